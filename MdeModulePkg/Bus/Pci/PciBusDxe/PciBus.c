@@ -38,6 +38,18 @@ EFI_PCI_PLATFORM_PROTOCOL                     *gPciPlatformProtocol;
 EFI_PCI_OVERRIDE_PROTOCOL                     *gPciOverrideProtocol;
 EDKII_IOMMU_PROTOCOL                          *mIoMmuProtocol;
 EDKII_DEVICE_SECURITY_PROTOCOL                *mDeviceSecurityProtocol;
+EDKII_PROTOCOL_NOTIFY_BATCH_PROTOCOL          *mProtocolNotifyBatch;
+
+//
+// Protocols installed on the PCI devices, whose notifications are made once
+// for all the devices started under a host bridge
+//
+EFI_GUID                                      *mPciNotifyBatchProtocols[] = {
+  &gEfiDevicePathProtocolGuid,
+  &gEfiPciIoProtocolGuid,
+  &gEfiLoadFile2ProtocolGuid,
+  &gEfiBusSpecificDriverOverrideProtocolGuid
+};
 
 GLOBAL_REMOVE_IF_UNREFERENCED EFI_PCI_HOTPLUG_REQUEST_PROTOCOL mPciHotPlugRequest = {
   PciHotPlugRequestNotify
@@ -234,9 +246,10 @@ PciBusDriverBindingStart (
   IN EFI_DEVICE_PATH_PROTOCOL     *RemainingDevicePath
   )
 {
-  EFI_STATUS                      Status;
-  EFI_DEVICE_PATH_PROTOCOL        *ParentDevicePath;
-  EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL *PciRootBridgeIo;
+  EFI_STATUS                        Status;
+  EFI_DEVICE_PATH_PROTOCOL          *ParentDevicePath;
+  EFI_PCI_ROOT_BRIDGE_IO_PROTOCOL   *PciRootBridgeIo;
+  EDKII_PROTOCOL_NOTIFY_BATCH_TOKEN BatchToken;
 
   //
   // Initialize PciRootBridgeIo to suppress incorrect compiler warning.
@@ -301,6 +314,14 @@ PciBusDriverBindingStart (
           );
   }
 
+  if (mProtocolNotifyBatch == NULL) {
+    gBS->LocateProtocol (
+          &gEdkiiProtocolNotifyBatchProtocolGuid,
+          NULL,
+          (VOID **) &mProtocolNotifyBatch
+          );
+  }
+
   if (PcdGetBool (PcdPciDisableBusEnumeration)) {
     gFullEnumeration = FALSE;
   } else {
@@ -363,10 +384,26 @@ PciBusDriverBindingStart (
   }
 
   //
-  // Start all the devices under the entire host bridge.
+  // Start all the devices under the entire host bridge.  The drivers waiting
+  // for the interfaces installed on the devices are notified once for all of
+  // them.
   //
+  BatchToken = NULL;
+  if ((mProtocolNotifyBatch != NULL) &&
+      EFI_ERROR (mProtocolNotifyBatch->BeginBatch (
+                                         mPciNotifyBatchProtocols,
+                                         ARRAY_SIZE (mPciNotifyBatchProtocols),
+                                         &BatchToken
+                                         ))) {
+    BatchToken = NULL;
+  }
+
   StartPciDevices (Controller);
 
+  if (BatchToken != NULL) {
+    mProtocolNotifyBatch->EndBatch (BatchToken);
+  }
+
   if (gFullEnumeration) {
     gFullEnumeration = FALSE;
 
@@ -28,6 +28,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/PciEnumerationComplete.h>
 #include <Protocol/IoMmu.h>
 #include <Protocol/DeviceSecurity.h>
+#include <Protocol/ProtocolNotifyBatch.h>
 
 #include <Library/DebugLib.h>
 #include <Library/UefiDriverEntryPoint.h>
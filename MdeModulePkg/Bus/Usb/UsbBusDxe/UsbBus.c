@@ -34,6 +34,8 @@ EFI_DRIVER_BINDING_PROTOCOL mUsbBusDriverBinding = {
   NULL
 };
 
+EDKII_PROTOCOL_NOTIFY_BATCH_PROTOCOL  *mUsbProtocolNotifyBatch = NULL;
+
 /**
   USB_IO function to execute a control transfer. This
   function will execute the USB transfer. If transfer
@@ -1110,6 +1112,15 @@ UsbBusDriverEntryPoint (
   IN EFI_SYSTEM_TABLE     *SystemTable
   )
 {
+  //
+  // The DXE Core may let the enumeration defer the protocol notifications
+  //
+  gBS->LocateProtocol (
+         &gEdkiiProtocolNotifyBatchProtocolGuid,
+         NULL,
+         (VOID **) &mUsbProtocolNotifyBatch
+         );
+
   return EfiLibInstallDriverBindingComponentName2 (
            ImageHandle,
            SystemTable,
@@ -17,6 +17,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/UsbHostController.h>
 #include <Protocol/UsbIo.h>
 #include <Protocol/DevicePath.h>
+#include <Protocol/ProtocolNotifyBatch.h>
 
 #include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
@@ -760,5 +761,6 @@ extern EFI_USB_IO_PROTOCOL            mUsbIoProtocol;
 extern EFI_DRIVER_BINDING_PROTOCOL    mUsbBusDriverBinding;
 extern EFI_COMPONENT_NAME_PROTOCOL    mUsbBusComponentName;
 extern EFI_COMPONENT_NAME2_PROTOCOL   mUsbBusComponentName2;
+extern EDKII_PROTOCOL_NOTIFY_BATCH_PROTOCOL  *mUsbProtocolNotifyBatch;
 
 #endif
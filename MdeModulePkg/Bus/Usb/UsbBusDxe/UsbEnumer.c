@@ -993,6 +993,61 @@ UsbEnumeratePort (
 }
 
 
+//
+// Protocols installed on the USB interfaces, whose notifications are made
+// once for all the devices enumerated on a hub
+//
+STATIC EFI_GUID  *mUsbNotifyBatchProtocols[] = {
+  &gEfiDevicePathProtocolGuid,
+  &gEfiUsbIoProtocolGuid
+};
+
+/**
+  Open a protocol notify batch, so that the drivers waiting for the USB I/O
+  interfaces of the devices enumerated are notified once for all of them.
+
+  @return The token of the batch, or NULL if no batch was opened.
+
+**/
+STATIC
+EDKII_PROTOCOL_NOTIFY_BATCH_TOKEN
+UsbBeginNotifyBatch (
+  VOID
+  )
+{
+  EDKII_PROTOCOL_NOTIFY_BATCH_TOKEN  Token;
+
+  if ((mUsbProtocolNotifyBatch == NULL) ||
+      EFI_ERROR (mUsbProtocolNotifyBatch->BeginBatch (
+                                            mUsbNotifyBatchProtocols,
+                                            ARRAY_SIZE (mUsbNotifyBatchProtocols),
+                                            &Token
+                                            ))) {
+    return NULL;
+  }
+
+  return Token;
+}
+
+
+/**
+  Close a protocol notify batch opened with UsbBeginNotifyBatch().
+
+  @param  Token                 The token of the batch, or NULL.
+
+**/
+STATIC
+VOID
+UsbEndNotifyBatch (
+  IN EDKII_PROTOCOL_NOTIFY_BATCH_TOKEN  Token
+  )
+{
+  if (Token != NULL) {
+    mUsbProtocolNotifyBatch->EndBatch (Token);
+  }
+}
+
+
 /**
   Enumerate all the changed hub ports.
 
@@ -1012,6 +1067,7 @@ UsbHubEnumeration (
   UINT8                   Bit;
   UINT8                   Index;
   USB_DEVICE              *Child;
+  EDKII_PROTOCOL_NOTIFY_BATCH_TOKEN  BatchToken;
 
   ASSERT (Context != NULL);
 
@@ -1035,6 +1091,7 @@ UsbHubEnumeration (
   Byte  = 0;
   Bit   = 1;
 
+  BatchToken = UsbBeginNotifyBatch ();
   for (Index = 0; Index < HubIf->NumOfPort; Index++) {
     if (USB_BIT_IS_SET (HubIf->ChangeMap[Byte], USB_BIT (Bit))) {
       UsbEnumeratePort (HubIf, Index);
@@ -1042,6 +1099,7 @@ UsbHubEnumeration (
 
     USB_NEXT_BIT (Byte, Bit);
   }
+  UsbEndNotifyBatch (BatchToken);
 
   UsbHubAckHubStatus (HubIf->Device);
 
@@ -1068,9 +1126,11 @@ UsbRootHubEnumeration (
   USB_INTERFACE           *RootHub;
   UINT8                   Index;
   USB_DEVICE              *Child;
+  EDKII_PROTOCOL_NOTIFY_BATCH_TOKEN  BatchToken;
 
   RootHub = (USB_INTERFACE *) Context;
 
+  BatchToken = UsbBeginNotifyBatch ();
   for (Index = 0; Index < RootHub->NumOfPort; Index++) {
     Child = UsbFindChild (RootHub, Index);
     if ((Child != NULL) && (Child->DisconnectFail == TRUE)) {
@@ -1080,4 +1140,5 @@ UsbRootHubEnumeration (
 
     UsbEnumeratePort (RootHub, Index);
   }
+  UsbEndNotifyBatch (BatchToken);
 }
@@ -19,6 +19,33 @@ BOOLEAN *mDepexEvaluationStack        = NULL;
 BOOLEAN *mDepexEvaluationStackEnd     = NULL;
 BOOLEAN *mDepexEvaluationStackPointer = NULL;
 
+#define DEPEX_WAITER_SIGNATURE  SIGNATURE_32('d','p','x','w')
+
+///
+/// DEPEX_WAITER - a driver whose dependency expression evaluated to FALSE,
+/// waiting for a protocol that the expression pushes.
+///
+typedef struct {
+  UINTN                   Signature;
+  /// Link on the mDepexWaiterIndex bucket of Protocol
+  LIST_ENTRY              Link;
+  EFI_GUID                Protocol;
+  EFI_CORE_DRIVER_ENTRY   *DriverEntry;
+} DEPEX_WAITER;
+
+//
+// Reverse index of the dependency expressions, from the protocols they push
+// to the drivers waiting for them, hashed by protocol GUID
+//
+LIST_ENTRY  mDepexWaiterIndex[DEPEX_WAITER_INDEX_SIZE];
+BOOLEAN     mDepexWaiterIndexInitialized = FALSE;
+
+//
+// Lock for mDepexWaiterIndex and EFI_CORE_DRIVER_ENTRY.DepexUnchanged, which
+// are updated from CoreInstallProtocolInterface()
+//
+EFI_LOCK    mDepexWaiterLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIFY);
+
 //
 // Worker functions
 //
@@ -148,6 +175,108 @@ PopBool (
 
 
 
+/**
+  Return the mDepexWaiterIndex bucket of a protocol.
+
+  @param  Protocol              The protocol GUID.
+
+  @return The list of the waiters for the protocols that share its bucket.
+
+**/
+LIST_ENTRY *
+CoreDepexWaiterBucket (
+  IN CONST EFI_GUID  *Protocol
+  )
+{
+  return &mDepexWaiterIndex[ReadUnaligned32 ((CONST UINT32 *) Protocol) & (DEPEX_WAITER_INDEX_SIZE - 1)];
+}
+
+
+
+/**
+  Index a driver under every protocol that its dependency expression pushes,
+  so that the installation of one of them marks the expression as changed.
+  The protocols already found installed, whose PUSH opcodes were replaced
+  with EFI_DEP_REPLACE_TRUE, are not waited for.
+
+  @param  DriverEntry           DriverEntry element to index.
+
+  @retval EFI_SUCCESS           The driver was indexed.
+  @retval EFI_UNSUPPORTED       The dependency expression is malformed.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough system memory to index the
+                                driver.
+
+**/
+EFI_STATUS
+CoreRegisterDepexWaiters (
+  IN  EFI_CORE_DRIVER_ENTRY   *DriverEntry
+  )
+{
+  UINT8         *Iterator;
+  UINT8         *End;
+  UINTN         Count;
+  UINTN         Index;
+  DEPEX_WAITER  *Waiters;
+
+  //
+  // Count the PUSH opcodes, and check that the expression ends in an END
+  // opcode, so that every protocol it depends on is known
+  //
+  Count    = 0;
+  Iterator = DriverEntry->Depex;
+  End      = Iterator + DriverEntry->DepexSize;
+  while (Iterator < End && *Iterator != EFI_DEP_END) {
+    if (*Iterator == EFI_DEP_PUSH) {
+      Count++;
+    }
+    if (*Iterator == EFI_DEP_PUSH || *Iterator == EFI_DEP_REPLACE_TRUE ||
+        *Iterator == EFI_DEP_BEFORE || *Iterator == EFI_DEP_AFTER) {
+      Iterator += sizeof (EFI_GUID);
+    }
+    Iterator++;
+  }
+  if (Iterator >= End) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Waiters = AllocatePool ((Count + 1) * sizeof (DEPEX_WAITER));
+  if (Waiters == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  CoreAcquireLock (&mDepexWaiterLock);
+
+  if (!mDepexWaiterIndexInitialized) {
+    for (Index = 0; Index < DEPEX_WAITER_INDEX_SIZE; Index++) {
+      InitializeListHead (&mDepexWaiterIndex[Index]);
+    }
+    mDepexWaiterIndexInitialized = TRUE;
+  }
+
+  Index = 0;
+  for (Iterator = DriverEntry->Depex; *Iterator != EFI_DEP_END; Iterator++) {
+    if (*Iterator == EFI_DEP_PUSH) {
+      Waiters[Index].Signature   = DEPEX_WAITER_SIGNATURE;
+      Waiters[Index].DriverEntry = DriverEntry;
+      CopyMem (&Waiters[Index].Protocol, Iterator + 1, sizeof (EFI_GUID));
+      InsertTailList (CoreDepexWaiterBucket (&Waiters[Index].Protocol), &Waiters[Index].Link);
+      Index++;
+    }
+    if (*Iterator == EFI_DEP_PUSH || *Iterator == EFI_DEP_REPLACE_TRUE ||
+        *Iterator == EFI_DEP_BEFORE || *Iterator == EFI_DEP_AFTER) {
+      Iterator += sizeof (EFI_GUID);
+    }
+  }
+  DriverEntry->DepexWaiters     = Waiters;
+  DriverEntry->DepexWaiterCount = Count;
+
+  CoreReleaseLock (&mDepexWaiterLock);
+
+  return EFI_SUCCESS;
+}
+
+
+
 /**
   Preprocess dependency expression and update DriverEntry to reflect the
   state of  Before, After, and SOR dependencies. If DriverEntry->Before
@@ -241,6 +370,21 @@ CoreIsSchedulable (
     return TRUE;
   }
 
+  //
+  // Index the driver under the protocols its Depex waits for the first time
+  // it is evaluated, and from now on until one of them is installed, the
+  // Depex is known to evaluate to the same result.  A Depex that cannot be
+  // indexed is always evaluated.
+  //
+  if (DriverEntry->DepexWaiters == NULL) {
+    CoreRegisterDepexWaiters (DriverEntry);
+  }
+  if (DriverEntry->DepexWaiters != NULL) {
+    CoreAcquireLock (&mDepexWaiterLock);
+    DriverEntry->DepexUnchanged = TRUE;
+    CoreReleaseLock (&mDepexWaiterLock);
+  }
+
   //
   // Clean out memory leaks in Depex Boolean stack. Leaks are only caused by
   // incorrectly formed DEPEX expressions
@@ -434,3 +578,73 @@ Done:
 }
 
 
+
+/**
+  Remove a driver from the index of the dependency expressions, when it
+  leaves the Dependent state.
+
+  @param  DriverEntry           DriverEntry element to remove.
+
+**/
+VOID
+CoreUnregisterDepexWaiters (
+  IN  EFI_CORE_DRIVER_ENTRY   *DriverEntry
+  )
+{
+  DEPEX_WAITER  *Waiters;
+  UINTN         Index;
+
+  if (DriverEntry->DepexWaiters == NULL) {
+    return;
+  }
+
+  CoreAcquireLock (&mDepexWaiterLock);
+
+  Waiters = DriverEntry->DepexWaiters;
+  for (Index = 0; Index < DriverEntry->DepexWaiterCount; Index++) {
+    RemoveEntryList (&Waiters[Index].Link);
+  }
+  DriverEntry->DepexWaiters     = NULL;
+  DriverEntry->DepexWaiterCount = 0;
+  DriverEntry->DepexUnchanged   = FALSE;
+
+  CoreReleaseLock (&mDepexWaiterLock);
+
+  FreePool (Waiters);
+}
+
+
+
+/**
+  Mark the dependency expressions that push a protocol as changed, when the
+  protocol is installed, so that the DXE Dispatcher evaluates them again.
+  The gProtocolDatabaseLock must be owned.
+
+  @param  Protocol              The GUID of the protocol installed.
+
+**/
+VOID
+CoreDepexProtocolInstalled (
+  IN CONST EFI_GUID  *Protocol
+  )
+{
+  LIST_ENTRY    *Bucket;
+  LIST_ENTRY    *Link;
+  DEPEX_WAITER  *Waiter;
+
+  if (!mDepexWaiterIndexInitialized) {
+    return;
+  }
+
+  CoreAcquireLock (&mDepexWaiterLock);
+
+  Bucket = CoreDepexWaiterBucket (Protocol);
+  for (Link = Bucket->ForwardLink; Link != Bucket; Link = Link->ForwardLink) {
+    Waiter = CR (Link, DEPEX_WAITER, Link, DEPEX_WAITER_SIGNATURE);
+    if (CompareGuid (&Waiter->Protocol, Protocol)) {
+      Waiter->DriverEntry->DepexUnchanged = FALSE;
+    }
+  }
+
+  CoreReleaseLock (&mDepexWaiterLock);
+}
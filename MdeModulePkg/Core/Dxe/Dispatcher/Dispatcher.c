@@ -61,6 +61,15 @@ EFI_LOCK  mDispatcherLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL);
 //
 BOOLEAN  gDispatcherRunning = FALSE;
 
+//
+// Statistics of the DXE Dispatcher: the number of searches of the
+// mDiscoveredList for drivers to schedule, and the number of Depex that were
+// evaluated and that were skipped because they could not have changed.
+//
+UINTN  mDispatcherPassCount     = 0;
+UINTN  mDepexEvaluationCount    = 0;
+UINTN  mDepexSkipCount          = 0;
+
 //
 // Module globals to manage the FwVol registration notification event
 //
@@ -454,6 +463,11 @@ CoreDispatcher (
       // skip the LoadImage
       //
       if (DriverEntry->ImageHandle == NULL && !DriverEntry->IsFvImage) {
+        //
+        // Decompress the images of the next drivers at once, on all processors
+        //
+        CorePrefetchScheduledImages ();
+
         DEBUG ((DEBUG_INFO, "Loading driver %g\n", &DriverEntry->FileName));
         Status = CoreLoadImage (
                         FALSE,
@@ -533,6 +547,8 @@ CoreDispatcher (
       ReturnStatus = EFI_SUCCESS;
     }
 
+    CoreFreePrefetchedImages ();
+
     //
     // Now DXE Dispatcher finished one round of dispatch, signal an event group
     // so that SMM Dispatcher get chance to dispatch SMM Drivers which depend
@@ -545,6 +561,8 @@ CoreDispatcher (
     //
     // Search DriverList for items to place on Scheduled Queue
     //
+    PERF_INMODULE_BEGIN ("DxeDepexEval");
+    mDispatcherPassCount++;
     ReadyToRun = FALSE;
     for (Link = mDiscoveredList.ForwardLink; Link != &mDiscoveredList; Link = Link->ForwardLink) {
       DriverEntry = CR (Link, EFI_CORE_DRIVER_ENTRY, Link, EFI_CORE_DRIVER_ENTRY_SIGNATURE);
@@ -557,6 +575,15 @@ CoreDispatcher (
       }
 
       if (DriverEntry->Dependent) {
+        if (DriverEntry->DepexUnchanged) {
+          //
+          // No protocol the Depex waits for was installed since it evaluated
+          // to FALSE
+          //
+          mDepexSkipCount++;
+          continue;
+        }
+        mDepexEvaluationCount++;
         if (CoreIsSchedulable (DriverEntry)) {
           CoreInsertOnScheduledQueueWhileProcessingBeforeAndAfter (DriverEntry);
           ReadyToRun = TRUE;
@@ -569,8 +596,17 @@ CoreDispatcher (
         }
       }
     }
+    PERF_INMODULE_END ("DxeDepexEval");
   } while (ReadyToRun);
 
+  DEBUG ((
+    DEBUG_DISPATCH,
+    "DXE Dispatcher: %d passes, %d DEPEX evaluated, %d DEPEX skipped\n",
+    mDispatcherPassCount,
+    mDepexEvaluationCount,
+    mDepexSkipCount
+    ));
+
   //
   // Close DXE dispatch Event
   //
@@ -634,6 +670,8 @@ CoreInsertOnScheduledQueueWhileProcessingBeforeAndAfter (
 
   CoreReleaseDispatcherLock ();
 
+  CoreUnregisterDepexWaiters (InsertedDriverEntry);
+
   //
   // Process After Dependency
   //
@@ -0,0 +1,704 @@
+/** @file
+  DXE Dispatcher image prefetch.
+
+  Before the DXE Dispatcher loads a driver, the images of the next drivers in
+  the scheduled queue are read from their firmware volumes, and the compressed
+  ones are decompressed in parallel on the application processors through the
+  MP Services Protocol.  CoreLoadImage() then takes the PE32 image from the
+  prefetched data instead of extracting it through the firmware volume.
+
+  The application processors are started without waiting for them: the boot
+  processor only waits for the image it loads, which it decompresses itself
+  if no application processor took it yet.  Once CoreLoadImage() is done with
+  that image, the boot processor takes the jobs left and waits for the
+  application processors to return, so that they are idle when the driver
+  starts.
+
+  Only the sections that the DXE Core would extract itself without calling
+  any service are decompressed on the application processors: standard
+  compression sections, and the LZMA and Brotli GUIDed sections.  Any other
+  file is left to the firmware volume.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeMain.h"
+
+//
+// Number of bytes of a file read to look for its first sections
+//
+#define IMAGE_PREFETCH_PEEK_SIZE        128
+
+//
+// States of a prefetch job
+//
+#define IMAGE_PREFETCH_JOB_PENDING      0
+#define IMAGE_PREFETCH_JOB_RUNNING      1
+#define IMAGE_PREFETCH_JOB_DONE         2
+
+///
+/// The decompression of the encapsulation section holding the PE32 image of
+/// a scheduled driver.
+///
+typedef struct {
+  volatile UINT32             State;
+  EFI_CORE_DRIVER_ENTRY       *DriverEntry;
+  VOID                        *FileBuffer;
+  UINT32                      FileAuthenticationStatus;
+  EFI_COMMON_SECTION_HEADER   *Section;
+  VOID                        *ScratchBuffer;
+  VOID                        *OutputBuffer;
+  UINT32                      OutputSize;
+  VOID                        *Stream;
+  UINT32                      AuthenticationStatus;
+  EFI_STATUS                  Status;
+} IMAGE_PREFETCH_JOB;
+
+//
+// The prefetch jobs of the current batch, and the index of the next job for
+// the application processors to take
+//
+IMAGE_PREFETCH_JOB        *mImagePrefetchJobs = NULL;
+UINT32                    mImagePrefetchJobCount = 0;
+volatile UINT32           mImagePrefetchNextJob = 0;
+
+//
+// The number of application processors that did not return from the jobs of
+// the current batch yet, and the event the MP Services Protocol signals once
+// they are done, which is kept as it may signal it later
+//
+volatile UINT32           mImagePrefetchRunningAps = 0;
+EFI_EVENT                 mImagePrefetchEvent = NULL;
+
+EFI_MP_SERVICES_PROTOCOL  *mImagePrefetchMpServices = NULL;
+
+extern LIST_ENTRY         mScheduledQueue;
+
+/**
+  Return the size of the header of a section.
+
+  @param  Section               The section.
+
+  @return The size of the common section header of the section.
+
+**/
+STATIC
+UINTN
+CoreSectionHeaderSize (
+  IN EFI_COMMON_SECTION_HEADER  *Section
+  )
+{
+  return IS_SECTION2 (Section) ? sizeof (EFI_COMMON_SECTION_HEADER2) : sizeof (EFI_COMMON_SECTION_HEADER);
+}
+
+/**
+  Return the size of a section, header included.
+
+  @param  Section               The section.
+
+  @return The size of the section.
+
+**/
+STATIC
+UINTN
+CoreSectionSize (
+  IN EFI_COMMON_SECTION_HEADER  *Section
+  )
+{
+  return IS_SECTION2 (Section) ? SECTION2_SIZE (Section) : SECTION_SIZE (Section);
+}
+
+/**
+  Find the first section of a section stream that is a PE32 section or an
+  encapsulation section, the way the section extraction searches for the
+  PE32 section.  The section found may extend past the end of the stream,
+  which can be the first bytes of a longer stream.
+
+  @param  Stream                The section stream.
+  @param  StreamSize            The size of the section stream.
+  @param  Section               The section found.
+
+  @retval EFI_SUCCESS           A PE32 or encapsulation section was found.
+  @retval EFI_NOT_FOUND         The stream has no such section.
+
+**/
+STATIC
+EFI_STATUS
+CoreFindImageSection (
+  IN  VOID                        *Stream,
+  IN  UINTN                       StreamSize,
+  OUT EFI_COMMON_SECTION_HEADER   **Section
+  )
+{
+  UINTN                       Offset;
+  UINTN                       SectionSize;
+  EFI_COMMON_SECTION_HEADER   *Header;
+
+  Offset = 0;
+  while (Offset + sizeof (EFI_COMMON_SECTION_HEADER) <= StreamSize) {
+    Header = (EFI_COMMON_SECTION_HEADER *) ((UINT8 *) Stream + Offset);
+    if (Offset + CoreSectionHeaderSize (Header) > StreamSize) {
+      break;
+    }
+    SectionSize = CoreSectionSize (Header);
+    if (SectionSize < CoreSectionHeaderSize (Header)) {
+      return EFI_NOT_FOUND;
+    }
+
+    switch (Header->Type) {
+    case EFI_SECTION_PE32:
+    case EFI_SECTION_COMPRESSION:
+    case EFI_SECTION_GUID_DEFINED:
+      *Section = Header;
+      return EFI_SUCCESS;
+    }
+
+    Offset = ALIGN_VALUE (Offset + SectionSize, 4);
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Prepare the decompression of an encapsulation section on an application
+  processor, if the section is one that decompresses without calling any
+  service.
+
+  @param  Job                   The prefetch job, with the section to decompress.
+
+  @retval EFI_SUCCESS           The buffers of the decompression were allocated.
+  @retval EFI_UNSUPPORTED       The section is not decompressed ahead of time.
+  @retval EFI_OUT_OF_RESOURCES  The buffers could not be allocated.
+
+**/
+STATIC
+EFI_STATUS
+CorePrepareImagePrefetchJob (
+  IN OUT IMAGE_PREFETCH_JOB  *Job
+  )
+{
+  EFI_STATUS                Status;
+  EFI_COMMON_SECTION_HEADER *Section;
+  EFI_GUID                  *SectionDefinitionGuid;
+  UINT16                    Attributes;
+  UINT32                    ScratchSize;
+  UINTN                     HeaderSize;
+  UINT8                     CompressionType;
+
+  Section = Job->Section;
+  if (Section->Type == EFI_SECTION_COMPRESSION) {
+    HeaderSize = IS_SECTION2 (Section) ? sizeof (EFI_COMPRESSION_SECTION2) : sizeof (EFI_COMPRESSION_SECTION);
+    if (CoreSectionSize (Section) < HeaderSize) {
+      return EFI_UNSUPPORTED;
+    }
+    if (IS_SECTION2 (Section)) {
+      CompressionType = ((EFI_COMPRESSION_SECTION2 *) Section)->CompressionType;
+    } else {
+      CompressionType = ((EFI_COMPRESSION_SECTION *) Section)->CompressionType;
+    }
+    if (CompressionType != EFI_STANDARD_COMPRESSION) {
+      return EFI_UNSUPPORTED;
+    }
+    Status = UefiDecompressGetInfo (
+               (UINT8 *) Section + HeaderSize,
+               (UINT32) (CoreSectionSize (Section) - HeaderSize),
+               &Job->OutputSize,
+               &ScratchSize
+               );
+  } else {
+    HeaderSize = IS_SECTION2 (Section) ? sizeof (EFI_GUID_DEFINED_SECTION2) : sizeof (EFI_GUID_DEFINED_SECTION);
+    if (CoreSectionSize (Section) < HeaderSize) {
+      return EFI_UNSUPPORTED;
+    }
+    if (IS_SECTION2 (Section)) {
+      SectionDefinitionGuid = &((EFI_GUID_DEFINED_SECTION2 *) Section)->SectionDefinitionGuid;
+      Attributes            = ((EFI_GUID_DEFINED_SECTION2 *) Section)->Attributes;
+    } else {
+      SectionDefinitionGuid = &((EFI_GUID_DEFINED_SECTION *) Section)->SectionDefinitionGuid;
+      Attributes            = ((EFI_GUID_DEFINED_SECTION *) Section)->Attributes;
+    }
+    if ((Attributes & EFI_GUIDED_SECTION_PROCESSING_REQUIRED) == 0) {
+      return EFI_UNSUPPORTED;
+    }
+    if (!CompareGuid (SectionDefinitionGuid, &gLzmaCustomDecompressGuid) &&
+        !CompareGuid (SectionDefinitionGuid, &gLzmaF86CustomDecompressGuid) &&
+        !CompareGuid (SectionDefinitionGuid, &gBrotliCustomDecompressGuid)) {
+      return EFI_UNSUPPORTED;
+    }
+    Status = ExtractGuidedSectionGetInfo (Section, &Job->OutputSize, &ScratchSize, &Attributes);
+  }
+  if (EFI_ERROR (Status) || (Job->OutputSize == 0)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Job->OutputBuffer = AllocatePool (Job->OutputSize);
+  if (ScratchSize != 0) {
+    Job->ScratchBuffer = AllocatePool (ScratchSize);
+  }
+  if ((Job->OutputBuffer == NULL) || ((ScratchSize != 0) && (Job->ScratchBuffer == NULL))) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Release the buffers of a prefetch job.  The job is left done, so that no
+  processor takes it.
+
+  @param  Job                   The prefetch job.
+
+**/
+STATIC
+VOID
+CoreFreeImagePrefetchJob (
+  IN OUT IMAGE_PREFETCH_JOB  *Job
+  )
+{
+  if (Job->FileBuffer != NULL) {
+    CoreFreePool (Job->FileBuffer);
+  }
+  if (Job->ScratchBuffer != NULL) {
+    CoreFreePool (Job->ScratchBuffer);
+  }
+  if (Job->OutputBuffer != NULL) {
+    CoreFreePool (Job->OutputBuffer);
+  }
+  ZeroMem (Job, sizeof (IMAGE_PREFETCH_JOB));
+  Job->State = IMAGE_PREFETCH_JOB_DONE;
+}
+
+/**
+  Decompress the section of a prefetch job, unless another processor took it.
+  It runs on application processors, so it must not call any service.
+
+  @param  Job                   The prefetch job.
+
+**/
+STATIC
+VOID
+CoreRunImagePrefetchJob (
+  IN OUT IMAGE_PREFETCH_JOB  *Job
+  )
+{
+  UINTN                     HeaderSize;
+
+  if (InterlockedCompareExchange32 (
+        (UINT32 *) &Job->State,
+        IMAGE_PREFETCH_JOB_PENDING,
+        IMAGE_PREFETCH_JOB_RUNNING
+        ) != IMAGE_PREFETCH_JOB_PENDING) {
+    return;
+  }
+
+  if (Job->Section->Type == EFI_SECTION_COMPRESSION) {
+    HeaderSize  = IS_SECTION2 (Job->Section) ? sizeof (EFI_COMPRESSION_SECTION2) : sizeof (EFI_COMPRESSION_SECTION);
+    Job->Stream = Job->OutputBuffer;
+    Job->Status = UefiDecompress ((UINT8 *) Job->Section + HeaderSize, Job->OutputBuffer, Job->ScratchBuffer);
+  } else {
+    Job->Stream = Job->OutputBuffer;
+    Job->Status = ExtractGuidedSectionDecode (
+                    Job->Section,
+                    &Job->Stream,
+                    Job->ScratchBuffer,
+                    &Job->AuthenticationStatus
+                    );
+  }
+
+  MemoryFence ();
+  Job->State = IMAGE_PREFETCH_JOB_DONE;
+}
+
+/**
+  Take the prefetch jobs of the current batch one after the other, until all
+  of them are taken.  Runs on the application processors, and on the boot
+  processor for the jobs they did not take.
+
+  @param  Buffer                On the application processors, the number of
+                                them that did not return yet, which is
+                                decremented once all the jobs are taken.
+                                NULL on the boot processor.
+
+**/
+STATIC
+VOID
+EFIAPI
+CoreImagePrefetchProcedure (
+  IN OUT VOID  *Buffer
+  )
+{
+  UINT32  Index;
+
+  for (;;) {
+    Index = InterlockedIncrement (&mImagePrefetchNextJob) - 1;
+    if (Index >= mImagePrefetchJobCount) {
+      break;
+    }
+    CoreRunImagePrefetchJob (&mImagePrefetchJobs[Index]);
+  }
+
+  if (Buffer != NULL) {
+    InterlockedDecrement ((UINT32 *) Buffer);
+  }
+}
+
+/**
+  Take the prefetch jobs of the current batch that no processor took, and
+  wait for the application processors to return, so that they are idle and
+  all the jobs are done.
+
+**/
+STATIC
+VOID
+CoreWaitImagePrefetchJobs (
+  VOID
+  )
+{
+  if (mImagePrefetchRunningAps == 0) {
+    return;
+  }
+
+  CoreImagePrefetchProcedure (NULL);
+  while (mImagePrefetchRunningAps != 0) {
+    CpuPause ();
+  }
+}
+
+/**
+  Release the prefetch jobs of the current batch, once all of them are done.
+
+**/
+STATIC
+VOID
+CoreFreeImagePrefetchJobs (
+  VOID
+  )
+{
+  UINT32  Index;
+
+  CoreWaitImagePrefetchJobs ();
+  for (Index = 0; Index < mImagePrefetchJobCount; Index++) {
+    if (mImagePrefetchJobs[Index].DriverEntry != NULL) {
+      CoreFreeImagePrefetchJob (&mImagePrefetchJobs[Index]);
+    }
+  }
+  mImagePrefetchJobCount = 0;
+}
+
+/**
+  Read the file of a scheduled driver, and set up a prefetch job for it if
+  its PE32 image is in a section that can be decompressed ahead of time.
+
+  @param  DriverEntry           The scheduled driver.
+  @param  Job                   The prefetch job to set up.
+
+  @retval EFI_SUCCESS           The prefetch job was set up.
+  @retval Others                The image of the driver is not prefetched.
+
+**/
+STATIC
+EFI_STATUS
+CoreSetupImagePrefetchJob (
+  IN  EFI_CORE_DRIVER_ENTRY  *DriverEntry,
+  OUT IMAGE_PREFETCH_JOB     *Job
+  )
+{
+  EFI_STATUS                Status;
+  UINT8                     Peek[IMAGE_PREFETCH_PEEK_SIZE];
+  VOID                      *Buffer;
+  UINTN                     Size;
+  EFI_FV_FILETYPE           Type;
+  EFI_FV_FILE_ATTRIBUTES    Attributes;
+  UINT32                    AuthenticationStatus;
+  EFI_COMMON_SECTION_HEADER *Section;
+
+  //
+  // Look at the first sections of the file, which tell whether its image is
+  // compressed, without reading all of it
+  //
+  Buffer = Peek;
+  Size   = sizeof (Peek);
+  Status = DriverEntry->Fv->ReadFile (
+                              DriverEntry->Fv,
+                              &DriverEntry->FileName,
+                              &Buffer,
+                              &Size,
+                              &Type,
+                              &Attributes,
+                              &AuthenticationStatus
+                              );
+  if (EFI_ERROR (Status) || (Type == EFI_FV_FILETYPE_RAW)) {
+    return EFI_UNSUPPORTED;
+  }
+  Status = CoreFindImageSection (Peek, MIN (Size, sizeof (Peek)), &Section);
+  if (!EFI_ERROR (Status) && Section->Type == EFI_SECTION_PE32) {
+    return EFI_UNSUPPORTED;
+  }
+  if (EFI_ERROR (Status) && Size <= sizeof (Peek)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // Read the whole file, whose first sections may not reach the image
+  //
+  ZeroMem (Job, sizeof (IMAGE_PREFETCH_JOB));
+  Job->DriverEntry = DriverEntry;
+  Status = DriverEntry->Fv->ReadFile (
+                              DriverEntry->Fv,
+                              &DriverEntry->FileName,
+                              &Job->FileBuffer,
+                              &Size,
+                              &Type,
+                              &Attributes,
+                              &Job->FileAuthenticationStatus
+                              );
+  if (EFI_ERROR (Status)) {
+    Job->FileBuffer = NULL;
+    return Status;
+  }
+
+  Status = CoreFindImageSection (Job->FileBuffer, Size, &Job->Section);
+  if (!EFI_ERROR (Status) && Job->Section->Type != EFI_SECTION_PE32 &&
+      (UINT8 *) Job->Section + CoreSectionSize (Job->Section) <= (UINT8 *) Job->FileBuffer + Size) {
+    Status = CorePrepareImagePrefetchJob (Job);
+  } else {
+    Status = EFI_UNSUPPORTED;
+  }
+  if (EFI_ERROR (Status)) {
+    CoreFreeImagePrefetchJob (Job);
+  }
+
+  return Status;
+}
+
+/**
+  Prefetch the images of the next drivers in the scheduled queue, unless the
+  driver at the head of the queue was already considered.  The compressed
+  images are decompressed in parallel on the application processors when the
+  MP Services Protocol is available, and on the boot processor otherwise.
+  It returns without waiting for the application processors.
+
+  The number of images prefetched at a time is PcdDxeImagePrefetchCount; 0
+  disables the prefetch.
+
+**/
+VOID
+CorePrefetchScheduledImages (
+  VOID
+  )
+{
+  EFI_STATUS             Status;
+  LIST_ENTRY             *Link;
+  EFI_CORE_DRIVER_ENTRY  *DriverEntry;
+  UINTN                  NumberOfProcessors;
+  UINTN                  NumberOfEnabledProcessors;
+
+  if (PcdGet32 (PcdDxeImagePrefetchCount) == 0 || IsListEmpty (&mScheduledQueue)) {
+    return;
+  }
+
+  DriverEntry = CR (mScheduledQueue.ForwardLink, EFI_CORE_DRIVER_ENTRY, ScheduledLink, EFI_CORE_DRIVER_ENTRY_SIGNATURE);
+  if (DriverEntry->Prefetched) {
+    return;
+  }
+
+  if (mImagePrefetchJobs == NULL) {
+    mImagePrefetchJobs = AllocateZeroPool (PcdGet32 (PcdDxeImagePrefetchCount) * sizeof (IMAGE_PREFETCH_JOB));
+    if (mImagePrefetchJobs == NULL) {
+      return;
+    }
+  }
+
+  CoreFreeImagePrefetchJobs ();
+
+  for (Link = mScheduledQueue.ForwardLink;
+       Link != &mScheduledQueue && mImagePrefetchJobCount < PcdGet32 (PcdDxeImagePrefetchCount);
+       Link = Link->ForwardLink) {
+    DriverEntry = CR (Link, EFI_CORE_DRIVER_ENTRY, ScheduledLink, EFI_CORE_DRIVER_ENTRY_SIGNATURE);
+    if (DriverEntry->Prefetched || DriverEntry->ImageHandle != NULL || DriverEntry->IsFvImage) {
+      continue;
+    }
+
+    DriverEntry->Prefetched = TRUE;
+    Status = CoreSetupImagePrefetchJob (DriverEntry, &mImagePrefetchJobs[mImagePrefetchJobCount]);
+    if (!EFI_ERROR (Status)) {
+      mImagePrefetchJobCount++;
+    }
+  }
+
+  if (mImagePrefetchJobCount == 0) {
+    return;
+  }
+
+  //
+  // Start the decompression on the application processors without waiting
+  // for them.  The jobs they do not take are left to the boot processor.
+  //
+  mImagePrefetchNextJob = 0;
+  if (mImagePrefetchJobCount > 1) {
+    if (mImagePrefetchMpServices == NULL) {
+      CoreLocateProtocol (&gEfiMpServiceProtocolGuid, NULL, (VOID **) &mImagePrefetchMpServices);
+    }
+    if (mImagePrefetchMpServices != NULL && mImagePrefetchEvent == NULL) {
+      Status = CoreCreateEvent (0, TPL_CALLBACK, NULL, NULL, &mImagePrefetchEvent);
+      if (EFI_ERROR (Status)) {
+        mImagePrefetchEvent = NULL;
+      }
+    }
+    if (mImagePrefetchEvent != NULL) {
+      Status = mImagePrefetchMpServices->GetNumberOfProcessors (
+                                           mImagePrefetchMpServices,
+                                           &NumberOfProcessors,
+                                           &NumberOfEnabledProcessors
+                                           );
+      if (!EFI_ERROR (Status) && NumberOfEnabledProcessors > 1) {
+        mImagePrefetchRunningAps = (UINT32) (NumberOfEnabledProcessors - 1);
+        Status = mImagePrefetchMpServices->StartupAllAPs (
+                                             mImagePrefetchMpServices,
+                                             CoreImagePrefetchProcedure,
+                                             FALSE,
+                                             mImagePrefetchEvent,
+                                             0,
+                                             (VOID *) &mImagePrefetchRunningAps,
+                                             NULL
+                                             );
+        if (EFI_ERROR (Status)) {
+          mImagePrefetchRunningAps = 0;
+        }
+        DEBUG ((DEBUG_DISPATCH, "Prefetch %d driver images on the application processors - %r\n", mImagePrefetchJobCount, Status));
+      }
+    }
+  }
+}
+
+/**
+  Return the PE32 image of a driver prefetched by CorePrefetchScheduledImages(),
+  the way GetFileBufferByFilePath() returns it from the firmware volume.  The
+  image is decompressed on the boot processor if no application processor
+  took it yet, and waited for otherwise.
+
+  @param  FilePath              The device path of the driver file.
+  @param  ImageSize             The size of the image returned.
+  @param  AuthenticationStatus  The authentication status of the image.
+
+  @return The PE32 image, to release with CoreReleasePrefetchedImage() once
+          it is loaded, or NULL if the image of the driver was not prefetched.
+
+**/
+VOID *
+CoreGetPrefetchedImage (
+  IN  CONST EFI_DEVICE_PATH_PROTOCOL  *FilePath,
+  OUT UINTN                           *ImageSize,
+  OUT UINT32                          *AuthenticationStatus
+  )
+{
+  UINT32                    Index;
+  IMAGE_PREFETCH_JOB        *Job;
+  EFI_STATUS                Status;
+  EFI_COMMON_SECTION_HEADER *Section;
+  UINT16                    Attributes;
+  VOID                      *Image;
+
+  Job = NULL;
+  for (Index = 0; Index < mImagePrefetchJobCount; Index++) {
+    if (mImagePrefetchJobs[Index].DriverEntry != NULL &&
+        mImagePrefetchJobs[Index].DriverEntry->FvFileDevicePath == FilePath) {
+      Job = &mImagePrefetchJobs[Index];
+      break;
+    }
+  }
+  if (Job == NULL) {
+    CoreWaitImagePrefetchJobs ();
+    return NULL;
+  }
+
+  CoreRunImagePrefetchJob (Job);
+  while (Job->State != IMAGE_PREFETCH_JOB_DONE) {
+    CpuPause ();
+  }
+
+  Image = NULL;
+  if (!EFI_ERROR (Job->Status)) {
+    //
+    // Only a PE32 section at the top of the decompressed stream is found the
+    // same way as by the section extraction; leave anything else to it
+    //
+    Status = CoreFindImageSection (Job->Stream, Job->OutputSize, &Section);
+    if (!EFI_ERROR (Status) && Section->Type == EFI_SECTION_PE32 &&
+        (UINT8 *) Section + CoreSectionSize (Section) <= (UINT8 *) Job->Stream + Job->OutputSize) {
+      *ImageSize = CoreSectionSize (Section) - CoreSectionHeaderSize (Section);
+      Image      = (UINT8 *) Section + CoreSectionHeaderSize (Section);
+    }
+
+    //
+    // Inherit the authentication status of the section extraction
+    //
+    if (Job->Section->Type == EFI_SECTION_GUID_DEFINED) {
+      if (IS_SECTION2 (Job->Section)) {
+        Attributes = ((EFI_GUID_DEFINED_SECTION2 *) Job->Section)->Attributes;
+      } else {
+        Attributes = ((EFI_GUID_DEFINED_SECTION *) Job->Section)->Attributes;
+      }
+      if ((Attributes & EFI_GUIDED_SECTION_AUTH_STATUS_VALID) == 0) {
+        Job->AuthenticationStatus = 0;
+      }
+    } else {
+      Job->AuthenticationStatus = 0;
+    }
+    *AuthenticationStatus = Job->AuthenticationStatus | Job->FileAuthenticationStatus;
+  }
+
+  if (Image == NULL) {
+    CoreWaitImagePrefetchJobs ();
+    CoreFreeImagePrefetchJob (Job);
+  }
+  return Image;
+}
+
+/**
+  Release a PE32 image returned by CoreGetPrefetchedImage(), once the image is
+  loaded.  The jobs of its batch are waited for, so that the application
+  processors are idle when the driver starts.
+
+  @param  Image                 The PE32 image.
+
+**/
+VOID
+CoreReleasePrefetchedImage (
+  IN VOID  *Image
+  )
+{
+  UINT32              Index;
+  IMAGE_PREFETCH_JOB  *Job;
+
+  CoreWaitImagePrefetchJobs ();
+  for (Index = 0; Index < mImagePrefetchJobCount; Index++) {
+    Job = &mImagePrefetchJobs[Index];
+    if (Job->DriverEntry != NULL &&
+        (UINT8 *) Image >= (UINT8 *) Job->Stream &&
+        (UINT8 *) Image < (UINT8 *) Job->Stream + Job->OutputSize) {
+      CoreFreeImagePrefetchJob (Job);
+      return;
+    }
+  }
+  ASSERT (FALSE);
+}
+
+/**
+  Release the driver images prefetched by CorePrefetchScheduledImages() that
+  were not loaded, and the prefetch jobs, at the end of a round of dispatch.
+
+**/
+VOID
+CoreFreePrefetchedImages (
+  VOID
+  )
+{
+  CoreFreeImagePrefetchJobs ();
+  if (mImagePrefetchJobs != NULL) {
+    CoreFreePool (mImagePrefetchJobs);
+    mImagePrefetchJobs = NULL;
+  }
+}
@@ -47,6 +47,12 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/HiiPackageList.h>
 #include <Protocol/SmmBase2.h>
 #include <Protocol/PeCoffImageEmulator.h>
+#include <Protocol/HandleSnapshot.h>
+#include <Protocol/TimerStatistics.h>
+#include <Protocol/TimerOneShot.h>
+#include <Protocol/SectionCache.h>
+#include <Protocol/ProtocolNotifyBatch.h>
+#include <Protocol/MpService.h>
 #include <Guid/MemoryTypeInformation.h>
 #include <Guid/FirmwareFileSystem2.h>
 #include <Guid/FirmwareFileSystem3.h>
@@ -86,6 +92,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/DxeServicesLib.h>
 #include <Library/DebugAgentLib.h>
 #include <Library/CpuExceptionHandlerLib.h>
+#include <Library/SynchronizationLib.h>
 
 
 //
@@ -116,6 +123,12 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 ///
 #define DEPEX_STACK_SIZE_INCREMENT  0x1000
 
+///
+/// Number of buckets of the index of the drivers waiting for protocols.  Must
+/// be a power of two.
+///
+#define DEPEX_WAITER_INDEX_SIZE     64
+
 typedef struct {
   EFI_GUID                    *ProtocolGuid;
   VOID                        **Protocol;
@@ -163,8 +176,17 @@ typedef struct {
   BOOLEAN                         Initialized;
   BOOLEAN                         DepexProtocolError;
 
+  //
+  // Set when the Depex evaluated to FALSE and none of the protocols it pushes
+  // was installed since
+  //
+  BOOLEAN                         DepexUnchanged;
+  VOID                            *DepexWaiters;
+  UINTN                           DepexWaiterCount;
+
   EFI_HANDLE                      ImageHandle;
   BOOLEAN                         IsFvImage;
+  BOOLEAN                         Prefetched;
 
 } EFI_CORE_DRIVER_ENTRY;
 
@@ -472,6 +494,18 @@ CoreTimerTick (
   );
 
 
+/**
+  Switches the timer interrupt to one-shot mode if PcdTimerOneShotEnable is set
+  and the Timer Architectural Protocol driver produces the Timer One-Shot
+  Protocol.  Called once the Timer Architectural Protocol is available.
+
+**/
+VOID
+CoreInitializeTimerOneShot (
+  VOID
+  );
+
+
 /**
   Initialize the dispatcher. Initialize the notification function that runs when
   an FV2 protocol is added to the system.
@@ -502,6 +536,33 @@ CoreIsSchedulable (
   );
 
 
+/**
+  Remove a driver from the index of the dependency expressions, when it
+  leaves the Dependent state.
+
+  @param  DriverEntry           DriverEntry element to remove.
+
+**/
+VOID
+CoreUnregisterDepexWaiters (
+  IN  EFI_CORE_DRIVER_ENTRY   *DriverEntry
+  );
+
+
+/**
+  Mark the dependency expressions that push a protocol as changed, when the
+  protocol is installed, so that the DXE Dispatcher evaluates them again.
+  The gProtocolDatabaseLock must be owned.
+
+  @param  Protocol              The GUID of the protocol installed.
+
+**/
+VOID
+CoreDepexProtocolInstalled (
+  IN CONST EFI_GUID  *Protocol
+  );
+
+
 /**
   Preprocess dependency expression and update DriverEntry to reflect the
   state of  Before, After, and SOR dependencies. If DriverEntry->Before
@@ -996,6 +1057,70 @@ CoreRegisterProtocolNotify (
   );
 
 
+/**
+  Open a batch of protocol notifications.  Until the batch is closed, the
+  events registered with RegisterProtocolNotify() for one of the protocols of
+  the batch are not signaled when an interface of the protocol is installed
+  or reinstalled.  While several batches covering a protocol are open, its
+  notifications are made when the last of them is closed.
+
+  @param  Protocols              The protocols whose notifications to defer.
+  @param  ProtocolCount          The number of protocols in Protocols.
+  @param  Token                  Returns the token identifying the batch.
+
+  @retval EFI_SUCCESS            The batch was opened.
+  @retval EFI_INVALID_PARAMETER  Protocols is NULL, or one of its entries is
+                                 NULL.
+  @retval EFI_INVALID_PARAMETER  ProtocolCount is 0.
+  @retval EFI_INVALID_PARAMETER  Token is NULL.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to open the batch.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreBeginProtocolNotifyBatch (
+  IN  EFI_GUID                           **Protocols,
+  IN  UINTN                              ProtocolCount,
+  OUT EDKII_PROTOCOL_NOTIFY_BATCH_TOKEN  *Token
+  );
+
+
+/**
+  Close a batch of protocol notifications opened with
+  CoreBeginProtocolNotifyBatch().  Each event registered for a protocol of
+  the batch that had interfaces installed or reinstalled during the batch is
+  signaled once, unless another open batch still covers the protocol.
+
+  @param  Token                  The token returned when the batch was opened.
+
+  @retval EFI_SUCCESS            The batch was closed.
+  @retval EFI_INVALID_PARAMETER  Token is not the token of an open batch.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreEndProtocolNotifyBatch (
+  IN EDKII_PROTOCOL_NOTIFY_BATCH_TOKEN  Token
+  );
+
+
+/**
+  Retrieve the statistics of the protocol notifications since the DXE Core
+  started.
+
+  @param  Statistics             The buffer to return the statistics in.
+
+  @retval EFI_SUCCESS            The statistics were returned.
+  @retval EFI_INVALID_PARAMETER  Statistics is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreGetProtocolNotifyBatchStatistics (
+  OUT EDKII_PROTOCOL_NOTIFY_BATCH_STATISTICS  *Statistics
+  );
+
+
 /**
   Removes all the events in the protocol database that match Event.
 
@@ -1100,6 +1225,38 @@ CoreLocateHandleBuffer (
 
 
 
+/**
+  Function returns an array of the handles on which the requested protocol was
+  installed or reinstalled after a generation of the handle database, in a
+  buffer allocated from pool.
+
+  @param  Protocol               Provides the protocol to search by.
+  @param  Generation             On input, the generation returned by the
+                                 previous call, or 0 to return all the handles
+                                 that support Protocol.  On output, the current
+                                 generation.
+  @param  NumberHandles          The number of handles returned in Buffer.
+  @param  Buffer                 A pointer to the buffer to return the requested
+                                 array of  handles that support Protocol.
+
+  @retval EFI_SUCCESS            The result array of handles was returned.
+  @retval EFI_NOT_FOUND          No handles match the search.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough pool memory to store the
+                                 matching results.
+  @retval EFI_INVALID_PARAMETER  One or more parameters are not valid.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreLocateHandleBufferSince (
+  IN     EFI_GUID                 *Protocol,
+  IN OUT UINT64                   *Generation,
+  OUT    UINTN                    *NumberHandles,
+  OUT    EFI_HANDLE               **Buffer
+  );
+
+
+
 /**
   Return the first Protocol Interface that matches the Protocol GUID. If
   Registration is passed in, return a Protocol Instance that was just add
@@ -1639,6 +1796,37 @@ CoreSetTimer (
 
 
 
+/**
+  Retrieve the statistics of the timer database since the DXE Core started or
+  since they were last reset.
+
+  @param  Statistics             The buffer to return the statistics in.
+
+  @retval EFI_SUCCESS            The statistics were returned.
+  @retval EFI_INVALID_PARAMETER  Statistics is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreGetTimerStatistics (
+  OUT EDKII_TIMER_STATISTICS  *Statistics
+  );
+
+
+/**
+  Reset the statistics of the timer database.
+
+  @retval EFI_SUCCESS            The statistics were reset.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreResetTimerStatistics (
+  VOID
+  );
+
+
+
 /**
   Signals the event.  Queues the event to be notified if needed.
 
@@ -2040,6 +2228,66 @@ CoreDispatcher (
   VOID
   );
 
+/**
+  Prefetch the images of the next drivers in the scheduled queue, unless the
+  driver at the head of the queue was already considered.  The compressed
+  images are decompressed in parallel on the application processors when the
+  MP Services Protocol is available, and on the boot processor otherwise.
+  It returns without waiting for the application processors.
+
+  The number of images prefetched at a time is PcdDxeImagePrefetchCount; 0
+  disables the prefetch.
+
+**/
+VOID
+CorePrefetchScheduledImages (
+  VOID
+  );
+
+/**
+  Return the PE32 image of a driver prefetched by CorePrefetchScheduledImages(),
+  the way GetFileBufferByFilePath() returns it from the firmware volume.  The
+  image is decompressed on the boot processor if no application processor
+  took it yet, and waited for otherwise.
+
+  @param  FilePath              The device path of the driver file.
+  @param  ImageSize             The size of the image returned.
+  @param  AuthenticationStatus  The authentication status of the image.
+
+  @return The PE32 image, to release with CoreReleasePrefetchedImage() once
+          it is loaded, or NULL if the image of the driver was not prefetched.
+
+**/
+VOID *
+CoreGetPrefetchedImage (
+  IN  CONST EFI_DEVICE_PATH_PROTOCOL  *FilePath,
+  OUT UINTN                           *ImageSize,
+  OUT UINT32                          *AuthenticationStatus
+  );
+
+/**
+  Release a PE32 image returned by CoreGetPrefetchedImage(), once the image is
+  loaded.  The jobs of its batch are waited for, so that the application
+  processors are idle when the driver starts.
+
+  @param  Image                 The PE32 image.
+
+**/
+VOID
+CoreReleasePrefetchedImage (
+  IN VOID  *Image
+  );
+
+/**
+  Release the driver images prefetched by CorePrefetchScheduledImages() that
+  were not loaded, and the prefetch jobs, at the end of a round of dispatch.
+
+**/
+VOID
+CoreFreePrefetchedImages (
+  VOID
+  );
+
 /**
   Check every driver and locate a matching one. If the driver is found, the Unrequested
   state flag is cleared.
@@ -2101,6 +2349,78 @@ FwVolDriverInit (
   );
 
 
+/**
+  Locate a section in a firmware file, the way
+  EFI_FIRMWARE_VOLUME2_PROTOCOL.ReadSection() does, and return a read-only
+  pointer to its data in the section cache.  The section data is referenced
+  until CoreReleaseCachedSection() is called, and is not evicted meanwhile.
+
+  @param  FirmwareVolume         A Firmware Volume2 Protocol instance produced
+                                 by the DXE Core.
+  @param  NameGuid               The name of the file.
+  @param  SectionType            The type of the section, or 0 for the whole
+                                 section stream of the file.
+  @param  SectionInstance        Which instance of sections of SectionType to
+                                 return.
+  @param  Buffer                 The data of the section, without its header.
+  @param  BufferSize             The size of the data of the section.
+  @param  AuthenticationStatus   The authentication status of the section.
+
+  @retval EFI_SUCCESS            The section was found, and is referenced.
+  @retval EFI_NOT_FOUND          The file or the section was not found.
+  @retval EFI_UNSUPPORTED        FirmwareVolume was not produced by the DXE
+                                 Core.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough pool memory to extract the
+                                 section.
+  @retval EFI_INVALID_PARAMETER  One or more parameters are NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreGetCachedSection (
+  IN  EFI_FIRMWARE_VOLUME2_PROTOCOL  *FirmwareVolume,
+  IN  CONST EFI_GUID                 *NameGuid,
+  IN  EFI_SECTION_TYPE               SectionType,
+  IN  UINTN                          SectionInstance,
+  OUT CONST VOID                     **Buffer,
+  OUT UINTN                          *BufferSize,
+  OUT UINT32                         *AuthenticationStatus
+  );
+
+
+/**
+  Release a reference to section data returned by CoreGetCachedSection().  The
+  data may be evicted afterwards, and must no longer be accessed.
+
+  @param  Buffer                 The data returned by CoreGetCachedSection().
+
+  @retval EFI_SUCCESS            The reference was released.
+  @retval EFI_NOT_FOUND          Buffer is not referenced.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreReleaseCachedSection (
+  IN  CONST VOID  *Buffer
+  );
+
+
+/**
+  Retrieve the statistics of the section cache since the DXE Core started.
+
+  @param  Statistics             The buffer to return the statistics in.
+
+  @retval EFI_SUCCESS            The statistics were returned.
+  @retval EFI_INVALID_PARAMETER  Statistics is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreGetSectionCacheStatistics (
+  OUT EDKII_SECTION_CACHE_STATISTICS  *Statistics
+  );
+
+
 /**
   Entry point of the section extraction code. Initializes an instance of the
   section extraction interface and installs it on a new handle.
@@ -2461,6 +2781,71 @@ GetSection (
   );
 
 
+/**
+  Retrieves requested section from section stream without copying it.  The
+  section data returned is in the stream database, and is valid until the
+  section stream is closed.
+
+  @param  SectionStreamHandle   The section stream from which to extract the
+                                requested section.
+  @param  SectionType           A pointer to the type of section to search for,
+                                or NULL for the whole section stream.
+  @param  SectionDefinitionGuid If the section type is EFI_SECTION_GUID_DEFINED,
+                                then SectionDefinitionGuid indicates which of
+                                these types of sections to search for.
+  @param  SectionInstance       Indicates which instance of the requested
+                                section to return.
+  @param  Buffer                The data of the section.
+  @param  BufferSize            The size of the data of the section.
+  @param  AuthenticationStatus  The authentication status of the section, as
+                                GetSection() returns it.
+  @param  IsFfs3Fv              Indicates the FV format.
+
+  @retval EFI_SUCCESS           Section was retrieved successfully
+  @retval EFI_PROTOCOL_ERROR    A GUID defined section was encountered in the
+                                section stream with its
+                                EFI_GUIDED_SECTION_PROCESSING_REQUIRED bit set,
+                                but there was no corresponding GUIDed Section
+                                Extraction Protocol in the handle database.
+  @retval EFI_NOT_FOUND         The requested section does not exist, or the
+                                SectionStream is not correctly formatted.
+  @retval EFI_OUT_OF_RESOURCES  The system has insufficient resources to process
+                                the request.
+  @retval EFI_INVALID_PARAMETER The SectionStreamHandle does not exist.
+
+**/
+EFI_STATUS
+GetSectionInPlace (
+  IN  UINTN                                             SectionStreamHandle,
+  IN  EFI_SECTION_TYPE                                  *SectionType,
+  IN  EFI_GUID                                          *SectionDefinitionGuid,
+  IN  UINTN                                             SectionInstance,
+  OUT CONST VOID                                        **Buffer,
+  OUT UINTN                                             *BufferSize,
+  OUT UINT32                                            *AuthenticationStatus,
+  IN  BOOLEAN                                           IsFfs3Fv
+  );
+
+
+/**
+  Returns the memory that the section stream database holds for a section
+  stream, that is the size of the streams extracted from its encapsulation
+  sections so far.  They are freed when the stream is closed.  The buffer of
+  the stream itself is not counted: OpenSectionStream() uses it in place, and
+  the caller owns it.
+
+  @param  SectionStreamHandle    The section stream.
+
+  @return The size of the extracted streams, in bytes, or 0 if the section
+          stream does not exist.
+
+**/
+UINTN
+GetSectionStreamSize (
+  IN  UINTN                                     SectionStreamHandle
+  );
+
+
 /**
   SEP member function.  Deletes an existing section stream
 
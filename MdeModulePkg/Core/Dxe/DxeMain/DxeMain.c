@@ -12,6 +12,10 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 // DXE Core Global Variables for Protocols from PEI
 //
 EFI_HANDLE                                mDecompressHandle = NULL;
+EFI_HANDLE                                mHandleSnapshotHandle = NULL;
+EFI_HANDLE                                mTimerStatisticsHandle = NULL;
+EFI_HANDLE                                mSectionCacheHandle = NULL;
+EFI_HANDLE                                mProtocolNotifyBatchHandle = NULL;
 
 //
 // DXE Core globals for Architecture Protocols
@@ -211,6 +215,39 @@ EFI_DECOMPRESS_PROTOCOL  gEfiDecompress = {
   DxeMainUefiDecompress
 };
 
+//
+// EDKII Handle Snapshot Protocol
+//
+EDKII_HANDLE_SNAPSHOT_PROTOCOL  mHandleSnapshot = {
+  CoreLocateHandleBufferSince
+};
+
+//
+// EDKII Timer Statistics Protocol
+//
+EDKII_TIMER_STATISTICS_PROTOCOL  mTimerStatistics = {
+  CoreGetTimerStatistics,
+  CoreResetTimerStatistics
+};
+
+//
+// EDKII Section Cache Protocol
+//
+EDKII_SECTION_CACHE_PROTOCOL  mSectionCache = {
+  CoreGetCachedSection,
+  CoreReleaseCachedSection,
+  CoreGetSectionCacheStatistics
+};
+
+//
+// EDKII Protocol Notify Batch Protocol
+//
+EDKII_PROTOCOL_NOTIFY_BATCH_PROTOCOL  mProtocolNotifyBatch = {
+  CoreBeginProtocolNotifyBatch,
+  CoreEndProtocolNotifyBatch,
+  CoreGetProtocolNotifyBatchStatistics
+};
+
 //
 // For Loading modules at fixed address feature, the configuration table is to cache the top address below which to load
 // Runtime code&boot time code
@@ -468,6 +505,46 @@ DxeMain (
              );
   ASSERT_EFI_ERROR (Status);
 
+  //
+  // Publish the Handle Snapshot protocol for incremental handle database queries
+  //
+  Status = CoreInstallMultipleProtocolInterfaces (
+             &mHandleSnapshotHandle,
+             &gEdkiiHandleSnapshotProtocolGuid,     &mHandleSnapshot,
+             NULL
+             );
+  ASSERT_EFI_ERROR (Status);
+
+  //
+  // Publish the Timer Statistics protocol for the work spent on timer events
+  //
+  Status = CoreInstallMultipleProtocolInterfaces (
+             &mTimerStatisticsHandle,
+             &gEdkiiTimerStatisticsProtocolGuid,    &mTimerStatistics,
+             NULL
+             );
+  ASSERT_EFI_ERROR (Status);
+
+  //
+  // Publish the Section Cache protocol for in place reads of firmware file sections
+  //
+  Status = CoreInstallMultipleProtocolInterfaces (
+             &mSectionCacheHandle,
+             &gEdkiiSectionCacheProtocolGuid,       &mSectionCache,
+             NULL
+             );
+  ASSERT_EFI_ERROR (Status);
+
+  //
+  // Publish the Protocol Notify Batch protocol for bus drivers installing many interfaces
+  //
+  Status = CoreInstallMultipleProtocolInterfaces (
+             &mProtocolNotifyBatchHandle,
+             &gEdkiiProtocolNotifyBatchProtocolGuid, &mProtocolNotifyBatch,
+             NULL
+             );
+  ASSERT_EFI_ERROR (Status);
+
   //
   // Register for the GUIDs of the Architectural Protocols, so the rest of the
   // EFI Boot Services and EFI Runtime Services tables can be filled in.
@@ -153,6 +153,11 @@ GenericProtocolNotify (
     // Register the Core timer tick handler with the Timer AP
     //
     gTimer->RegisterHandler (gTimer, CoreTimerTick);
+
+    //
+    // Stop the periodic timer tick if the Timer AP supports one-shot mode
+    //
+    CoreInitializeTimerOneShot ();
   }
 
   if (CompareGuid (Entry->ProtocolGuid, &gEfiRuntimeArchProtocolGuid)) {
@@ -10,17 +10,60 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "DxeMain.h"
 #include "Event.h"
 
+//
+// The timer database is a hierarchical timer wheel.  Time is counted in wheel
+// ticks of 2^TIMER_WHEEL_TICK_SHIFT 100ns units (6.5536ms).  Each level of the
+// wheel has TIMER_WHEEL_SLOTS slots, and a slot of level N holds the timers of
+// TIMER_WHEEL_SLOTS^N consecutive wheel ticks.  A timer is queued to the lowest
+// level that can hold its trigger time, counting from mEfiTimerWheelTick, and
+// timers too far away for the top level wait on mEfiTimerOverflowList.  Once the
+// wheel reaches the first tick of an upper level slot, the timers of the slot
+// are queued again, which moves them down the wheel.
+//
+#define TIMER_WHEEL_TICK_SHIFT    16
+#define TIMER_WHEEL_SLOT_SHIFT    6
+#define TIMER_WHEEL_SLOTS         (1 << TIMER_WHEEL_SLOT_SHIFT)
+#define TIMER_WHEEL_SLOT_MASK     (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_WHEEL_LEVELS        4
+
 //
 // Internal data
 //
 
-LIST_ENTRY       mEfiTimerList = INITIALIZE_LIST_HEAD_VARIABLE (mEfiTimerList);
+LIST_ENTRY       mEfiTimerWheel[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+LIST_ENTRY       mEfiTimerOverflowList = INITIALIZE_LIST_HEAD_VARIABLE (mEfiTimerOverflowList);
 EFI_LOCK         mEfiTimerLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL - 1);
 EFI_EVENT        mEfiCheckTimerEvent = NULL;
 
+//
+// The wheel tick up to which the timer database has been checked, the slots
+// of the wheel that may have timers queued, and the earliest time at which a
+// timer may expire.  A bit of mEfiTimerWheelBitmap may stay set after the
+// timers of its slot are cancelled, so mEfiTimerNextTrigger may be early.
+// CoreTimerTick() reads mEfiTimerNextTrigger at TPL_HIGH_LEVEL, and a UINT64
+// is not written atomically on IA32, so it is only written with
+// mEfiSystemTimeLock held as well.
+//
+UINT64           mEfiTimerWheelTick = 0;
+UINT64           mEfiTimerWheelBitmap[TIMER_WHEEL_LEVELS];
+UINT64           mEfiTimerNextTrigger = MAX_UINT64;
+
+EDKII_TIMER_STATISTICS  mEfiTimerStatistics;
+
 EFI_LOCK         mEfiSystemTimeLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_HIGH_LEVEL);
 UINT64           mEfiSystemTime = 0;
 
+//
+// In one-shot timer mode, the Timer One-Shot Protocol, the system time at
+// which the timer interrupt is programmed to fire, and the timer period the
+// timer interrupt falls back to while expired timers wait to be signaled.
+// mEfiTimerWakeTime is written from the timer interrupt, so it is only
+// accessed with mEfiSystemTimeLock held.
+//
+EDKII_TIMER_ONE_SHOT_PROTOCOL  *mEfiTimerOneShot = NULL;
+UINT64           mEfiTimerWakeTime = MAX_UINT64;
+UINT64           mEfiTimerPeriod = 0;
+
 //
 // Timer functions
 //
@@ -36,34 +79,331 @@ CoreInsertEventTimer (
   IN IEVENT   *Event
   )
 {
-  UINT64          TriggerTime;
-  LIST_ENTRY      *Link;
-  IEVENT          *Event2;
+  UINT64          Tick;
+  UINT64          Delta;
+  UINTN           Level;
+  UINTN           Slot;
+  LIST_ENTRY      *Head;
 
   ASSERT_LOCKED (&mEfiTimerLock);
 
   //
-  // Get the timer's trigger time
+  // Get the wheel tick of the timer's trigger time
+  //
+  Tick = RShiftU64 (Event->Timer.TriggerTime, TIMER_WHEEL_TICK_SHIFT);
+  if (Tick < mEfiTimerWheelTick) {
+    Tick = mEfiTimerWheelTick;
+  }
+  Delta = Tick - mEfiTimerWheelTick;
+
+  //
+  // Insert the timer into the lowest level of the wheel that covers its tick
   //
-  TriggerTime = Event->Timer.TriggerTime;
+  for (Level = 0; Level < TIMER_WHEEL_LEVELS; Level++) {
+    if (RShiftU64 (Delta, (Level + 1) * TIMER_WHEEL_SLOT_SHIFT) == 0) {
+      break;
+    }
+  }
+
+  if (Level == TIMER_WHEEL_LEVELS) {
+    Head = &mEfiTimerOverflowList;
+  } else {
+    Slot = (UINTN)RShiftU64 (Tick, Level * TIMER_WHEEL_SLOT_SHIFT) & TIMER_WHEEL_SLOT_MASK;
+    Head = &mEfiTimerWheel[Level][Slot];
+    mEfiTimerWheelBitmap[Level] |= LShiftU64 (1, Slot);
+  }
+
+  InsertTailList (Head, &Event->Timer.Link);
+
+  if (Event->Timer.TriggerTime < mEfiTimerNextTrigger) {
+    CoreAcquireLock (&mEfiSystemTimeLock);
+    mEfiTimerNextTrigger = Event->Timer.TriggerTime;
+    CoreReleaseLock (&mEfiSystemTimeLock);
+  }
+}
+
+/**
+  Queues again all the timer events of a list of the timer wheel.
+
+  @param  Head                   The list of timer events.
+
+  @return The number of timer events queued again.
+
+**/
+STATIC
+UINTN
+CoreRequeueEventTimers (
+  IN LIST_ENTRY   *Head
+  )
+{
+  LIST_ENTRY      List;
+  IEVENT          *Event;
+  UINTN           Count;
+
+  if (IsListEmpty (Head)) {
+    return 0;
+  }
 
   //
-  // Insert the timer into the timer database in assending sorted order
+  // Move the timers to a local list first, as they may be queued to Head again
   //
-  for (Link = mEfiTimerList.ForwardLink; Link != &mEfiTimerList; Link = Link->ForwardLink) {
-    Event2 = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+  List.ForwardLink = Head->ForwardLink;
+  List.BackLink    = Head->BackLink;
+  List.ForwardLink->BackLink = &List;
+  List.BackLink->ForwardLink = &List;
+  InitializeListHead (Head);
+
+  Count = 0;
+  while (!IsListEmpty (&List)) {
+    Event = CR (List.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+    RemoveEntryList (&Event->Timer.Link);
+    CoreInsertEventTimer (Event);
+    Count++;
+  }
+
+  return Count;
+}
+
+/**
+  Moves down the wheel the timer events of the upper level slots that start at
+  the current wheel tick.
+
+  @return The number of slots visited and timer events moved.
+
+**/
+STATIC
+UINTN
+CoreCascadeEventTimers (
+  VOID
+  )
+{
+  UINTN           Level;
+  UINTN           Shift;
+  UINTN           Slot;
+  UINTN           Work;
+
+  Work = 0;
+  for (Level = 1; Level <= TIMER_WHEEL_LEVELS; Level++) {
+    Shift = Level * TIMER_WHEEL_SLOT_SHIFT;
+    if ((mEfiTimerWheelTick & (LShiftU64 (1, Shift) - 1)) != 0) {
+      break;
+    }
 
-    if (Event2->Timer.TriggerTime > TriggerTime) {
+    if (Level == TIMER_WHEEL_LEVELS) {
+      Work += CoreRequeueEventTimers (&mEfiTimerOverflowList);
       break;
     }
+
+    Slot = (UINTN)RShiftU64 (mEfiTimerWheelTick, Shift) & TIMER_WHEEL_SLOT_MASK;
+    if ((mEfiTimerWheelBitmap[Level] & LShiftU64 (1, Slot)) != 0) {
+      mEfiTimerWheelBitmap[Level] &= ~LShiftU64 (1, Slot);
+      Work += 1 + CoreRequeueEventTimers (&mEfiTimerWheel[Level][Slot]);
+    }
   }
 
-  InsertTailList (Link, &Event->Timer.Link);
+  return Work;
+}
+
+/**
+  Moves the timer events of the current wheel tick that are expired to a list
+  kept sorted by trigger time.
+
+  @param  SystemTime             The current system time.
+  @param  Expired                The list of expired timer events.
+
+  @return The number of slots visited and timer events examined.
+
+**/
+STATIC
+UINTN
+CoreExpireEventTimers (
+  IN     UINT64       SystemTime,
+  IN OUT LIST_ENTRY   *Expired
+  )
+{
+  UINTN           Slot;
+  LIST_ENTRY      *Head;
+  LIST_ENTRY      *Link;
+  LIST_ENTRY      *NextLink;
+  LIST_ENTRY      *Previous;
+  IEVENT          *Event;
+  IEVENT          *Event2;
+  UINTN           Work;
+
+  Slot = (UINTN)mEfiTimerWheelTick & TIMER_WHEEL_SLOT_MASK;
+  if ((mEfiTimerWheelBitmap[0] & LShiftU64 (1, Slot)) == 0) {
+    return 0;
+  }
+
+  Head = &mEfiTimerWheel[0][Slot];
+  Work = 1;
+  for (Link = Head->ForwardLink; Link != Head; Link = NextLink) {
+    NextLink = Link->ForwardLink;
+    Event    = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+    Work++;
+
+    //
+    // If this timer is not expired, leave it in the slot
+    //
+    if (Event->Timer.TriggerTime > SystemTime) {
+      continue;
+    }
+
+    //
+    // Timers of earlier ticks are already on the list, so the search for the
+    // insertion point from the tail is short
+    //
+    RemoveEntryList (Link);
+    for (Previous = Expired->BackLink; Previous != Expired; Previous = Previous->BackLink) {
+      Event2 = CR (Previous, IEVENT, Timer.Link, EVENT_SIGNATURE);
+      if (Event2->Timer.TriggerTime <= Event->Timer.TriggerTime) {
+        break;
+      }
+    }
+    InsertHeadList (Previous, Link);
+  }
+
+  if (IsListEmpty (Head)) {
+    mEfiTimerWheelBitmap[0] &= ~LShiftU64 (1, Slot);
+  }
+
+  return Work;
+}
+
+/**
+  Returns the first wheel tick after the current one at which a timer event
+  may expire, or a slot of an upper level must be moved down the wheel.
+
+  @return The wheel tick, or MAX_UINT64 if no timer is queued after the current
+          wheel tick.
+
+**/
+STATIC
+UINT64
+CoreNextTimerWheelTick (
+  VOID
+  )
+{
+  UINT64          NextTick;
+  UINT64          Tick;
+  UINT64          Bitmap;
+  UINTN           Level;
+  UINTN           Shift;
+
+  NextTick = MAX_UINT64;
+  for (Level = 0; Level < TIMER_WHEEL_LEVELS; Level++) {
+    Shift  = Level * TIMER_WHEEL_SLOT_SHIFT;
+    Tick   = RShiftU64 (mEfiTimerWheelTick, Shift) + 1;
+    Bitmap = mEfiTimerWheelBitmap[Level];
+    if (Level == 0) {
+      //
+      // The current slot of the lowest level only holds timers of the current tick
+      //
+      Bitmap &= ~LShiftU64 (1, (UINTN)mEfiTimerWheelTick & TIMER_WHEEL_SLOT_MASK);
+    }
+
+    //
+    // Find the first slot with timers, starting from the slot after the current one
+    //
+    Bitmap = RRotU64 (Bitmap, (UINTN)Tick & TIMER_WHEEL_SLOT_MASK);
+    if (Bitmap != 0) {
+      Tick = LShiftU64 (Tick + LowBitSet64 (Bitmap), Shift);
+      if (Tick < NextTick) {
+        NextTick = Tick;
+      }
+    }
+  }
+
+  if (!IsListEmpty (&mEfiTimerOverflowList)) {
+    Shift = TIMER_WHEEL_LEVELS * TIMER_WHEEL_SLOT_SHIFT;
+    Tick  = LShiftU64 (RShiftU64 (mEfiTimerWheelTick, Shift) + 1, Shift);
+    if (Tick < NextTick) {
+      NextTick = Tick;
+    }
+  }
+
+  return NextTick;
+}
+
+/**
+  Returns the earliest time at which a timer event may expire.
+
+  @return The trigger time, or MAX_UINT64 if no timer is queued.
+
+**/
+STATIC
+UINT64
+CoreNextTimerTrigger (
+  VOID
+  )
+{
+  UINT64          NextTrigger;
+  LIST_ENTRY      *Head;
+  LIST_ENTRY      *Link;
+  IEVENT          *Event;
+
+  NextTrigger = CoreNextTimerWheelTick ();
+  if (NextTrigger != MAX_UINT64) {
+    NextTrigger = LShiftU64 (NextTrigger, TIMER_WHEEL_TICK_SHIFT);
+  }
+
+  Head = &mEfiTimerWheel[0][(UINTN)mEfiTimerWheelTick & TIMER_WHEEL_SLOT_MASK];
+  for (Link = Head->ForwardLink; Link != Head; Link = Link->ForwardLink) {
+    Event = CR (Link, IEVENT, Timer.Link, EVENT_SIGNATURE);
+    if (Event->Timer.TriggerTime < NextTrigger) {
+      NextTrigger = Event->Timer.TriggerTime;
+    }
+  }
+
+  return NextTrigger;
+}
+
+/**
+  Programs the timer interrupt for the earliest time at which a timer event may
+  expire, in one-shot timer mode.
+
+  The time is rounded up to a multiple of PcdTimerEventSlack, so that the timer
+  events due within the same PcdTimerEventSlack window are signaled on the same
+  timer interrupt.
+
+**/
+STATIC
+VOID
+CoreProgramTimerInterrupt (
+  VOID
+  )
+{
+  UINT64          SystemTime;
+  UINT64          WakeTime;
+  UINT64          Elapsed;
+  UINT32          Slack;
+
+  ASSERT_LOCKED (&mEfiSystemTimeLock);
+
+  mEfiTimerOneShot->GetElapsedTime (mEfiTimerOneShot, &Elapsed);
+  SystemTime = mEfiSystemTime + Elapsed;
+
+  WakeTime = mEfiTimerNextTrigger;
+  Slack    = PcdGet32 (PcdTimerEventSlack);
+  if ((Slack != 0) && (WakeTime <= MAX_UINT64 - Slack)) {
+    WakeTime = MultU64x32 (DivU64x32 (WakeTime + Slack - 1, Slack), Slack);
+  }
+
+  mEfiTimerWakeTime = WakeTime;
+  mEfiTimerOneShot->SetDeadline (
+                      mEfiTimerOneShot,
+                      (WakeTime > SystemTime) ? WakeTime - SystemTime : 0
+                      );
 }
 
 /**
   Returns the current system time.
 
+  In one-shot timer mode, the time elapsed since the last timer tick is only
+  read from the timer when the timer interrupt is programmed to fire later than
+  one timer period after that tick.  Otherwise the system time counted by the
+  timer ticks is as exact as in periodic timer mode.
+
   @return The current system time
 
 **/
@@ -73,16 +413,25 @@ CoreCurrentSystemTime (
   )
 {
   UINT64          SystemTime;
+  UINT64          Elapsed;
 
   CoreAcquireLock (&mEfiSystemTimeLock);
   SystemTime = mEfiSystemTime;
+  if ((mEfiTimerOneShot != NULL) &&
+      (mEfiTimerWakeTime > mEfiSystemTime + mEfiTimerPeriod)) {
+    //
+    // Add the time elapsed since the last timer tick, which can be long
+    //
+    mEfiTimerOneShot->GetElapsedTime (mEfiTimerOneShot, &Elapsed);
+    SystemTime += Elapsed;
+  }
   CoreReleaseLock (&mEfiSystemTimeLock);
 
   return SystemTime;
 }
 
 /**
-  Checks the sorted timer list against the current system time.
+  Checks the timer wheel against the current system time.
   Signals any expired event timer.
 
   @param  CheckEvent             Not used
@@ -97,60 +446,105 @@ CoreCheckTimers (
   )
 {
   UINT64                  SystemTime;
+  UINT64                  SystemTick;
+  UINT64                  NextTick;
+  UINT64                  NextTrigger;
+  LIST_ENTRY              Expired;
   IEVENT                  *Event;
+  UINTN                   Work;
+  UINTN                   Bucket;
 
   //
   // Check the timer database for expired timers
   //
   CoreAcquireLock (&mEfiTimerLock);
   SystemTime = CoreCurrentSystemTime ();
+  SystemTick = RShiftU64 (SystemTime, TIMER_WHEEL_TICK_SHIFT);
+  InitializeListHead (&Expired);
+  Work = 0;
 
-  while (!IsListEmpty (&mEfiTimerList)) {
-    Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
-
+  while (TRUE) {
     //
-    // If this timer is not expired, then we're done
+    // Turn the wheel up to the current system time, skipping the ticks without
+    // anything to do, and collect the expired timers
     //
-    if (Event->Timer.TriggerTime > SystemTime) {
-      break;
+    Work += CoreExpireEventTimers (SystemTime, &Expired);
+    while (mEfiTimerWheelTick < SystemTick) {
+      NextTick = CoreNextTimerWheelTick ();
+      mEfiTimerWheelTick = MIN (NextTick, SystemTick);
+      Work += CoreCascadeEventTimers ();
+      Work += CoreExpireEventTimers (SystemTime, &Expired);
     }
 
     //
-    // Remove this timer from the timer queue
+    // If no timer is expired, then we're done
     //
+    if (IsListEmpty (&Expired)) {
+      break;
+    }
 
-    RemoveEntryList (&Event->Timer.Link);
-    Event->Timer.Link.ForwardLink = NULL;
-
-    //
-    // Signal it
-    //
-    CoreSignalEvent (Event);
+    while (!IsListEmpty (&Expired)) {
+      Event = CR (Expired.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
 
-    //
-    // If this is a periodic timer, set it
-    //
-    if (Event->Timer.Period != 0) {
       //
-      // Compute the timers new trigger time
+      // Remove this timer from the expired list
       //
-      Event->Timer.TriggerTime = Event->Timer.TriggerTime + Event->Timer.Period;
+      RemoveEntryList (&Event->Timer.Link);
+      Event->Timer.Link.ForwardLink = NULL;
+      mEfiTimerStatistics.ExpiredCount++;
 
       //
-      // If that's before now, then reset the timer to start from now
+      // Signal it
       //
-      if (Event->Timer.TriggerTime <= SystemTime) {
-        Event->Timer.TriggerTime = SystemTime;
-        CoreSignalEvent (mEfiCheckTimerEvent);
-      }
+      CoreSignalEvent (Event);
 
       //
-      // Add the timer
+      // If this is a periodic timer, set it
       //
-      CoreInsertEventTimer (Event);
+      if (Event->Timer.Period != 0) {
+        //
+        // Compute the timers new trigger time
+        //
+        Event->Timer.TriggerTime = Event->Timer.TriggerTime + Event->Timer.Period;
+
+        //
+        // If that's before now, then reset the timer to start from now
+        //
+        if (Event->Timer.TriggerTime <= SystemTime) {
+          Event->Timer.TriggerTime = SystemTime;
+          CoreSignalEvent (mEfiCheckTimerEvent);
+        }
+
+        //
+        // Add the timer
+        //
+        CoreInsertEventTimer (Event);
+      }
     }
   }
 
+  NextTrigger = CoreNextTimerTrigger ();
+
+  CoreAcquireLock (&mEfiSystemTimeLock);
+  mEfiTimerNextTrigger = NextTrigger;
+  if (mEfiTimerOneShot != NULL) {
+    CoreProgramTimerInterrupt ();
+  }
+  CoreReleaseLock (&mEfiSystemTimeLock);
+
+  //
+  // Account the work done at TPL_HIGH_LEVEL - 1
+  //
+  Bucket = 0;
+  if (Work != 0) {
+    Bucket = MIN ((UINTN)HighBitSet64 (Work) + 1, EDKII_TIMER_STATISTICS_HISTOGRAM_SIZE - 1);
+  }
+  mEfiTimerStatistics.CheckCount++;
+  mEfiTimerStatistics.WorkHistogram[Bucket]++;
+  if (Work > mEfiTimerStatistics.MaxWork) {
+    mEfiTimerStatistics.MaxWork = Work;
+  }
+
   CoreReleaseLock (&mEfiTimerLock);
 }
 
@@ -165,6 +559,14 @@ CoreInitializeTimer (
   )
 {
   EFI_STATUS  Status;
+  UINTN       Level;
+  UINTN       Slot;
+
+  for (Level = 0; Level < TIMER_WHEEL_LEVELS; Level++) {
+    for (Slot = 0; Slot < TIMER_WHEEL_SLOTS; Slot++) {
+      InitializeListHead (&mEfiTimerWheel[Level][Slot]);
+    }
+  }
 
   Status = CoreCreateEventInternal (
              EVT_NOTIFY_SIGNAL,
@@ -178,6 +580,45 @@ CoreInitializeTimer (
 }
 
 
+/**
+  Switches the timer interrupt to one-shot mode if PcdTimerOneShotEnable is set
+  and the Timer Architectural Protocol driver produces the Timer One-Shot
+  Protocol.  Called once the Timer Architectural Protocol is available.
+
+**/
+VOID
+CoreInitializeTimerOneShot (
+  VOID
+  )
+{
+  EFI_STATUS                     Status;
+  EDKII_TIMER_ONE_SHOT_PROTOCOL  *TimerOneShot;
+
+  if (!FeaturePcdGet (PcdTimerOneShotEnable)) {
+    return;
+  }
+
+  Status = CoreLocateProtocol (&gEdkiiTimerOneShotProtocolGuid, NULL, (VOID **)&TimerOneShot);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  gTimer->GetTimerPeriod (gTimer, &mEfiTimerPeriod);
+  if (mEfiTimerPeriod == 0) {
+    return;
+  }
+
+  CoreAcquireLock (&mEfiTimerLock);
+  CoreAcquireLock (&mEfiSystemTimeLock);
+  mEfiTimerOneShot = TimerOneShot;
+  CoreProgramTimerInterrupt ();
+  CoreReleaseLock (&mEfiSystemTimeLock);
+  CoreReleaseLock (&mEfiTimerLock);
+
+  DEBUG ((DEBUG_INFO, "DXE timer interrupt in one-shot mode\n"));
+}
+
+
 /**
   Called by the platform code to process a tick.
 
@@ -191,8 +632,6 @@ CoreTimerTick (
   IN UINT64   Duration
   )
 {
-  IEVENT          *Event;
-
   //
   // Check runtiem flag in case there are ticks while exiting boot services
   //
@@ -202,17 +641,24 @@ CoreTimerTick (
   // Update the system time
   //
   mEfiSystemTime += Duration;
+  mEfiTimerStatistics.TickCount++;
 
   //
-  // If the head of the list is expired, fire the timer event
-  // to process it
+  // If a timer may be expired, fire the timer event to process it
   //
-  if (!IsListEmpty (&mEfiTimerList)) {
-    Event = CR (mEfiTimerList.ForwardLink, IEVENT, Timer.Link, EVENT_SIGNATURE);
+  if (mEfiTimerNextTrigger <= mEfiSystemTime) {
+    CoreSignalEvent (mEfiCheckTimerEvent);
 
-    if (Event->Timer.TriggerTime <= mEfiSystemTime) {
-      CoreSignalEvent (mEfiCheckTimerEvent);
+    //
+    // In one-shot timer mode, keep the system time running at the timer
+    // period until the timer event reprograms the timer interrupt
+    //
+    if (mEfiTimerOneShot != NULL) {
+      mEfiTimerWakeTime = mEfiSystemTime + mEfiTimerPeriod;
+      mEfiTimerOneShot->SetDeadline (mEfiTimerOneShot, mEfiTimerPeriod);
     }
+  } else if (mEfiTimerOneShot != NULL) {
+    CoreProgramTimerInterrupt ();
   }
 
   CoreReleaseLock (&mEfiSystemTimeLock);
@@ -286,6 +732,15 @@ CoreSetTimer (
 
     if (TriggerTime == 0) {
       CoreSignalEvent (mEfiCheckTimerEvent);
+    } else if (mEfiTimerOneShot != NULL) {
+      CoreAcquireLock (&mEfiSystemTimeLock);
+      if (Event->Timer.TriggerTime < mEfiTimerWakeTime) {
+        //
+        // The timer interrupt is programmed too late for this timer
+        //
+        CoreProgramTimerInterrupt ();
+      }
+      CoreReleaseLock (&mEfiSystemTimeLock);
     }
   }
 
@@ -293,3 +748,55 @@ CoreSetTimer (
 
   return EFI_SUCCESS;
 }
+
+
+/**
+  Retrieve the statistics of the timer database since the DXE Core started or
+  since they were last reset.
+
+  @param  Statistics             The buffer to return the statistics in.
+
+  @retval EFI_SUCCESS            The statistics were returned.
+  @retval EFI_INVALID_PARAMETER  Statistics is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreGetTimerStatistics (
+  OUT EDKII_TIMER_STATISTICS  *Statistics
+  )
+{
+  if (Statistics == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CoreAcquireLock (&mEfiTimerLock);
+  CoreAcquireLock (&mEfiSystemTimeLock);
+  CopyMem (Statistics, &mEfiTimerStatistics, sizeof (mEfiTimerStatistics));
+  CoreReleaseLock (&mEfiSystemTimeLock);
+  CoreReleaseLock (&mEfiTimerLock);
+
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Reset the statistics of the timer database.
+
+  @retval EFI_SUCCESS            The statistics were reset.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreResetTimerStatistics (
+  VOID
+  )
+{
+  CoreAcquireLock (&mEfiTimerLock);
+  CoreAcquireLock (&mEfiSystemTimeLock);
+  ZeroMem (&mEfiTimerStatistics, sizeof (mEfiTimerStatistics));
+  CoreReleaseLock (&mEfiSystemTimeLock);
+  CoreReleaseLock (&mEfiTimerLock);
+
+  return EFI_SUCCESS;
+}
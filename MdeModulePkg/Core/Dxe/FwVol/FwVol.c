@@ -263,6 +263,8 @@ FreeFvDeviceResource (
   while (&FfsFileEntry->Link != &FvDevice->FfsFileListHeader) {
     NextEntry = (&FfsFileEntry->Link)->ForwardLink;
 
+    FvSectionCacheRemove (FfsFileEntry);
+
     if (FfsFileEntry->StreamHandle != 0) {
       //
       // Close stream and free resources from SEP
@@ -21,6 +21,14 @@ typedef struct {
   EFI_FFS_FILE_HEADER             *FfsHeader;
   UINTN                           StreamHandle;
   BOOLEAN                         FileCached;
+  //
+  // Section cache state, valid while StreamHandle is not 0: the link on the
+  // least recently read list, the size of the section data extracted from
+  // the file, and the number of references to its section data
+  //
+  LIST_ENTRY                      CacheLink;
+  UINTN                           CacheSize;
+  UINTN                           ReferenceCount;
 } FFS_FILE_LIST_ENTRY;
 
 typedef struct {
@@ -234,6 +242,65 @@ FvReadFileSection (
   );
 
 
+/**
+  Open the section stream of a file, unless it is open already, and keep it
+  from being evicted from the section cache until FvSectionCacheUpdate() is
+  called.
+
+  @param  This                       Pointer to EFI_FIRMWARE_VOLUME2_PROTOCOL.
+  @param  NameGuid                   Pointer to an EFI_GUID, which is the
+                                     filename.
+  @param  FfsEntry                   The file list entry of the file.
+  @param  Cached                     TRUE if the section stream was open already.
+  @param  AuthenticationStatus       The authentication status of the file.
+
+  @retval EFI_SUCCESS                The section stream of the file is open.
+  @retval EFI_NOT_FOUND              The file was not found, or has no sections.
+  @retval Others                     The file could not be read, or its section
+                                     stream opened.
+
+**/
+EFI_STATUS
+FvOpenFileSectionStream (
+  IN  CONST EFI_FIRMWARE_VOLUME2_PROTOCOL  *This,
+  IN  CONST EFI_GUID                       *NameGuid,
+  OUT FFS_FILE_LIST_ENTRY                  **FfsEntry,
+  OUT BOOLEAN                              *Cached,
+  OUT UINT32                               *AuthenticationStatus
+  );
+
+
+/**
+  Account for a read of sections of a file in the section cache, and evict the
+  least recently read files with no referenced section data while the cache
+  is larger than PcdDxeSectionCacheSize.
+
+  @param  FfsEntry                   The file list entry returned by
+                                     FvOpenFileSectionStream().
+  @param  Cached                     TRUE if the section stream was open already.
+
+**/
+VOID
+FvSectionCacheUpdate (
+  IN FFS_FILE_LIST_ENTRY  *FfsEntry,
+  IN BOOLEAN              Cached
+  );
+
+
+/**
+  Remove a file from the section cache, before its section stream is closed
+  and its file list entry freed.  Any reference to its section data is
+  dropped.
+
+  @param  FfsEntry                   The file list entry.
+
+**/
+VOID
+FvSectionCacheRemove (
+  IN FFS_FILE_LIST_ENTRY  *FfsEntry
+  );
+
+
 /**
   Writes one or more files to the firmware volume.
 
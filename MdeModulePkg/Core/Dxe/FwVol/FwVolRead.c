@@ -445,11 +445,8 @@ FvReadFileSection (
 {
   EFI_STATUS                        Status;
   FV_DEVICE                         *FvDevice;
-  EFI_FV_FILETYPE                   FileType;
-  EFI_FV_FILE_ATTRIBUTES            FileAttributes;
-  UINTN                             FileSize;
-  UINT8                             *FileBuffer;
   FFS_FILE_LIST_ENTRY               *FfsEntry;
+  BOOLEAN                           Cached;
 
   if (NameGuid == NULL || Buffer == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -457,52 +454,10 @@ FvReadFileSection (
 
   FvDevice = FV_DEVICE_FROM_THIS (This);
 
-  //
-  // Read the file
-  //
-  Status = FvReadFile (
-            This,
-            NameGuid,
-            NULL,
-            &FileSize,
-            &FileType,
-            &FileAttributes,
-            AuthenticationStatus
-            );
-  //
-  // Get the last key used by our call to FvReadFile as it is the FfsEntry for this file.
-  //
-  FfsEntry = (FFS_FILE_LIST_ENTRY *) FvDevice->LastKey;
-
+  Status = FvOpenFileSectionStream (This, NameGuid, &FfsEntry, &Cached, AuthenticationStatus);
   if (EFI_ERROR (Status)) {
     return Status;
   }
-  if (IS_FFS_FILE2 (FfsEntry->FfsHeader)) {
-    FileBuffer = ((UINT8 *) FfsEntry->FfsHeader) + sizeof (EFI_FFS_FILE_HEADER2);
-  } else {
-    FileBuffer = ((UINT8 *) FfsEntry->FfsHeader) + sizeof (EFI_FFS_FILE_HEADER);
-  }
-  //
-  // Check to see that the file actually HAS sections before we go any further.
-  //
-  if (FileType == EFI_FV_FILETYPE_RAW) {
-    Status = EFI_NOT_FOUND;
-    goto Done;
-  }
-
-  //
-  // Use FfsEntry to cache Section Extraction Protocol Information
-  //
-  if (FfsEntry->StreamHandle == 0) {
-    Status = OpenSectionStream (
-               FileSize,
-               FileBuffer,
-               &FfsEntry->StreamHandle
-               );
-    if (EFI_ERROR (Status)) {
-      goto Done;
-    }
-  }
 
   //
   // If SectionType == 0 We need the whole section stream
@@ -526,10 +481,11 @@ FvReadFileSection (
   }
 
   //
-  // Close of stream defered to close of FfsHeader list to allow SEP to cache data
+  // Close of stream defered to eviction from the section cache or to close of
+  // FfsHeader list to allow SEP to cache data
   //
+  FvSectionCacheUpdate (FfsEntry, Cached);
 
-Done:
   return Status;
 }
 
@@ -0,0 +1,452 @@
+/** @file
+  Section cache of the firmware volumes.  The section stream of a file is
+  kept open after its sections are read, so that the sections extracted from
+  its encapsulation sections are not extracted again by the next read.  The
+  memory held by the open section streams is bounded by
+  PcdDxeSectionCacheSize, by closing the section streams of the least
+  recently read files.
+
+  The Section Cache Protocol returns read-only pointers to the section data
+  in the open section streams, instead of a copy in a new pool buffer.  The
+  section stream of a file is not closed while a pointer to its section data
+  is referenced.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeMain.h"
+#include "FwVolDriver.h"
+
+#define SECTION_CACHE_REFERENCE_SIGNATURE  SIGNATURE_32 ('s', 'c', 'r', 'f')
+
+//
+// A reference to section data returned by CoreGetCachedSection()
+//
+typedef struct {
+  UINTN                   Signature;
+  LIST_ENTRY              Link;
+  CONST VOID              *Buffer;
+  FFS_FILE_LIST_ENTRY     *FfsEntry;
+} SECTION_CACHE_REFERENCE;
+
+//
+// Files with an open section stream, the least recently read first
+//
+LIST_ENTRY                      mSectionCacheLru        = INITIALIZE_LIST_HEAD_VARIABLE (mSectionCacheLru);
+
+//
+// References to section data returned by CoreGetCachedSection()
+//
+LIST_ENTRY                      mSectionCacheReferences = INITIALIZE_LIST_HEAD_VARIABLE (mSectionCacheReferences);
+
+//
+// Lock to protect the section cache, the reference counts and the section
+// stream handles of the file list entries
+//
+EFI_LOCK                        mSectionCacheLock       = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIFY);
+
+EDKII_SECTION_CACHE_STATISTICS  mSectionCacheStatistics;
+
+
+/**
+  Close the section streams of the least recently read files with no
+  referenced section data, while the section cache is larger than
+  PcdDxeSectionCacheSize.  The section streams with nothing extracted free no
+  memory of the section cache, so they are kept open.  The section cache lock
+  must be held.
+
+  @param  Current                The file list entry not to evict, or NULL.
+
+**/
+VOID
+SectionCacheEvict (
+  IN FFS_FILE_LIST_ENTRY  *Current  OPTIONAL
+  )
+{
+  UINT64                MaxCachedSize;
+  LIST_ENTRY            *Link;
+  FFS_FILE_LIST_ENTRY   *FfsEntry;
+
+  MaxCachedSize = PcdGet32 (PcdDxeSectionCacheSize);
+  if (MaxCachedSize == 0) {
+    return;
+  }
+
+  Link = GetFirstNode (&mSectionCacheLru);
+  while (mSectionCacheStatistics.CachedSize > MaxCachedSize && !IsNull (&mSectionCacheLru, Link)) {
+    FfsEntry = BASE_CR (Link, FFS_FILE_LIST_ENTRY, CacheLink);
+    Link     = GetNextNode (&mSectionCacheLru, Link);
+    if (FfsEntry == Current || FfsEntry->ReferenceCount != 0 || FfsEntry->CacheSize == 0) {
+      continue;
+    }
+
+    RemoveEntryList (&FfsEntry->CacheLink);
+    mSectionCacheStatistics.CachedSize -= FfsEntry->CacheSize;
+    mSectionCacheStatistics.EvictionCount++;
+    FfsEntry->CacheSize = 0;
+
+    CloseSectionStream (FfsEntry->StreamHandle, FALSE);
+    FfsEntry->StreamHandle = 0;
+  }
+}
+
+
+/**
+  Open the section stream of a file, unless it is open already, and keep it
+  from being evicted from the section cache until FvSectionCacheUpdate() is
+  called.
+
+  @param  This                       Pointer to EFI_FIRMWARE_VOLUME2_PROTOCOL.
+  @param  NameGuid                   Pointer to an EFI_GUID, which is the
+                                     filename.
+  @param  FfsEntry                   The file list entry of the file.
+  @param  Cached                     TRUE if the section stream was open already.
+  @param  AuthenticationStatus       The authentication status of the file.
+
+  @retval EFI_SUCCESS                The section stream of the file is open.
+  @retval EFI_NOT_FOUND              The file was not found, or has no sections.
+  @retval Others                     The file could not be read, or its section
+                                     stream opened.
+
+**/
+EFI_STATUS
+FvOpenFileSectionStream (
+  IN  CONST EFI_FIRMWARE_VOLUME2_PROTOCOL  *This,
+  IN  CONST EFI_GUID                       *NameGuid,
+  OUT FFS_FILE_LIST_ENTRY                  **FfsEntry,
+  OUT BOOLEAN                              *Cached,
+  OUT UINT32                               *AuthenticationStatus
+  )
+{
+  EFI_STATUS                        Status;
+  FV_DEVICE                         *FvDevice;
+  EFI_FV_FILETYPE                   FileType;
+  EFI_FV_FILE_ATTRIBUTES            FileAttributes;
+  UINTN                             FileSize;
+  UINT8                             *FileBuffer;
+
+  FvDevice = FV_DEVICE_FROM_THIS (This);
+
+  //
+  // Read the file
+  //
+  Status = FvReadFile (
+            This,
+            NameGuid,
+            NULL,
+            &FileSize,
+            &FileType,
+            &FileAttributes,
+            AuthenticationStatus
+            );
+  //
+  // Get the last key used by our call to FvReadFile as it is the FfsEntry for this file.
+  //
+  *FfsEntry = FvDevice->LastKey;
+
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  if (IS_FFS_FILE2 ((*FfsEntry)->FfsHeader)) {
+    FileBuffer = ((UINT8 *) (*FfsEntry)->FfsHeader) + sizeof (EFI_FFS_FILE_HEADER2);
+  } else {
+    FileBuffer = ((UINT8 *) (*FfsEntry)->FfsHeader) + sizeof (EFI_FFS_FILE_HEADER);
+  }
+  //
+  // Check to see that the file actually HAS sections before we go any further.
+  //
+  if (FileType == EFI_FV_FILETYPE_RAW) {
+    return EFI_NOT_FOUND;
+  }
+
+  //
+  // Use FfsEntry to cache Section Extraction Protocol Information
+  //
+  CoreAcquireLock (&mSectionCacheLock);
+  *Cached = (BOOLEAN) ((*FfsEntry)->StreamHandle != 0);
+  if (!*Cached) {
+    Status = OpenSectionStream (
+               FileSize,
+               FileBuffer,
+               &(*FfsEntry)->StreamHandle
+               );
+    if (!EFI_ERROR (Status)) {
+      (*FfsEntry)->CacheSize = 0;
+      InsertTailList (&mSectionCacheLru, &(*FfsEntry)->CacheLink);
+    }
+  }
+  if (!EFI_ERROR (Status)) {
+    (*FfsEntry)->ReferenceCount++;
+  }
+  CoreReleaseLock (&mSectionCacheLock);
+
+  return Status;
+}
+
+
+/**
+  Account for a read of sections of a file in the section cache, and evict the
+  least recently read files with no referenced section data while the cache
+  is larger than PcdDxeSectionCacheSize.
+
+  @param  FfsEntry                   The file list entry returned by
+                                     FvOpenFileSectionStream().
+  @param  Cached                     TRUE if the section stream was open already.
+
+**/
+VOID
+FvSectionCacheUpdate (
+  IN FFS_FILE_LIST_ENTRY  *FfsEntry,
+  IN BOOLEAN              Cached
+  )
+{
+  UINTN                 CacheSize;
+
+  //
+  // The read extracted encapsulation sections if the section stream grew.
+  //
+  CacheSize = GetSectionStreamSize (FfsEntry->StreamHandle);
+
+  CoreAcquireLock (&mSectionCacheLock);
+  ASSERT (FfsEntry->ReferenceCount > 0);
+  FfsEntry->ReferenceCount--;
+
+  if (Cached && CacheSize == FfsEntry->CacheSize) {
+    mSectionCacheStatistics.HitCount++;
+  } else {
+    mSectionCacheStatistics.MissCount++;
+  }
+
+  mSectionCacheStatistics.CachedSize -= FfsEntry->CacheSize;
+  mSectionCacheStatistics.CachedSize += CacheSize;
+  FfsEntry->CacheSize = CacheSize;
+
+  //
+  // Move the file to the most recently read end of the list
+  //
+  RemoveEntryList (&FfsEntry->CacheLink);
+  InsertTailList (&mSectionCacheLru, &FfsEntry->CacheLink);
+
+  SectionCacheEvict (FfsEntry);
+  CoreReleaseLock (&mSectionCacheLock);
+}
+
+
+/**
+  Remove a file from the section cache, before its section stream is closed
+  and its file list entry freed.  Any reference to its section data is
+  dropped.
+
+  @param  FfsEntry                   The file list entry.
+
+**/
+VOID
+FvSectionCacheRemove (
+  IN FFS_FILE_LIST_ENTRY  *FfsEntry
+  )
+{
+  LIST_ENTRY               *Link;
+  SECTION_CACHE_REFERENCE  *Reference;
+  LIST_ENTRY               Released;
+
+  InitializeListHead (&Released);
+
+  CoreAcquireLock (&mSectionCacheLock);
+  if (FfsEntry->StreamHandle != 0) {
+    RemoveEntryList (&FfsEntry->CacheLink);
+    mSectionCacheStatistics.CachedSize -= FfsEntry->CacheSize;
+    FfsEntry->CacheSize = 0;
+  }
+
+  Link = GetFirstNode (&mSectionCacheReferences);
+  while (FfsEntry->ReferenceCount != 0 && !IsNull (&mSectionCacheReferences, Link)) {
+    Reference = CR (Link, SECTION_CACHE_REFERENCE, Link, SECTION_CACHE_REFERENCE_SIGNATURE);
+    Link      = GetNextNode (&mSectionCacheReferences, Link);
+    if (Reference->FfsEntry == FfsEntry) {
+      RemoveEntryList (&Reference->Link);
+      InsertTailList (&Released, &Reference->Link);
+      FfsEntry->ReferenceCount--;
+    }
+  }
+  CoreReleaseLock (&mSectionCacheLock);
+
+  while (!IsListEmpty (&Released)) {
+    Reference = CR (GetFirstNode (&Released), SECTION_CACHE_REFERENCE, Link, SECTION_CACHE_REFERENCE_SIGNATURE);
+    RemoveEntryList (&Reference->Link);
+    CoreFreePool (Reference);
+  }
+}
+
+
+/**
+  Locate a section in a firmware file, the way
+  EFI_FIRMWARE_VOLUME2_PROTOCOL.ReadSection() does, and return a read-only
+  pointer to its data in the section cache.  The section data is referenced
+  until CoreReleaseCachedSection() is called, and is not evicted meanwhile.
+
+  @param  FirmwareVolume         A Firmware Volume2 Protocol instance produced
+                                 by the DXE Core.
+  @param  NameGuid               The name of the file.
+  @param  SectionType            The type of the section, or 0 for the whole
+                                 section stream of the file.
+  @param  SectionInstance        Which instance of sections of SectionType to
+                                 return.
+  @param  Buffer                 The data of the section, without its header.
+  @param  BufferSize             The size of the data of the section.
+  @param  AuthenticationStatus   The authentication status of the section.
+
+  @retval EFI_SUCCESS            The section was found, and is referenced.
+  @retval EFI_NOT_FOUND          The file or the section was not found.
+  @retval EFI_UNSUPPORTED        FirmwareVolume was not produced by the DXE
+                                 Core.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough pool memory to extract the
+                                 section.
+  @retval EFI_INVALID_PARAMETER  One or more parameters are NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreGetCachedSection (
+  IN  EFI_FIRMWARE_VOLUME2_PROTOCOL  *FirmwareVolume,
+  IN  CONST EFI_GUID                 *NameGuid,
+  IN  EFI_SECTION_TYPE               SectionType,
+  IN  UINTN                          SectionInstance,
+  OUT CONST VOID                     **Buffer,
+  OUT UINTN                          *BufferSize,
+  OUT UINT32                         *AuthenticationStatus
+  )
+{
+  EFI_STATUS               Status;
+  FV_DEVICE                *FvDevice;
+  FFS_FILE_LIST_ENTRY      *FfsEntry;
+  BOOLEAN                  Cached;
+  SECTION_CACHE_REFERENCE  *Reference;
+
+  if (FirmwareVolume == NULL || NameGuid == NULL || Buffer == NULL ||
+      BufferSize == NULL || AuthenticationStatus == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (FirmwareVolume->ReadSection != FvReadFileSection) {
+    return EFI_UNSUPPORTED;
+  }
+  FvDevice = FV_DEVICE_FROM_THIS (FirmwareVolume);
+
+  Reference = AllocatePool (sizeof (SECTION_CACHE_REFERENCE));
+  if (Reference == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = FvOpenFileSectionStream (FirmwareVolume, NameGuid, &FfsEntry, &Cached, AuthenticationStatus);
+  if (EFI_ERROR (Status)) {
+    CoreFreePool (Reference);
+    return Status;
+  }
+
+  //
+  // If SectionType == 0 We need the whole section stream
+  //
+  Status = GetSectionInPlace (
+             FfsEntry->StreamHandle,
+             (SectionType == 0) ? NULL : &SectionType,
+             NULL,
+             (SectionType == 0) ? 0 : SectionInstance,
+             Buffer,
+             BufferSize,
+             AuthenticationStatus,
+             FvDevice->IsFfs3Fv
+             );
+
+  if (!EFI_ERROR (Status)) {
+    //
+    // Inherit the authentication status.
+    //
+    *AuthenticationStatus |= FvDevice->AuthenticationStatus;
+
+    Reference->Signature = SECTION_CACHE_REFERENCE_SIGNATURE;
+    Reference->Buffer    = *Buffer;
+    Reference->FfsEntry  = FfsEntry;
+
+    CoreAcquireLock (&mSectionCacheLock);
+    FfsEntry->ReferenceCount++;
+    InsertTailList (&mSectionCacheReferences, &Reference->Link);
+    CoreReleaseLock (&mSectionCacheLock);
+  } else {
+    CoreFreePool (Reference);
+  }
+
+  FvSectionCacheUpdate (FfsEntry, Cached);
+
+  return Status;
+}
+
+
+/**
+  Release a reference to section data returned by CoreGetCachedSection().  The
+  data may be evicted afterwards, and must no longer be accessed.
+
+  @param  Buffer                 The data returned by CoreGetCachedSection().
+
+  @retval EFI_SUCCESS            The reference was released.
+  @retval EFI_NOT_FOUND          Buffer is not referenced.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreReleaseCachedSection (
+  IN  CONST VOID  *Buffer
+  )
+{
+  LIST_ENTRY               *Link;
+  SECTION_CACHE_REFERENCE  *Reference;
+
+  CoreAcquireLock (&mSectionCacheLock);
+  for (Link = GetFirstNode (&mSectionCacheReferences);
+       !IsNull (&mSectionCacheReferences, Link);
+       Link = GetNextNode (&mSectionCacheReferences, Link)) {
+    Reference = CR (Link, SECTION_CACHE_REFERENCE, Link, SECTION_CACHE_REFERENCE_SIGNATURE);
+    if (Reference->Buffer == Buffer) {
+      RemoveEntryList (&Reference->Link);
+      ASSERT (Reference->FfsEntry->ReferenceCount > 0);
+      Reference->FfsEntry->ReferenceCount--;
+      SectionCacheEvict (NULL);
+      CoreReleaseLock (&mSectionCacheLock);
+
+      CoreFreePool (Reference);
+      return EFI_SUCCESS;
+    }
+  }
+  CoreReleaseLock (&mSectionCacheLock);
+
+  return EFI_NOT_FOUND;
+}
+
+
+/**
+  Retrieve the statistics of the section cache since the DXE Core started.
+
+  @param  Statistics             The buffer to return the statistics in.
+
+  @retval EFI_SUCCESS            The statistics were returned.
+  @retval EFI_INVALID_PARAMETER  Statistics is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreGetSectionCacheStatistics (
+  OUT EDKII_SECTION_CACHE_STATISTICS  *Statistics
+  )
+{
+  if (Statistics == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CoreAcquireLock (&mSectionCacheLock);
+  CopyMem (Statistics, &mSectionCacheStatistics, sizeof (EDKII_SECTION_CACHE_STATISTICS));
+  CoreReleaseLock (&mSectionCacheLock);
+  Statistics->MaxCachedSize = PcdGet32 (PcdDxeSectionCacheSize);
+
+  return EFI_SUCCESS;
+}
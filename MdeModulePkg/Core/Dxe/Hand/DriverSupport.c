@@ -68,7 +68,7 @@ CoreConnectController (
   //
   // Make sure ControllerHandle is valid
   //
-  Status = CoreValidateHandle (ControllerHandle);
+  Status = CoreValidateHandle (ControllerHandle, FALSE);
   if (EFI_ERROR (Status)) {
     return Status;
   }
@@ -154,7 +154,7 @@ CoreConnectController (
     //
     // Make sure the DriverBindingHandle is valid
     //
-    Status = CoreValidateHandle (ControllerHandle);
+    Status = CoreValidateHandle (ControllerHandle, TRUE);
     if (EFI_ERROR (Status)) {
       //
       // Release the protocol lock on the handle database
@@ -268,7 +268,7 @@ AddSortedDriverBindingProtocol (
   //
   // Make sure the DriverBindingHandle is valid
   //
-  Status = CoreValidateHandle (DriverBindingHandle);
+  Status = CoreValidateHandle (DriverBindingHandle, FALSE);
   if (EFI_ERROR (Status)) {
     return;
   }
@@ -746,7 +746,7 @@ CoreDisconnectController (
   //
   // Make sure ControllerHandle is valid
   //
-  Status = CoreValidateHandle (ControllerHandle);
+  Status = CoreValidateHandle (ControllerHandle, FALSE);
   if (EFI_ERROR (Status)) {
     return Status;
   }
@@ -755,7 +755,7 @@ CoreDisconnectController (
   // Make sure ChildHandle is valid if it is not NULL
   //
   if (ChildHandle != NULL) {
-    Status = CoreValidateHandle (ChildHandle);
+    Status = CoreValidateHandle (ChildHandle, FALSE);
     if (EFI_ERROR (Status)) {
       return Status;
     }
@@ -15,11 +15,37 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 // gHandleList           - A list of all the handles in the system
 // gProtocolDatabaseLock - Lock to protect the mProtocolDatabase
 // gHandleDatabaseKey    -  The Key to show that the handle has been created/modified
+// gProtocolDatabaseGeneration - The generation of the last protocol interface added to
+//                         the handle array of a protocol entry
 //
 LIST_ENTRY      mProtocolDatabase     = INITIALIZE_LIST_HEAD_VARIABLE (mProtocolDatabase);
 LIST_ENTRY      gHandleList           = INITIALIZE_LIST_HEAD_VARIABLE (gHandleList);
 EFI_LOCK        gProtocolDatabaseLock = EFI_INITIALIZE_LOCK_VARIABLE (TPL_NOTIFY);
 UINT64          gHandleDatabaseKey    = 0;
+UINT64          gProtocolDatabaseGeneration = 0;
+
+//
+// The protocol database and the handle list are additionally indexed by two
+// open-addressed hash tables with linear probing, so that GUID lookups and
+// handle validation do not have to walk the lists above.  Both tables start
+// out in static storage and are moved to pool memory once they need to grow.
+//
+// mProtocolHashTable    - PROTOCOL_ENTRY pointers, keyed by ProtocolID.  Protocol
+//                         entries are never removed, so no deletion is needed.
+// mHandleHashTable      - IHANDLE pointers of all the handles in gHandleList.
+//
+#define PROTOCOL_HASH_INITIAL_SIZE  64
+#define HANDLE_HASH_INITIAL_SIZE    256
+
+PROTOCOL_ENTRY  *mProtocolHashInitialTable[PROTOCOL_HASH_INITIAL_SIZE];
+PROTOCOL_ENTRY  **mProtocolHashTable  = mProtocolHashInitialTable;
+UINTN           mProtocolHashSize     = PROTOCOL_HASH_INITIAL_SIZE;
+UINTN           mProtocolEntryCount   = 0;
+
+IHANDLE         *mHandleHashInitialTable[HANDLE_HASH_INITIAL_SIZE];
+IHANDLE         **mHandleHashTable    = mHandleHashInitialTable;
+UINTN           mHandleHashSize       = HANDLE_HASH_INITIAL_SIZE;
+UINTN           mHandleCount          = 0;
 
 
 
@@ -51,10 +77,251 @@ CoreReleaseProtocolLock (
 
 
 
+/**
+  Scramble a value so that the low bits can be used as a hash table index.
+
+  @param  Value                  The value to scramble.
+
+  @return The scrambled value.
+
+**/
+STATIC
+UINTN
+CoreHashValue (
+  IN UINT64   Value
+  )
+{
+  Value ^= RShiftU64 (Value, 33);
+  Value  = MultU64x64 (Value, 0xFF51AFD7ED558CCDULL);
+  Value ^= RShiftU64 (Value, 33);
+  return (UINTN)Value;
+}
+
+
+
+/**
+  Compute the slot of a protocol GUID in mProtocolHashTable.
+
+  @param  Protocol               The ID of the protocol.
+
+  @return The first slot to probe for Protocol.
+
+**/
+STATIC
+UINTN
+CoreProtocolHashSlot (
+  IN EFI_GUID   *Protocol
+  )
+{
+  UINT64  Value;
+
+  Value = ReadUnaligned64 ((UINT64 *)Protocol) ^ ReadUnaligned64 ((UINT64 *)Protocol + 1);
+  return CoreHashValue (Value) & (mProtocolHashSize - 1);
+}
+
+
+
+/**
+  Compute the slot of a handle in mHandleHashTable.
+
+  @param  Handle                 The handle.
+
+  @return The first slot to probe for Handle.
+
+**/
+STATIC
+UINTN
+CoreHandleHashSlot (
+  IN EFI_HANDLE   Handle
+  )
+{
+  return CoreHashValue ((UINT64)(UINTN)Handle) & (mHandleHashSize - 1);
+}
+
+
+
+/**
+  Insert a protocol entry into mProtocolHashTable, growing the table when it
+  is three quarters full.
+  The gProtocolDatabaseLock must be owned
+
+  @param  ProtEntry              The protocol entry to insert.
+
+  @retval EFI_SUCCESS            The protocol entry was inserted.
+  @retval EFI_OUT_OF_RESOURCES   The table is full and could not be grown.
+
+**/
+STATIC
+EFI_STATUS
+CoreInsertProtocolHash (
+  IN PROTOCOL_ENTRY   *ProtEntry
+  )
+{
+  PROTOCOL_ENTRY  **OldTable;
+  PROTOCOL_ENTRY  **NewTable;
+  UINTN           OldSize;
+  UINTN           Index;
+  UINTN           Slot;
+
+  if ((mProtocolEntryCount + 1) * 4 > mProtocolHashSize * 3) {
+    NewTable = AllocateZeroPool (mProtocolHashSize * 2 * sizeof (PROTOCOL_ENTRY *));
+    if (NewTable != NULL) {
+      OldTable           = mProtocolHashTable;
+      OldSize            = mProtocolHashSize;
+      mProtocolHashTable = NewTable;
+      mProtocolHashSize  = OldSize * 2;
+      for (Index = 0; Index < OldSize; Index++) {
+        if (OldTable[Index] != NULL) {
+          Slot = CoreProtocolHashSlot (&OldTable[Index]->ProtocolID);
+          while (mProtocolHashTable[Slot] != NULL) {
+            Slot = (Slot + 1) & (mProtocolHashSize - 1);
+          }
+          mProtocolHashTable[Slot] = OldTable[Index];
+        }
+      }
+      if (OldTable != mProtocolHashInitialTable) {
+        CoreFreePool (OldTable);
+      }
+    } else if (mProtocolEntryCount + 1 >= mProtocolHashSize) {
+      //
+      // Always keep one empty slot so that probing terminates
+      //
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  Slot = CoreProtocolHashSlot (&ProtEntry->ProtocolID);
+  while (mProtocolHashTable[Slot] != NULL) {
+    Slot = (Slot + 1) & (mProtocolHashSize - 1);
+  }
+  mProtocolHashTable[Slot] = ProtEntry;
+  mProtocolEntryCount++;
+
+  return EFI_SUCCESS;
+}
+
+
+
+/**
+  Insert a handle into mHandleHashTable, growing the table when it is three
+  quarters full.
+  The gProtocolDatabaseLock must be owned
+
+  @param  Handle                 The handle to insert.
+
+  @retval EFI_SUCCESS            The handle was inserted.
+  @retval EFI_OUT_OF_RESOURCES   The table is full and could not be grown.
+
+**/
+STATIC
+EFI_STATUS
+CoreInsertHandleHash (
+  IN IHANDLE    *Handle
+  )
+{
+  IHANDLE   **OldTable;
+  IHANDLE   **NewTable;
+  UINTN     OldSize;
+  UINTN     Index;
+  UINTN     Slot;
+
+  ASSERT_LOCKED (&gProtocolDatabaseLock);
+
+  if ((mHandleCount + 1) * 4 > mHandleHashSize * 3) {
+    NewTable = AllocateZeroPool (mHandleHashSize * 2 * sizeof (IHANDLE *));
+    if (NewTable != NULL) {
+      OldTable         = mHandleHashTable;
+      OldSize          = mHandleHashSize;
+      mHandleHashTable = NewTable;
+      mHandleHashSize  = OldSize * 2;
+      for (Index = 0; Index < OldSize; Index++) {
+        if (OldTable[Index] != NULL) {
+          Slot = CoreHandleHashSlot (OldTable[Index]);
+          while (mHandleHashTable[Slot] != NULL) {
+            Slot = (Slot + 1) & (mHandleHashSize - 1);
+          }
+          mHandleHashTable[Slot] = OldTable[Index];
+        }
+      }
+      if (OldTable != mHandleHashInitialTable) {
+        CoreFreePool (OldTable);
+      }
+    } else if (mHandleCount + 1 >= mHandleHashSize) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+  }
+
+  Slot = CoreHandleHashSlot (Handle);
+  while (mHandleHashTable[Slot] != NULL) {
+    Slot = (Slot + 1) & (mHandleHashSize - 1);
+  }
+  mHandleHashTable[Slot] = Handle;
+  mHandleCount++;
+
+  return EFI_SUCCESS;
+}
+
+
+
+/**
+  Remove a handle from mHandleHashTable.  The entries that follow it in the
+  same probe sequence are shifted back so that no tombstones are needed.
+  The gProtocolDatabaseLock must be owned
+
+  @param  Handle                 The handle to remove.
+
+**/
+STATIC
+VOID
+CoreRemoveHandleHash (
+  IN IHANDLE    *Handle
+  )
+{
+  UINTN     Mask;
+  UINTN     Hole;
+  UINTN     Slot;
+  UINTN     Home;
+
+  ASSERT_LOCKED (&gProtocolDatabaseLock);
+
+  Mask = mHandleHashSize - 1;
+  Hole = CoreHandleHashSlot (Handle);
+  while (mHandleHashTable[Hole] != Handle) {
+    if (mHandleHashTable[Hole] == NULL) {
+      ASSERT (FALSE);
+      return;
+    }
+    Hole = (Hole + 1) & Mask;
+  }
+
+  Slot = Hole;
+  for (;;) {
+    Slot = (Slot + 1) & Mask;
+    if (mHandleHashTable[Slot] == NULL) {
+      break;
+    }
+    //
+    // Move the entry into the hole unless its home slot lies cyclically in
+    // (Hole, Slot], in which case it is still reachable from its home slot.
+    //
+    Home = CoreHandleHashSlot (mHandleHashTable[Slot]);
+    if (((Slot - Home) & Mask) >= ((Slot - Hole) & Mask)) {
+      mHandleHashTable[Hole] = mHandleHashTable[Slot];
+      Hole = Slot;
+    }
+  }
+
+  mHandleHashTable[Hole] = NULL;
+  mHandleCount--;
+}
+
+
+
 /**
   Check whether a handle is a valid EFI_HANDLE
 
   @param  UserHandle             The handle to check
+  @param  IsLocked               The protocol lock is acquried or not
 
   @retval EFI_INVALID_PARAMETER  The handle is NULL or not a valid EFI_HANDLE.
   @retval EFI_SUCCESS            The handle is valid EFI_HANDLE.
@@ -62,24 +329,38 @@ CoreReleaseProtocolLock (
 **/
 EFI_STATUS
 CoreValidateHandle (
-  IN  EFI_HANDLE                UserHandle
+  IN  EFI_HANDLE                UserHandle,
+  IN  BOOLEAN                   IsLocked
   )
 {
-  IHANDLE             *Handle;
-  LIST_ENTRY          *Link;
+  EFI_STATUS          Status;
+  UINTN               Slot;
 
   if (UserHandle == NULL) {
     return EFI_INVALID_PARAMETER;
   }
 
-  for (Link = gHandleList.BackLink; Link != &gHandleList; Link = Link->BackLink) {
-    Handle = CR (Link, IHANDLE, AllHandles, EFI_HANDLE_SIGNATURE);
-    if (Handle == (IHANDLE *) UserHandle) {
-      return EFI_SUCCESS;
+  if (IsLocked) {
+    ASSERT_LOCKED (&gProtocolDatabaseLock);
+  } else {
+    CoreAcquireProtocolLock ();
+  }
+
+  Status = EFI_INVALID_PARAMETER;
+  for (Slot = CoreHandleHashSlot (UserHandle);
+       mHandleHashTable[Slot] != NULL;
+       Slot = (Slot + 1) & (mHandleHashSize - 1)) {
+    if (mHandleHashTable[Slot] == (IHANDLE *) UserHandle) {
+      Status = EFI_SUCCESS;
+      break;
     }
   }
 
-  return EFI_INVALID_PARAMETER;
+  if (!IsLocked) {
+    CoreReleaseProtocolLock ();
+  }
+
+  return Status;
 }
 
 
@@ -100,22 +381,23 @@ CoreFindProtocolEntry (
   IN BOOLEAN    Create
   )
 {
-  LIST_ENTRY          *Link;
+  UINTN               Slot;
   PROTOCOL_ENTRY      *Item;
   PROTOCOL_ENTRY      *ProtEntry;
 
   ASSERT_LOCKED(&gProtocolDatabaseLock);
 
   //
-  // Search the database for the matching GUID
+  // Search the hash index of the database for the matching GUID
   //
 
   ProtEntry = NULL;
-  for (Link = mProtocolDatabase.ForwardLink;
-       Link != &mProtocolDatabase;
-       Link = Link->ForwardLink) {
+  for (Slot = CoreProtocolHashSlot (Protocol);
+       mProtocolHashTable[Slot] != NULL;
+       Slot = (Slot + 1) & (mProtocolHashSize - 1)) {
 
-    Item = CR(Link, PROTOCOL_ENTRY, AllEntries, PROTOCOL_ENTRY_SIGNATURE);
+    Item = mProtocolHashTable[Slot];
+    ASSERT (Item->Signature == PROTOCOL_ENTRY_SIGNATURE);
     if (CompareGuid (&Item->ProtocolID, Protocol)) {
 
       //
@@ -142,6 +424,17 @@ CoreFindProtocolEntry (
       CopyGuid ((VOID *)&ProtEntry->ProtocolID, Protocol);
       InitializeListHead (&ProtEntry->Protocols);
       InitializeListHead (&ProtEntry->Notify);
+      ProtEntry->Index          = mProtocolEntryCount;
+      ProtEntry->Handles        = NULL;
+      ProtEntry->HandleCount    = 0;
+      ProtEntry->HandleCapacity = 0;
+      ProtEntry->BatchOpenCount   = 0;
+      ProtEntry->BatchNotifyCount = 0;
+
+      if (EFI_ERROR (CoreInsertProtocolHash (ProtEntry))) {
+        CoreFreePool (ProtEntry);
+        return NULL;
+      }
 
       //
       // Add it to protocol database
@@ -155,6 +448,188 @@ CoreFindProtocolEntry (
 
 
 
+/**
+  Finds the protocol interface of a protocol entry on a handle, using the
+  per-handle protocol index before falling back to the handle's protocol list.
+  The gProtocolDatabaseLock must be owned
+
+  @param  Handle                 The handle to search the protocol on
+  @param  ProtEntry              The protocol entry to search for
+
+  @return Protocol instance (NULL: Not found)
+
+**/
+STATIC
+PROTOCOL_INTERFACE *
+CoreFindProtocolInterfaceByEntry (
+  IN IHANDLE          *Handle,
+  IN PROTOCOL_ENTRY   *ProtEntry
+  )
+{
+  PROTOCOL_INTERFACE  *Prot;
+  LIST_ENTRY          *Link;
+
+  Prot = Handle->ProtocolIndex[ProtEntry->Index & (HANDLE_PROTOCOL_INDEX_SIZE - 1)];
+  if ((Prot != NULL) && (Prot->Protocol == ProtEntry)) {
+    return Prot;
+  }
+
+  for (Link = Handle->Protocols.ForwardLink; Link != &Handle->Protocols; Link = Link->ForwardLink) {
+    Prot = CR(Link, PROTOCOL_INTERFACE, Link, PROTOCOL_INTERFACE_SIGNATURE);
+    if (Prot->Protocol == ProtEntry) {
+      return Prot;
+    }
+  }
+
+  return NULL;
+}
+
+
+
+/**
+  Remove a protocol interface from the per-handle protocol index, refilling
+  its slot with another interface of the handle that maps to the same slot.
+  The gProtocolDatabaseLock must be owned
+
+  @param  Handle                 The handle the protocol interface is on
+  @param  Prot                   The protocol interface being removed
+
+**/
+STATIC
+VOID
+CoreRemoveHandleProtocolIndex (
+  IN IHANDLE              *Handle,
+  IN PROTOCOL_INTERFACE   *Prot
+  )
+{
+  UINTN               Slot;
+  LIST_ENTRY          *Link;
+  PROTOCOL_INTERFACE  *Other;
+
+  Slot = Prot->Protocol->Index & (HANDLE_PROTOCOL_INDEX_SIZE - 1);
+  if (Handle->ProtocolIndex[Slot] != Prot) {
+    return;
+  }
+
+  Handle->ProtocolIndex[Slot] = NULL;
+  for (Link = Handle->Protocols.ForwardLink; Link != &Handle->Protocols; Link = Link->ForwardLink) {
+    Other = CR(Link, PROTOCOL_INTERFACE, Link, PROTOCOL_INTERFACE_SIGNATURE);
+    if ((Other != Prot) && ((Other->Protocol->Index & (HANDLE_PROTOCOL_INDEX_SIZE - 1)) == Slot)) {
+      Handle->ProtocolIndex[Slot] = Other;
+      break;
+    }
+  }
+}
+
+
+
+/**
+  Reserve room for one more handle in the handle array of a protocol entry.
+  The gProtocolDatabaseLock must be owned
+
+  @param  ProtEntry              Protocol entry
+
+  @retval EFI_SUCCESS            CoreAddProtocolHandle() will not fail.
+  @retval EFI_OUT_OF_RESOURCES   The handle array could not be grown.
+
+**/
+EFI_STATUS
+CoreReserveProtocolHandle (
+  IN PROTOCOL_ENTRY   *ProtEntry
+  )
+{
+  PROTOCOL_HANDLE_STAMP   *NewHandles;
+  UINTN                   NewCapacity;
+
+  ASSERT_LOCKED(&gProtocolDatabaseLock);
+
+  if (ProtEntry->HandleCount < ProtEntry->HandleCapacity) {
+    return EFI_SUCCESS;
+  }
+
+  NewCapacity = MAX (ProtEntry->HandleCapacity * 2, 4);
+  NewHandles  = AllocatePool (NewCapacity * sizeof (PROTOCOL_HANDLE_STAMP));
+  if (NewHandles == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  if (ProtEntry->Handles != NULL) {
+    CopyMem (NewHandles, ProtEntry->Handles, ProtEntry->HandleCount * sizeof (PROTOCOL_HANDLE_STAMP));
+    CoreFreePool (ProtEntry->Handles);
+  }
+  ProtEntry->Handles        = NewHandles;
+  ProtEntry->HandleCapacity = NewCapacity;
+
+  return EFI_SUCCESS;
+}
+
+
+
+/**
+  Append a handle to the handle array of a protocol entry, stamped with a new
+  protocol database generation.  Room must have been reserved with
+  CoreReserveProtocolHandle().
+  The gProtocolDatabaseLock must be owned
+
+  @param  ProtEntry              Protocol entry
+  @param  Handle                 The handle the protocol was installed on
+
+**/
+VOID
+CoreAddProtocolHandle (
+  IN PROTOCOL_ENTRY   *ProtEntry,
+  IN IHANDLE          *Handle
+  )
+{
+  ASSERT_LOCKED(&gProtocolDatabaseLock);
+  ASSERT (ProtEntry->HandleCount < ProtEntry->HandleCapacity);
+
+  gProtocolDatabaseGeneration++;
+  ProtEntry->Handles[ProtEntry->HandleCount].Handle     = Handle;
+  ProtEntry->Handles[ProtEntry->HandleCount].Generation = gProtocolDatabaseGeneration;
+  ProtEntry->HandleCount++;
+}
+
+
+
+/**
+  Remove a handle from the handle array of a protocol entry.
+  The gProtocolDatabaseLock must be owned
+
+  @param  ProtEntry              Protocol entry
+  @param  Handle                 The handle the protocol is removed from
+
+**/
+VOID
+CoreRemoveProtocolHandle (
+  IN PROTOCOL_ENTRY   *ProtEntry,
+  IN IHANDLE          *Handle
+  )
+{
+  UINTN     Index;
+
+  ASSERT_LOCKED(&gProtocolDatabaseLock);
+
+  for (Index = 0; Index < ProtEntry->HandleCount; Index++) {
+    if (ProtEntry->Handles[Index].Handle == Handle) {
+      //
+      // Keep the array in the order of ProtEntry->Protocols
+      //
+      CopyMem (
+        &ProtEntry->Handles[Index],
+        &ProtEntry->Handles[Index + 1],
+        (ProtEntry->HandleCount - Index - 1) * sizeof (PROTOCOL_HANDLE_STAMP)
+        );
+      ProtEntry->HandleCount--;
+      return;
+    }
+  }
+
+  ASSERT (FALSE);
+}
+
+
+
 /**
   Finds the protocol instance for the requested handle and protocol.
   Note: This function doesn't do parameters checking, it's caller's responsibility
@@ -176,7 +651,6 @@ CoreFindProtocolInterface (
 {
   PROTOCOL_INTERFACE  *Prot;
   PROTOCOL_ENTRY      *ProtEntry;
-  LIST_ENTRY          *Link;
 
   ASSERT_LOCKED(&gProtocolDatabaseLock);
   Prot = NULL;
@@ -189,18 +663,11 @@ CoreFindProtocolInterface (
   if (ProtEntry != NULL) {
 
     //
-    // Look at each protocol interface for any matches
+    // A protocol is installed at most once on a handle, so the interface
+    // found for the protocol entry is the only candidate
     //
-    for (Link = Handle->Protocols.ForwardLink; Link != &Handle->Protocols; Link=Link->ForwardLink) {
-
-      //
-      // If this protocol interface matches, remove it
-      //
-      Prot = CR(Link, PROTOCOL_INTERFACE, Link, PROTOCOL_INTERFACE_SIGNATURE);
-      if (Prot->Interface == Interface && Prot->Protocol == ProtEntry) {
-        break;
-      }
-
+    Prot = CoreFindProtocolInterfaceByEntry (Handle, ProtEntry);
+    if ((Prot != NULL) && (Prot->Interface != Interface)) {
       Prot = NULL;
     }
   }
@@ -399,6 +866,14 @@ CoreInstallProtocolInterfaceNotify (
     goto Done;
   }
 
+  //
+  // Make sure the handle can be added to the handle array of the protocol entry
+  //
+  Status = CoreReserveProtocolHandle (ProtEntry);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+
   //
   // If caller didn't supply a handle, allocate a new one
   //
@@ -416,6 +891,15 @@ CoreInstallProtocolInterfaceNotify (
     Handle->Signature = EFI_HANDLE_SIGNATURE;
     InitializeListHead (&Handle->Protocols);
 
+    //
+    // Add this handle to the hash index used to validate handles
+    //
+    Status = CoreInsertHandleHash (Handle);
+    if (EFI_ERROR (Status)) {
+      CoreFreePool (Handle);
+      goto Done;
+    }
+
     //
     // Initialize the Key to show that the handle has been created/modified
     //
@@ -428,7 +912,7 @@ CoreInstallProtocolInterfaceNotify (
     //
     InsertTailList (&gHandleList, &Handle->AllHandles);
   } else {
-    Status = CoreValidateHandle (Handle);
+    Status = CoreValidateHandle (Handle, TRUE);
     if (EFI_ERROR (Status)) {
       DEBUG((DEBUG_ERROR, "InstallProtocolInterface: input handle at 0x%x is invalid\n", Handle));
       goto Done;
@@ -460,11 +944,25 @@ CoreInstallProtocolInterfaceNotify (
   //
   InsertHeadList (&Handle->Protocols, &Prot->Link);
 
+  //
+  // Add this protocol interface to the per-handle protocol index if its
+  // slot is free
+  //
+  if (Handle->ProtocolIndex[ProtEntry->Index & (HANDLE_PROTOCOL_INDEX_SIZE - 1)] == NULL) {
+    Handle->ProtocolIndex[ProtEntry->Index & (HANDLE_PROTOCOL_INDEX_SIZE - 1)] = Prot;
+  }
+
   //
   // Add this protocol interface to the tail of the
   // protocol entry
   //
   InsertTailList (&ProtEntry->Protocols, &Prot->ByProtocol);
+  CoreAddProtocolHandle (ProtEntry, Handle);
+
+  //
+  // Have the DXE Dispatcher evaluate again the Depex that wait for this protocol
+  //
+  CoreDepexProtocolInstalled (&ProtEntry->ProtocolID);
 
   //
   // Notify the notification list for this protocol
@@ -723,7 +1221,7 @@ CoreUninstallProtocolInterface (
   //
   // Check that UserHandle is a valid handle
   //
-  Status = CoreValidateHandle (UserHandle);
+  Status = CoreValidateHandle (UserHandle, FALSE);
   if (EFI_ERROR (Status)) {
     return Status;
   }
@@ -773,6 +1271,7 @@ CoreUninstallProtocolInterface (
     //
     // Remove the protocol interface from the handle
     //
+    CoreRemoveHandleProtocolIndex (Handle, Prot);
     RemoveEntryList (&Prot->Link);
 
     //
@@ -788,6 +1287,7 @@ CoreUninstallProtocolInterface (
   //
   if (IsListEmpty (&Handle->Protocols)) {
     Handle->Signature = 0;
+    CoreRemoveHandleHash (Handle);
     RemoveEntryList (&Handle->AllHandles);
     CoreFreePool (Handle);
   }
@@ -895,28 +1395,21 @@ CoreGetProtocolInterface (
 {
   EFI_STATUS          Status;
   PROTOCOL_ENTRY      *ProtEntry;
-  PROTOCOL_INTERFACE  *Prot;
-  IHANDLE             *Handle;
-  LIST_ENTRY          *Link;
 
-  Status = CoreValidateHandle (UserHandle);
+  Status = CoreValidateHandle (UserHandle, TRUE);
   if (EFI_ERROR (Status)) {
     return NULL;
   }
 
-  Handle = (IHANDLE *)UserHandle;
-
   //
-  // Look at each protocol interface for a match
+  // Look up the protocol entry, then the handle's interface for it
   //
-  for (Link = Handle->Protocols.ForwardLink; Link != &Handle->Protocols; Link = Link->ForwardLink) {
-    Prot = CR(Link, PROTOCOL_INTERFACE, Link, PROTOCOL_INTERFACE_SIGNATURE);
-    ProtEntry = Prot->Protocol;
-    if (CompareGuid (&ProtEntry->ProtocolID, Protocol)) {
-      return Prot;
-    }
+  ProtEntry = CoreFindProtocolEntry (Protocol, FALSE);
+  if (ProtEntry == NULL) {
+    return NULL;
   }
-  return NULL;
+
+  return CoreFindProtocolInterfaceByEntry ((IHANDLE *)UserHandle, ProtEntry);
 }
 
 
@@ -1013,7 +1506,7 @@ CoreOpenProtocol (
   //
   // Check for invalid UserHandle
   //
-  Status = CoreValidateHandle (UserHandle);
+  Status = CoreValidateHandle (UserHandle, FALSE);
   if (EFI_ERROR (Status)) {
     return Status;
   }
@@ -1023,11 +1516,11 @@ CoreOpenProtocol (
   //
   switch (Attributes) {
   case EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER :
-    Status = CoreValidateHandle (ImageHandle);
+    Status = CoreValidateHandle (ImageHandle, FALSE);
     if (EFI_ERROR (Status)) {
       return Status;
     }
-    Status = CoreValidateHandle (ControllerHandle);
+    Status = CoreValidateHandle (ControllerHandle, FALSE);
     if (EFI_ERROR (Status)) {
       return Status;
     }
@@ -1037,17 +1530,17 @@ CoreOpenProtocol (
     break;
   case EFI_OPEN_PROTOCOL_BY_DRIVER :
   case EFI_OPEN_PROTOCOL_BY_DRIVER | EFI_OPEN_PROTOCOL_EXCLUSIVE :
-    Status = CoreValidateHandle (ImageHandle);
+    Status = CoreValidateHandle (ImageHandle, FALSE);
     if (EFI_ERROR (Status)) {
       return Status;
     }
-    Status = CoreValidateHandle (ControllerHandle);
+    Status = CoreValidateHandle (ControllerHandle, FALSE);
     if (EFI_ERROR (Status)) {
       return Status;
     }
     break;
   case EFI_OPEN_PROTOCOL_EXCLUSIVE :
-    Status = CoreValidateHandle (ImageHandle);
+    Status = CoreValidateHandle (ImageHandle, FALSE);
     if (EFI_ERROR (Status)) {
       return Status;
     }
@@ -1249,16 +1742,16 @@ CoreCloseProtocol (
   //
   // Check for invalid parameters
   //
-  Status = CoreValidateHandle (UserHandle);
+  Status = CoreValidateHandle (UserHandle, FALSE);
   if (EFI_ERROR (Status)) {
     return Status;
   }
-  Status = CoreValidateHandle (AgentHandle);
+  Status = CoreValidateHandle (AgentHandle, FALSE);
   if (EFI_ERROR (Status)) {
     return Status;
   }
   if (ControllerHandle != NULL) {
-    Status = CoreValidateHandle (ControllerHandle);
+    Status = CoreValidateHandle (ControllerHandle, FALSE);
     if (EFI_ERROR (Status)) {
       return Status;
     }
@@ -1443,7 +1936,7 @@ CoreProtocolsPerHandle (
   UINTN                               ProtocolCount;
   EFI_GUID                            **Buffer;
 
-  Status = CoreValidateHandle (UserHandle);
+  Status = CoreValidateHandle (UserHandle, FALSE);
   if (EFI_ERROR (Status)) {
     return Status;
   }
@@ -12,6 +12,13 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #define EFI_HANDLE_SIGNATURE            SIGNATURE_32('h','n','d','l')
 
+///
+/// Number of slots in the per-handle protocol interface index.  Must be a
+/// power of two.  Most handles carry fewer protocols than this, so a slot
+/// lookup almost always avoids walking IHANDLE.Protocols.
+///
+#define HANDLE_PROTOCOL_INDEX_SIZE      8
+
 ///
 /// IHANDLE - contains a list of protocol handles
 ///
@@ -24,12 +31,23 @@ typedef struct {
   UINTN               LocateRequest;
   /// The Handle Database Key value when this handle was last created or modified
   UINT64              Key;
+  /// Direct-mapped index of PROTOCOL_INTERFACE's, keyed by PROTOCOL_ENTRY.Index
+  struct _PROTOCOL_INTERFACE  *ProtocolIndex[HANDLE_PROTOCOL_INDEX_SIZE];
 } IHANDLE;
 
 #define ASSERT_IS_HANDLE(a)  ASSERT((a)->Signature == EFI_HANDLE_SIGNATURE)
 
 #define PROTOCOL_ENTRY_SIGNATURE        SIGNATURE_32('p','r','t','e')
 
+///
+/// PROTOCOL_HANDLE_STAMP - a handle that supports a protocol, stamped with the
+/// protocol database generation in which the interface was added to it.
+///
+typedef struct {
+  IHANDLE             *Handle;
+  UINT64              Generation;
+} PROTOCOL_HANDLE_STAMP;
+
 ///
 /// PROTOCOL_ENTRY - each different protocol has 1 entry in the protocol
 /// database.  Each handler that supports this protocol is listed, along
@@ -45,6 +63,17 @@ typedef struct {
   LIST_ENTRY          Protocols;
   /// Registerd notification handlers
   LIST_ENTRY          Notify;
+  /// Creation order of this entry, used to select a slot in IHANDLE.ProtocolIndex
+  UINTN               Index;
+  /// Handles of all protocol interfaces, in the order of Protocols.  The
+  /// generation stamps are therefore in ascending order.
+  PROTOCOL_HANDLE_STAMP *Handles;
+  UINTN               HandleCount;
+  UINTN               HandleCapacity;
+  /// Number of open protocol notify batches covering this protocol
+  UINTN               BatchOpenCount;
+  /// Number of notifications of this protocol deferred by the open batches
+  UINTN               BatchNotifyCount;
 } PROTOCOL_ENTRY;
 
 
@@ -54,7 +83,7 @@ typedef struct {
 /// PROTOCOL_INTERFACE - each protocol installed on a handle is tracked
 /// with a protocol interface structure
 ///
-typedef struct {
+typedef struct _PROTOCOL_INTERFACE {
   UINTN                       Signature;
   /// Link on IHANDLE.Protocols
   LIST_ENTRY                  Link;
@@ -103,6 +132,21 @@ typedef struct {
 } PROTOCOL_NOTIFY;
 
 
+#define PROTOCOL_NOTIFY_BATCH_SIGNATURE SIGNATURE_32('p','r','n','b')
+
+///
+/// PROTOCOL_NOTIFY_BATCH - an open batch of protocol notifications
+///
+typedef struct {
+  UINTN               Signature;
+  /// Link on the list of open batches
+  LIST_ENTRY          Link;
+  /// Protocol entries of the protocols whose notifications are deferred
+  UINTN               ProtocolCount;
+  PROTOCOL_ENTRY      **ProtEntries;
+} PROTOCOL_NOTIFY_BATCH;
+
+
 
 /**
   Finds the protocol entry for the requested protocol.
@@ -121,6 +165,54 @@ CoreFindProtocolEntry (
   );
 
 
+/**
+  Reserve room for one more handle in the handle array of a protocol entry.
+  The gProtocolDatabaseLock must be owned
+
+  @param  ProtEntry              Protocol entry
+
+  @retval EFI_SUCCESS            CoreAddProtocolHandle() will not fail.
+  @retval EFI_OUT_OF_RESOURCES   The handle array could not be grown.
+
+**/
+EFI_STATUS
+CoreReserveProtocolHandle (
+  IN PROTOCOL_ENTRY   *ProtEntry
+  );
+
+
+/**
+  Append a handle to the handle array of a protocol entry, stamped with a new
+  protocol database generation.  Room must have been reserved with
+  CoreReserveProtocolHandle().
+  The gProtocolDatabaseLock must be owned
+
+  @param  ProtEntry              Protocol entry
+  @param  Handle                 The handle the protocol was installed on
+
+**/
+VOID
+CoreAddProtocolHandle (
+  IN PROTOCOL_ENTRY   *ProtEntry,
+  IN IHANDLE          *Handle
+  );
+
+
+/**
+  Remove a handle from the handle array of a protocol entry.
+  The gProtocolDatabaseLock must be owned
+
+  @param  ProtEntry              Protocol entry
+  @param  Handle                 The handle the protocol is removed from
+
+**/
+VOID
+CoreRemoveProtocolHandle (
+  IN PROTOCOL_ENTRY   *ProtEntry,
+  IN IHANDLE          *Handle
+  );
+
+
 /**
   Signal event for every protocol in protocol entry.
 
@@ -244,6 +336,7 @@ CoreReleaseProtocolLock (
   Check whether a handle is a valid EFI_HANDLE
 
   @param  UserHandle             The handle to check
+  @param  IsLocked               The protocol lock is acquried or not
 
   @retval EFI_INVALID_PARAMETER  The handle is NULL or not a valid EFI_HANDLE.
   @retval EFI_SUCCESS            The handle is valid EFI_HANDLE.
@@ -251,7 +344,8 @@ CoreReleaseProtocolLock (
 **/
 EFI_STATUS
 CoreValidateHandle (
-  IN  EFI_HANDLE                UserHandle
+  IN  EFI_HANDLE                UserHandle,
+  IN  BOOLEAN                   IsLocked
   );
 
 //
@@ -260,5 +354,6 @@ CoreValidateHandle (
 extern EFI_LOCK         gProtocolDatabaseLock;
 extern LIST_ENTRY       gHandleList;
 extern UINT64           gHandleDatabaseKey;
+extern UINT64           gProtocolDatabaseGeneration;
 
 #endif
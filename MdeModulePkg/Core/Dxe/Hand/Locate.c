@@ -121,6 +121,7 @@ CoreLocateHandle (
   IHANDLE             *Handle;
   IHANDLE             **ResultBuffer;
   VOID                *Interface;
+  UINTN               Index;
 
   if (BufferSize == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -195,27 +196,38 @@ CoreLocateHandle (
   }
 
   ASSERT (GetNext != NULL);
-  //
-  // Enumerate out the matching handles
-  //
-  mEfiLocateHandleRequest += 1;
-  for (; ;) {
+  if (SearchType == ByProtocol) {
     //
-    // Get the next handle.  If no more handles, stop
+    // A protocol is installed at most once on a handle, so the handle array
+    // of the protocol entry is the result
     //
-    Handle = GetNext (&Position, &Interface);
-    if (NULL == Handle) {
-      break;
+    ResultSize = Position.ProtEntry->HandleCount * sizeof (EFI_HANDLE);
+    for (Index = 0; (Index < Position.ProtEntry->HandleCount) && ((Index + 1) * sizeof (EFI_HANDLE) <= *BufferSize); Index++) {
+      ResultBuffer[Index] = Position.ProtEntry->Handles[Index].Handle;
     }
-
+  } else {
     //
-    // Increase the resulting buffer size, and if this handle
-    // fits return it
+    // Enumerate out the matching handles
     //
-    ResultSize += sizeof(Handle);
-    if (ResultSize <= *BufferSize) {
-        *ResultBuffer = Handle;
-        ResultBuffer += 1;
+    mEfiLocateHandleRequest += 1;
+    for (; ;) {
+      //
+      // Get the next handle.  If no more handles, stop
+      //
+      Handle = GetNext (&Position, &Interface);
+      if (NULL == Handle) {
+        break;
+      }
+
+      //
+      // Increase the resulting buffer size, and if this handle
+      // fits return it
+      //
+      ResultSize += sizeof(Handle);
+      if (ResultSize <= *BufferSize) {
+          *ResultBuffer = Handle;
+          ResultBuffer += 1;
+      }
     }
   }
 
@@ -645,6 +657,7 @@ CoreLocateHandleBuffer (
 {
   EFI_STATUS          Status;
   UINTN               BufferSize;
+  UINT64              Generation;
 
   if (NumberHandles == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -657,6 +670,16 @@ CoreLocateHandleBuffer (
   BufferSize = 0;
   *NumberHandles = 0;
   *Buffer = NULL;
+
+  if (SearchType == ByProtocol) {
+    //
+    // The handle array of the protocol entry is a ready-made snapshot, so
+    // one copy is enough
+    //
+    Generation = 0;
+    return CoreLocateHandleBufferSince (Protocol, &Generation, NumberHandles, Buffer);
+  }
+
   Status = CoreLocateHandle (
              SearchType,
              Protocol,
@@ -700,3 +723,96 @@ CoreLocateHandleBuffer (
 
 
 
+/**
+  Function returns an array of the handles on which the requested protocol was
+  installed or reinstalled after a generation of the handle database, in a
+  buffer allocated from pool.
+
+  @param  Protocol               Provides the protocol to search by.
+  @param  Generation             On input, the generation returned by the
+                                 previous call, or 0 to return all the handles
+                                 that support Protocol.  On output, the current
+                                 generation.
+  @param  NumberHandles          The number of handles returned in Buffer.
+  @param  Buffer                 A pointer to the buffer to return the requested
+                                 array of  handles that support Protocol.
+
+  @retval EFI_SUCCESS            The result array of handles was returned.
+  @retval EFI_NOT_FOUND          No handles match the search.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough pool memory to store the
+                                 matching results.
+  @retval EFI_INVALID_PARAMETER  One or more parameters are not valid.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreLocateHandleBufferSince (
+  IN     EFI_GUID                 *Protocol,
+  IN OUT UINT64                   *Generation,
+  OUT    UINTN                    *NumberHandles,
+  OUT    EFI_HANDLE               **Buffer
+  )
+{
+  EFI_STATUS              Status;
+  PROTOCOL_ENTRY          *ProtEntry;
+  PROTOCOL_HANDLE_STAMP   *Stamps;
+  UINTN                   First;
+  UINTN                   Last;
+  UINTN                   Middle;
+  UINTN                   Index;
+
+  if ((Protocol == NULL) || (Generation == NULL) || (NumberHandles == NULL) || (Buffer == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  *NumberHandles = 0;
+  *Buffer = NULL;
+
+  CoreAcquireProtocolLock ();
+
+  Status    = EFI_NOT_FOUND;
+  ProtEntry = CoreFindProtocolEntry (Protocol, FALSE);
+  if (ProtEntry == NULL) {
+    goto Done;
+  }
+
+  //
+  // The generation stamps are in ascending order, so binary search for the
+  // first handle added after Generation
+  //
+  Stamps = ProtEntry->Handles;
+  First  = 0;
+  Last   = ProtEntry->HandleCount;
+  while (First < Last) {
+    Middle = First + (Last - First) / 2;
+    if (Stamps[Middle].Generation <= *Generation) {
+      First = Middle + 1;
+    } else {
+      Last = Middle;
+    }
+  }
+
+  if (First == ProtEntry->HandleCount) {
+    goto Done;
+  }
+
+  *Buffer = AllocatePool ((ProtEntry->HandleCount - First) * sizeof (EFI_HANDLE));
+  if (*Buffer == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Done;
+  }
+
+  for (Index = First; Index < ProtEntry->HandleCount; Index++) {
+    (*Buffer)[Index - First] = Stamps[Index].Handle;
+  }
+  *NumberHandles = ProtEntry->HandleCount - First;
+  Status = EFI_SUCCESS;
+
+Done:
+  if (Status != EFI_OUT_OF_RESOURCES) {
+    *Generation = gProtocolDatabaseGeneration;
+  }
+
+  CoreReleaseProtocolLock ();
+  return Status;
+}
@@ -11,8 +11,17 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "Handle.h"
 #include "Event.h"
 
+//
+// The open protocol notify batches
+//
+LIST_ENTRY                              mProtocolNotifyBatchOpenList = INITIALIZE_LIST_HEAD_VARIABLE (mProtocolNotifyBatchOpenList);
+
+EDKII_PROTOCOL_NOTIFY_BATCH_STATISTICS  mProtocolNotifyBatchStatistics;
+
 /**
-  Signal event for every protocol in protocol entry.
+  Signal event for every protocol in protocol entry.  While a protocol notify
+  batch covering the protocol is open, the notification is only counted, to
+  be made when the last such batch is closed.
 
   @param  ProtEntry              Protocol entry
 
@@ -27,10 +36,225 @@ CoreNotifyProtocolEntry (
 
   ASSERT_LOCKED (&gProtocolDatabaseLock);
 
+  if (ProtEntry->BatchOpenCount != 0) {
+    ProtEntry->BatchNotifyCount++;
+    return;
+  }
+
   for (Link=ProtEntry->Notify.ForwardLink; Link != &ProtEntry->Notify; Link=Link->ForwardLink) {
     ProtNotify = CR(Link, PROTOCOL_NOTIFY, Link, PROTOCOL_NOTIFY_SIGNATURE);
     CoreSignalEvent (ProtNotify->Event);
+    mProtocolNotifyBatchStatistics.SignalCount++;
+  }
+}
+
+
+/**
+  Make the notifications of a protocol deferred by the protocol notify
+  batches, once the last batch covering the protocol is closed.  Each event
+  registered for the protocol is signaled once.
+  The gProtocolDatabaseLock must be owned
+
+  @param  ProtEntry              Protocol entry
+
+**/
+STATIC
+VOID
+CoreNotifyProtocolEntryBatch (
+  IN PROTOCOL_ENTRY   *ProtEntry
+  )
+{
+  PROTOCOL_NOTIFY     *ProtNotify;
+  LIST_ENTRY          *Link;
+
+  for (Link=ProtEntry->Notify.ForwardLink; Link != &ProtEntry->Notify; Link=Link->ForwardLink) {
+    ProtNotify = CR(Link, PROTOCOL_NOTIFY, Link, PROTOCOL_NOTIFY_SIGNATURE);
+
+    //
+    // An event that is still signaled has not been notified yet, so it would
+    // have ignored the deferred signals, and signaling it now does nothing.
+    // Otherwise the first deferred signal is made now, and each one after it
+    // would have signaled the event again after its notification.  This also
+    // holds for an event registered for several protocols of the batches,
+    // which only the first of them signals.
+    //
+    if (((IEVENT *)ProtNotify->Event)->SignalCount == 0) {
+      CoreSignalEvent (ProtNotify->Event);
+      mProtocolNotifyBatchStatistics.SignalCount++;
+      mProtocolNotifyBatchStatistics.SavedSignalCount += ProtEntry->BatchNotifyCount - 1;
+    }
+  }
+
+  ProtEntry->BatchNotifyCount = 0;
+}
+
+
+/**
+  Open a batch of protocol notifications.  Until the batch is closed, the
+  events registered with RegisterProtocolNotify() for one of the protocols of
+  the batch are not signaled when an interface of the protocol is installed
+  or reinstalled.  While several batches covering a protocol are open, its
+  notifications are made when the last of them is closed.
+
+  @param  Protocols              The protocols whose notifications to defer.
+  @param  ProtocolCount          The number of protocols in Protocols.
+  @param  Token                  Returns the token identifying the batch.
+
+  @retval EFI_SUCCESS            The batch was opened.
+  @retval EFI_INVALID_PARAMETER  Protocols is NULL, or one of its entries is
+                                 NULL.
+  @retval EFI_INVALID_PARAMETER  ProtocolCount is 0.
+  @retval EFI_INVALID_PARAMETER  Token is NULL.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to open the batch.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreBeginProtocolNotifyBatch (
+  IN  EFI_GUID                           **Protocols,
+  IN  UINTN                              ProtocolCount,
+  OUT EDKII_PROTOCOL_NOTIFY_BATCH_TOKEN  *Token
+  )
+{
+  PROTOCOL_NOTIFY_BATCH  *Batch;
+  PROTOCOL_ENTRY         *ProtEntry;
+  UINTN                  Index;
+
+  if ((Protocols == NULL) || (ProtocolCount == 0) || (Token == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+  for (Index = 0; Index < ProtocolCount; Index++) {
+    if (Protocols[Index] == NULL) {
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  Batch = AllocatePool (sizeof (PROTOCOL_NOTIFY_BATCH) + ProtocolCount * sizeof (PROTOCOL_ENTRY *));
+  if (Batch == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Batch->Signature     = PROTOCOL_NOTIFY_BATCH_SIGNATURE;
+  Batch->ProtocolCount = ProtocolCount;
+  Batch->ProtEntries   = (PROTOCOL_ENTRY **)(Batch + 1);
+
+  CoreAcquireProtocolLock ();
+
+  for (Index = 0; Index < ProtocolCount; Index++) {
+    ProtEntry = CoreFindProtocolEntry (Protocols[Index], TRUE);
+    if (ProtEntry == NULL) {
+      //
+      // No notification was deferred while the lock is owned
+      //
+      while (Index > 0) {
+        Index--;
+        Batch->ProtEntries[Index]->BatchOpenCount--;
+      }
+      CoreReleaseProtocolLock ();
+      CoreFreePool (Batch);
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    ProtEntry->BatchOpenCount++;
+    Batch->ProtEntries[Index] = ProtEntry;
   }
+
+  InsertTailList (&mProtocolNotifyBatchOpenList, &Batch->Link);
+
+  CoreReleaseProtocolLock ();
+
+  *Token = Batch;
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Close a batch of protocol notifications opened with
+  CoreBeginProtocolNotifyBatch().  Each event registered for a protocol of
+  the batch that had interfaces installed or reinstalled during the batch is
+  signaled once, unless another open batch still covers the protocol.
+
+  @param  Token                  The token returned when the batch was opened.
+
+  @retval EFI_SUCCESS            The batch was closed.
+  @retval EFI_INVALID_PARAMETER  Token is not the token of an open batch.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreEndProtocolNotifyBatch (
+  IN EDKII_PROTOCOL_NOTIFY_BATCH_TOKEN  Token
+  )
+{
+  PROTOCOL_NOTIFY_BATCH  *Batch;
+  PROTOCOL_ENTRY         *ProtEntry;
+  LIST_ENTRY             *Link;
+  UINTN                  Index;
+
+  Batch = (PROTOCOL_NOTIFY_BATCH *)Token;
+  if (Batch == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CoreAcquireProtocolLock ();
+
+  //
+  // Only close a batch that is open, so that a caller cannot close the
+  // batches of others
+  //
+  for (Link = mProtocolNotifyBatchOpenList.ForwardLink; Link != &mProtocolNotifyBatchOpenList; Link = Link->ForwardLink) {
+    if (Link == &Batch->Link) {
+      break;
+    }
+  }
+  if (Link == &mProtocolNotifyBatchOpenList) {
+    CoreReleaseProtocolLock ();
+    return EFI_INVALID_PARAMETER;
+  }
+
+  RemoveEntryList (&Batch->Link);
+  Batch->Signature = 0;
+
+  for (Index = 0; Index < Batch->ProtocolCount; Index++) {
+    ProtEntry = Batch->ProtEntries[Index];
+    ProtEntry->BatchOpenCount--;
+    if ((ProtEntry->BatchOpenCount == 0) && (ProtEntry->BatchNotifyCount != 0)) {
+      CoreNotifyProtocolEntryBatch (ProtEntry);
+    }
+  }
+  mProtocolNotifyBatchStatistics.BatchCount++;
+
+  CoreReleaseProtocolLock ();
+
+  CoreFreePool (Batch);
+  return EFI_SUCCESS;
+}
+
+
+/**
+  Retrieve the statistics of the protocol notifications since the DXE Core
+  started.
+
+  @param  Statistics             The buffer to return the statistics in.
+
+  @retval EFI_SUCCESS            The statistics were returned.
+  @retval EFI_INVALID_PARAMETER  Statistics is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreGetProtocolNotifyBatchStatistics (
+  OUT EDKII_PROTOCOL_NOTIFY_BATCH_STATISTICS  *Statistics
+  )
+{
+  if (Statistics == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CoreAcquireProtocolLock ();
+  CopyMem (Statistics, &mProtocolNotifyBatchStatistics, sizeof (EDKII_PROTOCOL_NOTIFY_BATCH_STATISTICS));
+  CoreReleaseProtocolLock ();
+
+  return EFI_SUCCESS;
 }
 
 
@@ -79,6 +303,7 @@ CoreRemoveInterfaceFromProtocol (
     // Remove the protocol interface entry
     //
     RemoveEntryList (&Prot->ByProtocol);
+    CoreRemoveProtocolHandle (ProtEntry, Handle);
   }
 
   return Prot;
@@ -188,7 +413,7 @@ CoreReinstallProtocolInterface (
   PROTOCOL_INTERFACE        *Prot;
   PROTOCOL_ENTRY            *ProtEntry;
 
-  Status = CoreValidateHandle (UserHandle);
+  Status = CoreValidateHandle (UserHandle, FALSE);
   if (EFI_ERROR (Status)) {
     return Status;
   }
@@ -249,6 +474,7 @@ CoreReinstallProtocolInterface (
   // protocol entry
   //
   InsertTailList (&ProtEntry->Protocols, &Prot->ByProtocol);
+  CoreAddProtocolHandle (ProtEntry, Handle);
 
   //
   // Update the Key to show that the handle has been created/modified
@@ -1144,6 +1144,7 @@ CoreLoadImageCommon (
   UINTN                      FilePathSize;
   BOOLEAN                    ImageIsFromFv;
   BOOLEAN                    ImageIsFromLoadFile;
+  BOOLEAN                    ImageIsPrefetched;
 
   SecurityStatus = EFI_SUCCESS;
 
@@ -1173,6 +1174,7 @@ CoreLoadImageCommon (
   AuthenticationStatus = 0;
   ImageIsFromFv        = FALSE;
   ImageIsFromLoadFile  = FALSE;
+  ImageIsPrefetched    = FALSE;
 
   //
   // If the caller passed a copy of the file, then just use it
@@ -1221,18 +1223,26 @@ CoreLoadImageCommon (
     }
 
     //
-    // Get the source file buffer by its device path.
+    // Get the source file buffer by its device path, unless the DXE
+    // Dispatcher prefetched it.
     //
-    FHand.Source = GetFileBufferByFilePath (
-                      BootPolicy,
-                      FilePath,
-                      &FHand.SourceSize,
-                      &AuthenticationStatus
-                      );
+    FHand.Source = NULL;
+    if (ImageIsFromFv) {
+      FHand.Source = CoreGetPrefetchedImage (FilePath, &FHand.SourceSize, &AuthenticationStatus);
+      ImageIsPrefetched = (BOOLEAN) (FHand.Source != NULL);
+    }
+    if (FHand.Source == NULL) {
+      FHand.Source = GetFileBufferByFilePath (
+                        BootPolicy,
+                        FilePath,
+                        &FHand.SourceSize,
+                        &AuthenticationStatus
+                        );
+    }
     if (FHand.Source == NULL) {
       Status = EFI_NOT_FOUND;
     } else {
-      FHand.FreeBuffer = TRUE;
+      FHand.FreeBuffer = (BOOLEAN) !ImageIsPrefetched;
       if (ImageIsFromLoadFile) {
         //
         // LoadFile () may cause the device path of the Handle be updated.
@@ -1439,6 +1449,8 @@ Done:
   //
   if (FHand.FreeBuffer) {
     CoreFreePool (FHand.Source);
+  } else if (ImageIsPrefetched) {
+    CoreReleasePrefetchedImage (FHand.Source);
   }
   if (OriginalFilePath != InputFilePath) {
     CoreFreePool (OriginalFilePath);
@@ -30,6 +30,36 @@ UINTN     mMemoryMapKey = 0;
 
 #define MAX_MAP_DEPTH 6
 
+//
+// The memory map index is kept apart from the MEMORY_MAP descriptors, so that
+// they fill their descriptor pages exactly as without it.  Node N of the index
+// stands for mMapStack[N] below MAX_MAP_DEPTH, and for the entries of the
+// descriptor pages in the order they were allocated above it.  If more
+// descriptor pages are needed than the index can describe, it is dropped and
+// gMemoryMap is searched linearly.
+//
+#define MEMORY_MAP_INDEX_MAX_PAGES      64
+#define MEMORY_MAP_ENTRIES_PER_PAGE     (DEFAULT_PAGE_ALLOCATION_GRANULARITY / sizeof (MEMORY_MAP))
+#define MEMORY_MAP_INDEX_MAX_NODES      (MAX_MAP_DEPTH + MEMORY_MAP_INDEX_MAX_PAGES * MEMORY_MAP_ENTRIES_PER_PAGE)
+#define MEMORY_MAP_INDEX_NULL           MAX_UINT16
+
+STATIC_ASSERT (
+  MEMORY_MAP_INDEX_MAX_NODES < MEMORY_MAP_INDEX_NULL,
+  "The memory map index nodes must be numbered below MEMORY_MAP_INDEX_NULL"
+  );
+
+//
+// Node of the AVL tree indexing gMemoryMap by Start address.  MaxFreeBytes is
+// the size of the largest EfiConventionalMemory entry of the subtree.
+//
+typedef struct {
+  UINT16                Parent;
+  UINT16                Left;
+  UINT16                Right;
+  UINT16                Height;
+  UINT64                MaxFreeBytes;
+} MEMORY_MAP_INDEX_NODE;
+
 ///
 /// mMapDepth - depth of new descriptor stack
 ///
@@ -40,6 +70,17 @@ UINTN         mMapDepth = 0;
 MEMORY_MAP    mMapStack[MAX_MAP_DEPTH];
 UINTN         mFreeMapStack = 0;
 ///
+/// mMemoryMapIndex - nodes of the memory map index, and its root
+///
+MEMORY_MAP_INDEX_NODE  mMemoryMapIndex[MEMORY_MAP_INDEX_MAX_NODES];
+UINT16                 mMemoryMapRoot = MEMORY_MAP_INDEX_NULL;
+BOOLEAN                mMemoryMapIndexValid = TRUE;
+///
+/// mMemoryMapIndexPages - descriptor pages, in the order they were allocated
+///
+MEMORY_MAP    *mMemoryMapIndexPages[MEMORY_MAP_INDEX_MAX_PAGES];
+UINTN         mMemoryMapIndexPageCount = 0;
+///
 /// This list maintain the free memory map list
 ///
 LIST_ENTRY   mFreeMemoryMapEntryList = INITIALIZE_LIST_HEAD_VARIABLE (mFreeMemoryMapEntryList);
@@ -118,8 +159,490 @@ CoreReleaseMemoryLock (
   CoreReleaseLock (&gMemoryLock);
 }
 
+/**
+  Internal function.  Returns the descriptor entry of a memory map index node.
+
+  @param  Node                   The node number
+
+  @return The descriptor entry.
+
+**/
+STATIC
+MEMORY_MAP *
+MemoryMapIndexEntry (
+  IN UINT16              Node
+  )
+{
+  if (Node < MAX_MAP_DEPTH) {
+    return &mMapStack[Node];
+  }
+
+  Node -= MAX_MAP_DEPTH;
+  return &mMemoryMapIndexPages[Node / MEMORY_MAP_ENTRIES_PER_PAGE][Node % MEMORY_MAP_ENTRIES_PER_PAGE];
+}
+
+/**
+  Internal function.  Returns the memory map index node of a descriptor entry.
+
+  @param  Entry                  The descriptor entry, from mMapStack or from a
+                                 descriptor page
+
+  @return The node number.
+
+**/
+STATIC
+UINT16
+MemoryMapIndexNode (
+  IN MEMORY_MAP          *Entry
+  )
+{
+  UINTN             Page;
+
+  if (Entry >= mMapStack && Entry < mMapStack + MAX_MAP_DEPTH) {
+    return (UINT16)(Entry - mMapStack);
+  }
+
+  for (Page = mMemoryMapIndexPageCount; Page > 0; Page--) {
+    if (Entry >= mMemoryMapIndexPages[Page - 1] &&
+        Entry < mMemoryMapIndexPages[Page - 1] + MEMORY_MAP_ENTRIES_PER_PAGE) {
+      return (UINT16)(MAX_MAP_DEPTH + (Page - 1) * MEMORY_MAP_ENTRIES_PER_PAGE +
+                      (Entry - mMemoryMapIndexPages[Page - 1]));
+    }
+  }
+
+  ASSERT (FALSE);
+  return MEMORY_MAP_INDEX_NULL;
+}
+
+/**
+  Internal function.  Returns the height of a memory map index subtree.
+
+  @param  Node                   The root of the subtree, or MEMORY_MAP_INDEX_NULL
+
+  @return The height of the subtree, 0 if it is empty.
+
+**/
+STATIC
+UINT16
+MemoryMapIndexHeight (
+  IN UINT16              Node
+  )
+{
+  return (Node == MEMORY_MAP_INDEX_NULL) ? 0 : mMemoryMapIndex[Node].Height;
+}
+
+/**
+  Internal function.  Recomputes the height and the largest free range of a
+  memory map index node from its own range and from its children.
+
+  @param  Node                   The node to refresh
+
+**/
+STATIC
+VOID
+MemoryMapIndexRefresh (
+  IN UINT16              Node
+  )
+{
+  MEMORY_MAP_INDEX_NODE  *IndexNode;
+  MEMORY_MAP             *Entry;
+  UINT64                 MaxFreeBytes;
+
+  IndexNode = &mMemoryMapIndex[Node];
+  Entry     = MemoryMapIndexEntry (Node);
+
+  MaxFreeBytes = 0;
+  if (Entry->Type == EfiConventionalMemory) {
+    MaxFreeBytes = Entry->End - Entry->Start + 1;
+  }
+  if (IndexNode->Left != MEMORY_MAP_INDEX_NULL &&
+      mMemoryMapIndex[IndexNode->Left].MaxFreeBytes > MaxFreeBytes) {
+    MaxFreeBytes = mMemoryMapIndex[IndexNode->Left].MaxFreeBytes;
+  }
+  if (IndexNode->Right != MEMORY_MAP_INDEX_NULL &&
+      mMemoryMapIndex[IndexNode->Right].MaxFreeBytes > MaxFreeBytes) {
+    MaxFreeBytes = mMemoryMapIndex[IndexNode->Right].MaxFreeBytes;
+  }
+
+  IndexNode->MaxFreeBytes = MaxFreeBytes;
+  IndexNode->Height       = MAX (MemoryMapIndexHeight (IndexNode->Left), MemoryMapIndexHeight (IndexNode->Right)) + 1;
+}
+
+/**
+  Internal function.  Hooks a node into the memory map index in place of
+  one of the children of Parent.
+
+  @param  Parent                 The parent of OldChild, or MEMORY_MAP_INDEX_NULL
+                                 if OldChild is the root of the index
+  @param  OldChild               The node to unhook
+  @param  NewChild               The node to hook in its place, or
+                                 MEMORY_MAP_INDEX_NULL
+
+**/
+STATIC
+VOID
+MemoryMapIndexReplaceChild (
+  IN UINT16              Parent,
+  IN UINT16              OldChild,
+  IN UINT16              NewChild
+  )
+{
+  if (Parent == MEMORY_MAP_INDEX_NULL) {
+    mMemoryMapRoot = NewChild;
+  } else if (mMemoryMapIndex[Parent].Left == OldChild) {
+    mMemoryMapIndex[Parent].Left = NewChild;
+  } else {
+    mMemoryMapIndex[Parent].Right = NewChild;
+  }
+
+  if (NewChild != MEMORY_MAP_INDEX_NULL) {
+    mMemoryMapIndex[NewChild].Parent = Parent;
+  }
+}
+
+/**
+  Internal function.  Rotates a child of a memory map index node up into the
+  place of the node.
+
+  @param  Node                   The node to rotate down
+  @param  Child                  The left or right child of Node to rotate up
+
+**/
+STATIC
+VOID
+MemoryMapIndexRotate (
+  IN UINT16              Node,
+  IN UINT16              Child
+  )
+{
+  MEMORY_MAP_INDEX_NODE  *IndexNode;
+  MEMORY_MAP_INDEX_NODE  *IndexChild;
+
+  IndexNode  = &mMemoryMapIndex[Node];
+  IndexChild = &mMemoryMapIndex[Child];
+
+  MemoryMapIndexReplaceChild (IndexNode->Parent, Node, Child);
+
+  if (IndexNode->Left == Child) {
+    IndexNode->Left = IndexChild->Right;
+    if (IndexNode->Left != MEMORY_MAP_INDEX_NULL) {
+      mMemoryMapIndex[IndexNode->Left].Parent = Node;
+    }
+    IndexChild->Right = Node;
+  } else {
+    IndexNode->Right = IndexChild->Left;
+    if (IndexNode->Right != MEMORY_MAP_INDEX_NULL) {
+      mMemoryMapIndex[IndexNode->Right].Parent = Node;
+    }
+    IndexChild->Left = Node;
+  }
+  IndexNode->Parent = Child;
+
+  MemoryMapIndexRefresh (Node);
+  MemoryMapIndexRefresh (Child);
+}
+
+/**
+  Internal function.  Refreshes the memory map index from a node up to the
+  root, rebalancing it on the way.
+
+  @param  Node                   The lowest node to refresh, or
+                                 MEMORY_MAP_INDEX_NULL
+
+**/
+STATIC
+VOID
+MemoryMapIndexRebalance (
+  IN UINT16              Node
+  )
+{
+  MEMORY_MAP_INDEX_NODE  *IndexNode;
+  UINT16                 Child;
+
+  while (Node != MEMORY_MAP_INDEX_NULL) {
+    MemoryMapIndexRefresh (Node);
+
+    IndexNode = &mMemoryMapIndex[Node];
+    if (MemoryMapIndexHeight (IndexNode->Left) > MemoryMapIndexHeight (IndexNode->Right) + 1) {
+      Child = IndexNode->Left;
+      if (MemoryMapIndexHeight (mMemoryMapIndex[Child].Right) > MemoryMapIndexHeight (mMemoryMapIndex[Child].Left)) {
+        MemoryMapIndexRotate (Child, mMemoryMapIndex[Child].Right);
+        Child = IndexNode->Left;
+      }
+      MemoryMapIndexRotate (Node, Child);
+      Node = Child;
+    } else if (MemoryMapIndexHeight (IndexNode->Right) > MemoryMapIndexHeight (IndexNode->Left) + 1) {
+      Child = IndexNode->Right;
+      if (MemoryMapIndexHeight (mMemoryMapIndex[Child].Left) > MemoryMapIndexHeight (mMemoryMapIndex[Child].Right)) {
+        MemoryMapIndexRotate (Child, mMemoryMapIndex[Child].Left);
+        Child = IndexNode->Right;
+      }
+      MemoryMapIndexRotate (Node, Child);
+      Node = Child;
+    }
+
+    Node = mMemoryMapIndex[Node].Parent;
+  }
+}
+
+/**
+  Internal function.  Refreshes the memory map index after the range of a
+  descriptor entry in it changed.
+
+  @param  Entry                  The entry whose range changed
+
+**/
+STATIC
+VOID
+MemoryMapIndexUpdate (
+  IN MEMORY_MAP          *Entry
+  )
+{
+  if (mMemoryMapIndexValid) {
+    MemoryMapIndexRebalance (MemoryMapIndexNode (Entry));
+  }
+}
+
+/**
+  Internal function.  Adds a descriptor entry to the memory map index.
+
+  @param  Entry                  The entry to add
+
+**/
+STATIC
+VOID
+MemoryMapIndexInsert (
+  IN MEMORY_MAP          *Entry
+  )
+{
+  UINT16            Node;
+  UINT16            Parent;
+  UINT16            *Child;
+
+  if (!mMemoryMapIndexValid) {
+    return;
+  }
+
+  Node   = MemoryMapIndexNode (Entry);
+  Parent = MEMORY_MAP_INDEX_NULL;
+  Child  = &mMemoryMapRoot;
+  while (*Child != MEMORY_MAP_INDEX_NULL) {
+    Parent = *Child;
+    if (Entry->Start < MemoryMapIndexEntry (Parent)->Start) {
+      Child = &mMemoryMapIndex[Parent].Left;
+    } else {
+      Child = &mMemoryMapIndex[Parent].Right;
+    }
+  }
+
+  mMemoryMapIndex[Node].Parent = Parent;
+  mMemoryMapIndex[Node].Left   = MEMORY_MAP_INDEX_NULL;
+  mMemoryMapIndex[Node].Right  = MEMORY_MAP_INDEX_NULL;
+  *Child                       = Node;
+
+  MemoryMapIndexRebalance (Node);
+}
+
+/**
+  Internal function.  Removes a descriptor entry from the memory map index.
+  The range of the entry may already be empty.
+
+  @param  Entry                  The entry to remove
+
+**/
+STATIC
+VOID
+MemoryMapIndexRemove (
+  IN MEMORY_MAP          *Entry
+  )
+{
+  MEMORY_MAP_INDEX_NODE  *IndexNode;
+  UINT16                 Node;
+  UINT16                 Successor;
+  UINT16                 Lowest;
+
+  if (!mMemoryMapIndexValid) {
+    return;
+  }
+
+  Node      = MemoryMapIndexNode (Entry);
+  IndexNode = &mMemoryMapIndex[Node];
+  if (IndexNode->Left == MEMORY_MAP_INDEX_NULL || IndexNode->Right == MEMORY_MAP_INDEX_NULL) {
+    Lowest = IndexNode->Parent;
+    MemoryMapIndexReplaceChild (
+      IndexNode->Parent,
+      Node,
+      (IndexNode->Left != MEMORY_MAP_INDEX_NULL) ? IndexNode->Left : IndexNode->Right
+      );
+  } else {
+    //
+    // Move the in-order successor, which has no left child, in place of Node
+    //
+    Successor = IndexNode->Right;
+    while (mMemoryMapIndex[Successor].Left != MEMORY_MAP_INDEX_NULL) {
+      Successor = mMemoryMapIndex[Successor].Left;
+    }
+
+    if (mMemoryMapIndex[Successor].Parent == Node) {
+      Lowest = Successor;
+    } else {
+      Lowest = mMemoryMapIndex[Successor].Parent;
+      MemoryMapIndexReplaceChild (Lowest, Successor, mMemoryMapIndex[Successor].Right);
+      mMemoryMapIndex[Successor].Right = IndexNode->Right;
+      mMemoryMapIndex[IndexNode->Right].Parent = Successor;
+    }
+    mMemoryMapIndex[Successor].Left = IndexNode->Left;
+    mMemoryMapIndex[IndexNode->Left].Parent = Successor;
+    MemoryMapIndexReplaceChild (IndexNode->Parent, Node, Successor);
+  }
+
+  MemoryMapIndexRebalance (Lowest);
+}
+
+/**
+  Internal function.  Puts a copy of a descriptor entry in place of the entry
+  in the memory map index.
+
+  @param  Entry                  The entry to take out of the index
+  @param  NewEntry               The copy of Entry to put in the index
+
+**/
+STATIC
+VOID
+MemoryMapIndexReplace (
+  IN MEMORY_MAP          *Entry,
+  IN MEMORY_MAP          *NewEntry
+  )
+{
+  UINT16            Node;
+  UINT16            NewNode;
+
+  if (!mMemoryMapIndexValid) {
+    return;
+  }
+
+  Node    = MemoryMapIndexNode (Entry);
+  NewNode = MemoryMapIndexNode (NewEntry);
+
+  CopyMem (&mMemoryMapIndex[NewNode], &mMemoryMapIndex[Node], sizeof (MEMORY_MAP_INDEX_NODE));
+  MemoryMapIndexReplaceChild (mMemoryMapIndex[Node].Parent, Node, NewNode);
+  if (mMemoryMapIndex[NewNode].Left != MEMORY_MAP_INDEX_NULL) {
+    mMemoryMapIndex[mMemoryMapIndex[NewNode].Left].Parent = NewNode;
+  }
+  if (mMemoryMapIndex[NewNode].Right != MEMORY_MAP_INDEX_NULL) {
+    mMemoryMapIndex[mMemoryMapIndex[NewNode].Right].Parent = NewNode;
+  }
+}
+
+/**
+  Internal function.  Registers a new descriptor page with the memory map
+  index.  The index is dropped if it cannot describe the page.
+
+  @param  Page                   The descriptor page
+
+**/
+STATIC
+VOID
+MemoryMapIndexAddPage (
+  IN MEMORY_MAP          *Page
+  )
+{
+  if (!mMemoryMapIndexValid) {
+    return;
+  }
 
+  if (mMemoryMapIndexPageCount == MEMORY_MAP_INDEX_MAX_PAGES) {
+    DEBUG ((DEBUG_INFO, "Memory map index dropped after %d descriptor pages\n", MEMORY_MAP_INDEX_MAX_PAGES));
+    mMemoryMapIndexValid = FALSE;
+    mMemoryMapRoot       = MEMORY_MAP_INDEX_NULL;
+    return;
+  }
 
+  mMemoryMapIndexPages[mMemoryMapIndexPageCount] = Page;
+  mMemoryMapIndexPageCount += 1;
+}
+
+/**
+  Internal function.  Finds the descriptor entry that covers an address.
+
+  @param  Address                The address to look up
+
+  @return The entry whose range contains Address, or NULL if there is none.
+
+**/
+STATIC
+MEMORY_MAP *
+MemoryMapIndexLookup (
+  IN UINT64              Address
+  )
+{
+  LIST_ENTRY        *Link;
+  MEMORY_MAP        *Entry;
+  UINT16            Node;
+
+  if (!mMemoryMapIndexValid) {
+    for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
+      Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
+      if (Entry->Start <= Address && Entry->End >= Address) {
+        return Entry;
+      }
+    }
+    return NULL;
+  }
+
+  Entry = NULL;
+  Node  = mMemoryMapRoot;
+  while (Node != MEMORY_MAP_INDEX_NULL) {
+    if (MemoryMapIndexEntry (Node)->Start <= Address) {
+      Entry = MemoryMapIndexEntry (Node);
+      Node  = mMemoryMapIndex[Node].Right;
+    } else {
+      Node  = mMemoryMapIndex[Node].Left;
+    }
+  }
+
+  if (Entry == NULL || Entry->End < Address) {
+    return NULL;
+  }
+  return Entry;
+}
+
+/**
+  Internal function.  Returns the descriptor entry following an entry in
+  address order.  The memory map index must be valid.
+
+  @param  Entry                  The entry to start from
+
+  @return The entry with the next higher Start address, or NULL if Entry is
+          the highest one.
+
+**/
+STATIC
+MEMORY_MAP *
+MemoryMapIndexNext (
+  IN MEMORY_MAP          *Entry
+  )
+{
+  UINT16            Node;
+
+  Node = MemoryMapIndexNode (Entry);
+  if (mMemoryMapIndex[Node].Right != MEMORY_MAP_INDEX_NULL) {
+    Node = mMemoryMapIndex[Node].Right;
+    while (mMemoryMapIndex[Node].Left != MEMORY_MAP_INDEX_NULL) {
+      Node = mMemoryMapIndex[Node].Left;
+    }
+    return MemoryMapIndexEntry (Node);
+  }
+
+  while (mMemoryMapIndex[Node].Parent != MEMORY_MAP_INDEX_NULL &&
+         mMemoryMapIndex[mMemoryMapIndex[Node].Parent].Right == Node) {
+    Node = mMemoryMapIndex[Node].Parent;
+  }
+  if (mMemoryMapIndex[Node].Parent == MEMORY_MAP_INDEX_NULL) {
+    return NULL;
+  }
+  return MemoryMapIndexEntry (mMemoryMapIndex[Node].Parent);
+}
 
 /**
   Internal function.  Removes a descriptor entry.
@@ -134,6 +657,7 @@ RemoveMemoryMapEntry (
 {
   RemoveEntryList (&Entry->Link);
   Entry->Link.ForwardLink = NULL;
+  MemoryMapIndexRemove (Entry);
 
   if (Entry->FromPages) {
     //
@@ -163,7 +687,6 @@ CoreAddRange (
   IN UINT64                   Attribute
   )
 {
-  LIST_ENTRY        *Link;
   MEMORY_MAP        *Entry;
 
   ASSERT ((Start & EFI_PAGE_MASK) == 0);
@@ -212,25 +735,20 @@ CoreAddRange (
   // and the same Attribute
   //
 
-  Link = gMemoryMap.ForwardLink;
-  while (Link != &gMemoryMap) {
-    Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-    Link  = Link->ForwardLink;
-
-    if (Entry->Type != Type) {
-      continue;
-    }
-
-    if (Entry->Attribute != Attribute) {
-      continue;
-    }
-
-    if (Entry->End + 1 == Start) {
+  if (Start != 0) {
+    Entry = MemoryMapIndexLookup (Start - 1);
+    if (Entry != NULL && Entry->End + 1 == Start &&
+        Entry->Type == Type && Entry->Attribute == Attribute) {
 
       Start = Entry->Start;
       RemoveMemoryMapEntry (Entry);
+    }
+  }
 
-    } else if (Entry->Start == End + 1) {
+  if (End != MAX_UINT64) {
+    Entry = MemoryMapIndexLookup (End + 1);
+    if (Entry != NULL && Entry->Start == End + 1 &&
+        Entry->Type == Type && Entry->Attribute == Attribute) {
 
       End = Entry->End;
       RemoveMemoryMapEntry (Entry);
@@ -249,6 +767,7 @@ CoreAddRange (
   mMapStack[mMapDepth].VirtualStart  = 0;
   mMapStack[mMapDepth].Attribute     = Attribute;
   InsertTailList (&gMemoryMap, &mMapStack[mMapDepth].Link);
+  MemoryMapIndexInsert (&mMapStack[mMapDepth]);
 
   mMapDepth += 1;
   ASSERT (mMapDepth < MAX_MAP_DEPTH);
@@ -289,6 +808,7 @@ AllocateMemoryMapEntry (
                               FALSE
                               );
     if (FreeDescriptorEntries != NULL) {
+      MemoryMapIndexAddPage (FreeDescriptorEntries);
       //
       // Enque the free memmory map entries into the list
       //
@@ -361,14 +881,24 @@ CoreFreeMemoryMapStack (
 
       CopyMem (Entry , &mMapStack[mMapDepth], sizeof (MEMORY_MAP));
       Entry->FromPages = TRUE;
+      MemoryMapIndexReplace (&mMapStack[mMapDepth], Entry);
 
       //
-      // Find insertion location
+      // Find insertion location.  The entries from pages are kept sorted in
+      // gMemoryMap, so this is ahead of the next one in address order.
       //
-      for (Link2 = gMemoryMap.ForwardLink; Link2 != &gMemoryMap; Link2 = Link2->ForwardLink) {
-        Entry2 = CR (Link2, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-        if (Entry2->FromPages && Entry2->Start > Entry->Start) {
-          break;
+      if (mMemoryMapIndexValid) {
+        Entry2 = MemoryMapIndexNext (Entry);
+        while (Entry2 != NULL && !Entry2->FromPages) {
+          Entry2 = MemoryMapIndexNext (Entry2);
+        }
+        Link2 = (Entry2 != NULL) ? &Entry2->Link : &gMemoryMap;
+      } else {
+        for (Link2 = gMemoryMap.ForwardLink; Link2 != &gMemoryMap; Link2 = Link2->ForwardLink) {
+          Entry2 = CR (Link2, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
+          if (Entry2->FromPages && Entry2->Start > Entry->Start) {
+            break;
+          }
         }
       }
 
@@ -736,7 +1266,6 @@ CoreConvertPagesEx (
   UINT64          RangeEnd;
   UINT64          Attribute;
   EFI_MEMORY_TYPE MemType;
-  LIST_ENTRY      *Link;
   MEMORY_MAP      *Entry;
 
   Entry = NULL;
@@ -762,15 +1291,9 @@ CoreConvertPagesEx (
     //
     // Find the entry that the covers the range
     //
-    for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
-      Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-
-      if (Entry->Start <= Start && Entry->End > Start) {
-        break;
-      }
-    }
+    Entry = MemoryMapIndexLookup (Start);
 
-    if (Link == &gMemoryMap) {
+    if (Entry == NULL) {
       DEBUG ((DEBUG_ERROR | DEBUG_PAGE, "ConvertPages: failed to find range %lx - %lx\n", Start, End));
       return EFI_NOT_FOUND;
     }
@@ -852,6 +1375,7 @@ CoreConvertPagesEx (
       // Clip start
       //
       Entry->Start = RangeEnd + 1;
+      MemoryMapIndexUpdate (Entry);
 
     } else if (Entry->End == RangeEnd) {
 
@@ -859,6 +1383,7 @@ CoreConvertPagesEx (
       // Clip end
       //
       Entry->End = Start - 1;
+      MemoryMapIndexUpdate (Entry);
 
     } else {
 
@@ -882,9 +1407,11 @@ CoreConvertPagesEx (
 
       Entry->End = Start - 1;
       ASSERT (Entry->Start < Entry->End);
+      MemoryMapIndexUpdate (Entry);
 
       Entry = &mMapStack[mMapDepth];
       InsertTailList (&gMemoryMap, &Entry->Link);
+      MemoryMapIndexInsert (Entry);
 
       mMapDepth += 1;
       ASSERT (mMapDepth < MAX_MAP_DEPTH);
@@ -1008,6 +1535,171 @@ CoreUpdateMemoryAttributes (
 }
 
 
+/**
+  Internal function.  Finds the highest part of a descriptor entry that can
+  hold a free page range below the requested address.
+
+  @param  Entry                  The entry to check
+  @param  MaxAddress             The address that the range must be below
+  @param  MinAddress             The address that the range must be above
+  @param  NumberOfBytes          Number of bytes needed
+  @param  Alignment              Bits to align with
+  @param  NeedGuard              Flag to indicate Guard page is needed or not
+
+  @return The last address of the range, or 0 if the entry cannot hold it
+
+**/
+STATIC
+UINT64
+CoreFindFreePagesInEntry (
+  IN MEMORY_MAP       *Entry,
+  IN UINT64           MaxAddress,
+  IN UINT64           MinAddress,
+  IN UINT64           NumberOfBytes,
+  IN UINTN            Alignment,
+  IN BOOLEAN          NeedGuard
+  )
+{
+  UINT64          DescStart;
+  UINT64          DescEnd;
+  UINT64          DescNumberOfBytes;
+
+  //
+  // If it's not a free entry, don't bother with it
+  //
+  if (Entry->Type != EfiConventionalMemory) {
+    return 0;
+  }
+
+  DescStart = Entry->Start;
+  DescEnd = Entry->End;
+
+  //
+  // If desc is past max allowed address or below min allowed address, skip it
+  //
+  if ((DescStart >= MaxAddress) || (DescEnd < MinAddress)) {
+    return 0;
+  }
+
+  //
+  // If desc ends past max allowed address, clip the end
+  //
+  if (DescEnd >= MaxAddress) {
+    DescEnd = MaxAddress;
+  }
+
+  DescEnd = ((DescEnd + 1) & (~(Alignment - 1))) - 1;
+
+  // Skip if DescEnd is less than DescStart after alignment clipping
+  if (DescEnd < DescStart) {
+    return 0;
+  }
+
+  //
+  // Compute the number of bytes we can used from this
+  // descriptor, and see it's enough to satisfy the request
+  //
+  DescNumberOfBytes = DescEnd - DescStart + 1;
+
+  if (DescNumberOfBytes < NumberOfBytes) {
+    return 0;
+  }
+
+  //
+  // If the start of the allocated range is below the min address allowed, skip it
+  //
+  if ((DescEnd - NumberOfBytes + 1) < MinAddress) {
+    return 0;
+  }
+
+  if (NeedGuard) {
+    DescEnd = AdjustMemoryS (
+                DescEnd + 1 - DescNumberOfBytes,
+                DescNumberOfBytes,
+                NumberOfBytes
+                );
+  }
+
+  return DescEnd;
+}
+
+/**
+  Internal function.  Searches a subtree of the memory map index, from the
+  top down, for a consecutive free page range below the requested address.
+
+  As entries do not overlap, the first entry found that can hold the range
+  is also the one that holds it at the highest address.  Subtrees without a
+  large enough free entry are skipped, and so are subtrees entirely outside
+  of the allowed addresses.
+
+  @param  Node                   The root of the subtree to search
+  @param  MaxAddress             The address that the range must be below
+  @param  MinAddress             The address that the range must be above
+  @param  NumberOfBytes          Number of bytes needed
+  @param  Alignment              Bits to align with
+  @param  NeedGuard              Flag to indicate Guard page is needed or not
+
+  @return The last address of the range, or 0 if the range was not found
+
+**/
+STATIC
+UINT64
+CoreFindFreePagesInIndex (
+  IN UINT16           Node,
+  IN UINT64           MaxAddress,
+  IN UINT64           MinAddress,
+  IN UINT64           NumberOfBytes,
+  IN UINTN            Alignment,
+  IN BOOLEAN          NeedGuard
+  )
+{
+  UINT64          DescEnd;
+  MEMORY_MAP      *Entry;
+
+  while (Node != MEMORY_MAP_INDEX_NULL && mMemoryMapIndex[Node].MaxFreeBytes >= NumberOfBytes) {
+    //
+    // If Node starts past max allowed address, so does its right subtree
+    //
+    Entry = MemoryMapIndexEntry (Node);
+    if (Entry->Start < MaxAddress) {
+      DescEnd = CoreFindFreePagesInIndex (
+                  mMemoryMapIndex[Node].Right,
+                  MaxAddress,
+                  MinAddress,
+                  NumberOfBytes,
+                  Alignment,
+                  NeedGuard
+                  );
+      if (DescEnd != 0) {
+        return DescEnd;
+      }
+
+      DescEnd = CoreFindFreePagesInEntry (
+                  Entry,
+                  MaxAddress,
+                  MinAddress,
+                  NumberOfBytes,
+                  Alignment,
+                  NeedGuard
+                  );
+      if (DescEnd != 0) {
+        return DescEnd;
+      }
+    }
+
+    //
+    // The left subtree ends below Node, so it is below min allowed address
+    // if Node starts there
+    //
+    if (Entry->Start <= MinAddress) {
+      break;
+    }
+    Node = mMemoryMapIndex[Node].Left;
+  }
+
+  return 0;
+}
+
 /**
   Internal function. Finds a consecutive free page range below
   the requested address.
@@ -1035,11 +1727,8 @@ CoreFindFreePagesI (
 {
   UINT64          NumberOfBytes;
   UINT64          Target;
-  UINT64          DescStart;
   UINT64          DescEnd;
-  UINT64          DescNumberOfBytes;
   LIST_ENTRY      *Link;
-  MEMORY_MAP      *Entry;
 
   if ((MaxAddress < EFI_PAGE_MASK) ||(NumberOfPages == 0)) {
     return 0;
@@ -1068,71 +1757,30 @@ CoreFindFreePagesI (
   }
 
   NumberOfBytes = LShiftU64 (NumberOfPages, EFI_PAGE_SHIFT);
-  Target = 0;
-
-  for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
-    Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-
-    //
-    // If it's not a free entry, don't bother with it
-    //
-    if (Entry->Type != EfiConventionalMemory) {
-      continue;
-    }
-
-    DescStart = Entry->Start;
-    DescEnd = Entry->End;
-
-    //
-    // If desc is past max allowed address or below min allowed address, skip it
-    //
-    if ((DescStart >= MaxAddress) || (DescEnd < MinAddress)) {
-      continue;
-    }
-
-    //
-    // If desc ends past max allowed address, clip the end
-    //
-    if (DescEnd >= MaxAddress) {
-      DescEnd = MaxAddress;
-    }
-
-    DescEnd = ((DescEnd + 1) & (~(Alignment - 1))) - 1;
-
-    // Skip if DescEnd is less than DescStart after alignment clipping
-    if (DescEnd < DescStart) {
-      continue;
-    }
-
-    //
-    // Compute the number of bytes we can used from this
-    // descriptor, and see it's enough to satisfy the request
-    //
-    DescNumberOfBytes = DescEnd - DescStart + 1;
-
-    if (DescNumberOfBytes >= NumberOfBytes) {
-      //
-      // If the start of the allocated range is below the min address allowed, skip it
-      //
-      if ((DescEnd - NumberOfBytes + 1) < MinAddress) {
-        continue;
-      }
-
+  if (mMemoryMapIndexValid) {
+    Target = CoreFindFreePagesInIndex (
+               mMemoryMapRoot,
+               MaxAddress,
+               MinAddress,
+               NumberOfBytes,
+               Alignment,
+               NeedGuard
+               );
+  } else {
+    Target = 0;
+    for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
+      DescEnd = CoreFindFreePagesInEntry (
+                  CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE),
+                  MaxAddress,
+                  MinAddress,
+                  NumberOfBytes,
+                  Alignment,
+                  NeedGuard
+                  );
       //
       // If this is the best match so far remember it
       //
       if (DescEnd > Target) {
-        if (NeedGuard) {
-          DescEnd = AdjustMemoryS (
-                      DescEnd + 1 - DescNumberOfBytes,
-                      DescNumberOfBytes,
-                      NumberOfBytes
-                      );
-          if (DescEnd == 0) {
-            continue;
-          }
-        }
-
         Target = DescEnd;
       }
     }
@@ -1477,7 +2125,6 @@ CoreInternalFreePages (
   )
 {
   EFI_STATUS      Status;
-  LIST_ENTRY      *Link;
   MEMORY_MAP      *Entry;
   UINTN           Alignment;
   BOOLEAN         IsGuarded;
@@ -1491,14 +2138,8 @@ CoreInternalFreePages (
   // Find the entry that the covers the range
   //
   IsGuarded = FALSE;
-  Entry = NULL;
-  for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
-    Entry = CR(Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
-    if (Entry->Start <= Memory && Entry->End > Memory) {
-        break;
-    }
-  }
-  if (Link == &gMemoryMap) {
+  Entry = MemoryMapIndexLookup (Memory);
+  if (Entry == NULL) {
     Status = EFI_NOT_FOUND;
     goto Done;
   }
@@ -22,6 +22,7 @@ typedef struct {
 
 #define POOL_HEAD_SIGNATURE       SIGNATURE_32('p','h','d','0')
 #define POOLPAGE_HEAD_SIGNATURE   SIGNATURE_32('p','h','d','1')
+#define POOLSLAB_HEAD_SIGNATURE   SIGNATURE_32('p','h','d','2')
 typedef struct {
   UINT32          Signature;
   UINT32          Reserved;
@@ -60,6 +61,53 @@ STATIC CONST UINT16 mPoolSizeTable[] = {
 
 #define MAX_POOL_SIZE     (MAX_ADDRESS - POOL_OVERHEAD)
 
+//
+// A slab is one block of pool pages of the page allocation granularity of its
+// memory type, carved into equally sized blocks of one pool list.  The slab
+// header at the start of the pages keeps a list of the free blocks and a
+// bitmap of the blocks in use, so blocks are allocated and freed in constant
+// time, and the pages are given back once all the blocks are free.
+//
+#define POOL_SLAB_SIGNATURE   SIGNATURE_32('p','s','l','b')
+
+//
+// The smallest pool list size is 128 bytes
+//
+#define POOL_SLAB_MAX_BLOCKS  \
+  (MAX (DEFAULT_PAGE_ALLOCATION_GRANULARITY, RUNTIME_PAGE_ALLOCATION_GRANULARITY) / 128)
+
+#define POOL_SLAB_BITMAP_SIZE ((POOL_SLAB_MAX_BLOCKS + 31) / 32)
+
+//
+// Largest pool list served from slabs, as a fraction of the slab size.  Larger
+// blocks leave too much of a slab unused, and keep being carved off pages for
+// the free lists.
+//
+#define POOL_SLAB_MAX_BLOCK_SIZE(Granularity)  ((Granularity) / 4)
+
+//
+// Size of the empty slabs kept by a pool to absorb churn
+//
+#define POOL_SLAB_SPARE_SIZE  SIZE_128KB
+
+typedef struct _POOL_SLAB_FREE {
+  struct _POOL_SLAB_FREE  *Next;
+  UINTN                   Block;
+} POOL_SLAB_FREE;
+
+typedef struct {
+  UINT32          Signature;
+  UINT32          Index;
+  UINT32          Capacity;
+  UINT32          Used;
+  LIST_ENTRY      Link;
+  POOL_SLAB_FREE  *FreeBlocks;
+  UINT32          Bitmap[POOL_SLAB_BITMAP_SIZE];
+} POOL_SLAB;
+
+#define POOL_SLAB_CAPACITY(Granularity, Index)  \
+  (((Granularity) - sizeof (POOL_SLAB)) / LIST_TO_SIZE (Index))
+
 //
 // Globals
 //
@@ -71,6 +119,12 @@ typedef struct {
     EFI_MEMORY_TYPE  MemoryType;
     LIST_ENTRY       FreeList[MAX_POOL_LIST];
     LIST_ENTRY       Link;
+    //
+    // Slabs with free blocks, and empty slabs kept to absorb churn
+    //
+    LIST_ENTRY       SlabList[MAX_POOL_LIST];
+    LIST_ENTRY       SpareSlabs;
+    UINTN            SpareCount;
 } POOL;
 
 //
@@ -107,6 +161,36 @@ GetPoolIndexFromSize (
   return MAX_POOL_LIST;
 }
 
+/**
+  Check to see if pool of the given type should be allocated from slabs.
+
+  @param  MemoryType    Pool type to check.
+
+  @return TRUE  Small pool of the given type is allocated from slabs.
+  @return FALSE Pool of the given type is allocated from the free lists.
+
+**/
+STATIC
+BOOLEAN
+IsPoolTypeToSlab (
+  IN EFI_MEMORY_TYPE  MemoryType
+  )
+{
+  UINT64  TestBit;
+
+  if ((UINT32)MemoryType >= MEMORY_TYPE_OS_RESERVED_MIN) {
+    TestBit = BIT63;
+  } else if ((UINT32)MemoryType >= MEMORY_TYPE_OEM_RESERVED_MIN) {
+    TestBit = BIT62;
+  } else if (MemoryType < EfiMaxMemoryType) {
+    TestBit = LShiftU64 (1, MemoryType);
+  } else {
+    TestBit = 0;
+  }
+
+  return ((PcdGet64 (PcdPoolSlabType) & TestBit) != 0);
+}
+
 /**
   Called to initialize the pool.
 
@@ -123,8 +207,11 @@ CoreInitializePool (
     mPoolHead[Type].Signature  = 0;
     mPoolHead[Type].Used       = 0;
     mPoolHead[Type].MemoryType = (EFI_MEMORY_TYPE) Type;
+    mPoolHead[Type].SpareCount = 0;
+    InitializeListHead (&mPoolHead[Type].SpareSlabs);
     for (Index=0; Index < MAX_POOL_LIST; Index++) {
       InitializeListHead (&mPoolHead[Type].FreeList[Index]);
+      InitializeListHead (&mPoolHead[Type].SlabList[Index]);
     }
   }
 }
@@ -173,8 +260,11 @@ LookupPoolHead (
     Pool->Signature = POOL_SIGNATURE;
     Pool->Used      = 0;
     Pool->MemoryType = MemoryType;
+    Pool->SpareCount = 0;
+    InitializeListHead (&Pool->SpareSlabs);
     for (Index=0; Index < MAX_POOL_LIST; Index++) {
       InitializeListHead (&Pool->FreeList[Index]);
+      InitializeListHead (&Pool->SlabList[Index]);
     }
 
     InsertHeadList (&mPoolHeadList, &Pool->Link);
@@ -332,6 +422,85 @@ CoreAllocatePoolPagesI (
   return Buffer;
 }
 
+/**
+  Internal function.  Allocates a block of a pool list from the slabs of a
+  pool, getting a new slab when none of them has a free block.
+
+  @param  Pool                   The pool to allocate from
+  @param  Index                  The pool list of the block
+  @param  Granularity            The size of a slab
+
+  @return The allocated block, or NULL
+
+**/
+STATIC
+POOL_HEAD *
+CoreAllocatePoolSlab (
+  IN POOL     *Pool,
+  IN UINTN    Index,
+  IN UINTN    Granularity
+  )
+{
+  POOL_SLAB       *Slab;
+  POOL_SLAB_FREE  *Free;
+  UINTN           BlockSize;
+  UINTN           Block;
+
+  if (IsListEmpty (&Pool->SlabList[Index])) {
+    if (!IsListEmpty (&Pool->SpareSlabs)) {
+      Slab = CR (Pool->SpareSlabs.ForwardLink, POOL_SLAB, Link, POOL_SLAB_SIGNATURE);
+      RemoveEntryList (&Slab->Link);
+      Pool->SpareCount--;
+    } else {
+      Slab = CoreAllocatePoolPagesI (Pool->MemoryType, EFI_SIZE_TO_PAGES (Granularity),
+                                     Granularity, FALSE);
+      if (Slab == NULL) {
+        return NULL;
+      }
+    }
+
+    //
+    // Carve the slab into blocks, keeping the free list in address order
+    //
+    BlockSize        = LIST_TO_SIZE (Index);
+    Slab->Signature  = POOL_SLAB_SIGNATURE;
+    Slab->Index      = (UINT32)Index;
+    Slab->Capacity   = (UINT32)POOL_SLAB_CAPACITY (Granularity, Index);
+    Slab->Used       = 0;
+    Slab->FreeBlocks = NULL;
+    ZeroMem (Slab->Bitmap, sizeof (Slab->Bitmap));
+    ASSERT (Slab->Capacity <= POOL_SLAB_MAX_BLOCKS);
+
+    for (Block = Slab->Capacity; Block > 0; Block--) {
+      Free = (POOL_SLAB_FREE *)((UINT8 *)(Slab + 1) + (Block - 1) * BlockSize);
+      Free->Next       = Slab->FreeBlocks;
+      Free->Block      = Block - 1;
+      Slab->FreeBlocks = Free;
+    }
+
+    InsertHeadList (&Pool->SlabList[Index], &Slab->Link);
+  }
+
+  Slab = CR (Pool->SlabList[Index].ForwardLink, POOL_SLAB, Link, POOL_SLAB_SIGNATURE);
+
+  Free = Slab->FreeBlocks;
+  ASSERT (Free != NULL);
+  ASSERT (Free->Block < Slab->Capacity);
+  Slab->FreeBlocks = Free->Next;
+
+  Slab->Bitmap[Free->Block / 32] |= (UINT32)1 << (Free->Block % 32);
+  Slab->Used++;
+
+  //
+  // Full slabs are only found again through their blocks
+  //
+  if (Slab->Used == Slab->Capacity) {
+    RemoveEntryList (&Slab->Link);
+  }
+
+  return (POOL_HEAD *)Free;
+}
+
 /**
   Internal function to allocate pool of a particular type.
   Caller must have the memory lock held
@@ -363,6 +532,7 @@ CoreAllocatePoolI (
   UINTN       Granularity;
   BOOLEAN     HasPoolTail;
   BOOLEAN     PageAsPool;
+  BOOLEAN     IsSlab;
 
   ASSERT_LOCKED (&mPoolMemoryLock);
 
@@ -398,6 +568,7 @@ CoreAllocatePoolI (
     return NULL;
   }
   Head = NULL;
+  IsSlab = FALSE;
 
   //
   // If allocation is over max size, just allocate pages for the request
@@ -416,6 +587,20 @@ CoreAllocatePoolI (
     goto Done;
   }
 
+  //
+  // Small pool of the types selected by PcdPoolSlabType is served from slabs.
+  // The blocks carved off pages for the larger pool lists are used first, so
+  // they do not sit on the free lists of the pool lists served from slabs.
+  //
+  if (IsPoolTypeToSlab (PoolType) &&
+      (LIST_TO_SIZE (Index) <= POOL_SLAB_MAX_BLOCK_SIZE (Granularity)) &&
+      IsListEmpty (&Pool->FreeList[Index])) {
+    ASSERT (POOL_SLAB_CAPACITY (Granularity, Index) > 0);
+    Head = CoreAllocatePoolSlab (Pool, Index, Granularity);
+    IsSlab = TRUE;
+    goto Done;
+  }
+
   //
   // If there's no free pool in the proper list size, go get some more pages
   //
@@ -495,7 +680,13 @@ Done:
     //
     // If we have a pool buffer, fill in the header & tail info
     //
-    Head->Signature = (PageAsPool) ? POOLPAGE_HEAD_SIGNATURE : POOL_HEAD_SIGNATURE;
+    if (PageAsPool) {
+      Head->Signature = POOLPAGE_HEAD_SIGNATURE;
+    } else if (IsSlab) {
+      Head->Signature = POOLSLAB_HEAD_SIGNATURE;
+    } else {
+      Head->Signature = POOL_HEAD_SIGNATURE;
+    }
     Head->Size      = Size;
     Head->Type      = (EFI_MEMORY_TYPE) PoolType;
     Buffer          = Head->Data;
@@ -653,6 +844,65 @@ CoreFreePoolPagesWithGuard (
   }
 }
 
+/**
+  Internal function.  Frees a block allocated via CoreAllocatePoolSlab(),
+  giving the slab back to free memory once all its blocks are free.
+
+  @param  Pool                   The pool the block was allocated from
+  @param  Head                   The block to free
+  @param  Granularity            The size of a slab
+
+**/
+STATIC
+VOID
+CoreFreePoolSlab (
+  IN POOL       *Pool,
+  IN POOL_HEAD  *Head,
+  IN UINTN      Granularity
+  )
+{
+  POOL_SLAB       *Slab;
+  POOL_SLAB_FREE  *Free;
+  UINTN           Block;
+  UINT32          Mask;
+
+  Slab = (POOL_SLAB *)((UINTN)Head & ~(Granularity - 1));
+  ASSERT (Slab->Signature == POOL_SLAB_SIGNATURE);
+
+  Block = ((UINTN)Head - (UINTN)(Slab + 1)) / LIST_TO_SIZE (Slab->Index);
+  Mask  = (UINT32)1 << (Block % 32);
+  ASSERT (Block < Slab->Capacity);
+  ASSERT ((Slab->Bitmap[Block / 32] & Mask) != 0);
+
+  Slab->Bitmap[Block / 32] &= ~Mask;
+
+  Free             = (POOL_SLAB_FREE *)Head;
+  Free->Next       = Slab->FreeBlocks;
+  Free->Block      = Block;
+  Slab->FreeBlocks = Free;
+
+  //
+  // A slab that was full has the fewest free blocks, so serve it first to let
+  // the other slabs drain
+  //
+  if (Slab->Used == Slab->Capacity) {
+    InsertHeadList (&Pool->SlabList[Slab->Index], &Slab->Link);
+  }
+  Slab->Used--;
+
+  if (Slab->Used == 0) {
+    RemoveEntryList (&Slab->Link);
+    if (Pool->SpareCount < POOL_SLAB_SPARE_SIZE / Granularity) {
+      InsertHeadList (&Pool->SpareSlabs, &Slab->Link);
+      Pool->SpareCount++;
+    } else {
+      Slab->Signature = 0;
+      CoreFreePoolPagesI (Pool->MemoryType, (EFI_PHYSICAL_ADDRESS)(UINTN)Slab,
+        EFI_SIZE_TO_PAGES (Granularity));
+    }
+  }
+}
+
 /**
   Internal function to free a pool entry.
   Caller must have the memory lock held
@@ -684,6 +934,8 @@ CoreFreePoolI (
   BOOLEAN     IsGuarded;
   BOOLEAN     HasPoolTail;
   BOOLEAN     PageAsPool;
+  BOOLEAN     IsSlab;
+  POOL_SLAB   *Slab;
 
   ASSERT(Buffer != NULL);
   //
@@ -693,9 +945,11 @@ CoreFreePoolI (
   ASSERT(Head != NULL);
 
   if (Head->Signature != POOL_HEAD_SIGNATURE &&
-      Head->Signature != POOLPAGE_HEAD_SIGNATURE) {
+      Head->Signature != POOLPAGE_HEAD_SIGNATURE &&
+      Head->Signature != POOLSLAB_HEAD_SIGNATURE) {
     ASSERT (Head->Signature == POOL_HEAD_SIGNATURE ||
-            Head->Signature == POOLPAGE_HEAD_SIGNATURE);
+            Head->Signature == POOLPAGE_HEAD_SIGNATURE ||
+            Head->Signature == POOLSLAB_HEAD_SIGNATURE);
     return EFI_INVALID_PARAMETER;
   }
 
@@ -704,6 +958,7 @@ CoreFreePoolI (
   HasPoolTail = !(IsGuarded &&
                   ((PcdGet8 (PcdHeapGuardPropertyMask) & BIT7) == 0));
   PageAsPool = (Head->Signature == POOLPAGE_HEAD_SIGNATURE);
+  IsSlab     = (Head->Signature == POOLSLAB_HEAD_SIGNATURE);
 
   if (HasPoolTail) {
     Tail = HEAD_TO_TAIL (Head);
@@ -782,6 +1037,10 @@ CoreFreePoolI (
         );
     }
 
+  } else if (IsSlab) {
+
+    CoreFreePoolSlab (Pool, Head, Granularity);
+
   } else {
 
     //
@@ -848,6 +1107,13 @@ CoreFreePoolI (
   // list entry for that memory type
   //
   if (((UINT32) Pool->MemoryType >= MEMORY_TYPE_OEM_RESERVED_MIN) && Pool->Used == 0) {
+    while (!IsListEmpty (&Pool->SpareSlabs)) {
+      Slab = CR (Pool->SpareSlabs.ForwardLink, POOL_SLAB, Link, POOL_SLAB_SIGNATURE);
+      RemoveEntryList (&Slab->Link);
+      Slab->Signature = 0;
+      CoreFreePoolPagesI (Pool->MemoryType, (EFI_PHYSICAL_ADDRESS)(UINTN)Slab,
+        EFI_SIZE_TO_PAGES (Granularity));
+    }
     RemoveEntryList (&Pool->Link);
     CoreFreePoolI (Pool, NULL);
   }
@@ -1145,6 +1145,118 @@ FindStreamNode (
 }
 
 
+/**
+  Worker function.  Locates the requested section of a section stream, and
+  returns where its data is in the stream database.  The TPL must be raised to
+  TPL_NOTIFY.
+
+  @param  SectionStreamHandle   The section stream from which to extract the
+                                requested section.
+  @param  SectionType           A pointer to the type of section to search for,
+                                or NULL for the whole section stream.
+  @param  SectionDefinitionGuid If the section type is EFI_SECTION_GUID_DEFINED,
+                                then SectionDefinitionGuid indicates which of
+                                these types of sections to search for.
+  @param  SectionInstance       Indicates which instance of the requested
+                                section to return.
+  @param  SectionData           The data of the section, in the stream database.
+  @param  SectionSize           The size of the data of the section.
+  @param  AuthenticationStatus  The authentication status of the section.
+  @param  IsFfs3Fv              Indicates the FV format.
+
+  @retval EFI_SUCCESS           Section was located successfully
+  @retval EFI_PROTOCOL_ERROR    A GUID defined section was encountered in the
+                                section stream with its
+                                EFI_GUIDED_SECTION_PROCESSING_REQUIRED bit set,
+                                but there was no corresponding GUIDed Section
+                                Extraction Protocol in the handle database.
+  @retval EFI_NOT_FOUND         The requested section does not exist, or the
+                                SectionStream is not correctly formatted.
+  @retval EFI_OUT_OF_RESOURCES  The system has insufficient resources to process
+                                the request.
+  @retval EFI_INVALID_PARAMETER The SectionStreamHandle does not exist.
+
+**/
+EFI_STATUS
+LocateSection (
+  IN  UINTN                                             SectionStreamHandle,
+  IN  EFI_SECTION_TYPE                                  *SectionType,
+  IN  EFI_GUID                                          *SectionDefinitionGuid,
+  IN  UINTN                                             SectionInstance,
+  OUT UINT8                                             **SectionData,
+  OUT UINTN                                             *SectionSize,
+  OUT UINT32                                            *AuthenticationStatus,
+  IN  BOOLEAN                                           IsFfs3Fv
+  )
+{
+  CORE_SECTION_STREAM_NODE                              *StreamNode;
+  EFI_STATUS                                            Status;
+  CORE_SECTION_CHILD_NODE                               *ChildNode;
+  CORE_SECTION_STREAM_NODE                              *ChildStreamNode;
+  UINT32                                                ExtractedAuthenticationStatus;
+  UINTN                                                 Instance;
+  EFI_COMMON_SECTION_HEADER                             *Section;
+
+  ChildStreamNode = NULL;
+  Instance = SectionInstance + 1;
+
+  //
+  // Locate target stream
+  //
+  Status = FindStreamNode (SectionStreamHandle, &StreamNode);
+  if (EFI_ERROR (Status)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  //
+  // Found the stream, now locate and return the appropriate section
+  //
+  if (SectionType == NULL) {
+    //
+    // SectionType == NULL means return the WHOLE section stream...
+    //
+    *SectionSize = StreamNode->StreamLength;
+    *SectionData = StreamNode->StreamBuffer;
+    *AuthenticationStatus = StreamNode->AuthenticationStatus;
+    return EFI_SUCCESS;
+  }
+
+  //
+  // There's a requested section type, so go find it and return it...
+  //
+  Status = FindChildNode (
+             StreamNode,
+             *SectionType,
+             &Instance,
+             SectionDefinitionGuid,
+             &ChildNode,
+             &ChildStreamNode,
+             &ExtractedAuthenticationStatus
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Section = (EFI_COMMON_SECTION_HEADER *) (ChildStreamNode->StreamBuffer + ChildNode->OffsetInStream);
+
+  if (IS_SECTION2 (Section)) {
+    ASSERT (SECTION2_SIZE (Section) > 0x00FFFFFF);
+    if (!IsFfs3Fv) {
+      DEBUG ((DEBUG_ERROR, "It is a FFS3 formatted section in a non-FFS3 formatted FV.\n"));
+      return EFI_NOT_FOUND;
+    }
+    *SectionSize = SECTION2_SIZE (Section) - sizeof (EFI_COMMON_SECTION_HEADER2);
+    *SectionData = (UINT8 *) Section + sizeof (EFI_COMMON_SECTION_HEADER2);
+  } else {
+    *SectionSize = SECTION_SIZE (Section) - sizeof (EFI_COMMON_SECTION_HEADER);
+    *SectionData = (UINT8 *) Section + sizeof (EFI_COMMON_SECTION_HEADER);
+  }
+  *AuthenticationStatus = ExtractedAuthenticationStatus;
+
+  return EFI_SUCCESS;
+}
+
+
 /**
   SEP member function.  Retrieves requested section from section stream.
 
@@ -1216,77 +1328,29 @@ GetSection (
   IN BOOLEAN                                            IsFfs3Fv
   )
 {
-  CORE_SECTION_STREAM_NODE                              *StreamNode;
   EFI_TPL                                               OldTpl;
   EFI_STATUS                                            Status;
-  CORE_SECTION_CHILD_NODE                               *ChildNode;
-  CORE_SECTION_STREAM_NODE                              *ChildStreamNode;
   UINTN                                                 CopySize;
-  UINT32                                                ExtractedAuthenticationStatus;
-  UINTN                                                 Instance;
   UINT8                                                 *CopyBuffer;
   UINTN                                                 SectionSize;
-  EFI_COMMON_SECTION_HEADER                             *Section;
 
 
-  ChildStreamNode = NULL;
   OldTpl = CoreRaiseTpl (TPL_NOTIFY);
-  Instance = SectionInstance + 1;
 
-  //
-  // Locate target stream
-  //
-  Status = FindStreamNode (SectionStreamHandle, &StreamNode);
+  Status = LocateSection (
+             SectionStreamHandle,
+             SectionType,
+             SectionDefinitionGuid,
+             SectionInstance,
+             &CopyBuffer,
+             &CopySize,
+             AuthenticationStatus,
+             IsFfs3Fv
+             );
   if (EFI_ERROR (Status)) {
-    Status = EFI_INVALID_PARAMETER;
     goto GetSection_Done;
   }
 
-  //
-  // Found the stream, now locate and return the appropriate section
-  //
-  if (SectionType == NULL) {
-    //
-    // SectionType == NULL means return the WHOLE section stream...
-    //
-    CopySize = StreamNode->StreamLength;
-    CopyBuffer = StreamNode->StreamBuffer;
-    *AuthenticationStatus = StreamNode->AuthenticationStatus;
-  } else {
-    //
-    // There's a requested section type, so go find it and return it...
-    //
-    Status = FindChildNode (
-               StreamNode,
-               *SectionType,
-               &Instance,
-               SectionDefinitionGuid,
-               &ChildNode,
-               &ChildStreamNode,
-               &ExtractedAuthenticationStatus
-               );
-    if (EFI_ERROR (Status)) {
-      goto GetSection_Done;
-    }
-
-    Section = (EFI_COMMON_SECTION_HEADER *) (ChildStreamNode->StreamBuffer + ChildNode->OffsetInStream);
-
-    if (IS_SECTION2 (Section)) {
-      ASSERT (SECTION2_SIZE (Section) > 0x00FFFFFF);
-      if (!IsFfs3Fv) {
-        DEBUG ((DEBUG_ERROR, "It is a FFS3 formatted section in a non-FFS3 formatted FV.\n"));
-        Status = EFI_NOT_FOUND;
-        goto GetSection_Done;
-      }
-      CopySize = SECTION2_SIZE (Section) - sizeof (EFI_COMMON_SECTION_HEADER2);
-      CopyBuffer = (UINT8 *) Section + sizeof (EFI_COMMON_SECTION_HEADER2);
-    } else {
-      CopySize = SECTION_SIZE (Section) - sizeof (EFI_COMMON_SECTION_HEADER);
-      CopyBuffer = (UINT8 *) Section + sizeof (EFI_COMMON_SECTION_HEADER);
-    }
-    *AuthenticationStatus = ExtractedAuthenticationStatus;
-  }
-
   SectionSize = CopySize;
   if (*Buffer != NULL) {
     //
@@ -1316,6 +1380,144 @@ GetSection_Done:
 }
 
 
+/**
+  Retrieves requested section from section stream without copying it.  The
+  section data returned is in the stream database, and is valid until the
+  section stream is closed.
+
+  @param  SectionStreamHandle   The section stream from which to extract the
+                                requested section.
+  @param  SectionType           A pointer to the type of section to search for,
+                                or NULL for the whole section stream.
+  @param  SectionDefinitionGuid If the section type is EFI_SECTION_GUID_DEFINED,
+                                then SectionDefinitionGuid indicates which of
+                                these types of sections to search for.
+  @param  SectionInstance       Indicates which instance of the requested
+                                section to return.
+  @param  Buffer                The data of the section.
+  @param  BufferSize            The size of the data of the section.
+  @param  AuthenticationStatus  The authentication status of the section, as
+                                GetSection() returns it.
+  @param  IsFfs3Fv              Indicates the FV format.
+
+  @retval EFI_SUCCESS           Section was retrieved successfully
+  @retval EFI_PROTOCOL_ERROR    A GUID defined section was encountered in the
+                                section stream with its
+                                EFI_GUIDED_SECTION_PROCESSING_REQUIRED bit set,
+                                but there was no corresponding GUIDed Section
+                                Extraction Protocol in the handle database.
+  @retval EFI_NOT_FOUND         The requested section does not exist, or the
+                                SectionStream is not correctly formatted.
+  @retval EFI_OUT_OF_RESOURCES  The system has insufficient resources to process
+                                the request.
+  @retval EFI_INVALID_PARAMETER The SectionStreamHandle does not exist.
+
+**/
+EFI_STATUS
+GetSectionInPlace (
+  IN  UINTN                                             SectionStreamHandle,
+  IN  EFI_SECTION_TYPE                                  *SectionType,
+  IN  EFI_GUID                                          *SectionDefinitionGuid,
+  IN  UINTN                                             SectionInstance,
+  OUT CONST VOID                                        **Buffer,
+  OUT UINTN                                             *BufferSize,
+  OUT UINT32                                            *AuthenticationStatus,
+  IN  BOOLEAN                                           IsFfs3Fv
+  )
+{
+  EFI_TPL                                               OldTpl;
+  EFI_STATUS                                            Status;
+  UINT8                                                 *SectionData;
+
+  OldTpl = CoreRaiseTpl (TPL_NOTIFY);
+  Status = LocateSection (
+             SectionStreamHandle,
+             SectionType,
+             SectionDefinitionGuid,
+             SectionInstance,
+             &SectionData,
+             BufferSize,
+             AuthenticationStatus,
+             IsFfs3Fv
+             );
+  CoreRestoreTpl (OldTpl);
+
+  if (!EFI_ERROR (Status)) {
+    *Buffer = SectionData;
+  }
+  return Status;
+}
+
+
+/**
+  Worker function.  Adds up the sizes of the streams that were extracted from
+  the encapsulation sections of a stream, and from theirs.  Each extracted
+  stream has its own buffer, freed with its child node, and is counted once
+  through that child node.
+
+  @param  StreamNode             The stream.
+
+  @return The size of the extracted streams, in bytes.
+
+**/
+UINTN
+ExtractedStreamSize (
+  IN  CORE_SECTION_STREAM_NODE                  *StreamNode
+  )
+{
+  LIST_ENTRY                                    *Link;
+  CORE_SECTION_CHILD_NODE                       *ChildNode;
+  CORE_SECTION_STREAM_NODE                      *ChildStreamNode;
+  UINTN                                         Size;
+
+  Size = 0;
+  for (Link = GetFirstNode (&StreamNode->Children);
+       !IsNull (&StreamNode->Children, Link);
+       Link = GetNextNode (&StreamNode->Children, Link)) {
+    ChildNode = CHILD_SECTION_NODE_FROM_LINK (Link);
+    if (ChildNode->EncapsulatedStreamHandle != NULL_STREAM_HANDLE) {
+      ChildStreamNode = (CORE_SECTION_STREAM_NODE *) ChildNode->EncapsulatedStreamHandle;
+      Size += ChildStreamNode->StreamLength + ExtractedStreamSize (ChildStreamNode);
+    }
+  }
+
+  return Size;
+}
+
+
+/**
+  Returns the memory that the section stream database holds for a section
+  stream, that is the size of the streams extracted from its encapsulation
+  sections so far.  They are freed when the stream is closed.  The buffer of
+  the stream itself is not counted: OpenSectionStream() uses it in place, and
+  the caller owns it.
+
+  @param  SectionStreamHandle    The section stream.
+
+  @return The size of the extracted streams, in bytes, or 0 if the section
+          stream does not exist.
+
+**/
+UINTN
+GetSectionStreamSize (
+  IN  UINTN                                     SectionStreamHandle
+  )
+{
+  CORE_SECTION_STREAM_NODE                      *StreamNode;
+  EFI_TPL                                       OldTpl;
+  UINTN                                         Size;
+
+  Size = 0;
+  OldTpl = CoreRaiseTpl (TPL_NOTIFY);
+  if (!EFI_ERROR (FindStreamNode (SectionStreamHandle, &StreamNode))) {
+    Size = ExtractedStreamSize (StreamNode);
+  }
+  CoreRestoreTpl (OldTpl);
+
+  return Size;
+}
+
+
 /**
   Worker function.  Destructor for child nodes.
 
@@ -0,0 +1,702 @@
+/** @file
+  Host based unit tests of the DXE Dispatcher.
+
+  The dependency expressions of drivers are evaluated as the protocols they
+  wait for are installed, and are expected to be marked for evaluation again
+  only when one of these protocols is installed.
+
+  The image prefetch is run over a scheduled queue of drivers in a stand-in
+  firmware volume whose images are stored in all the ways the prefetch must
+  recognize, and the images it returns are compared with the PE32 sections
+  of the drivers.  The stand-in application processors run either after or
+  before the boot processor takes the image it loads.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "DxeMain.h"
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME        "DXE Core Dispatcher Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Key of the stand-in decompression, and number of stand-in application
+// processors
+//
+#define STUB_DECOMPRESS_KEY       0x5A
+#define STUB_AP_COUNT             3
+
+//
+// Number of driver images prefetched at a time, as set for this test in
+// MdeModulePkgHostTest.dsc
+//
+#define PREFETCH_TEST_COUNT       4
+
+//
+// Authentication status of the stand-in firmware volume
+//
+#define PREFETCH_TEST_FV_AUTHENTICATION_STATUS  EFI_AUTH_STATUS_IMAGE_SIGNED
+
+//
+// Maximum size of a driver file and of a PE32 image
+//
+#define PREFETCH_TEST_FILE_SIZE   1024
+#define PREFETCH_TEST_IMAGE_SIZE  256
+
+///
+/// The ways the PE32 image of a driver is stored in its file.
+///
+typedef enum {
+  PrefetchTestPe32,
+  PrefetchTestLzma,
+  PrefetchTestCompression,
+  PrefetchTestUnknownGuid,
+  PrefetchTestNestedCompression,
+  PrefetchTestLzmaAfterLargeSection,
+  PrefetchTestLzmaAuthenticated
+} PREFETCH_TEST_STORAGE;
+
+///
+/// A driver of the stand-in firmware volume.
+///
+typedef struct {
+  PREFETCH_TEST_STORAGE     Storage;
+  BOOLEAN                   Prefetched;
+  EFI_CORE_DRIVER_ENTRY     DriverEntry;
+  EFI_DEVICE_PATH_PROTOCOL  FilePath;
+  UINT8                     Image[PREFETCH_TEST_IMAGE_SIZE];
+  UINTN                     ImageSize;
+  UINT8                     File[PREFETCH_TEST_FILE_SIZE];
+  UINTN                     FileSize;
+} PREFETCH_TEST_DRIVER;
+
+extern UINTN    mStubStartupAllApsCount;
+extern UINTN    mStubApProcedureCount;
+
+//
+// Prefetch jobs of Prefetch.c, whose type is private to it
+//
+extern VOID     *mImagePrefetchJobs;
+
+VOID
+StubInstallProtocol (
+  IN CONST EFI_GUID  *Protocol
+  );
+
+VOID
+StubRunAps (
+  VOID
+  );
+
+///
+/// A dependency expression pushing two protocols.
+///
+#pragma pack(1)
+typedef struct {
+  UINT8     Push1;
+  EFI_GUID  Protocol1;
+  UINT8     Push2;
+  EFI_GUID  Protocol2;
+  UINT8     And;
+  UINT8     End;
+} DEPEX_TEST_AND;
+#pragma pack()
+
+//
+// Protocols the dependency expressions wait for.  The last one lands in the
+// same bucket of the index of the waiters as the first one.
+//
+EFI_GUID  mDepexTestProtocols[] = {
+  { 0x1c5e7a20, 0x3f41, 0x4b9d, { 0x8a, 0x06, 0x52, 0xe1, 0x7c, 0x9b, 0x30, 0x4f } },
+  { 0x6b2d9f13, 0x84a7, 0x4e50, { 0x91, 0xcc, 0x0d, 0x3e, 0x68, 0xa2, 0x57, 0xb1 } },
+  { 0xa04f6c88, 0x27d1, 0x4c3a, { 0xb5, 0x7e, 0xf2, 0x19, 0x4d, 0x86, 0xe0, 0x2c } },
+  { 0x1c5e7a20, 0x3f41, 0x4b9d, { 0x8a, 0x06, 0x52, 0xe1, 0x7c, 0x9b, 0x30, 0x50 } }
+};
+
+//
+// Scheduled queue of the DXE Dispatcher
+//
+LIST_ENTRY  mScheduledQueue = INITIALIZE_LIST_HEAD_VARIABLE (mScheduledQueue);
+
+//
+// Drivers of the stand-in firmware volume, in dispatch order, and whether the
+// prefetch is expected to return their image
+//
+PREFETCH_TEST_DRIVER  mPrefetchTestDrivers[] = {
+  { PrefetchTestLzma,                  TRUE  },
+  { PrefetchTestPe32,                  FALSE },
+  { PrefetchTestCompression,           TRUE  },
+  { PrefetchTestUnknownGuid,           FALSE },
+  { PrefetchTestNestedCompression,     FALSE },
+  { PrefetchTestLzmaAfterLargeSection, TRUE  },
+  { PrefetchTestLzmaAuthenticated,     TRUE  },
+  { PrefetchTestLzma,                  TRUE  }
+};
+
+//
+// Number of times the stand-in firmware volume read a whole file
+//
+UINTN  mPrefetchTestFileReadCount;
+
+/**
+  Find a driver of the stand-in firmware volume.
+
+  @param  NameGuid               The name of the driver file.
+
+  @return The driver, or NULL if there is no such file.
+
+**/
+STATIC
+PREFETCH_TEST_DRIVER *
+PrefetchTestFindDriver (
+  IN CONST EFI_GUID  *NameGuid
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (mPrefetchTestDrivers); Index++) {
+    if (CompareGuid (NameGuid, &mPrefetchTestDrivers[Index].DriverEntry.FileName)) {
+      return &mPrefetchTestDrivers[Index];
+    }
+  }
+  return NULL;
+}
+
+/**
+  Read a file of the stand-in firmware volume, the way
+  EFI_FIRMWARE_VOLUME2_PROTOCOL.ReadFile() does.
+
+  @param  This                  Indicates the calling context.
+  @param  NameGuid              Filename identifying which file to read.
+  @param  Buffer                Pointer to pointer to buffer in which contents of file are returned.
+  @param  BufferSize            Pointer to a caller allocated UINTN.
+  @param  FoundType             FoundType is a pointer to a caller allocated EFI_FV_FILETYPE.
+  @param  FileAttributes        FileAttributes is a pointer to a caller allocated EFI_FV_FILE_ATTRIBUTES.
+  @param  AuthenticationStatus  AuthenticationStatus is a pointer to a caller allocated UINT32.
+
+  @retval EFI_SUCCESS                The call completed successfully.
+  @retval EFI_WARN_BUFFER_TOO_SMALL  The buffer is too small to contain the requested output.
+  @retval EFI_NOT_FOUND              The requested file was not found in the firmware volume.
+
+**/
+EFI_STATUS
+EFIAPI
+PrefetchTestReadFile (
+  IN CONST EFI_FIRMWARE_VOLUME2_PROTOCOL  *This,
+  IN CONST EFI_GUID                       *NameGuid,
+  IN OUT   VOID                           **Buffer,
+  IN OUT   UINTN                          *BufferSize,
+  OUT      EFI_FV_FILETYPE                *FoundType,
+  OUT      EFI_FV_FILE_ATTRIBUTES         *FileAttributes,
+  OUT      UINT32                         *AuthenticationStatus
+  )
+{
+  PREFETCH_TEST_DRIVER  *Driver;
+  EFI_STATUS            Status;
+  UINTN                 Size;
+
+  Driver = PrefetchTestFindDriver (NameGuid);
+  if (Driver == NULL) {
+    return EFI_NOT_FOUND;
+  }
+
+  *FoundType            = EFI_FV_FILETYPE_DRIVER;
+  *FileAttributes       = 0;
+  *AuthenticationStatus = PREFETCH_TEST_FV_AUTHENTICATION_STATUS;
+
+  Status = EFI_SUCCESS;
+  Size   = Driver->FileSize;
+  if (*Buffer == NULL) {
+    *Buffer = AllocatePool (Size);
+    if (*Buffer == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    mPrefetchTestFileReadCount++;
+  } else if (Size > *BufferSize) {
+    Status = EFI_WARN_BUFFER_TOO_SMALL;
+    Size   = *BufferSize;
+  }
+  CopyMem (*Buffer, Driver->File, Size);
+  *BufferSize = Driver->FileSize;
+  return Status;
+}
+
+EFI_FIRMWARE_VOLUME2_PROTOCOL  mPrefetchTestFv = {
+  NULL,
+  NULL,
+  PrefetchTestReadFile
+};
+
+/**
+  Append a section to a section stream.
+
+  @param  Stream       The section stream.
+  @param  StreamSize   The size of the section stream, updated.
+  @param  Type         The type of the section.
+  @param  Header       The rest of the header of the section, after the common
+                       section header.
+  @param  HeaderSize   The size of the rest of the header.
+  @param  Data         The data of the section.
+  @param  DataSize     The size of the data.
+  @param  Key          The key the data is "compressed" with.
+
+  @return The section appended.
+
+**/
+STATIC
+EFI_COMMON_SECTION_HEADER *
+PrefetchTestAppendSection (
+  IN OUT UINT8             *Stream,
+  IN OUT UINTN             *StreamSize,
+  IN     EFI_SECTION_TYPE  Type,
+  IN     CONST VOID        *Header,
+  IN     UINTN             HeaderSize,
+  IN     CONST UINT8       *Data,
+  IN     UINTN             DataSize,
+  IN     UINT8             Key
+  )
+{
+  EFI_COMMON_SECTION_HEADER  *Section;
+  UINTN                      Size;
+  UINTN                      Index;
+
+  *StreamSize = ALIGN_VALUE (*StreamSize, 4);
+  Section     = (EFI_COMMON_SECTION_HEADER *) (Stream + *StreamSize);
+  Size        = sizeof (EFI_COMMON_SECTION_HEADER) + HeaderSize + DataSize;
+  ASSERT (*StreamSize + Size <= PREFETCH_TEST_FILE_SIZE);
+
+  Section->Type    = Type;
+  Section->Size[0] = (UINT8) Size;
+  Section->Size[1] = (UINT8) (Size >> 8);
+  Section->Size[2] = (UINT8) (Size >> 16);
+  CopyMem (Section + 1, Header, HeaderSize);
+  for (Index = 0; Index < DataSize; Index++) {
+    ((UINT8 *) (Section + 1))[HeaderSize + Index] = Data[Index] ^ Key;
+  }
+
+  *StreamSize += Size;
+  return Section;
+}
+
+/**
+  Append an encapsulation section, with the data "compressed".
+
+  @param  Stream       The section stream.
+  @param  StreamSize   The size of the section stream, updated.
+  @param  Type         EFI_SECTION_GUID_DEFINED or EFI_SECTION_COMPRESSION.
+  @param  Guid         The GUID of a GUIDed section.
+  @param  Attributes   The attributes of a GUIDed section.
+  @param  Data         The section stream to encapsulate.
+  @param  DataSize     The size of the section stream to encapsulate.
+
+**/
+STATIC
+VOID
+PrefetchTestAppendEncapsulation (
+  IN OUT UINT8             *Stream,
+  IN OUT UINTN             *StreamSize,
+  IN     EFI_SECTION_TYPE  Type,
+  IN     EFI_GUID          *Guid,
+  IN     UINT16            Attributes,
+  IN     CONST UINT8       *Data,
+  IN     UINTN             DataSize
+  )
+{
+  EFI_GUID_DEFINED_SECTION  Guided;
+  EFI_COMPRESSION_SECTION   Compression;
+
+  if (Type == EFI_SECTION_COMPRESSION) {
+    Compression.UncompressedLength = (UINT32) DataSize;
+    Compression.CompressionType    = EFI_STANDARD_COMPRESSION;
+    PrefetchTestAppendSection (
+      Stream,
+      StreamSize,
+      Type,
+      &Compression.UncompressedLength,
+      sizeof (Compression) - sizeof (EFI_COMMON_SECTION_HEADER),
+      Data,
+      DataSize,
+      STUB_DECOMPRESS_KEY
+      );
+    return;
+  }
+
+  CopyGuid (&Guided.SectionDefinitionGuid, Guid);
+  Guided.DataOffset = sizeof (Guided);
+  Guided.Attributes = Attributes;
+  PrefetchTestAppendSection (
+    Stream,
+    StreamSize,
+    Type,
+    &Guided.SectionDefinitionGuid,
+    sizeof (Guided) - sizeof (EFI_COMMON_SECTION_HEADER),
+    Data,
+    DataSize,
+    STUB_DECOMPRESS_KEY
+    );
+}
+
+/**
+  Build the file of a driver of the stand-in firmware volume, and schedule
+  the driver.
+
+  @param  Index        The index of the driver.
+
+**/
+STATIC
+VOID
+PrefetchTestBuildDriver (
+  IN UINTN  Index
+  )
+{
+  PREFETCH_TEST_DRIVER  *Driver;
+  UINT8                 Inner[PREFETCH_TEST_FILE_SIZE];
+  UINTN                 InnerSize;
+  UINT8                 Nested[PREFETCH_TEST_FILE_SIZE];
+  UINTN                 NestedSize;
+  UINT8                 Depex[8];
+  UINT8                 Ui[200];
+  EFI_GUID              UnknownGuid;
+  UINTN                 Byte;
+
+  Driver = &mPrefetchTestDrivers[Index];
+  ZeroMem (&Driver->DriverEntry, sizeof (Driver->DriverEntry));
+  Driver->DriverEntry.Signature        = EFI_CORE_DRIVER_ENTRY_SIGNATURE;
+  Driver->DriverEntry.Fv               = &mPrefetchTestFv;
+  Driver->DriverEntry.FvFileDevicePath = &Driver->FilePath;
+  Driver->DriverEntry.FileName.Data1   = (UINT32) Index + 1;
+  Driver->DriverEntry.Scheduled        = TRUE;
+  InsertTailList (&mScheduledQueue, &Driver->DriverEntry.ScheduledLink);
+
+  Driver->ImageSize = 64 + 16 * Index;
+  for (Byte = 0; Byte < Driver->ImageSize; Byte++) {
+    Driver->Image[Byte] = (UINT8) (Index * 31 + Byte);
+  }
+  SetMem (Depex, sizeof (Depex), EFI_DEP_TRUE);
+  SetMem (Ui, sizeof (Ui), 0);
+  CopyGuid (&UnknownGuid, &gLzmaCustomDecompressGuid);
+  UnknownGuid.Data1 ^= 0xFFFFFFFF;
+
+  //
+  // Section stream that the encapsulation sections hold
+  //
+  InnerSize = 0;
+  PrefetchTestAppendSection (Inner, &InnerSize, EFI_SECTION_USER_INTERFACE, NULL, 0, Ui, 6, 0);
+  PrefetchTestAppendSection (Inner, &InnerSize, EFI_SECTION_PE32, NULL, 0, Driver->Image, Driver->ImageSize, 0);
+
+  Driver->FileSize = 0;
+  PrefetchTestAppendSection (Driver->File, &Driver->FileSize, EFI_SECTION_DXE_DEPEX, NULL, 0, Depex, sizeof (Depex), 0);
+  switch (Driver->Storage) {
+  case PrefetchTestPe32:
+    PrefetchTestAppendSection (Driver->File, &Driver->FileSize, EFI_SECTION_PE32, NULL, 0, Driver->Image, Driver->ImageSize, 0);
+    break;
+  case PrefetchTestLzma:
+    PrefetchTestAppendEncapsulation (Driver->File, &Driver->FileSize, EFI_SECTION_GUID_DEFINED, &gLzmaCustomDecompressGuid, EFI_GUIDED_SECTION_PROCESSING_REQUIRED, Inner, InnerSize);
+    break;
+  case PrefetchTestCompression:
+    PrefetchTestAppendEncapsulation (Driver->File, &Driver->FileSize, EFI_SECTION_COMPRESSION, NULL, 0, Inner, InnerSize);
+    break;
+  case PrefetchTestUnknownGuid:
+    PrefetchTestAppendEncapsulation (Driver->File, &Driver->FileSize, EFI_SECTION_GUID_DEFINED, &UnknownGuid, EFI_GUIDED_SECTION_PROCESSING_REQUIRED, Inner, InnerSize);
+    break;
+  case PrefetchTestNestedCompression:
+    NestedSize = 0;
+    PrefetchTestAppendEncapsulation (Nested, &NestedSize, EFI_SECTION_COMPRESSION, NULL, 0, Inner, InnerSize);
+    PrefetchTestAppendEncapsulation (Driver->File, &Driver->FileSize, EFI_SECTION_GUID_DEFINED, &gLzmaCustomDecompressGuid, EFI_GUIDED_SECTION_PROCESSING_REQUIRED, Nested, NestedSize);
+    break;
+  case PrefetchTestLzmaAfterLargeSection:
+    PrefetchTestAppendSection (Driver->File, &Driver->FileSize, EFI_SECTION_USER_INTERFACE, NULL, 0, Ui, sizeof (Ui), 0);
+    PrefetchTestAppendEncapsulation (Driver->File, &Driver->FileSize, EFI_SECTION_GUID_DEFINED, &gLzmaCustomDecompressGuid, EFI_GUIDED_SECTION_PROCESSING_REQUIRED, Inner, InnerSize);
+    break;
+  case PrefetchTestLzmaAuthenticated:
+    PrefetchTestAppendEncapsulation (Driver->File, &Driver->FileSize, EFI_SECTION_GUID_DEFINED, &gLzmaCustomDecompressGuid, EFI_GUIDED_SECTION_PROCESSING_REQUIRED | EFI_GUIDED_SECTION_AUTH_STATUS_VALID, Inner, InnerSize);
+    break;
+  }
+}
+
+/**
+  Dispatch the scheduled drivers the way the DXE Dispatcher does, and check
+  that the prefetch returned the image of the drivers stored in sections it
+  can decompress, with the authentication status the firmware volume would
+  return, and that it decompressed the images in batches on the application
+  processors.
+
+  @param[in]  Context    [Unused]
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PrefetchShouldReturnDriverImages (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN                 Index;
+  PREFETCH_TEST_DRIVER  *Driver;
+  VOID                  *Image;
+  UINTN                 ImageSize;
+  UINT32                AuthenticationStatus;
+  UINTN                 PrefetchedCount;
+  UINTN                 StartupAllApsCount;
+
+  for (Index = 0; Index < ARRAY_SIZE (mPrefetchTestDrivers); Index++) {
+    PrefetchTestBuildDriver (Index);
+  }
+
+  PrefetchedCount = 0;
+  for (Index = 0; Index < ARRAY_SIZE (mPrefetchTestDrivers); Index++) {
+    Driver = &mPrefetchTestDrivers[Index];
+    UT_ASSERT_EQUAL (mScheduledQueue.ForwardLink, &Driver->DriverEntry.ScheduledLink);
+
+    StartupAllApsCount = mStubStartupAllApsCount;
+    CorePrefetchScheduledImages ();
+    UT_ASSERT_TRUE (Driver->DriverEntry.Prefetched);
+
+    //
+    // The application processors are not waited for.  They run after the
+    // boot processor takes the image of the first batch, and before it for
+    // the second one.
+    //
+    UT_ASSERT_EQUAL (mStubApProcedureCount, StartupAllApsCount * STUB_AP_COUNT);
+    if (StartupAllApsCount == 1) {
+      StubRunAps ();
+    }
+
+    AuthenticationStatus = 0;
+    Image = CoreGetPrefetchedImage (&Driver->FilePath, &ImageSize, &AuthenticationStatus);
+    StubRunAps ();
+    UT_LOG_INFO ("Driver %d: %a\n", Index, (Image != NULL) ? "prefetched" : "not prefetched");
+    if (!Driver->Prefetched) {
+      UT_ASSERT_TRUE (Image == NULL);
+    } else {
+      UT_ASSERT_NOT_NULL (Image);
+      UT_ASSERT_EQUAL (ImageSize, Driver->ImageSize);
+      UT_ASSERT_MEM_EQUAL (Image, Driver->Image, ImageSize);
+      UT_ASSERT_EQUAL (AuthenticationStatus, PREFETCH_TEST_FV_AUTHENTICATION_STATUS);
+      CoreReleasePrefetchedImage (Image);
+      PrefetchedCount++;
+    }
+
+    //
+    // An image is only returned once
+    //
+    UT_ASSERT_TRUE (CoreGetPrefetchedImage (&Driver->FilePath, &ImageSize, &AuthenticationStatus) == NULL);
+
+    RemoveEntryList (&Driver->DriverEntry.ScheduledLink);
+  }
+  CoreFreePrefetchedImages ();
+  UT_ASSERT_TRUE (mImagePrefetchJobs == NULL);
+
+  //
+  // Files whose first sections hold the image uncompressed are not read
+  //
+  UT_ASSERT_EQUAL (mPrefetchTestFileReadCount, ARRAY_SIZE (mPrefetchTestDrivers) - 1);
+
+  //
+  // The first batch holds the first PREFETCH_TEST_COUNT drivers that have a
+  // job, and the second one the rest
+  //
+  UT_ASSERT_EQUAL (mStubStartupAllApsCount, 2);
+  UT_ASSERT_EQUAL (mStubApProcedureCount, 2 * STUB_AP_COUNT);
+  UT_LOG_INFO ("%d of %d driver images prefetched\n", PrefetchedCount, ARRAY_SIZE (mPrefetchTestDrivers));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize a driver entry in the Dependent state with a dependency
+  expression.
+
+  @param  DriverEntry    The driver entry.
+  @param  Depex          The dependency expression.
+  @param  DepexSize      The size of the dependency expression.
+
+**/
+STATIC
+VOID
+DepexTestInitDriver (
+  OUT EFI_CORE_DRIVER_ENTRY  *DriverEntry,
+  IN  VOID                   *Depex,
+  IN  UINTN                  DepexSize
+  )
+{
+  ZeroMem (DriverEntry, sizeof (*DriverEntry));
+  DriverEntry->Signature = EFI_CORE_DRIVER_ENTRY_SIGNATURE;
+  DriverEntry->Depex     = Depex;
+  DriverEntry->DepexSize = DepexSize;
+  CorePreProcessDepex (DriverEntry);
+}
+
+/**
+  Evaluate the dependency expressions of two drivers as the protocols they
+  wait for are installed, and check that an expression is marked unchanged
+  after it evaluates to FALSE, until a protocol it pushes is installed.
+
+  @param[in]  Context    [Unused]
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+DepexShouldChangeOnlyWhenPushedProtocolIsInstalled (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  DEPEX_TEST_AND         AndDepex;
+  UINT8                  PushDepex[sizeof (EFI_GUID) + 2];
+  EFI_CORE_DRIVER_ENTRY  AndDriver;
+  EFI_CORE_DRIVER_ENTRY  PushDriver;
+
+  //
+  // AndDriver depends on the first two protocols, and PushDriver on the
+  // third one
+  //
+  AndDepex.Push1 = EFI_DEP_PUSH;
+  CopyGuid (&AndDepex.Protocol1, &mDepexTestProtocols[0]);
+  AndDepex.Push2 = EFI_DEP_PUSH;
+  CopyGuid (&AndDepex.Protocol2, &mDepexTestProtocols[1]);
+  AndDepex.And   = EFI_DEP_AND;
+  AndDepex.End   = EFI_DEP_END;
+  DepexTestInitDriver (&AndDriver, &AndDepex, sizeof (AndDepex));
+
+  PushDepex[0] = EFI_DEP_PUSH;
+  CopyMem (&PushDepex[1], &mDepexTestProtocols[2], sizeof (EFI_GUID));
+  PushDepex[sizeof (EFI_GUID) + 1] = EFI_DEP_END;
+  DepexTestInitDriver (&PushDriver, PushDepex, sizeof (PushDepex));
+
+  UT_ASSERT_FALSE (CoreIsSchedulable (&AndDriver));
+  UT_ASSERT_TRUE (AndDriver.DepexUnchanged);
+  UT_ASSERT_EQUAL (AndDriver.DepexWaiterCount, 2);
+  UT_ASSERT_FALSE (CoreIsSchedulable (&PushDriver));
+  UT_ASSERT_TRUE (PushDriver.DepexUnchanged);
+
+  //
+  // A protocol in the same bucket as a pushed one changes nothing
+  //
+  StubInstallProtocol (&mDepexTestProtocols[3]);
+  UT_ASSERT_TRUE (AndDriver.DepexUnchanged);
+  UT_ASSERT_TRUE (PushDriver.DepexUnchanged);
+
+  StubInstallProtocol (&mDepexTestProtocols[2]);
+  UT_ASSERT_TRUE (AndDriver.DepexUnchanged);
+  UT_ASSERT_FALSE (PushDriver.DepexUnchanged);
+  UT_ASSERT_TRUE (CoreIsSchedulable (&PushDriver));
+  CoreUnregisterDepexWaiters (&PushDriver);
+  UT_ASSERT_TRUE (PushDriver.DepexWaiters == NULL);
+
+  //
+  // Half of the AND is satisfied, so the expression is evaluated again, to
+  // FALSE, and is unchanged again
+  //
+  StubInstallProtocol (&mDepexTestProtocols[0]);
+  UT_ASSERT_FALSE (AndDriver.DepexUnchanged);
+  UT_ASSERT_FALSE (CoreIsSchedulable (&AndDriver));
+  UT_ASSERT_TRUE (AndDriver.DepexUnchanged);
+
+  StubInstallProtocol (&mDepexTestProtocols[1]);
+  UT_ASSERT_FALSE (AndDriver.DepexUnchanged);
+  UT_ASSERT_TRUE (CoreIsSchedulable (&AndDriver));
+  CoreUnregisterDepexWaiters (&AndDriver);
+
+  //
+  // The drivers are no longer waiting
+  //
+  StubInstallProtocol (&mDepexTestProtocols[1]);
+  StubInstallProtocol (&mDepexTestProtocols[2]);
+  UT_ASSERT_FALSE (AndDriver.DepexUnchanged);
+  UT_ASSERT_FALSE (PushDriver.DepexUnchanged);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  DXE Dispatcher and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      DepexTests;
+  UNIT_TEST_SUITE_HANDLE      PrefetchTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&DepexTests, Framework, "Dependency Expression Tests", "DxeCore.Dispatcher.Depex", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for DepexTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (DepexTests, "Depex should change only when a pushed protocol is installed", "Unchanged", DepexShouldChangeOnlyWhenPushedProtocolIsInstalled, NULL, NULL, NULL);
+
+  Status = CreateUnitTestSuite (&PrefetchTests, Framework, "Image Prefetch Tests", "DxeCore.Dispatcher.Prefetch", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for PrefetchTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (PrefetchTests, "Prefetch should return the images of compressed drivers", "Images", PrefetchShouldReturnDriverImages, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,426 @@
+/** @file
+  Host based stand-ins for the services that the DXE Dispatcher dependency
+  evaluator (Dispatcher/Dependency.c) and image prefetch
+  (Dispatcher/Prefetch.c) depend on.
+
+  The stand-in "decompression" of the LZMA GUIDed sections and of the
+  standard compression sections is an exclusive or of the section data with
+  STUB_DECOMPRESS_KEY, and the stand-in MP Services Protocol runs the
+  procedure on STUB_AP_COUNT application processors one after the other.
+  When it is started without waiting, the procedure only runs once the
+  tests call StubRunAps().
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeMain.h"
+
+#define STUB_DECOMPRESS_KEY  0x5A
+#define STUB_AP_COUNT        3
+#define STUB_PROTOCOL_COUNT  16
+
+//
+// Current task priority level
+//
+EFI_TPL     mStubTpl = TPL_APPLICATION;
+
+//
+// Protocols installed, as the dependency evaluator finds them
+//
+EFI_GUID    mStubProtocols[STUB_PROTOCOL_COUNT];
+UINTN       mStubProtocolCount;
+
+//
+// Number of calls to StartupAllAPs() and of procedures run on application
+// processors, and procedure started without waiting, until the tests run it
+//
+UINTN             mStubStartupAllApsCount;
+UINTN             mStubApProcedureCount;
+EFI_AP_PROCEDURE  mStubApProcedure;
+VOID              *mStubApProcedureArgument;
+
+//
+// Stand-in event handle returned by CoreCreateEvent()
+//
+UINT8       mStubEvent;
+
+/**
+  Raise the task priority level to the new level.
+
+  @param  NewTpl  New task priority level
+
+  @return The previous task priority level
+
+**/
+EFI_TPL
+EFIAPI
+CoreRaiseTpl (
+  IN EFI_TPL      NewTpl
+  )
+{
+  EFI_TPL     OldTpl;
+
+  OldTpl   = mStubTpl;
+  ASSERT (OldTpl <= NewTpl);
+  mStubTpl = NewTpl;
+  return OldTpl;
+}
+
+/**
+  Lowers the task priority to the previous value.
+
+  @param  NewTpl  New, lower, task priority
+
+**/
+VOID
+EFIAPI
+CoreRestoreTpl (
+  IN EFI_TPL NewTpl
+  )
+{
+  ASSERT (NewTpl <= mStubTpl);
+  mStubTpl = NewTpl;
+}
+
+/**
+  Install a protocol, and tell the dependency evaluator, the way
+  CoreInstallProtocolInterface() does.
+
+  @param  Protocol               The protocol to install.
+
+**/
+VOID
+StubInstallProtocol (
+  IN CONST EFI_GUID  *Protocol
+  )
+{
+  ASSERT (mStubProtocolCount < STUB_PROTOCOL_COUNT);
+  CopyGuid (&mStubProtocols[mStubProtocolCount++], Protocol);
+  CoreRaiseTpl (TPL_NOTIFY);
+  CoreDepexProtocolInstalled (Protocol);
+  CoreRestoreTpl (TPL_APPLICATION);
+}
+
+/**
+  Return if all the architectural protocols are available.  They are not in
+  the host environment.
+
+  @retval EFI_NOT_FOUND          An architectural protocol is missing.
+
+**/
+EFI_STATUS
+CoreAllEfiServicesAvailable (
+  VOID
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Creates an event, which the stand-in MP Services Protocol never signals.
+
+  @param  Type                   The type of event to create and its mode and
+                                 attributes
+  @param  NotifyTpl              The task priority level of event notifications
+  @param  NotifyFunction         Pointer to the events notification function
+  @param  NotifyContext          Pointer to the notification functions context
+  @param  Event                  Pointer to the newly created event if the call
+                                 succeeds; undefined otherwise
+
+  @retval EFI_SUCCESS            The event structure was created
+
+**/
+EFI_STATUS
+EFIAPI
+CoreCreateEvent (
+  IN UINT32                   Type,
+  IN EFI_TPL                  NotifyTpl,
+  IN EFI_EVENT_NOTIFY         NotifyFunction, OPTIONAL
+  IN VOID                     *NotifyContext, OPTIONAL
+  OUT EFI_EVENT               *Event
+  )
+{
+  *Event = &mStubEvent;
+  return EFI_SUCCESS;
+}
+
+/**
+  Return the number of stand-in processors: the boot processor, and
+  STUB_AP_COUNT application processors, all enabled.
+
+  @param  This                      A pointer to the EFI_MP_SERVICES_PROTOCOL instance.
+  @param  NumberOfProcessors        The number of processors.
+  @param  NumberOfEnabledProcessors The number of enabled processors.
+
+  @retval EFI_SUCCESS               The numbers of processors were returned.
+
+**/
+EFI_STATUS
+EFIAPI
+StubGetNumberOfProcessors (
+  IN  EFI_MP_SERVICES_PROTOCOL  *This,
+  OUT UINTN                     *NumberOfProcessors,
+  OUT UINTN                     *NumberOfEnabledProcessors
+  )
+{
+  *NumberOfProcessors        = STUB_AP_COUNT + 1;
+  *NumberOfEnabledProcessors = STUB_AP_COUNT + 1;
+  return EFI_SUCCESS;
+}
+
+/**
+  Run the procedure started without waiting on all the stand-in application
+  processors, if any.
+
+**/
+VOID
+StubRunAps (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  if (mStubApProcedure == NULL) {
+    return;
+  }
+  for (Index = 0; Index < STUB_AP_COUNT; Index++) {
+    mStubApProcedure (mStubApProcedureArgument);
+    mStubApProcedureCount++;
+  }
+  mStubApProcedure = NULL;
+}
+
+/**
+  Run a procedure on all the stand-in application processors, or keep it
+  for StubRunAps() when it is started without waiting.
+
+  @param  This                  A pointer to the EFI_MP_SERVICES_PROTOCOL instance.
+  @param  Procedure             The procedure to run.
+  @param  SingleThread          Not used.
+  @param  WaitEvent             The event of the completion, NULL to wait.
+  @param  TimeoutInMicroSeconds Not used.
+  @param  ProcedureArgument     The argument of the procedure.
+  @param  FailedCpuList         Not used.
+
+  @retval EFI_SUCCESS           The procedure ran or was started on all
+                                application processors.
+  @retval EFI_NOT_READY         The application processors are busy.
+
+**/
+EFI_STATUS
+EFIAPI
+StubStartupAllAps (
+  IN  EFI_MP_SERVICES_PROTOCOL  *This,
+  IN  EFI_AP_PROCEDURE          Procedure,
+  IN  BOOLEAN                   SingleThread,
+  IN  EFI_EVENT                 WaitEvent               OPTIONAL,
+  IN  UINTN                     TimeoutInMicroSeconds,
+  IN  VOID                      *ProcedureArgument      OPTIONAL,
+  OUT UINTN                     **FailedCpuList         OPTIONAL
+  )
+{
+  if (mStubApProcedure != NULL) {
+    return EFI_NOT_READY;
+  }
+  mStubStartupAllApsCount++;
+  mStubApProcedure         = Procedure;
+  mStubApProcedureArgument = ProcedureArgument;
+  if (WaitEvent == NULL) {
+    StubRunAps ();
+  }
+  return EFI_SUCCESS;
+}
+
+EFI_MP_SERVICES_PROTOCOL  mStubMpServices = {
+  StubGetNumberOfProcessors,
+  NULL,
+  StubStartupAllAps,
+  NULL,
+  NULL,
+  NULL,
+  NULL
+};
+
+/**
+  Locates the MP Services Protocol, which the image prefetch looks for, or a
+  protocol installed with StubInstallProtocol().
+
+  @param  Protocol               The protocol to search for
+  @param  Registration           Optional Registration Key returned from
+                                 RegisterProtocolNotify()
+  @param  Interface              Return the Protocol interface (instance).
+
+  @retval EFI_SUCCESS            If a valid Interface is returned
+  @retval EFI_NOT_FOUND          Protocol interface not found
+
+**/
+EFI_STATUS
+EFIAPI
+CoreLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  IN  VOID      *Registration OPTIONAL,
+  OUT VOID      **Interface
+  )
+{
+  UINTN  Index;
+
+  if (CompareGuid (Protocol, &gEfiMpServiceProtocolGuid)) {
+    *Interface = &mStubMpServices;
+    return EFI_SUCCESS;
+  }
+  for (Index = 0; Index < mStubProtocolCount; Index++) {
+    if (CompareGuid (Protocol, &mStubProtocols[Index])) {
+      *Interface = &mStubProtocols[Index];
+      return EFI_SUCCESS;
+    }
+  }
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Frees pool.
+
+  @param  Buffer                 The allocated pool entry to free
+
+  @retval EFI_SUCCESS            Pool successfully freed.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreFreePool (
+  IN VOID        *Buffer
+  )
+{
+  FreePool (Buffer);
+  return EFI_SUCCESS;
+}
+
+/**
+  Retrieves the size of the data of a stand-in LZMA GUIDed section.
+
+  @param  InputSection           A pointer to a GUIDed section of an FFS formatted file.
+  @param  OutputBufferSize       A pointer to the size, in bytes, of an output buffer required
+                                 if the buffer specified by InputSection were decoded.
+  @param  ScratchBufferSize      A pointer to the size, in bytes, required as scratch space
+                                 if the buffer specified by InputSection were decoded.
+  @param  SectionAttribute       A pointer to the attributes of the GUIDed section.
+
+  @retval RETURN_SUCCESS         The information about InputSection was returned.
+  @retval RETURN_UNSUPPORTED     The section specified by InputSection does not match
+                                 the LZMA GUID.
+
+**/
+RETURN_STATUS
+EFIAPI
+ExtractGuidedSectionGetInfo (
+  IN  CONST VOID    *InputSection,
+  OUT       UINT32  *OutputBufferSize,
+  OUT       UINT32  *ScratchBufferSize,
+  OUT       UINT16  *SectionAttribute
+  )
+{
+  CONST EFI_GUID_DEFINED_SECTION  *Section;
+
+  Section = InputSection;
+  if (!CompareGuid (&Section->SectionDefinitionGuid, &gLzmaCustomDecompressGuid)) {
+    return RETURN_UNSUPPORTED;
+  }
+  *OutputBufferSize  = SECTION_SIZE (Section) - Section->DataOffset;
+  *ScratchBufferSize = 16;
+  *SectionAttribute  = Section->Attributes;
+  return RETURN_SUCCESS;
+}
+
+/**
+  Decodes a stand-in LZMA GUIDed section.
+
+  @param  InputSection           A pointer to a GUIDed section of an FFS formatted file.
+  @param  OutputBuffer           A pointer to a buffer that contains the result of a decode operation.
+  @param  ScratchBuffer          A caller allocated buffer that may be required by this function
+                                 as a scratch buffer to perform the decode operation.
+  @param  AuthenticationStatus   A pointer to the authentication status of the decoded output buffer.
+
+  @retval RETURN_SUCCESS         The buffer specified by InputSection was decoded.
+  @retval RETURN_UNSUPPORTED     The section specified by InputSection does not match
+                                 the LZMA GUID.
+
+**/
+RETURN_STATUS
+EFIAPI
+ExtractGuidedSectionDecode (
+  IN  CONST VOID    *InputSection,
+  OUT       VOID    **OutputBuffer,
+  IN        VOID    *ScratchBuffer,        OPTIONAL
+  OUT       UINT32  *AuthenticationStatus
+  )
+{
+  CONST EFI_GUID_DEFINED_SECTION  *Section;
+  UINTN                           Index;
+
+  Section = InputSection;
+  if (!CompareGuid (&Section->SectionDefinitionGuid, &gLzmaCustomDecompressGuid)) {
+    return RETURN_UNSUPPORTED;
+  }
+  ASSERT (ScratchBuffer != NULL);
+  for (Index = 0; Index < SECTION_SIZE (Section) - Section->DataOffset; Index++) {
+    ((UINT8 *) *OutputBuffer)[Index] = ((UINT8 *) Section)[Section->DataOffset + Index] ^ STUB_DECOMPRESS_KEY;
+  }
+  *AuthenticationStatus = 0;
+  return RETURN_SUCCESS;
+}
+
+/**
+  Retrieves the size of the data of a stand-in standard compression section.
+
+  @param  Source               The source buffer containing the compressed data.
+  @param  SourceSize           The size, in bytes, of the source buffer.
+  @param  DestinationSize      A pointer to the size, in bytes, of the uncompressed buffer.
+  @param  ScratchSize          A pointer to the size, in bytes, of the scratch buffer.
+
+  @retval  RETURN_SUCCESS      The size of the uncompressed data was returned.
+
+**/
+RETURN_STATUS
+EFIAPI
+UefiDecompressGetInfo (
+  IN  CONST VOID  *Source,
+  IN  UINT32      SourceSize,
+  OUT UINT32      *DestinationSize,
+  OUT UINT32      *ScratchSize
+  )
+{
+  *DestinationSize = SourceSize;
+  *ScratchSize     = 0;
+  return RETURN_SUCCESS;
+}
+
+/**
+  Decompresses a stand-in standard compression section.  The size of the
+  data is taken from the section header before the data.
+
+  @param  Source      The source buffer containing the compressed data.
+  @param  Destination The destination buffer to store the decompressed data.
+  @param  Scratch     Not used.
+
+  @retval  RETURN_SUCCESS Decompression completed successfully.
+
+**/
+RETURN_STATUS
+EFIAPI
+UefiDecompress (
+  IN CONST VOID  *Source,
+  IN OUT VOID    *Destination,
+  IN OUT VOID    *Scratch  OPTIONAL
+  )
+{
+  CONST EFI_COMPRESSION_SECTION  *Section;
+  UINTN                          Index;
+
+  Section = (CONST EFI_COMPRESSION_SECTION *) Source - 1;
+  for (Index = 0; Index < Section->UncompressedLength; Index++) {
+    ((UINT8 *) Destination)[Index] = ((CONST UINT8 *) Source)[Index] ^ STUB_DECOMPRESS_KEY;
+  }
+  return RETURN_SUCCESS;
+}
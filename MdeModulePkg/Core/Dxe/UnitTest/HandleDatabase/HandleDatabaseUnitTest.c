@@ -0,0 +1,766 @@
+/** @file
+  Host based unit tests of the DXE Core handle database.
+
+  Besides checking the protocol services against the hash indexes of the
+  protocol database and the batching of protocol notifications, the benchmark
+  suite reports how the cost of a
+  HandleProtocol() lookup evolves as the number of handles grows.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include "DxeMain.h"
+#include "Handle.h"
+#include "Event.h"
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME        "DXE Core Handle Database Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Number of lookups timed for each handle count in the benchmark
+//
+#define BENCHMARK_LOOKUP_COUNT    0x100000
+
+//
+// Handle counts used by the lookup cost benchmark
+//
+UINTN  mBenchmarkHandleCounts[] = { 256, 1024, 4096, 16384 };
+
+//
+// Number of events signaled, counted by the stub CoreSignalEvent()
+//
+extern UINTN  mStubSignalCount;
+
+/**
+  Build a protocol GUID that is unique for each Index.
+
+  @param[in]   Index  The index of the protocol.
+  @param[out]  Guid   The returned protocol GUID.
+
+**/
+STATIC
+VOID
+BuildTestGuid (
+  IN  UINTN     Index,
+  OUT EFI_GUID  *Guid
+  )
+{
+  Guid->Data1    = (UINT32)Index;
+  Guid->Data2    = 0x4B1E;
+  Guid->Data3    = 0x9F3C;
+  Guid->Data4[0] = 0xA2;
+  Guid->Data4[1] = 0x41;
+  Guid->Data4[2] = 0x7C;
+  Guid->Data4[3] = 0x0D;
+  Guid->Data4[4] = 0x5E;
+  Guid->Data4[5] = 0x33;
+  Guid->Data4[6] = (UINT8)(Index >> 8);
+  Guid->Data4[7] = (UINT8)Index;
+}
+
+/**
+  Install one interface of CommonGuid on each of Count new handles.
+
+  @param[in]   Count       The number of handles to create.
+  @param[in]   CommonGuid  The protocol to install on each handle.
+  @param[out]  Handles     The created handles.
+
+  @retval EFI_SUCCESS  All the handles were created.
+
+**/
+STATIC
+EFI_STATUS
+CreateHandles (
+  IN  UINTN       Count,
+  IN  EFI_GUID    *CommonGuid,
+  OUT EFI_HANDLE  *Handles
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+
+  for (Index = 0; Index < Count; Index++) {
+    Handles[Index] = NULL;
+    Status = CoreInstallProtocolInterface (
+               &Handles[Index],
+               CommonGuid,
+               EFI_NATIVE_INTERFACE,
+               (VOID *)(UINTN)(Index + 1)
+               );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Uninstall the interfaces installed by CreateHandles(), freeing the handles.
+
+  @param[in]  Count       The number of handles.
+  @param[in]  CommonGuid  The protocol installed on each handle.
+  @param[in]  Handles     The handles to destroy.
+
+  @retval EFI_SUCCESS  All the handles were destroyed.
+
+**/
+STATIC
+EFI_STATUS
+DestroyHandles (
+  IN UINTN       Count,
+  IN EFI_GUID    *CommonGuid,
+  IN EFI_HANDLE  *Handles
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       Index;
+
+  for (Index = 0; Index < Count; Index++) {
+    Status = CoreUninstallProtocolInterface (
+               Handles[Index],
+               CommonGuid,
+               (VOID *)(UINTN)(Index + 1)
+               );
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Verify installing, locating and uninstalling protocols on many handles.
+
+  @param[in]  Context  Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+InstallLocateUninstallShouldBeConsistent (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  EFI_GUID    CommonGuid;
+  EFI_GUID    UniqueGuid;
+  EFI_HANDLE  Handles[64];
+  EFI_HANDLE  *Buffer;
+  UINTN       Count;
+  UINTN       Index;
+  VOID        *Interface;
+
+  BuildTestGuid (0x10000, &CommonGuid);
+  Status = CreateHandles (ARRAY_SIZE (Handles), &CommonGuid, Handles);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  for (Index = 0; Index < ARRAY_SIZE (Handles); Index++) {
+    BuildTestGuid (0x20000 + Index, &UniqueGuid);
+    Status = CoreInstallProtocolInterface (&Handles[Index], &UniqueGuid, EFI_NATIVE_INTERFACE, &Handles[Index]);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  //
+  // Installing the same protocol twice on a handle must be rejected
+  //
+  Status = CoreInstallProtocolInterface (&Handles[0], &CommonGuid, EFI_NATIVE_INTERFACE, NULL);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_INVALID_PARAMETER);
+
+  for (Index = 0; Index < ARRAY_SIZE (Handles); Index++) {
+    Status = CoreHandleProtocol (Handles[Index], &CommonGuid, &Interface);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL ((UINTN)Interface, Index + 1);
+
+    BuildTestGuid (0x20000 + Index, &UniqueGuid);
+    Status = CoreHandleProtocol (Handles[Index], &UniqueGuid, &Interface);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL ((UINTN)Interface, (UINTN)&Handles[Index]);
+
+    //
+    // The unique protocol of the next handle is not on this handle
+    //
+    BuildTestGuid (0x20000 + ((Index + 1) % ARRAY_SIZE (Handles)), &UniqueGuid);
+    Status = CoreHandleProtocol (Handles[Index], &UniqueGuid, &Interface);
+    UT_ASSERT_STATUS_EQUAL (Status, EFI_UNSUPPORTED);
+  }
+
+  Status = CoreLocateHandleBuffer (ByProtocol, &CommonGuid, NULL, &Count, &Buffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Count, ARRAY_SIZE (Handles));
+  UT_ASSERT_MEM_EQUAL (Buffer, Handles, sizeof (Handles));
+  FreePool (Buffer);
+
+  Status = CoreLocateProtocol (&CommonGuid, NULL, &Interface);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL ((UINTN)Interface, 1);
+
+  //
+  // Removing the unique protocols leaves the handles alive
+  //
+  for (Index = 0; Index < ARRAY_SIZE (Handles); Index++) {
+    BuildTestGuid (0x20000 + Index, &UniqueGuid);
+    Status = CoreUninstallProtocolInterface (Handles[Index], &UniqueGuid, &Handles[Index]);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    Status = CoreHandleProtocol (Handles[Index], &UniqueGuid, &Interface);
+    UT_ASSERT_STATUS_EQUAL (Status, EFI_UNSUPPORTED);
+    UT_ASSERT_NOT_EFI_ERROR (CoreValidateHandle (Handles[Index], FALSE));
+  }
+
+  Status = DestroyHandles (ARRAY_SIZE (Handles), &CommonGuid, Handles);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  //
+  // Once the last protocol is gone the handles are no longer valid
+  //
+  for (Index = 0; Index < ARRAY_SIZE (Handles); Index++) {
+    UT_ASSERT_STATUS_EQUAL (CoreValidateHandle (Handles[Index], FALSE), EFI_INVALID_PARAMETER);
+  }
+
+  Status = CoreLocateProtocol (&CommonGuid, NULL, &Interface);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Verify a handle carrying many more protocols than the per-handle protocol
+  index has slots, across growth of the protocol GUID hash table.
+
+  @param[in]  Context  Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ManyProtocolsOnOneHandleShouldBeFound (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  EFI_HANDLE  Handle;
+  EFI_GUID    Guid;
+  EFI_GUID    **ProtocolBuffer;
+  UINTN       ProtocolCount;
+  UINTN       Index;
+  VOID        *Interface;
+
+  Handle = NULL;
+  for (Index = 0; Index < 1000; Index++) {
+    BuildTestGuid (0x30000 + Index, &Guid);
+    Status = CoreInstallProtocolInterface (&Handle, &Guid, EFI_NATIVE_INTERFACE, (VOID *)(UINTN)(Index + 1));
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  Status = CoreProtocolsPerHandle (Handle, &ProtocolBuffer, &ProtocolCount);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (ProtocolCount, 1000);
+  FreePool (ProtocolBuffer);
+
+  //
+  // Remove every other protocol, which frees slots of the per-handle index
+  //
+  for (Index = 0; Index < 1000; Index += 2) {
+    BuildTestGuid (0x30000 + Index, &Guid);
+    Status = CoreUninstallProtocolInterface (Handle, &Guid, (VOID *)(UINTN)(Index + 1));
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  for (Index = 0; Index < 1000; Index++) {
+    BuildTestGuid (0x30000 + Index, &Guid);
+    Status = CoreHandleProtocol (Handle, &Guid, &Interface);
+    if ((Index % 2) == 0) {
+      UT_ASSERT_STATUS_EQUAL (Status, EFI_UNSUPPORTED);
+    } else {
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+      UT_ASSERT_EQUAL ((UINTN)Interface, Index + 1);
+    }
+  }
+
+  for (Index = 1; Index < 1000; Index += 2) {
+    BuildTestGuid (0x30000 + Index, &Guid);
+    Status = CoreUninstallProtocolInterface (Handle, &Guid, (VOID *)(UINTN)(Index + 1));
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  UT_ASSERT_STATUS_EQUAL (CoreValidateHandle (Handle, FALSE), EFI_INVALID_PARAMETER);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Verify handle validation while handles are destroyed in an order unrelated
+  to their creation, which exercises deletion from the handle hash table.
+
+  @param[in]  Context  Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+HandleValidationShouldSurviveRemoval (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  EFI_GUID    CommonGuid;
+  EFI_HANDLE  *Handles;
+  BOOLEAN     *Removed;
+  UINTN       Count;
+  UINTN       Step;
+  UINTN       Index;
+  UINTN       Check;
+
+  Count   = 5000;
+  Handles = AllocateZeroPool (Count * sizeof (EFI_HANDLE));
+  Removed = AllocateZeroPool (Count * sizeof (BOOLEAN));
+  UT_ASSERT_NOT_NULL (Handles);
+  UT_ASSERT_NOT_NULL (Removed);
+
+  BuildTestGuid (0x40000, &CommonGuid);
+  Status = CreateHandles (Count, &CommonGuid, Handles);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  //
+  // 7919 is prime, so this visits every handle exactly once
+  //
+  for (Step = 0, Index = 0; Step < Count; Step++, Index = (Index + 7919) % Count) {
+    Status = CoreUninstallProtocolInterface (Handles[Index], &CommonGuid, (VOID *)(UINTN)(Index + 1));
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    Removed[Index] = TRUE;
+
+    if ((Step % 97) == 0) {
+      for (Check = 0; Check < Count; Check++) {
+        Status = CoreValidateHandle (Handles[Check], FALSE);
+        UT_ASSERT_STATUS_EQUAL (Status, Removed[Check] ? EFI_INVALID_PARAMETER : EFI_SUCCESS);
+      }
+    }
+  }
+
+  FreePool (Handles);
+  FreePool (Removed);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Verify that CoreLocateHandleBufferSince() only returns the handles that
+  gained the protocol after the generation passed in, and that ByProtocol
+  searches keep returning handles in installation order.
+
+  @param[in]  Context  Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+LocateSinceGenerationShouldReturnNewHandles (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  EFI_GUID    CommonGuid;
+  EFI_HANDLE  Handles[64];
+  EFI_HANDLE  *Buffer;
+  UINTN       NumberHandles;
+  UINT64      Generation;
+  UINTN       Index;
+
+  BuildTestGuid (0x50000, &CommonGuid);
+
+  Generation = 0;
+  Status = CoreLocateHandleBufferSince (&CommonGuid, &Generation, &NumberHandles, &Buffer);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+
+  Status = CreateHandles (32, &CommonGuid, Handles);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  Generation = 0;
+  Status = CoreLocateHandleBufferSince (&CommonGuid, &Generation, &NumberHandles, &Buffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (NumberHandles, 32);
+  for (Index = 0; Index < NumberHandles; Index++) {
+    UT_ASSERT_EQUAL ((UINTN)Buffer[Index], (UINTN)Handles[Index]);
+  }
+  FreePool (Buffer);
+
+  //
+  // Nothing changed, so the same generation has nothing new to report
+  //
+  Status = CoreLocateHandleBufferSince (&CommonGuid, &Generation, &NumberHandles, &Buffer);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+
+  //
+  // Remove a few of the early handles and add some more.  Only the added
+  // ones are newer than the saved generation.
+  //
+  for (Index = 0; Index < 8; Index++) {
+    Status = CoreUninstallProtocolInterface (Handles[Index], &CommonGuid, (VOID *)(UINTN)(Index + 1));
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+  for (Index = 32; Index < 64; Index++) {
+    Handles[Index] = NULL;
+    Status = CoreInstallProtocolInterface (&Handles[Index], &CommonGuid, EFI_NATIVE_INTERFACE, (VOID *)(UINTN)(Index + 1));
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  Status = CoreLocateHandleBufferSince (&CommonGuid, &Generation, &NumberHandles, &Buffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (NumberHandles, 32);
+  for (Index = 0; Index < NumberHandles; Index++) {
+    UT_ASSERT_EQUAL ((UINTN)Buffer[Index], (UINTN)Handles[32 + Index]);
+  }
+  FreePool (Buffer);
+
+  //
+  // A full ByProtocol search sees the surviving handles in installation order
+  //
+  Status = CoreLocateHandleBuffer (ByProtocol, &CommonGuid, NULL, &NumberHandles, &Buffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (NumberHandles, 56);
+  for (Index = 0; Index < NumberHandles; Index++) {
+    UT_ASSERT_EQUAL ((UINTN)Buffer[Index], (UINTN)Handles[8 + Index]);
+  }
+  FreePool (Buffer);
+
+  for (Index = 8; Index < 64; Index++) {
+    Status = CoreUninstallProtocolInterface (Handles[Index], &CommonGuid, (VOID *)(UINTN)(Index + 1));
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Verify that the protocol notifications deferred by a batch signal each
+  registered event once, that only the protocols of the batch are deferred,
+  and that the notification functions still find all the new handles.
+
+  @param[in]  Context  Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ProtocolNotifiesShouldBeCoalescedInBatches (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS                              Status;
+  EFI_GUID                                GuidA;
+  EFI_GUID                                GuidB;
+  EFI_GUID                                GuidC;
+  EFI_GUID                                *BatchGuids[2];
+  IEVENT                                  Events[3];
+  VOID                                    *Registration[4];
+  EFI_HANDLE                              HandlesA[16];
+  EFI_HANDLE                              HandlesB[18];
+  EFI_HANDLE                              Handle;
+  EFI_HANDLE                              HandleC;
+  EFI_HANDLE                              Found;
+  UINTN                                   BufferSize;
+  UINTN                                   Index;
+  UINTN                                   SignalCount;
+  EDKII_PROTOCOL_NOTIFY_BATCH_STATISTICS  Before;
+  EDKII_PROTOCOL_NOTIFY_BATCH_STATISTICS  After;
+  EDKII_PROTOCOL_NOTIFY_BATCH_TOKEN       First;
+  EDKII_PROTOCOL_NOTIFY_BATCH_TOKEN       Second;
+
+  BuildTestGuid (0x60000, &GuidA);
+  BuildTestGuid (0x60001, &GuidB);
+  BuildTestGuid (0x60002, &GuidC);
+
+  //
+  // Events[0] is registered for both GuidA and GuidB, Events[1] for GuidB
+  // only, and Events[2] for GuidC, which no batch covers
+  //
+  ZeroMem (Events, sizeof (Events));
+  Status = CoreRegisterProtocolNotify (&GuidA, &Events[0], &Registration[0]);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = CoreRegisterProtocolNotify (&GuidB, &Events[0], &Registration[1]);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = CoreRegisterProtocolNotify (&GuidB, &Events[1], &Registration[2]);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = CoreRegisterProtocolNotify (&GuidC, &Events[2], &Registration[3]);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  //
+  // A batch covers at least one protocol
+  //
+  BatchGuids[0] = &GuidB;
+  BatchGuids[1] = NULL;
+  UT_ASSERT_STATUS_EQUAL (CoreBeginProtocolNotifyBatch (NULL, 1, &First), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (CoreBeginProtocolNotifyBatch (BatchGuids, 0, &First), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (CoreBeginProtocolNotifyBatch (BatchGuids, 2, &First), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (CoreBeginProtocolNotifyBatch (BatchGuids, 1, NULL), EFI_INVALID_PARAMETER);
+
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetProtocolNotifyBatchStatistics (&Before));
+
+  //
+  // Without a batch, every installation signals the events
+  //
+  SignalCount = mStubSignalCount;
+  for (Index = 0; Index < 16; Index++) {
+    HandlesA[Index] = NULL;
+    Status = CoreInstallProtocolInterface (&HandlesA[Index], &GuidA, EFI_NATIVE_INTERFACE, (VOID *)(UINTN)(Index + 1));
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL (mStubSignalCount, SignalCount + Index + 1);
+    Events[0].SignalCount = 0;
+  }
+
+  //
+  // While the batches covering a protocol are open, its events are not
+  // signaled until the last one is closed, in any order, and then each event
+  // once.  The other protocols are notified as usual.
+  //
+  SignalCount = mStubSignalCount;
+  UT_ASSERT_NOT_EFI_ERROR (CoreBeginProtocolNotifyBatch (BatchGuids, 1, &First));
+  BatchGuids[0] = &GuidA;
+  BatchGuids[1] = &GuidB;
+  UT_ASSERT_NOT_EFI_ERROR (CoreBeginProtocolNotifyBatch (BatchGuids, 2, &Second));
+  for (Index = 0; Index < 16; Index++) {
+    HandlesB[Index] = NULL;
+    Status = CoreInstallProtocolInterface (&HandlesB[Index], &GuidB, EFI_NATIVE_INTERFACE, (VOID *)(UINTN)(Index + 1));
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+  Handle = NULL;
+  Status = CoreInstallMultipleProtocolInterfaces (&Handle, &GuidA, (VOID *)(UINTN)17, NULL);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (mStubSignalCount, SignalCount);
+
+  HandleC = NULL;
+  Status = CoreInstallProtocolInterface (&HandleC, &GuidC, EFI_NATIVE_INTERFACE, (VOID *)(UINTN)1);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (mStubSignalCount, SignalCount + 1);
+  UT_ASSERT_EQUAL (Events[2].SignalCount, 1);
+
+  UT_ASSERT_NOT_EFI_ERROR (CoreEndProtocolNotifyBatch (First));
+  UT_ASSERT_EQUAL (mStubSignalCount, SignalCount + 1);
+
+  //
+  // Only the token of an open batch closes a batch
+  //
+  UT_ASSERT_STATUS_EQUAL (CoreEndProtocolNotifyBatch (First), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (CoreEndProtocolNotifyBatch (NULL), EFI_INVALID_PARAMETER);
+  UT_ASSERT_STATUS_EQUAL (CoreEndProtocolNotifyBatch (&SignalCount), EFI_INVALID_PARAMETER);
+  UT_ASSERT_EQUAL (mStubSignalCount, SignalCount + 1);
+
+  UT_ASSERT_NOT_EFI_ERROR (CoreEndProtocolNotifyBatch (Second));
+  UT_ASSERT_EQUAL (mStubSignalCount, SignalCount + 3);
+  UT_ASSERT_EQUAL (Events[0].SignalCount, 1);
+  UT_ASSERT_EQUAL (Events[1].SignalCount, 1);
+  UT_ASSERT_STATUS_EQUAL (CoreEndProtocolNotifyBatch (Second), EFI_INVALID_PARAMETER);
+
+  //
+  // The batches suppressed the 15 signals of Events[1] beyond its first.
+  // GuidA signaled Events[0] first, so the 16 deferred signals of GuidB found
+  // it signaled and would have been ignored.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetProtocolNotifyBatchStatistics (&After));
+  UT_ASSERT_EQUAL (After.SignalCount, Before.SignalCount + 16 + 3);
+  UT_ASSERT_EQUAL (After.SavedSignalCount, Before.SavedSignalCount + 15);
+  UT_ASSERT_EQUAL (After.BatchCount, Before.BatchCount + 2);
+
+  //
+  // The notification function of Events[1] finds all the handles of GuidB
+  //
+  for (Index = 0; ; Index++) {
+    BufferSize = sizeof (Found);
+    Status = CoreLocateHandle (ByRegisterNotify, NULL, Registration[2], &BufferSize, &Found);
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+    UT_ASSERT_TRUE (Index < 16);
+    UT_ASSERT_EQUAL ((UINTN)Found, (UINTN)HandlesB[Index]);
+  }
+  UT_ASSERT_EQUAL (Index, 16);
+
+  //
+  // The signals deferred for an event that is still signaled when the batch
+  // is closed are not counted as saved
+  //
+  Events[0].SignalCount = 0;
+  Before = After;
+  SignalCount = mStubSignalCount;
+  UT_ASSERT_NOT_EFI_ERROR (CoreBeginProtocolNotifyBatch (&BatchGuids[1], 1, &First));
+  for (Index = 16; Index < 18; Index++) {
+    HandlesB[Index] = NULL;
+    Status = CoreInstallProtocolInterface (&HandlesB[Index], &GuidB, EFI_NATIVE_INTERFACE, (VOID *)(UINTN)(Index + 1));
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+  UT_ASSERT_NOT_EFI_ERROR (CoreEndProtocolNotifyBatch (First));
+  UT_ASSERT_EQUAL (mStubSignalCount, SignalCount + 1);
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetProtocolNotifyBatchStatistics (&After));
+  UT_ASSERT_EQUAL (After.SignalCount, Before.SignalCount + 1);
+  UT_ASSERT_EQUAL (After.SavedSignalCount, Before.SavedSignalCount + 1);
+
+  UT_ASSERT_NOT_EFI_ERROR (CoreUnregisterProtocolNotify (&Events[0]));
+  UT_ASSERT_NOT_EFI_ERROR (CoreUnregisterProtocolNotify (&Events[1]));
+  UT_ASSERT_NOT_EFI_ERROR (CoreUnregisterProtocolNotify (&Events[2]));
+  UT_ASSERT_NOT_EFI_ERROR (CoreUninstallProtocolInterface (Handle, &GuidA, (VOID *)(UINTN)17));
+  UT_ASSERT_NOT_EFI_ERROR (CoreUninstallProtocolInterface (HandleC, &GuidC, (VOID *)(UINTN)1));
+  UT_ASSERT_NOT_EFI_ERROR (DestroyHandles (16, &GuidA, HandlesA));
+  UT_ASSERT_NOT_EFI_ERROR (DestroyHandles (18, &GuidB, HandlesB));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Measure the average cost of a HandleProtocol() lookup with a growing number
+  of handles in the handle database.  The results are only reported, since
+  timings on a build host are too noisy to fail a test on.
+
+  @param[in]  Context  Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+HandleProtocolLookupCost (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  EFI_GUID    CommonGuid;
+  EFI_GUID    OtherGuid;
+  EFI_HANDLE  *Handles;
+  UINTN       Count;
+  UINTN       CountIndex;
+  UINTN       Index;
+  UINTN       Lookup;
+  VOID        *Interface;
+  UINT32      NanoSeconds;
+  clock_t     Start;
+  clock_t     End;
+
+  BuildTestGuid (0x50000, &CommonGuid);
+  BuildTestGuid (0x50001, &OtherGuid);
+
+  for (CountIndex = 0; CountIndex < ARRAY_SIZE (mBenchmarkHandleCounts); CountIndex++) {
+    Count   = mBenchmarkHandleCounts[CountIndex];
+    Handles = AllocatePool (Count * sizeof (EFI_HANDLE));
+    UT_ASSERT_NOT_NULL (Handles);
+
+    Status = CreateHandles (Count, &CommonGuid, Handles);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+
+    Start = clock ();
+    for (Lookup = 0, Index = 0; Lookup < BENCHMARK_LOOKUP_COUNT; Lookup++) {
+      Index = (Index + 7919) % Count;
+      Status = CoreHandleProtocol (Handles[Index], &CommonGuid, &Interface);
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+      Status = CoreHandleProtocol (Handles[Index], &OtherGuid, &Interface);
+      UT_ASSERT_STATUS_EQUAL (Status, EFI_UNSUPPORTED);
+    }
+    End = clock ();
+
+    NanoSeconds = (UINT32)((UINT64)(End - Start) * (1000000000ULL / CLOCKS_PER_SEC) / (2 * BENCHMARK_LOOKUP_COUNT));
+    UT_LOG_INFO ("%5d handles: %d ns per HandleProtocol()\n", (UINT32)Count, NanoSeconds);
+    DEBUG ((DEBUG_INFO, "%5d handles: %d ns per HandleProtocol()\n", (UINT32)Count, NanoSeconds));
+
+    Status = DestroyHandles (Count, &CommonGuid, Handles);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    FreePool (Handles);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the DXE Core
+  handle database and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      DatabaseTests;
+  UNIT_TEST_SUITE_HANDLE      BenchmarkTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&DatabaseTests, Framework, "Handle Database Tests", "DxeCore.HandleDatabase", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for DatabaseTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (DatabaseTests, "Install, locate and uninstall should be consistent", "Consistency", InstallLocateUninstallShouldBeConsistent, NULL, NULL, NULL);
+  AddTestCase (DatabaseTests, "Many protocols on one handle should be found", "ManyProtocols", ManyProtocolsOnOneHandleShouldBeFound, NULL, NULL, NULL);
+  AddTestCase (DatabaseTests, "Handle validation should survive removal", "Validation", HandleValidationShouldSurviveRemoval, NULL, NULL, NULL);
+  AddTestCase (DatabaseTests, "Locate since a generation should return new handles", "Generation", LocateSinceGenerationShouldReturnNewHandles, NULL, NULL, NULL);
+  AddTestCase (DatabaseTests, "Protocol notifies should be coalesced in batches", "NotifyBatch", ProtocolNotifiesShouldBeCoalescedInBatches, NULL, NULL, NULL);
+
+  Status = CreateUnitTestSuite (&BenchmarkTests, Framework, "Handle Database Benchmarks", "DxeCore.HandleDatabase.Benchmark", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BenchmarkTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (BenchmarkTests, "HandleProtocol lookup cost by handle count", "LookupCost", HandleProtocolLookupCost, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,177 @@
+/** @file
+  Host based stand-ins for the DXE Core services that the handle database
+  (Hand/Handle.c, Hand/Locate.c and Hand/Notify.c) depends on.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeMain.h"
+#include "Event.h"
+
+//
+// Image handle of the DXE Core.  Leaving it NULL makes CoreHandleProtocol()
+// skip the open protocol bookkeeping, which is irrelevant for these tests.
+//
+EFI_HANDLE  gDxeCoreImageHandle = NULL;
+
+//
+// Current task priority level
+//
+EFI_TPL     mStubTpl = TPL_APPLICATION;
+
+//
+// Number of events signaled
+//
+UINTN       mStubSignalCount;
+
+/**
+  Raise the task priority level to the new level.
+
+  @param  NewTpl  New task priority level
+
+  @return The previous task priority level
+
+**/
+EFI_TPL
+EFIAPI
+CoreRaiseTpl (
+  IN EFI_TPL      NewTpl
+  )
+{
+  EFI_TPL     OldTpl;
+
+  OldTpl   = mStubTpl;
+  ASSERT (OldTpl <= NewTpl);
+  mStubTpl = NewTpl;
+  return OldTpl;
+}
+
+/**
+  Lowers the task priority to the previous value.
+
+  @param  NewTpl  New, lower, task priority
+
+**/
+VOID
+EFIAPI
+CoreRestoreTpl (
+  IN EFI_TPL NewTpl
+  )
+{
+  ASSERT (NewTpl <= mStubTpl);
+  mStubTpl = NewTpl;
+}
+
+/**
+  Frees pool.
+
+  @param  Buffer                 The allocated pool entry to free
+
+  @retval EFI_SUCCESS            Pool successfully freed.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreFreePool (
+  IN VOID        *Buffer
+  )
+{
+  FreePool (Buffer);
+  return EFI_SUCCESS;
+}
+
+/**
+  Signals the event.  There are no events to dispatch in the host environment,
+  so the event stays signaled until the test clears its SignalCount.
+
+  @param  UserEvent              The event to signal .
+
+  @retval EFI_SUCCESS            The event was signaled.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreSignalEvent (
+  IN EFI_EVENT    UserEvent
+  )
+{
+  IEVENT  *Event;
+
+  Event = UserEvent;
+  if (Event->SignalCount == 0) {
+    Event->SignalCount++;
+    mStubSignalCount++;
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Marks the dependency expressions that push a protocol as changed.  There
+  is no DXE Dispatcher in the host environment.
+
+  @param  Protocol              The GUID of the protocol installed.
+
+**/
+VOID
+CoreDepexProtocolInstalled (
+  IN CONST EFI_GUID  *Protocol
+  )
+{
+}
+
+/**
+  Connects one or more drivers to a controller.  No drivers are present in
+  the host environment.
+
+  @param  ControllerHandle      The handle of the controller to which driver(s) are to be connected.
+  @param  DriverImageHandle     A pointer to an ordered list handles that support the
+                                EFI_DRIVER_BINDING_PROTOCOL.
+  @param  RemainingDevicePath   A pointer to the device path that specifies a child of the
+                                controller specified by ControllerHandle.
+  @param  Recursive             If TRUE, then ConnectController() is called recursively
+                                until the entire tree of controllers below the controller specified
+                                by ControllerHandle have been created.
+
+  @retval EFI_NOT_FOUND         No driver was connected to ControllerHandle.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreConnectController (
+  IN  EFI_HANDLE                ControllerHandle,
+  IN  EFI_HANDLE                *DriverImageHandle    OPTIONAL,
+  IN  EFI_DEVICE_PATH_PROTOCOL  *RemainingDevicePath  OPTIONAL,
+  IN  BOOLEAN                   Recursive
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Disonnects a controller from a driver.  No drivers are present in the host
+  environment.
+
+  @param  ControllerHandle                      ControllerHandle The handle of
+                                                the controller from which
+                                                driver(s)  are to be
+                                                disconnected.
+  @param  DriverImageHandle                     DriverImageHandle The driver to
+                                                disconnect from ControllerHandle.
+  @param  ChildHandle                           ChildHandle The handle of the
+                                                child to destroy.
+
+  @retval EFI_SUCCESS                           No driver is managing ControllerHandle.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreDisconnectController (
+  IN  EFI_HANDLE  ControllerHandle,
+  IN  EFI_HANDLE  DriverImageHandle  OPTIONAL,
+  IN  EFI_HANDLE  ChildHandle        OPTIONAL
+  )
+{
+  return EFI_SUCCESS;
+}
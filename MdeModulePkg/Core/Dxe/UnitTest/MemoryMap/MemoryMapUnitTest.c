@@ -0,0 +1,566 @@
+/** @file
+  Host based unit tests of the DXE Core page allocator and memory map.
+
+  A fragmented memory map is built over a buffer of the host heap.  Pages are
+  then allocated and freed at random, and every allocation is checked against
+  a walk of the memory map entries.  The benchmark reports the cost of
+  allocating and freeing pages in that map.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include "DxeMain.h"
+#include "Imem.h"
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME        "DXE Core Memory Map Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Size of the memory handed to the page allocator, and largest size of the
+// ranges it is handed in
+//
+#define MEMORY_TEST_PAGES         0x8000
+#define MEMORY_TEST_MAX_CHUNK     32
+
+//
+// Number of live allocations and of random operations in the tests
+//
+#define MEMORY_TEST_LIVE_COUNT    1024
+#define MEMORY_TEST_OP_COUNT      20000
+
+//
+// Number of FreePages()/AllocatePages() pairs timed by the benchmark
+//
+#define BENCHMARK_PAGES_COUNT     20000
+
+typedef struct {
+  EFI_PHYSICAL_ADDRESS  Memory;
+  UINTN                 NumberOfPages;
+} MEMORY_TEST_ALLOCATION;
+
+//
+// Memory types allocated by the tests
+//
+EFI_MEMORY_TYPE  mMemoryTestTypes[] = {
+  EfiBootServicesData,
+  EfiBootServicesCode,
+  EfiLoaderData,
+  EfiACPIReclaimMemory
+};
+
+//
+// Memory handed to the page allocator
+//
+EFI_PHYSICAL_ADDRESS    mMemoryTestBase;
+
+//
+// Live allocations
+//
+MEMORY_TEST_ALLOCATION  mMemoryTestLive[MEMORY_TEST_LIVE_COUNT];
+
+//
+// State of the pseudo random number generator
+//
+UINT32  mMemoryTestSeed;
+
+/**
+  Return the next pseudo random number.
+
+  @return A pseudo random number in the range 0..0x7FFF.
+
+**/
+STATIC
+UINT32
+MemoryTestRandom (
+  VOID
+  )
+{
+  mMemoryTestSeed = mMemoryTestSeed * 1103515245 + 12345;
+  return (mMemoryTestSeed >> 16) & 0x7FFF;
+}
+
+/**
+  Return a pseudo random allocation size, mostly a few pages with a tail of
+  larger requests.
+
+  @return The number of pages to allocate.
+
+**/
+STATIC
+UINTN
+MemoryTestRandomPages (
+  VOID
+  )
+{
+  if ((MemoryTestRandom () % 8) != 0) {
+    return 1 + MemoryTestRandom () % 4;
+  }
+  return 1 + MemoryTestRandom () % 64;
+}
+
+/**
+  Return the memory map.
+
+  @param[out]  DescriptorSize  The size of a descriptor of the memory map.
+  @param[out]  Count           The number of descriptors in the memory map.
+
+  @return The memory map, to be freed with FreePool(), or NULL.
+
+**/
+STATIC
+EFI_MEMORY_DESCRIPTOR *
+GetMemoryMapSnapshot (
+  OUT UINTN  *DescriptorSize,
+  OUT UINTN  *Count
+  )
+{
+  EFI_STATUS             Status;
+  EFI_MEMORY_DESCRIPTOR  *MemoryMap;
+  UINTN                  MemoryMapSize;
+  UINTN                  MapKey;
+  UINT32                 DescriptorVersion;
+
+  MemoryMapSize = 0;
+  Status = CoreGetMemoryMap (&MemoryMapSize, NULL, &MapKey, DescriptorSize, &DescriptorVersion);
+  if (Status != EFI_BUFFER_TOO_SMALL) {
+    return NULL;
+  }
+
+  MemoryMap = AllocatePool (MemoryMapSize);
+  if (MemoryMap == NULL) {
+    return NULL;
+  }
+
+  Status = CoreGetMemoryMap (&MemoryMapSize, MemoryMap, &MapKey, DescriptorSize, &DescriptorVersion);
+  if (EFI_ERROR (Status)) {
+    FreePool (MemoryMap);
+    return NULL;
+  }
+
+  *Count = MemoryMapSize / *DescriptorSize;
+  return MemoryMap;
+}
+
+/**
+  Find the highest free page range below an address by going through all the
+  entries of the memory map.
+
+  @param[in]  MaxAddress      The last address the range may cover.
+  @param[in]  NumberOfPages   The number of pages of the range.
+
+  @return The base address of the range, or 0 if there is none.
+
+**/
+STATIC
+EFI_PHYSICAL_ADDRESS
+FindHighestFreePages (
+  IN EFI_PHYSICAL_ADDRESS   MaxAddress,
+  IN UINTN                  NumberOfPages
+  )
+{
+  LIST_ENTRY             *Link;
+  MEMORY_MAP             *Entry;
+  EFI_PHYSICAL_ADDRESS   End;
+  EFI_PHYSICAL_ADDRESS   Best;
+  UINT64                 Bytes;
+
+  Best  = 0;
+  Bytes = EFI_PAGES_TO_SIZE (NumberOfPages);
+  for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
+    Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
+    if (Entry->Type != EfiConventionalMemory) {
+      continue;
+    }
+
+    End = MIN (Entry->End, MaxAddress);
+    if (End < Entry->Start || End - Entry->Start + 1 < Bytes) {
+      continue;
+    }
+    Best = MAX (Best, End + 1 - Bytes);
+  }
+
+  return Best;
+}
+
+/**
+  Check whether a page range lies in a single free entry of the memory map.
+
+  @param[in]  Memory          The base address of the range.
+  @param[in]  NumberOfPages   The number of pages of the range.
+
+  @retval TRUE   The range is free.
+  @retval FALSE  The range is not free, or spans several entries.
+
+**/
+STATIC
+BOOLEAN
+IsRangeFree (
+  IN EFI_PHYSICAL_ADDRESS   Memory,
+  IN UINTN                  NumberOfPages
+  )
+{
+  LIST_ENTRY             *Link;
+  MEMORY_MAP             *Entry;
+
+  for (Link = gMemoryMap.ForwardLink; Link != &gMemoryMap; Link = Link->ForwardLink) {
+    Entry = CR (Link, MEMORY_MAP, Link, MEMORY_MAP_SIGNATURE);
+    if (Entry->Type == EfiConventionalMemory &&
+        Memory >= Entry->Start &&
+        Memory + EFI_PAGES_TO_SIZE (NumberOfPages) - 1 <= Entry->End) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/**
+  Count the pages of the memory map returned by CoreGetMemoryMap().
+
+  @return The total number of pages of the memory map, or 0 on error.
+
+**/
+STATIC
+UINT64
+CountMemoryMapPages (
+  VOID
+  )
+{
+  EFI_MEMORY_DESCRIPTOR  *MemoryMap;
+  UINTN                  DescriptorSize;
+  UINTN                  Count;
+  UINT64                 Pages;
+  UINTN                  Index;
+
+  MemoryMap = GetMemoryMapSnapshot (&DescriptorSize, &Count);
+  if (MemoryMap == NULL) {
+    return 0;
+  }
+
+  Pages = 0;
+  for (Index = 0; Index < Count; Index++) {
+    Pages += ((EFI_MEMORY_DESCRIPTOR *)((UINT8 *)MemoryMap + Index * DescriptorSize))->NumberOfPages;
+  }
+  FreePool (MemoryMap);
+
+  return Pages;
+}
+
+/**
+  Verify that pages are allocated from the top of the free memory below the
+  requested address, at the requested address when it is free, and that the
+  memory map keeps covering the same pages while they are allocated and freed
+  at random.  The expected results come from a walk of gMemoryMap.
+
+  @param[in]  Context  Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+AllocatePagesShouldPickHighestFit (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS              Status;
+  UINTN                   Op;
+  UINTN                   Index;
+  UINTN                   NumberOfPages;
+  EFI_ALLOCATE_TYPE       AllocateType;
+  EFI_PHYSICAL_ADDRESS    Memory;
+  EFI_PHYSICAL_ADDRESS    Expected;
+  BOOLEAN                 Free;
+
+  mMemoryTestSeed = 1;
+
+  for (Op = 0; Op < MEMORY_TEST_OP_COUNT; Op++) {
+    if ((Op % 1000) == 0) {
+      UT_ASSERT_EQUAL (CountMemoryMapPages (), MEMORY_TEST_PAGES);
+    }
+
+    Index = MemoryTestRandom () % MEMORY_TEST_LIVE_COUNT;
+    if (mMemoryTestLive[Index].NumberOfPages != 0) {
+      Status = CoreFreePages (mMemoryTestLive[Index].Memory, mMemoryTestLive[Index].NumberOfPages);
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+      mMemoryTestLive[Index].NumberOfPages = 0;
+      continue;
+    }
+
+    NumberOfPages = MemoryTestRandomPages ();
+    Memory        = mMemoryTestBase + EFI_PAGES_TO_SIZE ((MemoryTestRandom () % MEMORY_TEST_PAGES) + 1) - 1;
+    switch (MemoryTestRandom () % 4) {
+    case 0:
+      AllocateType = AllocateAddress;
+      Memory      &= ~(UINT64)EFI_PAGE_MASK;
+      Free         = IsRangeFree (Memory, NumberOfPages);
+      Expected     = Free ? Memory : 0;
+      break;
+    case 1:
+      AllocateType = AllocateMaxAddress;
+      Expected     = FindHighestFreePages (Memory, NumberOfPages);
+      break;
+    default:
+      AllocateType = AllocateAnyPages;
+      Expected     = FindHighestFreePages (MAX_ALLOC_ADDRESS, NumberOfPages);
+      break;
+    }
+
+    Status = CoreAllocatePages (
+               AllocateType,
+               mMemoryTestTypes[MemoryTestRandom () % ARRAY_SIZE (mMemoryTestTypes)],
+               NumberOfPages,
+               &Memory
+               );
+    if (Expected == 0) {
+      UT_ASSERT_TRUE (EFI_ERROR (Status));
+      continue;
+    }
+
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    UT_ASSERT_EQUAL (Memory, Expected);
+    mMemoryTestLive[Index].Memory        = Memory;
+    mMemoryTestLive[Index].NumberOfPages = NumberOfPages;
+  }
+
+  for (Index = 0; Index < MEMORY_TEST_LIVE_COUNT; Index++) {
+    if (mMemoryTestLive[Index].NumberOfPages != 0) {
+      Status = CoreFreePages (mMemoryTestLive[Index].Memory, mMemoryTestLive[Index].NumberOfPages);
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+      mMemoryTestLive[Index].NumberOfPages = 0;
+    }
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Verify that freeing pages that are not allocated fails.
+
+  @param[in]  Context  Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FreePagesShouldRejectFreeMemory (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS            Status;
+  EFI_PHYSICAL_ADDRESS  Memory;
+
+  Status = CoreAllocatePages (AllocateAnyPages, EfiBootServicesData, 4, &Memory);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = CoreFreePages (Memory, 4);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  Status = CoreFreePages (Memory, 4);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+  Status = CoreFreePages (mMemoryTestBase + EFI_PAGES_TO_SIZE (MEMORY_TEST_PAGES), 1);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_NOT_FOUND);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Measure the cost of freeing and allocating a few pages at a time in the
+  fragmented memory map.  The results are only reported, since timings on a build host are too
+  noisy to fail a test on.
+
+  @param[in]  Context  Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+AllocatePagesCost (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS             Status;
+  EFI_MEMORY_DESCRIPTOR  *MemoryMap;
+  UINTN                  DescriptorSize;
+  UINTN                  Count;
+  UINTN                  Churn;
+  UINTN                  Index;
+  UINT32                 NanoSeconds;
+  clock_t                Start;
+  clock_t                End;
+
+  mMemoryTestSeed = 1;
+
+  for (Index = 0; Index < MEMORY_TEST_LIVE_COUNT; Index++) {
+    mMemoryTestLive[Index].NumberOfPages = 1 + MemoryTestRandom () % 4;
+    Status = CoreAllocatePages (
+               AllocateAnyPages,
+               mMemoryTestTypes[Index % ARRAY_SIZE (mMemoryTestTypes)],
+               mMemoryTestLive[Index].NumberOfPages,
+               &mMemoryTestLive[Index].Memory
+               );
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  MemoryMap = GetMemoryMapSnapshot (&DescriptorSize, &Count);
+  UT_ASSERT_NOT_NULL (MemoryMap);
+  FreePool (MemoryMap);
+
+  Start = clock ();
+  for (Churn = 0; Churn < BENCHMARK_PAGES_COUNT; Churn++) {
+    Index  = MemoryTestRandom () % MEMORY_TEST_LIVE_COUNT;
+    Status = CoreFreePages (mMemoryTestLive[Index].Memory, mMemoryTestLive[Index].NumberOfPages);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    mMemoryTestLive[Index].NumberOfPages = 1 + MemoryTestRandom () % 4;
+    Status = CoreAllocatePages (
+               AllocateAnyPages,
+               mMemoryTestTypes[Index % ARRAY_SIZE (mMemoryTestTypes)],
+               mMemoryTestLive[Index].NumberOfPages,
+               &mMemoryTestLive[Index].Memory
+               );
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+  End = clock ();
+
+  NanoSeconds = (UINT32)((UINT64)(End - Start) * (1000000000ULL / CLOCKS_PER_SEC) / BENCHMARK_PAGES_COUNT);
+  UT_LOG_INFO ("%d ns per FreePages()/AllocatePages() with %d memory map descriptors\n", NanoSeconds, (UINT32)Count);
+  DEBUG ((DEBUG_INFO, "%d ns per FreePages()/AllocatePages() with %d memory map descriptors\n", NanoSeconds, (UINT32)Count));
+
+  for (Index = 0; Index < MEMORY_TEST_LIVE_COUNT; Index++) {
+    Status = CoreFreePages (mMemoryTestLive[Index].Memory, mMemoryTestLive[Index].NumberOfPages);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    mMemoryTestLive[Index].NumberOfPages = 0;
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Hand a buffer of the host heap to the page allocator, in ranges of random
+  sizes whose attributes alternate so that they are not merged.
+
+  @retval  EFI_SUCCESS           The memory map was built.
+  @retval  EFI_OUT_OF_RESOURCES  The buffer could not be allocated.
+**/
+STATIC
+EFI_STATUS
+BuildFragmentedMemoryMap (
+  VOID
+  )
+{
+  UINTN   Page;
+  UINTN   Pages;
+  UINTN   Chunk;
+
+  mMemoryTestBase = (EFI_PHYSICAL_ADDRESS)(UINTN)AllocateAlignedPages (MEMORY_TEST_PAGES, SIZE_64KB);
+  if (mMemoryTestBase == 0) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mMemoryTestSeed = 1;
+  for (Page = 0, Chunk = 0; Page < MEMORY_TEST_PAGES; Page += Pages, Chunk++) {
+    Pages = MIN (1 + MemoryTestRandom () % MEMORY_TEST_MAX_CHUNK, MEMORY_TEST_PAGES - Page);
+    CoreAddMemoryDescriptor (
+      EfiConventionalMemory,
+      mMemoryTestBase + EFI_PAGES_TO_SIZE (Page),
+      Pages,
+      ((Chunk % 2) == 0) ? EFI_MEMORY_WB : EFI_MEMORY_WB | EFI_MEMORY_XP
+      );
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  page allocator and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      MemoryMapTests;
+  UNIT_TEST_SUITE_HANDLE      BenchmarkTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = BuildFragmentedMemoryMap ();
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed to build the memory map. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&MemoryMapTests, Framework, "Memory Map Tests", "DxeCore.MemoryMap", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for MemoryMapTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (MemoryMapTests, "AllocatePages should pick the highest fit", "HighestFit", AllocatePagesShouldPickHighestFit, NULL, NULL, NULL);
+  AddTestCase (MemoryMapTests, "FreePages should reject free memory", "FreeOfFree", FreePagesShouldRejectFreeMemory, NULL, NULL, NULL);
+
+  Status = CreateUnitTestSuite (&BenchmarkTests, Framework, "Memory Map Benchmarks", "DxeCore.MemoryMap.Benchmark", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BenchmarkTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (BenchmarkTests, "FreePages/AllocatePages cost in a fragmented map", "PagesChurn", AllocatePagesCost, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
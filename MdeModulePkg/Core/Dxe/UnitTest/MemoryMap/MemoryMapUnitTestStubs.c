@@ -0,0 +1,370 @@
+/** @file
+  Host based stand-ins for the DXE Core services that the page allocator
+  (Mem/Page.c) depends on.  There is no GCD memory space map, no Heap Guard
+  and no memory profile in the host environment.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeMain.h"
+#include "Imem.h"
+#include "HeapGuard.h"
+
+//
+// Image handle of the DXE Core
+//
+EFI_HANDLE  gDxeCoreImageHandle = NULL;
+
+//
+// Load Module At Fixed Address is never enabled in the host environment
+//
+EFI_LOAD_FIXED_ADDRESS_CONFIGURATION_TABLE    gLoadModuleAtFixAddressConfigurationTable = {0, 0};
+
+//
+// The GCD memory space map stays empty, so no untested memory is ever
+// promoted and no reserved or MMIO ranges are added to the memory map
+//
+LIST_ENTRY  mGcdMemorySpaceMap = INITIALIZE_LIST_HEAD_VARIABLE (mGcdMemorySpaceMap);
+
+//
+// Heap Guard is never enabled in the host environment
+//
+BOOLEAN     mOnGuarding = FALSE;
+
+//
+// Current task priority level
+//
+EFI_TPL     mStubTpl = TPL_APPLICATION;
+
+/**
+  Raise the task priority level to the new level.
+
+  @param  NewTpl  New task priority level
+
+  @return The previous task priority level
+
+**/
+EFI_TPL
+EFIAPI
+CoreRaiseTpl (
+  IN EFI_TPL      NewTpl
+  )
+{
+  EFI_TPL     OldTpl;
+
+  OldTpl   = mStubTpl;
+  ASSERT (OldTpl <= NewTpl);
+  mStubTpl = NewTpl;
+  return OldTpl;
+}
+
+/**
+  Lowers the task priority to the previous value.
+
+  @param  NewTpl  New, lower, task priority
+
+**/
+VOID
+EFIAPI
+CoreRestoreTpl (
+  IN EFI_TPL NewTpl
+  )
+{
+  ASSERT (NewTpl <= mStubTpl);
+  mStubTpl = NewTpl;
+}
+
+/**
+  Acquire memory lock on mGcdMemorySpaceLock.
+
+**/
+VOID
+CoreAcquireGcdMemoryLock (
+  VOID
+  )
+{
+}
+
+/**
+  Release memory lock on mGcdMemorySpaceLock.
+
+**/
+VOID
+CoreReleaseGcdMemoryLock (
+  VOID
+  )
+{
+}
+
+/**
+  Retrieves the descriptor for a memory region containing a specified address.
+  The GCD memory space map is empty in the host environment.
+
+  @param  BaseAddress            Specified start address
+  @param  Descriptor             Specified length
+
+  @retval EFI_NOT_FOUND          No descriptor covers BaseAddress.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreGetMemorySpaceDescriptor (
+  IN  EFI_PHYSICAL_ADDRESS             BaseAddress,
+  OUT EFI_GCD_MEMORY_SPACE_DESCRIPTOR  *Descriptor
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Signals all events in the EventGroup.  There are no events in the host
+  environment.
+
+  @param  EventGroup             The list to signal
+
+**/
+VOID
+CoreNotifySignalList (
+  IN EFI_GUID     *EventGroup
+  )
+{
+}
+
+/**
+  Merge continous memory map entries whose have same attributes.  The
+  properties table is never enabled in the host environment.
+
+  @param  MemoryMap       A pointer to the buffer in which firmware places
+                          the current memory map.
+  @param  MemoryMapSize   A pointer to the size, in bytes, of the
+                          MemoryMap buffer. On input, this is the size of
+                          the current memory map.  On output,
+                          it is the size of new memory map after merge.
+  @param  DescriptorSize  Size, in bytes, of an individual EFI_MEMORY_DESCRIPTOR.
+**/
+VOID
+MergeMemoryMap (
+  IN OUT EFI_MEMORY_DESCRIPTOR  *MemoryMap,
+  IN OUT UINTN                  *MemoryMapSize,
+  IN UINTN                      DescriptorSize
+  )
+{
+}
+
+/**
+  Check to see if the heap guard is enabled for page and/or pool allocation.
+
+  @param[in]  GuardType   Specify the sub-type(s) of Heap Guard.
+
+  @return FALSE   Heap Guard is never enabled in the host environment.
+**/
+BOOLEAN
+IsHeapGuardEnabled (
+  UINT8           GuardType
+  )
+{
+  return FALSE;
+}
+
+/**
+  Check to see if the page at the given address should be guarded or not.
+
+  @param[in]  MemoryType      Page type to check.
+  @param[in]  AllocateType    Allocation type to check.
+
+  @return FALSE   Pages are never guarded in the host environment.
+**/
+BOOLEAN
+IsPageTypeToGuard (
+  IN EFI_MEMORY_TYPE        MemoryType,
+  IN EFI_ALLOCATE_TYPE      AllocateType
+  )
+{
+  return FALSE;
+}
+
+/**
+  Check to see if the memory at the given address should be guarded or not.
+
+  @param[in]  Address   The address to check.
+
+  @return FALSE   Memory is never guarded in the host environment.
+**/
+BOOLEAN
+EFIAPI
+IsMemoryGuarded (
+  IN EFI_PHYSICAL_ADDRESS    Address
+  )
+{
+  return FALSE;
+}
+
+/**
+  Adjust the start address and number of pages to allocate according to
+  Guard.  Never called, since pages are never guarded.
+
+  @param[in]  Start           Start address of free memory block.
+  @param[in]  Size            Size of free memory block.
+  @param[in]  SizeRequested   Size of memory to allocate.
+
+  @return 0   No memory is ever allocated with Guard.
+**/
+UINT64
+AdjustMemoryS (
+  IN UINT64                  Start,
+  IN UINT64                  Size,
+  IN UINT64                  SizeRequested
+  )
+{
+  ASSERT (FALSE);
+  return 0;
+}
+
+/**
+  Set head Guard and tail Guard for the given memory range.  Never called,
+  since pages are never guarded.
+
+  @param[in]  Memory          Base address of memory to set guard for.
+  @param[in]  NumberOfPages   Memory size in pages.
+**/
+VOID
+SetGuardForMemory (
+  IN EFI_PHYSICAL_ADDRESS   Memory,
+  IN UINTN                  NumberOfPages
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Convert the memory range with Guard.  Guard pages are never set in the
+  host environment, so this is a plain conversion.
+
+  @param[in]  Start           Start address of memory to convert.
+  @param[in]  NumberOfPages   Number of pages to convert.
+  @param[in]  NewType         New memory type to convert to.
+
+  @return Status returned by CoreConvertPages.
+**/
+EFI_STATUS
+CoreConvertPagesWithGuard (
+  IN UINT64           Start,
+  IN UINTN            NumberOfPages,
+  IN EFI_MEMORY_TYPE  NewType
+  )
+{
+  return CoreConvertPages (Start, NumberOfPages, NewType);
+}
+
+/**
+  Check to see if the freed-memory guard needs to be set for the given pages.
+
+  @param[in]  BaseAddress     Base address of the freed pages.
+  @param[in]  Pages           Number of freed pages.
+
+**/
+VOID
+EFIAPI
+GuardFreedPagesChecked (
+  IN  EFI_PHYSICAL_ADDRESS    BaseAddress,
+  IN  UINTN                   Pages
+  )
+{
+}
+
+/**
+  Put part (at most 64 pages a time) guarded free pages back to free page pool.
+  There are no guarded free pages in the host environment.
+
+  @param[out]  StartAddress   Start address of promoted memory.
+  @param[out]  EndAddress     End address of promoted memory.
+
+  @return FALSE   No free pages were promoted.
+**/
+BOOLEAN
+PromoteGuardedFreePages (
+  OUT EFI_PHYSICAL_ADDRESS      *StartAddress,
+  OUT EFI_PHYSICAL_ADDRESS      *EndAddress
+  )
+{
+  return FALSE;
+}
+
+/**
+  Dump the guarded memory bit map.  There is none in the host environment.
+
+**/
+VOID
+EFIAPI
+DumpGuardedMemoryBitmap (
+  VOID
+  )
+{
+}
+
+/**
+  Manage memory permission attributes on a memory range.  There are no page
+  tables in the host environment.
+
+  @param  OldType           The old memory type of the range
+  @param  NewType           The new memory type of the range
+  @param  Memory            The base address of the memory range
+  @param  Length            The size of the memory range
+
+  @retval EFI_SUCCESS       Nothing needed to be done.
+
+**/
+EFI_STATUS
+EFIAPI
+ApplyMemoryProtectionPolicy (
+  IN  EFI_MEMORY_TYPE       OldType,
+  IN  EFI_MEMORY_TYPE       NewType,
+  IN  EFI_PHYSICAL_ADDRESS  Memory,
+  IN  UINT64                Length
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  Update memory profile information.  Memory profiling is not supported in
+  the host environment.
+
+  @param CallerAddress  Address of caller who call Allocate or Free.
+  @param Action         This Allocate or Free action.
+  @param MemoryType     Memory type.
+  @param Size           Buffer size.
+  @param Buffer         Buffer address.
+  @param ActionString   String for memory profile action.
+
+  @return EFI_UNSUPPORTED   Memory profile is unsupported.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreUpdateProfile (
+  IN EFI_PHYSICAL_ADDRESS   CallerAddress,
+  IN MEMORY_PROFILE_ACTION  Action,
+  IN EFI_MEMORY_TYPE        MemoryType,
+  IN UINTN                  Size,
+  IN VOID                   *Buffer,
+  IN CHAR8                  *ActionString OPTIONAL
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  Install MemoryAttributesTable on memory allocation.  There is no system
+  table to install it in the host environment.
+
+  @param[in] MemoryType EFI memory type.
+**/
+VOID
+InstallMemoryAttributesTableOnMemoryAllocation (
+  IN EFI_MEMORY_TYPE    MemoryType
+  )
+{
+}
@@ -0,0 +1,486 @@
+/** @file
+  Host based unit tests of the DXE Core pool allocator.
+
+  The pool services are checked both for a pool type served from slabs and
+  for a pool type served from the free lists, and the churn benchmark reports
+  the throughput and the peak page usage of both.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include "DxeMain.h"
+#include "Imem.h"
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME        "DXE Core Pool Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Number of live allocations in the consistency test and the benchmark
+//
+#define POOL_TEST_LIVE_COUNT      4096
+
+//
+// Number of free/allocate pairs timed by the churn benchmark
+//
+#define BENCHMARK_CHURN_COUNT     0x200000
+
+//
+// Page usage of the pool allocator, maintained by the page allocator stubs
+//
+extern UINTN  mPoolTestPagesInUse;
+extern UINTN  mPoolTestPeakPages;
+extern UINTN  mPoolTestPageCalls;
+
+typedef struct {
+  EFI_MEMORY_TYPE   PoolType;
+  CHAR8             *Backend;
+} POOL_TEST_CONTEXT;
+
+//
+// EfiBootServicesData is selected by PcdPoolSlabType in the host test DSC, and
+// EfiLoaderData is not
+//
+POOL_TEST_CONTEXT  mSlabContext     = { EfiBootServicesData, "slab" };
+POOL_TEST_CONTEXT  mFreeListContext = { EfiLoaderData,       "free list" };
+
+//
+// State of the pseudo random number generator
+//
+UINT32  mPoolTestSeed;
+
+/**
+  Return the next pseudo random number.
+
+  @return A pseudo random number in the range 0..0x7FFF.
+
+**/
+STATIC
+UINT32
+PoolTestRandom (
+  VOID
+  )
+{
+  mPoolTestSeed = mPoolTestSeed * 1103515245 + 12345;
+  return (mPoolTestSeed >> 16) & 0x7FFF;
+}
+
+/**
+  Return a pseudo random allocation size, mostly small with a tail of larger
+  requests, similar to the pool usage of drivers.
+
+  @return The allocation size.
+
+**/
+STATIC
+UINTN
+PoolTestRandomSize (
+  VOID
+  )
+{
+  if ((PoolTestRandom () % 10) != 0) {
+    return 1 + PoolTestRandom () % 256;
+  }
+  return 1 + PoolTestRandom () % 2048;
+}
+
+/**
+  Allocate a pool buffer and fill it with a pattern derived from Tag.
+
+  @param[in]   PoolType  The type of pool to allocate.
+  @param[in]   Size      The size of the buffer.
+  @param[in]   Tag       The tag of the pattern.
+  @param[out]  Buffer    The allocated buffer.
+
+  @retval EFI_SUCCESS  The buffer was allocated.
+
+**/
+STATIC
+EFI_STATUS
+AllocateTagged (
+  IN  EFI_MEMORY_TYPE  PoolType,
+  IN  UINTN            Size,
+  IN  UINT8            Tag,
+  OUT VOID             **Buffer
+  )
+{
+  EFI_STATUS  Status;
+
+  Status = CoreAllocatePool (PoolType, Size, Buffer);
+  if (!EFI_ERROR (Status)) {
+    SetMem (*Buffer, Size, Tag);
+  }
+  return Status;
+}
+
+/**
+  Check that a buffer still holds the pattern written by AllocateTagged().
+
+  @param[in]  Buffer  The buffer to check.
+  @param[in]  Size    The size of the buffer.
+  @param[in]  Tag     The tag of the pattern.
+
+  @retval TRUE   The pattern is intact.
+  @retval FALSE  The buffer was overwritten.
+
+**/
+STATIC
+BOOLEAN
+IsTagIntact (
+  IN VOID   *Buffer,
+  IN UINTN  Size,
+  IN UINT8  Tag
+  )
+{
+  UINT8   *Byte;
+  UINTN   Index;
+
+  Byte = Buffer;
+  for (Index = 0; Index < Size; Index++) {
+    if (Byte[Index] != Tag) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/**
+  Verify that many live allocations of random sizes keep their contents while
+  others are freed and allocated around them, and that the pool pages are
+  given back once everything is freed.
+
+  @param[in]  Context  The POOL_TEST_CONTEXT of the pool type to test.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PoolShouldKeepContentsAndReturnPages (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  POOL_TEST_CONTEXT  *TestContext;
+  EFI_STATUS         Status;
+  VOID               **Buffers;
+  UINTN              *Sizes;
+  UINTN              PagesBefore;
+  UINTN              Round;
+  UINTN              Step;
+  UINTN              Index;
+
+  TestContext   = (POOL_TEST_CONTEXT *)Context;
+  mPoolTestSeed = 1;
+  PagesBefore   = mPoolTestPagesInUse;
+
+  Buffers = AllocateZeroPool (POOL_TEST_LIVE_COUNT * sizeof (VOID *));
+  Sizes   = AllocateZeroPool (POOL_TEST_LIVE_COUNT * sizeof (UINTN));
+  UT_ASSERT_NOT_NULL (Buffers);
+  UT_ASSERT_NOT_NULL (Sizes);
+
+  for (Index = 0; Index < POOL_TEST_LIVE_COUNT; Index++) {
+    Sizes[Index] = PoolTestRandomSize ();
+    Status = AllocateTagged (TestContext->PoolType, Sizes[Index], (UINT8)Index, &Buffers[Index]);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  //
+  // Free and allocate every third buffer in a scrambled order, then check all
+  // of them.  4093 is prime, so the steps visit every buffer once per round.
+  //
+  for (Round = 0; Round < 3; Round++) {
+    for (Step = 0, Index = Round; Step < POOL_TEST_LIVE_COUNT; Step++, Index = (Index + 4093) % POOL_TEST_LIVE_COUNT) {
+      if ((Index % 3) != Round) {
+        continue;
+      }
+      UT_ASSERT_TRUE (IsTagIntact (Buffers[Index], Sizes[Index], (UINT8)Index));
+      Status = CoreFreePool (Buffers[Index]);
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+
+      Sizes[Index] = PoolTestRandomSize ();
+      Status = AllocateTagged (TestContext->PoolType, Sizes[Index], (UINT8)Index, &Buffers[Index]);
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+    }
+
+    for (Index = 0; Index < POOL_TEST_LIVE_COUNT; Index++) {
+      UT_ASSERT_TRUE (IsTagIntact (Buffers[Index], Sizes[Index], (UINT8)Index));
+    }
+  }
+
+  for (Index = 0; Index < POOL_TEST_LIVE_COUNT; Index++) {
+    Status = CoreFreePool (Buffers[Index]);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  //
+  // A pool keeps up to 128KB of empty slabs to absorb churn
+  //
+  UT_LOG_INFO ("%a: %d pages left after freeing all pool\n", TestContext->Backend, (UINT32)(mPoolTestPagesInUse - PagesBefore));
+  UT_ASSERT_TRUE (mPoolTestPagesInUse <= PagesBefore + EFI_SIZE_TO_PAGES (SIZE_128KB));
+
+  FreePool (Buffers);
+  FreePool (Sizes);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Verify that freeing and allocating a single small buffer over and over does
+  not go to the page allocator each time.
+
+  @param[in]  Context  The POOL_TEST_CONTEXT of the pool type to test.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PoolChurnShouldNotThrashPages (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  POOL_TEST_CONTEXT  *TestContext;
+  EFI_STATUS         Status;
+  VOID               *Buffer;
+  UINTN              PageCalls;
+  UINTN              Index;
+
+  TestContext = (POOL_TEST_CONTEXT *)Context;
+
+  Status = CoreAllocatePool (TestContext->PoolType, 64, &Buffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = CoreFreePool (Buffer);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  PageCalls = mPoolTestPageCalls;
+  for (Index = 0; Index < 1000; Index++) {
+    Status = CoreAllocatePool (TestContext->PoolType, 64, &Buffer);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    Status = CoreFreePool (Buffer);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  UT_LOG_INFO ("%a: %d page allocator calls\n", TestContext->Backend, (UINT32)(mPoolTestPageCalls - PageCalls));
+  UT_ASSERT_EQUAL (mPoolTestPageCalls, PageCalls);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Verify that pool larger than a quarter of a page is not served from slabs,
+  and that the blocks carved off its page serve the smaller pool lists before
+  any slab is allocated.
+
+  EfiBootServicesCode is also selected by PcdPoolSlabType in the host test DSC,
+  and is not used by the other tests, so its pool has no spare slab.
+
+  @param[in]  Context  Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SlabPoolShouldNotServeLargeBlocks (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS  Status;
+  VOID        *Large;
+  VOID        *Small;
+  UINTN       PagesBefore;
+  UINTN       PageCalls;
+
+  PagesBefore = mPoolTestPagesInUse;
+
+  //
+  // A 2688 byte block, the rest of its page is carved into free blocks of the
+  // 1024 and 384 byte lists
+  //
+  Status = CoreAllocatePool (EfiBootServicesCode, 2000, &Large);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (mPoolTestPagesInUse, PagesBefore + 1);
+
+  PageCalls = mPoolTestPageCalls;
+  Status = CoreAllocatePool (EfiBootServicesCode, 900, &Small);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (mPoolTestPageCalls, PageCalls);
+
+  Status = CoreFreePool (Small);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = CoreFreePool (Large);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (mPoolTestPagesInUse, PagesBefore);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Measure the throughput and the peak page usage of the pool allocator while a
+  working set of buffers of random sizes is freed and reallocated at random.
+  The results are only reported, since timings on a build host are too noisy
+  to fail a test on.
+
+  @param[in]  Context  The POOL_TEST_CONTEXT of the pool type to measure.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PoolChurnCost (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  POOL_TEST_CONTEXT  *TestContext;
+  EFI_STATUS         Status;
+  VOID               **Buffers;
+  UINTN              PagesBefore;
+  UINTN              PageCalls;
+  UINTN              Churn;
+  UINTN              Index;
+  UINT32             NanoSeconds;
+  clock_t            Start;
+  clock_t            End;
+
+  TestContext   = (POOL_TEST_CONTEXT *)Context;
+  mPoolTestSeed = 1;
+  PagesBefore   = mPoolTestPagesInUse;
+
+  Buffers = AllocateZeroPool (POOL_TEST_LIVE_COUNT * sizeof (VOID *));
+  UT_ASSERT_NOT_NULL (Buffers);
+
+  for (Index = 0; Index < POOL_TEST_LIVE_COUNT; Index++) {
+    Status = CoreAllocatePool (TestContext->PoolType, PoolTestRandomSize (), &Buffers[Index]);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+  mPoolTestPeakPages = mPoolTestPagesInUse;
+  PageCalls          = mPoolTestPageCalls;
+
+  Start = clock ();
+  for (Churn = 0; Churn < BENCHMARK_CHURN_COUNT; Churn++) {
+    Index  = PoolTestRandom () % POOL_TEST_LIVE_COUNT;
+    Status = CoreFreePool (Buffers[Index]);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    Status = CoreAllocatePool (TestContext->PoolType, PoolTestRandomSize (), &Buffers[Index]);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+  End = clock ();
+
+  NanoSeconds = (UINT32)((UINT64)(End - Start) * (1000000000ULL / CLOCKS_PER_SEC) / BENCHMARK_CHURN_COUNT);
+  UT_LOG_INFO (
+    "%-9a: %d ns per FreePool()/AllocatePool(), %d peak pages, %d page allocator calls\n",
+    TestContext->Backend,
+    NanoSeconds,
+    (UINT32)(mPoolTestPeakPages - PagesBefore),
+    (UINT32)(mPoolTestPageCalls - PageCalls)
+    );
+  DEBUG ((
+    DEBUG_INFO,
+    "%-9a: %d ns per FreePool()/AllocatePool(), %d peak pages, %d page allocator calls\n",
+    TestContext->Backend,
+    NanoSeconds,
+    (UINT32)(mPoolTestPeakPages - PagesBefore),
+    (UINT32)(mPoolTestPageCalls - PageCalls)
+    ));
+
+  for (Index = 0; Index < POOL_TEST_LIVE_COUNT; Index++) {
+    Status = CoreFreePool (Buffers[Index]);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+  FreePool (Buffers);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  pool allocator and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      PoolTests;
+  UNIT_TEST_SUITE_HANDLE      BenchmarkTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  CoreInitializePool ();
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&PoolTests, Framework, "Pool Tests", "DxeCore.Pool", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for PoolTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (PoolTests, "Slab pool should keep contents and return pages", "SlabContents", PoolShouldKeepContentsAndReturnPages, NULL, NULL, &mSlabContext);
+  AddTestCase (PoolTests, "Free list pool should keep contents and return pages", "FreeListContents", PoolShouldKeepContentsAndReturnPages, NULL, NULL, &mFreeListContext);
+  AddTestCase (PoolTests, "Slab pool churn should not thrash pages", "SlabThrash", PoolChurnShouldNotThrashPages, NULL, NULL, &mSlabContext);
+  AddTestCase (PoolTests, "Slab pool should not serve large blocks", "SlabLarge", SlabPoolShouldNotServeLargeBlocks, NULL, NULL, NULL);
+
+  Status = CreateUnitTestSuite (&BenchmarkTests, Framework, "Pool Benchmarks", "DxeCore.Pool.Benchmark", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BenchmarkTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (BenchmarkTests, "Slab pool churn throughput and peak pages", "SlabChurn", PoolChurnCost, NULL, NULL, &mSlabContext);
+  AddTestCase (BenchmarkTests, "Free list pool churn throughput and peak pages", "FreeListChurn", PoolChurnCost, NULL, NULL, &mFreeListContext);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
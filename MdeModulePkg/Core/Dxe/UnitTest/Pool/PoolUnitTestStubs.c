@@ -0,0 +1,357 @@
+/** @file
+  Host based stand-ins for the DXE Core services that the pool allocator
+  (Mem/Pool.c) depends on.  The page allocator is backed by the host heap and
+  keeps track of the number of pages in use, so the tests can check that pool
+  pages are given back and report the peak page usage.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeMain.h"
+#include "Imem.h"
+#include "HeapGuard.h"
+
+//
+// Heap Guard is never enabled in the host environment
+//
+BOOLEAN     mOnGuarding = FALSE;
+
+//
+// Current task priority level
+//
+EFI_TPL     mStubTpl = TPL_APPLICATION;
+
+//
+// Page usage of the pool allocator
+//
+UINTN       mPoolTestPagesInUse = 0;
+UINTN       mPoolTestPeakPages  = 0;
+UINTN       mPoolTestPageCalls  = 0;
+
+/**
+  Raise the task priority level to the new level.
+
+  @param  NewTpl  New task priority level
+
+  @return The previous task priority level
+
+**/
+EFI_TPL
+EFIAPI
+CoreRaiseTpl (
+  IN EFI_TPL      NewTpl
+  )
+{
+  EFI_TPL     OldTpl;
+
+  OldTpl   = mStubTpl;
+  ASSERT (OldTpl <= NewTpl);
+  mStubTpl = NewTpl;
+  return OldTpl;
+}
+
+/**
+  Lowers the task priority to the previous value.
+
+  @param  NewTpl  New, lower, task priority
+
+**/
+VOID
+EFIAPI
+CoreRestoreTpl (
+  IN EFI_TPL NewTpl
+  )
+{
+  ASSERT (NewTpl <= mStubTpl);
+  mStubTpl = NewTpl;
+}
+
+/**
+  Enter critical section by gaining lock on gMemoryLock.
+
+**/
+VOID
+CoreAcquireMemoryLock (
+  VOID
+  )
+{
+  CoreAcquireLock (&gMemoryLock);
+}
+
+/**
+  Exit critical section by releasing lock on gMemoryLock.
+
+**/
+VOID
+CoreReleaseMemoryLock (
+  VOID
+  )
+{
+  CoreReleaseLock (&gMemoryLock);
+}
+
+/**
+  Allocates pool pages from the host heap.
+
+  @param  PoolType               The type of memory for the new pool pages
+  @param  NumberOfPages          No of pages to allocate
+  @param  Alignment              Bits to align.
+  @param  NeedGuard              Flag to indicate Guard page is needed or not
+
+  @return The allocated memory, or NULL
+
+**/
+VOID *
+CoreAllocatePoolPages (
+  IN EFI_MEMORY_TYPE    PoolType,
+  IN UINTN              NumberOfPages,
+  IN UINTN              Alignment,
+  IN BOOLEAN            NeedGuard
+  )
+{
+  VOID    *Buffer;
+
+  ASSERT (!NeedGuard);
+
+  Buffer = AllocateAlignedPages (NumberOfPages, Alignment);
+  if (Buffer != NULL) {
+    mPoolTestPageCalls++;
+    mPoolTestPagesInUse += NumberOfPages;
+    mPoolTestPeakPages   = MAX (mPoolTestPeakPages, mPoolTestPagesInUse);
+  }
+  return Buffer;
+}
+
+/**
+  Frees pool pages allocated via CoreAllocatePoolPages().
+
+  @param  Memory                 The base address to free
+  @param  NumberOfPages          The number of pages to free
+
+**/
+VOID
+CoreFreePoolPages (
+  IN EFI_PHYSICAL_ADDRESS   Memory,
+  IN UINTN                  NumberOfPages
+  )
+{
+  ASSERT (mPoolTestPagesInUse >= NumberOfPages);
+
+  mPoolTestPageCalls++;
+  mPoolTestPagesInUse -= NumberOfPages;
+  FreeAlignedPages ((VOID *)(UINTN)Memory, NumberOfPages);
+}
+
+/**
+  Check to see if the pool at the given address should be guarded or not.
+
+  @param[in]  MemoryType      Pool type to check.
+
+  @return FALSE   Pool is never guarded in the host environment.
+**/
+BOOLEAN
+IsPoolTypeToGuard (
+  IN EFI_MEMORY_TYPE        MemoryType
+  )
+{
+  return FALSE;
+}
+
+/**
+  Check to see if the heap guard is enabled for page and/or pool allocation.
+
+  @param[in]  GuardType   Specify the sub-type(s) of Heap Guard.
+
+  @return FALSE   Heap Guard is never enabled in the host environment.
+**/
+BOOLEAN
+IsHeapGuardEnabled (
+  UINT8           GuardType
+  )
+{
+  return FALSE;
+}
+
+/**
+  Check to see if the memory at the given address should be guarded or not.
+
+  @param[in]  Address   The address to check.
+
+  @return FALSE   Memory is never guarded in the host environment.
+**/
+BOOLEAN
+EFIAPI
+IsMemoryGuarded (
+  IN EFI_PHYSICAL_ADDRESS    Address
+  )
+{
+  return FALSE;
+}
+
+/**
+  Set head Guard and tail Guard for the given memory range.
+
+  @param[in]  Memory          Base address of memory to set guard for.
+  @param[in]  NumberOfPages   Memory size in pages.
+
+**/
+VOID
+SetGuardForMemory (
+  IN EFI_PHYSICAL_ADDRESS   Memory,
+  IN UINTN                  NumberOfPages
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Unset head Guard and tail Guard for the given memory range.
+
+  @param[in]  Memory          Base address of memory to unset guard for.
+  @param[in]  NumberOfPages   Memory size in pages.
+
+**/
+VOID
+UnsetGuardForMemory (
+  IN EFI_PHYSICAL_ADDRESS   Memory,
+  IN UINTN                  NumberOfPages
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Adjust the start address and number of pages to free according to Guard.
+
+  @param[in,out]  Memory          Base address of memory to free.
+  @param[in,out]  NumberOfPages   Size of memory to free.
+
+**/
+VOID
+AdjustMemoryF (
+  IN OUT EFI_PHYSICAL_ADDRESS    *Memory,
+  IN OUT UINTN                   *NumberOfPages
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Adjust the pool head position to make sure the Guard page is adjavent to
+  pool tail or pool head.
+
+  @param[in]  Memory    Base address of memory allocated.
+  @param[in]  NoPages   Number of pages actually allocated.
+  @param[in]  Size      Size of memory requested.
+
+  @return Address of pool head.
+**/
+VOID *
+AdjustPoolHeadA (
+  IN EFI_PHYSICAL_ADDRESS    Memory,
+  IN UINTN                   NoPages,
+  IN UINTN                   Size
+  )
+{
+  ASSERT (FALSE);
+  return (VOID *)(UINTN)Memory;
+}
+
+/**
+  Get the page base address according to pool head address.
+
+  @param[in]  Memory    Head address of pool to free.
+
+  @return Address of pool head.
+**/
+VOID *
+AdjustPoolHeadF (
+  IN EFI_PHYSICAL_ADDRESS    Memory
+  )
+{
+  ASSERT (FALSE);
+  return (VOID *)(UINTN)Memory;
+}
+
+/**
+  Check to see if the freed-memory guard needs to be set for the given pages.
+
+  @param[in]  BaseAddress     Base address of the freed pages.
+  @param[in]  Pages           Number of freed pages.
+
+**/
+VOID
+EFIAPI
+GuardFreedPagesChecked (
+  IN  EFI_PHYSICAL_ADDRESS    BaseAddress,
+  IN  UINTN                   Pages
+  )
+{
+}
+
+/**
+  Manage memory permission attributes on a memory range.  There are no page
+  tables in the host environment.
+
+  @param  OldType           The old memory type of the range
+  @param  NewType           The new memory type of the range
+  @param  Memory            The base address of the memory range
+  @param  Length            The size of the memory range
+
+  @retval EFI_SUCCESS       Nothing needed to be done.
+
+**/
+EFI_STATUS
+EFIAPI
+ApplyMemoryProtectionPolicy (
+  IN  EFI_MEMORY_TYPE       OldType,
+  IN  EFI_MEMORY_TYPE       NewType,
+  IN  EFI_PHYSICAL_ADDRESS  Memory,
+  IN  UINT64                Length
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  Update memory profile information.  Memory profiling is not supported in
+  the host environment.
+
+  @param CallerAddress  Address of caller who call Allocate or Free.
+  @param Action         This Allocate or Free action.
+  @param MemoryType     Memory type.
+  @param Size           Buffer size.
+  @param Buffer         Buffer address.
+  @param ActionString   String for memory profile action.
+
+  @return EFI_UNSUPPORTED   Memory profile is unsupported.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreUpdateProfile (
+  IN EFI_PHYSICAL_ADDRESS   CallerAddress,
+  IN MEMORY_PROFILE_ACTION  Action,
+  IN EFI_MEMORY_TYPE        MemoryType,
+  IN UINTN                  Size,
+  IN VOID                   *Buffer,
+  IN CHAR8                  *ActionString OPTIONAL
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  Install MemoryAttributesTable on memory allocation.  There is no system
+  table to install it in the host environment.
+
+  @param[in] MemoryType EFI memory type.
+**/
+VOID
+InstallMemoryAttributesTableOnMemoryAllocation (
+  IN EFI_MEMORY_TYPE    MemoryType
+  )
+{
+}
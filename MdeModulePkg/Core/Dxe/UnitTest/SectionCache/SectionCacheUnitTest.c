@@ -0,0 +1,724 @@
+/** @file
+  Host based unit tests of the section cache of the DXE Core firmware
+  volumes.
+
+  The sections of firmware files encapsulated in compression sections are
+  read through EFI_FIRMWARE_VOLUME2_PROTOCOL.ReadSection() and through the
+  Section Cache Protocol, and the tests check which reads are answered from
+  the section data extracted by earlier reads, that the section cache stays
+  within PcdDxeSectionCacheSize, and that referenced section data is not
+  evicted.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "DxeMain.h"
+#include "FwVolDriver.h"
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME        "DXE Core Section Cache Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Number of firmware files of the test firmware volume, and size of the data
+// of their PE32 sections
+//
+#define SECTION_TEST_FILE_COUNT   8
+#define SECTION_TEST_DATA_SIZE    0x1000
+
+//
+// Size of the section cache the test is built with, which holds the section
+// data of about three of the firmware files
+//
+#define SECTION_TEST_CACHE_SIZE   0x8000
+
+//
+// Name of the user interface sections of the firmware files
+//
+#define SECTION_TEST_UI_NAME      L"Test"
+
+//
+// Name of the first firmware file.  The others are numbered from it.
+//
+EFI_GUID              mSectionTestFileGuid = {
+  0x4f1e8a23, 0x6c0d, 0x4b97, { 0x85, 0x3a, 0xe2, 0x19, 0x7d, 0x40, 0xc6, 0x5b }
+};
+
+EFI_FIRMWARE_VOLUME_HEADER  mSectionTestFvHeader;
+FV_DEVICE                   mSectionTestFvDevice;
+FFS_FILE_LIST_ENTRY         *mSectionTestFiles[SECTION_TEST_FILE_COUNT];
+
+/**
+  Return the name of a firmware file of the test firmware volume.
+
+  @param  Index        The number of the firmware file.
+  @param  Name         The name of the firmware file.
+
+**/
+VOID
+SectionTestFileName (
+  IN  UINTN     Index,
+  OUT EFI_GUID  *Name
+  )
+{
+  CopyGuid (Name, &mSectionTestFileGuid);
+  Name->Data1 += (UINT32) Index;
+}
+
+/**
+  Return the value of the bytes of the PE32 section of a firmware file.
+
+  @param  Index        The number of the firmware file.
+
+  @return The value of the bytes of the PE32 section.
+
+**/
+UINT8
+SectionTestData (
+  IN UINTN  Index
+  )
+{
+  return (UINT8) (0xA0 + Index);
+}
+
+/**
+  Return the size of the stream extracted from the compression section of a
+  firmware file, that is of its PE32 section and user interface section.
+
+  @return The size of the extracted stream.
+
+**/
+UINT32
+SectionTestExtractedSize (
+  VOID
+  )
+{
+  return ALIGN_VALUE (sizeof (EFI_COMMON_SECTION_HEADER) + SECTION_TEST_DATA_SIZE, 4) +
+         sizeof (EFI_COMMON_SECTION_HEADER) + sizeof (SECTION_TEST_UI_NAME);
+}
+
+/**
+  Create a firmware file, with a PE32 section and a user interface section,
+  encapsulated in a compression section or not.
+
+  @param  Index        The number of the firmware file.
+  @param  Encapsulate  TRUE to encapsulate the sections in a compression
+                       section.
+
+  @return The firmware file.
+
+**/
+EFI_FFS_FILE_HEADER *
+SectionTestCreateFile (
+  IN UINTN    Index,
+  IN BOOLEAN  Encapsulate
+  )
+{
+  EFI_FFS_FILE_HEADER        *FfsHeader;
+  EFI_COMPRESSION_SECTION    *Compression;
+  EFI_COMMON_SECTION_HEADER  *Section;
+  UINT32                     Pe32Size;
+  UINT32                     UiSize;
+  UINT32                     CompressionSize;
+  UINT32                     FileSize;
+
+  Pe32Size        = sizeof (EFI_COMMON_SECTION_HEADER) + SECTION_TEST_DATA_SIZE;
+  UiSize          = sizeof (EFI_COMMON_SECTION_HEADER) + sizeof (SECTION_TEST_UI_NAME);
+  CompressionSize = 0;
+  if (Encapsulate) {
+    CompressionSize = sizeof (EFI_COMPRESSION_SECTION) + SectionTestExtractedSize ();
+    FileSize        = sizeof (EFI_FFS_FILE_HEADER) + CompressionSize;
+  } else {
+    FileSize        = sizeof (EFI_FFS_FILE_HEADER) + SectionTestExtractedSize ();
+  }
+
+  FfsHeader = AllocateZeroPool (FileSize);
+  if (FfsHeader == NULL) {
+    return NULL;
+  }
+  SectionTestFileName (Index, &FfsHeader->Name);
+  FfsHeader->Type    = EFI_FV_FILETYPE_DRIVER;
+  FfsHeader->Size[0] = (UINT8) FileSize;
+  FfsHeader->Size[1] = (UINT8) (FileSize >> 8);
+  FfsHeader->Size[2] = (UINT8) (FileSize >> 16);
+
+  Section = (EFI_COMMON_SECTION_HEADER *) (FfsHeader + 1);
+  if (Encapsulate) {
+    Compression = (EFI_COMPRESSION_SECTION *) Section;
+    Compression->CommonHeader.Size[0] = (UINT8) CompressionSize;
+    Compression->CommonHeader.Size[1] = (UINT8) (CompressionSize >> 8);
+    Compression->CommonHeader.Size[2] = (UINT8) (CompressionSize >> 16);
+    Compression->CommonHeader.Type    = EFI_SECTION_COMPRESSION;
+    Compression->UncompressedLength   = SectionTestExtractedSize ();
+    Compression->CompressionType      = EFI_NOT_COMPRESSED;
+
+    Section = (EFI_COMMON_SECTION_HEADER *) (Compression + 1);
+  }
+
+  Section->Size[0] = (UINT8) Pe32Size;
+  Section->Size[1] = (UINT8) (Pe32Size >> 8);
+  Section->Size[2] = (UINT8) (Pe32Size >> 16);
+  Section->Type    = EFI_SECTION_PE32;
+  SetMem (Section + 1, SECTION_TEST_DATA_SIZE, SectionTestData (Index));
+
+  Section = (EFI_COMMON_SECTION_HEADER *) ((UINT8 *) Section + ALIGN_VALUE (Pe32Size, 4));
+  Section->Size[0] = (UINT8) UiSize;
+  Section->Size[1] = (UINT8) (UiSize >> 8);
+  Section->Size[2] = (UINT8) (UiSize >> 16);
+  Section->Type    = EFI_SECTION_USER_INTERFACE;
+  CopyMem (Section + 1, SECTION_TEST_UI_NAME, sizeof (SECTION_TEST_UI_NAME));
+
+  return FfsHeader;
+}
+
+/**
+  Add a firmware file to the test firmware volume.
+
+  @param  Index        The number of the firmware file.
+  @param  Encapsulate  TRUE to encapsulate the sections of the firmware file in
+                       a compression section.
+
+  @retval EFI_SUCCESS           The firmware file was added.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory.
+
+**/
+EFI_STATUS
+SectionTestAddFile (
+  IN UINTN    Index,
+  IN BOOLEAN  Encapsulate
+  )
+{
+  FFS_FILE_LIST_ENTRY  *FfsEntry;
+
+  FfsEntry = AllocateZeroPool (sizeof (FFS_FILE_LIST_ENTRY));
+  if (FfsEntry == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  FfsEntry->FfsHeader = SectionTestCreateFile (Index, Encapsulate);
+  if (FfsEntry->FfsHeader == NULL) {
+    FreePool (FfsEntry);
+    return EFI_OUT_OF_RESOURCES;
+  }
+  InsertTailList (&mSectionTestFvDevice.FfsFileListHeader, &FfsEntry->Link);
+  if (Index < SECTION_TEST_FILE_COUNT) {
+    mSectionTestFiles[Index] = FfsEntry;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Create the test firmware volume and its firmware files.
+
+  @retval EFI_SUCCESS           The firmware volume was created.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory.
+
+**/
+EFI_STATUS
+SectionTestCreateFv (
+  VOID
+  )
+{
+  EFI_STATUS           Status;
+  UINTN                Index;
+
+  ZeroMem (&mSectionTestFvDevice, sizeof (mSectionTestFvDevice));
+  mSectionTestFvDevice.Signature      = FV2_DEVICE_SIGNATURE;
+  mSectionTestFvDevice.Fv.ReadFile    = FvReadFile;
+  mSectionTestFvDevice.Fv.ReadSection = FvReadFileSection;
+  mSectionTestFvDevice.FwVolHeader    = &mSectionTestFvHeader;
+  InitializeListHead (&mSectionTestFvDevice.FfsFileListHeader);
+
+  for (Index = 0; Index < SECTION_TEST_FILE_COUNT; Index++) {
+    Status = SectionTestAddFile (Index, TRUE);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Free the test firmware volume, the way FreeFvDeviceResource() does.
+
+**/
+VOID
+SectionTestFreeFv (
+  VOID
+  )
+{
+  FFS_FILE_LIST_ENTRY  *FfsEntry;
+
+  while (!IsListEmpty (&mSectionTestFvDevice.FfsFileListHeader)) {
+    FfsEntry = (FFS_FILE_LIST_ENTRY *) GetFirstNode (&mSectionTestFvDevice.FfsFileListHeader);
+    RemoveEntryList (&FfsEntry->Link);
+
+    FvSectionCacheRemove (FfsEntry);
+    if (FfsEntry->StreamHandle != 0) {
+      CloseSectionStream (FfsEntry->StreamHandle, FALSE);
+    }
+
+    FreePool (FfsEntry->FfsHeader);
+    FreePool (FfsEntry);
+  }
+}
+
+/**
+  Read the PE32 section of a firmware file through
+  EFI_FIRMWARE_VOLUME2_PROTOCOL.ReadSection(), and check its data.
+
+  @param  Index        The number of the firmware file.
+
+  @retval TRUE         The section was read, and its data is right.
+  @retval FALSE        The section could not be read, or its data is wrong.
+
+**/
+BOOLEAN
+SectionTestReadPe32 (
+  IN UINTN  Index
+  )
+{
+  EFI_STATUS  Status;
+  EFI_GUID    Name;
+  VOID        *Buffer;
+  UINTN       BufferSize;
+  UINT32      AuthenticationStatus;
+  UINTN       Offset;
+  BOOLEAN     Match;
+
+  SectionTestFileName (Index, &Name);
+  Buffer = NULL;
+  Status = mSectionTestFvDevice.Fv.ReadSection (
+                                     &mSectionTestFvDevice.Fv,
+                                     &Name,
+                                     EFI_SECTION_PE32,
+                                     0,
+                                     &Buffer,
+                                     &BufferSize,
+                                     &AuthenticationStatus
+                                     );
+  if (EFI_ERROR (Status)) {
+    return FALSE;
+  }
+
+  Match = (BOOLEAN) (BufferSize == SECTION_TEST_DATA_SIZE);
+  for (Offset = 0; Match && Offset < BufferSize; Offset++) {
+    Match = (BOOLEAN) (((UINT8 *) Buffer)[Offset] == SectionTestData (Index));
+  }
+  FreePool (Buffer);
+  return Match;
+}
+
+/**
+  Check the data of the PE32 section of a firmware file returned by the
+  Section Cache Protocol.
+
+  @param  Index        The number of the firmware file.
+  @param  Buffer       The data of the section.
+  @param  BufferSize   The size of the data of the section.
+
+  @retval TRUE         The data is right.
+  @retval FALSE        The data is wrong.
+
+**/
+BOOLEAN
+SectionTestCheckPe32 (
+  IN UINTN       Index,
+  IN CONST VOID  *Buffer,
+  IN UINTN       BufferSize
+  )
+{
+  UINTN       Offset;
+
+  if (BufferSize != SECTION_TEST_DATA_SIZE) {
+    return FALSE;
+  }
+  for (Offset = 0; Offset < BufferSize; Offset++) {
+    if (((CONST UINT8 *) Buffer)[Offset] != SectionTestData (Index)) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/**
+  Sections should be read from the section data extracted by earlier reads of
+  their firmware file.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ReadSectionShouldHitExtractedSections (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EDKII_SECTION_CACHE_STATISTICS  Before;
+  EDKII_SECTION_CACHE_STATISTICS  After;
+  EFI_STATUS                      Status;
+  EFI_GUID                        Name;
+  VOID                            *Buffer;
+  UINTN                           BufferSize;
+  UINT32                          AuthenticationStatus;
+
+  UT_ASSERT_NOT_EFI_ERROR (SectionTestCreateFv ());
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&Before));
+
+  //
+  // The first read opens the section stream, and extracts the compression
+  // section.
+  //
+  UT_ASSERT_TRUE (SectionTestReadPe32 (0));
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&After));
+  UT_ASSERT_EQUAL (After.MissCount, Before.MissCount + 1);
+  UT_ASSERT_EQUAL (After.HitCount, Before.HitCount);
+  UT_ASSERT_TRUE (After.CachedSize > Before.CachedSize);
+
+  //
+  // The next reads of the file, of the same or of another section in the
+  // compression section, do not extract anything.
+  //
+  UT_ASSERT_TRUE (SectionTestReadPe32 (0));
+  SectionTestFileName (0, &Name);
+  Buffer = NULL;
+  Status = FvReadFileSection (
+             &mSectionTestFvDevice.Fv,
+             &Name,
+             EFI_SECTION_USER_INTERFACE,
+             0,
+             &Buffer,
+             &BufferSize,
+             &AuthenticationStatus
+             );
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (BufferSize, sizeof (SECTION_TEST_UI_NAME));
+  UT_ASSERT_MEM_EQUAL (Buffer, SECTION_TEST_UI_NAME, sizeof (SECTION_TEST_UI_NAME));
+  FreePool (Buffer);
+
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&After));
+  UT_ASSERT_EQUAL (After.MissCount, Before.MissCount + 1);
+  UT_ASSERT_EQUAL (After.HitCount, Before.HitCount + 2);
+  UT_ASSERT_EQUAL (After.EvictionCount, Before.EvictionCount);
+
+  SectionTestFreeFv ();
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&After));
+  UT_ASSERT_EQUAL (After.CachedSize, Before.CachedSize);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The section cache should evict the least recently read firmware files to
+  stay within PcdDxeSectionCacheSize.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SectionCacheShouldStayWithinItsSize (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EDKII_SECTION_CACHE_STATISTICS  Before;
+  EDKII_SECTION_CACHE_STATISTICS  After;
+  UINTN                           Index;
+
+  UT_ASSERT_NOT_EFI_ERROR (SectionTestCreateFv ());
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&Before));
+  UT_ASSERT_EQUAL (Before.MaxCachedSize, SECTION_TEST_CACHE_SIZE);
+
+  for (Index = 0; Index < SECTION_TEST_FILE_COUNT; Index++) {
+    UT_ASSERT_TRUE (SectionTestReadPe32 (Index));
+    UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&After));
+    UT_ASSERT_TRUE (After.CachedSize <= SECTION_TEST_CACHE_SIZE);
+  }
+  UT_ASSERT_TRUE (After.EvictionCount > Before.EvictionCount);
+
+  //
+  // The first file was evicted, and the last one was not.
+  //
+  UT_ASSERT_EQUAL (mSectionTestFiles[0]->StreamHandle, 0);
+  UT_ASSERT_NOT_EQUAL (mSectionTestFiles[SECTION_TEST_FILE_COUNT - 1]->StreamHandle, 0);
+
+  Before = After;
+  UT_ASSERT_TRUE (SectionTestReadPe32 (SECTION_TEST_FILE_COUNT - 1));
+  UT_ASSERT_TRUE (SectionTestReadPe32 (0));
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&After));
+  UT_ASSERT_EQUAL (After.HitCount, Before.HitCount + 1);
+  UT_ASSERT_EQUAL (After.MissCount, Before.MissCount + 1);
+  UT_ASSERT_TRUE (After.CachedSize <= SECTION_TEST_CACHE_SIZE);
+
+  SectionTestFreeFv ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The section cache should only count the streams extracted from the
+  encapsulation sections of the firmware files, and not the firmware files
+  that their section streams are opened on in place.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SectionCacheShouldCountExtractedStreams (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EDKII_SECTION_CACHE_STATISTICS  Before;
+  EDKII_SECTION_CACHE_STATISTICS  After;
+  UINTN                           Index;
+
+  UT_ASSERT_NOT_EFI_ERROR (SectionTestCreateFv ());
+  UT_ASSERT_NOT_EFI_ERROR (SectionTestAddFile (SECTION_TEST_FILE_COUNT, FALSE));
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&Before));
+
+  //
+  // A firmware file without encapsulation sections costs nothing.
+  //
+  UT_ASSERT_TRUE (SectionTestReadPe32 (SECTION_TEST_FILE_COUNT));
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&After));
+  UT_ASSERT_EQUAL (After.CachedSize, Before.CachedSize);
+
+  //
+  // A firmware file costs the stream extracted from its compression section,
+  // once, however many sections are read from it.
+  //
+  UT_ASSERT_TRUE (SectionTestReadPe32 (0));
+  UT_ASSERT_TRUE (SectionTestReadPe32 (0));
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&After));
+  UT_ASSERT_EQUAL (After.CachedSize, Before.CachedSize + SectionTestExtractedSize ());
+
+  //
+  // As many firmware files as fit in the section cache are read without
+  // eviction.
+  //
+  for (Index = 1; Index < SECTION_TEST_CACHE_SIZE / SectionTestExtractedSize (); Index++) {
+    UT_ASSERT_TRUE (SectionTestReadPe32 (Index));
+  }
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&After));
+  UT_ASSERT_EQUAL (After.EvictionCount, Before.EvictionCount);
+  UT_ASSERT_EQUAL (After.CachedSize, Before.CachedSize + Index * SectionTestExtractedSize ());
+
+  SectionTestFreeFv ();
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&After));
+  UT_ASSERT_EQUAL (After.CachedSize, Before.CachedSize);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Section data returned by the Section Cache Protocol should not be evicted
+  until it is released.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ReferencedSectionsShouldNotBeEvicted (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EDKII_SECTION_CACHE_STATISTICS  Before;
+  EDKII_SECTION_CACHE_STATISTICS  After;
+  EFI_STATUS                      Status;
+  EFI_GUID                        Name;
+  CONST VOID                      *Buffer;
+  UINTN                           BufferSize;
+  UINT32                          AuthenticationStatus;
+  UINTN                           Index;
+  EFI_FIRMWARE_VOLUME2_PROTOCOL   OtherFv;
+
+  UT_ASSERT_NOT_EFI_ERROR (SectionTestCreateFv ());
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&Before));
+
+  SectionTestFileName (0, &Name);
+  Status = CoreGetCachedSection (
+             &mSectionTestFvDevice.Fv,
+             &Name,
+             EFI_SECTION_PE32,
+             0,
+             &Buffer,
+             &BufferSize,
+             &AuthenticationStatus
+             );
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_TRUE (SectionTestCheckPe32 (0, Buffer, BufferSize));
+
+  //
+  // The section data stays in place while all the other files are read.
+  //
+  for (Index = 1; Index < SECTION_TEST_FILE_COUNT; Index++) {
+    UT_ASSERT_TRUE (SectionTestReadPe32 (Index));
+  }
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&After));
+  UT_ASSERT_TRUE (After.EvictionCount > Before.EvictionCount);
+  UT_ASSERT_NOT_EQUAL (mSectionTestFiles[0]->StreamHandle, 0);
+  UT_ASSERT_TRUE (SectionTestCheckPe32 (0, Buffer, BufferSize));
+
+  //
+  // Once released, it is evicted first, as the least recently read file.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (CoreReleaseCachedSection (Buffer));
+  UT_ASSERT_STATUS_EQUAL (CoreReleaseCachedSection (Buffer), EFI_NOT_FOUND);
+  UT_ASSERT_EQUAL (mSectionTestFiles[1]->StreamHandle, 0);
+  UT_ASSERT_TRUE (SectionTestReadPe32 (1));
+  UT_ASSERT_EQUAL (mSectionTestFiles[0]->StreamHandle, 0);
+
+  //
+  // Firmware volumes that the DXE Core did not produce are not supported.
+  //
+  CopyMem (&OtherFv, &mSectionTestFvDevice.Fv, sizeof (OtherFv));
+  OtherFv.ReadSection = NULL;
+  Status = CoreGetCachedSection (
+             &OtherFv,
+             &Name,
+             EFI_SECTION_PE32,
+             0,
+             &Buffer,
+             &BufferSize,
+             &AuthenticationStatus
+             );
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_UNSUPPORTED);
+
+  SectionTestFreeFv ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  References to section data should be dropped when the firmware volume goes
+  away.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ReferencesShouldBeDroppedWithTheFirmwareVolume (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EDKII_SECTION_CACHE_STATISTICS  Before;
+  EDKII_SECTION_CACHE_STATISTICS  After;
+  EFI_STATUS                      Status;
+  EFI_GUID                        Name;
+  CONST VOID                      *Buffer;
+  UINTN                           BufferSize;
+  UINT32                          AuthenticationStatus;
+
+  UT_ASSERT_NOT_EFI_ERROR (SectionTestCreateFv ());
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&Before));
+
+  SectionTestFileName (1, &Name);
+  Status = CoreGetCachedSection (
+             &mSectionTestFvDevice.Fv,
+             &Name,
+             0,
+             0,
+             &Buffer,
+             &BufferSize,
+             &AuthenticationStatus
+             );
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+
+  SectionTestFreeFv ();
+  UT_ASSERT_STATUS_EQUAL (CoreReleaseCachedSection (Buffer), EFI_NOT_FOUND);
+  UT_ASSERT_NOT_EFI_ERROR (CoreGetSectionCacheStatistics (&After));
+  UT_ASSERT_EQUAL (After.CachedSize, Before.CachedSize);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the section
+  cache and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      SectionCacheTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&SectionCacheTests, Framework, "Section Cache Tests", "DxeCore.SectionCache", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for SectionCacheTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (SectionCacheTests, "ReadSection should hit extracted sections", "Hit", ReadSectionShouldHitExtractedSections, NULL, NULL, NULL);
+  AddTestCase (SectionCacheTests, "Section cache should stay within its size", "Evict", SectionCacheShouldStayWithinItsSize, NULL, NULL, NULL);
+  AddTestCase (SectionCacheTests, "Section cache should count extracted streams", "Size", SectionCacheShouldCountExtractedStreams, NULL, NULL, NULL);
+  AddTestCase (SectionCacheTests, "Referenced sections should not be evicted", "Reference", ReferencedSectionsShouldNotBeEvicted, NULL, NULL, NULL);
+  AddTestCase (SectionCacheTests, "References should be dropped with the firmware volume", "FreeFv", ReferencesShouldBeDroppedWithTheFirmwareVolume, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,269 @@
+/** @file
+  Host based stand-ins for the services that the section cache of the
+  firmware volumes (FwVol/FwVolSectionCache.c), the firmware file reads
+  (FwVol/FwVolRead.c) and the section extraction
+  (SectionExtraction/CoreSectionExtraction.c) depend on.
+
+  The firmware files of the tests only encapsulate their sections in
+  compression sections of the EFI_NOT_COMPRESSED type, so there is no
+  decompression or GUIDed section extraction in the host environment.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeMain.h"
+#include "FwVolDriver.h"
+
+//
+// Current task priority level
+//
+EFI_TPL             mStubTpl = TPL_APPLICATION;
+
+//
+// Boot Services Table.  Only used to close the events of GUIDed sections.
+//
+EFI_BOOT_SERVICES   *gBS;
+
+/**
+  Raise the task priority level to the new level.
+
+  @param  NewTpl  New task priority level
+
+  @return The previous task priority level
+
+**/
+EFI_TPL
+EFIAPI
+CoreRaiseTpl (
+  IN EFI_TPL      NewTpl
+  )
+{
+  EFI_TPL     OldTpl;
+
+  OldTpl   = mStubTpl;
+  ASSERT (OldTpl <= NewTpl);
+  mStubTpl = NewTpl;
+  return OldTpl;
+}
+
+/**
+  Lowers the task priority to the previous value.
+
+  @param  NewTpl  New, lower, task priority
+
+**/
+VOID
+EFIAPI
+CoreRestoreTpl (
+  IN EFI_TPL NewTpl
+  )
+{
+  ASSERT (NewTpl <= mStubTpl);
+  mStubTpl = NewTpl;
+}
+
+/**
+  Frees pool.
+
+  @param  Buffer                 The allocated pool entry to free
+
+  @retval EFI_SUCCESS            Pool successfully freed.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreFreePool (
+  IN VOID        *Buffer
+  )
+{
+  FreePool (Buffer);
+  return EFI_SUCCESS;
+}
+
+/**
+  Installs a protocol interface.  There is no handle database in the host
+  environment.
+
+  @param  UserHandle             The handle to install the protocol handler on,
+                                 or NULL if a new handle is to be allocated
+  @param  Protocol               The protocol to add to the handle
+  @param  InterfaceType          Indicates whether Interface is supplied in
+                                 native form.
+  @param  Interface              The interface for the protocol being added
+
+  @retval EFI_UNSUPPORTED        The handle database is not available.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreInstallProtocolInterface (
+  IN OUT EFI_HANDLE     *UserHandle,
+  IN EFI_GUID           *Protocol,
+  IN EFI_INTERFACE_TYPE InterfaceType,
+  IN VOID               *Interface
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  Locates a protocol.  There is no handle database in the host environment.
+
+  @param  Protocol               The protocol to search for
+  @param  Registration           Optional Registration Key returned from
+                                 RegisterProtocolNotify()
+  @param  Interface              Return the Protocol interface (instance).
+
+  @retval EFI_NOT_FOUND          Protocol interface not found
+
+**/
+EFI_STATUS
+EFIAPI
+CoreLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  IN  VOID      *Registration OPTIONAL,
+  OUT VOID      **Interface
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Creates a protocol notification event.  There are no events in the host
+  environment.
+
+  @param  ProtocolGuid    Supplies GUID of the protocol upon whose installation the event is fired.
+  @param  NotifyTpl       Supplies the task priority level of the event notifications.
+  @param  NotifyFunction  Supplies the function to notify when the event is signaled.
+  @param  NotifyContext   The context parameter to pass to NotifyFunction.
+  @param  Registration    A pointer to a memory location to receive the registration value.
+
+  @return NULL.
+
+**/
+EFI_EVENT
+EFIAPI
+EfiCreateProtocolNotifyEvent (
+  IN  EFI_GUID          *ProtocolGuid,
+  IN  EFI_TPL           NotifyTpl,
+  IN  EFI_EVENT_NOTIFY  NotifyFunction,
+  IN  VOID              *NotifyContext,  OPTIONAL
+  OUT VOID              **Registration
+  )
+{
+  return NULL;
+}
+
+/**
+  Retrieves a pointer to the system configuration table.  There are no
+  configuration tables in the host environment.
+
+  @param  TableGuid       The pointer to table's GUID type.
+  @param  Table           The pointer to the table associated with TableGuid in the EFI System Table.
+
+  @retval EFI_NOT_FOUND   The table was not found.
+
+**/
+EFI_STATUS
+EFIAPI
+EfiGetSystemConfigurationTable (
+  IN  EFI_GUID  *TableGuid,
+  OUT VOID      **Table
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Retrieves the GUIDs of the registered GUIDed section extraction handlers.
+  There are none in the host environment.
+
+  @param  ExtractHandlerGuidTable  A pointer to the array of GUIDs that have been registered through
+                                   ExtractGuidedSectionRegisterHandlers().
+
+  @return 0.
+
+**/
+UINTN
+EFIAPI
+ExtractGuidedSectionGetGuidList (
+  OUT  GUID  **ExtractHandlerGuidTable
+  )
+{
+  *ExtractHandlerGuidTable = NULL;
+  return 0;
+}
+
+/**
+  Retrieves the size of the data of a GUIDed section.  No GUIDed section is
+  supported in the host environment.
+
+  @param  InputSection           A pointer to a GUIDed section of an FFS formatted file.
+  @param  OutputBufferSize       A pointer to the size, in bytes, of an output buffer required
+                                 if the buffer specified by InputSection were decoded.
+  @param  ScratchBufferSize      A pointer to the size, in bytes, required as scratch space
+                                 if the buffer specified by InputSection were decoded.
+  @param  SectionAttribute       A pointer to the attributes of the GUIDed section.
+
+  @retval RETURN_UNSUPPORTED     The GUIDed section is not supported.
+
+**/
+RETURN_STATUS
+EFIAPI
+ExtractGuidedSectionGetInfo (
+  IN  CONST VOID    *InputSection,
+  OUT       UINT32  *OutputBufferSize,
+  OUT       UINT32  *ScratchBufferSize,
+  OUT       UINT16  *SectionAttribute
+  )
+{
+  return RETURN_UNSUPPORTED;
+}
+
+/**
+  Decodes a GUIDed section.  No GUIDed section is supported in the host
+  environment.
+
+  @param  InputSection           A pointer to a GUIDed section of an FFS formatted file.
+  @param  OutputBuffer           A pointer to a buffer that contains the result of a decode operation.
+  @param  ScratchBuffer          A caller allocated buffer that may be required by this function
+                                 as a scratch buffer to perform the decode operation.
+  @param  AuthenticationStatus   A pointer to the authentication status of the decoded output buffer.
+
+  @retval RETURN_UNSUPPORTED     The GUIDed section is not supported.
+
+**/
+RETURN_STATUS
+EFIAPI
+ExtractGuidedSectionDecode (
+  IN  CONST VOID    *InputSection,
+  OUT       VOID    **OutputBuffer,
+  IN        VOID    *ScratchBuffer,        OPTIONAL
+  OUT       UINT32  *AuthenticationStatus
+  )
+{
+  return RETURN_UNSUPPORTED;
+}
+
+/**
+  Retrieves the attributes of the firmware volume.  The firmware volume of
+  the tests can always be read.
+
+  @param  This             Pointer to EFI_FIRMWARE_VOLUME2_PROTOCOL.
+  @param  Attributes       output buffer which contains attributes.
+
+  @retval EFI_SUCCESS      Successfully got volume attributes.
+
+**/
+EFI_STATUS
+EFIAPI
+FvGetVolumeAttributes (
+  IN  CONST EFI_FIRMWARE_VOLUME2_PROTOCOL *This,
+  OUT       EFI_FV_ATTRIBUTES             *Attributes
+  )
+{
+  *Attributes = EFI_FV2_READ_STATUS;
+  return EFI_SUCCESS;
+}
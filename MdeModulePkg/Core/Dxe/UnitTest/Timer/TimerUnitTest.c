@@ -0,0 +1,801 @@
+/** @file
+  Host based unit tests of the DXE Core timer services.
+
+  Timer events are set, cancelled and left to expire at random while the
+  system time advances by timer ticks of random length, and the timer events
+  signaled on every check of the timer database are compared with a model of
+  the timer services.  The benchmark reports the cost of setting timers and
+  of timer ticks with many periodic timers, as network stacks create them.
+  In one-shot timer mode, timer ticks only happen when the timer interrupt
+  programmed by the timer services fires.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include "DxeMain.h"
+#include "Event.h"
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME        "DXE Core Timer Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Number of timer events and of random steps of the test
+//
+#define TIMER_TEST_EVENT_COUNT    1024
+#define TIMER_TEST_STEP_COUNT     50000
+
+//
+// Timer tick period, in 100ns units
+//
+#define TIMER_TEST_TICK           100000
+
+//
+// Number of periodic and of one-shot timer events of the benchmark, and
+// number of timer ticks it runs
+//
+#define BENCHMARK_PERIODIC_COUNT  512
+#define BENCHMARK_ONE_SHOT_COUNT  512
+#define BENCHMARK_TICK_COUNT      20000
+
+//
+// Timer period reported by the stub Timer Architectural Protocol
+//
+#define STUB_TIMER_PERIOD         100000
+
+//
+// Timer event slack of the timer services, in 100ns units
+//
+#define TIMER_TEST_SLACK          10000
+
+///
+/// The expected state of a timer event.
+///
+typedef struct {
+  BOOLEAN   Armed;
+  UINT64    TriggerTime;
+  UINT64    Period;
+  UINT32    SignalCount;
+} TIMER_TEST_MODEL;
+
+extern IEVENT   mStubCheckTimerEvent;
+extern UINT64   mEfiSystemTime;
+extern UINT64   mStubTimerDeadline;
+extern UINTN    mStubTimerDeadlineCount;
+extern UINTN    mStubTimerElapsedCount;
+
+extern EDKII_TIMER_ONE_SHOT_PROTOCOL  *mEfiTimerOneShot;
+
+/**
+  Returns the current system time.
+
+  @return The current system time
+
+**/
+UINT64
+CoreCurrentSystemTime (
+  VOID
+  );
+
+/**
+  Checks the timer wheel against the current system time.
+  Signals any expired event timer.
+
+  @param  CheckEvent             Not used
+  @param  Context                Not used
+
+**/
+VOID
+EFIAPI
+CoreCheckTimers (
+  IN EFI_EVENT            CheckEvent,
+  IN VOID                 *Context
+  );
+
+//
+// Timer events and their expected state
+//
+IEVENT            *mTimerTestEvents[TIMER_TEST_EVENT_COUNT];
+TIMER_TEST_MODEL  mTimerTestModel[TIMER_TEST_EVENT_COUNT];
+
+//
+// Trigger time of the last timer event signaled in the current check of the
+// timer database, and whether timer events were signaled out of order
+//
+UINT64   mTimerTestLastTrigger;
+BOOLEAN  mTimerTestOutOfOrder;
+
+//
+// State of the pseudo random number generator
+//
+UINT32   mTimerTestSeed;
+
+/**
+  Return the next pseudo random number.
+
+  @return A pseudo random number in the range 0..0x7FFF.
+
+**/
+STATIC
+UINT32
+TimerTestRandom (
+  VOID
+  )
+{
+  mTimerTestSeed = mTimerTestSeed * 1103515245 + 12345;
+  return (mTimerTestSeed >> 16) & 0x7FFF;
+}
+
+/**
+  Return a pseudo random 64-bit number below a limit.
+
+  @param  Limit  The limit.
+
+  @return A pseudo random number in the range 0..Limit - 1.
+
+**/
+STATIC
+UINT64
+TimerTestRandom64 (
+  IN UINT64  Limit
+  )
+{
+  UINT64  Value;
+
+  Value = LShiftU64 (TimerTestRandom (), 45) | LShiftU64 (TimerTestRandom (), 30) |
+          LShiftU64 (TimerTestRandom (), 15) | TimerTestRandom ();
+  return Value % Limit;
+}
+
+/**
+  Return a pseudo random timer delay, spread from a single tick to beyond
+  the range of the timer wheel.
+
+  @return The delay in 100ns units.
+
+**/
+STATIC
+UINT64
+TimerTestRandomDelay (
+  VOID
+  )
+{
+  switch (TimerTestRandom () % 8) {
+  case 0:
+    return 0;
+  case 1:
+    return TimerTestRandom64 (10000);
+  case 2:
+  case 3:
+    return TimerTestRandom64 (200000);
+  case 4:
+    return TimerTestRandom64 (10000000);
+  case 5:
+    return TimerTestRandom64 (600000000);
+  case 6:
+    return TimerTestRandom64 (36000000000ULL);
+  default:
+    return TimerTestRandom64 (3600000000000ULL);
+  }
+}
+
+/**
+  Called for every timer event signaled by the timer services.
+
+  @param  Event                  The timer event signaled.
+
+**/
+VOID
+TimerTestEventSignaled (
+  IN IEVENT      *Event
+  )
+{
+  if (Event->Timer.TriggerTime < mTimerTestLastTrigger) {
+    mTimerTestOutOfOrder = TRUE;
+  }
+  mTimerTestLastTrigger = Event->Timer.TriggerTime;
+}
+
+/**
+  Set a timer event and its expected state.
+
+  @param  Index        The index of the timer event.
+  @param  Type         The type of the timer.
+  @param  TriggerTime  The number of 100ns units until the timer expires.
+
+  @retval EFI_SUCCESS  The timer event was set.
+
+**/
+STATIC
+EFI_STATUS
+TimerTestSetTimer (
+  IN UINTN            Index,
+  IN EFI_TIMER_DELAY  Type,
+  IN UINT64           TriggerTime
+  )
+{
+  TIMER_TEST_MODEL  *Model;
+
+  Model = &mTimerTestModel[Index];
+  Model->Armed       = FALSE;
+  Model->TriggerTime = 0;
+  Model->Period      = 0;
+  if (Type != TimerCancel) {
+    if ((Type == TimerPeriodic) && (TriggerTime == 0)) {
+      TriggerTime = STUB_TIMER_PERIOD;
+    }
+    if (Type == TimerPeriodic) {
+      Model->Period = TriggerTime;
+    }
+    Model->Armed       = TRUE;
+    Model->TriggerTime = mEfiSystemTime + TriggerTime;
+  }
+
+  return CoreSetTimer (mTimerTestEvents[Index], Type, TriggerTime);
+}
+
+/**
+  Expire the timer events of the model at the current system time, the way
+  the timer services are expected to.
+
+**/
+STATIC
+VOID
+TimerTestExpireModel (
+  VOID
+  )
+{
+  UINTN             Index;
+  BOOLEAN           Expired;
+  TIMER_TEST_MODEL  *Model;
+
+  do {
+    Expired = FALSE;
+    for (Index = 0; Index < TIMER_TEST_EVENT_COUNT; Index++) {
+      Model = &mTimerTestModel[Index];
+      if (!Model->Armed || (Model->TriggerTime > mEfiSystemTime)) {
+        continue;
+      }
+
+      Expired = TRUE;
+      Model->SignalCount++;
+      if (Model->Period == 0) {
+        Model->Armed = FALSE;
+        continue;
+      }
+      Model->TriggerTime += Model->Period;
+      if (Model->TriggerTime <= mEfiSystemTime) {
+        Model->TriggerTime = mEfiSystemTime;
+      }
+    }
+  } while (Expired);
+}
+
+/**
+  Return whether a timer event of the model is expired.
+
+  @retval TRUE   A timer event is expired.
+  @retval FALSE  No timer event is expired.
+
+**/
+STATIC
+BOOLEAN
+TimerTestModelExpired (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < TIMER_TEST_EVENT_COUNT; Index++) {
+    if (mTimerTestModel[Index].Armed && (mTimerTestModel[Index].TriggerTime <= mEfiSystemTime)) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/**
+  Cancel all the timer events.
+
+**/
+STATIC
+VOID
+TimerTestCancelAll (
+  VOID
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < TIMER_TEST_EVENT_COUNT; Index++) {
+    TimerTestSetTimer (Index, TimerCancel, 0);
+  }
+}
+
+/**
+  Process a timer tick, and check the timer database as long as the timer
+  services ask for it, the way the timer check event would be dispatched.
+
+  @param  Duration  The length of the timer tick in 100ns units.
+
+**/
+STATIC
+VOID
+TimerTestTick (
+  IN UINT64  Duration
+  )
+{
+  CoreTimerTick (Duration);
+  while (mStubCheckTimerEvent.SignalCount != 0) {
+    mStubCheckTimerEvent.SignalCount = 0;
+    mTimerTestLastTrigger = 0;
+    CoreCheckTimers (&mStubCheckTimerEvent, NULL);
+  }
+}
+
+/**
+  Set, cancel and expire timer events at random, and check after every timer
+  tick that the timer services signaled the same timer events as the model,
+  in order of trigger time, and left them armed in the same way.
+
+  @param[in]  Context    [Unused]
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TimersShouldExpireInOrder (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS        Status;
+  UINTN             Step;
+  UINTN             Index;
+  UINT64            Duration;
+  UINTN             Signals;
+  TIMER_TEST_MODEL  *Model;
+  IEVENT            *Event;
+
+  mTimerTestSeed       = 1;
+  mTimerTestOutOfOrder = FALSE;
+  Signals              = 0;
+
+  for (Step = 0; Step < TIMER_TEST_STEP_COUNT; Step++) {
+    //
+    // Set or cancel a few timers
+    //
+    for (Index = TimerTestRandom () % 4; Index > 0; Index--) {
+      switch (TimerTestRandom () % 8) {
+      case 0:
+        Status = TimerTestSetTimer (TimerTestRandom () % TIMER_TEST_EVENT_COUNT, TimerCancel, 0);
+        break;
+      case 1:
+      case 2:
+        Status = TimerTestSetTimer (TimerTestRandom () % TIMER_TEST_EVENT_COUNT, TimerPeriodic, TimerTestRandom64 (20000000));
+        break;
+      default:
+        Status = TimerTestSetTimer (TimerTestRandom () % TIMER_TEST_EVENT_COUNT, TimerRelative, TimerTestRandomDelay ());
+        break;
+      }
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+    }
+
+    //
+    // Advance the system time, now and then by hours
+    //
+    if ((TimerTestRandom () % 1024) == 0) {
+      Duration = TimerTestRandom64 (7200000000000ULL);
+    } else {
+      Duration = TIMER_TEST_TICK / 2 + TimerTestRandom64 (TIMER_TEST_TICK);
+    }
+
+    //
+    // A tick must ask for a check of the timer database if a timer is expired
+    //
+    CoreTimerTick (Duration);
+    if (TimerTestModelExpired ()) {
+      UT_ASSERT_NOT_EQUAL (mStubCheckTimerEvent.SignalCount, 0);
+    }
+    TimerTestTick (0);
+    TimerTestExpireModel ();
+
+    UT_ASSERT_FALSE (mTimerTestOutOfOrder);
+    for (Index = 0; Index < TIMER_TEST_EVENT_COUNT; Index++) {
+      Model = &mTimerTestModel[Index];
+      Event = mTimerTestEvents[Index];
+      UT_ASSERT_EQUAL (Event->SignalCount, Model->SignalCount);
+      UT_ASSERT_EQUAL (Event->Timer.Link.ForwardLink != NULL, Model->Armed);
+      if (Model->Armed) {
+        UT_ASSERT_EQUAL (Event->Timer.TriggerTime, Model->TriggerTime);
+        UT_ASSERT_EQUAL (Event->Timer.Period, Model->Period);
+      }
+    }
+  }
+
+  for (Index = 0; Index < TIMER_TEST_EVENT_COUNT; Index++) {
+    Signals += mTimerTestModel[Index].SignalCount;
+  }
+  UT_LOG_INFO ("%d timer events signaled\n", (UINT32)Signals);
+
+  TimerTestCancelAll ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Set, cancel and expire timer events at random in one-shot timer mode, where
+  the system time only advances when the timer interrupt fires, and check that
+  the timer interrupt never fires later than the timer event slack after the
+  earliest armed timer event, and that the timer services signaled the same
+  timer events as the model.
+
+  @param[in]  Context    [Unused]
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TimerInterruptShouldFireForNextTimer (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS        Status;
+  UINTN             Step;
+  UINTN             Index;
+  UINT64            NextTrigger;
+
+  mTimerTestSeed = 2;
+
+  CoreInitializeTimerOneShot ();
+  UT_ASSERT_NOT_NULL (mEfiTimerOneShot);
+  UT_ASSERT_NOT_EQUAL (mStubTimerDeadlineCount, 0);
+
+  for (Step = 0; Step < TIMER_TEST_STEP_COUNT; Step++) {
+    //
+    // Set or cancel a few timers
+    //
+    for (Index = TimerTestRandom () % 4; Index > 0; Index--) {
+      switch (TimerTestRandom () % 8) {
+      case 0:
+        Status = TimerTestSetTimer (TimerTestRandom () % TIMER_TEST_EVENT_COUNT, TimerCancel, 0);
+        break;
+      case 1:
+        Status = TimerTestSetTimer (TimerTestRandom () % TIMER_TEST_EVENT_COUNT, TimerPeriodic, TimerTestRandom64 (20000000));
+        break;
+      default:
+        Status = TimerTestSetTimer (TimerTestRandom () % TIMER_TEST_EVENT_COUNT, TimerRelative, TimerTestRandomDelay ());
+        break;
+      }
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+    }
+
+    //
+    // The timer interrupt must fire by the earliest trigger time of the armed
+    // timer events rounded up to the slack, unless a check of the timer
+    // database is pending for a timer set to expire now
+    //
+    NextTrigger = MAX_UINT64;
+    for (Index = 0; Index < TIMER_TEST_EVENT_COUNT; Index++) {
+      if (mTimerTestModel[Index].Armed) {
+        NextTrigger = MIN (NextTrigger, mTimerTestModel[Index].TriggerTime);
+      }
+    }
+    if ((NextTrigger != MAX_UINT64) && (mStubCheckTimerEvent.SignalCount == 0)) {
+      NextTrigger = ((NextTrigger + TIMER_TEST_SLACK - 1) / TIMER_TEST_SLACK) * TIMER_TEST_SLACK;
+      UT_ASSERT_TRUE (mStubTimerDeadline <= MAX (NextTrigger, mEfiSystemTime));
+    }
+
+    //
+    // Fire the timer interrupt
+    //
+    TimerTestTick (mStubTimerDeadline - mEfiSystemTime);
+    TimerTestExpireModel ();
+
+    for (Index = 0; Index < TIMER_TEST_EVENT_COUNT; Index++) {
+      UT_ASSERT_EQUAL (mTimerTestEvents[Index]->SignalCount, mTimerTestModel[Index].SignalCount);
+      UT_ASSERT_EQUAL (mTimerTestEvents[Index]->Timer.Link.ForwardLink != NULL, mTimerTestModel[Index].Armed);
+    }
+  }
+
+  UT_LOG_INFO ("%d timer interrupts programmed\n", (UINT32)mStubTimerDeadlineCount);
+  DEBUG ((DEBUG_INFO, "%d timer interrupts programmed\n", (UINT32)mStubTimerDeadlineCount));
+
+  TimerTestCancelAll ();
+  mEfiTimerOneShot = NULL;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that in one-shot timer mode, the current system time is only read from
+  the timer when the timer interrupt is programmed to fire later than one timer
+  period after the last timer tick.
+
+  @param[in]  Context    [Unused]
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SystemTimeShouldReadTimerForLongInterval (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS        Status;
+  UINTN             Step;
+  UINTN             ElapsedCount;
+
+  CoreInitializeTimerOneShot ();
+  UT_ASSERT_NOT_NULL (mEfiTimerOneShot);
+
+  //
+  // No timer is armed, so the timer interrupt is programmed far away once the
+  // timer wheel turned past the slots of the timers cancelled
+  //
+  for (Step = 0; mStubTimerDeadline <= mEfiSystemTime + STUB_TIMER_PERIOD; Step++) {
+    UT_ASSERT_TRUE (Step < TIMER_TEST_STEP_COUNT);
+    TimerTestTick (mStubTimerDeadline - mEfiSystemTime);
+  }
+  ElapsedCount = mStubTimerElapsedCount;
+  CoreCurrentSystemTime ();
+  UT_ASSERT_EQUAL (mStubTimerElapsedCount, ElapsedCount + 1);
+
+  Status = TimerTestSetTimer (0, TimerRelative, 50 * STUB_TIMER_PERIOD);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  ElapsedCount = mStubTimerElapsedCount;
+  CoreCurrentSystemTime ();
+  UT_ASSERT_EQUAL (mStubTimerElapsedCount, ElapsedCount + 1);
+
+  //
+  // A timer within the timer period brings the timer interrupt within the
+  // timer period, where the timer ticks count the system time
+  //
+  Status = TimerTestSetTimer (1, TimerRelative, STUB_TIMER_PERIOD / 2);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  ElapsedCount = mStubTimerElapsedCount;
+  CoreCurrentSystemTime ();
+  UT_ASSERT_EQUAL (mStubTimerElapsedCount, ElapsedCount);
+
+  //
+  // While expired timers wait to be signaled, the timer interrupt falls back
+  // to the timer period
+  //
+  CoreTimerTick (mStubTimerDeadline - mEfiSystemTime);
+  UT_ASSERT_NOT_EQUAL (mStubCheckTimerEvent.SignalCount, 0);
+  ElapsedCount = mStubTimerElapsedCount;
+  CoreCurrentSystemTime ();
+  UT_ASSERT_EQUAL (mStubTimerElapsedCount, ElapsedCount);
+
+  TimerTestTick (0);
+  TimerTestExpireModel ();
+  UT_ASSERT_EQUAL (mTimerTestEvents[1]->SignalCount, mTimerTestModel[1].SignalCount);
+
+  TimerTestCancelAll ();
+  mEfiTimerOneShot = NULL;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Measure the cost of setting timers and of timer ticks with many periodic
+  timers, and of one-shot timers set again before they expire, the way
+  network stacks use them.
+
+  @param[in]  Context    [Unused]
+
+  @retval  UNIT_TEST_PASSED             The Unit test has completed and the test
+                                        case was successful.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test case assertion has failed.
+
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TimerCost (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS              Status;
+  EDKII_TIMER_STATISTICS  Statistics;
+  UINTN                   Tick;
+  UINTN                   Index;
+  UINTN                   SetCount;
+  clock_t                 SetClocks;
+  clock_t                 TickClocks;
+  clock_t                 Start;
+  UINT32                  SetNanoSeconds;
+  UINT32                  TickNanoSeconds;
+
+  mTimerTestSeed = 1;
+
+  for (Index = 0; Index < BENCHMARK_PERIODIC_COUNT; Index++) {
+    Status = TimerTestSetTimer (Index, TimerPeriodic, TIMER_TEST_TICK + TimerTestRandom64 (10000000));
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+  for (Index = BENCHMARK_PERIODIC_COUNT; Index < BENCHMARK_PERIODIC_COUNT + BENCHMARK_ONE_SHOT_COUNT; Index++) {
+    Status = TimerTestSetTimer (Index, TimerRelative, 10000000 + TimerTestRandom64 (30000000));
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  CoreResetTimerStatistics ();
+  SetCount   = 0;
+  SetClocks  = 0;
+  TickClocks = 0;
+  for (Tick = 0; Tick < BENCHMARK_TICK_COUNT; Tick++) {
+    //
+    // Set again a few one-shot timers, as for retransmissions
+    //
+    Start = clock ();
+    for (Index = 0; Index < 16; Index++) {
+      CoreSetTimer (
+        mTimerTestEvents[BENCHMARK_PERIODIC_COUNT + TimerTestRandom () % BENCHMARK_ONE_SHOT_COUNT],
+        TimerRelative,
+        10000000 + TimerTestRandom64 (30000000)
+        );
+    }
+    SetClocks += clock () - Start;
+    SetCount  += Index;
+
+    Start = clock ();
+    TimerTestTick (TIMER_TEST_TICK);
+    TickClocks += clock () - Start;
+  }
+
+  Status = CoreGetTimerStatistics (&Statistics);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Statistics.TickCount, BENCHMARK_TICK_COUNT);
+
+  SetNanoSeconds  = (UINT32)((UINT64)SetClocks * (1000000000ULL / CLOCKS_PER_SEC) / SetCount);
+  TickNanoSeconds = (UINT32)((UINT64)TickClocks * (1000000000ULL / CLOCKS_PER_SEC) / BENCHMARK_TICK_COUNT);
+  UT_LOG_INFO (
+    "%d ns per SetTimer(), %d ns per tick, %d checks, work max %d with %d timers\n",
+    SetNanoSeconds,
+    TickNanoSeconds,
+    (UINT32)Statistics.CheckCount,
+    (UINT32)Statistics.MaxWork,
+    BENCHMARK_PERIODIC_COUNT + BENCHMARK_ONE_SHOT_COUNT
+    );
+  DEBUG ((
+    DEBUG_INFO,
+    "%d ns per SetTimer(), %d ns per tick, %d checks, work max %d with %d timers\n",
+    SetNanoSeconds,
+    TickNanoSeconds,
+    (UINT32)Statistics.CheckCount,
+    (UINT32)Statistics.MaxWork,
+    BENCHMARK_PERIODIC_COUNT + BENCHMARK_ONE_SHOT_COUNT
+    ));
+  for (Index = 0; Index < EDKII_TIMER_STATISTICS_HISTOGRAM_SIZE; Index++) {
+    if (Statistics.WorkHistogram[Index] != 0) {
+      DEBUG ((DEBUG_INFO, "  work < %6d: %d checks\n", 1 << Index, (UINT32)Statistics.WorkHistogram[Index]));
+    }
+  }
+
+  TimerTestCancelAll ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the timer services and create the timer events.
+
+  @retval  EFI_SUCCESS           The timer events were created.
+  @retval  EFI_OUT_OF_RESOURCES  The timer events could not be allocated.
+**/
+STATIC
+EFI_STATUS
+CreateTimerEvents (
+  VOID
+  )
+{
+  UINTN   Index;
+
+  CoreInitializeTimer ();
+
+  for (Index = 0; Index < TIMER_TEST_EVENT_COUNT; Index++) {
+    mTimerTestEvents[Index] = AllocateZeroPool (sizeof (IEVENT));
+    if (mTimerTestEvents[Index] == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    mTimerTestEvents[Index]->Signature = EVENT_SIGNATURE;
+    mTimerTestEvents[Index]->Type      = EVT_TIMER;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  timer services and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      TimerTests;
+  UNIT_TEST_SUITE_HANDLE      BenchmarkTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  Status = CreateTimerEvents ();
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed to create the timer events. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&TimerTests, Framework, "Timer Tests", "DxeCore.Timer", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for TimerTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (TimerTests, "Timers should expire in order of trigger time", "ExpireInOrder", TimersShouldExpireInOrder, NULL, NULL, NULL);
+  AddTestCase (TimerTests, "Timer interrupt should fire for the next timer", "OneShot", TimerInterruptShouldFireForNextTimer, NULL, NULL, NULL);
+  AddTestCase (TimerTests, "System time should read the timer for long intervals only", "OneShotElapsed", SystemTimeShouldReadTimerForLongInterval, NULL, NULL, NULL);
+
+  Status = CreateUnitTestSuite (&BenchmarkTests, Framework, "Timer Benchmarks", "DxeCore.Timer.Benchmark", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BenchmarkTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (BenchmarkTests, "SetTimer and timer tick cost with network timers", "NetworkTimers", TimerCost, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,261 @@
+/** @file
+  Host based stand-ins for the DXE Core services that the timer services
+  (Event/Timer.c) depend on.  Events are not dispatched in the host
+  environment: signaling an event only counts the signal.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "DxeMain.h"
+#include "Event.h"
+
+/**
+  Called for every timer event signaled by the timer services.
+
+  @param  Event                  The timer event signaled.
+
+**/
+VOID
+TimerTestEventSignaled (
+  IN IEVENT      *Event
+  );
+
+//
+// Timer period reported by the Timer Architectural Protocol, in 100ns units
+//
+#define STUB_TIMER_PERIOD  100000
+
+//
+// Event created by the timer services to check the timer database
+//
+IEVENT      mStubCheckTimerEvent;
+
+//
+// Current task priority level
+//
+EFI_TPL     mStubTpl = TPL_APPLICATION;
+
+/**
+  Returns the period of the timer tick.
+
+  @param  This                   The EFI_TIMER_ARCH_PROTOCOL instance.
+  @param  TimerPeriod            The period of the timer tick in 100ns units.
+
+  @retval EFI_SUCCESS            The timer period was returned.
+
+**/
+EFI_STATUS
+EFIAPI
+StubGetTimerPeriod (
+  IN  EFI_TIMER_ARCH_PROTOCOL  *This,
+  OUT UINT64                   *TimerPeriod
+  )
+{
+  *TimerPeriod = STUB_TIMER_PERIOD;
+  return EFI_SUCCESS;
+}
+
+EFI_TIMER_ARCH_PROTOCOL  mStubTimer = {
+  NULL,
+  NULL,
+  StubGetTimerPeriod,
+  NULL
+};
+
+EFI_TIMER_ARCH_PROTOCOL  *gTimer = &mStubTimer;
+
+//
+// Longest delay the stub Timer One-Shot Protocol can program, in 100ns units
+//
+#define STUB_TIMER_MAX_DELAY  10000000
+
+//
+// System time at which the stub Timer One-Shot Protocol is programmed to fire,
+// number of times it was programmed, and number of times the time elapsed was
+// read.  Time does not pass between timer ticks in the host environment, so
+// the time elapsed is always 0.
+//
+UINT64      mStubTimerDeadline;
+UINTN       mStubTimerDeadlineCount;
+UINTN       mStubTimerElapsedCount;
+
+extern UINT64  mEfiSystemTime;
+
+/**
+  Programs the stub timer interrupt to fire once, Delay 100ns units from now.
+
+  @param  This                   The EDKII_TIMER_ONE_SHOT_PROTOCOL instance.
+  @param  Delay                  The time until the timer interrupt, in 100ns
+                                 units.
+
+  @retval EFI_SUCCESS            The timer interrupt was programmed.
+
+**/
+EFI_STATUS
+EFIAPI
+StubSetDeadline (
+  IN EDKII_TIMER_ONE_SHOT_PROTOCOL  *This,
+  IN UINT64                         Delay
+  )
+{
+  mStubTimerDeadline = mEfiSystemTime + MIN (Delay, STUB_TIMER_MAX_DELAY);
+  mStubTimerDeadlineCount++;
+  return EFI_SUCCESS;
+}
+
+/**
+  Returns the time elapsed since the last timer tick.
+
+  @param  This                   The EDKII_TIMER_ONE_SHOT_PROTOCOL instance.
+  @param  Elapsed                The time elapsed, in 100ns units.
+
+  @retval EFI_SUCCESS            The time elapsed was returned.
+
+**/
+EFI_STATUS
+EFIAPI
+StubGetElapsedTime (
+  IN  EDKII_TIMER_ONE_SHOT_PROTOCOL  *This,
+  OUT UINT64                         *Elapsed
+  )
+{
+  *Elapsed = 0;
+  mStubTimerElapsedCount++;
+  return EFI_SUCCESS;
+}
+
+EDKII_TIMER_ONE_SHOT_PROTOCOL  mStubTimerOneShot = {
+  StubSetDeadline,
+  StubGetElapsedTime
+};
+
+/**
+  Raise the task priority level to the new level.
+
+  @param  NewTpl  New task priority level
+
+  @return The previous task priority level
+
+**/
+EFI_TPL
+EFIAPI
+CoreRaiseTpl (
+  IN EFI_TPL      NewTpl
+  )
+{
+  EFI_TPL     OldTpl;
+
+  OldTpl   = mStubTpl;
+  ASSERT (OldTpl <= NewTpl);
+  mStubTpl = NewTpl;
+  return OldTpl;
+}
+
+/**
+  Lowers the task priority to the previous value.
+
+  @param  NewTpl  New, lower, task priority
+
+**/
+VOID
+EFIAPI
+CoreRestoreTpl (
+  IN EFI_TPL NewTpl
+  )
+{
+  ASSERT (NewTpl <= mStubTpl);
+  mStubTpl = NewTpl;
+}
+
+/**
+  Creates an event.  The only event created by the timer services is the one
+  that checks the timer database.
+
+  @param  Type                   The type of event to create and its mode and
+                                 attributes
+  @param  NotifyTpl              The task priority level of event notifications
+  @param  NotifyFunction         Pointer to the events notification function
+  @param  NotifyContext          Pointer to the notification functions context;
+                                 corresponds to parameter "Context" in the
+                                 notification function
+  @param  EventGroup             GUID for EventGroup if NULL act the same as
+                                 gBS->CreateEvent().
+  @param  Event                  Pointer to the newly created event if the call
+                                 succeeds; undefined otherwise
+
+  @retval EFI_SUCCESS            The event structure was created
+
+**/
+EFI_STATUS
+EFIAPI
+CoreCreateEventInternal (
+  IN UINT32                   Type,
+  IN EFI_TPL                  NotifyTpl,
+  IN EFI_EVENT_NOTIFY         NotifyFunction,    OPTIONAL
+  IN CONST VOID               *NotifyContext,    OPTIONAL
+  IN CONST EFI_GUID           *EventGroup,       OPTIONAL
+  OUT EFI_EVENT               *Event
+  )
+{
+  mStubCheckTimerEvent.Signature = EVENT_SIGNATURE;
+  mStubCheckTimerEvent.Type      = Type;
+  mStubCheckTimerEvent.NotifyTpl = NotifyTpl;
+  *Event = &mStubCheckTimerEvent;
+  return EFI_SUCCESS;
+}
+
+/**
+  Signals the event.  The signal is counted, and reported to the test for
+  timer events.
+
+  @param  UserEvent              The event to signal .
+
+  @retval EFI_SUCCESS            The event was signaled.
+
+**/
+EFI_STATUS
+EFIAPI
+CoreSignalEvent (
+  IN EFI_EVENT    UserEvent
+  )
+{
+  IEVENT          *Event;
+
+  Event = UserEvent;
+  ASSERT (Event->Signature == EVENT_SIGNATURE);
+  Event->SignalCount++;
+  if (Event != &mStubCheckTimerEvent) {
+    TimerTestEventSignaled (Event);
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Locates the Timer One-Shot Protocol, the only protocol that the timer
+  services look for.
+
+  @param  Protocol               The protocol to search for
+  @param  Registration           Optional Registration Key returned from
+                                 RegisterProtocolNotify()
+  @param  Interface              Return the Protocol interface (instance).
+
+  @retval EFI_SUCCESS            If a valid Interface is returned
+  @retval EFI_NOT_FOUND          Protocol interface not found
+
+**/
+EFI_STATUS
+EFIAPI
+CoreLocateProtocol (
+  IN  EFI_GUID  *Protocol,
+  IN  VOID      *Registration OPTIONAL,
+  OUT VOID      **Interface
+  )
+{
+  if (!CompareGuid (Protocol, &gEdkiiTimerOneShotProtocolGuid)) {
+    return EFI_NOT_FOUND;
+  }
+  *Interface = &mStubTimerOneShot;
+  return EFI_SUCCESS;
+}
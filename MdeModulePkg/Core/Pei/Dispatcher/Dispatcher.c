@@ -712,6 +712,12 @@ PeiCheckAndSwitchStack (
       DEBUG ((DEBUG_INFO, "  temporary memory heap occupied by memory pages: %d bytes.\n",
              (UINT32)(UINTN)(Private->HobList.HandoffInformationTable->EfiMemoryTop - Private->HobList.HandoffInformationTable->EfiFreeMemoryTop)
             ));
+      DEBUG ((DEBUG_INFO, "PPI database: %d PPIs, %d notifies, %d PPIs located, %d descriptors scanned.\n",
+             (UINT32)Private->PpiData.PpiList.CurrentCount,
+             (UINT32)(Private->PpiData.CallbackNotifyList.CurrentCount + Private->PpiData.DispatchNotifyList.CurrentCount),
+             (UINT32)Private->PpiData.LocateCount,
+             (UINT32)Private->PpiData.ScanCount
+            ));
       for (Hob.Raw = Private->HobList.Raw; !END_OF_HOB_LIST(Hob); Hob.Raw = GET_NEXT_HOB(Hob)) {
         if (GET_HOB_TYPE (Hob) == EFI_HOB_TYPE_MEMORY_ALLOCATION) {
           DEBUG ((DEBUG_INFO, "Memory Allocation 0x%08x 0x%0lx - 0x%0lx\n", \
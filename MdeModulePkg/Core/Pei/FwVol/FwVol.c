@@ -244,8 +244,9 @@ FileHandleToVolume (
 
 /**
   Given the input file pointer, search for the first matching file in the
-  FFS volume as defined by SearchType. The search starts from FileHeader inside
-  the Firmware Volume defined by FwVolHeader.
+  FFS volume as defined by SearchType, by walking the FFS file headers of the
+  volume. The search starts from FileHeader inside the Firmware Volume defined
+  by FwVolHeader.
   If SearchType is EFI_FV_FILETYPE_ALL, the first FFS file will return without check its file type.
   If SearchType is PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE,
   the first PEIM, or COMBINED PEIM or FV file type FFS file will return.
@@ -262,7 +263,7 @@ FileHandleToVolume (
 
 **/
 EFI_STATUS
-FindFileEx (
+FindFileExByWalk (
   IN  CONST EFI_PEI_FV_HANDLE        FvHandle,
   IN  CONST EFI_GUID                 *FileName,   OPTIONAL
   IN        EFI_FV_FILETYPE          SearchType,
@@ -411,6 +412,9 @@ FindFileEx (
             }
           }
         }
+      } else if (SearchType == PEI_CORE_INTERNAL_FFS_FILE_INDEX_TYPE) {
+        *FileHeader = FfsFileHeader;
+        return EFI_SUCCESS;
       } else if (((SearchType == FfsFileHeader->Type) || (SearchType == EFI_FV_FILETYPE_ALL)) &&
                  (FfsFileHeader->Type != EFI_FV_FILETYPE_FFS_PAD)) {
         *FileHeader = FfsFileHeader;
@@ -446,6 +450,233 @@ FindFileEx (
   return EFI_NOT_FOUND;
 }
 
+/**
+  Get the hash of a file name in the file index of a firmware volume.
+
+  @param FileName        File name
+
+  @return The hash of the file name.
+
+**/
+UINT16
+GetFvFileIndexNameHash (
+  IN CONST EFI_GUID                  *FileName
+  )
+{
+  UINT32                                Hash;
+
+  Hash = ReadUnaligned32 ((UINT32 *) FileName) ^ ReadUnaligned32 ((UINT32 *) FileName + 1) ^
+         ReadUnaligned32 ((UINT32 *) FileName + 2) ^ ReadUnaligned32 ((UINT32 *) FileName + 3);
+  return (UINT16) (Hash ^ (Hash >> 16));
+}
+
+/**
+  Build the file index of a firmware volume.
+
+  The index holds the files that a walk of the FV may find, in the order of the
+  FV, so the searches of files in the FV do not walk the FFS file headers again
+  nor check their checksums again.  The FFS pad files are in the index, as a
+  search by name may find them.
+
+  @param CoreFvHandle    Pointer to the PEI_CORE_FV_HANDLE of the FV.
+
+**/
+VOID
+BuildFvFileIndex (
+  IN PEI_CORE_FV_HANDLE              *CoreFvHandle
+  )
+{
+  EFI_FFS_FILE_HEADER                   *FfsFileHeader;
+  UINTN                                 Count;
+  UINTN                                 Index;
+
+  CoreFvHandle->FileIndexed = TRUE;
+
+  Count = 0;
+  FfsFileHeader = NULL;
+  while (!EFI_ERROR (FindFileExByWalk (CoreFvHandle->FvHandle, NULL, PEI_CORE_INTERNAL_FFS_FILE_INDEX_TYPE, (EFI_PEI_FILE_HANDLE *) &FfsFileHeader, NULL))) {
+    Count++;
+  }
+  if (Count == 0) {
+    return;
+  }
+
+  CoreFvHandle->FileIndex = AllocatePool (sizeof (PEI_CORE_FV_FILE_INDEX_ENTRY) * Count);
+  if (CoreFvHandle->FileIndex == NULL) {
+    //
+    // The FV is searched by walking it.
+    //
+    CoreFvHandle->FileIndexed = FALSE;
+    return;
+  }
+
+  Index = 0;
+  FfsFileHeader = NULL;
+  while ((Index < Count) &&
+         !EFI_ERROR (FindFileExByWalk (CoreFvHandle->FvHandle, NULL, PEI_CORE_INTERNAL_FFS_FILE_INDEX_TYPE, (EFI_PEI_FILE_HANDLE *) &FfsFileHeader, NULL))) {
+    CoreFvHandle->FileIndex[Index].Offset   = (UINT32) ((UINTN) FfsFileHeader - (UINTN) CoreFvHandle->FvHandle);
+    CoreFvHandle->FileIndex[Index].NameHash = GetFvFileIndexNameHash (&FfsFileHeader->Name);
+    CoreFvHandle->FileIndex[Index].Type     = FfsFileHeader->Type;
+    CoreFvHandle->FileIndex[Index].Reserved = 0;
+    Index++;
+  }
+  CoreFvHandle->FileIndexCount = Index;
+}
+
+/**
+  Given the input file pointer, search for the first matching file in the
+  FFS volume as defined by SearchType, through the file index of the volume.
+  The search starts from FileHeader inside the Firmware Volume, and finds the
+  file the walk of the FFS file headers of the volume finds.
+
+  @param CoreFvHandle    Pointer to the PEI_CORE_FV_HANDLE of the FV, whose file
+                         index is built.
+  @param FileName        File name
+  @param SearchType      Filter to find only files of this type.
+                         Type EFI_FV_FILETYPE_ALL causes no filtering to be done.
+  @param FileHandle      This parameter must point to a valid FFS volume.
+  @param AprioriFile     Pointer to AprioriFile image in this FV if has
+
+  @return EFI_NOT_FOUND   No files matching the search criteria were found
+  @retval EFI_SUCCESS     Success to search given file
+  @retval EFI_UNSUPPORTED FileHandle is not a file of the index, and the volume
+                          has to be walked from it.
+
+**/
+EFI_STATUS
+FindFileExByIndex (
+  IN        PEI_CORE_FV_HANDLE       *CoreFvHandle,
+  IN  CONST EFI_GUID                 *FileName,   OPTIONAL
+  IN        EFI_FV_FILETYPE          SearchType,
+  IN OUT    EFI_PEI_FILE_HANDLE      *FileHandle,
+  IN OUT    EFI_PEI_FILE_HANDLE      *AprioriFile  OPTIONAL
+  )
+{
+  PEI_CORE_FV_FILE_INDEX_ENTRY          *Entry;
+  EFI_FFS_FILE_HEADER                   *FfsFileHeader;
+  UINTN                                 Index;
+  UINTN                                 Low;
+  UINTN                                 High;
+  UINTN                                 Offset;
+  UINT16                                NameHash;
+  UINT16                                AprioriNameHash;
+
+  //
+  // If FileHeader is not specified (NULL) or FileName is not NULL,
+  // start with the first file in the firmware volume.  Otherwise,
+  // start from the file after FileHeader in the index.
+  //
+  Index = 0;
+  if ((*FileHandle != NULL) && (FileName == NULL)) {
+    if ((UINTN) *FileHandle <= (UINTN) CoreFvHandle->FvHandle) {
+      return EFI_UNSUPPORTED;
+    }
+    Offset = (UINTN) *FileHandle - (UINTN) CoreFvHandle->FvHandle;
+    Low    = 0;
+    High   = CoreFvHandle->FileIndexCount;
+    while (Low < High) {
+      Index = Low + (High - Low) / 2;
+      if (CoreFvHandle->FileIndex[Index].Offset < Offset) {
+        Low = Index + 1;
+      } else {
+        High = Index;
+      }
+    }
+    if ((Low == CoreFvHandle->FileIndexCount) || (CoreFvHandle->FileIndex[Low].Offset != Offset)) {
+      return EFI_UNSUPPORTED;
+    }
+    Index = Low + 1;
+  }
+
+  NameHash        = 0;
+  AprioriNameHash = 0;
+  if (FileName != NULL) {
+    NameHash = GetFvFileIndexNameHash (FileName);
+  } else if (AprioriFile != NULL) {
+    AprioriNameHash = GetFvFileIndexNameHash (&gPeiAprioriFileNameGuid);
+  }
+
+  for (; Index < CoreFvHandle->FileIndexCount; Index++) {
+    Entry         = &CoreFvHandle->FileIndex[Index];
+    FfsFileHeader = (EFI_FFS_FILE_HEADER *) ((UINT8 *) CoreFvHandle->FvHandle + Entry->Offset);
+
+    if (FileName != NULL) {
+      if ((Entry->NameHash == NameHash) && CompareGuid (&FfsFileHeader->Name, FileName)) {
+        *FileHandle = (EFI_PEI_FILE_HANDLE) FfsFileHeader;
+        return EFI_SUCCESS;
+      }
+    } else if (SearchType == PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE) {
+      if ((Entry->Type == EFI_FV_FILETYPE_PEIM) ||
+          (Entry->Type == EFI_FV_FILETYPE_COMBINED_PEIM_DRIVER) ||
+          (Entry->Type == EFI_FV_FILETYPE_FIRMWARE_VOLUME_IMAGE)) {
+        *FileHandle = (EFI_PEI_FILE_HANDLE) FfsFileHeader;
+        return EFI_SUCCESS;
+      } else if ((AprioriFile != NULL) && (Entry->Type == EFI_FV_FILETYPE_FREEFORM)) {
+        if ((Entry->NameHash == AprioriNameHash) && CompareGuid (&FfsFileHeader->Name, &gPeiAprioriFileNameGuid)) {
+          *AprioriFile = (EFI_PEI_FILE_HANDLE) FfsFileHeader;
+        }
+      }
+    } else if (((SearchType == Entry->Type) || (SearchType == EFI_FV_FILETYPE_ALL)) &&
+               (Entry->Type != EFI_FV_FILETYPE_FFS_PAD)) {
+      *FileHandle = (EFI_PEI_FILE_HANDLE) FfsFileHeader;
+      return EFI_SUCCESS;
+    }
+  }
+
+  *FileHandle = NULL;
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Given the input file pointer, search for the first matching file in the
+  FFS volume as defined by SearchType. The search starts from FileHeader inside
+  the Firmware Volume defined by FwVolHeader.
+  If SearchType is EFI_FV_FILETYPE_ALL, the first FFS file will return without check its file type.
+  If SearchType is PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE,
+  the first PEIM, or COMBINED PEIM or FV file type FFS file will return.
+
+  The files of a volume the PEI Core has processed are found through the file
+  index of the volume, built by the first search of a file in the volume.
+
+  @param FvHandle        Pointer to the FV header of the volume to search
+  @param FileName        File name
+  @param SearchType      Filter to find only files of this type.
+                         Type EFI_FV_FILETYPE_ALL causes no filtering to be done.
+  @param FileHandle      This parameter must point to a valid FFS volume.
+  @param AprioriFile     Pointer to AprioriFile image in this FV if has
+
+  @return EFI_NOT_FOUND  No files matching the search criteria were found
+  @retval EFI_SUCCESS    Success to search given file
+
+**/
+EFI_STATUS
+FindFileEx (
+  IN  CONST EFI_PEI_FV_HANDLE        FvHandle,
+  IN  CONST EFI_GUID                 *FileName,   OPTIONAL
+  IN        EFI_FV_FILETYPE          SearchType,
+  IN OUT    EFI_PEI_FILE_HANDLE      *FileHandle,
+  IN OUT    EFI_PEI_FILE_HANDLE      *AprioriFile  OPTIONAL
+  )
+{
+  PEI_CORE_FV_HANDLE                    *CoreFvHandle;
+  EFI_STATUS                            Status;
+
+  CoreFvHandle = FvHandleToCoreHandle (FvHandle);
+  if (CoreFvHandle != NULL) {
+    if (!CoreFvHandle->FileIndexed) {
+      BuildFvFileIndex (CoreFvHandle);
+    }
+    if (CoreFvHandle->FileIndexed) {
+      Status = FindFileExByIndex (CoreFvHandle, FileName, SearchType, FileHandle, AprioriFile);
+      if (Status != EFI_UNSUPPORTED) {
+        return Status;
+      }
+    }
+  }
+
+  return FindFileExByWalk (FvHandle, FileName, SearchType, FileHandle, AprioriFile);
+}
+
 /**
   Initialize PeiCore FV List.
 
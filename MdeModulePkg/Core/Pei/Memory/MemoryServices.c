@@ -8,6 +8,15 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "PeiMain.h"
 
+//
+// The memory allocation HOB at an offset from the start of the HOB list, and the
+// offset of a memory allocation HOB, as the free memory index records them.
+//
+#define FREE_MEMORY_INDEX_HOB(PrivateData, Offset) \
+  ((EFI_HOB_MEMORY_ALLOCATION *) ((PrivateData)->HobList.Raw + (Offset)))
+#define FREE_MEMORY_INDEX_OFFSET(PrivateData, Hob) \
+  ((UINT32) ((UINTN) (Hob) - (UINTN) (PrivateData)->HobList.Raw))
+
 /**
 
   Initialize the memory services.
@@ -166,6 +175,294 @@ MigrateMemoryPages (
   Private->FreePhysicalMemoryTop = NewMemPagesBase;
 }
 
+/**
+  Search the free memory index for the free memory range that starts at an address.
+
+  @param[in]  PrivateData       Pointer to PeiCore's private data structure.
+  @param[in]  BaseAddress       The start address of the free memory range.
+  @param[out] Position          The position of the free memory range in the index
+                                if it is found, otherwise the position it would be
+                                inserted at.
+
+  @retval TRUE                  The free memory range is found.
+  @retval FALSE                 No free memory range in the index starts at BaseAddress.
+
+**/
+BOOLEAN
+SearchFreeMemoryRange (
+  IN  PEI_CORE_INSTANCE         *PrivateData,
+  IN  EFI_PHYSICAL_ADDRESS      BaseAddress,
+  OUT UINT32                    *Position
+  )
+{
+  PEI_FREE_MEMORY_INDEX         *Index;
+  UINT32                        Low;
+  UINT32                        High;
+  UINT32                        Middle;
+  EFI_PHYSICAL_ADDRESS          MiddleAddress;
+
+  Index = &PrivateData->FreeMemory;
+  Low   = 0;
+  High  = Index->RangeCount;
+  while (Low < High) {
+    Middle        = (Low + High) / 2;
+    MiddleAddress = FREE_MEMORY_INDEX_HOB (PrivateData, Index->Range[Middle])->AllocDescriptor.MemoryBaseAddress;
+    if (MiddleAddress == BaseAddress) {
+      *Position = Middle;
+      return TRUE;
+    }
+    if (MiddleAddress < BaseAddress) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  *Position = Low;
+  return FALSE;
+}
+
+/**
+  Delete the free memory range at a position of the free memory index.
+
+  @param[in] PrivateData        Pointer to PeiCore's private data structure.
+  @param[in] Position           The position of the free memory range in the index.
+
+**/
+VOID
+DeleteFreeMemoryRange (
+  IN PEI_CORE_INSTANCE          *PrivateData,
+  IN UINT32                     Position
+  )
+{
+  PEI_FREE_MEMORY_INDEX         *Index;
+
+  Index = &PrivateData->FreeMemory;
+  ASSERT (Position < Index->RangeCount);
+  CopyMem (
+    &Index->Range[Position],
+    &Index->Range[Position + 1],
+    (Index->RangeCount - Position - 1) * sizeof (Index->Range[0])
+    );
+  Index->RangeCount--;
+}
+
+/**
+  Add a memory allocation HOB that describes a free memory range to the free memory index.
+
+  @param[in] PrivateData            Pointer to PeiCore's private data structure.
+  @param[in] MemoryAllocationHob    Pointer to the EfiConventionalMemory memory allocation HOB.
+
+**/
+VOID
+InsertFreeMemoryRange (
+  IN PEI_CORE_INSTANCE          *PrivateData,
+  IN EFI_HOB_MEMORY_ALLOCATION  *MemoryAllocationHob
+  )
+{
+  PEI_FREE_MEMORY_INDEX         *Index;
+  UINT32                        Position;
+
+  Index = &PrivateData->FreeMemory;
+  if (Index->RangeOverflow) {
+    return;
+  }
+
+  if ((Index->RangeCount == PEI_FREE_MEMORY_RANGE_MAX) ||
+      SearchFreeMemoryRange (PrivateData, MemoryAllocationHob->AllocDescriptor.MemoryBaseAddress, &Position)) {
+    //
+    // The index cannot hold the free memory range, search the HOB list for
+    // the free memory ranges until the index is rebuilt.
+    //
+    Index->RangeOverflow = TRUE;
+    return;
+  }
+
+  CopyMem (
+    &Index->Range[Position + 1],
+    &Index->Range[Position],
+    (Index->RangeCount - Position) * sizeof (Index->Range[0])
+    );
+  Index->Range[Position] = FREE_MEMORY_INDEX_OFFSET (PrivateData, MemoryAllocationHob);
+  Index->RangeCount++;
+}
+
+/**
+  Remove a memory allocation HOB that describes a free memory range from the free memory index.
+
+  @param[in] PrivateData            Pointer to PeiCore's private data structure.
+  @param[in] MemoryAllocationHob    Pointer to the EfiConventionalMemory memory allocation HOB.
+
+**/
+VOID
+RemoveFreeMemoryRange (
+  IN PEI_CORE_INSTANCE          *PrivateData,
+  IN EFI_HOB_MEMORY_ALLOCATION  *MemoryAllocationHob
+  )
+{
+  UINT32                        Position;
+
+  if (PrivateData->FreeMemory.RangeOverflow) {
+    return;
+  }
+
+  if (!SearchFreeMemoryRange (PrivateData, MemoryAllocationHob->AllocDescriptor.MemoryBaseAddress, &Position) ||
+      (PrivateData->FreeMemory.Range[Position] != FREE_MEMORY_INDEX_OFFSET (PrivateData, MemoryAllocationHob))) {
+    ASSERT (FALSE);
+    return;
+  }
+
+  DeleteFreeMemoryRange (PrivateData, Position);
+}
+
+/**
+  Rebuild the free memory index from the memory allocation HOBs of the HOB list,
+  after the MemoryBaseAddress of the HOBs is converted, or after the free memory
+  ranges were more than the index could hold.
+
+  @param[in] PrivateData        Pointer to PeiCore's private data structure.
+
+**/
+VOID
+RebuildFreeMemoryIndex (
+  IN PEI_CORE_INSTANCE          *PrivateData
+  )
+{
+  EFI_PEI_HOB_POINTERS          Hob;
+
+  PrivateData->FreeMemory.RangeCount    = 0;
+  PrivateData->FreeMemory.RangeOverflow = FALSE;
+
+  Hob.Raw = GetFirstHob (EFI_HOB_TYPE_MEMORY_ALLOCATION);
+  while ((Hob.Raw != NULL) && !PrivateData->FreeMemory.RangeOverflow) {
+    if (Hob.MemoryAllocation->AllocDescriptor.MemoryType == EfiConventionalMemory) {
+      InsertFreeMemoryRange (PrivateData, Hob.MemoryAllocation);
+    }
+    Hob.Raw = GET_NEXT_HOB (Hob);
+    Hob.Raw = GetNextHob (EFI_HOB_TYPE_MEMORY_ALLOCATION, Hob.Raw);
+  }
+}
+
+/**
+  Mark a memory allocation HOB to be unused(freed), and record it to be reused
+  for the next memory allocation HOB.
+
+  @param[in]      PrivateData           Pointer to PeiCore's private data structure.
+  @param[in, out] MemoryAllocationHob   Pointer to the memory allocation HOB, which
+                                        is not in the free memory index.
+
+**/
+VOID
+MarkMemoryAllocationHobUnused (
+  IN     PEI_CORE_INSTANCE          *PrivateData,
+  IN OUT EFI_HOB_MEMORY_ALLOCATION  *MemoryAllocationHob
+  )
+{
+  PEI_FREE_MEMORY_INDEX             *Index;
+
+  MemoryAllocationHob->Header.HobType = EFI_HOB_TYPE_UNUSED;
+
+  Index = &PrivateData->FreeMemory;
+  if (Index->UnusedHobCount == PEI_UNUSED_MEMORY_HOB_MAX) {
+    Index->UnusedHobOverflow = TRUE;
+    return;
+  }
+  Index->UnusedHob[Index->UnusedHobCount++] = FREE_MEMORY_INDEX_OFFSET (PrivateData, MemoryAllocationHob);
+}
+
+/**
+  Get an unused(freed) memory allocation HOB to reuse.
+
+  @param[in] PrivateData        Pointer to PeiCore's private data structure.
+
+  @return Pointer to the unused memory allocation HOB, or NULL if there is none.
+
+**/
+EFI_HOB_MEMORY_ALLOCATION *
+GetUnusedMemoryAllocationHob (
+  IN PEI_CORE_INSTANCE          *PrivateData
+  )
+{
+  PEI_FREE_MEMORY_INDEX         *Index;
+  EFI_PEI_HOB_POINTERS          Hob;
+
+  Index = &PrivateData->FreeMemory;
+  if (Index->UnusedHobCount > 0) {
+    Index->UnusedHobCount--;
+    return FREE_MEMORY_INDEX_HOB (PrivateData, Index->UnusedHob[Index->UnusedHobCount]);
+  }
+
+  if (!Index->UnusedHobOverflow) {
+    return NULL;
+  }
+
+  //
+  // Search unused(freed) memory allocation HOB that could not be recorded.
+  //
+  Hob.Raw = GetFirstHob (EFI_HOB_TYPE_UNUSED);
+  while (Hob.Raw != NULL) {
+    if (Hob.Header->HobLength == sizeof (EFI_HOB_MEMORY_ALLOCATION)) {
+      return Hob.MemoryAllocation;
+    }
+
+    Hob.Raw = GET_NEXT_HOB (Hob);
+    Hob.Raw = GetNextHob (EFI_HOB_TYPE_UNUSED, Hob.Raw);
+  }
+
+  Index->UnusedHobOverflow = FALSE;
+  return NULL;
+}
+
+/**
+  Merge the free memory range of a memory allocation HOB with the adjacent free
+  memory ranges in the free memory index.
+
+  @param[in] PrivateData            Pointer to PeiCore's private data structure.
+  @param[in] MemoryAllocationHob    Pointer to the EfiConventionalMemory memory allocation HOB.
+
+  @return Pointer to the memory allocation HOB of the merged free memory range.
+
+**/
+EFI_HOB_MEMORY_ALLOCATION *
+MergeFreeMemoryRange (
+  IN PEI_CORE_INSTANCE          *PrivateData,
+  IN EFI_HOB_MEMORY_ALLOCATION  *MemoryAllocationHob
+  )
+{
+  PEI_FREE_MEMORY_INDEX         *Index;
+  UINT32                        Position;
+  EFI_HOB_MEMORY_ALLOCATION     *AdjacentHob;
+
+  Index = &PrivateData->FreeMemory;
+  if (Index->RangeOverflow ||
+      !SearchFreeMemoryRange (PrivateData, MemoryAllocationHob->AllocDescriptor.MemoryBaseAddress, &Position)) {
+    return MemoryAllocationHob;
+  }
+
+  if (Position + 1 < Index->RangeCount) {
+    AdjacentHob = FREE_MEMORY_INDEX_HOB (PrivateData, Index->Range[Position + 1]);
+    if ((MemoryAllocationHob->AllocDescriptor.MemoryBaseAddress + MemoryAllocationHob->AllocDescriptor.MemoryLength) ==
+        AdjacentHob->AllocDescriptor.MemoryBaseAddress) {
+      MemoryAllocationHob->AllocDescriptor.MemoryLength += AdjacentHob->AllocDescriptor.MemoryLength;
+      DeleteFreeMemoryRange (PrivateData, Position + 1);
+      MarkMemoryAllocationHobUnused (PrivateData, AdjacentHob);
+    }
+  }
+
+  if (Position > 0) {
+    AdjacentHob = FREE_MEMORY_INDEX_HOB (PrivateData, Index->Range[Position - 1]);
+    if ((AdjacentHob->AllocDescriptor.MemoryBaseAddress + AdjacentHob->AllocDescriptor.MemoryLength) ==
+        MemoryAllocationHob->AllocDescriptor.MemoryBaseAddress) {
+      AdjacentHob->AllocDescriptor.MemoryLength += MemoryAllocationHob->AllocDescriptor.MemoryLength;
+      DeleteFreeMemoryRange (PrivateData, Position);
+      MarkMemoryAllocationHobUnused (PrivateData, MemoryAllocationHob);
+      MemoryAllocationHob = AdjacentHob;
+    }
+  }
+
+  return MemoryAllocationHob;
+}
+
 /**
   Migrate MemoryBaseAddress in memory allocation HOBs
   from the temporary memory to PEI installed memory.
@@ -210,6 +507,11 @@ ConvertMemoryAllocationHobs (
     Hob.Raw = GET_NEXT_HOB (Hob);
     Hob.Raw = GetNextHob (EFI_HOB_TYPE_MEMORY_ALLOCATION, Hob.Raw);
   }
+
+  //
+  // The free memory ranges may not be sorted by MemoryBaseAddress anymore.
+  //
+  RebuildFreeMemoryIndex (PrivateData);
 }
 
 /**
@@ -217,6 +519,7 @@ ConvertMemoryAllocationHobs (
   It will search and reuse the unused(freed) memory allocation HOB,
   or build memory allocation HOB normally if no unused(freed) memory allocation HOB found.
 
+  @param[in] PrivateData        Pointer to PeiCore's private data structure.
   @param[in] BaseAddress        The 64 bit physical address of the memory.
   @param[in] Length             The length of the memory allocation in bytes.
   @param[in] MemoryType         The type of memory allocated by this HOB.
@@ -224,58 +527,55 @@ ConvertMemoryAllocationHobs (
 **/
 VOID
 InternalBuildMemoryAllocationHob (
+  IN PEI_CORE_INSTANCE          *PrivateData,
   IN EFI_PHYSICAL_ADDRESS       BaseAddress,
   IN UINT64                     Length,
   IN EFI_MEMORY_TYPE            MemoryType
   )
 {
-  EFI_PEI_HOB_POINTERS          Hob;
+  EFI_STATUS                    Status;
   EFI_HOB_MEMORY_ALLOCATION     *MemoryAllocationHob;
 
-  //
-  // Search unused(freed) memory allocation HOB.
-  //
-  MemoryAllocationHob = NULL;
-  Hob.Raw = GetFirstHob (EFI_HOB_TYPE_UNUSED);
-  while (Hob.Raw != NULL) {
-    if (Hob.Header->HobLength == sizeof (EFI_HOB_MEMORY_ALLOCATION)) {
-      MemoryAllocationHob = (EFI_HOB_MEMORY_ALLOCATION *) Hob.Raw;
-      break;
-    }
-
-    Hob.Raw = GET_NEXT_HOB (Hob);
-    Hob.Raw = GetNextHob (EFI_HOB_TYPE_UNUSED, Hob.Raw);
-  }
-
+  MemoryAllocationHob = GetUnusedMemoryAllocationHob (PrivateData);
   if (MemoryAllocationHob != NULL) {
     //
     // Reuse the unused(freed) memory allocation HOB.
     //
     MemoryAllocationHob->Header.HobType = EFI_HOB_TYPE_MEMORY_ALLOCATION;
-    ZeroMem (&(MemoryAllocationHob->AllocDescriptor.Name), sizeof (EFI_GUID));
-    MemoryAllocationHob->AllocDescriptor.MemoryBaseAddress = BaseAddress;
-    MemoryAllocationHob->AllocDescriptor.MemoryLength      = Length;
-    MemoryAllocationHob->AllocDescriptor.MemoryType        = MemoryType;
-    //
-    // Zero the reserved space to match HOB spec
-    //
-    ZeroMem (MemoryAllocationHob->AllocDescriptor.Reserved, sizeof (MemoryAllocationHob->AllocDescriptor.Reserved));
   } else {
     //
     // No unused(freed) memory allocation HOB found.
     // Build memory allocation HOB normally.
     //
-    BuildMemoryAllocationHob (
-      BaseAddress,
-      Length,
-      MemoryType
-      );
+    ASSERT (((BaseAddress & EFI_PAGE_MASK) == 0) && ((Length & EFI_PAGE_MASK) == 0));
+    Status = PeiServicesCreateHob (
+               EFI_HOB_TYPE_MEMORY_ALLOCATION,
+               (UINT16) sizeof (EFI_HOB_MEMORY_ALLOCATION),
+               (VOID **) &MemoryAllocationHob
+               );
+    if (EFI_ERROR (Status)) {
+      return;
+    }
+  }
+
+  ZeroMem (&(MemoryAllocationHob->AllocDescriptor.Name), sizeof (EFI_GUID));
+  MemoryAllocationHob->AllocDescriptor.MemoryBaseAddress = BaseAddress;
+  MemoryAllocationHob->AllocDescriptor.MemoryLength      = Length;
+  MemoryAllocationHob->AllocDescriptor.MemoryType        = MemoryType;
+  //
+  // Zero the reserved space to match HOB spec
+  //
+  ZeroMem (MemoryAllocationHob->AllocDescriptor.Reserved, sizeof (MemoryAllocationHob->AllocDescriptor.Reserved));
+
+  if (MemoryType == EfiConventionalMemory) {
+    InsertFreeMemoryRange (PrivateData, MemoryAllocationHob);
   }
 }
 
 /**
   Update or split memory allocation HOB for memory pages allocate and free.
 
+  @param[in]      PrivateData           Pointer to PeiCore's private data structure.
   @param[in, out] MemoryAllocationHob   Pointer to the memory allocation HOB
                                         that needs to be updated or split.
                                         On output, it will be filled with
@@ -288,18 +588,24 @@ InternalBuildMemoryAllocationHob (
 **/
 VOID
 UpdateOrSplitMemoryAllocationHob (
+  IN PEI_CORE_INSTANCE                  *PrivateData,
   IN OUT EFI_HOB_MEMORY_ALLOCATION      *MemoryAllocationHob,
   IN EFI_PHYSICAL_ADDRESS               Memory,
   IN UINT64                             Bytes,
   IN EFI_MEMORY_TYPE                    MemoryType
   )
 {
+  if (MemoryAllocationHob->AllocDescriptor.MemoryType == EfiConventionalMemory) {
+    RemoveFreeMemoryRange (PrivateData, MemoryAllocationHob);
+  }
+
   if ((Memory + Bytes) <
       (MemoryAllocationHob->AllocDescriptor.MemoryBaseAddress + MemoryAllocationHob->AllocDescriptor.MemoryLength)) {
     //
     // Last pages need to be split out.
     //
     InternalBuildMemoryAllocationHob (
+      PrivateData,
       Memory + Bytes,
       (MemoryAllocationHob->AllocDescriptor.MemoryBaseAddress + MemoryAllocationHob->AllocDescriptor.MemoryLength) - (Memory + Bytes),
       MemoryAllocationHob->AllocDescriptor.MemoryType
@@ -311,6 +617,7 @@ UpdateOrSplitMemoryAllocationHob (
     // First pages need to be split out.
     //
     InternalBuildMemoryAllocationHob (
+      PrivateData,
       MemoryAllocationHob->AllocDescriptor.MemoryBaseAddress,
       Memory - MemoryAllocationHob->AllocDescriptor.MemoryBaseAddress,
       MemoryAllocationHob->AllocDescriptor.MemoryType
@@ -323,10 +630,61 @@ UpdateOrSplitMemoryAllocationHob (
   MemoryAllocationHob->AllocDescriptor.MemoryBaseAddress = Memory;
   MemoryAllocationHob->AllocDescriptor.MemoryLength = Bytes;
   MemoryAllocationHob->AllocDescriptor.MemoryType = MemoryType;
+
+  if (MemoryType == EfiConventionalMemory) {
+    InsertFreeMemoryRange (PrivateData, MemoryAllocationHob);
+  }
+}
+
+/**
+  Merge adjacent free memory ranges in the free memory index.
+
+  @param[in] PrivateData        Pointer to PeiCore's private data structure.
+
+  @retval TRUE          There are free memory ranges merged.
+  @retval FALSE         No free memory ranges merged.
+
+**/
+BOOLEAN
+MergeFreeMemoryInFreeMemoryIndex (
+  IN PEI_CORE_INSTANCE          *PrivateData
+  )
+{
+  PEI_FREE_MEMORY_INDEX         *Index;
+  EFI_HOB_MEMORY_ALLOCATION     *MemoryHob;
+  EFI_HOB_MEMORY_ALLOCATION     *MemoryHob2;
+  UINT32                        Position;
+  BOOLEAN                       Merged;
+
+  Merged = FALSE;
+
+  Index    = &PrivateData->FreeMemory;
+  Position = 1;
+  while (Position < Index->RangeCount) {
+    MemoryHob  = FREE_MEMORY_INDEX_HOB (PrivateData, Index->Range[Position - 1]);
+    MemoryHob2 = FREE_MEMORY_INDEX_HOB (PrivateData, Index->Range[Position]);
+    if ((MemoryHob->AllocDescriptor.MemoryBaseAddress + MemoryHob->AllocDescriptor.MemoryLength) ==
+        MemoryHob2->AllocDescriptor.MemoryBaseAddress) {
+      //
+      // Merge adjacent two free memory ranges.
+      //
+      MemoryHob->AllocDescriptor.MemoryLength += MemoryHob2->AllocDescriptor.MemoryLength;
+      Merged = TRUE;
+      DeleteFreeMemoryRange (PrivateData, Position);
+      MarkMemoryAllocationHobUnused (PrivateData, MemoryHob2);
+    } else {
+      Position++;
+    }
+  }
+
+  return Merged;
 }
 
 /**
-  Merge adjacent free memory ranges in memory allocation HOBs.
+  Merge adjacent free memory ranges in memory allocation HOBs, when the free
+  memory index could not hold all of them, and rebuild the index.
+
+  @param[in] PrivateData        Pointer to PeiCore's private data structure.
 
   @retval TRUE          There are free memory ranges merged.
   @retval FALSE         No free memory ranges merged.
@@ -334,7 +692,7 @@ UpdateOrSplitMemoryAllocationHob (
 **/
 BOOLEAN
 MergeFreeMemoryInMemoryAllocationHob (
-  VOID
+  IN PEI_CORE_INSTANCE          *PrivateData
   )
 {
   EFI_PEI_HOB_POINTERS          Hob;
@@ -368,7 +726,7 @@ MergeFreeMemoryInMemoryAllocationHob (
             //
             // Mark MemoryHob to be unused(freed).
             //
-            MemoryHob->Header.HobType = EFI_HOB_TYPE_UNUSED;
+            MarkMemoryAllocationHobUnused (PrivateData, MemoryHob);
             break;
           } else if (End == MemoryHob2->AllocDescriptor.MemoryBaseAddress) {
             //
@@ -380,7 +738,7 @@ MergeFreeMemoryInMemoryAllocationHob (
             //
             // Mark MemoryHob to be unused(freed).
             //
-            MemoryHob->Header.HobType = EFI_HOB_TYPE_UNUSED;
+            MarkMemoryAllocationHobUnused (PrivateData, MemoryHob);
             break;
           }
         }
@@ -392,12 +750,19 @@ MergeFreeMemoryInMemoryAllocationHob (
     Hob.Raw = GetNextHob (EFI_HOB_TYPE_MEMORY_ALLOCATION, Hob.Raw);
   }
 
+  //
+  // The index may hold the free memory ranges left after merging.
+  //
+  RebuildFreeMemoryIndex (PrivateData);
+
   return Merged;
 }
 
 /**
-  Find free memory by searching memory allocation HOBs.
+  Find free memory by searching the free memory index, or memory allocation HOBs
+  if the index could not hold all the free memory ranges.
 
+  @param[in]  PrivateData       Pointer to PeiCore's private data structure.
   @param[in]  MemoryType        The type of memory to allocate.
   @param[in]  Pages             The number of contiguous 4 KB pages to allocate.
   @param[in]  Granularity       Page allocation granularity.
@@ -410,6 +775,7 @@ MergeFreeMemoryInMemoryAllocationHob (
 **/
 EFI_STATUS
 FindFreeMemoryFromMemoryAllocationHob (
+  IN  PEI_CORE_INSTANCE         *PrivateData,
   IN  EFI_MEMORY_TYPE           MemoryType,
   IN  UINTN                     Pages,
   IN  UINTN                     Granularity,
@@ -420,12 +786,37 @@ FindFreeMemoryFromMemoryAllocationHob (
   EFI_HOB_MEMORY_ALLOCATION     *MemoryAllocationHob;
   UINT64                        Bytes;
   EFI_PHYSICAL_ADDRESS          BaseAddress;
+  UINT32                        Position;
+  BOOLEAN                       Merged;
 
   Bytes = LShiftU64 (Pages, EFI_PAGE_SHIFT);
 
   BaseAddress = 0;
   MemoryAllocationHob = NULL;
-  Hob.Raw = GetFirstHob (EFI_HOB_TYPE_MEMORY_ALLOCATION);
+  if (!PrivateData->FreeMemory.RangeOverflow) {
+    //
+    // Allocate from the highest free memory range that is big enough.
+    //
+    for (Position = PrivateData->FreeMemory.RangeCount; Position > 0; Position--) {
+      MemoryAllocationHob = FREE_MEMORY_INDEX_HOB (PrivateData, PrivateData->FreeMemory.Range[Position - 1]);
+      if (MemoryAllocationHob->AllocDescriptor.MemoryLength >= Bytes) {
+        BaseAddress = MemoryAllocationHob->AllocDescriptor.MemoryBaseAddress +
+                      MemoryAllocationHob->AllocDescriptor.MemoryLength - Bytes;
+        //
+        // Make sure the granularity could be satisfied.
+        //
+        BaseAddress &= ~((EFI_PHYSICAL_ADDRESS) Granularity - 1);
+        if (BaseAddress >= MemoryAllocationHob->AllocDescriptor.MemoryBaseAddress) {
+          break;
+        }
+      }
+      BaseAddress = 0;
+      MemoryAllocationHob = NULL;
+    }
+    Hob.Raw = NULL;
+  } else {
+    Hob.Raw = GetFirstHob (EFI_HOB_TYPE_MEMORY_ALLOCATION);
+  }
   while (Hob.Raw != NULL) {
     if ((Hob.MemoryAllocation->AllocDescriptor.MemoryType == EfiConventionalMemory) &&
         (Hob.MemoryAllocation->AllocDescriptor.MemoryLength >= Bytes)) {
@@ -453,15 +844,20 @@ FindFreeMemoryFromMemoryAllocationHob (
   }
 
   if (MemoryAllocationHob != NULL) {
-    UpdateOrSplitMemoryAllocationHob (MemoryAllocationHob, BaseAddress, Bytes, MemoryType);
+    UpdateOrSplitMemoryAllocationHob (PrivateData, MemoryAllocationHob, BaseAddress, Bytes, MemoryType);
     *Memory = BaseAddress;
     return EFI_SUCCESS;
   } else {
-    if (MergeFreeMemoryInMemoryAllocationHob ()) {
+    if (!PrivateData->FreeMemory.RangeOverflow) {
+      Merged = MergeFreeMemoryInFreeMemoryIndex (PrivateData);
+    } else {
+      Merged = MergeFreeMemoryInMemoryAllocationHob (PrivateData);
+    }
+    if (Merged) {
       //
       // Retry if there are free memory ranges merged.
       //
-      return FindFreeMemoryFromMemoryAllocationHob (MemoryType, Pages, Granularity, Memory);
+      return FindFreeMemoryFromMemoryAllocationHob (PrivateData, MemoryType, Pages, Granularity, Memory);
     }
     return EFI_NOT_FOUND;
   }
@@ -572,6 +968,7 @@ PeiAllocatePages (
     // the pages that we will lose to rounding
     //
     InternalBuildMemoryAllocationHob (
+      PrivateData,
       *(FreeMemoryTop),
       Padding & ~(UINTN)EFI_PAGE_MASK,
       EfiConventionalMemory
@@ -590,7 +987,7 @@ PeiAllocatePages (
     //
     // Try to find free memory by searching memory allocation HOBs.
     //
-    Status = FindFreeMemoryFromMemoryAllocationHob (MemoryType, Pages, Granularity, Memory);
+    Status = FindFreeMemoryFromMemoryAllocationHob (PrivateData, MemoryType, Pages, Granularity, Memory);
     if (!EFI_ERROR (Status)) {
       return Status;
     }
@@ -612,6 +1009,7 @@ PeiAllocatePages (
     // Create a memory allocation HOB.
     //
     InternalBuildMemoryAllocationHob (
+      PrivateData,
       *(FreeMemoryTop),
       Pages * EFI_PAGE_SIZE,
       MemoryType
@@ -638,6 +1036,7 @@ FreeMemoryAllocationHob (
   EFI_PEI_HOB_POINTERS                  Hob;
   EFI_PHYSICAL_ADDRESS                  *FreeMemoryTop;
   EFI_HOB_MEMORY_ALLOCATION             *MemoryAllocationHob;
+  UINT32                                Position;
 
   Hob.Raw = PrivateData->HobList.Raw;
 
@@ -659,10 +1058,18 @@ FreeMemoryAllocationHob (
     //
     // Mark the memory allocation HOB to be unused(freed).
     //
-    MemoryAllocationHobToFree->Header.HobType = EFI_HOB_TYPE_UNUSED;
+    RemoveFreeMemoryRange (PrivateData, MemoryAllocationHobToFree);
+    MarkMemoryAllocationHobUnused (PrivateData, MemoryAllocationHobToFree);
 
     MemoryAllocationHob = NULL;
-    Hob.Raw = GetFirstHob (EFI_HOB_TYPE_MEMORY_ALLOCATION);
+    if (!PrivateData->FreeMemory.RangeOverflow) {
+      if (SearchFreeMemoryRange (PrivateData, *FreeMemoryTop, &Position)) {
+        MemoryAllocationHob = FREE_MEMORY_INDEX_HOB (PrivateData, PrivateData->FreeMemory.Range[Position]);
+      }
+      Hob.Raw = NULL;
+    } else {
+      Hob.Raw = GetFirstHob (EFI_HOB_TYPE_MEMORY_ALLOCATION);
+    }
     while (Hob.Raw != NULL) {
       if ((Hob.MemoryAllocation->AllocDescriptor.MemoryType == EfiConventionalMemory) &&
           (Hob.MemoryAllocation->AllocDescriptor.MemoryBaseAddress == *FreeMemoryTop)) {
@@ -748,7 +1155,8 @@ PeiFreePages (
   }
 
   if (MemoryAllocationHob != NULL) {
-    UpdateOrSplitMemoryAllocationHob (MemoryAllocationHob, Memory, Bytes, EfiConventionalMemory);
+    UpdateOrSplitMemoryAllocationHob (PrivateData, MemoryAllocationHob, Memory, Bytes, EfiConventionalMemory);
+    MemoryAllocationHob = MergeFreeMemoryRange (PrivateData, MemoryAllocationHob);
     FreeMemoryAllocationHob (PrivateData, MemoryAllocationHob);
     return EFI_SUCCESS;
   } else {
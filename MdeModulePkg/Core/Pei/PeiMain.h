@@ -51,6 +51,13 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 ///
 #define PEI_CORE_INTERNAL_FFS_FILE_DISPATCH_TYPE   0xff
 
+///
+/// It is an FFS type extension used for PeiFindFileEx. It indicates current
+/// FFS searching is for all FFS files, including the pad files, to build the
+/// file index of the FV.
+///
+#define PEI_CORE_INTERNAL_FFS_FILE_INDEX_TYPE      0xfe
+
 ///
 /// Pei Core private data structures
 ///
@@ -67,6 +74,46 @@ typedef union {
 #define CALLBACK_NOTIFY_GROWTH_STEP 32
 #define DISPATCH_NOTIFY_GROWTH_STEP 8
 
+///
+/// Number of buckets of the GUID hash index of a PPI or notify list, a power of two.
+///
+#define PPI_HASH_BUCKET_COUNT       32
+
+///
+/// The GUID hash index of a PPI or notify list.
+///
+/// The descriptors whose GUIDs hash to the same bucket are chained in the order
+/// of the list, so the PPIs and the notifies of a GUID are found in the order
+/// they were installed, without comparing the GUID of every descriptor of the
+/// list.  The links of the chains are the index + 1 of the descriptors, 0 ending
+/// a chain.  The link to the next descriptor of the chain of each descriptor is
+/// in an array of MaxCount UINT16 that follows the MaxCount pointers of the list,
+/// in the same buffer, so it migrates with them.
+///
+typedef struct {
+  ///
+  /// The link to the first descriptor of each bucket.
+  ///
+  UINT16                Head[PPI_HASH_BUCKET_COUNT];
+  ///
+  /// The link to the last descriptor of each bucket.
+  ///
+  UINT16                Tail[PPI_HASH_BUCKET_COUNT];
+} PEI_PPI_HASH_INDEX;
+
+///
+/// The maximum number of PPIs whose notifies are found by walking the chains of
+/// the GUID hash index of the notify list.  The notifies for more PPIs are all
+/// checked, and the PPIs of each of them found in the hash index of the PPI list.
+///
+#define PPI_NOTIFY_MERGE_MAX        4
+
+///
+/// The links to the next descriptor of the chains of the GUID hash index of a
+/// PPI or notify list.
+///
+#define PPI_HASH_NEXT_LINKS(Ptrs, MaxCount)  ((UINT16 *) ((Ptrs) + (MaxCount)))
+
 typedef struct {
   UINTN                 CurrentCount;
   UINTN                 MaxCount;
@@ -75,6 +122,7 @@ typedef struct {
   /// MaxCount number of entries.
   ///
   PEI_PPI_LIST_POINTERS *PpiPtrs;
+  PEI_PPI_HASH_INDEX    HashIndex;
 } PEI_PPI_LIST;
 
 typedef struct {
@@ -84,6 +132,7 @@ typedef struct {
   /// MaxCount number of entries.
   ///
   PEI_PPI_LIST_POINTERS *NotifyPtrs;
+  PEI_PPI_HASH_INDEX    HashIndex;
 } PEI_CALLBACK_NOTIFY_LIST;
 
 typedef struct {
@@ -94,6 +143,7 @@ typedef struct {
   /// MaxCount number of entries.
   ///
   PEI_PPI_LIST_POINTERS *NotifyPtrs;
+  PEI_PPI_HASH_INDEX    HashIndex;
 } PEI_DISPATCH_NOTIFY_LIST;
 
 ///
@@ -113,6 +163,15 @@ typedef struct {
   /// Notify List at callback level.
   ///
   PEI_DISPATCH_NOTIFY_LIST  DispatchNotifyList;
+  ///
+  /// The number of PPIs that PeiLocatePpi() was called to locate.
+  ///
+  UINTN                     LocateCount;
+  ///
+  /// The number of descriptors whose GUID was compared to locate the PPIs and
+  /// to match the notifies with the PPIs.
+  ///
+  UINTN                     ScanCount;
 } PEI_PPI_DATABASE;
 
 //
@@ -130,6 +189,26 @@ typedef struct {
 //
 #define FV_GROWTH_STEP 8
 
+///
+/// An entry of the file index of a firmware volume.
+///
+typedef struct {
+  ///
+  /// The offset of the FFS file header from the FV header.
+  ///
+  UINT32                              Offset;
+  ///
+  /// The hash of the name of the file.  The name is only compared with the names
+  /// of the same hash.
+  ///
+  UINT16                              NameHash;
+  ///
+  /// The type of the file.
+  ///
+  EFI_FV_FILETYPE                     Type;
+  UINT8                               Reserved;
+} PEI_CORE_FV_FILE_INDEX_ENTRY;
+
 typedef struct {
   EFI_FIRMWARE_VOLUME_HEADER          *FvHeader;
   EFI_PEI_FIRMWARE_VOLUME_PPI         *FvPpi;
@@ -145,6 +224,17 @@ typedef struct {
   EFI_PEI_FILE_HANDLE                 *FvFileHandles;
   BOOLEAN                             ScanFv;
   UINT32                              AuthenticationStatus;
+  //
+  // TRUE once the file index of the FV is built, by the first search of a file
+  // in the FV.
+  //
+  BOOLEAN                             FileIndexed;
+  UINTN                               FileIndexCount;
+  //
+  // Pointer to the buffer with the FileIndexCount number of Entries, one for each
+  // file of the FV that a search may find, in the order of the FV.
+  //
+  PEI_CORE_FV_FILE_INDEX_ENTRY        *FileIndex;
 } PEI_CORE_FV_HANDLE;
 
 typedef struct {
@@ -173,6 +263,43 @@ typedef struct {
   BOOLEAN                            OffsetPositive;
 } HOLE_MEMORY_DATA;
 
+///
+/// The maximum number of free memory ranges, and of unused memory allocation HOBs,
+/// that the PEI Core keeps in PEI_FREE_MEMORY_INDEX.
+///
+#define PEI_FREE_MEMORY_RANGE_MAX       32
+#define PEI_UNUSED_MEMORY_HOB_MAX       16
+
+///
+/// The index of the memory allocation HOBs that FreePages() and AllocatePages()
+/// leave in the HOB list: the EfiConventionalMemory HOBs that describe the free
+/// memory ranges, and the HOBs marked unused, which are reused for the next memory
+/// allocation HOB.  The HOBs are recorded by their offset from the start of the
+/// HOB list, so the index stays valid when the HOB list is migrated.
+///
+typedef struct {
+  ///
+  /// The offsets of the free memory allocation HOBs, sorted by MemoryBaseAddress.
+  ///
+  UINT32                             Range[PEI_FREE_MEMORY_RANGE_MAX];
+  UINT32                             RangeCount;
+  ///
+  /// TRUE if there were more free memory ranges than Range could hold, so they are
+  /// found by searching the HOB list until the index is rebuilt.
+  ///
+  BOOLEAN                            RangeOverflow;
+  ///
+  /// The offsets of the unused memory allocation HOBs.
+  ///
+  UINT32                             UnusedHob[PEI_UNUSED_MEMORY_HOB_MAX];
+  UINT32                             UnusedHobCount;
+  ///
+  /// TRUE if there were more unused memory allocation HOBs than UnusedHob could
+  /// hold, so the HOB list is searched for them once UnusedHob is empty.
+  ///
+  BOOLEAN                            UnusedHobOverflow;
+} PEI_FREE_MEMORY_INDEX;
+
 ///
 /// Forward declaration for PEI_CORE_INSTANCE
 ///
@@ -272,6 +399,10 @@ struct _PEI_CORE_INSTANCE {
   // Information for migrating memory pages allocated in pre-memory phase.
   //
   HOLE_MEMORY_DATA                   MemoryPages;
+  //
+  // The free memory ranges and unused memory allocation HOBs in the HOB list.
+  //
+  PEI_FREE_MEMORY_INDEX              FreeMemory;
   PEICORE_FUNCTION_POINTER           ShadowedPeiCore;
   CACHE_SECTION_DATA                 CacheSection;
   //
@@ -8,6 +8,156 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "PeiMain.h"
 
+/**
+
+  Compare two GUIDs of the PPI database.
+
+  @param Guid1           Pointer to the first GUID.
+  @param Guid2           Pointer to the second GUID.
+
+  @retval TRUE           The GUIDs are the same.
+  @retval FALSE          The GUIDs are different.
+
+**/
+BOOLEAN
+IsPpiGuidEqual (
+  IN CONST EFI_GUID      *Guid1,
+  IN CONST EFI_GUID      *Guid2
+  )
+{
+  //
+  // Don't use CompareGuid function here for performance reasons.
+  // Instead we compare the GUID as INT32 at a time and branch
+  // on the first failed comparison.
+  //
+  return (BOOLEAN) ((((INT32 *)Guid1)[0] == ((INT32 *)Guid2)[0]) &&
+                    (((INT32 *)Guid1)[1] == ((INT32 *)Guid2)[1]) &&
+                    (((INT32 *)Guid1)[2] == ((INT32 *)Guid2)[2]) &&
+                    (((INT32 *)Guid1)[3] == ((INT32 *)Guid2)[3]));
+}
+
+/**
+
+  Get the bucket of a GUID in the GUID hash index of a PPI or notify list.
+
+  @param Guid            Pointer to the GUID.
+
+  @return The bucket of the GUID.
+
+**/
+UINTN
+GetPpiHashBucket (
+  IN CONST EFI_GUID      *Guid
+  )
+{
+  UINT32                 Hash;
+
+  Hash  = ((UINT32 *)Guid)[0] ^ ((UINT32 *)Guid)[1] ^ ((UINT32 *)Guid)[2] ^ ((UINT32 *)Guid)[3];
+  Hash ^= Hash >> 16;
+  Hash ^= Hash >> 8;
+  return Hash & (PPI_HASH_BUCKET_COUNT - 1);
+}
+
+/**
+
+  Add the last descriptor of a PPI or notify list to the GUID hash index of the list.
+
+  @param HashIndex       Pointer to the GUID hash index of the list.
+  @param Ptrs            The descriptors of the list.
+  @param MaxCount        The number of entries of Ptrs.
+  @param Index           The index of the descriptor, after all the descriptors in
+                         the hash index.
+
+**/
+VOID
+AddPpiHashIndexEntry (
+  IN OUT PEI_PPI_HASH_INDEX    *HashIndex,
+  IN     PEI_PPI_LIST_POINTERS *Ptrs,
+  IN     UINTN                 MaxCount,
+  IN     UINTN                 Index
+  )
+{
+  UINT16                 *NextLinks;
+  UINTN                  Bucket;
+
+  NextLinks = PPI_HASH_NEXT_LINKS (Ptrs, MaxCount);
+  Bucket    = GetPpiHashBucket (Ptrs[Index].Ppi->Guid);
+
+  NextLinks[Index] = 0;
+  if (HashIndex->Tail[Bucket] == 0) {
+    HashIndex->Head[Bucket] = (UINT16) (Index + 1);
+  } else {
+    NextLinks[HashIndex->Tail[Bucket] - 1] = (UINT16) (Index + 1);
+  }
+  HashIndex->Tail[Bucket] = (UINT16) (Index + 1);
+}
+
+/**
+
+  Rebuild the GUID hash index of a PPI or notify list from its descriptors.
+
+  @param HashIndex       Pointer to the GUID hash index of the list.
+  @param Ptrs            The descriptors of the list.
+  @param MaxCount        The number of entries of Ptrs.
+  @param CurrentCount    The number of descriptors of the list.
+
+**/
+VOID
+RebuildPpiHashIndex (
+  OUT PEI_PPI_HASH_INDEX    *HashIndex,
+  IN  PEI_PPI_LIST_POINTERS *Ptrs,
+  IN  UINTN                 MaxCount,
+  IN  UINTN                 CurrentCount
+  )
+{
+  UINTN                  Index;
+
+  ZeroMem (HashIndex, sizeof (PEI_PPI_HASH_INDEX));
+  for (Index = 0; Index < CurrentCount; Index++) {
+    AddPpiHashIndexEntry (HashIndex, Ptrs, MaxCount, Index);
+  }
+}
+
+/**
+
+  Grow the buffer of a PPI or notify list, with the links of the GUID hash index
+  of the list that follow its descriptors.
+
+  @param Ptrs            Pointer to the descriptors of the list.  Returns the
+                         descriptors in the new buffer.
+  @param MaxCount        Pointer to the number of entries of the list.  Returns
+                         the number of entries of the new buffer.
+  @param GrowthStep      The number of entries to grow the buffer by.
+
+**/
+VOID
+GrowPpiList (
+  IN OUT PEI_PPI_LIST_POINTERS **Ptrs,
+  IN OUT UINTN                 *MaxCount,
+  IN     UINTN                 GrowthStep
+  )
+{
+  PEI_PPI_LIST_POINTERS  *TempPtr;
+
+  ASSERT (*MaxCount + GrowthStep <= MAX_UINT16);
+  TempPtr = AllocateZeroPool (
+              (sizeof (PEI_PPI_LIST_POINTERS) + sizeof (UINT16)) * (*MaxCount + GrowthStep)
+              );
+  ASSERT (TempPtr != NULL);
+  CopyMem (
+    TempPtr,
+    *Ptrs,
+    sizeof (PEI_PPI_LIST_POINTERS) * *MaxCount
+    );
+  CopyMem (
+    PPI_HASH_NEXT_LINKS (TempPtr, *MaxCount + GrowthStep),
+    PPI_HASH_NEXT_LINKS (*Ptrs, *MaxCount),
+    sizeof (UINT16) * *MaxCount
+    );
+  *Ptrs     = TempPtr;
+  *MaxCount = *MaxCount + GrowthStep;
+}
+
 /**
 
   Migrate Pointer from the temporary memory to PEI installed memory.
@@ -196,6 +346,29 @@ ConvertPpiPointers (
       &PrivateData->PpiData.DispatchNotifyList.NotifyPtrs[Index]
       );
   }
+
+  //
+  // Rebuild the GUID hash indexes from the converted descriptors, so they are
+  // read from the permanent memory.
+  //
+  RebuildPpiHashIndex (
+    &PrivateData->PpiData.PpiList.HashIndex,
+    PrivateData->PpiData.PpiList.PpiPtrs,
+    PrivateData->PpiData.PpiList.MaxCount,
+    PrivateData->PpiData.PpiList.CurrentCount
+    );
+  RebuildPpiHashIndex (
+    &PrivateData->PpiData.CallbackNotifyList.HashIndex,
+    PrivateData->PpiData.CallbackNotifyList.NotifyPtrs,
+    PrivateData->PpiData.CallbackNotifyList.MaxCount,
+    PrivateData->PpiData.CallbackNotifyList.CurrentCount
+    );
+  RebuildPpiHashIndex (
+    &PrivateData->PpiData.DispatchNotifyList.HashIndex,
+    PrivateData->PpiData.DispatchNotifyList.NotifyPtrs,
+    PrivateData->PpiData.DispatchNotifyList.MaxCount,
+    PrivateData->PpiData.DispatchNotifyList.CurrentCount
+    );
 }
 
 /**
@@ -227,7 +400,6 @@ InternalPeiInstallPpi (
   PEI_PPI_LIST          *PpiListPointer;
   UINTN                 Index;
   UINTN                 LastCount;
-  VOID                  *TempPtr;
 
   if (PpiList == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -253,6 +425,12 @@ InternalPeiInstallPpi (
     //
     if ((PpiList->Flags & EFI_PEI_PPI_DESCRIPTOR_PPI) == 0) {
       PpiListPointer->CurrentCount = LastCount;
+      RebuildPpiHashIndex (
+        &PpiListPointer->HashIndex,
+        PpiListPointer->PpiPtrs,
+        PpiListPointer->MaxCount,
+        PpiListPointer->CurrentCount
+        );
       DEBUG((EFI_D_ERROR, "ERROR -> InstallPpi: %g %p\n", PpiList->Guid, PpiList->Ppi));
       return  EFI_INVALID_PARAMETER;
     }
@@ -261,21 +439,12 @@ InternalPeiInstallPpi (
       //
       // Run out of room, grow the buffer.
       //
-      TempPtr = AllocateZeroPool (
-                  sizeof (PEI_PPI_LIST_POINTERS) * (PpiListPointer->MaxCount + PPI_GROWTH_STEP)
-                  );
-      ASSERT (TempPtr != NULL);
-      CopyMem (
-        TempPtr,
-        PpiListPointer->PpiPtrs,
-        sizeof (PEI_PPI_LIST_POINTERS) * PpiListPointer->MaxCount
-        );
-      PpiListPointer->PpiPtrs = TempPtr;
-      PpiListPointer->MaxCount = PpiListPointer->MaxCount + PPI_GROWTH_STEP;
+      GrowPpiList (&PpiListPointer->PpiPtrs, &PpiListPointer->MaxCount, PPI_GROWTH_STEP);
     }
 
     DEBUG((EFI_D_INFO, "Install PPI: %g\n", PpiList->Guid));
     PpiListPointer->PpiPtrs[Index].Ppi = (EFI_PEI_PPI_DESCRIPTOR *) PpiList;
+    AddPpiHashIndexEntry (&PpiListPointer->HashIndex, PpiListPointer->PpiPtrs, PpiListPointer->MaxCount, Index);
     Index++;
     PpiListPointer->CurrentCount++;
 
@@ -364,6 +533,7 @@ PeiReInstallPpi (
 {
   PEI_CORE_INSTANCE   *PrivateData;
   UINTN               Index;
+  UINTN               OldBucket;
 
 
   if ((OldPpi == NULL) || (NewPpi == NULL)) {
@@ -393,7 +563,19 @@ PeiReInstallPpi (
   // Replace the old PPI with the new one.
   //
   DEBUG((EFI_D_INFO, "Reinstall PPI: %g\n", NewPpi->Guid));
+  OldBucket = GetPpiHashBucket (PrivateData->PpiData.PpiList.PpiPtrs[Index].Ppi->Guid);
   PrivateData->PpiData.PpiList.PpiPtrs[Index].Ppi = (EFI_PEI_PPI_DESCRIPTOR *) NewPpi;
+  if (GetPpiHashBucket (NewPpi->Guid) != OldBucket) {
+    //
+    // The new PPI has a GUID of another bucket, rechain the PPIs in the hash index.
+    //
+    RebuildPpiHashIndex (
+      &PrivateData->PpiData.PpiList.HashIndex,
+      PrivateData->PpiData.PpiList.PpiPtrs,
+      PrivateData->PpiData.PpiList.MaxCount,
+      PrivateData->PpiData.PpiList.CurrentCount
+      );
+  }
 
   //
   // Process any callback level notifies for the newly installed PPI.
@@ -437,29 +619,27 @@ PeiLocatePpi (
   )
 {
   PEI_CORE_INSTANCE         *PrivateData;
-  UINTN                     Index;
-  EFI_GUID                  *CheckGuid;
+  PEI_PPI_LIST              *PpiListPointer;
+  UINT16                    *NextLinks;
+  UINTN                     Link;
   EFI_PEI_PPI_DESCRIPTOR    *TempPtr;
 
 
   PrivateData = PEI_CORE_INSTANCE_FROM_PS_THIS(PeiServices);
+  PrivateData->PpiData.LocateCount++;
 
   //
-  // Search the data base for the matching instance of the GUIDed PPI.
+  // Search the chain of the GUID in the hash index of the data base for the
+  // matching instance of the GUIDed PPI.  The chain is in the order the PPIs
+  // were installed.
   //
-  for (Index = 0; Index < PrivateData->PpiData.PpiList.CurrentCount; Index++) {
-    TempPtr = PrivateData->PpiData.PpiList.PpiPtrs[Index].Ppi;
-    CheckGuid = TempPtr->Guid;
+  PpiListPointer = &PrivateData->PpiData.PpiList;
+  NextLinks = PPI_HASH_NEXT_LINKS (PpiListPointer->PpiPtrs, PpiListPointer->MaxCount);
+  for (Link = PpiListPointer->HashIndex.Head[GetPpiHashBucket (Guid)]; Link != 0; Link = NextLinks[Link - 1]) {
+    TempPtr = PpiListPointer->PpiPtrs[Link - 1].Ppi;
+    PrivateData->PpiData.ScanCount++;
 
-    //
-    // Don't use CompareGuid function here for performance reasons.
-    // Instead we compare the GUID as INT32 at a time and branch
-    // on the first failed comparison.
-    //
-    if ((((INT32 *)Guid)[0] == ((INT32 *)CheckGuid)[0]) &&
-        (((INT32 *)Guid)[1] == ((INT32 *)CheckGuid)[1]) &&
-        (((INT32 *)Guid)[2] == ((INT32 *)CheckGuid)[2]) &&
-        (((INT32 *)Guid)[3] == ((INT32 *)CheckGuid)[3])) {
+    if (IsPpiGuidEqual (Guid, TempPtr->Guid)) {
       if (Instance == 0) {
 
         if (PpiDescriptor != NULL) {
@@ -511,7 +691,6 @@ InternalPeiNotifyPpi (
   PEI_DISPATCH_NOTIFY_LIST  *DispatchNotifyListPointer;
   UINTN                     DispatchNotifyIndex;
   UINTN                     LastDispatchNotifyCount;
-  VOID                      *TempPtr;
 
   if (NotifyList == NULL) {
     return EFI_INVALID_PARAMETER;
@@ -540,6 +719,18 @@ InternalPeiNotifyPpi (
     if ((NotifyList->Flags & EFI_PEI_PPI_DESCRIPTOR_NOTIFY_TYPES) == 0) {
         CallbackNotifyListPointer->CurrentCount = LastCallbackNotifyCount;
         DispatchNotifyListPointer->CurrentCount = LastDispatchNotifyCount;
+        RebuildPpiHashIndex (
+          &CallbackNotifyListPointer->HashIndex,
+          CallbackNotifyListPointer->NotifyPtrs,
+          CallbackNotifyListPointer->MaxCount,
+          CallbackNotifyListPointer->CurrentCount
+          );
+        RebuildPpiHashIndex (
+          &DispatchNotifyListPointer->HashIndex,
+          DispatchNotifyListPointer->NotifyPtrs,
+          DispatchNotifyListPointer->MaxCount,
+          DispatchNotifyListPointer->CurrentCount
+          );
         DEBUG((DEBUG_ERROR, "ERROR -> NotifyPpi: %g %p\n", NotifyList->Guid, NotifyList->Notify));
       return  EFI_INVALID_PARAMETER;
     }
@@ -549,19 +740,15 @@ InternalPeiNotifyPpi (
         //
         // Run out of room, grow the buffer.
         //
-        TempPtr = AllocateZeroPool (
-                    sizeof (PEI_PPI_LIST_POINTERS) * (CallbackNotifyListPointer->MaxCount + CALLBACK_NOTIFY_GROWTH_STEP)
-                    );
-        ASSERT (TempPtr != NULL);
-        CopyMem (
-          TempPtr,
-          CallbackNotifyListPointer->NotifyPtrs,
-          sizeof (PEI_PPI_LIST_POINTERS) * CallbackNotifyListPointer->MaxCount
-          );
-        CallbackNotifyListPointer->NotifyPtrs = TempPtr;
-        CallbackNotifyListPointer->MaxCount = CallbackNotifyListPointer->MaxCount + CALLBACK_NOTIFY_GROWTH_STEP;
+        GrowPpiList (&CallbackNotifyListPointer->NotifyPtrs, &CallbackNotifyListPointer->MaxCount, CALLBACK_NOTIFY_GROWTH_STEP);
       }
       CallbackNotifyListPointer->NotifyPtrs[CallbackNotifyIndex].Notify = (EFI_PEI_NOTIFY_DESCRIPTOR *) NotifyList;
+      AddPpiHashIndexEntry (
+        &CallbackNotifyListPointer->HashIndex,
+        CallbackNotifyListPointer->NotifyPtrs,
+        CallbackNotifyListPointer->MaxCount,
+        CallbackNotifyIndex
+        );
       CallbackNotifyIndex++;
       CallbackNotifyListPointer->CurrentCount++;
     } else {
@@ -569,19 +756,15 @@ InternalPeiNotifyPpi (
         //
         // Run out of room, grow the buffer.
         //
-        TempPtr = AllocateZeroPool (
-                    sizeof (PEI_PPI_LIST_POINTERS) * (DispatchNotifyListPointer->MaxCount + DISPATCH_NOTIFY_GROWTH_STEP)
-                    );
-        ASSERT (TempPtr != NULL);
-        CopyMem (
-          TempPtr,
-          DispatchNotifyListPointer->NotifyPtrs,
-          sizeof (PEI_PPI_LIST_POINTERS) * DispatchNotifyListPointer->MaxCount
-          );
-        DispatchNotifyListPointer->NotifyPtrs = TempPtr;
-        DispatchNotifyListPointer->MaxCount = DispatchNotifyListPointer->MaxCount + DISPATCH_NOTIFY_GROWTH_STEP;
+        GrowPpiList (&DispatchNotifyListPointer->NotifyPtrs, &DispatchNotifyListPointer->MaxCount, DISPATCH_NOTIFY_GROWTH_STEP);
       }
       DispatchNotifyListPointer->NotifyPtrs[DispatchNotifyIndex].Notify = (EFI_PEI_NOTIFY_DESCRIPTOR *) NotifyList;
+      AddPpiHashIndexEntry (
+        &DispatchNotifyListPointer->HashIndex,
+        DispatchNotifyListPointer->NotifyPtrs,
+        DispatchNotifyListPointer->MaxCount,
+        DispatchNotifyIndex
+        );
       DispatchNotifyIndex++;
       DispatchNotifyListPointer->CurrentCount++;
     }
@@ -713,6 +896,13 @@ ProcessDispatchNotifyList (
 
   Process notifications.
 
+  The notifies are processed in the order of the notify list, and for each notify,
+  the matching PPIs in the order of the PPI list.  When few PPIs are processed,
+  the notifies for them are found by walking the chains of their buckets in the
+  GUID hash index of the notify list, merged in the order of the list.  Otherwise,
+  the PPIs for each notify are found by walking the chain of its bucket in the
+  GUID hash index of the PPI list.
+
   @param PrivateData        PeiCore's private data structure
   @param NotifyType         Type of notify to fire.
   @param InstallStartIndex  Install Beginning index.
@@ -736,27 +926,113 @@ ProcessNotify (
   EFI_GUID                      *SearchGuid;
   EFI_GUID                      *CheckGuid;
   EFI_PEI_NOTIFY_DESCRIPTOR     *NotifyDescriptor;
+  PEI_PPI_LIST                  *PpiListPointer;
+  PEI_PPI_LIST_POINTERS         **NotifyPtrs;
+  UINTN                         *NotifyMaxCount;
+  PEI_PPI_HASH_INDEX            *NotifyHashIndex;
+  UINTN                         Buckets[PPI_NOTIFY_MERGE_MAX];
+  UINTN                         Links[PPI_NOTIFY_MERGE_MAX];
+  UINTN                         BucketCount;
+  UINTN                         Bucket;
+  UINTN                         Index;
+  UINTN                         Cursor;
+  UINTN                         Link;
 
-  for (Index1 = NotifyStartIndex; Index1 < NotifyStopIndex; Index1++) {
-    if (NotifyType == EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK) {
-      NotifyDescriptor = PrivateData->PpiData.CallbackNotifyList.NotifyPtrs[Index1].Notify;
-    } else {
-      NotifyDescriptor = PrivateData->PpiData.DispatchNotifyList.NotifyPtrs[Index1].Notify;
-    }
-
-    CheckGuid = NotifyDescriptor->Guid;
+  PpiListPointer = &PrivateData->PpiData.PpiList;
+  if (NotifyType == EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK) {
+    NotifyPtrs      = &PrivateData->PpiData.CallbackNotifyList.NotifyPtrs;
+    NotifyMaxCount  = &PrivateData->PpiData.CallbackNotifyList.MaxCount;
+    NotifyHashIndex = &PrivateData->PpiData.CallbackNotifyList.HashIndex;
+  } else {
+    NotifyPtrs      = &PrivateData->PpiData.DispatchNotifyList.NotifyPtrs;
+    NotifyMaxCount  = &PrivateData->PpiData.DispatchNotifyList.MaxCount;
+    NotifyHashIndex = &PrivateData->PpiData.DispatchNotifyList.HashIndex;
+  }
 
+  //
+  // The notify functions may install PPIs and notifies, which may move the lists
+  // to larger buffers, so the lists are read again after each notify function.
+  //
+  if (InstallStopIndex - InstallStartIndex <= PPI_NOTIFY_MERGE_MAX) {
+    //
+    // Start walking the chain of the notifies of each bucket of the PPIs.
+    //
+    BucketCount = 0;
     for (Index2 = InstallStartIndex; Index2 < InstallStopIndex; Index2++) {
-      SearchGuid = PrivateData->PpiData.PpiList.PpiPtrs[Index2].Ppi->Guid;
+      Bucket = GetPpiHashBucket (PpiListPointer->PpiPtrs[Index2].Ppi->Guid);
+      for (Index = 0; Index < BucketCount; Index++) {
+        if (Buckets[Index] == Bucket) {
+          break;
+        }
+      }
+      if (Index == BucketCount) {
+        Buckets[BucketCount] = Bucket;
+        Links[BucketCount]   = NotifyHashIndex->Head[Bucket];
+        BucketCount++;
+      }
+    }
+
+    for (;;) {
       //
-      // Don't use CompareGuid function here for performance reasons.
-      // Instead we compare the GUID as INT32 at a time and branch
-      // on the first failed comparison.
+      // Find the first notify of the chains from NotifyStartIndex.
       //
-      if ((((INT32 *)SearchGuid)[0] == ((INT32 *)CheckGuid)[0]) &&
-          (((INT32 *)SearchGuid)[1] == ((INT32 *)CheckGuid)[1]) &&
-          (((INT32 *)SearchGuid)[2] == ((INT32 *)CheckGuid)[2]) &&
-          (((INT32 *)SearchGuid)[3] == ((INT32 *)CheckGuid)[3])) {
+      Cursor = BucketCount;
+      for (Index = 0; Index < BucketCount; Index++) {
+        while ((Links[Index] != 0) && ((INTN) (Links[Index] - 1) < NotifyStartIndex)) {
+          Links[Index] = PPI_HASH_NEXT_LINKS (*NotifyPtrs, *NotifyMaxCount)[Links[Index] - 1];
+        }
+        if ((Links[Index] != 0) && ((Cursor == BucketCount) || (Links[Index] < Links[Cursor]))) {
+          Cursor = Index;
+        }
+      }
+      if ((Cursor == BucketCount) || ((INTN) (Links[Cursor] - 1) >= NotifyStopIndex)) {
+        break;
+      }
+
+      Index1 = (INTN) (Links[Cursor] - 1);
+      Links[Cursor] = PPI_HASH_NEXT_LINKS (*NotifyPtrs, *NotifyMaxCount)[Index1];
+
+      NotifyDescriptor = (*NotifyPtrs)[Index1].Notify;
+      CheckGuid = NotifyDescriptor->Guid;
+
+      for (Index2 = InstallStartIndex; Index2 < InstallStopIndex; Index2++) {
+        SearchGuid = PpiListPointer->PpiPtrs[Index2].Ppi->Guid;
+        PrivateData->PpiData.ScanCount++;
+        if (IsPpiGuidEqual (SearchGuid, CheckGuid)) {
+          DEBUG ((EFI_D_INFO, "Notify: PPI Guid: %g, Peim notify entry point: %p\n",
+            SearchGuid,
+            NotifyDescriptor->Notify
+            ));
+          NotifyDescriptor->Notify (
+                              (EFI_PEI_SERVICES **) GetPeiServicesTablePointer (),
+                              NotifyDescriptor,
+                              (PpiListPointer->PpiPtrs[Index2].Ppi)->Ppi
+                              );
+        }
+      }
+    }
+    return;
+  }
+
+  for (Index1 = NotifyStartIndex; Index1 < NotifyStopIndex; Index1++) {
+    NotifyDescriptor = (*NotifyPtrs)[Index1].Notify;
+    CheckGuid = NotifyDescriptor->Guid;
+
+    //
+    // Walk the chain of the PPIs of the bucket of the notify, in the order of
+    // the PPI list, up to InstallStopIndex.
+    //
+    for (Link = PpiListPointer->HashIndex.Head[GetPpiHashBucket (CheckGuid)];
+         (Link != 0) && ((INTN) (Link - 1) < InstallStopIndex);
+         Link = PPI_HASH_NEXT_LINKS (PpiListPointer->PpiPtrs, PpiListPointer->MaxCount)[Link - 1]) {
+      Index2 = (INTN) (Link - 1);
+      if (Index2 < InstallStartIndex) {
+        continue;
+      }
+
+      SearchGuid = PpiListPointer->PpiPtrs[Index2].Ppi->Guid;
+      PrivateData->PpiData.ScanCount++;
+      if (IsPpiGuidEqual (SearchGuid, CheckGuid)) {
         DEBUG ((EFI_D_INFO, "Notify: PPI Guid: %g, Peim notify entry point: %p\n",
           SearchGuid,
           NotifyDescriptor->Notify
@@ -764,7 +1040,7 @@ ProcessNotify (
         NotifyDescriptor->Notify (
                             (EFI_PEI_SERVICES **) GetPeiServicesTablePointer (),
                             NotifyDescriptor,
-                            (PrivateData->PpiData.PpiList.PpiPtrs[Index2].Ppi)->Ppi
+                            (PpiListPointer->PpiPtrs[Index2].Ppi)->Ppi
                             );
       }
     }
@@ -77,6 +77,10 @@ typedef struct {
 // The payload for this function is SMM_VARIABLE_COMMUNICATE_GET_RUNTIME_CACHE_INFO
 //
 #define SMM_VARIABLE_FUNCTION_GET_RUNTIME_CACHE_INFO                14
+//
+// The payload for this function is SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH
+//
+#define SMM_VARIABLE_FUNCTION_SET_VARIABLE_BATCH                    15
 
 ///
 /// Size of SMM communicate header, without including the payload.
@@ -138,6 +142,7 @@ typedef struct {
   VARIABLE_STORE_HEADER   *RuntimeHobCache;
   VARIABLE_STORE_HEADER   *RuntimeNvCache;
   VARIABLE_STORE_HEADER   *RuntimeVolatileCache;
+  BOOLEAN                 *CacheRewritten;
 } SMM_VARIABLE_COMMUNICATE_RUNTIME_VARIABLE_CACHE_CONTEXT;
 
 typedef struct {
@@ -147,4 +152,31 @@ typedef struct {
   BOOLEAN                 AuthenticatedVariableUsage;
 } SMM_VARIABLE_COMMUNICATE_GET_RUNTIME_CACHE_INFO;
 
+///
+/// This structure is used to communicate with SMI handler by the batched SetVariable.
+/// VariableCount SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE structures follow it, each
+/// of them starting at an offset aligned on sizeof (UINTN).
+///
+typedef struct {
+  UINTN                   VariableCount;
+} SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH;
+
+///
+/// A variable of the batched SetVariable.  Its name and then its data follow it.
+///
+typedef struct {
+  EFI_STATUS              Status;   // Return the status of the variable
+  EFI_GUID                Guid;
+  UINTN                   DataSize;
+  UINTN                   NameSize;
+  UINT32                  Attributes;
+  CHAR16                  Name[1];
+} SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE;
+
+///
+/// Size of a variable of the batched SetVariable, with its name and data.
+///
+#define SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE_SIZE(NameSize, DataSize) \
+  ALIGN_VALUE (OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE, Name) + (NameSize) + (DataSize), sizeof (UINTN))
+
 #endif // _SMM_VARIABLE_COMMON_H_
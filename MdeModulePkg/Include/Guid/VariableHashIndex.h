@@ -0,0 +1,88 @@
+/** @file
+  The variable hash index HOB is related to EDK II-specific implementation of variables.
+
+  The PEI variable module builds the hash index of the variables of the non-volatile
+  variable store, by variable name and vendor GUID, once permanent memory is installed,
+  and publishes it in this HOB.  The PEI variable module then finds the variables through
+  the index instead of walking the store in flash, and the DXE variable modules load the
+  index instead of hashing all the variables of the store again.
+
+  The hash of a variable is the FNV-1a hash of the characters of its name, up to the null
+  terminator, followed by the bytes of its vendor GUID.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __VARIABLE_HASH_INDEX_H__
+#define __VARIABLE_HASH_INDEX_H__
+
+#define EDKII_VARIABLE_HASH_INDEX_GUID \
+  { 0x2d5a9f3c, 0x8e17, 0x4b62, { 0x9c, 0x41, 0x07, 0xe3, 0xb5, 0x6a, 0xd8, 0x1f } }
+
+extern EFI_GUID gEdkiiVariableHashIndexGuid;
+
+///
+/// The average size, in bytes, of the variables a variable store is sized for in the
+/// hash index, and the minimum number of entries of the hash index.
+///
+#define VARIABLE_HASH_INDEX_VARIABLE_SIZE       64
+#define VARIABLE_HASH_INDEX_MIN_ENTRY_COUNT     64
+
+///
+/// An entry of the hash index of a variable store.
+///
+typedef struct {
+  ///
+  /// The hash of the name and vendor GUID of the variable.
+  ///
+  UINT32                  Hash;
+  ///
+  /// The offset of the variable header from the start of the variable store,
+  /// or 0 if the entry is free.
+  ///
+  UINT32                  Offset;
+} VARIABLE_HASH_INDEX_ENTRY;
+
+///
+/// The hash index of the variables of a variable store, followed by its EntryCount
+/// entries.
+///
+/// The index holds the offsets of all the variable headers of the store up to
+/// IndexedOffset, whatever their state, in an open addressed table with linear
+/// probing.  The state of the variables is checked in the store when they are looked up.
+///
+typedef struct {
+  ///
+  /// The address of the variable store header of the store indexed.
+  ///
+  EFI_PHYSICAL_ADDRESS    StoreBase;
+  ///
+  /// The size of the variable store indexed, from its header.
+  ///
+  UINT32                  StoreSize;
+  ///
+  /// The number of entries of the index, a power of two.
+  ///
+  UINT32                  EntryCount;
+  ///
+  /// The number of variable headers in the index.
+  ///
+  UINT32                  UsedCount;
+  ///
+  /// The offset of the first variable header that is not in the index.
+  ///
+  UINT32                  IndexedOffset;
+  ///
+  /// TRUE if the variables of the store use the authenticated format.
+  ///
+  BOOLEAN                 AuthFormat;
+  ///
+  /// TRUE if the store has more variable headers than the index can hold, and the
+  /// index must not be used.
+  ///
+  BOOLEAN                 Full;
+} VARIABLE_HASH_INDEX;
+
+#endif
@@ -0,0 +1,64 @@
+/** @file
+  Handle Snapshot Protocol is an EDK II-specific extension of the handle
+  database services.  It lets a caller that repeatedly looks for the handles
+  supporting a protocol retrieve only the handles on which the protocol was
+  installed since its previous query.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __HANDLE_SNAPSHOT_H__
+#define __HANDLE_SNAPSHOT_H__
+
+#define EDKII_HANDLE_SNAPSHOT_PROTOCOL_GUID \
+  { \
+    0x6a1f5e2c, 0x3b8d, 0x4c71, { 0x9e, 0x04, 0x52, 0xd7, 0xa1, 0x6c, 0xf3, 0x8b } \
+  }
+
+typedef struct _EDKII_HANDLE_SNAPSHOT_PROTOCOL  EDKII_HANDLE_SNAPSHOT_PROTOCOL;
+
+/**
+  Return the handles on which Protocol was installed or reinstalled after a
+  generation of the handle database, in a buffer allocated from pool.
+
+  Handles from which Protocol was uninstalled since Generation are not
+  reported; the caller is expected to cope with stale handles as it would with
+  the result of LocateHandleBuffer().
+
+  @param[in]      Protocol       Provides the protocol to search by.
+  @param[in, out] Generation     On input, the generation returned by the previous
+                                 call, or 0 to return all the handles that support
+                                 Protocol.  On output, the current generation.
+  @param[out]     NumberHandles  The number of handles returned in Buffer.
+  @param[out]     Buffer         A pointer to the buffer to return the requested
+                                 array of handles that support Protocol.
+
+  @retval EFI_SUCCESS            The result array of handles was returned.
+  @retval EFI_NOT_FOUND          No handles match the search.  Generation is
+                                 still updated.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough pool memory to store the
+                                 matching results.
+  @retval EFI_INVALID_PARAMETER  One or more parameters are NULL.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_HANDLE_SNAPSHOT_LOCATE_HANDLE_BUFFER) (
+  IN     EFI_GUID                       *Protocol,
+  IN OUT UINT64                         *Generation,
+  OUT    UINTN                          *NumberHandles,
+  OUT    EFI_HANDLE                     **Buffer
+  );
+
+///
+/// Handle Snapshot Protocol is an EDK II-specific extension of the handle
+/// database services produced by the DXE Core.
+///
+struct _EDKII_HANDLE_SNAPSHOT_PROTOCOL {
+  EDKII_HANDLE_SNAPSHOT_LOCATE_HANDLE_BUFFER  LocateHandleBuffer;
+};
+
+extern EFI_GUID gEdkiiHandleSnapshotProtocolGuid;
+
+#endif
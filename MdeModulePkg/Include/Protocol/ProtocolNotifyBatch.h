@@ -0,0 +1,122 @@
+/** @file
+  Protocol Notify Batch Protocol is an EDK II-specific extension of the
+  handle database services produced by the DXE Core.  It lets a driver that
+  installs many protocol interfaces in a row, such as a bus driver enumerating
+  its children, defer the notifications of the protocols it installs until it
+  is done, so that each event registered with RegisterProtocolNotify() for
+  one of them is signaled once for all the interfaces instead of once for
+  each of them.  The notifications of the other protocols are not deferred.
+
+  The notification functions of such events are expected to call
+  LocateHandle() with ByRegisterNotify until it returns EFI_NOT_FOUND, since
+  an event signaled once may stand for several new interfaces.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __PROTOCOL_NOTIFY_BATCH_H__
+#define __PROTOCOL_NOTIFY_BATCH_H__
+
+#define EDKII_PROTOCOL_NOTIFY_BATCH_PROTOCOL_GUID \
+  { \
+    0xe3a54c10, 0x8f2b, 0x4d69, { 0xb7, 0x0c, 0x41, 0x9e, 0x26, 0xd5, 0x83, 0xfa } \
+  }
+
+///
+/// Statistics of the protocol notifications of the DXE Core.
+///
+/// BatchCount is the number of batches closed.  SignalCount is the number of
+/// times an event registered with RegisterProtocolNotify() was signaled.
+/// SavedSignalCount is the number of signals that batches suppressed: for
+/// each event signaled when a batch was closed, the signals deferred for it
+/// beyond the first.  The deferred signals of an event that was still
+/// signaled when the batch was closed are not counted, since the event would
+/// have ignored them.
+///
+typedef struct {
+  UINT64    BatchCount;
+  UINT64    SignalCount;
+  UINT64    SavedSignalCount;
+} EDKII_PROTOCOL_NOTIFY_BATCH_STATISTICS;
+
+///
+/// Identifies a batch opened with BeginBatch().
+///
+typedef VOID  *EDKII_PROTOCOL_NOTIFY_BATCH_TOKEN;
+
+typedef struct _EDKII_PROTOCOL_NOTIFY_BATCH_PROTOCOL  EDKII_PROTOCOL_NOTIFY_BATCH_PROTOCOL;
+
+/**
+  Open a batch of protocol notifications.  Until the batch is closed, the
+  events registered with RegisterProtocolNotify() for one of the protocols of
+  the batch are not signaled when an interface of the protocol is installed
+  or reinstalled.  Several drivers may have batches open at the same time,
+  and the notifications of a protocol are made when the last open batch
+  covering it is closed.
+
+  @param[in]  Protocols          The protocols whose notifications to defer.
+  @param[in]  ProtocolCount      The number of protocols in Protocols.
+  @param[out] Token              Returns the token identifying the batch.
+
+  @retval EFI_SUCCESS            The batch was opened.
+  @retval EFI_INVALID_PARAMETER  Protocols is NULL, or one of its entries is
+                                 NULL.
+  @retval EFI_INVALID_PARAMETER  ProtocolCount is 0.
+  @retval EFI_INVALID_PARAMETER  Token is NULL.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough memory to open the batch.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_PROTOCOL_NOTIFY_BATCH_BEGIN) (
+  IN  EFI_GUID                           **Protocols,
+  IN  UINTN                              ProtocolCount,
+  OUT EDKII_PROTOCOL_NOTIFY_BATCH_TOKEN  *Token
+  );
+
+/**
+  Close a batch of protocol notifications opened with BeginBatch().  Each
+  event registered for a protocol of the batch that had interfaces installed
+  or reinstalled during the batch is signaled once, unless another open batch
+  still covers the protocol.
+
+  @param[in]  Token              The token returned by BeginBatch().
+
+  @retval EFI_SUCCESS            The batch was closed.
+  @retval EFI_INVALID_PARAMETER  Token is not the token of an open batch.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_PROTOCOL_NOTIFY_BATCH_END) (
+  IN EDKII_PROTOCOL_NOTIFY_BATCH_TOKEN  Token
+  );
+
+/**
+  Retrieve the statistics of the protocol notifications since the DXE Core
+  started.
+
+  @param[out] Statistics         The buffer to return the statistics in.
+
+  @retval EFI_SUCCESS            The statistics were returned.
+  @retval EFI_INVALID_PARAMETER  Statistics is NULL.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_PROTOCOL_NOTIFY_BATCH_GET_STATISTICS) (
+  OUT EDKII_PROTOCOL_NOTIFY_BATCH_STATISTICS  *Statistics
+  );
+
+///
+/// Protocol Notify Batch Protocol is an EDK II-specific extension of the
+/// handle database services produced by the DXE Core.
+///
+struct _EDKII_PROTOCOL_NOTIFY_BATCH_PROTOCOL {
+  EDKII_PROTOCOL_NOTIFY_BATCH_BEGIN           BeginBatch;
+  EDKII_PROTOCOL_NOTIFY_BATCH_END             EndBatch;
+  EDKII_PROTOCOL_NOTIFY_BATCH_GET_STATISTICS  GetStatistics;
+};
+
+extern EFI_GUID gEdkiiProtocolNotifyBatchProtocolGuid;
+
+#endif
@@ -0,0 +1,125 @@
+/** @file
+  Section Cache Protocol is an EDK II-specific extension of the Firmware
+  Volume2 Protocol produced by the DXE Core.  It returns read-only pointers to
+  the sections of firmware files in the section data the DXE Core already
+  extracted, instead of a copy of the section in a new pool buffer, and it
+  reports how often the section data was already extracted.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __SECTION_CACHE_H__
+#define __SECTION_CACHE_H__
+
+#include <Protocol/FirmwareVolume2.h>
+
+#define EDKII_SECTION_CACHE_PROTOCOL_GUID \
+  { \
+    0x9b3c6e41, 0x2a7f, 0x4d85, { 0xa1, 0x5e, 0x8c, 0x04, 0xd9, 0x37, 0x6b, 0xf2 } \
+  }
+
+///
+/// Statistics of the section cache of the DXE Core.
+///
+/// A read is a hit when it was answered from section data extracted by an
+/// earlier read, and a miss when a section stream had to be opened or an
+/// encapsulation section extracted.  CachedSize is the memory held by the
+/// streams extracted from the encapsulation sections of the files read; the
+/// files themselves are read in place and not counted.  It is kept below
+/// MaxCachedSize by evicting the least recently read files that have no
+/// section referenced.  A MaxCachedSize of 0 means the section cache is not
+/// bounded.
+///
+typedef struct {
+  UINT64    HitCount;
+  UINT64    MissCount;
+  UINT64    EvictionCount;
+  UINT64    CachedSize;
+  UINT64    MaxCachedSize;
+} EDKII_SECTION_CACHE_STATISTICS;
+
+typedef struct _EDKII_SECTION_CACHE_PROTOCOL  EDKII_SECTION_CACHE_PROTOCOL;
+
+/**
+  Locate a section in a firmware file, the way
+  EFI_FIRMWARE_VOLUME2_PROTOCOL.ReadSection() does, and return a read-only
+  pointer to its data in the section cache.  The section data is referenced
+  until ReleaseSection() is called, and is not evicted meanwhile.
+
+  @param[in]  FirmwareVolume        A Firmware Volume2 Protocol instance
+                                    produced by the DXE Core.
+  @param[in]  NameGuid              The name of the file.
+  @param[in]  SectionType           The type of the section, or 0 for the whole
+                                    section stream of the file.
+  @param[in]  SectionInstance       Which instance of sections of SectionType
+                                    to return.
+  @param[out] Buffer                The data of the section, without its
+                                    header.
+  @param[out] BufferSize            The size of the data of the section.
+  @param[out] AuthenticationStatus  The authentication status of the section.
+
+  @retval EFI_SUCCESS               The section was found, and is referenced.
+  @retval EFI_NOT_FOUND             The file or the section was not found.
+  @retval EFI_UNSUPPORTED           FirmwareVolume was not produced by the DXE
+                                    Core.
+  @retval EFI_OUT_OF_RESOURCES      There is not enough pool memory to extract
+                                    the section.
+  @retval EFI_INVALID_PARAMETER     One or more parameters are NULL.
+  @retval Others                    The errors of ReadSection().
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_SECTION_CACHE_GET_SECTION) (
+  IN  EFI_FIRMWARE_VOLUME2_PROTOCOL     *FirmwareVolume,
+  IN  CONST EFI_GUID                    *NameGuid,
+  IN  EFI_SECTION_TYPE                  SectionType,
+  IN  UINTN                             SectionInstance,
+  OUT CONST VOID                        **Buffer,
+  OUT UINTN                             *BufferSize,
+  OUT UINT32                            *AuthenticationStatus
+  );
+
+/**
+  Release a reference to section data returned by GetSection().  The data may
+  be evicted afterwards, and must no longer be accessed.
+
+  @param[in]  Buffer                The data returned by GetSection().
+
+  @retval EFI_SUCCESS               The reference was released.
+  @retval EFI_NOT_FOUND             Buffer is not referenced.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_SECTION_CACHE_RELEASE_SECTION) (
+  IN  CONST VOID                        *Buffer
+  );
+
+/**
+  Retrieve the statistics of the section cache since the DXE Core started.
+
+  @param[out] Statistics            The buffer to return the statistics in.
+
+  @retval EFI_SUCCESS               The statistics were returned.
+  @retval EFI_INVALID_PARAMETER     Statistics is NULL.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_SECTION_CACHE_GET_STATISTICS) (
+  OUT EDKII_SECTION_CACHE_STATISTICS    *Statistics
+  );
+
+///
+/// Section Cache Protocol is an EDK II-specific extension of the Firmware
+/// Volume2 Protocol produced by the DXE Core.
+///
+struct _EDKII_SECTION_CACHE_PROTOCOL {
+  EDKII_SECTION_CACHE_GET_SECTION       GetSection;
+  EDKII_SECTION_CACHE_RELEASE_SECTION   ReleaseSection;
+  EDKII_SECTION_CACHE_GET_STATISTICS    GetStatistics;
+};
+
+extern EFI_GUID gEdkiiSectionCacheProtocolGuid;
+
+#endif
@@ -0,0 +1,85 @@
+/** @file
+  Timer One-Shot Protocol is an EDK II-specific extension of the Timer
+  Architectural Protocol.  It lets the DXE Core program the timer interrupt for
+  the next timer event it has to signal, instead of taking timer interrupts at a
+  fixed period whether or not a timer event is due.
+
+  A Timer Architectural Protocol driver that supports one-shot timer interrupts
+  installs this protocol on the handle of the Timer Architectural Protocol, in
+  the same call to InstallMultipleProtocolInterfaces().
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __TIMER_ONE_SHOT_H__
+#define __TIMER_ONE_SHOT_H__
+
+#define EDKII_TIMER_ONE_SHOT_PROTOCOL_GUID \
+  { \
+    0x5c0e3a9d, 0x7b21, 0x4e86, { 0x8f, 0x4a, 0x13, 0xd6, 0x2b, 0x97, 0xc0, 0x5e } \
+  }
+
+typedef struct _EDKII_TIMER_ONE_SHOT_PROTOCOL  EDKII_TIMER_ONE_SHOT_PROTOCOL;
+
+/**
+  Program the timer interrupt to fire once, Delay 100ns units from now, instead
+  of periodically.
+
+  The handler registered with EFI_TIMER_ARCH_PROTOCOL.RegisterHandler() is
+  passed all the time elapsed since its previous call, including the time
+  elapsed before this call.  The timer stays in one-shot mode until
+  EFI_TIMER_ARCH_PROTOCOL.SetTimerPeriod() is called, which restores periodic
+  timer interrupts or disables the timer interrupt.
+
+  @param[in] This                The EDKII_TIMER_ONE_SHOT_PROTOCOL instance.
+  @param[in] Delay               The time until the timer interrupt, in 100ns
+                                 units.  It is rounded to the nearest delay
+                                 supported by the timer hardware, and if it is
+                                 larger than the timer hardware supports, the
+                                 timer interrupt fires after the largest delay
+                                 supported.
+
+  @retval EFI_SUCCESS            The timer interrupt was programmed.
+  @retval EFI_NOT_STARTED        The timer interrupt is disabled by a call to
+                                 SetTimerPeriod() with a period of 0.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_TIMER_ONE_SHOT_SET_DEADLINE) (
+  IN EDKII_TIMER_ONE_SHOT_PROTOCOL      *This,
+  IN UINT64                             Delay
+  );
+
+/**
+  Return the time elapsed since the previous call to the handler registered
+  with EFI_TIMER_ARCH_PROTOCOL.RegisterHandler().  This time will be part of
+  the Duration passed to the next call to the handler.
+
+  @param[in]  This               The EDKII_TIMER_ONE_SHOT_PROTOCOL instance.
+  @param[out] Elapsed            The time elapsed, in 100ns units.  It is 0 if the
+                                 timer is in periodic mode.
+
+  @retval EFI_SUCCESS            The time elapsed was returned.
+  @retval EFI_INVALID_PARAMETER  Elapsed is NULL.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_TIMER_ONE_SHOT_GET_ELAPSED_TIME) (
+  IN  EDKII_TIMER_ONE_SHOT_PROTOCOL     *This,
+  OUT UINT64                            *Elapsed
+  );
+
+///
+/// Timer One-Shot Protocol is an EDK II-specific extension of the Timer
+/// Architectural Protocol.
+///
+struct _EDKII_TIMER_ONE_SHOT_PROTOCOL {
+  EDKII_TIMER_ONE_SHOT_SET_DEADLINE     SetDeadline;
+  EDKII_TIMER_ONE_SHOT_GET_ELAPSED_TIME GetElapsedTime;
+};
+
+extern EFI_GUID gEdkiiTimerOneShotProtocolGuid;
+
+#endif
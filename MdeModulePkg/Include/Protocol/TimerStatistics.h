@@ -0,0 +1,81 @@
+/** @file
+  Timer Statistics Protocol is an EDK II-specific debug protocol produced by
+  the DXE Core.  It reports how much work the DXE Core spends checking its
+  timer database for expired timer events, which it does at TPL_HIGH_LEVEL - 1
+  on the ticks that have timers due.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __TIMER_STATISTICS_H__
+#define __TIMER_STATISTICS_H__
+
+#define EDKII_TIMER_STATISTICS_PROTOCOL_GUID \
+  { \
+    0x2d8e4b71, 0x95c3, 0x4f0a, { 0xb6, 0x1e, 0x7a, 0x30, 0xc9, 0x52, 0xe4, 0x1d } \
+  }
+
+///
+/// Number of buckets of the work histogram.
+///
+#define EDKII_TIMER_STATISTICS_HISTOGRAM_SIZE  16
+
+///
+/// Statistics of the timer database of the DXE Core.
+///
+/// The work of one check of the timer database is the number of timer wheel
+/// slots visited plus the number of timer events expired or moved between
+/// the levels of the wheel.  WorkHistogram[0] counts the checks that did no
+/// work, and WorkHistogram[N] the checks whose work was at least 2^(N-1) and
+/// below 2^N.  The last bucket also counts all the checks above its range.
+///
+typedef struct {
+  UINT64    TickCount;
+  UINT64    CheckCount;
+  UINT64    ExpiredCount;
+  UINT64    MaxWork;
+  UINT64    WorkHistogram[EDKII_TIMER_STATISTICS_HISTOGRAM_SIZE];
+} EDKII_TIMER_STATISTICS;
+
+typedef struct _EDKII_TIMER_STATISTICS_PROTOCOL  EDKII_TIMER_STATISTICS_PROTOCOL;
+
+/**
+  Retrieve the statistics of the timer database since the DXE Core started or
+  since they were last reset.
+
+  @param[out] Statistics         The buffer to return the statistics in.
+
+  @retval EFI_SUCCESS            The statistics were returned.
+  @retval EFI_INVALID_PARAMETER  Statistics is NULL.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_TIMER_STATISTICS_GET) (
+  OUT EDKII_TIMER_STATISTICS            *Statistics
+  );
+
+/**
+  Reset the statistics of the timer database.
+
+  @retval EFI_SUCCESS            The statistics were reset.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_TIMER_STATISTICS_RESET) (
+  VOID
+  );
+
+///
+/// Timer Statistics Protocol is an EDK II-specific debug protocol produced by
+/// the DXE Core.
+///
+struct _EDKII_TIMER_STATISTICS_PROTOCOL {
+  EDKII_TIMER_STATISTICS_GET            GetStatistics;
+  EDKII_TIMER_STATISTICS_RESET          ResetStatistics;
+};
+
+extern EFI_GUID gEdkiiTimerStatisticsProtocolGuid;
+
+#endif
@@ -0,0 +1,102 @@
+/** @file
+  Variable Batch Protocol is related to EDK II-specific implementation of variables
+  and intended for use as a means to set a batch of variables at once, such as the
+  settings a setup or configuration tool applies together.
+
+  The variable driver checks the whole batch, and reserves the non-volatile variable
+  space all the variables of the batch need, before it sets any of them, so the batch
+  is applied with at most one reclaim of the non-volatile variable store.  When the
+  variable services are provided by SMM, the batch is sent to SMM in one SMI, so it
+  has to fit in the SMM communicate buffer.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __VARIABLE_BATCH_H__
+#define __VARIABLE_BATCH_H__
+
+#define EDKII_VARIABLE_BATCH_PROTOCOL_GUID \
+  { \
+    0x8490ce8f, 0xf1bb, 0x4e16, { 0xa8, 0x3c, 0x57, 0x8a, 0x79, 0x96, 0x55, 0xc1 } \
+  }
+
+typedef struct _EDKII_VARIABLE_BATCH_PROTOCOL  EDKII_VARIABLE_BATCH_PROTOCOL;
+
+///
+/// A variable to set, with the parameters of SetVariable().
+///
+typedef struct {
+  ///
+  /// The name of the variable, a Null-terminated string.
+  ///
+  CHAR16        *VariableName;
+  ///
+  /// The vendor GUID of the variable.
+  ///
+  EFI_GUID      *VendorGuid;
+  ///
+  /// The attributes of the variable, as passed to SetVariable().
+  ///
+  UINT32        Attributes;
+  ///
+  /// The size in bytes of Data.
+  ///
+  UINTN         DataSize;
+  ///
+  /// The contents of the variable.
+  ///
+  VOID          *Data;
+  ///
+  /// Returns the status SetVariable() returned for the variable, or EFI_NOT_STARTED
+  /// if the variable was not set because the batch failed before it.
+  ///
+  EFI_STATUS    Status;
+} EDKII_VARIABLE_BATCH_ENTRY;
+
+/**
+  Set a batch of variables.
+
+  The variables are set in order, the way SetVariable() sets them, until all of them
+  are set or one of them fails.  Before any variable is set, the batch is checked,
+  and the space the non-volatile variables of the batch need is reserved in the
+  non-volatile variable store.
+
+  @param[in]      This           The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in]      VariableCount  The number of variables in Variables.
+  @param[in, out] Variables      The variables to set.  Returns the status of each
+                                 variable in its Status field.
+
+  @retval EFI_SUCCESS            All the variables were set.
+  @retval EFI_INVALID_PARAMETER  Variables is NULL and VariableCount is not 0, or the
+                                 parameters of a variable are invalid.  No variable
+                                 was set.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough space in the variable store for
+                                 the non-volatile variables of the batch.  No variable
+                                 was set.
+  @retval EFI_BAD_BUFFER_SIZE    The batch is too large to be set at once.  No variable
+                                 was set.
+  @retval Others                 The variable whose Status is not EFI_SUCCESS nor
+                                 EFI_NOT_STARTED failed with this status.  The
+                                 variables before it were set.
+**/
+typedef
+EFI_STATUS
+(EFIAPI * EDKII_VARIABLE_BATCH_PROTOCOL_SET_VARIABLES) (
+  IN CONST EDKII_VARIABLE_BATCH_PROTOCOL *This,
+  IN       UINTN                         VariableCount,
+  IN OUT   EDKII_VARIABLE_BATCH_ENTRY    *Variables
+  );
+
+///
+/// Variable Batch Protocol is related to EDK II-specific implementation of variables
+/// and intended for use as a means to set a batch of variables at once.
+///
+struct _EDKII_VARIABLE_BATCH_PROTOCOL {
+  EDKII_VARIABLE_BATCH_PROTOCOL_SET_VARIABLES SetVariables;
+};
+
+extern EFI_GUID gEdkiiVariableBatchProtocolGuid;
+
+#endif
@@ -24,6 +24,12 @@ EFI_PEI_PPI_DESCRIPTOR     mPpiListVariable = {
   &mVariablePpi
 };
 
+EFI_PEI_NOTIFY_DESCRIPTOR  mMemoryDiscoveredNotifyList = {
+  (EFI_PEI_PPI_DESCRIPTOR_NOTIFY_CALLBACK | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST),
+  &gEfiPeiMemoryDiscoveredPpiGuid,
+  BuildVariableHashIndex
+};
+
 
 /**
   Provide the functionality of the variable services.
@@ -33,7 +39,7 @@ EFI_PEI_PPI_DESCRIPTOR     mPpiListVariable = {
   @param  PeiServices  General purpose services available to every PEIM.
 
   @retval EFI_SUCCESS  If the interface could be successfully installed
-  @retval Others       Returned from PeiServicesInstallPpi()
+  @retval Others       Returned from PeiServicesInstallPpi() or PeiServicesNotifyPpi()
 **/
 EFI_STATUS
 EFIAPI
@@ -42,7 +48,17 @@ PeimInitializeVariableServices (
   IN CONST EFI_PEI_SERVICES          **PeiServices
   )
 {
-  return PeiServicesInstallPpi (&mPpiListVariable);
+  EFI_STATUS  Status;
+
+  Status = PeiServicesInstallPpi (&mPpiListVariable);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Index the variables of the NV storage once permanent memory is installed.
+  //
+  return PeiServicesNotifyPpi (&mMemoryDiscoveredNotifyList);
 }
 
 /**
@@ -568,6 +584,7 @@ GetVariableStore (
   UINT32                                BackUpOffset;
 
   StoreInfo->IndexTable = NULL;
+  StoreInfo->HashIndex = NULL;
   StoreInfo->FtwLastWriteData = NULL;
   StoreInfo->AuthFlag = FALSE;
   VariableStoreHeader = NULL;
@@ -649,6 +666,19 @@ GetVariableStore (
           StoreInfo->IndexTable->EndPtr      = GetEndPointer   (VariableStoreHeader);
           StoreInfo->IndexTable->GoneThrough = 0;
         }
+
+        //
+        // Find the variables through the hash index of the NV storage once it is built,
+        // unless a part of the NV storage is backed up in spare block.
+        //
+        GuidHob = GetFirstGuidHob (&gEdkiiVariableHashIndexGuid);
+        if ((GuidHob != NULL) && (StoreInfo->FtwLastWriteData == NULL)) {
+          StoreInfo->HashIndex = GET_GUID_HOB_DATA (GuidHob);
+          if ((StoreInfo->HashIndex->StoreBase != (EFI_PHYSICAL_ADDRESS) (UINTN) VariableStoreHeader) ||
+              StoreInfo->HashIndex->Full) {
+            StoreInfo->HashIndex = NULL;
+          }
+        }
       }
       break;
 
@@ -783,6 +813,104 @@ GetVariableNameOrData (
   CopyMem (Buffer, NameOrData, Size);
 }
 
+/**
+  Compute the hash of the name and vendor GUID of a variable in the variable hash index.
+
+  @param  VariableName        Name of the variable.
+  @param  NameLength          Maximum number of characters of the name.
+  @param  VendorGuid          Vendor GUID of the variable.
+
+  @return The hash of the name and vendor GUID.
+
+**/
+UINT32
+VariableHashIndexHash (
+  IN CONST CHAR16               *VariableName,
+  IN UINTN                      NameLength,
+  IN CONST EFI_GUID             *VendorGuid
+  )
+{
+  UINT32                        Hash;
+  CONST UINT8                   *Guid;
+  UINTN                         Index;
+
+  //
+  // FNV-1a hash of the characters of the name, up to the null terminator, and
+  // of the bytes of the vendor GUID, the hash the DXE variable modules use.
+  //
+  Hash = 0x811C9DC5;
+  for (Index = 0; Index < NameLength && VariableName[Index] != 0; Index++) {
+    Hash = (Hash ^ VariableName[Index]) * 0x01000193;
+  }
+  Guid = (CONST UINT8 *) VendorGuid;
+  for (Index = 0; Index < sizeof (EFI_GUID); Index++) {
+    Hash = (Hash ^ Guid[Index]) * 0x01000193;
+  }
+  return Hash;
+}
+
+/**
+  Find the variable in the specified variable store through the hash index of the store.
+
+  The variable is found the way FindVariableEx() finds it by walking the store, but only
+  the variables with the hash of the name and vendor GUID are read from the store.
+
+  @param  StoreInfo           Pointer to the store info structure, with the hash index of the store.
+  @param  VariableName        Name of the variable to be found, not empty.
+  @param  VendorGuid          Vendor GUID to be found.
+  @param  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+
+  @retval  EFI_SUCCESS            Variable found successfully
+  @retval  EFI_NOT_FOUND          Variable not found
+
+**/
+EFI_STATUS
+FindVariableInHashIndex (
+  IN VARIABLE_STORE_INFO         *StoreInfo,
+  IN CONST CHAR16                *VariableName,
+  IN CONST EFI_GUID              *VendorGuid,
+  OUT VARIABLE_POINTER_TRACK     *PtrTrack
+  )
+{
+  VARIABLE_HASH_INDEX         *HashIndex;
+  VARIABLE_HASH_INDEX_ENTRY   *Entries;
+  VARIABLE_HEADER             *Variable;
+  VARIABLE_HEADER             *InDeletedVariable;
+  UINT32                      Hash;
+  UINT32                      Slot;
+
+  HashIndex = StoreInfo->HashIndex;
+  Entries   = (VARIABLE_HASH_INDEX_ENTRY *) (HashIndex + 1);
+  Hash      = VariableHashIndexHash (VariableName, MAX_UINTN, VendorGuid);
+
+  InDeletedVariable = NULL;
+  for (Slot = Hash & (HashIndex->EntryCount - 1); Entries[Slot].Offset != 0; Slot = (Slot + 1) & (HashIndex->EntryCount - 1)) {
+    if (Entries[Slot].Hash != Hash) {
+      continue;
+    }
+
+    //
+    // The hash index is only used when no part of the store is backed up in spare
+    // block, so the variable headers are consecutive.
+    //
+    Variable = (VARIABLE_HEADER *) ((UINTN) StoreInfo->VariableStoreHeader + Entries[Slot].Offset);
+    if (Variable->State != VAR_ADDED && Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+      continue;
+    }
+    if (CompareWithValidVariable (StoreInfo, Variable, Variable, VariableName, VendorGuid, PtrTrack) == EFI_SUCCESS) {
+      if (Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+        InDeletedVariable = PtrTrack->CurrPtr;
+      } else {
+        return EFI_SUCCESS;
+      }
+    }
+  }
+
+  PtrTrack->CurrPtr = InDeletedVariable;
+
+  return (PtrTrack->CurrPtr == NULL) ? EFI_NOT_FOUND : EFI_SUCCESS;
+}
+
 /**
   Find the variable in the specified variable store.
 
@@ -833,6 +961,10 @@ FindVariableEx (
   PtrTrack->StartPtr = GetStartPointer (VariableStoreHeader);
   PtrTrack->EndPtr   = GetEndPointer   (VariableStoreHeader);
 
+  if ((StoreInfo->HashIndex != NULL) && (VariableName[0] != 0)) {
+    return FindVariableInHashIndex (StoreInfo, VariableName, VendorGuid, PtrTrack);
+  }
+
   InDeletedVariable = NULL;
 
   //
@@ -974,6 +1106,115 @@ FindVariable (
   return EFI_NOT_FOUND;
 }
 
+/**
+  Build the hash index of the variables of the non-volatile variable store, and
+  publish it in the variable hash index HOB, once permanent memory is installed.
+
+  The index holds all the variable headers of the store, whatever their state, so
+  the DXE variable modules can load it for their copy of the store.
+
+  @param  PeiServices       An indirect pointer to the EFI_PEI_SERVICES table published by the PEI Foundation.
+  @param  NotifyDescriptor  Address of the notification descriptor data structure.
+  @param  Ppi               Address of the PPI that was installed.
+
+  @retval EFI_SUCCESS           The hash index is built, or the variables of the store are
+                                found by walking the store.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory for the hash index HOB.
+
+**/
+EFI_STATUS
+EFIAPI
+BuildVariableHashIndex (
+  IN EFI_PEI_SERVICES           **PeiServices,
+  IN EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyDescriptor,
+  IN VOID                       *Ppi
+  )
+{
+  VARIABLE_STORE_INFO         StoreInfo;
+  VARIABLE_STORE_HEADER       *VariableStoreHeader;
+  VARIABLE_HASH_INDEX         *HashIndex;
+  VARIABLE_HASH_INDEX_ENTRY   *Entries;
+  VARIABLE_HEADER             *Variable;
+  VARIABLE_HEADER             *VariableHeader;
+  UINT32                      EntryCount;
+  UINT32                      Hash;
+  UINT32                      Slot;
+
+  if (GetFirstGuidHob (&gEdkiiVariableHashIndexGuid) != NULL) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // The variables of the NV storage that is partly backed up in spare block are
+  // found by walking the store.
+  //
+  VariableStoreHeader = GetVariableStore (VariableStoreTypeNv, &StoreInfo);
+  if ((VariableStoreHeader == NULL) ||
+      (StoreInfo.FtwLastWriteData != NULL) ||
+      (GetVariableStoreStatus (VariableStoreHeader) != EfiValid)) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Size the index for the variables the store can hold, with a load factor
+  // of at most 3/4, as far as it fits in a HOB.
+  //
+  EntryCount = MAX (VariableStoreHeader->Size / VARIABLE_HASH_INDEX_VARIABLE_SIZE, VARIABLE_HASH_INDEX_MIN_ENTRY_COUNT);
+  if (GetPowerOfTwo32 (EntryCount) != EntryCount) {
+    EntryCount = GetPowerOfTwo32 (EntryCount) << 1;
+  }
+  while (sizeof (VARIABLE_HASH_INDEX) + EntryCount * sizeof (VARIABLE_HASH_INDEX_ENTRY) > VARIABLE_HASH_INDEX_MAX_SIZE) {
+    EntryCount >>= 1;
+  }
+
+  HashIndex = BuildGuidHob (&gEdkiiVariableHashIndexGuid, sizeof (VARIABLE_HASH_INDEX) + EntryCount * sizeof (VARIABLE_HASH_INDEX_ENTRY));
+  if (HashIndex == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  ZeroMem (HashIndex, sizeof (VARIABLE_HASH_INDEX) + EntryCount * sizeof (VARIABLE_HASH_INDEX_ENTRY));
+  HashIndex->StoreBase  = (EFI_PHYSICAL_ADDRESS) (UINTN) VariableStoreHeader;
+  HashIndex->StoreSize  = VariableStoreHeader->Size;
+  HashIndex->EntryCount = EntryCount;
+  HashIndex->AuthFormat = StoreInfo.AuthFlag;
+  Entries               = (VARIABLE_HASH_INDEX_ENTRY *) (HashIndex + 1);
+
+  Variable = GetStartPointer (VariableStoreHeader);
+  while (GetVariableHeader (&StoreInfo, Variable, &VariableHeader)) {
+    if (HashIndex->UsedCount >= EntryCount - EntryCount / 4) {
+      //
+      // The store holds more variables than the index can hold, walk the store.
+      //
+      HashIndex->Full = TRUE;
+      break;
+    }
+
+    Hash = VariableHashIndexHash (
+             GetVariableNamePtr (Variable, StoreInfo.AuthFlag),
+             NameSizeOfVariable (VariableHeader, StoreInfo.AuthFlag) / sizeof (CHAR16),
+             GetVendorGuidPtr (VariableHeader, StoreInfo.AuthFlag)
+             );
+    Slot = Hash & (EntryCount - 1);
+    while (Entries[Slot].Offset != 0) {
+      Slot = (Slot + 1) & (EntryCount - 1);
+    }
+    Entries[Slot].Hash   = Hash;
+    Entries[Slot].Offset = (UINT32) ((UINTN) Variable - (UINTN) VariableStoreHeader);
+    HashIndex->UsedCount++;
+
+    Variable = GetNextVariablePtr (&StoreInfo, Variable, VariableHeader);
+  }
+  HashIndex->IndexedOffset = (UINT32) ((UINTN) Variable - (UINTN) VariableStoreHeader);
+
+  DEBUG ((
+    DEBUG_INFO,
+    "PeiVariable: Hash index of %d variables of the NV storage%a\n",
+    HashIndex->UsedCount,
+    HashIndex->Full ? " is full" : ""
+    ));
+
+  return EFI_SUCCESS;
+}
+
 /**
   This service retrieves a variable's value using its name and GUID.
 
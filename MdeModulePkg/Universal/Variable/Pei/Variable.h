@@ -12,7 +12,9 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include <PiPei.h>
 #include <Ppi/ReadOnlyVariable2.h>
+#include <Ppi/MemoryDiscovered.h>
 
+#include <Library/BaseLib.h>
 #include <Library/DebugLib.h>
 #include <Library/PeimEntryPoint.h>
 #include <Library/HobLib.h>
@@ -23,6 +25,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include <Guid/VariableFormat.h>
 #include <Guid/VariableIndexTable.h>
+#include <Guid/VariableHashIndex.h>
 #include <Guid/SystemNvDataGuid.h>
 #include <Guid/FaultTolerantWrite.h>
 
@@ -36,6 +39,10 @@ typedef struct {
   VARIABLE_STORE_HEADER                   *VariableStoreHeader;
   VARIABLE_INDEX_TABLE                    *IndexTable;
   //
+  // If it is not NULL, the variables of the store are found through this hash index.
+  //
+  VARIABLE_HASH_INDEX                     *HashIndex;
+  //
   // If it is not NULL, it means there may be an inconsecutive variable whose
   // partial content is still in NV storage, but another partial content is backed up
   // in spare block.
@@ -44,6 +51,11 @@ typedef struct {
   BOOLEAN                                 AuthFlag;
 } VARIABLE_STORE_INFO;
 
+//
+// The maximum size of the variable hash index, the maximum size of the data of a GUID HOB
+//
+#define VARIABLE_HASH_INDEX_MAX_SIZE  (0xFFF8 - sizeof (EFI_HOB_GUID_TYPE))
+
 //
 // Functions
 //
@@ -65,6 +77,27 @@ PeimInitializeVariableServices (
   IN CONST EFI_PEI_SERVICES          **PeiServices
   );
 
+/**
+  Build the hash index of the variables of the non-volatile variable store, and
+  publish it in the variable hash index HOB, once permanent memory is installed.
+
+  @param  PeiServices       An indirect pointer to the EFI_PEI_SERVICES table published by the PEI Foundation.
+  @param  NotifyDescriptor  Address of the notification descriptor data structure.
+  @param  Ppi               Address of the PPI that was installed.
+
+  @retval EFI_SUCCESS           The hash index is built, or the variables of the store are
+                                found by walking the store.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory for the hash index HOB.
+
+**/
+EFI_STATUS
+EFIAPI
+BuildVariableHashIndex (
+  IN EFI_PEI_SERVICES           **PeiServices,
+  IN EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyDescriptor,
+  IN VOID                       *Ppi
+  );
+
 /**
   This service retrieves a variable's value using its name and GUID.
 
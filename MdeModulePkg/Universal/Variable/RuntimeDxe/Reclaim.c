@@ -8,6 +8,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
 #include "Variable.h"
+#include "VariableParsing.h"
 
 /**
   Gets LBA of block and offset by given address.
@@ -92,6 +93,10 @@ GetLbaAndOffsetByAddress (
   volume block device. The destination is specified by parameter
   VariableBase. Fault Tolerant Write protocol is used for writing.
 
+  Only the range of the variable storage space that differs from the buffer
+  is written, in a single fault tolerant write, so the blocks before and
+  after that range are not erased again.
+
   @param  VariableBase   Base address of variable to write
   @param  VariableBuffer Point to the variable data buffer.
 
@@ -111,8 +116,32 @@ FtwVariableSpace (
   EFI_LBA                            VarLba;
   UINTN                              VarOffset;
   UINTN                              FtwBufferSize;
+  UINTN                              WriteStart;
+  UINTN                              WriteEnd;
+  UINT8                              *Buffer;
+  UINT8                              *Storage;
   EFI_FAULT_TOLERANT_WRITE_PROTOCOL  *FtwProtocol;
 
+  FtwBufferSize = ((VARIABLE_STORE_HEADER *) ((UINTN) VariableBase))->Size;
+  ASSERT (FtwBufferSize == VariableBuffer->Size);
+
+  //
+  // Find the range of the variable storage space that the buffer changes.
+  //
+  Buffer  = (UINT8 *) VariableBuffer;
+  Storage = (UINT8 *) (UINTN) VariableBase;
+  WriteStart = 0;
+  while (WriteStart < FtwBufferSize && Buffer[WriteStart] == Storage[WriteStart]) {
+    WriteStart++;
+  }
+  if (WriteStart == FtwBufferSize) {
+    return EFI_SUCCESS;
+  }
+  WriteEnd = FtwBufferSize;
+  while (Buffer[WriteEnd - 1] == Storage[WriteEnd - 1]) {
+    WriteEnd--;
+  }
+
   //
   // Locate fault tolerant write protocol.
   //
@@ -130,26 +159,219 @@ FtwVariableSpace (
   //
   // Get LBA and Offset by address.
   //
-  Status = GetLbaAndOffsetByAddress (VariableBase, &VarLba, &VarOffset);
+  Status = GetLbaAndOffsetByAddress (VariableBase + WriteStart, &VarLba, &VarOffset);
   if (EFI_ERROR (Status)) {
     return EFI_ABORTED;
   }
 
-  FtwBufferSize = ((VARIABLE_STORE_HEADER *) ((UINTN) VariableBase))->Size;
-  ASSERT (FtwBufferSize == VariableBuffer->Size);
-
   //
   // FTW write record.
   //
   Status = FtwProtocol->Write (
                           FtwProtocol,
-                          VarLba,         // LBA
-                          VarOffset,      // Offset
-                          FtwBufferSize,  // NumBytes
-                          NULL,           // PrivateData NULL
-                          FvbHandle,      // Fvb Handle
-                          (VOID *) VariableBuffer // write buffer
+                          VarLba,                  // LBA
+                          VarOffset,               // Offset
+                          WriteEnd - WriteStart,   // NumBytes
+                          NULL,                    // PrivateData NULL
+                          FvbHandle,               // Fvb Handle
+                          Buffer + WriteStart      // write buffer
                           );
 
   return Status;
 }
+
+/**
+  Check whether a reclaim drops a variable of the non-volatile variable store.
+
+  @param[in] Variable                     The variable.
+  @param[in] UpdatingVariable             The variable being updated, or NULL.
+  @param[in] UpdatingInDeletedTransition  The IN_DELETED_TRANSITION copy of the variable
+                                          being updated, or NULL.
+
+  @retval TRUE                            The variable is deleted, or being updated.
+  @retval FALSE                           The variable is ADDED or IN_DELETED_TRANSITION.
+
+**/
+BOOLEAN
+IsDeadVariable (
+  IN VARIABLE_HEADER            *Variable,
+  IN VARIABLE_HEADER            *UpdatingVariable,
+  IN VARIABLE_HEADER            *UpdatingInDeletedTransition
+  )
+{
+  if (Variable == UpdatingVariable || Variable == UpdatingInDeletedTransition) {
+    return TRUE;
+  }
+  return (BOOLEAN) (Variable->State != VAR_ADDED && Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED));
+}
+
+/**
+  Get the offset in the non-volatile variable store from which it is reclaimed.
+
+  The variables before that offset are kept in place, so the blocks they
+  occupy are not written again.  For a complete reclaim, it is the offset of
+  the first variable that is not an ADDED variable kept as is.
+
+  For an incremental reclaim, the dead bytes of each erase block are weighed,
+  and the reclaim starts at the first variable of the erase block that gives
+  the most dead bytes reclaimed per byte written, among those from which at
+  least half of the dead bytes of the store are reclaimed.  The dead bytes
+  before it are left for a later reclaim.  The erase blocks are only known when
+  the firmware volume of the store has one size of erase block and starts on
+  an erase block boundary; otherwise the reclaim is complete.
+
+  @param[in]  VariableStoreHeader          The non-volatile variable store.
+  @param[in]  UpdatingVariable             The variable being updated, or NULL.
+  @param[in]  UpdatingInDeletedTransition  The IN_DELETED_TRANSITION copy of the variable
+                                           being updated, or NULL.
+  @param[in]  Incremental                  TRUE for an incremental reclaim.
+  @param[out] DeadSize                     The dead bytes of the store.
+
+  @return The offset of the first variable reclaimed, from the variable store header.
+
+**/
+UINTN
+GetReclaimStartOffset (
+  IN  VARIABLE_STORE_HEADER     *VariableStoreHeader,
+  IN  VARIABLE_HEADER           *UpdatingVariable,
+  IN  VARIABLE_HEADER           *UpdatingInDeletedTransition,
+  IN  BOOLEAN                   Incremental,
+  OUT UINTN                     *DeadSize
+  )
+{
+  VARIABLE_HEADER       *Variable;
+  VARIABLE_HEADER       *NextVariable;
+  VARIABLE_HEADER       *FirstVariable;
+  VARIABLE_HEADER       *StartVariable;
+  UINTN                 EndOffset;
+  UINTN                 BlockSize;
+  UINTN                 FvBase;
+  UINTN                 Block;
+  UINTN                 LastBlock;
+  UINTN                 DeadSizeBefore;
+  UINTN                 StartDeadSize;
+  UINTN                 StartWriteSize;
+  UINTN                 WriteSize;
+  BOOLEAN               AuthFormat;
+
+  AuthFormat = mVariableModuleGlobal->VariableGlobal.AuthFormat;
+
+  //
+  // Find the first variable that is not kept as is, and count the dead bytes.
+  // IN_DELETED_TRANSITION variables are not counted, as they are dropped only
+  // if they have an ADDED copy.
+  //
+  FirstVariable = NULL;
+  *DeadSize     = 0;
+  Variable      = GetStartPointer (VariableStoreHeader);
+  while (IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))) {
+    NextVariable = GetNextVariablePtr (Variable, AuthFormat);
+    if (FirstVariable == NULL && (Variable->State != VAR_ADDED || Variable == UpdatingVariable)) {
+      FirstVariable = Variable;
+    }
+    if (IsDeadVariable (Variable, UpdatingVariable, UpdatingInDeletedTransition)) {
+      *DeadSize += (UINTN) NextVariable - (UINTN) Variable;
+    }
+    Variable = NextVariable;
+  }
+  EndOffset = (UINTN) Variable - (UINTN) VariableStoreHeader;
+
+  if (FirstVariable == NULL) {
+    return EndOffset;
+  }
+
+  if (!Incremental || *DeadSize == 0) {
+    return (UINTN) FirstVariable - (UINTN) VariableStoreHeader;
+  }
+
+  //
+  // The erase block of an offset in the store is only known when the firmware
+  // volume has one size of erase block, and is aligned on it.
+  //
+  BlockSize = mNvFvHeaderCache->BlockMap[0].Length;
+  FvBase    = (UINTN) VariableStoreHeader - mNvFvHeaderCache->HeaderLength;
+  if (BlockSize == 0 ||
+      mNvFvHeaderCache->BlockMap[1].NumBlocks != 0 ||
+      mNvFvHeaderCache->BlockMap[1].Length != 0 ||
+      (FvBase % BlockSize) != 0) {
+    return (UINTN) FirstVariable - (UINTN) VariableStoreHeader;
+  }
+
+  //
+  // Weigh starting the reclaim at the first variable of each erase block.
+  // The variables being updated have to be reclaimed.
+  //
+  StartVariable  = FirstVariable;
+  StartDeadSize  = *DeadSize;
+  StartWriteSize = EndOffset - ((UINTN) FirstVariable - (UINTN) VariableStoreHeader);
+  DeadSizeBefore = 0;
+  LastBlock      = (mNvFvHeaderCache->HeaderLength + (UINTN) FirstVariable - (UINTN) VariableStoreHeader) / BlockSize;
+  Variable       = FirstVariable;
+  while (IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))) {
+    NextVariable = GetNextVariablePtr (Variable, AuthFormat);
+    Block        = (mNvFvHeaderCache->HeaderLength + (UINTN) Variable - (UINTN) VariableStoreHeader) / BlockSize;
+    if (Block != LastBlock) {
+      LastBlock = Block;
+      if ((UpdatingVariable != NULL && Variable > UpdatingVariable) ||
+          (UpdatingInDeletedTransition != NULL && Variable > UpdatingInDeletedTransition) ||
+          ((*DeadSize - DeadSizeBefore) * 2 < *DeadSize)) {
+        break;
+      }
+      WriteSize = EndOffset - ((UINTN) Variable - (UINTN) VariableStoreHeader);
+      if (MultU64x64 (*DeadSize - DeadSizeBefore, StartWriteSize) > MultU64x64 (StartDeadSize, WriteSize)) {
+        StartVariable  = Variable;
+        StartDeadSize  = *DeadSize - DeadSizeBefore;
+        StartWriteSize = WriteSize;
+      }
+    }
+
+    if (IsDeadVariable (Variable, UpdatingVariable, UpdatingInDeletedTransition)) {
+      DeadSizeBefore += (UINTN) NextVariable - (UINTN) Variable;
+    }
+    Variable = NextVariable;
+  }
+
+  return (UINTN) StartVariable - (UINTN) VariableStoreHeader;
+}
+
+/**
+  Add the sizes of a range of variables of the non-volatile variable store to
+  the total sizes of the variables.
+
+  The variables are counted whatever their state, as the variables a reclaim
+  keeps in place take space in the store until a later reclaim drops them.
+
+  @param[in]      Variable                     The first variable of the range.
+  @param[in]      EndVariable                  The variable after the range.
+  @param[in, out] HwErrVariableTotalSize       The total size of the hardware error
+                                               record variables.
+  @param[in, out] CommonVariableTotalSize      The total size of the other variables.
+  @param[in, out] CommonUserVariableTotalSize  The total size of the user variables.
+
+**/
+VOID
+GetVariableTotalSizes (
+  IN     VARIABLE_HEADER        *Variable,
+  IN     VARIABLE_HEADER        *EndVariable,
+  IN OUT UINTN                  *HwErrVariableTotalSize,
+  IN OUT UINTN                  *CommonVariableTotalSize,
+  IN OUT UINTN                  *CommonUserVariableTotalSize
+  )
+{
+  VARIABLE_HEADER       *NextVariable;
+  UINTN                 VariableSize;
+
+  while (Variable < EndVariable) {
+    NextVariable = GetNextVariablePtr (Variable, mVariableModuleGlobal->VariableGlobal.AuthFormat);
+    VariableSize = (UINTN) NextVariable - (UINTN) Variable;
+    if ((Variable->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) == EFI_VARIABLE_HARDWARE_ERROR_RECORD) {
+      *HwErrVariableTotalSize += VariableSize;
+    } else {
+      *CommonVariableTotalSize += VariableSize;
+      if (IsUserVariable (Variable)) {
+        *CommonUserVariableTotalSize += VariableSize;
+      }
+    }
+    Variable = NextVariable;
+  }
+}
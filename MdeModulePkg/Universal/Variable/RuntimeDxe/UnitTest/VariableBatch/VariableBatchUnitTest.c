@@ -0,0 +1,437 @@
+/** @file
+  Host based unit tests of the variable batch.
+
+  The variable stores are in memory, in the emulated non-volatile mode.  The
+  tests check that a batch the non-volatile variable store has no space for
+  sets none of its variables and leaves the store as it was, that a batch that
+  only fits once the store is reclaimed sets all its variables, and that the
+  variable services lock is acquired once for the whole batch.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "Variable.h"
+#include "VariableParsing.h"
+
+#include <Library/PrintLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME        "Variable Batch Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Sizes of the test variable stores, and maximum size of a test variable
+//
+#define VARIABLE_TEST_NV_STORE_SIZE         SIZE_4KB
+#define VARIABLE_TEST_VOLATILE_STORE_SIZE   SIZE_4KB
+#define VARIABLE_TEST_MAX_VARIABLE_SIZE     SIZE_1KB
+
+//
+// Size of the data of the test variables, number of the test variables in a
+// batch, and maximum number of characters of their names
+//
+#define VARIABLE_TEST_DATA_SIZE       0x200
+#define VARIABLE_TEST_BATCH_COUNT     4
+#define VARIABLE_TEST_NAME_LENGTH     16
+
+#define VARIABLE_TEST_ATTRIBUTES      (EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS)
+
+//
+// Defined by the stand-ins of the services Variable.c depends on
+//
+extern UINTN    mStubLockAcquireCount;
+extern BOOLEAN  mStubLockHeld;
+extern BOOLEAN  mStubLockReentered;
+extern UINTN    mStubSecureBootHookCount;
+
+//
+// Vendor GUID of the test variables
+//
+EFI_GUID                    mVariableTestGuid = {
+  0x7a1d4f26, 0x93c8, 0x4b5e, { 0x8e, 0x02, 0x6c, 0xf1, 0x3b, 0xa9, 0x57, 0xd4 }
+};
+
+VARIABLE_STORE_HEADER       *mVariableTestNvStore;
+VARIABLE_STORE_HEADER       *mVariableTestVolatileStore;
+CHAR16                      mVariableTestNames[VARIABLE_TEST_BATCH_COUNT][VARIABLE_TEST_NAME_LENGTH];
+UINT8                       mVariableTestData[VARIABLE_TEST_BATCH_COUNT][VARIABLE_TEST_DATA_SIZE];
+EDKII_VARIABLE_BATCH_ENTRY  mVariableTestBatch[VARIABLE_TEST_BATCH_COUNT];
+
+/**
+  Create an empty variable store.
+
+  @param  Size          The size of the variable store.
+  @param  ScratchSize   The size of the scratch buffer that follows the store.
+
+  @return The variable store, or NULL if there is not enough memory.
+
+**/
+VARIABLE_STORE_HEADER *
+VariableTestCreateStore (
+  IN UINTN  Size,
+  IN UINTN  ScratchSize
+  )
+{
+  VARIABLE_STORE_HEADER  *Store;
+
+  Store = AllocatePool (Size + ScratchSize);
+  if (Store == NULL) {
+    return NULL;
+  }
+
+  SetMem (Store, Size + ScratchSize, 0xff);
+  CopyGuid (&Store->Signature, &gEfiVariableGuid);
+  Store->Size      = (UINT32) Size;
+  Store->Format    = VARIABLE_STORE_FORMATTED;
+  Store->State     = VARIABLE_STORE_HEALTHY;
+  Store->Reserved  = 0;
+  Store->Reserved1 = 0;
+  return Store;
+}
+
+/**
+  Create the variable module global, with an empty emulated non-volatile
+  variable store and an empty volatile variable store followed by the scratch
+  buffer, and the batch of test variables.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED                      The stores are created.
+  @retval  UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  There is not enough memory.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+VariableTestCreateStores (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  mVariableModuleGlobal      = AllocateZeroPool (sizeof (VARIABLE_MODULE_GLOBAL));
+  mVariableTestNvStore       = VariableTestCreateStore (VARIABLE_TEST_NV_STORE_SIZE, 0);
+  mVariableTestVolatileStore = VariableTestCreateStore (VARIABLE_TEST_VOLATILE_STORE_SIZE, VARIABLE_TEST_MAX_VARIABLE_SIZE);
+  if (mVariableModuleGlobal == NULL || mVariableTestNvStore == NULL || mVariableTestVolatileStore == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  mNvVariableCache = mVariableTestNvStore;
+  mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase = (EFI_PHYSICAL_ADDRESS) (UINTN) mVariableTestNvStore;
+  mVariableModuleGlobal->VariableGlobal.VolatileVariableBase    = (EFI_PHYSICAL_ADDRESS) (UINTN) mVariableTestVolatileStore;
+  mVariableModuleGlobal->VariableGlobal.EmuNvMode   = TRUE;
+  mVariableModuleGlobal->VariableGlobal.AuthFormat  = FALSE;
+  mVariableModuleGlobal->VariableGlobal.AuthSupport = FALSE;
+  mVariableModuleGlobal->NonVolatileLastVariableOffset = (UINTN) GetStartPointer (mVariableTestNvStore) - (UINTN) mVariableTestNvStore;
+  mVariableModuleGlobal->VolatileLastVariableOffset    = (UINTN) GetStartPointer (mVariableTestVolatileStore) - (UINTN) mVariableTestVolatileStore;
+  mVariableModuleGlobal->CommonVariableSpace        = VARIABLE_TEST_NV_STORE_SIZE - mVariableModuleGlobal->NonVolatileLastVariableOffset;
+  mVariableModuleGlobal->CommonMaxUserVariableSpace = mVariableModuleGlobal->CommonVariableSpace;
+  mVariableModuleGlobal->CommonRuntimeVariableSpace = mVariableModuleGlobal->CommonVariableSpace;
+  mVariableModuleGlobal->MaxVariableSize         = VARIABLE_TEST_MAX_VARIABLE_SIZE;
+  mVariableModuleGlobal->MaxAuthVariableSize     = VARIABLE_TEST_MAX_VARIABLE_SIZE;
+  mVariableModuleGlobal->MaxVolatileVariableSize = VARIABLE_TEST_MAX_VARIABLE_SIZE;
+  mVariableModuleGlobal->ScratchBufferSize       = VARIABLE_TEST_MAX_VARIABLE_SIZE;
+
+  for (Index = 0; Index < VARIABLE_TEST_BATCH_COUNT; Index++) {
+    UnicodeSPrint (mVariableTestNames[Index], sizeof (mVariableTestNames[Index]), L"BatchVar%d", Index);
+    SetMem (mVariableTestData[Index], VARIABLE_TEST_DATA_SIZE, (UINT8) (0xA0 + Index));
+    mVariableTestBatch[Index].VariableName = mVariableTestNames[Index];
+    mVariableTestBatch[Index].VendorGuid   = &mVariableTestGuid;
+    mVariableTestBatch[Index].Attributes   = VARIABLE_TEST_ATTRIBUTES;
+    mVariableTestBatch[Index].DataSize     = VARIABLE_TEST_DATA_SIZE;
+    mVariableTestBatch[Index].Data         = mVariableTestData[Index];
+    mVariableTestBatch[Index].Status       = EFI_SUCCESS;
+  }
+
+  mStubLockAcquireCount    = 0;
+  mStubLockHeld            = FALSE;
+  mStubLockReentered       = FALSE;
+  mStubSecureBootHookCount = 0;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free the variable module global and the variable stores.
+
+  @param[in]  Context    Unused.
+**/
+VOID
+EFIAPI
+VariableTestFreeStores (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  if (mVariableTestNvStore != NULL) {
+    FreePool (mVariableTestNvStore);
+    mVariableTestNvStore = NULL;
+  }
+  if (mVariableTestVolatileStore != NULL) {
+    FreePool (mVariableTestVolatileStore);
+    mVariableTestVolatileStore = NULL;
+  }
+  if (mVariableModuleGlobal != NULL) {
+    FreePool (mVariableModuleGlobal);
+    mVariableModuleGlobal = NULL;
+  }
+  mNvVariableCache = NULL;
+}
+
+/**
+  Set non-volatile variables that fill the non-volatile variable store.
+
+  @param  Count    The number of variables to set.
+
+  @retval EFI_SUCCESS    The variables are set.
+  @retval Others         A variable could not be set.
+
+**/
+EFI_STATUS
+VariableTestFillStore (
+  IN UINTN  Count
+  )
+{
+  EFI_STATUS  Status;
+  CHAR16      Name[VARIABLE_TEST_NAME_LENGTH];
+  UINT8       Data[VARIABLE_TEST_DATA_SIZE];
+  UINTN       Index;
+
+  SetMem (Data, sizeof (Data), 0x5A);
+  for (Index = 0; Index < Count; Index++) {
+    UnicodeSPrint (Name, sizeof (Name), L"FillVar%d", Index);
+    Status = VariableServiceSetVariable (Name, &mVariableTestGuid, VARIABLE_TEST_ATTRIBUTES, sizeof (Data), Data);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Delete the variables VariableTestFillStore () set, from the first one.
+
+  @param  Count    The number of variables to delete.
+
+  @retval EFI_SUCCESS    The variables are deleted.
+  @retval Others         A variable could not be deleted.
+
+**/
+EFI_STATUS
+VariableTestDeleteFill (
+  IN UINTN  Count
+  )
+{
+  EFI_STATUS  Status;
+  CHAR16      Name[VARIABLE_TEST_NAME_LENGTH];
+  UINTN       Index;
+
+  for (Index = 0; Index < Count; Index++) {
+    UnicodeSPrint (Name, sizeof (Name), L"FillVar%d", Index);
+    Status = VariableServiceSetVariable (Name, &mVariableTestGuid, 0, 0, NULL);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Find a test variable of the batch.
+
+  @param  Index    The index of the variable in the batch.
+
+  @return The variable, or NULL if the variable is not found.
+
+**/
+VARIABLE_HEADER *
+VariableTestFind (
+  IN UINTN  Index
+  )
+{
+  VARIABLE_POINTER_TRACK  Variable;
+
+  if (EFI_ERROR (FindVariable (mVariableTestNames[Index], &mVariableTestGuid, &Variable, &mVariableModuleGlobal->VariableGlobal, FALSE))) {
+    return NULL;
+  }
+  return Variable.CurrPtr;
+}
+
+/**
+  Check that a batch the non-volatile variable store has no space for, even
+  after a reclaim, sets none of its variables, although its first variables
+  would fit, and leaves the store as it was.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BatchShouldSetNothingWhenOutOfSpace (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_STORE_HEADER  *Snapshot;
+  UINTN                  LastVariableOffset;
+  UINTN                  Index;
+
+  //
+  // Leave space for all the variables of the batch but one.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (VariableTestFillStore (4));
+
+  Snapshot = AllocateCopyPool (VARIABLE_TEST_NV_STORE_SIZE, mVariableTestNvStore);
+  UT_ASSERT_NOT_NULL (Snapshot);
+  LastVariableOffset = mVariableModuleGlobal->NonVolatileLastVariableOffset;
+
+  mStubLockAcquireCount    = 0;
+  mStubSecureBootHookCount = 0;
+  UT_ASSERT_STATUS_EQUAL (VariableServiceSetVariableBatch (VARIABLE_TEST_BATCH_COUNT, mVariableTestBatch), EFI_OUT_OF_RESOURCES);
+  UT_ASSERT_EQUAL (mStubLockAcquireCount, 1);
+  UT_ASSERT_FALSE (mStubLockReentered);
+  UT_ASSERT_FALSE (mStubLockHeld);
+  UT_ASSERT_EQUAL (mStubSecureBootHookCount, 0);
+  for (Index = 0; Index < VARIABLE_TEST_BATCH_COUNT; Index++) {
+    UT_ASSERT_STATUS_EQUAL (mVariableTestBatch[Index].Status, EFI_NOT_STARTED);
+    UT_ASSERT_TRUE (VariableTestFind (Index) == NULL);
+  }
+  UT_ASSERT_EQUAL (mVariableModuleGlobal->NonVolatileLastVariableOffset, LastVariableOffset);
+  UT_ASSERT_MEM_EQUAL (mVariableTestNvStore, Snapshot, VARIABLE_TEST_NV_STORE_SIZE);
+
+  //
+  // Set one by one, the variables of the batch but the last one do fit.
+  //
+  for (Index = 0; Index < VARIABLE_TEST_BATCH_COUNT - 1; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (
+      VariableServiceSetVariable (
+        mVariableTestNames[Index],
+        &mVariableTestGuid,
+        VARIABLE_TEST_ATTRIBUTES,
+        VARIABLE_TEST_DATA_SIZE,
+        mVariableTestData[Index]
+        )
+      );
+  }
+
+  FreePool (Snapshot);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that a batch that only fits once the non-volatile variable store is
+  reclaimed sets all its variables, under one hold of the variable services
+  lock.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BatchShouldSetAllAfterReclaim (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_HEADER  *Variable;
+  UINTN            Index;
+
+  //
+  // Fill the store, and delete most of the variables, so the batch only fits
+  // once the deleted variables are reclaimed.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (VariableTestFillStore (6));
+  UT_ASSERT_NOT_EFI_ERROR (VariableTestDeleteFill (4));
+
+  mStubLockAcquireCount    = 0;
+  mStubSecureBootHookCount = 0;
+  UT_ASSERT_NOT_EFI_ERROR (VariableServiceSetVariableBatch (VARIABLE_TEST_BATCH_COUNT, mVariableTestBatch));
+  UT_ASSERT_EQUAL (mStubLockAcquireCount, 1);
+  UT_ASSERT_FALSE (mStubLockReentered);
+  UT_ASSERT_FALSE (mStubLockHeld);
+  UT_ASSERT_EQUAL (mStubSecureBootHookCount, VARIABLE_TEST_BATCH_COUNT);
+  for (Index = 0; Index < VARIABLE_TEST_BATCH_COUNT; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (mVariableTestBatch[Index].Status);
+    Variable = VariableTestFind (Index);
+    UT_ASSERT_NOT_NULL (Variable);
+    UT_ASSERT_EQUAL (DataSizeOfVariable (Variable, FALSE), VARIABLE_TEST_DATA_SIZE);
+    UT_ASSERT_MEM_EQUAL (GetVariableDataPtr (Variable, FALSE), mVariableTestData[Index], VARIABLE_TEST_DATA_SIZE);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the variable
+  batch and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      BatchTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&BatchTests, Framework, "Variable Batch Tests", "Variable.Batch", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BatchTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (BatchTests, "Batch should set nothing when out of space", "OutOfSpace", BatchShouldSetNothingWhenOutOfSpace, VariableTestCreateStores, VariableTestFreeStores, NULL);
+  AddTestCase (BatchTests, "Batch should set all the variables after a reclaim", "Reclaim", BatchShouldSetAllAfterReclaim, VariableTestCreateStores, VariableTestFreeStores, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
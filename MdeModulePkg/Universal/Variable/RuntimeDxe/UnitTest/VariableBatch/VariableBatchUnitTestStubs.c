@@ -0,0 +1,371 @@
+/** @file
+  Host based stand-ins for the services that the variable services (Variable.c)
+  depend on, for the tests of the variable batch.
+
+  The variable services lock records how many times it is acquired, and whether
+  it is acquired while it is held.  SecureBootHook() records how many times it
+  is called.  The variable checks accept all the variables.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "Variable.h"
+#include "VariableNonVolatile.h"
+
+//
+// Number of times the variable services lock is acquired, whether it is held,
+// and whether it was acquired while it was held
+//
+UINTN     mStubLockAcquireCount;
+BOOLEAN   mStubLockHeld;
+BOOLEAN   mStubLockReentered;
+
+//
+// Number of times SecureBootHook () is called
+//
+UINTN     mStubSecureBootHookCount;
+
+/**
+  Initializes a basic mutual exclusion lock.
+
+  @param[in, out] Lock       A pointer to the lock data structure to initialize.
+  @param[in]      Priority   Unused.
+
+  @return Lock
+
+**/
+EFI_LOCK *
+InitializeLock (
+  IN OUT EFI_LOCK  *Lock,
+  IN EFI_TPL        Priority
+  )
+{
+  return Lock;
+}
+
+/**
+  Acquire the variable services lock, and record whether it was held.
+
+  @param[in] Lock    The lock to acquire.
+
+**/
+VOID
+AcquireLockOnlyAtBootTime (
+  IN EFI_LOCK  *Lock
+  )
+{
+  if (mStubLockHeld) {
+    mStubLockReentered = TRUE;
+  }
+  mStubLockHeld = TRUE;
+  mStubLockAcquireCount++;
+}
+
+/**
+  Release the variable services lock.
+
+  @param[in] Lock    The lock to release.
+
+**/
+VOID
+ReleaseLockOnlyAtBootTime (
+  IN EFI_LOCK  *Lock
+  )
+{
+  mStubLockHeld = FALSE;
+}
+
+/**
+  Return TRUE if ExitBootServices () has been called.
+
+  @retval FALSE  The tests run before ExitBootServices ().
+**/
+BOOLEAN
+AtRuntime (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+/**
+  Record the call of the hook of the Secure Boot variables.
+
+  @param[in] VariableName   Unused.
+  @param[in] VendorGuid     Unused.
+
+**/
+VOID
+EFIAPI
+SecureBootHook (
+  IN CHAR16                                 *VariableName,
+  IN EFI_GUID                               *VendorGuid
+  )
+{
+  mStubSecureBootHookCount++;
+}
+
+/**
+  Initialization for MOR Control Lock.
+
+  @retval EFI_SUCCESS     Nothing to initialize.
+**/
+EFI_STATUS
+MorLockInit (
+  VOID
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  The test variables are not MOR variables.
+
+  @param[in] VariableName   Unused.
+  @param[in] VendorGuid     Unused.
+  @param[in] Attributes     Unused.
+  @param[in] DataSize       Unused.
+  @param[in] Data           Unused.
+
+  @retval EFI_SUCCESS       The variable is not a MOR variable.
+**/
+EFI_STATUS
+SetVariableCheckHandlerMor (
+  IN CHAR16     *VariableName,
+  IN EFI_GUID   *VendorGuid,
+  IN UINT32     Attributes,
+  IN UINTN      DataSize,
+  IN VOID       *Data
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  No speculation barrier is needed on the host.
+**/
+VOID
+VariableSpeculationBarrier (
+  VOID
+  )
+{
+}
+
+/**
+  The test variables have no property.
+
+  @param[in] Name               Unused.
+  @param[in] Guid               Unused.
+  @param[in] VariableProperty   Unused.
+
+  @retval EFI_SUCCESS           The property is ignored.
+**/
+EFI_STATUS
+EFIAPI
+VarCheckLibVariablePropertySet (
+  IN CHAR16                         *Name,
+  IN EFI_GUID                       *Guid,
+  IN VAR_CHECK_VARIABLE_PROPERTY    *VariableProperty
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  The test variables have no property.
+
+  @param[in]  Name               Unused.
+  @param[in]  Guid               Unused.
+  @param[out] VariableProperty   Unused.
+
+  @retval EFI_NOT_FOUND          The variable has no property.
+**/
+EFI_STATUS
+EFIAPI
+VarCheckLibVariablePropertyGet (
+  IN CHAR16                         *Name,
+  IN EFI_GUID                       *Guid,
+  OUT VAR_CHECK_VARIABLE_PROPERTY   *VariableProperty
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Accept all the test variables.
+
+  @param[in] VariableName       Unused.
+  @param[in] VendorGuid         Unused.
+  @param[in] Attributes         Unused.
+  @param[in] DataSize           Unused.
+  @param[in] Data               Unused.
+  @param[in] RequestSource      Unused.
+
+  @retval EFI_SUCCESS           The variable passes the checks.
+**/
+EFI_STATUS
+EFIAPI
+VarCheckLibSetVariableCheck (
+  IN CHAR16                     *VariableName,
+  IN EFI_GUID                   *VendorGuid,
+  IN UINT32                     Attributes,
+  IN UINTN                      DataSize,
+  IN VOID                       *Data,
+  IN VAR_CHECK_REQUEST_SOURCE   RequestSource
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  The tests do not support authenticated variables.
+
+  @param[in]  AuthVarLibContextIn    Unused.
+  @param[out] AuthVarLibContextOut   Unused.
+
+  @retval EFI_UNSUPPORTED            Authenticated variables are not supported.
+**/
+EFI_STATUS
+EFIAPI
+AuthVariableLibInitialize (
+  IN  AUTH_VAR_LIB_CONTEXT_IN   *AuthVarLibContextIn,
+  OUT AUTH_VAR_LIB_CONTEXT_OUT  *AuthVarLibContextOut
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  The tests do not support authenticated variables.
+
+  @param[in] VariableName           Unused.
+  @param[in] VendorGuid             Unused.
+  @param[in] Data                   Unused.
+  @param[in] DataSize               Unused.
+  @param[in] Attributes             Unused.
+
+  @retval EFI_UNSUPPORTED           Authenticated variables are not supported.
+**/
+EFI_STATUS
+EFIAPI
+AuthVariableLibProcessVariable (
+  IN CHAR16         *VariableName,
+  IN EFI_GUID       *VendorGuid,
+  IN VOID           *Data,
+  IN UINTN          DataSize,
+  IN UINT32         Attributes
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  The test variable store is in memory, and has no firmware volume block.
+
+  @param[in]  FvBlockHandle   Unused.
+  @param[out] FvBlock         Unused.
+
+  @retval EFI_NOT_FOUND       There is no firmware volume block.
+**/
+EFI_STATUS
+GetFvbByHandle (
+  IN  EFI_HANDLE                          FvBlockHandle,
+  OUT EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  **FvBlock
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+/**
+  The test variable store is in memory, and has no firmware volume block.
+
+  @param[out] NumberHandles   Unused.
+  @param[out] Buffer          Unused.
+
+  @retval EFI_NOT_FOUND       There is no firmware volume block.
+**/
+EFI_STATUS
+GetFvbCountAndBuffer (
+  OUT UINTN                               *NumberHandles,
+  OUT EFI_HANDLE                          **Buffer
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+/**
+  The test variable store is in memory, and has no fault tolerant write.
+
+  @param[out] FtwProtocol   Unused.
+
+  @retval EFI_NOT_FOUND     There is no fault tolerant write.
+**/
+EFI_STATUS
+GetFtwProtocol (
+  OUT VOID                                **FtwProtocol
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+/**
+  The tests create their variable stores.
+
+  @return 0
+**/
+UINTN
+GetNonVolatileMaxVariableSize (
+  VOID
+  )
+{
+  return 0;
+}
+
+/**
+  The tests create their variable stores.
+
+  @retval EFI_UNSUPPORTED   The stores are created by the tests.
+**/
+EFI_STATUS
+InitNonVolatileVariableStore (
+  VOID
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  The tests run without HOBs.
+
+  @param[in] Guid          Unused.
+
+  @retval NULL             There is no HOB.
+**/
+VOID *
+EFIAPI
+GetFirstGuidHob (
+  IN CONST EFI_GUID         *Guid
+  )
+{
+  return NULL;
+}
+
+/**
+  The tests run without HOBs.
+
+  @param[in] Guid          Unused.
+  @param[in] HobStart      Unused.
+
+  @retval NULL             There is no HOB.
+**/
+VOID *
+EFIAPI
+GetNextGuidHob (
+  IN CONST EFI_GUID         *Guid,
+  IN CONST VOID             *HobStart
+  )
+{
+  return NULL;
+}
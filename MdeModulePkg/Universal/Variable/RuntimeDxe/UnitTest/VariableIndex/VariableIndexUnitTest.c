@@ -0,0 +1,834 @@
+/** @file
+  Host based unit tests of the hash index of the variable stores.
+
+  The variables of a test variable store are looked up with FindVariableEx(),
+  through the hash index of the store, and the tests check that the results
+  are the ones of the walk of the store, as variables are added, change state
+  and are reclaimed, when the store holds more variables than its index, and
+  when the index is loaded from the hash index the PEI variable module built.
+  The enumeration of the variables is checked the same way, and the benchmark
+  suite reports the cost of GetNextVariableName() over a store of 1000
+  variables, walking the store, through the index, and with the cursor of the
+  enumeration.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include "VariableParsing.h"
+#include "VariableIndex.h"
+
+#include <Library/PrintLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME        "Variable Index Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Size of the test variable store, and number of variables the tests add to
+// it
+//
+#define VARIABLE_TEST_STORE_SIZE      0x10000
+#define VARIABLE_TEST_VARIABLE_COUNT  200
+
+//
+// Size of a test variable store that holds more variables than its index
+//
+#define VARIABLE_TEST_SMALL_STORE_SIZE  0x1000
+
+//
+// Maximum number of characters of the names of the test variables
+//
+#define VARIABLE_TEST_NAME_LENGTH     16
+
+//
+// Size of the variable store, number of variables and number of enumerations
+// of the store of the benchmark
+//
+#define BENCHMARK_STORE_SIZE          0x40000
+#define BENCHMARK_VARIABLE_COUNT      1000
+#define BENCHMARK_ENUMERATION_COUNT   16
+
+//
+// How the enumeration of the variables finds the variable the caller passes
+// back
+//
+typedef enum {
+  VariableTestEnumerateWalk,
+  VariableTestEnumerateIndex,
+  VariableTestEnumerateCursor
+} VARIABLE_TEST_ENUMERATION;
+
+//
+// Set by the stand-in AtRuntime ()
+//
+extern BOOLEAN  mStubAtRuntime;
+
+//
+// Vendor GUIDs of the test variables
+//
+EFI_GUID              mVariableTestGuid = {
+  0x6a1d3c58, 0x92e4, 0x4b07, { 0xa3, 0x5f, 0x18, 0xc6, 0x7e, 0x90, 0x2d, 0x4b }
+};
+EFI_GUID              mVariableTestOtherGuid = {
+  0xd27b45e0, 0x3f81, 0x4c6a, { 0x9e, 0x14, 0x6b, 0x02, 0xa8, 0xf3, 0x57, 0xc9 }
+};
+
+VARIABLE_STORE_HEADER *mVariableTestStore;
+VARIABLE_HEADER       *mVariableTestEnd;
+
+/**
+  Create an empty volatile variable store, and index it.
+
+  @param  Size         The size of the variable store.
+
+  @retval EFI_SUCCESS           The variable store is created.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory.
+
+**/
+EFI_STATUS
+VariableTestCreateStore (
+  IN UINT32  Size
+  )
+{
+  mVariableTestStore = AllocatePool (Size);
+  if (mVariableTestStore == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  SetMem (mVariableTestStore, Size, 0xff);
+  CopyGuid (&mVariableTestStore->Signature, &gEfiVariableGuid);
+  mVariableTestStore->Size      = Size;
+  mVariableTestStore->Format    = VARIABLE_STORE_FORMATTED;
+  mVariableTestStore->State     = VARIABLE_STORE_HEALTHY;
+  mVariableTestStore->Reserved  = 0;
+  mVariableTestStore->Reserved1 = 0;
+  mVariableTestEnd = GetStartPointer (mVariableTestStore);
+
+  return VariableIndexInitialize (VariableStoreTypeVolatile, mVariableTestStore, FALSE, NULL);
+}
+
+/**
+  Free the test variable store, and its index.
+
+**/
+VOID
+VariableTestFreeStore (
+  VOID
+  )
+{
+  VariableIndexFree (VariableStoreTypeVolatile);
+  FreePool (mVariableTestStore);
+  mVariableTestStore = NULL;
+}
+
+/**
+  Return the name of a test variable.
+
+  @param  Index        The number of the test variable.
+  @param  Name         The name of the test variable, of VARIABLE_TEST_NAME_LENGTH
+                       characters.
+
+**/
+VOID
+VariableTestName (
+  IN  UINTN   Index,
+  OUT CHAR16  *Name
+  )
+{
+  UnicodeSPrint (Name, VARIABLE_TEST_NAME_LENGTH * sizeof (CHAR16), L"Var%04d", Index);
+}
+
+/**
+  Add a variable to the end of the test variable store, the way
+  UpdateVariable() does, without updating the index.
+
+  @param  Name         The name of the variable.
+  @param  Guid         The vendor GUID of the variable.
+  @param  Attributes   The attributes of the variable.
+  @param  Data         The data of the variable.
+
+  @return The header of the variable.
+
+**/
+VARIABLE_HEADER *
+VariableTestAddVariable (
+  IN CHAR16    *Name,
+  IN EFI_GUID  *Guid,
+  IN UINT32    Attributes,
+  IN UINT32    Data
+  )
+{
+  VARIABLE_HEADER  *Variable;
+
+  Variable             = mVariableTestEnd;
+  Variable->StartId    = VARIABLE_DATA;
+  Variable->State      = VAR_ADDED;
+  Variable->Reserved   = 0;
+  Variable->Attributes = Attributes;
+  Variable->NameSize   = (UINT32) StrSize (Name);
+  Variable->DataSize   = sizeof (Data);
+  CopyGuid (&Variable->VendorGuid, Guid);
+  CopyMem (GetVariableNamePtr (Variable, FALSE), Name, Variable->NameSize);
+  CopyMem (GetVariableDataPtr (Variable, FALSE), &Data, sizeof (Data));
+
+  mVariableTestEnd = GetNextVariablePtr (Variable, FALSE);
+  ASSERT (mVariableTestEnd <= GetEndPointer (mVariableTestStore));
+  return Variable;
+}
+
+/**
+  Find a variable in the test variable store, through the index of the store
+  if it is up to date.
+
+  @param  Name           The name of the variable.
+  @param  Guid           The vendor GUID of the variable.
+  @param  IgnoreRtCheck  Ignore the EFI_VARIABLE_RUNTIME_ACCESS attribute at runtime.
+  @param  PtrTrack       The variable found.
+
+  @return The status of FindVariableEx().
+
+**/
+EFI_STATUS
+VariableTestFind (
+  IN  CHAR16                  *Name,
+  IN  EFI_GUID                *Guid,
+  IN  BOOLEAN                 IgnoreRtCheck,
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack
+  )
+{
+  ZeroMem (PtrTrack, sizeof (*PtrTrack));
+  PtrTrack->StartPtr = GetStartPointer (mVariableTestStore);
+  PtrTrack->EndPtr   = GetEndPointer (mVariableTestStore);
+  PtrTrack->Volatile = TRUE;
+  return FindVariableEx (Name, Guid, IgnoreRtCheck, PtrTrack, FALSE);
+}
+
+/**
+  Find a variable in the test variable store by walking the store.
+
+  @param  Name           The name of the variable.
+  @param  Guid           The vendor GUID of the variable.
+  @param  IgnoreRtCheck  Ignore the EFI_VARIABLE_RUNTIME_ACCESS attribute at runtime.
+  @param  PtrTrack       The variable found.
+
+  @return The status of FindVariableEx().
+
+**/
+EFI_STATUS
+VariableTestWalk (
+  IN  CHAR16                  *Name,
+  IN  EFI_GUID                *Guid,
+  IN  BOOLEAN                 IgnoreRtCheck,
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack
+  )
+{
+  VARIABLE_INDEX  Index;
+  EFI_STATUS      Status;
+
+  CopyMem (&Index, &mVariableIndex[VariableStoreTypeVolatile], sizeof (Index));
+  ZeroMem (&mVariableIndex[VariableStoreTypeVolatile], sizeof (Index));
+  Status = VariableTestFind (Name, Guid, IgnoreRtCheck, PtrTrack);
+  CopyMem (&mVariableIndex[VariableStoreTypeVolatile], &Index, sizeof (Index));
+  return Status;
+}
+
+/**
+  Check that a variable is found through the index the way it is found by
+  walking the test variable store.
+
+  @param  Name           The name of the variable.
+  @param  Guid           The vendor GUID of the variable.
+  @param  IgnoreRtCheck  Ignore the EFI_VARIABLE_RUNTIME_ACCESS attribute at runtime.
+  @param  PtrTrack       The variable found.
+
+  @retval TRUE           The index and the walk find the same variables.
+  @retval FALSE          The index and the walk do not agree.
+
+**/
+BOOLEAN
+VariableTestFindLikeWalk (
+  IN  CHAR16                  *Name,
+  IN  EFI_GUID                *Guid,
+  IN  BOOLEAN                 IgnoreRtCheck,
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack
+  )
+{
+  VARIABLE_POINTER_TRACK  Walk;
+  EFI_STATUS              Status;
+
+  Status = VariableTestFind (Name, Guid, IgnoreRtCheck, PtrTrack);
+  if (Status != VariableTestWalk (Name, Guid, IgnoreRtCheck, &Walk)) {
+    return FALSE;
+  }
+  if (PtrTrack->CurrPtr != Walk.CurrPtr) {
+    return FALSE;
+  }
+  if (!EFI_ERROR (Status) && PtrTrack->InDeletedTransitionPtr != Walk.InDeletedTransitionPtr) {
+    return FALSE;
+  }
+  return TRUE;
+}
+
+/**
+  Enumerate the variables of the test variable store the way
+  GetNextVariableName() does.
+
+  @param  Enumeration  How the variable the caller passes back is found.
+  @param  Variables    The variables enumerated, or NULL.
+  @param  MaxCount     The maximum number of variables enumerated.
+
+  @return The number of variables enumerated.
+
+**/
+UINTN
+VariableTestEnumerate (
+  IN  VARIABLE_TEST_ENUMERATION  Enumeration,
+  OUT VARIABLE_HEADER            **Variables  OPTIONAL,
+  IN  UINTN                      MaxCount
+  )
+{
+  VARIABLE_STORE_HEADER  *VariableStoreList[VariableStoreTypeMax];
+  VARIABLE_INDEX         Index;
+  VARIABLE_HEADER        *Variable;
+  CHAR16                 Name[VARIABLE_TEST_NAME_LENGTH];
+  EFI_GUID               Guid;
+  UINTN                  Count;
+
+  ZeroMem (VariableStoreList, sizeof (VariableStoreList));
+  VariableStoreList[VariableStoreTypeVolatile] = mVariableTestStore;
+
+  CopyMem (&Index, &mVariableIndex[VariableStoreTypeVolatile], sizeof (Index));
+  if (Enumeration == VariableTestEnumerateWalk) {
+    ZeroMem (&mVariableIndex[VariableStoreTypeVolatile], sizeof (Index));
+  }
+
+  Name[0] = 0;
+  ZeroMem (&Guid, sizeof (Guid));
+  for (Count = 0; Count < MaxCount; Count++) {
+    if (Enumeration == VariableTestEnumerateIndex) {
+      mVariableIndex[VariableStoreTypeVolatile].CursorOffset = 0;
+    }
+    if (VariableServiceGetNextVariableInternal (Name, &Guid, VariableStoreList, &Variable, FALSE) != EFI_SUCCESS) {
+      break;
+    }
+    if (Variables != NULL) {
+      Variables[Count] = Variable;
+    }
+    CopyMem (Name, GetVariableNamePtr (Variable, FALSE), NameSizeOfVariable (Variable, FALSE));
+    CopyGuid (&Guid, GetVendorGuidPtr (Variable, FALSE));
+  }
+
+  if (Enumeration == VariableTestEnumerateWalk) {
+    CopyMem (&mVariableIndex[VariableStoreTypeVolatile], &Index, sizeof (Index));
+  }
+  return Count;
+}
+
+/**
+  The index should find the variables of a store the way the walk of the store
+  finds them.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IndexShouldFindVariablesLikeTheWalk (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_HEADER         *Variables[VARIABLE_TEST_VARIABLE_COUNT];
+  VARIABLE_POINTER_TRACK  PtrTrack;
+  CHAR16                  Name[VARIABLE_TEST_NAME_LENGTH];
+  UINTN                   Index;
+
+  UT_ASSERT_NOT_EFI_ERROR (VariableTestCreateStore (VARIABLE_TEST_STORE_SIZE));
+
+  //
+  // Every other variable has the name of the previous one, with another
+  // vendor GUID.
+  //
+  for (Index = 0; Index < VARIABLE_TEST_VARIABLE_COUNT; Index++) {
+    VariableTestName (Index / 2, Name);
+    Variables[Index] = VariableTestAddVariable (
+                         Name,
+                         (Index % 2 == 0) ? &mVariableTestGuid : &mVariableTestOtherGuid,
+                         EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+                         (UINT32) Index
+                         );
+  }
+  VariableIndexUpdate (VariableStoreTypeVolatile);
+  UT_ASSERT_EQUAL (mVariableIndex[VariableStoreTypeVolatile].UsedCount, VARIABLE_TEST_VARIABLE_COUNT);
+  UT_ASSERT_FALSE (mVariableIndex[VariableStoreTypeVolatile].Full);
+
+  for (Index = 0; Index < VARIABLE_TEST_VARIABLE_COUNT; Index++) {
+    VariableTestName (Index / 2, Name);
+    UT_ASSERT_TRUE (VariableTestFindLikeWalk (Name, (Index % 2 == 0) ? &mVariableTestGuid : &mVariableTestOtherGuid, FALSE, &PtrTrack));
+    UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) Variables[Index]);
+  }
+
+  //
+  // Variables that are not in the store, with the name of a variable or with
+  // a name that is a prefix of the name of a variable.
+  //
+  VariableTestName (VARIABLE_TEST_VARIABLE_COUNT, Name);
+  UT_ASSERT_TRUE (VariableTestFindLikeWalk (Name, &mVariableTestGuid, FALSE, &PtrTrack));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) NULL);
+  UT_ASSERT_TRUE (VariableTestFindLikeWalk (L"Var00", &mVariableTestGuid, FALSE, &PtrTrack));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) NULL);
+  VariableTestName (0, Name);
+  UT_ASSERT_TRUE (VariableTestFindLikeWalk (Name, &gEfiVariableGuid, FALSE, &PtrTrack));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) NULL);
+
+  VariableTestFreeStore ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The index should find the ADDED and IN_DELETED_TRANSITION variables the
+  way the walk of the store finds them, as variables are updated.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IndexShouldFollowVariableStates (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_HEADER         *Variable;
+  VARIABLE_HEADER         *NewVariable;
+  VARIABLE_POINTER_TRACK  PtrTrack;
+
+  UT_ASSERT_NOT_EFI_ERROR (VariableTestCreateStore (VARIABLE_TEST_STORE_SIZE));
+
+  Variable = VariableTestAddVariable (L"Test", &mVariableTestGuid, EFI_VARIABLE_BOOTSERVICE_ACCESS, 1);
+  VariableIndexUpdate (VariableStoreTypeVolatile);
+  UT_ASSERT_TRUE (VariableTestFindLikeWalk (L"Test", &mVariableTestGuid, FALSE, &PtrTrack));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) Variable);
+
+  //
+  // Update the variable the way UpdateVariable() does.  Before the index is
+  // updated, the variable is found by walking the store.
+  //
+  Variable->State &= VAR_IN_DELETED_TRANSITION;
+  NewVariable = VariableTestAddVariable (L"Test", &mVariableTestGuid, EFI_VARIABLE_BOOTSERVICE_ACCESS, 2);
+  UT_ASSERT_TRUE (VariableTestFindLikeWalk (L"Test", &mVariableTestGuid, FALSE, &PtrTrack));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) NewVariable);
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.InDeletedTransitionPtr, (UINTN) Variable);
+
+  VariableIndexUpdate (VariableStoreTypeVolatile);
+  UT_ASSERT_EQUAL (mVariableIndex[VariableStoreTypeVolatile].UsedCount, 2);
+  UT_ASSERT_TRUE (VariableTestFindLikeWalk (L"Test", &mVariableTestGuid, FALSE, &PtrTrack));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) NewVariable);
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.InDeletedTransitionPtr, (UINTN) Variable);
+
+  //
+  // An IN_DELETED_TRANSITION variable is found without an ADDED one, and
+  // DELETED variables are not found.
+  //
+  NewVariable->State &= VAR_DELETED;
+  UT_ASSERT_TRUE (VariableTestFindLikeWalk (L"Test", &mVariableTestGuid, FALSE, &PtrTrack));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) Variable);
+
+  Variable->State &= VAR_DELETED;
+  UT_ASSERT_TRUE (VariableTestFindLikeWalk (L"Test", &mVariableTestGuid, FALSE, &PtrTrack));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) NULL);
+
+  VariableTestFreeStore ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The index should not find boot services variables at runtime, unless the
+  runtime access check is ignored.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IndexShouldHideBootServicesVariablesAtRuntime (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_HEADER         *Variable;
+  VARIABLE_POINTER_TRACK  PtrTrack;
+
+  UT_ASSERT_NOT_EFI_ERROR (VariableTestCreateStore (VARIABLE_TEST_STORE_SIZE));
+  Variable = VariableTestAddVariable (L"Test", &mVariableTestGuid, EFI_VARIABLE_BOOTSERVICE_ACCESS, 1);
+  VariableIndexUpdate (VariableStoreTypeVolatile);
+
+  mStubAtRuntime = TRUE;
+  UT_ASSERT_TRUE (VariableTestFindLikeWalk (L"Test", &mVariableTestGuid, FALSE, &PtrTrack));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) NULL);
+  UT_ASSERT_TRUE (VariableTestFindLikeWalk (L"Test", &mVariableTestGuid, TRUE, &PtrTrack));
+  UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) Variable);
+  mStubAtRuntime = FALSE;
+
+  VariableTestFreeStore ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Variables should be found by walking the store when the store holds more
+  variables than its index, until the index is rebuilt after a reclaim.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FullIndexShouldFallBackToTheWalk (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_POINTER_TRACK  PtrTrack;
+  CHAR16                  Name[VARIABLE_TEST_NAME_LENGTH];
+  UINTN                   Index;
+  UINTN                   Count;
+
+  UT_ASSERT_NOT_EFI_ERROR (VariableTestCreateStore (VARIABLE_TEST_SMALL_STORE_SIZE));
+  Count = VARIABLE_INDEX_MIN_ENTRY_COUNT - 4;
+  for (Index = 0; Index < Count; Index++) {
+    VariableTestName (Index, Name);
+    VariableTestAddVariable (Name, &mVariableTestGuid, EFI_VARIABLE_BOOTSERVICE_ACCESS, (UINT32) Index);
+  }
+  VariableIndexUpdate (VariableStoreTypeVolatile);
+  UT_ASSERT_TRUE (mVariableIndex[VariableStoreTypeVolatile].Full);
+
+  for (Index = 0; Index < Count; Index++) {
+    VariableTestName (Index, Name);
+    UT_ASSERT_TRUE (VariableTestFindLikeWalk (Name, &mVariableTestGuid, FALSE, &PtrTrack));
+    UT_ASSERT_NOT_NULL (PtrTrack.CurrPtr);
+  }
+
+  //
+  // Reclaim the store, keeping half of the variables.
+  //
+  SetMem (GetStartPointer (mVariableTestStore), (UINTN) GetEndPointer (mVariableTestStore) - (UINTN) GetStartPointer (mVariableTestStore), 0xff);
+  mVariableTestEnd = GetStartPointer (mVariableTestStore);
+  for (Index = 0; Index < Count; Index += 2) {
+    VariableTestName (Index, Name);
+    VariableTestAddVariable (Name, &mVariableTestGuid, EFI_VARIABLE_BOOTSERVICE_ACCESS, (UINT32) Index);
+  }
+  VariableIndexRebuild (VariableStoreTypeVolatile);
+  UT_ASSERT_FALSE (mVariableIndex[VariableStoreTypeVolatile].Full);
+  UT_ASSERT_EQUAL (mVariableIndex[VariableStoreTypeVolatile].UsedCount, Count / 2);
+
+  for (Index = 0; Index < Count; Index++) {
+    VariableTestName (Index, Name);
+    UT_ASSERT_TRUE (VariableTestFindLikeWalk (Name, &mVariableTestGuid, FALSE, &PtrTrack));
+    UT_ASSERT_EQUAL (PtrTrack.CurrPtr != NULL, Index % 2 == 0);
+  }
+
+  VariableTestFreeStore ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The index should load the hash index the PEI variable module built for the
+  store, and index the variables added since, and it should index the store
+  again if the hash index does not fit the store.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IndexShouldLoadThePeiHashIndex (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_HEADER            *Variables[VARIABLE_TEST_VARIABLE_COUNT];
+  VARIABLE_HASH_INDEX        *HashIndex;
+  VARIABLE_HASH_INDEX_ENTRY  *Entries;
+  VARIABLE_INDEX             *Index;
+  VARIABLE_POINTER_TRACK     PtrTrack;
+  CHAR16                     Name[VARIABLE_TEST_NAME_LENGTH];
+  UINTN                      Count;
+  UINT32                     Slot;
+
+  UT_ASSERT_NOT_EFI_ERROR (VariableTestCreateStore (VARIABLE_TEST_STORE_SIZE));
+  Index = &mVariableIndex[VariableStoreTypeVolatile];
+
+  //
+  // The PEI variable module indexes the first half of the variables, in a hash
+  // index smaller than the one of the store.
+  //
+  for (Count = 0; Count < VARIABLE_TEST_VARIABLE_COUNT / 2; Count++) {
+    VariableTestName (Count, Name);
+    Variables[Count] = VariableTestAddVariable (Name, &mVariableTestGuid, EFI_VARIABLE_BOOTSERVICE_ACCESS, (UINT32) Count);
+  }
+  VariableIndexUpdate (VariableStoreTypeVolatile);
+
+  HashIndex = AllocateZeroPool (sizeof (VARIABLE_HASH_INDEX) + Index->EntryCount / 2 * sizeof (VARIABLE_HASH_INDEX_ENTRY));
+  UT_ASSERT_NOT_NULL (HashIndex);
+  Entries = (VARIABLE_HASH_INDEX_ENTRY *) (HashIndex + 1);
+  for (Slot = 0; Slot < Index->EntryCount; Slot++) {
+    if (Index->Entries[Slot].Offset != 0) {
+      Entries[HashIndex->UsedCount++] = Index->Entries[Slot];
+    }
+  }
+  HashIndex->StoreSize     = mVariableTestStore->Size;
+  HashIndex->EntryCount    = Index->EntryCount / 2;
+  HashIndex->IndexedOffset = Index->IndexedOffset;
+  UT_ASSERT_EQUAL (HashIndex->UsedCount, VARIABLE_TEST_VARIABLE_COUNT / 2);
+
+  for (; Count < VARIABLE_TEST_VARIABLE_COUNT; Count++) {
+    VariableTestName (Count, Name);
+    Variables[Count] = VariableTestAddVariable (Name, &mVariableTestGuid, EFI_VARIABLE_BOOTSERVICE_ACCESS, (UINT32) Count);
+  }
+
+  UT_ASSERT_NOT_EFI_ERROR (VariableIndexInitialize (VariableStoreTypeVolatile, mVariableTestStore, FALSE, HashIndex));
+  UT_ASSERT_EQUAL (Index->UsedCount, VARIABLE_TEST_VARIABLE_COUNT);
+  for (Count = 0; Count < VARIABLE_TEST_VARIABLE_COUNT; Count++) {
+    VariableTestName (Count, Name);
+    UT_ASSERT_TRUE (VariableTestFindLikeWalk (Name, &mVariableTestGuid, FALSE, &PtrTrack));
+    UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) Variables[Count]);
+  }
+
+  //
+  // A hash index with an entry that is not a variable header of the store.
+  //
+  Entries[0].Offset += sizeof (UINT32);
+  UT_ASSERT_NOT_EFI_ERROR (VariableIndexInitialize (VariableStoreTypeVolatile, mVariableTestStore, FALSE, HashIndex));
+  UT_ASSERT_EQUAL (Index->UsedCount, VARIABLE_TEST_VARIABLE_COUNT);
+  for (Count = 0; Count < VARIABLE_TEST_VARIABLE_COUNT; Count++) {
+    VariableTestName (Count, Name);
+    UT_ASSERT_TRUE (VariableTestFindLikeWalk (Name, &mVariableTestGuid, FALSE, &PtrTrack));
+    UT_ASSERT_EQUAL ((UINTN) PtrTrack.CurrPtr, (UINTN) Variables[Count]);
+  }
+
+  FreePool (HashIndex);
+  VariableTestFreeStore ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The enumeration of the variables should return the same variables, in the
+  same order, through the index and with the cursor of the enumeration as by
+  walking the store.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+EnumerationShouldReturnVariablesLikeTheWalk (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_HEADER  *Variables[VARIABLE_TEST_VARIABLE_COUNT];
+  VARIABLE_HEADER  *Walked[VARIABLE_TEST_VARIABLE_COUNT];
+  VARIABLE_HEADER  *Enumerated[VARIABLE_TEST_VARIABLE_COUNT];
+  CHAR16           Name[VARIABLE_TEST_NAME_LENGTH];
+  UINTN            Index;
+  UINTN            Count;
+  UINTN            WalkCount;
+
+  UT_ASSERT_NOT_EFI_ERROR (VariableTestCreateStore (VARIABLE_TEST_STORE_SIZE));
+
+  //
+  // Deleted variables, variables in deleted transition with and without an
+  // ADDED copy, and boot services variables.
+  //
+  Count = VARIABLE_TEST_VARIABLE_COUNT - VARIABLE_TEST_VARIABLE_COUNT / 8;
+  for (Index = 0; Index < Count; Index++) {
+    VariableTestName (Index, Name);
+    Variables[Index] = VariableTestAddVariable (
+                         Name,
+                         &mVariableTestGuid,
+                         (Index % 3 == 0) ? EFI_VARIABLE_BOOTSERVICE_ACCESS : EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS,
+                         (UINT32) Index
+                         );
+    if (Index % 5 == 0) {
+      Variables[Index]->State &= VAR_DELETED;
+    } else if (Index % 4 == 0) {
+      Variables[Index]->State &= VAR_IN_DELETED_TRANSITION;
+    }
+  }
+  for (Index = 0; Index < Count; Index += 8) {
+    VariableTestName (Index, Name);
+    VariableTestAddVariable (Name, &mVariableTestGuid, EFI_VARIABLE_BOOTSERVICE_ACCESS, (UINT32) Index);
+  }
+  VariableIndexUpdate (VariableStoreTypeVolatile);
+
+  WalkCount = VariableTestEnumerate (VariableTestEnumerateWalk, Walked, VARIABLE_TEST_VARIABLE_COUNT);
+  UT_ASSERT_NOT_EQUAL (WalkCount, 0);
+  UT_ASSERT_TRUE (WalkCount < Count);
+
+  UT_ASSERT_EQUAL (VariableTestEnumerate (VariableTestEnumerateIndex, Enumerated, VARIABLE_TEST_VARIABLE_COUNT), WalkCount);
+  UT_ASSERT_MEM_EQUAL (Enumerated, Walked, WalkCount * sizeof (VARIABLE_HEADER *));
+  UT_ASSERT_EQUAL (VariableTestEnumerate (VariableTestEnumerateCursor, Enumerated, VARIABLE_TEST_VARIABLE_COUNT), WalkCount);
+  UT_ASSERT_MEM_EQUAL (Enumerated, Walked, WalkCount * sizeof (VARIABLE_HEADER *));
+
+  //
+  // At runtime, the boot services variables are not enumerated.
+  //
+  mStubAtRuntime = TRUE;
+  WalkCount = VariableTestEnumerate (VariableTestEnumerateWalk, Walked, VARIABLE_TEST_VARIABLE_COUNT);
+  UT_ASSERT_EQUAL (VariableTestEnumerate (VariableTestEnumerateCursor, Enumerated, VARIABLE_TEST_VARIABLE_COUNT), WalkCount);
+  UT_ASSERT_MEM_EQUAL (Enumerated, Walked, WalkCount * sizeof (VARIABLE_HEADER *));
+  mStubAtRuntime = FALSE;
+
+  //
+  // The cursor is dropped when the store is rewritten.
+  //
+  UT_ASSERT_NOT_EQUAL (mVariableIndex[VariableStoreTypeVolatile].CursorOffset, 0);
+  VariableIndexRebuild (VariableStoreTypeVolatile);
+  UT_ASSERT_EQUAL (mVariableIndex[VariableStoreTypeVolatile].CursorOffset, 0);
+
+  VariableTestFreeStore ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Report the cost of GetNextVariableName() over a store of 1000 variables,
+  walking the store, through the index, and with the cursor of the
+  enumeration.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+GetNextVariableNameCost (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  STATIC CONST CHAR8         *EnumerationNames[] = { "walk", "index", "cursor" };
+  VARIABLE_TEST_ENUMERATION  Enumeration;
+  CHAR16                     Name[VARIABLE_TEST_NAME_LENGTH];
+  UINTN                      Index;
+  UINT32                     NanoSeconds;
+  clock_t                    Start;
+  clock_t                    End;
+
+  UT_ASSERT_NOT_EFI_ERROR (VariableTestCreateStore (BENCHMARK_STORE_SIZE));
+  for (Index = 0; Index < BENCHMARK_VARIABLE_COUNT; Index++) {
+    VariableTestName (Index, Name);
+    VariableTestAddVariable (Name, &mVariableTestGuid, EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS, (UINT32) Index);
+  }
+  VariableIndexUpdate (VariableStoreTypeVolatile);
+  UT_ASSERT_FALSE (mVariableIndex[VariableStoreTypeVolatile].Full);
+
+  for (Enumeration = VariableTestEnumerateWalk; Enumeration <= VariableTestEnumerateCursor; Enumeration++) {
+    Start = clock ();
+    for (Index = 0; Index < BENCHMARK_ENUMERATION_COUNT; Index++) {
+      UT_ASSERT_EQUAL (VariableTestEnumerate (Enumeration, NULL, MAX_UINTN), BENCHMARK_VARIABLE_COUNT);
+    }
+    End = clock ();
+
+    NanoSeconds = (UINT32)((UINT64)(End - Start) * (1000000000ULL / CLOCKS_PER_SEC) / (BENCHMARK_ENUMERATION_COUNT * BENCHMARK_VARIABLE_COUNT));
+    UT_LOG_INFO ("%d variables, %a: %d ns per GetNextVariableName()\n", BENCHMARK_VARIABLE_COUNT, EnumerationNames[Enumeration], NanoSeconds);
+    DEBUG ((DEBUG_INFO, "%d variables, %a: %d ns per GetNextVariableName()\n", BENCHMARK_VARIABLE_COUNT, EnumerationNames[Enumeration], NanoSeconds));
+  }
+
+  VariableTestFreeStore ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the hash index
+  of the variable stores and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      VariableIndexTests;
+  UNIT_TEST_SUITE_HANDLE      BenchmarkTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&VariableIndexTests, Framework, "Variable Index Tests", "Variable.Index", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for VariableIndexTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (VariableIndexTests, "Index should find variables like the walk", "Find", IndexShouldFindVariablesLikeTheWalk, NULL, NULL, NULL);
+  AddTestCase (VariableIndexTests, "Index should follow variable states", "State", IndexShouldFollowVariableStates, NULL, NULL, NULL);
+  AddTestCase (VariableIndexTests, "Index should hide boot services variables at runtime", "Runtime", IndexShouldHideBootServicesVariablesAtRuntime, NULL, NULL, NULL);
+  AddTestCase (VariableIndexTests, "Full index should fall back to the walk", "Full", FullIndexShouldFallBackToTheWalk, NULL, NULL, NULL);
+  AddTestCase (VariableIndexTests, "Index should load the PEI hash index", "Load", IndexShouldLoadThePeiHashIndex, NULL, NULL, NULL);
+  AddTestCase (VariableIndexTests, "Enumeration should return variables like the walk", "Enumeration", EnumerationShouldReturnVariablesLikeTheWalk, NULL, NULL, NULL);
+
+  Status = CreateUnitTestSuite (&BenchmarkTests, Framework, "Variable Index Benchmarks", "Variable.Index.Benchmark", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BenchmarkTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (BenchmarkTests, "GetNextVariableName cost over 1000 variables", "EnumerationCost", GetNextVariableNameCost, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,29 @@
+/** @file
+  Host based stand-ins for the services that the hash index of the variable
+  stores (VariableIndex.c) and the variable parsing (VariableParsing.c)
+  depend on.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "Variable.h"
+
+//
+// TRUE once the tests simulate ExitBootServices ()
+//
+BOOLEAN     mStubAtRuntime = FALSE;
+
+/**
+  Return TRUE if ExitBootServices () has been called.
+
+  @retval TRUE If ExitBootServices () has been called.
+**/
+BOOLEAN
+AtRuntime (
+  VOID
+  )
+{
+  return mStubAtRuntime;
+}
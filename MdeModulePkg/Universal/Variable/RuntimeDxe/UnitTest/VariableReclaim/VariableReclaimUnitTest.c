@@ -0,0 +1,558 @@
+/** @file
+  Host based unit tests of the reclaim of the non-volatile variable store.
+
+  A test firmware volume holds a variable store whose variables span several
+  erase blocks.  The tests check where a complete and an incremental reclaim
+  start, that the reclaim falls back to a complete one when the erase blocks
+  of the store are not known, that the variables the reclaim keeps in place
+  are counted in the variable total sizes whatever their state, and that the
+  fault tolerant write of the reclaimed store only writes the range that
+  changed.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "VariableParsing.h"
+
+#include <Library/PrintLib.h>
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME        "Variable Reclaim Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Erase blocks of the test firmware volume.  The variable store takes all the
+// blocks but the last one.
+//
+#define VARIABLE_TEST_BLOCK_SIZE      SIZE_4KB
+#define VARIABLE_TEST_BLOCK_COUNT     8
+#define VARIABLE_TEST_FV_SIZE         (VARIABLE_TEST_BLOCK_SIZE * VARIABLE_TEST_BLOCK_COUNT)
+#define VARIABLE_TEST_HEADER_LENGTH   (sizeof (EFI_FIRMWARE_VOLUME_HEADER) + sizeof (EFI_FV_BLOCK_MAP_ENTRY))
+#define VARIABLE_TEST_STORE_SIZE      (VARIABLE_TEST_FV_SIZE - VARIABLE_TEST_BLOCK_SIZE - VARIABLE_TEST_HEADER_LENGTH)
+
+//
+// Size of the data of the test variables, and maximum number of characters of
+// their names
+//
+#define VARIABLE_TEST_DATA_SIZE       0x1F0
+#define VARIABLE_TEST_NAME_LENGTH     16
+
+//
+// Erase block of the dead variables of the test variable store
+//
+#define VARIABLE_TEST_DEAD_BLOCK      5
+
+//
+// Offset of a firmware volume that is not aligned on its erase blocks
+//
+#define VARIABLE_TEST_UNALIGNED_FV    0x200
+
+//
+// Defined by the stand-ins of the services Reclaim.c depends on
+//
+extern EFI_PHYSICAL_ADDRESS  mStubFvBase;
+extern UINTN                 mStubFtwWriteCount;
+extern EFI_LBA               mStubFtwLba;
+extern UINTN                 mStubFtwOffset;
+extern UINTN                 mStubFtwLength;
+
+//
+// Vendor GUID of the test variables
+//
+EFI_GUID              mVariableTestGuid = {
+  0x4c2e9a71, 0x5b3d, 0x4f80, { 0x96, 0x1a, 0xd7, 0x38, 0x0e, 0x5c, 0xb2, 0x64 }
+};
+
+VOID                  *mVariableTestFvBuffer;
+VARIABLE_STORE_HEADER *mVariableTestStore;
+VARIABLE_HEADER       *mVariableTestEnd;
+
+/**
+  Create a test firmware volume with an empty variable store.
+
+  @param  FvOffset     The offset of the firmware volume from an erase block
+                       boundary.
+
+  @retval EFI_SUCCESS           The firmware volume is created.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory.
+
+**/
+EFI_STATUS
+VariableTestCreateFv (
+  IN UINTN  FvOffset
+  )
+{
+  EFI_FIRMWARE_VOLUME_HEADER  *FvHeader;
+
+  mVariableTestFvBuffer = AllocateAlignedPages (
+                            EFI_SIZE_TO_PAGES (VARIABLE_TEST_FV_SIZE + VARIABLE_TEST_BLOCK_SIZE),
+                            VARIABLE_TEST_BLOCK_SIZE
+                            );
+  if (mVariableTestFvBuffer == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  FvHeader = (EFI_FIRMWARE_VOLUME_HEADER *) ((UINT8 *) mVariableTestFvBuffer + FvOffset);
+  SetMem (FvHeader, VARIABLE_TEST_FV_SIZE, 0xff);
+  ZeroMem (FvHeader, VARIABLE_TEST_HEADER_LENGTH);
+  FvHeader->FvLength               = VARIABLE_TEST_FV_SIZE;
+  FvHeader->Signature              = EFI_FVH_SIGNATURE;
+  FvHeader->HeaderLength           = (UINT16) VARIABLE_TEST_HEADER_LENGTH;
+  FvHeader->Revision               = EFI_FVH_REVISION;
+  FvHeader->BlockMap[0].NumBlocks  = VARIABLE_TEST_BLOCK_COUNT;
+  FvHeader->BlockMap[0].Length     = VARIABLE_TEST_BLOCK_SIZE;
+  mStubFvBase = (EFI_PHYSICAL_ADDRESS) (UINTN) FvHeader;
+
+  mNvFvHeaderCache = AllocateCopyPool (VARIABLE_TEST_HEADER_LENGTH, FvHeader);
+  if (mNvFvHeaderCache == NULL) {
+    FreeAlignedPages (mVariableTestFvBuffer, EFI_SIZE_TO_PAGES (VARIABLE_TEST_FV_SIZE + VARIABLE_TEST_BLOCK_SIZE));
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  mVariableTestStore = (VARIABLE_STORE_HEADER *) ((UINT8 *) FvHeader + VARIABLE_TEST_HEADER_LENGTH);
+  CopyGuid (&mVariableTestStore->Signature, &gEfiVariableGuid);
+  mVariableTestStore->Size      = VARIABLE_TEST_STORE_SIZE;
+  mVariableTestStore->Format    = VARIABLE_STORE_FORMATTED;
+  mVariableTestStore->State     = VARIABLE_STORE_HEALTHY;
+  mVariableTestStore->Reserved  = 0;
+  mVariableTestStore->Reserved1 = 0;
+  mVariableTestEnd = GetStartPointer (mVariableTestStore);
+
+  mVariableModuleGlobal->VariableGlobal.AuthFormat = FALSE;
+  return EFI_SUCCESS;
+}
+
+/**
+  Free the test firmware volume.
+
+**/
+VOID
+VariableTestFreeFv (
+  VOID
+  )
+{
+  FreePool (mNvFvHeaderCache);
+  mNvFvHeaderCache = NULL;
+  FreeAlignedPages (mVariableTestFvBuffer, EFI_SIZE_TO_PAGES (VARIABLE_TEST_FV_SIZE + VARIABLE_TEST_BLOCK_SIZE));
+  mVariableTestFvBuffer = NULL;
+  mVariableTestStore    = NULL;
+}
+
+/**
+  Add a variable to the end of the test variable store, the way
+  UpdateVariable() does.
+
+  @param  Index        The number of the variable.
+  @param  Attributes   The attributes of the variable.
+
+  @return The header of the variable, or NULL if the store is full.
+
+**/
+VARIABLE_HEADER *
+VariableTestAddVariable (
+  IN UINTN   Index,
+  IN UINT32  Attributes
+  )
+{
+  VARIABLE_HEADER  *Variable;
+  CHAR16           Name[VARIABLE_TEST_NAME_LENGTH];
+
+  UnicodeSPrint (Name, sizeof (Name), L"Var%04d", Index);
+
+  Variable = mVariableTestEnd;
+  if ((UINTN) GetEndPointer (mVariableTestStore) - (UINTN) Variable <
+      sizeof (VARIABLE_HEADER) + StrSize (Name) + GET_PAD_SIZE (StrSize (Name)) + VARIABLE_TEST_DATA_SIZE) {
+    return NULL;
+  }
+
+  Variable->StartId    = VARIABLE_DATA;
+  Variable->State      = VAR_ADDED;
+  Variable->Reserved   = 0;
+  Variable->Attributes = Attributes;
+  Variable->NameSize   = (UINT32) StrSize (Name);
+  Variable->DataSize   = VARIABLE_TEST_DATA_SIZE;
+  CopyGuid (&Variable->VendorGuid, &mVariableTestGuid);
+  CopyMem (GetVariableNamePtr (Variable, FALSE), Name, Variable->NameSize);
+  SetMem (GetVariableDataPtr (Variable, FALSE), VARIABLE_TEST_DATA_SIZE, (UINT8) Index);
+
+  mVariableTestEnd = GetNextVariablePtr (Variable, FALSE);
+  return Variable;
+}
+
+/**
+  Return the erase block of the test firmware volume that holds the start of
+  a variable.
+
+  @param  Variable     The variable.
+
+  @return The number of the erase block.
+
+**/
+UINTN
+VariableTestBlock (
+  IN VARIABLE_HEADER  *Variable
+  )
+{
+  return (VARIABLE_TEST_HEADER_LENGTH + (UINTN) Variable - (UINTN) mVariableTestStore) / VARIABLE_TEST_BLOCK_SIZE;
+}
+
+/**
+  Return the offset of a variable from the test variable store header.
+
+  @param  Variable     The variable.
+
+  @return The offset of the variable.
+
+**/
+UINTN
+VariableTestOffset (
+  IN VARIABLE_HEADER  *Variable
+  )
+{
+  return (UINTN) Variable - (UINTN) mVariableTestStore;
+}
+
+/**
+  Fill the test variable store.  The second variable is a hardware error
+  record, and the third variable and the variables that start in the erase
+  block VARIABLE_TEST_DEAD_BLOCK are deleted.
+
+  @param  FirstDead    The first variable deleted.
+  @param  FirstDeadInBlock  The first variable deleted in the erase block
+                       VARIABLE_TEST_DEAD_BLOCK.
+  @param  DeadSize     The size of the variables deleted.
+
+  @return The number of variables of the store.
+
+**/
+UINTN
+VariableTestFillStore (
+  OUT VARIABLE_HEADER  **FirstDead,
+  OUT VARIABLE_HEADER  **FirstDeadInBlock,
+  OUT UINTN            *DeadSize
+  )
+{
+  VARIABLE_HEADER  *Variable;
+  UINT32           Attributes;
+  UINTN            Index;
+
+  *FirstDead        = NULL;
+  *FirstDeadInBlock = NULL;
+  *DeadSize         = 0;
+  for (Index = 0; ; Index++) {
+    Attributes = EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS;
+    if (Index == 1) {
+      Attributes |= EFI_VARIABLE_HARDWARE_ERROR_RECORD;
+    }
+    Variable = VariableTestAddVariable (Index, Attributes);
+    if (Variable == NULL) {
+      break;
+    }
+    if (Index == 2 || VariableTestBlock (Variable) == VARIABLE_TEST_DEAD_BLOCK) {
+      Variable->State &= VAR_DELETED;
+      *DeadSize += (UINTN) mVariableTestEnd - (UINTN) Variable;
+      if (*FirstDead == NULL) {
+        *FirstDead = Variable;
+      } else if (*FirstDeadInBlock == NULL) {
+        *FirstDeadInBlock = Variable;
+      }
+    }
+  }
+
+  return Index;
+}
+
+/**
+  Check where a complete and an incremental reclaim of the variable store
+  start, and the dead bytes they see.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IncrementalReclaimShouldStartAtTheBestBlock (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_HEADER  *FirstDead;
+  VARIABLE_HEADER  *FirstDeadInBlock;
+  VARIABLE_HEADER  *Updating;
+  UINTN            ExpectedDeadSize;
+  UINTN            DeadSize;
+  UINTN            Offset;
+
+  UT_ASSERT_NOT_EFI_ERROR (VariableTestCreateFv (0));
+  UT_ASSERT_TRUE (VariableTestFillStore (&FirstDead, &FirstDeadInBlock, &ExpectedDeadSize) > 20);
+  UT_ASSERT_NOT_NULL (FirstDeadInBlock);
+  UT_ASSERT_TRUE (VariableTestBlock (mVariableTestEnd) > VARIABLE_TEST_DEAD_BLOCK);
+
+  //
+  // A complete reclaim starts at the first dead variable.
+  //
+  Offset = GetReclaimStartOffset (mVariableTestStore, NULL, NULL, FALSE, &DeadSize);
+  UT_ASSERT_EQUAL (Offset, VariableTestOffset (FirstDead));
+  UT_ASSERT_EQUAL (DeadSize, ExpectedDeadSize);
+
+  //
+  // An incremental reclaim leaves the dead variable of the first block, and
+  // starts at the block that holds the most dead bytes.
+  //
+  Offset = GetReclaimStartOffset (mVariableTestStore, NULL, NULL, TRUE, &DeadSize);
+  UT_ASSERT_EQUAL (Offset, VariableTestOffset (FirstDeadInBlock));
+  UT_ASSERT_EQUAL (DeadSize, ExpectedDeadSize);
+
+  //
+  // The variable being updated is dead, and has to be reclaimed.
+  //
+  Updating = GetNextVariablePtr (GetNextVariablePtr (FirstDead, FALSE), FALSE);
+  Offset   = GetReclaimStartOffset (mVariableTestStore, Updating, NULL, TRUE, &DeadSize);
+  UT_ASSERT_TRUE (Offset <= VariableTestOffset (Updating));
+  UT_ASSERT_EQUAL (DeadSize, ExpectedDeadSize + (UINTN) GetNextVariablePtr (Updating, FALSE) - (UINTN) Updating);
+
+  VariableTestFreeFv ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that an incremental reclaim is a complete one when the firmware
+  volume has several sizes of erase blocks, or is not aligned on its erase
+  blocks.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IncrementalReclaimShouldFallBackToCompleteReclaim (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_HEADER  *FirstDead;
+  VARIABLE_HEADER  *FirstDeadInBlock;
+  UINTN            ExpectedDeadSize;
+  UINTN            DeadSize;
+  UINTN            Offset;
+
+  //
+  // Two entries in the block map.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (VariableTestCreateFv (0));
+  VariableTestFillStore (&FirstDead, &FirstDeadInBlock, &ExpectedDeadSize);
+  mNvFvHeaderCache->BlockMap[0].NumBlocks = VARIABLE_TEST_BLOCK_COUNT / 2;
+  mNvFvHeaderCache->BlockMap[1].NumBlocks = VARIABLE_TEST_BLOCK_COUNT / 4;
+  mNvFvHeaderCache->BlockMap[1].Length    = VARIABLE_TEST_BLOCK_SIZE * 2;
+  Offset = GetReclaimStartOffset (mVariableTestStore, NULL, NULL, TRUE, &DeadSize);
+  UT_ASSERT_EQUAL (Offset, VariableTestOffset (FirstDead));
+  UT_ASSERT_EQUAL (DeadSize, ExpectedDeadSize);
+
+  //
+  // No erase block size.
+  //
+  mNvFvHeaderCache->BlockMap[0].NumBlocks = 0;
+  mNvFvHeaderCache->BlockMap[0].Length    = 0;
+  Offset = GetReclaimStartOffset (mVariableTestStore, NULL, NULL, TRUE, &DeadSize);
+  UT_ASSERT_EQUAL (Offset, VariableTestOffset (FirstDead));
+  VariableTestFreeFv ();
+
+  //
+  // Firmware volume that does not start on an erase block boundary.
+  //
+  UT_ASSERT_NOT_EFI_ERROR (VariableTestCreateFv (VARIABLE_TEST_UNALIGNED_FV));
+  VariableTestFillStore (&FirstDead, &FirstDeadInBlock, &ExpectedDeadSize);
+  Offset = GetReclaimStartOffset (mVariableTestStore, NULL, NULL, TRUE, &DeadSize);
+  UT_ASSERT_EQUAL (Offset, VariableTestOffset (FirstDead));
+  UT_ASSERT_EQUAL (DeadSize, ExpectedDeadSize);
+  VariableTestFreeFv ();
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that the variables an incremental reclaim keeps in place are counted
+  in the variable total sizes, the dead ones included.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+KeptVariablesShouldCountInTotalSizes (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_HEADER  *FirstDead;
+  VARIABLE_HEADER  *FirstDeadInBlock;
+  VARIABLE_HEADER  *HwErrVariable;
+  VARIABLE_HEADER  *FirstVariable;
+  UINTN            DeadSize;
+  UINTN            HwErrVariableTotalSize;
+  UINTN            CommonVariableTotalSize;
+  UINTN            CommonUserVariableTotalSize;
+  UINTN            HwErrSize;
+
+  UT_ASSERT_NOT_EFI_ERROR (VariableTestCreateFv (0));
+  VariableTestFillStore (&FirstDead, &FirstDeadInBlock, &DeadSize);
+
+  FirstVariable = (VARIABLE_HEADER *) ((UINTN) mVariableTestStore + GetReclaimStartOffset (mVariableTestStore, NULL, NULL, TRUE, &DeadSize));
+  UT_ASSERT_TRUE (FirstVariable > FirstDead);
+
+  HwErrVariable = GetNextVariablePtr (GetStartPointer (mVariableTestStore), FALSE);
+  HwErrSize     = (UINTN) GetNextVariablePtr (HwErrVariable, FALSE) - (UINTN) HwErrVariable;
+
+  //
+  // The sizes are added to the totals passed in.
+  //
+  HwErrVariableTotalSize      = 1;
+  CommonVariableTotalSize     = 2;
+  CommonUserVariableTotalSize = 3;
+  GetVariableTotalSizes (
+    GetStartPointer (mVariableTestStore),
+    FirstVariable,
+    &HwErrVariableTotalSize,
+    &CommonVariableTotalSize,
+    &CommonUserVariableTotalSize
+    );
+  UT_ASSERT_EQUAL (HwErrVariableTotalSize, 1 + HwErrSize);
+  UT_ASSERT_EQUAL (
+    CommonVariableTotalSize,
+    2 + (UINTN) FirstVariable - (UINTN) GetStartPointer (mVariableTestStore) - HwErrSize
+    );
+  UT_ASSERT_EQUAL (CommonUserVariableTotalSize, 3);
+
+  VariableTestFreeFv ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that the fault tolerant write of a reclaimed variable store writes the
+  range that changed, and nothing when nothing changed.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FtwShouldWriteTheChangedRange (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_HEADER        *FirstDead;
+  VARIABLE_HEADER        *FirstDeadInBlock;
+  VARIABLE_STORE_HEADER  *Buffer;
+  UINTN                  DeadSize;
+  UINTN                  Start;
+  UINTN                  End;
+
+  UT_ASSERT_NOT_EFI_ERROR (VariableTestCreateFv (0));
+  VariableTestFillStore (&FirstDead, &FirstDeadInBlock, &DeadSize);
+
+  Buffer = AllocateCopyPool (VARIABLE_TEST_STORE_SIZE, mVariableTestStore);
+  UT_ASSERT_NOT_NULL (Buffer);
+
+  mStubFtwWriteCount = 0;
+  UT_ASSERT_NOT_EFI_ERROR (FtwVariableSpace ((EFI_PHYSICAL_ADDRESS) (UINTN) mVariableTestStore, Buffer));
+  UT_ASSERT_EQUAL (mStubFtwWriteCount, 0);
+
+  //
+  // Drop the dead variables of the erase block VARIABLE_TEST_DEAD_BLOCK.
+  //
+  Start = VariableTestOffset (FirstDeadInBlock);
+  End   = VariableTestOffset (mVariableTestEnd);
+  SetMem ((UINT8 *) Buffer + Start, End - Start, 0xff);
+  UT_ASSERT_NOT_EFI_ERROR (FtwVariableSpace ((EFI_PHYSICAL_ADDRESS) (UINTN) mVariableTestStore, Buffer));
+  UT_ASSERT_EQUAL (mStubFtwWriteCount, 1);
+  UT_ASSERT_EQUAL (mStubFtwLba, (VARIABLE_TEST_HEADER_LENGTH + Start) / VARIABLE_TEST_BLOCK_SIZE);
+  UT_ASSERT_EQUAL (mStubFtwOffset, (VARIABLE_TEST_HEADER_LENGTH + Start) % VARIABLE_TEST_BLOCK_SIZE);
+  UT_ASSERT_TRUE (mStubFtwLength <= End - Start);
+  UT_ASSERT_MEM_EQUAL (mVariableTestStore, Buffer, VARIABLE_TEST_STORE_SIZE);
+
+  FreePool (Buffer);
+  VariableTestFreeFv ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the reclaim of
+  the non-volatile variable store and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      ReclaimTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&ReclaimTests, Framework, "Variable Reclaim Tests", "Variable.Reclaim", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for ReclaimTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (ReclaimTests, "Incremental reclaim should start at the best block", "Incremental", IncrementalReclaimShouldStartAtTheBestBlock, NULL, NULL, NULL);
+  AddTestCase (ReclaimTests, "Incremental reclaim should fall back to a complete reclaim", "Fallback", IncrementalReclaimShouldFallBackToCompleteReclaim, NULL, NULL, NULL);
+  AddTestCase (ReclaimTests, "Kept variables should count in the total sizes", "TotalSize", KeptVariablesShouldCountInTotalSizes, NULL, NULL, NULL);
+  AddTestCase (ReclaimTests, "FTW should write the changed range", "Ftw", FtwShouldWriteTheChangedRange, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
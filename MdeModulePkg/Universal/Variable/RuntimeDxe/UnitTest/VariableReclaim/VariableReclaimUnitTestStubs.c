@@ -0,0 +1,164 @@
+/** @file
+  Host based stand-ins for the services and the globals that the reclaim of
+  the non-volatile variable store (Reclaim.c) depends on.
+
+  The fault tolerant write writes directly to the test firmware volume, and
+  records the last write.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "Variable.h"
+
+VARIABLE_MODULE_GLOBAL      mStubModuleGlobal;
+VARIABLE_MODULE_GLOBAL      *mVariableModuleGlobal = &mStubModuleGlobal;
+EFI_FIRMWARE_VOLUME_HEADER  *mNvFvHeaderCache = NULL;
+
+//
+// Base address of the test firmware volume
+//
+EFI_PHYSICAL_ADDRESS        mStubFvBase;
+
+//
+// Number of fault tolerant writes, and the range of the last one
+//
+UINTN                       mStubFtwWriteCount;
+EFI_LBA                     mStubFtwLba;
+UINTN                       mStubFtwOffset;
+UINTN                       mStubFtwLength;
+
+/**
+  Write the test firmware volume, and record the range written.
+
+  @param[in] This          The fault tolerant write protocol.
+  @param[in] Lba           The logical block address of the target block.
+  @param[in] Offset        The offset within the target block.
+  @param[in] Length        The number of bytes to write.
+  @param[in] PrivateData   Unused.
+  @param[in] FvbHandle     Unused.
+  @param[in] Buffer        The data to write.
+
+  @retval EFI_SUCCESS      The data was written.
+
+**/
+EFI_STATUS
+EFIAPI
+StubFtwWrite (
+  IN EFI_FAULT_TOLERANT_WRITE_PROTOCOL     *This,
+  IN EFI_LBA                               Lba,
+  IN UINTN                                 Offset,
+  IN UINTN                                 Length,
+  IN VOID                                  *PrivateData,
+  IN EFI_HANDLE                            FvbHandle,
+  IN VOID                                  *Buffer
+  )
+{
+  EFI_FIRMWARE_VOLUME_HEADER  *FvHeader;
+
+  FvHeader = (EFI_FIRMWARE_VOLUME_HEADER *) (UINTN) mStubFvBase;
+  ASSERT (Lba * FvHeader->BlockMap[0].Length + Offset + Length <= FvHeader->FvLength);
+  CopyMem ((UINT8 *) FvHeader + Lba * FvHeader->BlockMap[0].Length + Offset, Buffer, Length);
+
+  mStubFtwWriteCount++;
+  mStubFtwLba    = Lba;
+  mStubFtwOffset = Offset;
+  mStubFtwLength = Length;
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the base address of the test firmware volume.
+
+  @param[in]  This      The firmware volume block protocol.
+  @param[out] Address   The base address of the test firmware volume.
+
+  @retval EFI_SUCCESS   The address is returned.
+
+**/
+EFI_STATUS
+EFIAPI
+StubFvbGetPhysicalAddress (
+  IN CONST  EFI_FIRMWARE_VOLUME_BLOCK2_PROTOCOL *This,
+  OUT       EFI_PHYSICAL_ADDRESS                *Address
+  )
+{
+  *Address = mStubFvBase;
+  return EFI_SUCCESS;
+}
+
+EFI_FAULT_TOLERANT_WRITE_PROTOCOL   mStubFtw = { NULL, NULL, StubFtwWrite, NULL, NULL, NULL };
+EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  mStubFvb = { NULL, NULL, StubFvbGetPhysicalAddress };
+
+/**
+  Get the fault tolerant write protocol that writes the test firmware volume.
+
+  @param[out] FtwProtocol   The fault tolerant write protocol.
+
+  @retval EFI_SUCCESS       The protocol is returned.
+
+**/
+EFI_STATUS
+GetFtwProtocol (
+  OUT VOID                                **FtwProtocol
+  )
+{
+  *FtwProtocol = &mStubFtw;
+  return EFI_SUCCESS;
+}
+
+/**
+  Get the firmware volume block protocol of the test firmware volume.
+
+  @param[in]  Address       The address in the test firmware volume.
+  @param[out] FvbHandle     The handle of the firmware volume block protocol.
+  @param[out] FvbProtocol   The firmware volume block protocol.
+
+  @retval EFI_SUCCESS       The firmware volume block protocol is returned.
+
+**/
+EFI_STATUS
+GetFvbInfoByAddress (
+  IN  EFI_PHYSICAL_ADDRESS                Address,
+  OUT EFI_HANDLE                          *FvbHandle OPTIONAL,
+  OUT EFI_FIRMWARE_VOLUME_BLOCK_PROTOCOL  **FvbProtocol OPTIONAL
+  )
+{
+  if (FvbHandle != NULL) {
+    *FvbHandle = (EFI_HANDLE) &mStubFvb;
+  }
+  if (FvbProtocol != NULL) {
+    *FvbProtocol = &mStubFvb;
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Return TRUE if ExitBootServices () has been called.
+
+  @retval FALSE  The tests run before ExitBootServices ().
+**/
+BOOLEAN
+AtRuntime (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+/**
+  Is user variable?
+
+  @param[in] Variable   Pointer to variable header.
+
+  @retval FALSE         The test variables are system variables.
+
+**/
+BOOLEAN
+IsUserVariable (
+  IN VARIABLE_HEADER    *Variable
+  )
+{
+  return FALSE;
+}
@@ -0,0 +1,420 @@
+/** @file
+  Host based unit tests of the journal of the pending updates of the runtime
+  variable caches.
+
+  Ranges are added to the journal of a runtime cache, and the tests check that
+  the journal coalesces the ranges that overlap or are adjacent, that it stays
+  within its size by merging its closest ranges, and that the runtime caches
+  are copies of their variable stores once the pending updates are flushed,
+  after random writes to the stores.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include "VariableRuntimeCache.h"
+
+#include <Library/UnitTestLib.h>
+
+#define UNIT_TEST_APP_NAME        "Variable Runtime Cache Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Size of the test variable stores, and number of random writes to them
+//
+#define VARIABLE_TEST_STORE_SIZE    0x4000
+#define VARIABLE_TEST_WRITE_COUNT   1000
+
+//
+// Maximum length of a random write to a test variable store
+//
+#define VARIABLE_TEST_WRITE_LENGTH  0x80
+
+//
+// The globals of the variable module that VariableRuntimeCache.c uses
+//
+VARIABLE_MODULE_GLOBAL  *mVariableModuleGlobal;
+VARIABLE_STORE_HEADER   *mNvVariableCache;
+
+//
+// The flags the runtime variable caches share with the variable module
+//
+BOOLEAN                 mVariableTestReadLock;
+BOOLEAN                 mVariableTestPendingUpdate;
+BOOLEAN                 mVariableTestHobFlushComplete;
+BOOLEAN                 mVariableTestCacheRewritten;
+
+//
+// State of the pseudo random number generator of the tests
+//
+UINT32                  mVariableTestSeed;
+
+/**
+  Return a pseudo random number.
+
+  @return The next number of the sequence.
+
+**/
+UINT32
+VariableTestRandom (
+  VOID
+  )
+{
+  mVariableTestSeed = mVariableTestSeed * 1103515245 + 12345;
+  return mVariableTestSeed >> 8;
+}
+
+/**
+  Create a test variable store.
+
+  @param  Size         The size of the variable store.
+
+  @return The variable store, or NULL if there is not enough memory.
+
+**/
+VARIABLE_STORE_HEADER *
+VariableTestCreateStore (
+  IN UINT32  Size
+  )
+{
+  VARIABLE_STORE_HEADER  *Store;
+
+  Store = AllocatePool (Size);
+  if (Store == NULL) {
+    return NULL;
+  }
+  SetMem (Store, Size, 0xff);
+  CopyGuid (&Store->Signature, &gEfiVariableGuid);
+  Store->Size      = Size;
+  Store->Format    = VARIABLE_STORE_FORMATTED;
+  Store->State     = VARIABLE_STORE_HEALTHY;
+  Store->Reserved  = 0;
+  Store->Reserved1 = 0;
+  return Store;
+}
+
+/**
+  Create the volatile and the non-volatile test variable stores, and their
+  runtime caches, with the journals of the pending updates empty.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED                    The stores are created.
+  @retval  UNIT_TEST_ERROR_PREREQUISITE_NOT_MET There is not enough memory.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+VariableTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_RUNTIME_CACHE_CONTEXT  *CacheContext;
+
+  mVariableModuleGlobal = AllocateZeroPool (sizeof (*mVariableModuleGlobal));
+  if (mVariableModuleGlobal == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+  mNvVariableCache = VariableTestCreateStore (VARIABLE_TEST_STORE_SIZE);
+  mVariableModuleGlobal->VariableGlobal.VolatileVariableBase = (EFI_PHYSICAL_ADDRESS) (UINTN) VariableTestCreateStore (VARIABLE_TEST_STORE_SIZE);
+
+  CacheContext = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext;
+  CacheContext->VariableRuntimeNvCache.Store       = VariableTestCreateStore (VARIABLE_TEST_STORE_SIZE);
+  CacheContext->VariableRuntimeVolatileCache.Store = VariableTestCreateStore (VARIABLE_TEST_STORE_SIZE);
+  CacheContext->ReadLock                           = &mVariableTestReadLock;
+  CacheContext->PendingUpdate                      = &mVariableTestPendingUpdate;
+  CacheContext->HobFlushComplete                   = &mVariableTestHobFlushComplete;
+  CacheContext->CacheRewritten                     = &mVariableTestCacheRewritten;
+  if (mNvVariableCache == NULL ||
+      mVariableModuleGlobal->VariableGlobal.VolatileVariableBase == 0 ||
+      CacheContext->VariableRuntimeNvCache.Store == NULL ||
+      CacheContext->VariableRuntimeVolatileCache.Store == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+
+  mVariableTestReadLock       = FALSE;
+  mVariableTestPendingUpdate  = FALSE;
+  mVariableTestCacheRewritten = FALSE;
+  mVariableTestSeed           = 1;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free the test variable stores and their runtime caches.
+
+  @param[in]  Context    Unused.
+**/
+VOID
+EFIAPI
+VariableTestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_RUNTIME_CACHE_CONTEXT  *CacheContext;
+
+  CacheContext = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext;
+  FreePool (CacheContext->VariableRuntimeNvCache.Store);
+  FreePool (CacheContext->VariableRuntimeVolatileCache.Store);
+  FreePool ((VOID *) (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase);
+  FreePool (mNvVariableCache);
+  FreePool (mVariableModuleGlobal);
+  mNvVariableCache      = NULL;
+  mVariableModuleGlobal = NULL;
+}
+
+/**
+  The journal should merge the ranges that overlap or are adjacent, and keep
+  the other ones apart, sorted by offset.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+JournalShouldCoalesceAdjacentUpdates (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_RUNTIME_CACHE  *Cache;
+
+  Cache = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache;
+
+  //
+  // A variable header, and its data right after it.
+  //
+  AddRuntimeVariableCachePendingUpdate (Cache, 0x100, 0x20);
+  AddRuntimeVariableCachePendingUpdate (Cache, 0x120, 0x40);
+  UT_ASSERT_EQUAL (Cache->PendingUpdateCount, 1);
+  UT_ASSERT_EQUAL (Cache->PendingUpdates[0].Offset, 0x100);
+  UT_ASSERT_EQUAL (Cache->PendingUpdates[0].Length, 0x60);
+
+  //
+  // The states of two variables before it, and a range within it.
+  //
+  AddRuntimeVariableCachePendingUpdate (Cache, 0x80, 1);
+  AddRuntimeVariableCachePendingUpdate (Cache, 0x40, 1);
+  AddRuntimeVariableCachePendingUpdate (Cache, 0x110, 0x10);
+  UT_ASSERT_EQUAL (Cache->PendingUpdateCount, 3);
+  UT_ASSERT_EQUAL (Cache->PendingUpdates[0].Offset, 0x40);
+  UT_ASSERT_EQUAL (Cache->PendingUpdates[1].Offset, 0x80);
+  UT_ASSERT_EQUAL (Cache->PendingUpdates[2].Offset, 0x100);
+  UT_ASSERT_EQUAL (Cache->PendingUpdates[2].Length, 0x60);
+
+  //
+  // A range that overlaps the last two ranges merges them.
+  //
+  AddRuntimeVariableCachePendingUpdate (Cache, 0x81, 0x80);
+  UT_ASSERT_EQUAL (Cache->PendingUpdateCount, 2);
+  UT_ASSERT_EQUAL (Cache->PendingUpdates[1].Offset, 0x80);
+  UT_ASSERT_EQUAL (Cache->PendingUpdates[1].Length, 0xE0);
+
+  //
+  // An empty range is not pending.
+  //
+  AddRuntimeVariableCachePendingUpdate (Cache, 0x200, 0);
+  UT_ASSERT_EQUAL (Cache->PendingUpdateCount, 2);
+
+  return UNIT_TEST_PASSED;
+}
+
+//
+// Offsets of the ranges that fill the journal
+//
+UINT32  mVariableTestUpdateOffsets[VARIABLE_RUNTIME_CACHE_PENDING_UPDATE_MAX] = {
+  0x100, 0x200, 0x300, 0x330, 0x430, 0x530, 0x630, 0x730
+};
+
+/**
+  The journal should merge its two closest ranges when a new range does not
+  fit, and still cover all the ranges added to it.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FullJournalShouldMergeClosestUpdates (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_RUNTIME_CACHE  *Cache;
+  UINT32                  Index;
+
+  Cache = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache;
+
+  //
+  // Ranges of 0x20 bytes, the third and the fourth ones 0x10 bytes apart.
+  //
+  for (Index = 0; Index < VARIABLE_RUNTIME_CACHE_PENDING_UPDATE_MAX; Index++) {
+    AddRuntimeVariableCachePendingUpdate (Cache, mVariableTestUpdateOffsets[Index], 0x20);
+  }
+  UT_ASSERT_EQUAL (Cache->PendingUpdateCount, VARIABLE_RUNTIME_CACHE_PENDING_UPDATE_MAX);
+
+  AddRuntimeVariableCachePendingUpdate (Cache, 0x2000, 0x20);
+  UT_ASSERT_EQUAL (Cache->PendingUpdateCount, VARIABLE_RUNTIME_CACHE_PENDING_UPDATE_MAX);
+  UT_ASSERT_EQUAL (Cache->PendingUpdates[2].Offset, 0x300);
+  UT_ASSERT_EQUAL (Cache->PendingUpdates[2].Length, 0x50);
+  UT_ASSERT_EQUAL (Cache->PendingUpdates[VARIABLE_RUNTIME_CACHE_PENDING_UPDATE_MAX - 1].Offset, 0x2000);
+
+  //
+  // A new range in the gap the merge covers is already pending.
+  //
+  AddRuntimeVariableCachePendingUpdate (Cache, 0x320, 0x10);
+  UT_ASSERT_EQUAL (Cache->PendingUpdateCount, VARIABLE_RUNTIME_CACHE_PENDING_UPDATE_MAX);
+  UT_ASSERT_EQUAL (Cache->PendingUpdates[2].Offset, 0x300);
+  UT_ASSERT_EQUAL (Cache->PendingUpdates[2].Length, 0x50);
+
+  for (Index = 0; Index + 1 < Cache->PendingUpdateCount; Index++) {
+    UT_ASSERT_TRUE (Cache->PendingUpdates[Index].Offset + Cache->PendingUpdates[Index].Length < Cache->PendingUpdates[Index + 1].Offset);
+  }
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  The runtime caches should be copies of their variable stores once the
+  pending updates of random writes to the stores are flushed, and only a
+  pending update from the start of a store should rewrite its cache.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FlushShouldCopyPendingUpdates (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  VARIABLE_RUNTIME_CACHE_CONTEXT  *CacheContext;
+  VARIABLE_STORE_HEADER           *VolatileStore;
+  VARIABLE_RUNTIME_CACHE          *Cache;
+  VARIABLE_STORE_HEADER           *Store;
+  UINT32                          Index;
+  UINT32                          Offset;
+  UINT32                          Length;
+
+  CacheContext  = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext;
+  VolatileStore = (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase;
+
+  for (Index = 0; Index < VARIABLE_TEST_WRITE_COUNT; Index++) {
+    //
+    // The runtime caches are read most of the time, so most writes stay pending.
+    //
+    mVariableTestReadLock = (BOOLEAN) (VariableTestRandom () % 8 != 0);
+
+    if (VariableTestRandom () % 2 == 0) {
+      Cache = &CacheContext->VariableRuntimeNvCache;
+      Store = mNvVariableCache;
+    } else {
+      Cache = &CacheContext->VariableRuntimeVolatileCache;
+      Store = VolatileStore;
+    }
+    Offset = sizeof (VARIABLE_STORE_HEADER) + VariableTestRandom () % (VARIABLE_TEST_STORE_SIZE - sizeof (VARIABLE_STORE_HEADER) - VARIABLE_TEST_WRITE_LENGTH);
+    Length = 1 + VariableTestRandom () % VARIABLE_TEST_WRITE_LENGTH;
+    SetMem ((UINT8 *) Store + Offset, Length, (UINT8) VariableTestRandom ());
+
+    UT_ASSERT_NOT_EFI_ERROR (SynchronizeRuntimeVariableCache (Cache, Offset, Length));
+    UT_ASSERT_TRUE (CacheContext->VariableRuntimeNvCache.PendingUpdateCount <= VARIABLE_RUNTIME_CACHE_PENDING_UPDATE_MAX);
+    UT_ASSERT_TRUE (CacheContext->VariableRuntimeVolatileCache.PendingUpdateCount <= VARIABLE_RUNTIME_CACHE_PENDING_UPDATE_MAX);
+  }
+
+  mVariableTestReadLock = FALSE;
+  UT_ASSERT_NOT_EFI_ERROR (FlushPendingRuntimeVariableCacheUpdates ());
+  UT_ASSERT_FALSE (mVariableTestPendingUpdate);
+  UT_ASSERT_FALSE (mVariableTestCacheRewritten);
+  UT_ASSERT_EQUAL (CacheContext->VariableRuntimeNvCache.PendingUpdateCount, 0);
+  UT_ASSERT_EQUAL (CacheContext->VariableRuntimeVolatileCache.PendingUpdateCount, 0);
+  UT_ASSERT_MEM_EQUAL (CacheContext->VariableRuntimeNvCache.Store, mNvVariableCache, VARIABLE_TEST_STORE_SIZE);
+  UT_ASSERT_MEM_EQUAL (CacheContext->VariableRuntimeVolatileCache.Store, VolatileStore, VARIABLE_TEST_STORE_SIZE);
+
+  //
+  // A reclaim rewrites the store from its start.
+  //
+  SetMem (mNvVariableCache + 1, VARIABLE_TEST_STORE_SIZE - sizeof (VARIABLE_STORE_HEADER), 0xff);
+  UT_ASSERT_NOT_EFI_ERROR (SynchronizeRuntimeVariableCache (&CacheContext->VariableRuntimeNvCache, 0, VARIABLE_TEST_STORE_SIZE));
+  UT_ASSERT_TRUE (mVariableTestCacheRewritten);
+  UT_ASSERT_MEM_EQUAL (CacheContext->VariableRuntimeNvCache.Store, mNvVariableCache, VARIABLE_TEST_STORE_SIZE);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the journal
+  of the pending updates of the runtime variable caches, and run the unit
+  tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      RuntimeCacheTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&RuntimeCacheTests, Framework, "Variable Runtime Cache Tests", "Variable.RuntimeCache", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for RuntimeCacheTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (RuntimeCacheTests, "Journal should coalesce adjacent updates", "Coalesce", JournalShouldCoalesceAdjacentUpdates, VariableTestSetup, VariableTestCleanup, NULL);
+  AddTestCase (RuntimeCacheTests, "Full journal should merge the closest updates", "Full", FullJournalShouldMergeClosestUpdates, VariableTestSetup, VariableTestCleanup, NULL);
+  AddTestCase (RuntimeCacheTests, "Flush should copy the pending updates", "Flush", FlushShouldCopyPendingUpdates, VariableTestSetup, VariableTestCleanup, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
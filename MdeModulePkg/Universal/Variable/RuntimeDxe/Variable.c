@@ -26,6 +26,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include "VariableNonVolatile.h"
 #include "VariableParsing.h"
 #include "VariableRuntimeCache.h"
+#include "VariableIndex.h"
 
 VARIABLE_MODULE_GLOBAL  *mVariableModuleGlobal;
 
@@ -254,6 +255,43 @@ UpdateVariableStore (
   return EFI_SUCCESS;
 }
 
+/**
+  Synchronize a range of a variable store with the runtime cache of the store.
+
+  Only the range is copied to the runtime cache, so the runtime cache is kept in sync
+  with the few bytes an update of a variable changes, rather than with the whole store.
+  A range that is not in the variable store is ignored.
+
+  @param[in] VariableRuntimeCache  The runtime cache of the variable store.
+  @param[in] VariableStoreHeader   The variable store.
+  @param[in] Buffer                The start of the range in the variable store.
+  @param[in] Length                The length in bytes of the range.
+
+**/
+VOID
+SynchronizeRuntimeVariableCacheRange (
+  IN VARIABLE_RUNTIME_CACHE     *VariableRuntimeCache,
+  IN VARIABLE_STORE_HEADER      *VariableStoreHeader,
+  IN VOID                       *Buffer,
+  IN UINTN                      Length
+  )
+{
+  EFI_STATUS                    Status;
+
+  if (VariableRuntimeCache->Store == NULL ||
+      (UINTN) Buffer < (UINTN) VariableStoreHeader ||
+      (UINTN) Buffer - (UINTN) VariableStoreHeader + Length > VariableStoreHeader->Size) {
+    return;
+  }
+
+  Status = SynchronizeRuntimeVariableCache (
+             VariableRuntimeCache,
+             (UINTN) Buffer - (UINTN) VariableStoreHeader,
+             Length
+             );
+  ASSERT_EFI_ERROR (Status);
+}
+
 /**
   Record variable error flag.
 
@@ -333,12 +371,12 @@ RecordVarErrorFlag (
       // Update the data in NV cache.
       //
       *VarErrFlag = TempFlag;
-      Status =  SynchronizeRuntimeVariableCache (
-                  &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache,
-                  0,
-                  mNvVariableCache->Size
-                  );
-      ASSERT_EFI_ERROR (Status);
+      SynchronizeRuntimeVariableCacheRange (
+        &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache,
+        mNvVariableCache,
+        VarErrFlag,
+        sizeof (TempFlag)
+        );
     }
   }
 }
@@ -397,17 +435,19 @@ InitializeVarErrorFlag (
 }
 
 /**
-  Is user variable?
+  Is the variable with the name and vendor GUID a user variable?
 
-  @param[in] Variable   Pointer to variable header.
+  @param[in] VariableName   Name of the variable.
+  @param[in] VendorGuid     Vendor GUID of the variable.
 
   @retval TRUE          User variable.
   @retval FALSE         System variable.
 
 **/
 BOOLEAN
-IsUserVariable (
-  IN VARIABLE_HEADER    *Variable
+IsUserVariableName (
+  IN CHAR16             *VariableName,
+  IN EFI_GUID           *VendorGuid
   )
 {
   VAR_CHECK_VARIABLE_PROPERTY   Property;
@@ -418,17 +458,33 @@ IsUserVariable (
   // then no need to check if the variable is user variable or not specially.
   //
   if (mEndOfDxe && (mVariableModuleGlobal->CommonMaxUserVariableSpace != mVariableModuleGlobal->CommonVariableSpace)) {
-    if (VarCheckLibVariablePropertyGet (
-          GetVariableNamePtr (Variable, mVariableModuleGlobal->VariableGlobal.AuthFormat),
-          GetVendorGuidPtr (Variable, mVariableModuleGlobal->VariableGlobal.AuthFormat),
-          &Property
-          ) == EFI_NOT_FOUND) {
+    if (VarCheckLibVariablePropertyGet (VariableName, VendorGuid, &Property) == EFI_NOT_FOUND) {
       return TRUE;
     }
   }
   return FALSE;
 }
 
+/**
+  Is user variable?
+
+  @param[in] Variable   Pointer to variable header.
+
+  @retval TRUE          User variable.
+  @retval FALSE         System variable.
+
+**/
+BOOLEAN
+IsUserVariable (
+  IN VARIABLE_HEADER    *Variable
+  )
+{
+  return IsUserVariableName (
+           GetVariableNamePtr (Variable, mVariableModuleGlobal->VariableGlobal.AuthFormat),
+           GetVendorGuidPtr (Variable, mVariableModuleGlobal->VariableGlobal.AuthFormat)
+           );
+}
+
 /**
   Calculate common user variable total size.
 
@@ -499,6 +555,9 @@ InitializeVariableQuota (
   @param[in, out] UpdatingPtrTrack        Pointer to updating variable pointer track structure.
   @param[in]      NewVariable             Pointer to new variable.
   @param[in]      NewVariableSize         New variable size.
+  @param[in]      Incremental             TRUE to only reclaim the erase blocks of the
+                                          non-volatile variable store that hold the most
+                                          dead bytes; FALSE to reclaim all the dead bytes.
 
   @return EFI_SUCCESS                  Reclaim operation has finished successfully.
   @return EFI_OUT_OF_RESOURCES         No enough memory resources or variable space.
@@ -512,10 +571,12 @@ Reclaim (
   IN     BOOLEAN                      IsVolatile,
   IN OUT VARIABLE_POINTER_TRACK       *UpdatingPtrTrack,
   IN     VARIABLE_HEADER              *NewVariable,
-  IN     UINTN                        NewVariableSize
+  IN     UINTN                        NewVariableSize,
+  IN     BOOLEAN                      Incremental
   )
 {
   VARIABLE_HEADER       *Variable;
+  VARIABLE_HEADER       *FirstVariable;
   VARIABLE_HEADER       *AddedVariable;
   VARIABLE_HEADER       *NextVariable;
   VARIABLE_HEADER       *NextAddedVariable;
@@ -524,6 +585,7 @@ Reclaim (
   UINTN                 MaximumBufferSize;
   UINTN                 VariableSize;
   UINTN                 NameSize;
+  UINTN                 DeadSize;
   UINT8                 *CurrPtr;
   VOID                  *Point0;
   VOID                  *Point1;
@@ -545,6 +607,7 @@ Reclaim (
   }
 
   VariableStoreHeader = (VARIABLE_STORE_HEADER *) ((UINTN) VariableBase);
+  FirstVariable       = GetStartPointer (VariableStoreHeader);
 
   CommonVariableTotalSize = 0;
   CommonUserVariableTotalSize = 0;
@@ -593,6 +656,18 @@ Reclaim (
     //
     MaximumBufferSize = mNvVariableCache->Size;
     ValidBuffer = (UINT8 *) mNvVariableCache;
+
+    //
+    // The variables before the first one reclaimed are kept in place, so that
+    // the erase blocks they occupy are not written.
+    //
+    FirstVariable = (VARIABLE_HEADER *) ((UINTN) VariableBase + GetReclaimStartOffset (
+                                                                  VariableStoreHeader,
+                                                                  UpdatingVariable,
+                                                                  UpdatingInDeletedTransition,
+                                                                  Incremental,
+                                                                  &DeadSize
+                                                                  ));
   }
 
   SetMem (ValidBuffer, MaximumBufferSize, 0xff);
@@ -603,10 +678,25 @@ Reclaim (
   CopyMem (ValidBuffer, VariableStoreHeader, sizeof (VARIABLE_STORE_HEADER));
   CurrPtr = (UINT8 *) GetStartPointer ((VARIABLE_STORE_HEADER *) ValidBuffer);
 
+  //
+  // Keep the variables before the first one reclaimed, whatever their state.
+  //
+  Variable     = GetStartPointer (VariableStoreHeader);
+  VariableSize = (UINTN) FirstVariable - (UINTN) Variable;
+  CopyMem (CurrPtr, (UINT8 *) Variable, VariableSize);
+  CurrPtr += VariableSize;
+  GetVariableTotalSizes (
+    Variable,
+    FirstVariable,
+    &HwErrVariableTotalSize,
+    &CommonVariableTotalSize,
+    &CommonUserVariableTotalSize
+    );
+
   //
   // Reinstall all ADDED variables as long as they are not identical to Updating Variable.
   //
-  Variable = GetStartPointer (VariableStoreHeader);
+  Variable = FirstVariable;
   while (IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))) {
     NextVariable = GetNextVariablePtr (Variable, AuthFormat);
     if (Variable != UpdatingVariable && Variable->State == VAR_ADDED) {
@@ -628,7 +718,7 @@ Reclaim (
   //
   // Reinstall all in delete transition variables.
   //
-  Variable = GetStartPointer (VariableStoreHeader);
+  Variable = FirstVariable;
   while (IsValidVariableHeader (Variable, GetEndPointer (VariableStoreHeader))) {
     NextVariable = GetNextVariablePtr (Variable, AuthFormat);
     if (Variable != UpdatingVariable && Variable != UpdatingInDeletedTransition && Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
@@ -644,7 +734,7 @@ Reclaim (
       while (IsValidVariableHeader (AddedVariable, GetEndPointer ((VARIABLE_STORE_HEADER *) ValidBuffer))) {
         NextAddedVariable = GetNextVariablePtr (AddedVariable, AuthFormat);
         NameSize = NameSizeOfVariable (AddedVariable, AuthFormat);
-        if (CompareGuid (
+        if (AddedVariable->State == VAR_ADDED && CompareGuid (
               GetVendorGuidPtr (AddedVariable, AuthFormat),
               GetVendorGuidPtr (Variable, AuthFormat)
             ) && NameSize == NameSizeOfVariable (Variable, AuthFormat)) {
@@ -793,6 +883,11 @@ Done:
     ASSERT_EFI_ERROR (Status);
   }
 
+  //
+  // The variables were moved, index them again.
+  //
+  VariableIndexRebuild (IsVolatile ? VariableStoreTypeVolatile : VariableStoreTypeNv);
+
   return Status;
 }
 
@@ -1634,6 +1729,8 @@ UpdateVariable (
   VARIABLE_POINTER_TRACK              NvVariable;
   VARIABLE_STORE_HEADER               *VariableStoreHeader;
   VARIABLE_RUNTIME_CACHE              *VolatileCacheInstance;
+  UINTN                               NewVariableOffset;
+  UINTN                               NewVariableSize;
   UINT8                               *BufferForMerge;
   UINTN                               MergedBufSize;
   BOOLEAN                             DataReady;
@@ -1664,6 +1761,8 @@ UpdateVariable (
   }
 
   AuthFormat = mVariableModuleGlobal->VariableGlobal.AuthFormat;
+  NewVariableOffset = 0;
+  NewVariableSize   = 0;
 
   //
   // Check if CacheVariable points to the variable in variable HOB.
@@ -2057,7 +2156,8 @@ UpdateVariable (
                  FALSE,
                  Variable,
                  NextVariable,
-                 HEADER_ALIGN (VarSize)
+                 HEADER_ALIGN (VarSize),
+                 FALSE
                  );
       if (!EFI_ERROR (Status)) {
         //
@@ -2180,7 +2280,10 @@ UpdateVariable (
       }
     }
 
+    NewVariableOffset = mVariableModuleGlobal->NonVolatileLastVariableOffset;
+    NewVariableSize   = VarSize;
     mVariableModuleGlobal->NonVolatileLastVariableOffset += HEADER_ALIGN (VarSize);
+    VariableIndexUpdate (VariableStoreTypeNv);
 
     if ((Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) != 0) {
       mVariableModuleGlobal->HwErrVariableTotalSize += HEADER_ALIGN (VarSize);
@@ -2207,7 +2310,8 @@ UpdateVariable (
                  TRUE,
                  Variable,
                  NextVariable,
-                 HEADER_ALIGN (VarSize)
+                 HEADER_ALIGN (VarSize),
+                 FALSE
                  );
       if (!EFI_ERROR (Status)) {
         //
@@ -2237,7 +2341,10 @@ UpdateVariable (
       goto Done;
     }
 
+    NewVariableOffset = mVariableModuleGlobal->VolatileLastVariableOffset;
+    NewVariableSize   = VarSize;
     mVariableModuleGlobal->VolatileLastVariableOffset += HEADER_ALIGN (VarSize);
+    VariableIndexUpdate (VariableStoreTypeVolatile);
   }
 
   //
@@ -2295,20 +2402,43 @@ UpdateVariable (
   }
 
 Done:
-  if (!EFI_ERROR (Status)) {
-    if ((Variable->CurrPtr != NULL && !Variable->Volatile) || (Attributes & EFI_VARIABLE_NON_VOLATILE) != 0) {
-      VolatileCacheInstance = &(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache);
-    } else {
-      VolatileCacheInstance = &(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeVolatileCache);
-    }
+  if ((Variable->CurrPtr != NULL && !Variable->Volatile) || (Attributes & EFI_VARIABLE_NON_VOLATILE) != 0) {
+    VolatileCacheInstance = &(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeNvCache);
+    VariableStoreHeader   = mNvVariableCache;
+  } else {
+    VolatileCacheInstance = &(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.VariableRuntimeVolatileCache);
+    VariableStoreHeader   = (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase;
+  }
 
-    if (VolatileCacheInstance->Store != NULL) {
-      Status =  SynchronizeRuntimeVariableCache (
-                  VolatileCacheInstance,
-                  0,
-                  VolatileCacheInstance->Store->Size
-                  );
-      ASSERT_EFI_ERROR (Status);
+  //
+  // Only the states of the existing variable and the variable added to the end of the
+  // store changed, even if the update failed part way.  A reclaim synchronizes the
+  // whole store itself.
+  //
+  if (VolatileCacheInstance->Store != NULL) {
+    if (CacheVariable->CurrPtr != NULL) {
+      SynchronizeRuntimeVariableCacheRange (
+        VolatileCacheInstance,
+        VariableStoreHeader,
+        &CacheVariable->CurrPtr->State,
+        sizeof (CacheVariable->CurrPtr->State)
+        );
+    }
+    if (CacheVariable->InDeletedTransitionPtr != NULL) {
+      SynchronizeRuntimeVariableCacheRange (
+        VolatileCacheInstance,
+        VariableStoreHeader,
+        &CacheVariable->InDeletedTransitionPtr->State,
+        sizeof (CacheVariable->InDeletedTransitionPtr->State)
+        );
+    }
+    if (NewVariableSize > 0) {
+      SynchronizeRuntimeVariableCacheRange (
+        VolatileCacheInstance,
+        VariableStoreHeader,
+        (UINT8 *) VariableStoreHeader + NewVariableOffset,
+        NewVariableSize
+        );
     }
   }
 
@@ -2535,6 +2665,56 @@ VariableServiceSetVariable (
   IN UINTN                   DataSize,
   IN VOID                    *Data
   )
+{
+  EFI_STATUS                          Status;
+
+  Status = VariableServiceSetVariableInternal (VariableName, VendorGuid, Attributes, DataSize, Data, FALSE);
+
+  if (!AtRuntime ()) {
+    if (!EFI_ERROR (Status)) {
+      SecureBootHook (
+        VariableName,
+        VendorGuid
+        );
+    }
+  }
+
+  return Status;
+}
+
+/**
+
+  This code sets variable in storage blocks (Volatile or Non-Volatile), like
+  VariableServiceSetVariable(), without measuring the secure boot variables.
+
+  Caution: This function may receive untrusted input.
+  This function may be invoked in SMM mode, and datasize and data are external input.
+  This function will do basic validation, before parse the data.
+
+  @param VariableName                     Name of Variable to be found.
+  @param VendorGuid                       Variable vendor GUID.
+  @param Attributes                       Attribute value of the variable found
+  @param DataSize                         Size of Data found. If size is less than the
+                                          data, this value contains the required size.
+  @param Data                             Data pointer.
+  @param LockHeld                         TRUE if the caller holds the variable services lock.
+
+  @return EFI_INVALID_PARAMETER           Invalid parameter.
+  @return EFI_SUCCESS                     Set successfully.
+  @return EFI_OUT_OF_RESOURCES            Resource not enough to set variable.
+  @return EFI_NOT_FOUND                   Not found.
+  @return EFI_WRITE_PROTECTED             Variable is read-only.
+
+**/
+EFI_STATUS
+VariableServiceSetVariableInternal (
+  IN CHAR16                  *VariableName,
+  IN EFI_GUID                *VendorGuid,
+  IN UINT32                  Attributes,
+  IN UINTN                   DataSize,
+  IN VOID                    *Data,
+  IN BOOLEAN                 LockHeld
+  )
 {
   VARIABLE_POINTER_TRACK              Variable;
   EFI_STATUS                          Status;
@@ -2720,7 +2900,9 @@ VariableServiceSetVariable (
     return Status;
   }
 
-  AcquireLockOnlyAtBootTime(&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+  if (!LockHeld) {
+    AcquireLockOnlyAtBootTime(&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+  }
 
   //
   // Consider reentrant in MCA/INIT/NMI. It needs be reupdated.
@@ -2780,14 +2962,216 @@ VariableServiceSetVariable (
 
 Done:
   InterlockedDecrement (&mVariableModuleGlobal->VariableGlobal.ReentrantState);
+  if (!LockHeld) {
+    ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+  }
+
+  return Status;
+}
+
+/**
+  Reserve the space the non-volatile variables of a batch need in the non-volatile
+  variable store, so the variables of the batch are set without reclaiming the store
+  between them.  The store is reclaimed once if it is short of space.
+
+  The space a variable of the batch needs is an upper bound of the size of the variable
+  it writes: the size of a variable holding the data of the batch, with the data of the
+  current variable for an append, and 0 for a deletion or for an update that leaves the
+  data of the current variable unchanged.
+
+  Caution: This function must be called with the variable services lock held.
+
+  @param[in] VariableCount      The number of variables in Variables.
+  @param[in] Variables          The variables of the batch.
+
+  @retval EFI_SUCCESS           There is enough space in the variable store for the batch.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough space in the variable store for the batch.
+
+**/
+EFI_STATUS
+ReserveVariableBatchSpace (
+  IN UINTN                          VariableCount,
+  IN EDKII_VARIABLE_BATCH_ENTRY     *Variables
+  )
+{
+  EFI_STATUS                        Status;
+  EDKII_VARIABLE_BATCH_ENTRY        *Entry;
+  VARIABLE_POINTER_TRACK            Variable;
+  BOOLEAN                           AuthFormat;
+  BOOLEAN                           Reclaimed;
+  UINTN                             Index;
+  UINTN                             NameSize;
+  UINTN                             DataSize;
+  UINT64                            VarSize;
+  UINT64                            HwErrSize;
+  UINT64                            CommonSize;
+  UINT64                            CommonUserSize;
+
+  AuthFormat     = mVariableModuleGlobal->VariableGlobal.AuthFormat;
+  HwErrSize      = 0;
+  CommonSize     = 0;
+  CommonUserSize = 0;
+
+  for (Index = 0; Index < VariableCount; Index++) {
+    Entry = &Variables[Index];
+    if (((Entry->Attributes & EFI_VARIABLE_NON_VOLATILE) == 0) ||
+        ((Entry->Attributes & (EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS)) == 0) ||
+        ((Entry->DataSize == 0) && ((Entry->Attributes & EFI_VARIABLE_APPEND_WRITE) == 0))) {
+      //
+      // A volatile variable, or the deletion of a variable.
+      //
+      continue;
+    }
+
+    NameSize = StrSize (Entry->VariableName);
+    DataSize = Entry->DataSize;
+    Status   = FindVariable (Entry->VariableName, Entry->VendorGuid, &Variable, &mVariableModuleGlobal->VariableGlobal, FALSE);
+    if (!EFI_ERROR (Status) && !Variable.Volatile) {
+      if ((Entry->Attributes & EFI_VARIABLE_APPEND_WRITE) != 0) {
+        DataSize += DataSizeOfVariable (Variable.CurrPtr, AuthFormat);
+      } else if (((Entry->Attributes & VARIABLE_ATTRIBUTE_AT_AW) == 0) &&
+                 (DataSizeOfVariable (Variable.CurrPtr, AuthFormat) == DataSize) &&
+                 (CompareMem (GetVariableDataPtr (Variable.CurrPtr, AuthFormat), Entry->Data, DataSize) == 0)) {
+        //
+        // The variable is updated with the data it holds, nothing is written.
+        //
+        continue;
+      }
+    }
+
+    VarSize = ALIGN_VALUE (
+                (UINT64) GetVariableHeaderSize (AuthFormat) + NameSize + GET_PAD_SIZE (NameSize) + DataSize + GET_PAD_SIZE (DataSize),
+                HEADER_ALIGNMENT
+                );
+    if ((Entry->Attributes & EFI_VARIABLE_HARDWARE_ERROR_RECORD) != 0) {
+      HwErrSize += VarSize;
+    } else {
+      CommonSize += VarSize;
+      if (IsUserVariableName (Entry->VariableName, Entry->VendorGuid)) {
+        CommonUserSize += VarSize;
+      }
+    }
+  }
+
+  Reclaimed = FALSE;
+  while ((HwErrSize + mVariableModuleGlobal->HwErrVariableTotalSize > PcdGet32 (PcdHwErrStorageSize)) ||
+         (CommonSize + mVariableModuleGlobal->CommonVariableTotalSize > mVariableModuleGlobal->CommonVariableSpace) ||
+         (AtRuntime () && (CommonSize + mVariableModuleGlobal->CommonVariableTotalSize > mVariableModuleGlobal->CommonRuntimeVariableSpace)) ||
+         (CommonUserSize + mVariableModuleGlobal->CommonUserVariableTotalSize > mVariableModuleGlobal->CommonMaxUserVariableSpace)) {
+    if (Reclaimed || AtRuntime ()) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+
+    //
+    // Perform garbage collection & reclaim operation once for the whole batch.
+    //
+    Status = Reclaim (
+               mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase,
+               &mVariableModuleGlobal->NonVolatileLastVariableOffset,
+               FALSE,
+               NULL,
+               NULL,
+               0,
+               FALSE
+               );
+    if (EFI_ERROR (Status)) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    Reclaimed = TRUE;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  Set a batch of variables.
+
+  The variables are set in order like VariableServiceSetVariable(), until all of them
+  are set or one of them fails.  Before any variable is set, the parameters of the
+  variables are checked, and the space the non-volatile variables of the batch need is
+  reserved in the non-volatile variable store.  The variable services lock is held from
+  the reservation to the last variable, so no other update takes the space reserved.
+  The updates of the batch are copied to the runtime variable caches once, after the
+  last variable.
+
+  Caution: This function may receive untrusted input.
+  This function may be invoked in SMM mode, and the variables are external input.
+  The variables are validated like VariableServiceSetVariable() before they are set.
+
+  @param[in]      VariableCount  The number of variables in Variables.
+  @param[in, out] Variables      The variables to set.  Returns the status of each
+                                 variable in its Status field.
+
+  @retval EFI_SUCCESS            All the variables were set.
+  @retval EFI_INVALID_PARAMETER  Variables is NULL and VariableCount is not 0, or the
+                                 parameters of a variable are invalid.  No variable
+                                 was set.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough space in the variable store for
+                                 the non-volatile variables of the batch.  No variable
+                                 was set.
+  @retval Others                 The variable whose Status is not EFI_SUCCESS nor
+                                 EFI_NOT_STARTED failed with this status.  The
+                                 variables before it were set.
+
+**/
+EFI_STATUS
+VariableServiceSetVariableBatch (
+  IN     UINTN                          VariableCount,
+  IN OUT EDKII_VARIABLE_BATCH_ENTRY     *Variables
+  )
+{
+  EFI_STATUS                            Status;
+  UINTN                                 Index;
+
+  if (VariableCount == 0) {
+    return EFI_SUCCESS;
+  }
+  if (Variables == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  for (Index = 0; Index < VariableCount; Index++) {
+    Variables[Index].Status = EFI_NOT_STARTED;
+  }
+
+  for (Index = 0; Index < VariableCount; Index++) {
+    if (Variables[Index].VariableName == NULL || Variables[Index].VariableName[0] == 0 ||
+        Variables[Index].VendorGuid == NULL ||
+        (Variables[Index].DataSize != 0 && Variables[Index].Data == NULL)) {
+      Variables[Index].Status = EFI_INVALID_PARAMETER;
+      return EFI_INVALID_PARAMETER;
+    }
+  }
+
+  AcquireLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
+  Status = ReserveVariableBatchSpace (VariableCount, Variables);
+  if (!EFI_ERROR (Status)) {
+    DeferRuntimeVariableCacheFlush (TRUE);
+    for (Index = 0; Index < VariableCount; Index++) {
+      Status = VariableServiceSetVariableInternal (
+                 Variables[Index].VariableName,
+                 Variables[Index].VendorGuid,
+                 Variables[Index].Attributes,
+                 Variables[Index].DataSize,
+                 Variables[Index].Data,
+                 TRUE
+                 );
+      Variables[Index].Status = Status;
+      if (EFI_ERROR (Status)) {
+        break;
+      }
+    }
+    DeferRuntimeVariableCacheFlush (FALSE);
+  }
   ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
 
+  //
+  // Measure the secure boot variables set once the lock is released, as the
+  // measurement reads them back.
+  //
   if (!AtRuntime ()) {
-    if (!EFI_ERROR (Status)) {
-      SecureBootHook (
-        VariableName,
-        VendorGuid
-        );
+    for (Index = 0; Index < VariableCount && Variables[Index].Status == EFI_SUCCESS; Index++) {
+      SecureBootHook (Variables[Index].VariableName, Variables[Index].VendorGuid);
     }
   }
 
@@ -3066,6 +3450,11 @@ VariableServiceQueryVariableInfo (
 /**
   This function reclaims variable storage if free size is below the threshold.
 
+  When the variables still fit, but the free space of the non-volatile
+  variable store is below PcdReclaimVariableSpaceThreshold percent of the
+  store, the erase blocks holding the most dead bytes are reclaimed, before
+  the store fills at OS runtime.
+
   Caution: This function may be invoked at SMM mode.
   Care must be taken to make sure not security issue.
 
@@ -3078,6 +3467,8 @@ ReclaimForOS(
   EFI_STATUS                     Status;
   UINTN                          RemainingCommonRuntimeVariableSpace;
   UINTN                          RemainingHwErrVariableSpace;
+  UINTN                          FreeSize;
+  UINTN                          DeadSize;
   STATIC BOOLEAN                 Reclaimed;
 
   //
@@ -3111,9 +3502,31 @@ ReclaimForOS(
             FALSE,
             NULL,
             NULL,
-            0
+            0,
+            FALSE
             );
     ASSERT_EFI_ERROR (Status);
+  } else if (PcdGet8 (PcdReclaimVariableSpaceThreshold) != 0) {
+    //
+    // Reclaim in the background when the free space is below the threshold,
+    // and when it gets at least the space of another variable.
+    //
+    FreeSize = mNvVariableCache->Size - mVariableModuleGlobal->NonVolatileLastVariableOffset;
+    if (FreeSize * 100 < mNvVariableCache->Size * PcdGet8 (PcdReclaimVariableSpaceThreshold)) {
+      GetReclaimStartOffset (mNvVariableCache, NULL, NULL, FALSE, &DeadSize);
+      if (DeadSize >= mVariableModuleGlobal->MaxVariableSize) {
+        Status = Reclaim (
+                   mVariableModuleGlobal->VariableGlobal.NonVolatileVariableBase,
+                   &mVariableModuleGlobal->NonVolatileLastVariableOffset,
+                   FALSE,
+                   NULL,
+                   NULL,
+                   0,
+                   TRUE
+                   );
+        ASSERT_EFI_ERROR (Status);
+      }
+    }
   }
 }
 
@@ -3258,6 +3671,7 @@ FlushHobVariableToFlash (
       if (mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.HobFlushComplete != NULL) {
         *(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.HobFlushComplete) = TRUE;
       }
+      VariableIndexFree (VariableStoreTypeHob);
       if (!AtRuntime ()) {
         FreePool ((VOID *) VariableStoreHeader);
       }
@@ -3300,7 +3714,8 @@ VariableWriteServiceInitialize (
                  FALSE,
                  NULL,
                  NULL,
-                 0
+                 0,
+                 FALSE
                  );
       if (EFI_ERROR (Status)) {
         ReleaseLockOnlyAtBootTime (&mVariableModuleGlobal->VariableGlobal.VariableServicesLock);
@@ -3563,6 +3978,7 @@ VariableCommonInitialize (
   VARIABLE_STORE_HEADER           *VolatileVariableStore;
   UINTN                           ScratchSize;
   EFI_GUID                        *VariableGuid;
+  EFI_HOB_GUID_TYPE               *GuidHob;
 
   //
   // Allocate runtime memory for variable driver global structure.
@@ -3648,6 +4064,28 @@ VariableCommonInitialize (
   VolatileVariableStore->Reserved    = 0;
   VolatileVariableStore->Reserved1   = 0;
 
+  //
+  // Index the variables of the variable stores.  The variables of a store
+  // that could not be indexed are found by walking the store.  The index of
+  // the NV variable store the PEI variable module built is loaded, if any.
+  //
+  if (mVariableModuleGlobal->VariableGlobal.HobVariableBase != 0) {
+    VariableIndexInitialize (
+      VariableStoreTypeHob,
+      (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.HobVariableBase,
+      mVariableModuleGlobal->VariableGlobal.AuthFormat,
+      NULL
+      );
+  }
+  GuidHob = GetFirstGuidHob (&gEdkiiVariableHashIndexGuid);
+  VariableIndexInitialize (
+    VariableStoreTypeNv,
+    mNvVariableCache,
+    mVariableModuleGlobal->VariableGlobal.AuthFormat,
+    (GuidHob != NULL) ? GET_GUID_HOB_DATA (GuidHob) : NULL
+    );
+  VariableIndexInitialize (VariableStoreTypeVolatile, VolatileVariableStore, mVariableModuleGlobal->VariableGlobal.AuthFormat, NULL);
+
   return EFI_SUCCESS;
 }
 
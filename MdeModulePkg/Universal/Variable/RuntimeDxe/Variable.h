@@ -16,6 +16,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/FirmwareVolumeBlock.h>
 #include <Protocol/Variable.h>
 #include <Protocol/VariableLock.h>
+#include <Protocol/VariableBatch.h>
 #include <Protocol/VarCheck.h>
 #include <Library/PcdLib.h>
 #include <Library/HobLib.h>
@@ -64,16 +65,36 @@ typedef enum {
   VariableStoreTypeMax
 } VARIABLE_STORE_TYPE;
 
+///
+/// The maximum number of ranges of a runtime variable cache that are pending an update.
+/// Once the journal of the pending updates of a cache is full, the two closest ranges
+/// are merged to make room for a new one.
+///
+#define VARIABLE_RUNTIME_CACHE_PENDING_UPDATE_MAX  8
+
+///
+/// A range of a runtime variable cache that is pending an update.
+///
 typedef struct {
-  UINT32                  PendingUpdateOffset;
-  UINT32                  PendingUpdateLength;
-  VARIABLE_STORE_HEADER   *Store;
+  UINT32                  Offset;
+  UINT32                  Length;
+} VARIABLE_RUNTIME_CACHE_UPDATE;
+
+///
+/// A runtime variable cache, with the journal of its pending updates.  The ranges of
+/// the journal are sorted by offset, and they neither overlap nor are adjacent.
+///
+typedef struct {
+  UINT32                        PendingUpdateCount;
+  VARIABLE_RUNTIME_CACHE_UPDATE PendingUpdates[VARIABLE_RUNTIME_CACHE_PENDING_UPDATE_MAX];
+  VARIABLE_STORE_HEADER         *Store;
 } VARIABLE_RUNTIME_CACHE;
 
 typedef struct {
   BOOLEAN                 *ReadLock;
   BOOLEAN                 *PendingUpdate;
   BOOLEAN                 *HobFlushComplete;
+  BOOLEAN                 *CacheRewritten;
   VARIABLE_RUNTIME_CACHE  VariableRuntimeHobCache;
   VARIABLE_RUNTIME_CACHE  VariableRuntimeNvCache;
   VARIABLE_RUNTIME_CACHE  VariableRuntimeVolatileCache;
@@ -146,6 +167,10 @@ FlushHobVariableToFlash (
   volume block device. The destination is specified by the parameter
   VariableBase. Fault Tolerant Write protocol is used for writing.
 
+  Only the range of the variable storage space that differs from the buffer
+  is written, in a single fault tolerant write, so the blocks before and
+  after that range are not erased again.
+
   @param  VariableBase   Base address of the variable to write.
   @param  VariableBuffer Point to the variable data buffer.
 
@@ -160,6 +185,68 @@ FtwVariableSpace (
   IN VARIABLE_STORE_HEADER  *VariableBuffer
   );
 
+/**
+  Get the offset in the non-volatile variable store from which it is reclaimed.
+
+  For an incremental reclaim, the reclaim starts at the erase block that gives
+  the most dead bytes reclaimed per byte written.  The erase blocks are only
+  known when the firmware volume of the store has one size of erase block and
+  starts on an erase block boundary; otherwise the reclaim is complete.
+
+  @param[in]  VariableStoreHeader          The non-volatile variable store.
+  @param[in]  UpdatingVariable             The variable being updated, or NULL.
+  @param[in]  UpdatingInDeletedTransition  The IN_DELETED_TRANSITION copy of the variable
+                                           being updated, or NULL.
+  @param[in]  Incremental                  TRUE for an incremental reclaim.
+  @param[out] DeadSize                     The dead bytes of the store.
+
+  @return The offset of the first variable reclaimed, from the variable store header.
+
+**/
+UINTN
+GetReclaimStartOffset (
+  IN  VARIABLE_STORE_HEADER     *VariableStoreHeader,
+  IN  VARIABLE_HEADER           *UpdatingVariable,
+  IN  VARIABLE_HEADER           *UpdatingInDeletedTransition,
+  IN  BOOLEAN                   Incremental,
+  OUT UINTN                     *DeadSize
+  );
+
+/**
+  Add the sizes of a range of variables of the non-volatile variable store to
+  the total sizes of the variables, whatever the state of the variables.
+
+  @param[in]      Variable                     The first variable of the range.
+  @param[in]      EndVariable                  The variable after the range.
+  @param[in, out] HwErrVariableTotalSize       The total size of the hardware error
+                                               record variables.
+  @param[in, out] CommonVariableTotalSize      The total size of the other variables.
+  @param[in, out] CommonUserVariableTotalSize  The total size of the user variables.
+
+**/
+VOID
+GetVariableTotalSizes (
+  IN     VARIABLE_HEADER        *Variable,
+  IN     VARIABLE_HEADER        *EndVariable,
+  IN OUT UINTN                  *HwErrVariableTotalSize,
+  IN OUT UINTN                  *CommonVariableTotalSize,
+  IN OUT UINTN                  *CommonUserVariableTotalSize
+  );
+
+/**
+  Is user variable?
+
+  @param[in] Variable   Pointer to variable header.
+
+  @retval TRUE          User variable.
+  @retval FALSE         System variable.
+
+**/
+BOOLEAN
+IsUserVariable (
+  IN VARIABLE_HEADER    *Variable
+  );
+
 /**
   Finds variable in storage blocks of volatile and non-volatile storage areas.
 
@@ -377,6 +464,11 @@ VariableCommonInitialize (
 /**
   This function reclaims variable storage if free size is below the threshold.
 
+  When the variables still fit, but the free space of the non-volatile
+  variable store is below PcdReclaimVariableSpaceThreshold percent of the
+  store, the erase blocks holding the most dead bytes are reclaimed, before
+  the store fills at OS runtime.
+
 **/
 VOID
 ReclaimForOS(
@@ -536,6 +628,77 @@ VariableServiceSetVariable (
   IN VOID                    *Data
   );
 
+/**
+
+  This code sets variable in storage blocks (Volatile or Non-Volatile), like
+  VariableServiceSetVariable(), without measuring the secure boot variables.
+
+  Caution: This function may receive untrusted input.
+  This function may be invoked in SMM mode, and datasize and data are external input.
+  This function will do basic validation, before parse the data.
+
+  @param VariableName                     Name of Variable to be found.
+  @param VendorGuid                       Variable vendor GUID.
+  @param Attributes                       Attribute value of the variable found
+  @param DataSize                         Size of Data found. If size is less than the
+                                          data, this value contains the required size.
+  @param Data                             Data pointer.
+  @param LockHeld                         TRUE if the caller holds the variable services lock.
+
+  @return EFI_INVALID_PARAMETER           Invalid parameter.
+  @return EFI_SUCCESS                     Set successfully.
+  @return EFI_OUT_OF_RESOURCES            Resource not enough to set variable.
+  @return EFI_NOT_FOUND                   Not found.
+  @return EFI_WRITE_PROTECTED             Variable is read-only.
+
+**/
+EFI_STATUS
+VariableServiceSetVariableInternal (
+  IN CHAR16                  *VariableName,
+  IN EFI_GUID                *VendorGuid,
+  IN UINT32                  Attributes,
+  IN UINTN                   DataSize,
+  IN VOID                    *Data,
+  IN BOOLEAN                 LockHeld
+  );
+
+/**
+  Set a batch of variables.
+
+  The variables are set in order like VariableServiceSetVariable(), until all of them
+  are set or one of them fails.  Before any variable is set, the parameters of the
+  variables are checked, and the space the non-volatile variables of the batch need is
+  reserved in the non-volatile variable store.  The variable services lock is held from
+  the reservation to the last variable, so no other update takes the space reserved.
+  The updates of the batch are copied to the runtime variable caches once, after the
+  last variable.
+
+  Caution: This function may receive untrusted input.
+  This function may be invoked in SMM mode, and the variables are external input.
+  The variables are validated like VariableServiceSetVariable() before they are set.
+
+  @param[in]      VariableCount  The number of variables in Variables.
+  @param[in, out] Variables      The variables to set.  Returns the status of each
+                                 variable in its Status field.
+
+  @retval EFI_SUCCESS            All the variables were set.
+  @retval EFI_INVALID_PARAMETER  Variables is NULL and VariableCount is not 0, or the
+                                 parameters of a variable are invalid.  No variable
+                                 was set.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough space in the variable store for
+                                 the non-volatile variables of the batch.  No variable
+                                 was set.
+  @retval Others                 The variable whose Status is not EFI_SUCCESS nor
+                                 EFI_NOT_STARTED failed with this status.  The
+                                 variables before it were set.
+
+**/
+EFI_STATUS
+VariableServiceSetVariableBatch (
+  IN     UINTN                          VariableCount,
+  IN OUT EDKII_VARIABLE_BATCH_ENTRY     *Variables
+  );
+
 /**
 
   This code returns information about the EFI variables.
@@ -617,6 +780,38 @@ VariableLockRequestToLock (
   IN       EFI_GUID                     *VendorGuid
   );
 
+/**
+  Set a batch of variables.
+
+  The variables are set in order, the way SetVariable() sets them, until all of them
+  are set or one of them fails.  Before any variable is set, the batch is checked,
+  and the space the non-volatile variables of the batch need is reserved in the
+  non-volatile variable store.
+
+  @param[in]      This           The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in]      VariableCount  The number of variables in Variables.
+  @param[in, out] Variables      The variables to set.  Returns the status of each
+                                 variable in its Status field.
+
+  @retval EFI_SUCCESS            All the variables were set.
+  @retval EFI_INVALID_PARAMETER  Variables is NULL and VariableCount is not 0, or the
+                                 parameters of a variable are invalid.  No variable
+                                 was set.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough space in the variable store for
+                                 the non-volatile variables of the batch.  No variable
+                                 was set.
+  @retval Others                 The variable whose Status is not EFI_SUCCESS nor
+                                 EFI_NOT_STARTED failed with this status.  The
+                                 variables before it were set.
+**/
+EFI_STATUS
+EFIAPI
+VariableBatchSetVariables (
+  IN CONST EDKII_VARIABLE_BATCH_PROTOCOL *This,
+  IN       UINTN                         VariableCount,
+  IN OUT   EDKII_VARIABLE_BATCH_ENTRY    *Variables
+  );
+
 /**
   Register SetVariable check handler.
 
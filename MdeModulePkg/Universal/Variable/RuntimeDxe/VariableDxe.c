@@ -10,6 +10,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
 #include "Variable.h"
+#include "VariableIndex.h"
 
 EFI_HANDLE                          mHandle                    = NULL;
 EFI_EVENT                           mVirtualAddressChangeEvent = NULL;
@@ -17,6 +18,7 @@ VOID                                *mFtwRegistration          = NULL;
 VOID                                ***mVarCheckAddressPointer = NULL;
 UINTN                               mVarCheckAddressPointerCount = 0;
 EDKII_VARIABLE_LOCK_PROTOCOL        mVariableLock              = { VariableLockRequestToLock };
+EDKII_VARIABLE_BATCH_PROTOCOL       mVariableBatch             = { VariableBatchSetVariables };
 EDKII_VAR_CHECK_PROTOCOL            mVarCheck                  = { VarCheckRegisterSetVariableCheckHandler,
                                                                     VarCheckVariablePropertySet,
                                                                     VarCheckVariablePropertyGet };
@@ -210,6 +212,41 @@ GetFvbCountAndBuffer (
   return Status;
 }
 
+/**
+  Set a batch of variables.
+
+  The variables are set in order, the way SetVariable() sets them, until all of them
+  are set or one of them fails.  Before any variable is set, the batch is checked,
+  and the space the non-volatile variables of the batch need is reserved in the
+  non-volatile variable store.
+
+  @param[in]      This           The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in]      VariableCount  The number of variables in Variables.
+  @param[in, out] Variables      The variables to set.  Returns the status of each
+                                 variable in its Status field.
+
+  @retval EFI_SUCCESS            All the variables were set.
+  @retval EFI_INVALID_PARAMETER  Variables is NULL and VariableCount is not 0, or the
+                                 parameters of a variable are invalid.  No variable
+                                 was set.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough space in the variable store for
+                                 the non-volatile variables of the batch.  No variable
+                                 was set.
+  @retval Others                 The variable whose Status is not EFI_SUCCESS nor
+                                 EFI_NOT_STARTED failed with this status.  The
+                                 variables before it were set.
+**/
+EFI_STATUS
+EFIAPI
+VariableBatchSetVariables (
+  IN CONST EDKII_VARIABLE_BATCH_PROTOCOL *This,
+  IN       UINTN                         VariableCount,
+  IN OUT   EDKII_VARIABLE_BATCH_ENTRY    *Variables
+  )
+{
+  return VariableServiceSetVariableBatch (VariableCount, Variables);
+}
+
 
 /**
   Notification function of EVT_SIGNAL_VIRTUAL_ADDRESS_CHANGE.
@@ -228,7 +265,8 @@ VariableClassAddressChangeEvent (
   IN VOID                                 *Context
   )
 {
-  UINTN          Index;
+  UINTN                Index;
+  VARIABLE_STORE_TYPE  StoreType;
 
   if (mVariableModuleGlobal->FvbInstance != NULL) {
     EfiConvertPointer (0x0, (VOID **) &mVariableModuleGlobal->FvbInstance->GetBlockSize);
@@ -250,6 +288,11 @@ VariableClassAddressChangeEvent (
   EfiConvertPointer (0x0, (VOID **) &mNvVariableCache);
   EfiConvertPointer (0x0, (VOID **) &mNvFvHeaderCache);
 
+  for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+    EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableIndex[StoreType].Store);
+    EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableIndex[StoreType].Entries);
+  }
+
   if (mAuthContextOut.AddressPointer != NULL) {
     for (Index = 0; Index < mAuthContextOut.AddressPointerCount; Index++) {
       EfiConvertPointer (0x0, (VOID **) mAuthContextOut.AddressPointer[Index]);
@@ -500,6 +543,14 @@ VariableServiceInitialize (
                   );
   ASSERT_EFI_ERROR (Status);
 
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &mHandle,
+                  &gEdkiiVariableBatchProtocolGuid,
+                  &mVariableBatch,
+                  NULL
+                  );
+  ASSERT_EFI_ERROR (Status);
+
   Status = gBS->InstallMultipleProtocolInterfaces (
                   &mHandle,
                   &gEdkiiVarCheckProtocolGuid,
@@ -0,0 +1,541 @@
+/** @file
+  The hash index of the variables of the variable stores, by variable name and
+  vendor GUID.
+
+  FindVariableEx() looks variables up in the index of a store instead of
+  walking the whole store, as long as the index of the store is up to date.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "VariableParsing.h"
+#include "VariableIndex.h"
+
+VARIABLE_INDEX  mVariableIndex[VariableStoreTypeMax];
+
+/**
+  Compute the hash of the name and vendor GUID of a variable.
+
+  @param[in] VariableName       Name of the variable.
+  @param[in] NameLength         Maximum number of characters of the name.
+  @param[in] VendorGuid         Vendor GUID of the variable.
+
+  @return The hash of the name and vendor GUID.
+
+**/
+UINT32
+VariableIndexHash (
+  IN CONST CHAR16               *VariableName,
+  IN UINTN                      NameLength,
+  IN CONST EFI_GUID             *VendorGuid
+  )
+{
+  UINT32                        Hash;
+  CONST UINT8                   *Guid;
+  UINTN                         Index;
+
+  //
+  // FNV-1a hash of the characters of the name, up to the null terminator, and
+  // of the bytes of the vendor GUID.
+  //
+  Hash = 0x811C9DC5;
+  for (Index = 0; Index < NameLength && VariableName[Index] != 0; Index++) {
+    Hash = (Hash ^ VariableName[Index]) * 0x01000193;
+  }
+  Guid = (CONST UINT8 *) VendorGuid;
+  for (Index = 0; Index < sizeof (EFI_GUID); Index++) {
+    Hash = (Hash ^ Guid[Index]) * 0x01000193;
+  }
+  return Hash;
+}
+
+/**
+  Return the hash index of the variable store a variable pointer track walks.
+
+  @param[in] PtrTrack           Variable Track Pointer structure.
+  @param[in] AuthFormat         TRUE indicates authenticated variables are used.
+                                FALSE indicates authenticated variables are not used.
+
+  @return The hash index of the variable store, or NULL if it is not indexed.
+
+**/
+VARIABLE_INDEX *
+VariableIndexGet (
+  IN VARIABLE_POINTER_TRACK     *PtrTrack,
+  IN BOOLEAN                    AuthFormat
+  )
+{
+  VARIABLE_STORE_TYPE           StoreType;
+  VARIABLE_INDEX                *Index;
+
+  for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+    Index = &mVariableIndex[StoreType];
+    if (Index->Store != NULL && GetStartPointer (Index->Store) == PtrTrack->StartPtr) {
+      if (Index->Full || Index->AuthFormat != AuthFormat) {
+        return NULL;
+      }
+      return Index;
+    }
+  }
+  return NULL;
+}
+
+/**
+  Check whether a variable header of the index matches the variable looked up.
+
+  @param[in] Variable           The variable header.
+  @param[in] VariableName       Name of the variable to be found.
+  @param[in] VendorGuid         Vendor GUID to be found.
+  @param[in] IgnoreRtCheck      Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                                check at runtime when searching variable.
+  @param[in] EndPtr             The end of the range of the store searched.
+  @param[in] AuthFormat         TRUE indicates authenticated variables are used.
+                                FALSE indicates authenticated variables are not used.
+
+  @retval TRUE                  The variable is an ADDED or IN_DELETED_TRANSITION
+                                variable with the name and vendor GUID looked up.
+  @retval FALSE                 The variable does not match.
+
+**/
+BOOLEAN
+VariableIndexMatch (
+  IN VARIABLE_HEADER            *Variable,
+  IN CHAR16                     *VariableName,
+  IN EFI_GUID                   *VendorGuid,
+  IN BOOLEAN                    IgnoreRtCheck,
+  IN VARIABLE_HEADER            *EndPtr,
+  IN BOOLEAN                    AuthFormat
+  )
+{
+  if (!IsValidVariableHeader (Variable, EndPtr)) {
+    return FALSE;
+  }
+  if (Variable->State != VAR_ADDED && Variable->State != (VAR_IN_DELETED_TRANSITION & VAR_ADDED)) {
+    return FALSE;
+  }
+  if (!IgnoreRtCheck && AtRuntime () && ((Variable->Attributes & EFI_VARIABLE_RUNTIME_ACCESS) == 0)) {
+    return FALSE;
+  }
+  if (!CompareGuid (VendorGuid, GetVendorGuidPtr (Variable, AuthFormat))) {
+    return FALSE;
+  }
+
+  ASSERT (NameSizeOfVariable (Variable, AuthFormat) != 0);
+  return (BOOLEAN) (CompareMem (VariableName, GetVariableNamePtr (Variable, AuthFormat), NameSizeOfVariable (Variable, AuthFormat)) == 0);
+}
+
+/**
+  Load the hash index the PEI variable module built for a variable store into
+  the hash index of the store, and index the variables added to the store since.
+
+  The entries are moved to the slots of their hash in the index of the store, so
+  the variables are not hashed again.  The index is not loaded if it does not
+  fit the store, or if an entry does not point to a variable header of the store.
+
+  @param[in] StoreType          The type of the variable store.
+  @param[in] HashIndex          The hash index the PEI variable module built.
+
+  @retval TRUE                  The hash index is loaded.
+  @retval FALSE                 The hash index does not fit the store, and the
+                                store must be indexed again.
+
+**/
+BOOLEAN
+VariableIndexLoad (
+  IN VARIABLE_STORE_TYPE        StoreType,
+  IN CONST VARIABLE_HASH_INDEX  *HashIndex
+  )
+{
+  VARIABLE_INDEX                   *Index;
+  CONST VARIABLE_HASH_INDEX_ENTRY  *Entries;
+  VARIABLE_HEADER                  *IndexedEnd;
+  UINT32                           StartOffset;
+  UINT32                           Entry;
+  UINT32                           Slot;
+
+  Index       = &mVariableIndex[StoreType];
+  StartOffset = (UINT32) ((UINTN) GetStartPointer (Index->Store) - (UINTN) Index->Store);
+  if (HashIndex->Full ||
+      HashIndex->StoreSize != Index->Store->Size ||
+      HashIndex->AuthFormat != Index->AuthFormat ||
+      HashIndex->UsedCount >= Index->EntryCount - Index->EntryCount / 4 ||
+      HashIndex->IndexedOffset < StartOffset ||
+      HashIndex->IndexedOffset > Index->Store->Size) {
+    return FALSE;
+  }
+
+  ZeroMem (Index->Entries, Index->EntryCount * sizeof (VARIABLE_INDEX_ENTRY));
+  Index->UsedCount    = 0;
+  Index->CursorOffset = 0;
+  Index->Full         = FALSE;
+
+  IndexedEnd = (VARIABLE_HEADER *) ((UINTN) Index->Store + HashIndex->IndexedOffset);
+  Entries    = (CONST VARIABLE_HASH_INDEX_ENTRY *) (HashIndex + 1);
+  for (Entry = 0; Entry < HashIndex->EntryCount; Entry++) {
+    if (Entries[Entry].Offset == 0) {
+      continue;
+    }
+    if (Entries[Entry].Offset < StartOffset ||
+        !IsValidVariableHeader ((VARIABLE_HEADER *) ((UINTN) Index->Store + Entries[Entry].Offset), IndexedEnd)) {
+      return FALSE;
+    }
+
+    Slot = Entries[Entry].Hash & (Index->EntryCount - 1);
+    while (Index->Entries[Slot].Offset != 0) {
+      Slot = (Slot + 1) & (Index->EntryCount - 1);
+    }
+    Index->Entries[Slot] = Entries[Entry];
+    Index->UsedCount++;
+  }
+  if (Index->UsedCount != HashIndex->UsedCount) {
+    return FALSE;
+  }
+
+  Index->IndexedOffset = HashIndex->IndexedOffset;
+  VariableIndexUpdate (StoreType);
+  return TRUE;
+}
+
+/**
+  Create the hash index of a variable store, and index the variables it holds.
+
+  @param[in] StoreType          The type of the variable store.
+  @param[in] Store              The variable store.
+  @param[in] AuthFormat         TRUE indicates authenticated variables are used.
+                                FALSE indicates authenticated variables are not used.
+  @param[in] HashIndex          The hash index the PEI variable module built for
+                                the store, to load instead of hashing the variables
+                                of the store again, or NULL.
+
+  @retval EFI_SUCCESS           The variable store is indexed.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory for the index.
+
+**/
+EFI_STATUS
+VariableIndexInitialize (
+  IN VARIABLE_STORE_TYPE        StoreType,
+  IN VARIABLE_STORE_HEADER      *Store,
+  IN BOOLEAN                    AuthFormat,
+  IN CONST VARIABLE_HASH_INDEX  *HashIndex  OPTIONAL
+  )
+{
+  VARIABLE_INDEX                *Index;
+  UINT32                        EntryCount;
+
+  ASSERT (StoreType < VariableStoreTypeMax);
+  VariableIndexFree (StoreType);
+
+  //
+  // Size the index for the variables the store can hold, with a load factor
+  // of at most 3/4.
+  //
+  EntryCount = MAX (Store->Size / VARIABLE_INDEX_VARIABLE_SIZE, VARIABLE_INDEX_MIN_ENTRY_COUNT);
+  if (GetPowerOfTwo32 (EntryCount) != EntryCount) {
+    EntryCount = GetPowerOfTwo32 (EntryCount) << 1;
+  }
+
+  Index          = &mVariableIndex[StoreType];
+  Index->Entries = AllocateRuntimeZeroPool (EntryCount * sizeof (VARIABLE_INDEX_ENTRY));
+  if (Index->Entries == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Index->Store      = Store;
+  Index->EntryCount = EntryCount;
+  Index->AuthFormat = AuthFormat;
+
+  if (HashIndex == NULL || !VariableIndexLoad (StoreType, HashIndex)) {
+    VariableIndexRebuild (StoreType);
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  Free the hash index of a variable store that is not used anymore.
+
+  @param[in] StoreType          The type of the variable store.
+
+**/
+VOID
+VariableIndexFree (
+  IN VARIABLE_STORE_TYPE        StoreType
+  )
+{
+  VARIABLE_INDEX                *Index;
+
+  ASSERT (StoreType < VariableStoreTypeMax);
+  Index = &mVariableIndex[StoreType];
+  if (Index->Entries != NULL && !AtRuntime ()) {
+    FreePool (Index->Entries);
+  }
+  ZeroMem (Index, sizeof (*Index));
+}
+
+/**
+  Rebuild the hash index of a variable store after the store was rewritten,
+  such as by a reclaim.
+
+  @param[in] StoreType          The type of the variable store.
+
+**/
+VOID
+VariableIndexRebuild (
+  IN VARIABLE_STORE_TYPE        StoreType
+  )
+{
+  VARIABLE_INDEX                *Index;
+
+  ASSERT (StoreType < VariableStoreTypeMax);
+  Index = &mVariableIndex[StoreType];
+  if (Index->Store == NULL) {
+    return;
+  }
+
+  ZeroMem (Index->Entries, Index->EntryCount * sizeof (VARIABLE_INDEX_ENTRY));
+  Index->UsedCount     = 0;
+  Index->IndexedOffset = (UINT32) ((UINTN) GetStartPointer (Index->Store) - (UINTN) Index->Store);
+  Index->CursorOffset  = 0;
+  Index->Full          = FALSE;
+
+  VariableIndexUpdate (StoreType);
+}
+
+/**
+  Add the variables that were added to the end of a variable store to the hash
+  index of the store.
+
+  @param[in] StoreType          The type of the variable store.
+
+**/
+VOID
+VariableIndexUpdate (
+  IN VARIABLE_STORE_TYPE        StoreType
+  )
+{
+  VARIABLE_INDEX                *Index;
+  VARIABLE_HEADER               *Variable;
+  VARIABLE_HEADER               *EndPtr;
+  UINT32                        Hash;
+  UINT32                        Slot;
+
+  ASSERT (StoreType < VariableStoreTypeMax);
+  Index = &mVariableIndex[StoreType];
+  if (Index->Store == NULL || Index->Full) {
+    return;
+  }
+
+  EndPtr = GetEndPointer (Index->Store);
+  for ( Variable = (VARIABLE_HEADER *) ((UINTN) Index->Store + Index->IndexedOffset)
+      ; IsValidVariableHeader (Variable, EndPtr)
+      ; Variable = GetNextVariablePtr (Variable, Index->AuthFormat)
+      ) {
+    if (Index->UsedCount >= Index->EntryCount - Index->EntryCount / 4) {
+      //
+      // The store holds more variables than the index was sized for.  Walk the
+      // store until the next reclaim.
+      //
+      Index->Full = TRUE;
+      break;
+    }
+
+    Hash = VariableIndexHash (
+             GetVariableNamePtr (Variable, Index->AuthFormat),
+             NameSizeOfVariable (Variable, Index->AuthFormat) / sizeof (CHAR16),
+             GetVendorGuidPtr (Variable, Index->AuthFormat)
+             );
+    Slot = Hash & (Index->EntryCount - 1);
+    while (Index->Entries[Slot].Offset != 0) {
+      Slot = (Slot + 1) & (Index->EntryCount - 1);
+    }
+
+    //
+    // Fill in the hash first, the offset marks the entry as used.
+    //
+    Index->Entries[Slot].Hash   = Hash;
+    Index->Entries[Slot].Offset = (UINT32) ((UINTN) Variable - (UINTN) Index->Store);
+    Index->UsedCount++;
+  }
+
+  Index->IndexedOffset = (UINT32) ((UINTN) Variable - (UINTN) Index->Store);
+}
+
+/**
+  Find a variable in a variable store through the hash index of the store.
+
+  The variable is found the way FindVariableEx() finds it by walking the store.
+
+  @param[in]       VariableName        Name of the variable to be found, not empty.
+  @param[in]       VendorGuid          Vendor GUID to be found.
+  @param[in]       IgnoreRtCheck       Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                                       check at runtime when searching variable.
+  @param[in, out]  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+  @param[in]       AuthFormat          TRUE indicates authenticated variables are used.
+                                       FALSE indicates authenticated variables are not used.
+
+  @retval          EFI_SUCCESS         Variable found successfully.
+  @retval          EFI_NOT_FOUND       Variable not found.
+  @retval          EFI_UNSUPPORTED     The variable store is not indexed, or its index
+                                       is not up to date, and it has to be walked.
+**/
+EFI_STATUS
+VariableIndexFind (
+  IN     CHAR16                  *VariableName,
+  IN     EFI_GUID                *VendorGuid,
+  IN     BOOLEAN                 IgnoreRtCheck,
+  IN OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  IN     BOOLEAN                 AuthFormat
+  )
+{
+  VARIABLE_INDEX                 *Index;
+  VARIABLE_HEADER                *Variable;
+  VARIABLE_HEADER                *AddedVariable;
+  VARIABLE_HEADER                *InDeletedVariable;
+  UINT32                         Hash;
+  UINT32                         Slot;
+
+  ASSERT (VariableName[0] != 0);
+
+  Index = VariableIndexGet (PtrTrack, AuthFormat);
+  if (Index == NULL) {
+    return EFI_UNSUPPORTED;
+  }
+
+  //
+  // A variable was added to the store since the index was updated, such as by
+  // a nested SetVariable() call, and the store has to be walked.
+  //
+  if (IsValidVariableHeader ((VARIABLE_HEADER *) ((UINTN) Index->Store + Index->IndexedOffset), GetEndPointer (Index->Store))) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Hash = VariableIndexHash (VariableName, MAX_UINTN, VendorGuid);
+
+  //
+  // The walk of the store returns the first ADDED variable, and the last
+  // IN_DELETED_TRANSITION variable before it.  Without an ADDED variable, it
+  // returns the last IN_DELETED_TRANSITION variable.
+  //
+  AddedVariable = NULL;
+  for (Slot = Hash & (Index->EntryCount - 1); Index->Entries[Slot].Offset != 0; Slot = (Slot + 1) & (Index->EntryCount - 1)) {
+    if (Index->Entries[Slot].Hash != Hash) {
+      continue;
+    }
+    Variable = (VARIABLE_HEADER *) ((UINTN) Index->Store + Index->Entries[Slot].Offset);
+    if (VariableIndexMatch (Variable, VariableName, VendorGuid, IgnoreRtCheck, PtrTrack->EndPtr, AuthFormat) &&
+        Variable->State == VAR_ADDED &&
+        (AddedVariable == NULL || Variable < AddedVariable)) {
+      AddedVariable = Variable;
+    }
+  }
+
+  InDeletedVariable = NULL;
+  for (Slot = Hash & (Index->EntryCount - 1); Index->Entries[Slot].Offset != 0; Slot = (Slot + 1) & (Index->EntryCount - 1)) {
+    if (Index->Entries[Slot].Hash != Hash) {
+      continue;
+    }
+    Variable = (VARIABLE_HEADER *) ((UINTN) Index->Store + Index->Entries[Slot].Offset);
+    if (VariableIndexMatch (Variable, VariableName, VendorGuid, IgnoreRtCheck, PtrTrack->EndPtr, AuthFormat) &&
+        Variable->State == (VAR_IN_DELETED_TRANSITION & VAR_ADDED) &&
+        (AddedVariable == NULL || Variable < AddedVariable) &&
+        (InDeletedVariable == NULL || Variable > InDeletedVariable)) {
+      InDeletedVariable = Variable;
+    }
+  }
+
+  if (AddedVariable != NULL) {
+    PtrTrack->CurrPtr                = AddedVariable;
+    PtrTrack->InDeletedTransitionPtr = InDeletedVariable;
+    return EFI_SUCCESS;
+  }
+
+  PtrTrack->CurrPtr = InDeletedVariable;
+  return (PtrTrack->CurrPtr == NULL) ? EFI_NOT_FOUND : EFI_SUCCESS;
+}
+
+/**
+  Find the variable that GetNextVariableName() returned last, so the
+  enumeration of the variables continues from it without looking it up.
+
+  The variable is found only if it is the ADDED variable with the name and
+  vendor GUID, the one FindVariableEx() would find in the variable stores.
+
+  @param[in]   VariableName        Name of the variable the caller passes back, not empty.
+  @param[in]   VendorGuid          Vendor GUID of the variable the caller passes back.
+  @param[in]   VariableStoreList   A list of variable stores that should be used to get the next variable.
+                                   The maximum number of entries is the max value of VARIABLE_STORE_TYPE.
+  @param[out]  PtrTrack            Variable Track Pointer structure of the variable found.
+  @param[in]   AuthFormat          TRUE indicates authenticated variables are used.
+                                   FALSE indicates authenticated variables are not used.
+
+  @retval      EFI_SUCCESS         The variable is the one GetNextVariableName() returned last.
+  @retval      EFI_NOT_FOUND       The variable has to be looked up.
+**/
+EFI_STATUS
+VariableIndexFindCursor (
+  IN  CHAR16                  *VariableName,
+  IN  EFI_GUID                *VendorGuid,
+  IN  VARIABLE_STORE_HEADER   **VariableStoreList,
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  IN  BOOLEAN                 AuthFormat
+  )
+{
+  VARIABLE_STORE_TYPE         StoreType;
+  VARIABLE_INDEX              *Index;
+  VARIABLE_HEADER             *Variable;
+
+  ASSERT (VariableName[0] != 0);
+
+  for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+    Index = &mVariableIndex[StoreType];
+    if (Index->Store == NULL || Index->CursorOffset == 0 ||
+        Index->Store != VariableStoreList[StoreType] || Index->AuthFormat != AuthFormat) {
+      continue;
+    }
+
+    //
+    // Only an ADDED variable is the one the stores are searched for: a variable
+    // is held by either the volatile or the non-volatile store, and the
+    // enumeration does not return the non-volatile variables that a HOB
+    // variable overrides.  An IN_DELETED_TRANSITION variable may have an ADDED
+    // copy, so it is looked up.
+    //
+    Variable = (VARIABLE_HEADER *) ((UINTN) Index->Store + Index->CursorOffset);
+    if (!VariableIndexMatch (Variable, VariableName, VendorGuid, FALSE, GetEndPointer (Index->Store), AuthFormat) ||
+        Variable->State != VAR_ADDED) {
+      continue;
+    }
+
+    PtrTrack->StartPtr = GetStartPointer (Index->Store);
+    PtrTrack->EndPtr   = GetEndPointer (Index->Store);
+    PtrTrack->CurrPtr  = Variable;
+    PtrTrack->Volatile = (BOOLEAN) (StoreType == VariableStoreTypeVolatile);
+    return EFI_SUCCESS;
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Record the variable GetNextVariableName() returns, as the cursor of the
+  enumeration of the variables.
+
+  @param[in]  PtrTrack            Variable Track Pointer structure of the variable returned.
+
+**/
+VOID
+VariableIndexSetCursor (
+  IN VARIABLE_POINTER_TRACK     *PtrTrack
+  )
+{
+  VARIABLE_STORE_TYPE           StoreType;
+  VARIABLE_INDEX                *Index;
+
+  for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+    Index = &mVariableIndex[StoreType];
+    if (Index->Store != NULL && GetStartPointer (Index->Store) == PtrTrack->StartPtr) {
+      Index->CursorOffset = (UINT32) ((UINTN) PtrTrack->CurrPtr - (UINTN) Index->Store);
+      return;
+    }
+  }
+}
@@ -0,0 +1,210 @@
+/** @file
+  The hash index of the variables of the variable stores, by variable name and
+  vendor GUID, shared by the variable modules and the runtime variable cache.
+
+Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _VARIABLE_INDEX_H_
+#define _VARIABLE_INDEX_H_
+
+#include "Variable.h"
+
+#include <Guid/VariableHashIndex.h>
+
+///
+/// The average size, in bytes, of the variables a variable store is sized for
+/// in the hash index.  The index of a store with smaller variables gets full,
+/// and the variables are then found by walking the store until it is rebuilt.
+///
+#define VARIABLE_INDEX_VARIABLE_SIZE      VARIABLE_HASH_INDEX_VARIABLE_SIZE
+
+///
+/// The minimum number of entries of the hash index of a variable store.
+///
+#define VARIABLE_INDEX_MIN_ENTRY_COUNT    VARIABLE_HASH_INDEX_MIN_ENTRY_COUNT
+
+///
+/// An entry of the hash index of a variable store, the entry of the variable
+/// hash index HOB the PEI variable module builds.
+///
+typedef VARIABLE_HASH_INDEX_ENTRY  VARIABLE_INDEX_ENTRY;
+
+///
+/// The hash index of the variables of a variable store.
+///
+/// The index holds the offsets of all the variable headers of the store up to
+/// IndexedOffset, whatever their state, in an open addressed table.  The state
+/// of the variables is checked in the store when they are looked up, so the
+/// index only has to be updated when variables are added to the end of the
+/// store, and rebuilt when the store is reclaimed.
+///
+typedef struct {
+  ///
+  /// The variable store, or NULL if it is not indexed.
+  ///
+  VARIABLE_STORE_HEADER   *Store;
+  ///
+  /// The entries of the index.
+  ///
+  VARIABLE_INDEX_ENTRY    *Entries;
+  ///
+  /// The number of entries of the index, a power of two.
+  ///
+  UINT32                  EntryCount;
+  ///
+  /// The number of variable headers in the index.
+  ///
+  UINT32                  UsedCount;
+  ///
+  /// The offset of the first variable header that is not in the index yet.
+  ///
+  UINT32                  IndexedOffset;
+  ///
+  /// The offset of the variable header that GetNextVariableName() returned
+  /// last from the store, or 0.  It is the cursor of the enumeration of the
+  /// variables, and it is valid until the store is rewritten.
+  ///
+  UINT32                  CursorOffset;
+  ///
+  /// TRUE if the variables of the store use the authenticated format.
+  ///
+  BOOLEAN                 AuthFormat;
+  ///
+  /// TRUE if the store has more variable headers than the index can hold.
+  ///
+  BOOLEAN                 Full;
+} VARIABLE_INDEX;
+
+///
+/// The hash indexes of the variable stores.
+///
+extern VARIABLE_INDEX     mVariableIndex[VariableStoreTypeMax];
+
+/**
+  Create the hash index of a variable store, and index the variables it holds.
+
+  @param[in] StoreType          The type of the variable store.
+  @param[in] Store              The variable store.
+  @param[in] AuthFormat         TRUE indicates authenticated variables are used.
+                                FALSE indicates authenticated variables are not used.
+  @param[in] HashIndex          The hash index the PEI variable module built for
+                                the store, to load instead of hashing the variables
+                                of the store again, or NULL.
+
+  @retval EFI_SUCCESS           The variable store is indexed.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory for the index.
+
+**/
+EFI_STATUS
+VariableIndexInitialize (
+  IN VARIABLE_STORE_TYPE        StoreType,
+  IN VARIABLE_STORE_HEADER      *Store,
+  IN BOOLEAN                    AuthFormat,
+  IN CONST VARIABLE_HASH_INDEX  *HashIndex  OPTIONAL
+  );
+
+/**
+  Free the hash index of a variable store that is not used anymore.
+
+  @param[in] StoreType          The type of the variable store.
+
+**/
+VOID
+VariableIndexFree (
+  IN VARIABLE_STORE_TYPE        StoreType
+  );
+
+/**
+  Rebuild the hash index of a variable store after the store was rewritten,
+  such as by a reclaim.
+
+  @param[in] StoreType          The type of the variable store.
+
+**/
+VOID
+VariableIndexRebuild (
+  IN VARIABLE_STORE_TYPE        StoreType
+  );
+
+/**
+  Add the variables that were added to the end of a variable store to the hash
+  index of the store.
+
+  @param[in] StoreType          The type of the variable store.
+
+**/
+VOID
+VariableIndexUpdate (
+  IN VARIABLE_STORE_TYPE        StoreType
+  );
+
+/**
+  Find a variable in a variable store through the hash index of the store.
+
+  The variable is found the way FindVariableEx() finds it by walking the store.
+
+  @param[in]       VariableName        Name of the variable to be found, not empty.
+  @param[in]       VendorGuid          Vendor GUID to be found.
+  @param[in]       IgnoreRtCheck       Ignore EFI_VARIABLE_RUNTIME_ACCESS attribute
+                                       check at runtime when searching variable.
+  @param[in, out]  PtrTrack            Variable Track Pointer structure that contains Variable Information.
+  @param[in]       AuthFormat          TRUE indicates authenticated variables are used.
+                                       FALSE indicates authenticated variables are not used.
+
+  @retval          EFI_SUCCESS         Variable found successfully.
+  @retval          EFI_NOT_FOUND       Variable not found.
+  @retval          EFI_UNSUPPORTED     The variable store is not indexed, or its index
+                                       is not up to date, and it has to be walked.
+**/
+EFI_STATUS
+VariableIndexFind (
+  IN     CHAR16                  *VariableName,
+  IN     EFI_GUID                *VendorGuid,
+  IN     BOOLEAN                 IgnoreRtCheck,
+  IN OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  IN     BOOLEAN                 AuthFormat
+  );
+
+/**
+  Find the variable that GetNextVariableName() returned last, so the
+  enumeration of the variables continues from it without looking it up.
+
+  The variable is found only if it is the ADDED variable with the name and
+  vendor GUID, the one FindVariableEx() would find in the variable stores.
+
+  @param[in]   VariableName        Name of the variable the caller passes back, not empty.
+  @param[in]   VendorGuid          Vendor GUID of the variable the caller passes back.
+  @param[in]   VariableStoreList   A list of variable stores that should be used to get the next variable.
+                                   The maximum number of entries is the max value of VARIABLE_STORE_TYPE.
+  @param[out]  PtrTrack            Variable Track Pointer structure of the variable found.
+  @param[in]   AuthFormat          TRUE indicates authenticated variables are used.
+                                   FALSE indicates authenticated variables are not used.
+
+  @retval      EFI_SUCCESS         The variable is the one GetNextVariableName() returned last.
+  @retval      EFI_NOT_FOUND       The variable has to be looked up.
+**/
+EFI_STATUS
+VariableIndexFindCursor (
+  IN  CHAR16                  *VariableName,
+  IN  EFI_GUID                *VendorGuid,
+  IN  VARIABLE_STORE_HEADER   **VariableStoreList,
+  OUT VARIABLE_POINTER_TRACK  *PtrTrack,
+  IN  BOOLEAN                 AuthFormat
+  );
+
+/**
+  Record the variable GetNextVariableName() returns, as the cursor of the
+  enumeration of the variables.
+
+  @param[in]  PtrTrack            Variable Track Pointer structure of the variable returned.
+
+**/
+VOID
+VariableIndexSetCursor (
+  IN VARIABLE_POINTER_TRACK     *PtrTrack
+  );
+
+#endif
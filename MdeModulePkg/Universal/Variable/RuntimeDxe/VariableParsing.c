@@ -8,6 +8,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 **/
 
 #include "VariableParsing.h"
+#include "VariableIndex.h"
 
 /**
 
@@ -462,9 +463,20 @@ FindVariableEx (
 {
   VARIABLE_HEADER                *InDeletedVariable;
   VOID                           *Point;
+  EFI_STATUS                     Status;
 
   PtrTrack->InDeletedTransitionPtr = NULL;
 
+  //
+  // Look the variable up in the hash index of the variable store first.
+  //
+  if (VariableName[0] != 0) {
+    Status = VariableIndexFind (VariableName, VendorGuid, IgnoreRtCheck, PtrTrack, AuthFormat);
+    if (Status != EFI_UNSUPPORTED) {
+      return Status;
+    }
+  }
+
   //
   // Find the variable by walk through HOB, volatile and non-volatile variable store.
   //
@@ -553,8 +565,16 @@ VariableServiceGetNextVariableInternal (
 
   ZeroMem (&Variable, sizeof (Variable));
 
+  //
+  // Continue the enumeration from the variable returned last when the caller
+  // passes it back, which is how the variables are enumerated.
+  //
+  if (VariableName[0] != 0) {
+    Status = VariableIndexFindCursor (VariableName, VendorGuid, VariableStoreList, &Variable, AuthFormat);
+  }
+
   // Check if the variable exists in the given variable store list
-  for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+  for (StoreType = (VARIABLE_STORE_TYPE) 0; EFI_ERROR (Status) && StoreType < VariableStoreTypeMax; StoreType++) {
     if (VariableStoreList[StoreType] == NULL) {
       continue;
     }
@@ -677,6 +697,7 @@ VariableServiceGetNextVariableInternal (
         }
 
         *VariablePtr = Variable.CurrPtr;
+        VariableIndexSetCursor (&Variable);
         Status = EFI_SUCCESS;
         goto Done;
       }
@@ -18,6 +18,181 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 extern VARIABLE_MODULE_GLOBAL   *mVariableModuleGlobal;
 extern VARIABLE_STORE_HEADER    *mNvVariableCache;
 
+//
+// TRUE while the flushes of the pending updates to the runtime variable caches are deferred
+//
+BOOLEAN                         mRuntimeVariableCacheFlushDeferred = FALSE;
+
+/**
+  Check whether a pending update rewrites a runtime variable cache from its start.
+
+  A pending update from the start of a runtime cache, such as the update after a reclaim,
+  moves the variables of the cache, and the cache must be indexed again.  The updates of
+  the variables in place, and of the variables added to the end of the cache, start after
+  the variable store header.
+
+  @param[in] VariableRuntimeCache Variable runtime cache structure for the runtime cache being updated.
+
+  @retval TRUE                    The pending update rewrites the runtime cache.
+  @retval FALSE                   The pending update leaves the variables of the runtime cache in place.
+
+**/
+BOOLEAN
+IsRuntimeVariableCacheRewrite (
+  IN  VARIABLE_RUNTIME_CACHE          *VariableRuntimeCache
+  )
+{
+  return (BOOLEAN) (VariableRuntimeCache->PendingUpdateCount > 0 && VariableRuntimeCache->PendingUpdates[0].Offset == 0);
+}
+
+/**
+  Merges the two closest ranges of the journal of the pending updates of a runtime variable
+  cache, to make room in the journal for a new range.
+
+  The merged range also covers the gap between the two ranges, so the fewest bytes that are
+  not pending an update are copied to the runtime cache.
+
+  @param[in, out] VariableRuntimeCache Variable runtime cache structure for the runtime cache being updated.
+
+**/
+VOID
+MergeClosestRuntimeVariableCachePendingUpdates (
+  IN OUT  VARIABLE_RUNTIME_CACHE      *VariableRuntimeCache
+  )
+{
+  VARIABLE_RUNTIME_CACHE_UPDATE       *Updates;
+  UINT32                              Index;
+  UINT32                              ClosestIndex;
+  UINT32                              Gap;
+  UINT32                              ClosestGap;
+
+  Updates      = VariableRuntimeCache->PendingUpdates;
+  ClosestIndex = 0;
+  ClosestGap   = MAX_UINT32;
+  for (Index = 0; Index + 1 < VariableRuntimeCache->PendingUpdateCount; Index++) {
+    Gap = Updates[Index + 1].Offset - (Updates[Index].Offset + Updates[Index].Length);
+    if (Gap < ClosestGap) {
+      ClosestGap   = Gap;
+      ClosestIndex = Index;
+    }
+  }
+
+  Updates[ClosestIndex].Length = Updates[ClosestIndex + 1].Offset + Updates[ClosestIndex + 1].Length -
+                                 Updates[ClosestIndex].Offset;
+  CopyMem (
+    &Updates[ClosestIndex + 1],
+    &Updates[ClosestIndex + 2],
+    (VariableRuntimeCache->PendingUpdateCount - ClosestIndex - 2) * sizeof (*Updates)
+    );
+  VariableRuntimeCache->PendingUpdateCount--;
+}
+
+/**
+  Adds a range to the journal of the pending updates of a runtime variable cache.
+
+  The range is merged with the pending updates it overlaps or is adjacent to, so a run of
+  writes to neighboring bytes, such as the header and the data of a variable, is copied to
+  the runtime cache at once.
+
+  @param[in, out] VariableRuntimeCache Variable runtime cache structure for the runtime cache being updated.
+  @param[in]      Offset               Offset in bytes of the range to update.
+  @param[in]      Length               Length in bytes of the range to update.
+
+**/
+VOID
+AddRuntimeVariableCachePendingUpdate (
+  IN OUT  VARIABLE_RUNTIME_CACHE      *VariableRuntimeCache,
+  IN      UINT32                      Offset,
+  IN      UINT32                      Length
+  )
+{
+  VARIABLE_RUNTIME_CACHE_UPDATE       *Updates;
+  UINT32                              Index;
+  UINT32                              Last;
+  UINT32                              Start;
+  UINT32                              End;
+
+  if (Length == 0) {
+    return;
+  }
+
+  Updates = VariableRuntimeCache->PendingUpdates;
+  while (TRUE) {
+    //
+    // Find the first pending update that ends at or after the start of the range, and
+    // the pending updates that overlap or are adjacent to the range.
+    //
+    Start = Offset;
+    End   = Offset + Length;
+    for (Index = 0; Index < VariableRuntimeCache->PendingUpdateCount; Index++) {
+      if (Updates[Index].Offset + Updates[Index].Length >= Start) {
+        break;
+      }
+    }
+    for (Last = Index; Last < VariableRuntimeCache->PendingUpdateCount; Last++) {
+      if (Updates[Last].Offset > End) {
+        break;
+      }
+      Start = MIN (Start, Updates[Last].Offset);
+      End   = MAX (End, Updates[Last].Offset + Updates[Last].Length);
+    }
+
+    if (Last > Index || VariableRuntimeCache->PendingUpdateCount < VARIABLE_RUNTIME_CACHE_PENDING_UPDATE_MAX) {
+      break;
+    }
+
+    //
+    // The range is a new one and the journal is full.  The merged range may overlap the
+    // range, so look for the pending updates it overlaps again.
+    //
+    MergeClosestRuntimeVariableCachePendingUpdates (VariableRuntimeCache);
+  }
+
+  if (Last == Index) {
+    CopyMem (
+      &Updates[Index + 1],
+      &Updates[Index],
+      (VariableRuntimeCache->PendingUpdateCount - Index) * sizeof (*Updates)
+      );
+    VariableRuntimeCache->PendingUpdateCount++;
+  } else if (Last > Index + 1) {
+    CopyMem (
+      &Updates[Index + 1],
+      &Updates[Last],
+      (VariableRuntimeCache->PendingUpdateCount - Last) * sizeof (*Updates)
+      );
+    VariableRuntimeCache->PendingUpdateCount -= Last - Index - 1;
+  }
+  Updates[Index].Offset = Start;
+  Updates[Index].Length = End - Start;
+}
+
+/**
+  Copies the pending updates of a runtime variable cache from its variable store, and
+  empties the journal of the pending updates.
+
+  @param[in, out] VariableRuntimeCache Variable runtime cache structure for the runtime cache being updated.
+  @param[in]      VariableStore        The variable store the runtime cache is a copy of.
+
+**/
+VOID
+CopyRuntimeVariableCachePendingUpdates (
+  IN OUT  VARIABLE_RUNTIME_CACHE      *VariableRuntimeCache,
+  IN      VARIABLE_STORE_HEADER       *VariableStore
+  )
+{
+  UINT32                              Index;
+
+  for (Index = 0; Index < VariableRuntimeCache->PendingUpdateCount; Index++) {
+    CopyMem (
+      (VOID *) ((UINT8 *) VariableRuntimeCache->Store + VariableRuntimeCache->PendingUpdates[Index].Offset),
+      (VOID *) ((UINT8 *) VariableStore + VariableRuntimeCache->PendingUpdates[Index].Offset),
+      VariableRuntimeCache->PendingUpdates[Index].Length
+      );
+  }
+  VariableRuntimeCache->PendingUpdateCount = 0;
+}
+
 /**
   Copies any pending updates to runtime variable caches.
 
@@ -36,55 +211,37 @@ FlushPendingRuntimeVariableCacheUpdates (
 
   if (VariableRuntimeCacheContext->VariableRuntimeNvCache.Store == NULL ||
       VariableRuntimeCacheContext->VariableRuntimeVolatileCache.Store == NULL ||
-      VariableRuntimeCacheContext->PendingUpdate == NULL) {
+      VariableRuntimeCacheContext->PendingUpdate == NULL ||
+      VariableRuntimeCacheContext->CacheRewritten == NULL) {
     return EFI_UNSUPPORTED;
   }
 
   if (*(VariableRuntimeCacheContext->PendingUpdate)) {
+    if (IsRuntimeVariableCacheRewrite (&VariableRuntimeCacheContext->VariableRuntimeNvCache) ||
+        IsRuntimeVariableCacheRewrite (&VariableRuntimeCacheContext->VariableRuntimeVolatileCache)) {
+      *(VariableRuntimeCacheContext->CacheRewritten) = TRUE;
+    }
+
     if (VariableRuntimeCacheContext->VariableRuntimeHobCache.Store != NULL &&
         mVariableModuleGlobal->VariableGlobal.HobVariableBase > 0) {
-      CopyMem (
-        (VOID *) (
-          ((UINT8 *) (UINTN) VariableRuntimeCacheContext->VariableRuntimeHobCache.Store) +
-          VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateOffset
-          ),
-        (VOID *) (
-          ((UINT8 *) (UINTN) mVariableModuleGlobal->VariableGlobal.HobVariableBase) +
-          VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateOffset
-          ),
-        VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateLength
+      if (IsRuntimeVariableCacheRewrite (&VariableRuntimeCacheContext->VariableRuntimeHobCache)) {
+        *(VariableRuntimeCacheContext->CacheRewritten) = TRUE;
+      }
+      CopyRuntimeVariableCachePendingUpdates (
+        &VariableRuntimeCacheContext->VariableRuntimeHobCache,
+        (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.HobVariableBase
         );
-      VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateLength = 0;
-      VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateOffset = 0;
     }
+    VariableRuntimeCacheContext->VariableRuntimeHobCache.PendingUpdateCount = 0;
 
-    CopyMem (
-      (VOID *) (
-        ((UINT8 *) (UINTN) VariableRuntimeCacheContext->VariableRuntimeNvCache.Store) +
-        VariableRuntimeCacheContext->VariableRuntimeNvCache.PendingUpdateOffset
-        ),
-      (VOID *) (
-        ((UINT8 *) (UINTN) mNvVariableCache) +
-        VariableRuntimeCacheContext->VariableRuntimeNvCache.PendingUpdateOffset
-        ),
-      VariableRuntimeCacheContext->VariableRuntimeNvCache.PendingUpdateLength
+    CopyRuntimeVariableCachePendingUpdates (
+      &VariableRuntimeCacheContext->VariableRuntimeNvCache,
+      mNvVariableCache
       );
-    VariableRuntimeCacheContext->VariableRuntimeNvCache.PendingUpdateLength = 0;
-    VariableRuntimeCacheContext->VariableRuntimeNvCache.PendingUpdateOffset = 0;
-
-    CopyMem (
-      (VOID *) (
-        ((UINT8 *) (UINTN) VariableRuntimeCacheContext->VariableRuntimeVolatileCache.Store) +
-        VariableRuntimeCacheContext->VariableRuntimeVolatileCache.PendingUpdateOffset
-      ),
-      (VOID *) (
-        ((UINT8 *) (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase) +
-        VariableRuntimeCacheContext->VariableRuntimeVolatileCache.PendingUpdateOffset
-        ),
-      VariableRuntimeCacheContext->VariableRuntimeVolatileCache.PendingUpdateLength
+    CopyRuntimeVariableCachePendingUpdates (
+      &VariableRuntimeCacheContext->VariableRuntimeVolatileCache,
+      (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase
       );
-    VariableRuntimeCacheContext->VariableRuntimeVolatileCache.PendingUpdateLength = 0;
-    VariableRuntimeCacheContext->VariableRuntimeVolatileCache.PendingUpdateOffset = 0;
     *(VariableRuntimeCacheContext->PendingUpdate) = FALSE;
   }
 
@@ -96,8 +253,12 @@ FlushPendingRuntimeVariableCacheUpdates (
 
   Ensures all conditions are met to maintain coherency for runtime cache updates. This function will attempt
   to write the given update (and any other pending updates) if the ReadLock is available. Otherwise, the
-  update is added as a pending update for the given variable store and it will be flushed to the runtime cache
-  at the next opportunity the ReadLock is available.
+  update is added to the journal of the pending updates for the given variable store and it will be flushed
+  to the runtime cache at the next opportunity the ReadLock is available.
+
+  Only the ranges in the journal are copied to the runtime cache, so the callers pass the ranges of the
+  variable store they changed, such as the header of a variable whose state changed and a variable added
+  to the end of the store, rather than the whole store.
 
   @param[in] VariableRuntimeCache Variable runtime cache structure for the runtime cache being synchronized.
   @param[in] Offset               Offset in bytes to apply the update.
@@ -128,26 +289,49 @@ SynchronizeRuntimeVariableCache (
     return EFI_UNSUPPORTED;
   }
 
-  if (*(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.PendingUpdate) &&
-      VariableRuntimeCache->PendingUpdateLength > 0) {
-    VariableRuntimeCache->PendingUpdateLength =
-      (UINT32) (
-        MAX (
-          (UINTN) (VariableRuntimeCache->PendingUpdateOffset + VariableRuntimeCache->PendingUpdateLength),
-          Offset + Length
-        ) - MIN ((UINTN) VariableRuntimeCache->PendingUpdateOffset, Offset)
-      );
-    VariableRuntimeCache->PendingUpdateOffset =
-      (UINT32) MIN ((UINTN) VariableRuntimeCache->PendingUpdateOffset, Offset);
-  } else {
-    VariableRuntimeCache->PendingUpdateLength = (UINT32) Length;
-    VariableRuntimeCache->PendingUpdateOffset = (UINT32) Offset;
+  if (!*(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.PendingUpdate)) {
+    VariableRuntimeCache->PendingUpdateCount = 0;
   }
+  AddRuntimeVariableCachePendingUpdate (VariableRuntimeCache, (UINT32) Offset, (UINT32) Length);
   *(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.PendingUpdate) = TRUE;
 
-  if (*(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.ReadLock) == FALSE) {
+  if (!mRuntimeVariableCacheFlushDeferred &&
+      *(mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext.ReadLock) == FALSE) {
     return FlushPendingRuntimeVariableCacheUpdates ();
   }
 
   return EFI_SUCCESS;
 }
+
+/**
+  Defers the flushes of the pending updates to the runtime variable caches, or ends the deferral.
+
+  The updates a batch of variables makes to the variable stores are accumulated as pending
+  updates while the flushes are deferred, and they are copied to the runtime variable caches
+  once, when the deferral ends, instead of after each variable of the batch.
+
+  @param[in] Defer                TRUE to defer the flushes of the pending updates.
+                                  FALSE to end the deferral, and flush the pending updates
+                                  if the ReadLock of the runtime variable caches is available.
+
+**/
+VOID
+DeferRuntimeVariableCacheFlush (
+  IN  BOOLEAN                         Defer
+  )
+{
+  VARIABLE_RUNTIME_CACHE_CONTEXT    *VariableRuntimeCacheContext;
+
+  mRuntimeVariableCacheFlushDeferred = Defer;
+  if (Defer) {
+    return;
+  }
+
+  VariableRuntimeCacheContext = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext;
+  if (VariableRuntimeCacheContext->PendingUpdate != NULL &&
+      VariableRuntimeCacheContext->ReadLock != NULL &&
+      *(VariableRuntimeCacheContext->PendingUpdate) &&
+      *(VariableRuntimeCacheContext->ReadLock) == FALSE) {
+    FlushPendingRuntimeVariableCacheUpdates ();
+  }
+}
@@ -24,6 +24,25 @@ FlushPendingRuntimeVariableCacheUpdates (
   VOID
   );
 
+/**
+  Adds a range to the journal of the pending updates of a runtime variable cache.
+
+  The range is merged with the pending updates it overlaps or is adjacent to, so a run of
+  writes to neighboring bytes, such as the header and the data of a variable, is copied to
+  the runtime cache at once.
+
+  @param[in, out] VariableRuntimeCache Variable runtime cache structure for the runtime cache being updated.
+  @param[in]      Offset               Offset in bytes of the range to update.
+  @param[in]      Length               Length in bytes of the range to update.
+
+**/
+VOID
+AddRuntimeVariableCachePendingUpdate (
+  IN OUT  VARIABLE_RUNTIME_CACHE      *VariableRuntimeCache,
+  IN      UINT32                      Offset,
+  IN      UINT32                      Length
+  );
+
 /**
   Synchronizes the runtime variable caches with all pending updates outside runtime.
 
@@ -48,4 +67,21 @@ SynchronizeRuntimeVariableCache (
   IN  UINTN                           Length
   );
 
+/**
+  Defers the flushes of the pending updates to the runtime variable caches, or ends the deferral.
+
+  The updates a batch of variables makes to the variable stores are accumulated as pending
+  updates while the flushes are deferred, and they are copied to the runtime variable caches
+  once, when the deferral ends, instead of after each variable of the batch.
+
+  @param[in] Defer                TRUE to defer the flushes of the pending updates.
+                                  FALSE to end the deferral, and flush the pending updates
+                                  if the ReadLock of the runtime variable caches is available.
+
+**/
+VOID
+DeferRuntimeVariableCacheFlush (
+  IN  BOOLEAN                         Defer
+  );
+
 #endif
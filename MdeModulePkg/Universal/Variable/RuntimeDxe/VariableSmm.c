@@ -12,7 +12,8 @@
 
   Each sub function VariableServiceGetVariable(), VariableServiceGetNextVariableName(),
   VariableServiceSetVariable(), VariableServiceQueryVariableInfo(), ReclaimForOS(),
-  SmmVariableGetStatistics() should also do validation based on its own knowledge.
+  SmmVariableGetStatistics(), SmmVariableSetVariableBatch() should also do validation
+  based on its own knowledge.
 
 Copyright (c) 2010 - 2019, Intel Corporation. All rights reserved.<BR>
 Copyright (c) 2018, Linaro, Ltd. All rights reserved.<BR>
@@ -425,6 +426,114 @@ SmmVariableGetStatistics (
 }
 
 
+/**
+  Set the variables of a batched SetVariable request.
+
+  Caution: This function may receive untrusted input.
+  The batch is external input, so the size and the name of each variable of the batch
+  are validated before any variable of the batch is set.
+
+  @param[in, out] SetVariableBatch  The batch, copied to SMRAM.  Returns the status of
+                                    each variable of the batch.
+  @param[in]      BatchSize         The size in bytes of the batch.
+
+  @retval EFI_SUCCESS               All the variables of the batch were set.
+  @retval EFI_ACCESS_DENIED         The batch is invalid.  No variable was set.
+  @retval EFI_OUT_OF_RESOURCES      There is not enough resource for the batch.
+                                    No variable was set.
+  @retval Others                    See VariableServiceSetVariableBatch().
+
+**/
+EFI_STATUS
+SmmVariableSetVariableBatch (
+  IN OUT SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH  *SetVariableBatch,
+  IN     UINTN                                        BatchSize
+  )
+{
+  EFI_STATUS                                          Status;
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE             *BatchVariable;
+  EDKII_VARIABLE_BATCH_ENTRY                          *Variables;
+  UINTN                                               VariableCount;
+  UINTN                                               Offset;
+  UINTN                                               Index;
+
+  //
+  // Each variable of the batch takes at least the size of its header, which bounds
+  // the number of variables the batch holds.
+  //
+  VariableCount = SetVariableBatch->VariableCount;
+  if (VariableCount > (BatchSize - sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH)) /
+                      OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE, Name)) {
+    return EFI_ACCESS_DENIED;
+  }
+  if (VariableCount == 0) {
+    return EFI_SUCCESS;
+  }
+
+  Variables = AllocatePool (VariableCount * sizeof (EDKII_VARIABLE_BATCH_ENTRY));
+  if (Variables == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  Status = EFI_SUCCESS;
+  Offset = sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH);
+  for (Index = 0; Index < VariableCount; Index++) {
+    if ((Offset > BatchSize) ||
+        (BatchSize - Offset < OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE, Name))) {
+      Status = EFI_ACCESS_DENIED;
+      break;
+    }
+    BatchVariable = (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE *) ((UINT8 *) SetVariableBatch + Offset);
+    if ((BatchVariable->NameSize > BatchSize - Offset - OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE, Name)) ||
+        (BatchVariable->DataSize > BatchSize - Offset - OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE, Name) - BatchVariable->NameSize)) {
+      //
+      // The variable does not fit in the communicate buffer.
+      //
+      Status = EFI_ACCESS_DENIED;
+      break;
+    }
+
+    //
+    // The VariableSpeculationBarrier() call here is to ensure the previous
+    // range/content checks for the CommBuffer have been completed before the
+    // subsequent consumption of the CommBuffer content.
+    //
+    VariableSpeculationBarrier ();
+    if (BatchVariable->NameSize < sizeof (CHAR16) || BatchVariable->Name[BatchVariable->NameSize/sizeof (CHAR16) - 1] != L'\0') {
+      //
+      // Make sure VariableName is A Null-terminated string.
+      //
+      Status = EFI_ACCESS_DENIED;
+      break;
+    }
+
+    Variables[Index].VariableName = BatchVariable->Name;
+    Variables[Index].VendorGuid   = &BatchVariable->Guid;
+    Variables[Index].Attributes   = BatchVariable->Attributes;
+    Variables[Index].DataSize     = BatchVariable->DataSize;
+    Variables[Index].Data         = (UINT8 *) BatchVariable->Name + BatchVariable->NameSize;
+    Variables[Index].Status       = EFI_NOT_STARTED;
+    Offset += SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE_SIZE (BatchVariable->NameSize, BatchVariable->DataSize);
+  }
+
+  if (!EFI_ERROR (Status)) {
+    Status = VariableServiceSetVariableBatch (VariableCount, Variables);
+  } else {
+    VariableCount = Index;
+  }
+
+  //
+  // Return the status of each variable of the batch.
+  //
+  for (Index = 0; Index < VariableCount; Index++) {
+    BatchVariable = BASE_CR (Variables[Index].VendorGuid, SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE, Guid);
+    BatchVariable->Status = Variables[Index].Status;
+  }
+
+  FreePool (Variables);
+  return Status;
+}
+
 /**
   Communication service SMI Handler entry.
 
@@ -434,7 +543,8 @@ SmmVariableGetStatistics (
   This variable data and communicate buffer are external input, so this function will do basic validation.
   Each sub function VariableServiceGetVariable(), VariableServiceGetNextVariableName(),
   VariableServiceSetVariable(), VariableServiceQueryVariableInfo(), ReclaimForOS(),
-  SmmVariableGetStatistics() should also do validation based on its own knowledge.
+  SmmVariableGetStatistics(), SmmVariableSetVariableBatch() should also do validation
+  based on its own knowledge.
 
   @param[in]     DispatchHandle  The unique handle assigned to this handler by SmiHandlerRegister().
   @param[in]     RegisterContext Points to an optional handler context which was specified when the
@@ -470,6 +580,7 @@ SmmVariableHandler (
   SMM_VARIABLE_COMMUNICATE_GET_RUNTIME_CACHE_INFO         *GetRuntimeCacheInfo;
   SMM_VARIABLE_COMMUNICATE_LOCK_VARIABLE                  *VariableToLock;
   SMM_VARIABLE_COMMUNICATE_VAR_CHECK_VARIABLE_PROPERTY    *CommVariableProperty;
+  SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH             *SetVariableBatch;
   VARIABLE_INFO_ENTRY                                     *VariableInfo;
   VARIABLE_RUNTIME_CACHE_CONTEXT                          *VariableCacheContext;
   VARIABLE_STORE_HEADER                                   *VariableCache;
@@ -821,7 +932,8 @@ SmmVariableHandler (
           RuntimeVariableCacheContext->RuntimeNvCache == NULL ||
           RuntimeVariableCacheContext->PendingUpdate == NULL ||
           RuntimeVariableCacheContext->ReadLock == NULL ||
-          RuntimeVariableCacheContext->HobFlushComplete == NULL) {
+          RuntimeVariableCacheContext->HobFlushComplete == NULL ||
+          RuntimeVariableCacheContext->CacheRewritten == NULL) {
         DEBUG ((DEBUG_ERROR, "InitRuntimeVariableCacheContext: Required runtime cache buffer is NULL!\n"));
         Status = EFI_ACCESS_DENIED;
         goto EXIT;
@@ -885,6 +997,13 @@ SmmVariableHandler (
         Status = EFI_ACCESS_DENIED;
         goto EXIT;
       }
+      if (!VariableSmmIsBufferOutsideSmmValid (
+            (UINTN) RuntimeVariableCacheContext->CacheRewritten,
+            sizeof (*(RuntimeVariableCacheContext->CacheRewritten)))) {
+        DEBUG ((DEBUG_ERROR, "InitRuntimeVariableCacheContext: Runtime cache rewritten buffer in SMRAM or overflow!\n"));
+        Status = EFI_ACCESS_DENIED;
+        goto EXIT;
+      }
 
       VariableCacheContext = &mVariableModuleGlobal->VariableGlobal.VariableRuntimeCacheContext;
       VariableCacheContext->VariableRuntimeHobCache.Store      = RuntimeVariableCacheContext->RuntimeHobCache;
@@ -893,29 +1012,42 @@ SmmVariableHandler (
       VariableCacheContext->PendingUpdate                      = RuntimeVariableCacheContext->PendingUpdate;
       VariableCacheContext->ReadLock                           = RuntimeVariableCacheContext->ReadLock;
       VariableCacheContext->HobFlushComplete                   = RuntimeVariableCacheContext->HobFlushComplete;
+      VariableCacheContext->CacheRewritten                     = RuntimeVariableCacheContext->CacheRewritten;
 
       // Set up the intial pending request since the RT cache needs to be in sync with SMM cache
-      VariableCacheContext->VariableRuntimeHobCache.PendingUpdateOffset = 0;
-      VariableCacheContext->VariableRuntimeHobCache.PendingUpdateLength = 0;
+      VariableCacheContext->VariableRuntimeHobCache.PendingUpdateCount = 0;
       if (mVariableModuleGlobal->VariableGlobal.HobVariableBase > 0 &&
           VariableCacheContext->VariableRuntimeHobCache.Store != NULL) {
         VariableCache = (VARIABLE_STORE_HEADER *) (UINTN) mVariableModuleGlobal->VariableGlobal.HobVariableBase;
-        VariableCacheContext->VariableRuntimeHobCache.PendingUpdateLength = (UINT32) ((UINTN) GetEndPointer (VariableCache) - (UINTN) VariableCache);
+        AddRuntimeVariableCachePendingUpdate (
+          &VariableCacheContext->VariableRuntimeHobCache,
+          0,
+          (UINT32) ((UINTN) GetEndPointer (VariableCache) - (UINTN) VariableCache)
+          );
         CopyGuid (&(VariableCacheContext->VariableRuntimeHobCache.Store->Signature), &(VariableCache->Signature));
       }
       VariableCache = (VARIABLE_STORE_HEADER  *) (UINTN) mVariableModuleGlobal->VariableGlobal.VolatileVariableBase;
-      VariableCacheContext->VariableRuntimeVolatileCache.PendingUpdateOffset   = 0;
-      VariableCacheContext->VariableRuntimeVolatileCache.PendingUpdateLength   = (UINT32) ((UINTN) GetEndPointer (VariableCache) - (UINTN) VariableCache);
+      VariableCacheContext->VariableRuntimeVolatileCache.PendingUpdateCount = 0;
+      AddRuntimeVariableCachePendingUpdate (
+        &VariableCacheContext->VariableRuntimeVolatileCache,
+        0,
+        (UINT32) ((UINTN) GetEndPointer (VariableCache) - (UINTN) VariableCache)
+        );
       CopyGuid (&(VariableCacheContext->VariableRuntimeVolatileCache.Store->Signature), &(VariableCache->Signature));
 
       VariableCache = (VARIABLE_STORE_HEADER  *) (UINTN) mNvVariableCache;
-      VariableCacheContext->VariableRuntimeNvCache.PendingUpdateOffset = 0;
-      VariableCacheContext->VariableRuntimeNvCache.PendingUpdateLength = (UINT32) ((UINTN) GetEndPointer (VariableCache) - (UINTN) VariableCache);
+      VariableCacheContext->VariableRuntimeNvCache.PendingUpdateCount = 0;
+      AddRuntimeVariableCachePendingUpdate (
+        &VariableCacheContext->VariableRuntimeNvCache,
+        0,
+        (UINT32) ((UINTN) GetEndPointer (VariableCache) - (UINTN) VariableCache)
+        );
       CopyGuid (&(VariableCacheContext->VariableRuntimeNvCache.Store->Signature), &(VariableCache->Signature));
 
       *(VariableCacheContext->PendingUpdate) = TRUE;
       *(VariableCacheContext->ReadLock) = FALSE;
       *(VariableCacheContext->HobFlushComplete) = FALSE;
+      *(VariableCacheContext->CacheRewritten) = FALSE;
 
       Status = EFI_SUCCESS;
       break;
@@ -945,6 +1077,21 @@ SmmVariableHandler (
       Status = EFI_SUCCESS;
       break;
 
+    case SMM_VARIABLE_FUNCTION_SET_VARIABLE_BATCH:
+      if (CommBufferPayloadSize < sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH)) {
+        DEBUG ((DEBUG_ERROR, "SetVariableBatch: SMM communication buffer size invalid!\n"));
+        return EFI_SUCCESS;
+      }
+      //
+      // Copy the input communicate buffer payload to pre-allocated SMM variable buffer payload.
+      //
+      CopyMem (mVariableBufferPayload, SmmVariableFunctionHeader->Data, CommBufferPayloadSize);
+      SetVariableBatch = (SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH *) mVariableBufferPayload;
+
+      Status = SmmVariableSetVariableBatch (SetVariableBatch, CommBufferPayloadSize);
+      CopyMem (SmmVariableFunctionHeader->Data, mVariableBufferPayload, CommBufferPayloadSize);
+      break;
+
     default:
       Status = EFI_UNSUPPORTED;
   }
@@ -23,6 +23,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/SmmCommunication.h>
 #include <Protocol/SmmVariable.h>
 #include <Protocol/VariableLock.h>
+#include <Protocol/VariableBatch.h>
 #include <Protocol/VarCheck.h>
 
 #include <Library/UefiBootServicesTableLib.h>
@@ -40,6 +41,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include "PrivilegePolymorphic.h"
 #include "VariableParsing.h"
+#include "VariableIndex.h"
 
 EFI_HANDLE                       mHandle                    = NULL;
 EFI_SMM_VARIABLE_PROTOCOL       *mSmmVariable               = NULL;
@@ -60,8 +62,10 @@ BOOLEAN                          mVariableRuntimeCachePendingUpdate;
 BOOLEAN                          mVariableRuntimeCacheReadLock;
 BOOLEAN                          mVariableAuthFormat;
 BOOLEAN                          mHobFlushComplete;
+BOOLEAN                          mVariableRuntimeCacheRewritten;
 EFI_LOCK                         mVariableServicesLock;
 EDKII_VARIABLE_LOCK_PROTOCOL     mVariableLock;
+EDKII_VARIABLE_BATCH_PROTOCOL    mVariableBatch;
 EDKII_VAR_CHECK_PROTOCOL         mVarCheck;
 
 /**
@@ -529,12 +533,17 @@ SyncRuntimeCache (
   If the variable HOB was finished being flushed since the last check for a runtime cache update, this function
   will prevent the HOB cache from being used for future runtime cache hits.
 
+  The variables added to the runtime caches since the last check are added to the indexes of the caches, which
+  are rebuilt if a cache was rewritten.  This function must be called with the runtime cache read lock acquired.
+
 **/
 VOID
 CheckForRuntimeCacheSync (
   VOID
   )
 {
+  VARIABLE_STORE_TYPE     StoreType;
+
   if (mVariableRuntimeCachePendingUpdate) {
     SyncRuntimeCache ();
   }
@@ -548,7 +557,17 @@ CheckForRuntimeCacheSync (
       FreePages (mVariableRuntimeHobCacheBuffer, EFI_SIZE_TO_PAGES (mVariableRuntimeHobCacheBufferSize));
     }
     mVariableRuntimeHobCacheBuffer = NULL;
+    VariableIndexFree (VariableStoreTypeHob);
   }
+
+  for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+    if (mVariableRuntimeCacheRewritten) {
+      VariableIndexRebuild (StoreType);
+    } else {
+      VariableIndexUpdate (StoreType);
+    }
+  }
+  mVariableRuntimeCacheRewritten = FALSE;
 }
 
 /**
@@ -859,9 +878,9 @@ GetNextVariableNameInRuntimeCache (
   //
   ASSERT (!mVariableRuntimeCacheReadLock);
 
+  mVariableRuntimeCacheReadLock = TRUE;
   CheckForRuntimeCacheSync ();
 
-  mVariableRuntimeCacheReadLock = TRUE;
   if (!mVariableRuntimeCachePendingUpdate) {
     //
     // 0: Volatile, 1: HOB, 2: Non-Volatile.
@@ -1146,6 +1165,149 @@ Done:
 }
 
 
+/**
+  Set a batch of variables.
+
+  The variables are set in order, the way SetVariable() sets them, until all of them
+  are set or one of them fails.  Before any variable is set, the batch is checked,
+  and the space the non-volatile variables of the batch need is reserved in the
+  non-volatile variable store.
+
+  The batch is sent to SMM in one SMI, so that SMM checks and reserves space for the
+  whole batch before it sets any variable.  A batch larger than the communicate buffer
+  is rejected rather than split, as the SMIs before a failing one could not be undone.
+
+  @param[in]      This           The EDKII_VARIABLE_BATCH_PROTOCOL instance.
+  @param[in]      VariableCount  The number of variables in Variables.
+  @param[in, out] Variables      The variables to set.  Returns the status of each
+                                 variable in its Status field.
+
+  @retval EFI_SUCCESS            All the variables were set.
+  @retval EFI_INVALID_PARAMETER  Variables is NULL and VariableCount is not 0, or the
+                                 parameters of a variable are invalid.  No variable
+                                 was set.
+  @retval EFI_OUT_OF_RESOURCES   There is not enough space in the variable store for
+                                 the non-volatile variables of the batch.  No variable
+                                 was set.
+  @retval EFI_BAD_BUFFER_SIZE    The batch is too large to be set at once.  No variable
+                                 was set.
+  @retval Others                 The variable whose Status is not EFI_SUCCESS nor
+                                 EFI_NOT_STARTED failed with this status.  The
+                                 variables before it were set.
+**/
+EFI_STATUS
+EFIAPI
+VariableBatchSetVariables (
+  IN CONST EDKII_VARIABLE_BATCH_PROTOCOL *This,
+  IN       UINTN                         VariableCount,
+  IN OUT   EDKII_VARIABLE_BATCH_ENTRY    *Variables
+  )
+{
+  EFI_STATUS                                    Status;
+  UINTN                                         Index;
+  UINTN                                         PayloadSize;
+  UINTN                                         VariableSize;
+  UINTN                                         VariableNameSize;
+  SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH   *SetVariableBatch;
+  SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE       *BatchVariable;
+
+  if (VariableCount == 0) {
+    return EFI_SUCCESS;
+  }
+  if (Variables == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  for (Index = 0; Index < VariableCount; Index++) {
+    Variables[Index].Status = EFI_NOT_STARTED;
+  }
+
+  //
+  // Check input parameters, and make sure the whole batch fits in the communicate buffer.
+  //
+  PayloadSize = sizeof (SMM_VARIABLE_COMMUNICATE_SET_VARIABLE_BATCH);
+  for (Index = 0; Index < VariableCount; Index++) {
+    if (Variables[Index].VariableName == NULL || Variables[Index].VariableName[0] == 0 ||
+        Variables[Index].VendorGuid == NULL ||
+        (Variables[Index].DataSize != 0 && Variables[Index].Data == NULL)) {
+      Variables[Index].Status = EFI_INVALID_PARAMETER;
+      return EFI_INVALID_PARAMETER;
+    }
+
+    VariableNameSize = StrSize (Variables[Index].VariableName);
+    VariableSize     = mVariableBufferPayloadSize - PayloadSize;
+    if ((VariableSize < OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE, Name)) ||
+        (VariableNameSize > VariableSize - OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE, Name)) ||
+        (Variables[Index].DataSize > VariableSize - OFFSET_OF (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE, Name) - VariableNameSize) ||
+        (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE_SIZE (VariableNameSize, Variables[Index].DataSize) > VariableSize)) {
+      return EFI_BAD_BUFFER_SIZE;
+    }
+    PayloadSize += SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE_SIZE (VariableNameSize, Variables[Index].DataSize);
+  }
+
+  AcquireLockOnlyAtBootTime(&mVariableServicesLock);
+
+  //
+  // Init the communicate buffer. The buffer data size is:
+  // SMM_COMMUNICATE_HEADER_SIZE + SMM_VARIABLE_COMMUNICATE_HEADER_SIZE + PayloadSize.
+  //
+  Status = InitCommunicateBuffer ((VOID **) &SetVariableBatch, PayloadSize, SMM_VARIABLE_FUNCTION_SET_VARIABLE_BATCH);
+  if (EFI_ERROR (Status)) {
+    goto Done;
+  }
+  ASSERT (SetVariableBatch != NULL);
+
+  SetVariableBatch->VariableCount = VariableCount;
+  BatchVariable = (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE *) (SetVariableBatch + 1);
+  for (Index = 0; Index < VariableCount; Index++) {
+    VariableNameSize          = StrSize (Variables[Index].VariableName);
+    BatchVariable->Status     = EFI_NOT_STARTED;
+    CopyGuid (&BatchVariable->Guid, Variables[Index].VendorGuid);
+    BatchVariable->DataSize   = Variables[Index].DataSize;
+    BatchVariable->NameSize   = VariableNameSize;
+    BatchVariable->Attributes = Variables[Index].Attributes;
+    CopyMem (BatchVariable->Name, Variables[Index].VariableName, VariableNameSize);
+    CopyMem ((UINT8 *) BatchVariable->Name + VariableNameSize, Variables[Index].Data, BatchVariable->DataSize);
+    BatchVariable = (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE *) (
+                      (UINT8 *) BatchVariable +
+                      SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE_SIZE (VariableNameSize, BatchVariable->DataSize)
+                      );
+  }
+
+  //
+  // Send data to SMM, and get the status of each variable back.
+  //
+  Status = SendCommunicateBuffer (PayloadSize);
+
+  BatchVariable = (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE *) (SetVariableBatch + 1);
+  for (Index = 0; Index < VariableCount; Index++) {
+    Variables[Index].Status = BatchVariable->Status;
+    BatchVariable = (SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE *) (
+                      (UINT8 *) BatchVariable +
+                      SMM_VARIABLE_COMMUNICATE_BATCH_VARIABLE_SIZE (
+                        StrSize (Variables[Index].VariableName),
+                        Variables[Index].DataSize
+                        )
+                      );
+  }
+
+Done:
+  ReleaseLockOnlyAtBootTime (&mVariableServicesLock);
+
+  if (!EfiAtRuntime ()) {
+    for (Index = 0; Index < VariableCount; Index++) {
+      if (Variables[Index].Status == EFI_SUCCESS) {
+        SecureBootHook (
+          Variables[Index].VariableName,
+          Variables[Index].VendorGuid
+          );
+      }
+    }
+  }
+  return Status;
+}
+
+
 /**
   This code returns information about the EFI variables.
 
@@ -1306,11 +1468,18 @@ VariableAddressChangeEvent (
   IN VOID                                   *Context
   )
 {
+  VARIABLE_STORE_TYPE  StoreType;
+
   EfiConvertPointer (0x0, (VOID **) &mVariableBuffer);
   EfiConvertPointer (0x0, (VOID **) &mSmmCommunication);
   EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableRuntimeHobCacheBuffer);
   EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableRuntimeNvCacheBuffer);
   EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableRuntimeVolatileCacheBuffer);
+
+  for (StoreType = (VARIABLE_STORE_TYPE) 0; StoreType < VariableStoreTypeMax; StoreType++) {
+    EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableIndex[StoreType].Store);
+    EfiConvertPointer (EFI_OPTIONAL_PTR, (VOID **) &mVariableIndex[StoreType].Entries);
+  }
 }
 
 /**
@@ -1519,6 +1688,7 @@ SendRuntimeVariableCacheContextToSmm (
   SmmRuntimeVarCacheContext->PendingUpdate = &mVariableRuntimeCachePendingUpdate;
   SmmRuntimeVarCacheContext->ReadLock = &mVariableRuntimeCacheReadLock;
   SmmRuntimeVarCacheContext->HobFlushComplete = &mHobFlushComplete;
+  SmmRuntimeVarCacheContext->CacheRewritten = &mVariableRuntimeCacheRewritten;
 
   //
   // Send data to SMM.
@@ -1596,6 +1766,16 @@ SmmVariableReady (
         if (!EFI_ERROR (Status)) {
           Status = InitVariableCache (&mVariableRuntimeVolatileCacheBuffer, &mVariableRuntimeVolatileCacheBufferSize);
           if (!EFI_ERROR (Status)) {
+            //
+            // Index the variables of the runtime caches.  The variables of a cache that
+            // could not be indexed are found by walking the cache.
+            //
+            if (mVariableRuntimeHobCacheBuffer != NULL) {
+              VariableIndexInitialize (VariableStoreTypeHob, mVariableRuntimeHobCacheBuffer, mVariableAuthFormat, NULL);
+            }
+            VariableIndexInitialize (VariableStoreTypeNv, mVariableRuntimeNvCacheBuffer, mVariableAuthFormat, NULL);
+            VariableIndexInitialize (VariableStoreTypeVolatile, mVariableRuntimeVolatileCacheBuffer, mVariableAuthFormat, NULL);
+
             Status = SendRuntimeVariableCacheContextToSmm ();
             if (!EFI_ERROR (Status)) {
               SyncRuntimeCache ();
@@ -1639,6 +1819,15 @@ SmmVariableReady (
                   );
   ASSERT_EFI_ERROR (Status);
 
+  mVariableBatch.SetVariables = VariableBatchSetVariables;
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &mHandle,
+                  &gEdkiiVariableBatchProtocolGuid,
+                  &mVariableBatch,
+                  NULL
+                  );
+  ASSERT_EFI_ERROR (Status);
+
   mVarCheck.RegisterSetVariableCheckHandler = VarCheckRegisterSetVariableCheckHandler;
   mVarCheck.VariablePropertySet = VarCheckVariablePropertySet;
   mVarCheck.VariablePropertyGet = VarCheckVariablePropertyGet;
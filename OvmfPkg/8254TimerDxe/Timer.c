@@ -23,6 +23,14 @@ EFI_TIMER_ARCH_PROTOCOL   mTimer = {
   TimerDriverGenerateSoftInterrupt
 };
 
+//
+// The Timer One-Shot Protocol that this driver produces
+//
+EDKII_TIMER_ONE_SHOT_PROTOCOL  mTimerOneShot = {
+  TimerDriverSetDeadline,
+  TimerDriverGetElapsedTime
+};
+
 //
 // Pointer to the CPU Architectural Protocol instance
 //
@@ -44,24 +52,134 @@ EFI_TIMER_NOTIFY mTimerNotifyFunction;
 //
 volatile UINT64           mTimerPeriod = 0;
 
+//
+// The count Timer #0 counts down in one-shot mode, or 0 in periodic mode, and
+// whether the count is armed: it is no longer once the notification function
+// accounted for its expiry, so that Timer #0 is not read until it is armed
+// again
+//
+UINT16                    mTimerOneShotCount = 0;
+BOOLEAN                   mTimerOneShotArmed = FALSE;
+
+//
+// The time elapsed since the last call to the notification function that is
+// not accounted for by the count of Timer #0.  It wraps around below 0 when
+// the notification function is called before the one-shot count expires.
+//
+UINT64                    mTimerElapsed = 0;
+
 //
 // Worker Functions
 //
 /**
   Sets the counter value for Timer #0 in a legacy 8254 timer.
 
+  @param Control  The control word selecting the mode of Timer #0.
   @param Count    The 16-bit counter value to program into Timer #0 of the legacy 8254 timer.
 **/
 VOID
 SetPitCount (
+  IN UINT8   Control,
   IN UINT16  Count
   )
 {
-  IoWrite8 (TIMER_CONTROL_PORT, 0x36);
+  IoWrite8 (TIMER_CONTROL_PORT, Control);
   IoWrite8 (TIMER0_COUNT_PORT, (UINT8)(Count & 0xff));
   IoWrite8 (TIMER0_COUNT_PORT, (UINT8)((Count >> 8) & 0xff));
 }
 
+/**
+  Converts a number of 8254 counts into 100 ns units.
+
+  @param Count    The number of counts of the 1.193182 MHz clock.
+
+  @return The time in 100 ns units.
+**/
+UINT64
+PitCountToTime (
+  IN UINT32  Count
+  )
+{
+  return DivU64x32 (MultU64x32 (1000000, Count) + 59659, 119318);
+}
+
+/**
+  Returns the number of counts Timer #0 has counted down in one-shot mode.
+
+  @return The number of counts, or 0 in periodic mode or when no count is
+          armed.
+**/
+UINT16
+GetPitOneShotElapsedCount (
+  VOID
+  )
+{
+  UINT8   Status;
+  UINT16  Count;
+
+  if (!mTimerOneShotArmed) {
+    return 0;
+  }
+
+  IoWrite8 (TIMER_CONTROL_PORT, TIMER0_CONTROL_READ_BACK);
+  Status = IoRead8 (TIMER0_COUNT_PORT);
+  Count  = IoRead8 (TIMER0_COUNT_PORT);
+  Count |= (UINT16)(IoRead8 (TIMER0_COUNT_PORT) << 8);
+
+  if ((Status & TIMER0_STATUS_OUTPUT) != 0) {
+    //
+    // The count expired, and Timer #0 may have wrapped around since
+    //
+    return mTimerOneShotCount;
+  }
+  if ((Status & TIMER0_STATUS_NULL_COUNT) != 0 || Count > mTimerOneShotCount) {
+    return 0;
+  }
+  return mTimerOneShotCount - Count;
+}
+
+/**
+  Returns the time elapsed since the last call to the notification function,
+  and starts counting the time for the next call.
+
+  @return The time to pass to the notification function, in 100 ns units.
+**/
+UINT64
+GetTimerTickDuration (
+  VOID
+  )
+{
+  UINT64  Duration;
+  UINT16  Counted;
+
+  if (mTimerOneShotCount == 0) {
+    //
+    // @bug : This does not handle missed timer interrupts
+    //
+    Duration      = mTimerPeriod + mTimerElapsed;
+    mTimerElapsed = 0;
+    return Duration;
+  }
+
+  Counted  = GetPitOneShotElapsedCount ();
+  Duration = mTimerElapsed + PitCountToTime (Counted);
+  if (Counted == mTimerOneShotCount) {
+    //
+    // The count expired and is accounted for, so the time elapsed stays 0
+    // until the count is armed again
+    //
+    mTimerOneShotArmed = FALSE;
+    mTimerElapsed      = 0;
+  } else {
+    //
+    // The count already counted down is accounted for in this call, so take
+    // it off the time of the next call
+    //
+    mTimerElapsed = 0 - PitCountToTime (Counted);
+  }
+  return Duration;
+}
+
 /**
   8254 Timer #0 Interrupt Handler.
 
@@ -82,10 +200,7 @@ TimerInterruptHandler (
   mLegacy8259->EndOfInterrupt (mLegacy8259, Efi8259Irq0);
 
   if (mTimerNotifyFunction != NULL) {
-    //
-    // @bug : This does not handle missed timer interrupts
-    //
-    mTimerNotifyFunction (mTimerPeriod);
+    mTimerNotifyFunction (GetTimerTickDuration ());
   }
 
   gBS->RestoreTPL (OriginalTPL);
@@ -181,6 +296,17 @@ TimerDriverSetTimerPeriod (
   )
 {
   UINT64  TimerCount;
+  EFI_TPL OriginalTPL;
+
+  //
+  // Leave one-shot mode, keeping the time counted down so far for the next
+  // call to the notification function
+  //
+  OriginalTPL = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  mTimerElapsed += PitCountToTime (GetPitOneShotElapsedCount ());
+  mTimerOneShotCount = 0;
+  mTimerOneShotArmed = FALSE;
+  gBS->RestoreTPL (OriginalTPL);
 
   //
   //  The basic clock is 1.19318 MHz or 0.119318 ticks per 100 ns.
@@ -218,7 +344,7 @@ TimerDriverSetTimerPeriod (
     //
     // Program the 8254 timer with the new count value
     //
-    SetPitCount ((UINT16) TimerCount);
+    SetPitCount (TIMER0_CONTROL_PERIODIC, (UINT16) TimerCount);
 
     //
     // Enable timer interrupt
@@ -304,10 +430,7 @@ TimerDriverGenerateSoftInterrupt (
     OriginalTPL = gBS->RaiseTPL (TPL_HIGH_LEVEL);
 
     if (mTimerNotifyFunction != NULL) {
-      //
-      // @bug : This does not handle missed timer interrupts
-      //
-      mTimerNotifyFunction (mTimerPeriod);
+      mTimerNotifyFunction (GetTimerTickDuration ());
     }
 
     gBS->RestoreTPL (OriginalTPL);
@@ -318,6 +441,102 @@ TimerDriverGenerateSoftInterrupt (
   return EFI_SUCCESS;
 }
 
+/**
+  Program the timer interrupt to fire once, Delay 100ns units from now, instead
+  of periodically.
+
+  @param This            The EDKII_TIMER_ONE_SHOT_PROTOCOL instance.
+  @param Delay           The time until the timer interrupt, in 100ns units.
+                         It is rounded to the nearest 8254 count, and limited to
+                         MAX_TIMER_TICK_DURATION.
+
+  @retval EFI_SUCCESS      The timer interrupt was programmed.
+  @retval EFI_NOT_STARTED  The timer interrupt is disabled.
+
+**/
+EFI_STATUS
+EFIAPI
+TimerDriverSetDeadline (
+  IN EDKII_TIMER_ONE_SHOT_PROTOCOL  *This,
+  IN UINT64                         Delay
+  )
+{
+  UINT64   TimerCount;
+  EFI_TPL  OriginalTPL;
+
+  OriginalTPL = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+
+  if (mTimerPeriod == 0) {
+    gBS->RestoreTPL (OriginalTPL);
+    return EFI_NOT_STARTED;
+  }
+
+  //
+  // Keep the time counted down so far for the next call to the notification
+  // function
+  //
+  mTimerElapsed += PitCountToTime (GetPitOneShotElapsedCount ());
+
+  //
+  // Convert Delay into 8254 counts, as TimerDriverSetTimerPeriod() does.  A
+  // count of 0 would stand for 65,536, so it is not used.
+  //
+  if (Delay > MAX_TIMER_TICK_DURATION) {
+    Delay = MAX_TIMER_TICK_DURATION;
+  }
+  TimerCount = DivU64x32 (MultU64x32 (119318, (UINT32) Delay) + 500000, 1000000);
+  if (TimerCount == 0) {
+    TimerCount = 1;
+  } else if (TimerCount > MAX_UINT16) {
+    TimerCount = MAX_UINT16;
+  }
+
+  SetPitCount (TIMER0_CONTROL_ONE_SHOT, (UINT16) TimerCount);
+  mTimerOneShotCount = (UINT16) TimerCount;
+  mTimerOneShotArmed = TRUE;
+
+  gBS->RestoreTPL (OriginalTPL);
+  return EFI_SUCCESS;
+}
+
+/**
+  Return the time elapsed since the previous call to the timer notification
+  function.
+
+  Timer #0 is only read while a one-shot count is armed.
+
+  @param This            The EDKII_TIMER_ONE_SHOT_PROTOCOL instance.
+  @param Elapsed         The time elapsed, in 100ns units.  It is 0 if the timer
+                         is in periodic mode.
+
+  @retval EFI_SUCCESS            The time elapsed was returned.
+  @retval EFI_INVALID_PARAMETER  Elapsed is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+TimerDriverGetElapsedTime (
+  IN  EDKII_TIMER_ONE_SHOT_PROTOCOL  *This,
+  OUT UINT64                         *Elapsed
+  )
+{
+  EFI_TPL  OriginalTPL;
+
+  if (Elapsed == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OriginalTPL = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  if (mTimerOneShotCount == 0) {
+    *Elapsed = 0;
+  } else {
+    *Elapsed = mTimerElapsed + PitCountToTime (GetPitOneShotElapsedCount ());
+  }
+  gBS->RestoreTPL (OriginalTPL);
+
+  return EFI_SUCCESS;
+}
+
 /**
   Initialize the Timer Architectural Protocol driver
 
@@ -387,11 +606,13 @@ TimerDriverInitialize (
   ASSERT_EFI_ERROR (Status);
 
   //
-  // Install the Timer Architectural Protocol onto a new handle
+  // Install the Timer Architectural Protocol and the Timer One-Shot Protocol
+  // onto a new handle
   //
   Status = gBS->InstallMultipleProtocolInterfaces (
                   &mTimerHandle,
-                  &gEfiTimerArchProtocolGuid, &mTimer,
+                  &gEfiTimerArchProtocolGuid,      &mTimer,
+                  &gEdkiiTimerOneShotProtocolGuid, &mTimerOneShot,
                   NULL
                   );
   ASSERT_EFI_ERROR (Status);
@@ -13,6 +13,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/Cpu.h>
 #include <Protocol/Legacy8259.h>
 #include <Protocol/Timer.h>
+#include <Protocol/TimerOneShot.h>
 
 #include <Library/UefiBootServicesTableLib.h>
 #include <Library/BaseLib.h>
@@ -40,6 +41,21 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #define TIMER_CONTROL_PORT          0x43
 #define TIMER0_COUNT_PORT           0x40
 
+//
+// Timer #0 control words: square wave mode for periodic interrupts, interrupt
+// on terminal count mode for one-shot interrupts, and read-back of the count
+// and status of Timer #0
+//
+#define TIMER0_CONTROL_PERIODIC     0x36
+#define TIMER0_CONTROL_ONE_SHOT     0x30
+#define TIMER0_CONTROL_READ_BACK    0xC2
+
+//
+// Bits of the Timer #0 status returned by the read-back command
+//
+#define TIMER0_STATUS_OUTPUT        BIT7
+#define TIMER0_STATUS_NULL_COUNT    BIT6
+
 //
 // Function Prototypes
 //
@@ -182,4 +198,45 @@ TimerDriverGenerateSoftInterrupt (
   )
 ;
 
+/**
+  Program the timer interrupt to fire once, Delay 100ns units from now, instead
+  of periodically.
+
+  @param This            The EDKII_TIMER_ONE_SHOT_PROTOCOL instance.
+  @param Delay           The time until the timer interrupt, in 100ns units.
+                         It is rounded to the nearest 8254 count, and limited to
+                         MAX_TIMER_TICK_DURATION.
+
+  @retval EFI_SUCCESS      The timer interrupt was programmed.
+  @retval EFI_NOT_STARTED  The timer interrupt is disabled.
+
+**/
+EFI_STATUS
+EFIAPI
+TimerDriverSetDeadline (
+  IN EDKII_TIMER_ONE_SHOT_PROTOCOL  *This,
+  IN UINT64                         Delay
+  )
+;
+
+/**
+  Return the time elapsed since the previous call to the timer notification
+  function.
+
+  @param This            The EDKII_TIMER_ONE_SHOT_PROTOCOL instance.
+  @param Elapsed         The time elapsed, in 100ns units.  It is 0 if the timer
+                         is in periodic mode.
+
+  @retval EFI_SUCCESS            The time elapsed was returned.
+  @retval EFI_INVALID_PARAMETER  Elapsed is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+TimerDriverGetElapsedTime (
+  IN  EDKII_TIMER_ONE_SHOT_PROTOCOL  *This,
+  OUT UINT64                         *Elapsed
+  )
+;
+
 #endif
@@ -25,6 +25,14 @@ EFI_TIMER_ARCH_PROTOCOL   mTimer = {
   TimerDriverGenerateSoftInterrupt
 };
 
+//
+// The Timer One-Shot Protocol that this driver produces
+//
+EDKII_TIMER_ONE_SHOT_PROTOCOL  mTimerOneShot = {
+  TimerDriverSetDeadline,
+  TimerDriverGetElapsedTime
+};
+
 //
 // Pointer to the CPU Architectural Protocol instance
 //
@@ -41,9 +49,79 @@ EFI_TIMER_NOTIFY mTimerNotifyFunction;
 //
 volatile UINT64           mTimerPeriod = 0;
 
+//
+// The count the local APIC timer counts down in one-shot mode, or 0 in
+// periodic mode
+//
+UINT32                    mTimerOneShotCount = 0;
+
+//
+// The time elapsed since the last call to the notification function that is
+// not accounted for by the count of the local APIC timer.  It wraps around
+// below 0 when the notification function is called before the one-shot count
+// expires.
+//
+UINT64                    mTimerElapsed = 0;
+
 //
 // Worker Functions
 //
+/**
+  Returns the time the local APIC timer has counted down in one-shot mode.
+
+  @return The time in 100 ns units, or 0 in periodic mode.
+**/
+UINT64
+GetApicTimerOneShotElapsedTime (
+  VOID
+  )
+{
+  UINT32  Count;
+
+  if (mTimerOneShotCount == 0) {
+    return 0;
+  }
+
+  //
+  // The current count stays at 0 once the one-shot count expires
+  //
+  Count = mTimerOneShotCount - GetApicTimerCurrentCount ();
+  return DivU64x32 (MultU64x32 (10000000, Count), PcdGet32 (PcdFSBClock));
+}
+
+/**
+  Returns the time elapsed since the last call to the notification function,
+  and starts counting the time for the next call.
+
+  @return The time to pass to the notification function, in 100 ns units.
+**/
+UINT64
+GetTimerTickDuration (
+  VOID
+  )
+{
+  UINT64  Duration;
+  UINT64  Counted;
+
+  if (mTimerOneShotCount == 0) {
+    //
+    // @bug : This does not handle missed timer interrupts
+    //
+    Duration      = mTimerPeriod + mTimerElapsed;
+    mTimerElapsed = 0;
+    return Duration;
+  }
+
+  //
+  // The count already counted down is accounted for in this call, so take it
+  // off the time of the next call
+  //
+  Counted       = GetApicTimerOneShotElapsedTime ();
+  Duration      = mTimerElapsed + Counted;
+  mTimerElapsed = 0 - Counted;
+  return Duration;
+}
+
 /**
   Interrupt Handler.
 
@@ -64,10 +142,7 @@ TimerInterruptHandler (
   SendApicEoi();
 
   if (mTimerNotifyFunction != NULL) {
-    //
-    // @bug : This does not handle missed timer interrupts
-    //
-    mTimerNotifyFunction (mTimerPeriod);
+    mTimerNotifyFunction (GetTimerTickDuration ());
   }
 
   gBS->RestoreTPL (OriginalTPL);
@@ -165,6 +240,16 @@ TimerDriverSetTimerPeriod (
   UINT64  TimerCount;
   UINT32  TimerFrequency;
   UINTN   DivideValue = 1;
+  EFI_TPL OriginalTPL;
+
+  //
+  // Leave one-shot mode, keeping the time counted down so far for the next
+  // call to the notification function
+  //
+  OriginalTPL = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  mTimerElapsed += GetApicTimerOneShotElapsedTime ();
+  mTimerOneShotCount = 0;
+  gBS->RestoreTPL (OriginalTPL);
 
   if (TimerPeriod == 0) {
     //
@@ -271,10 +356,7 @@ TimerDriverGenerateSoftInterrupt (
     OriginalTPL = gBS->RaiseTPL (TPL_HIGH_LEVEL);
 
     if (mTimerNotifyFunction != NULL) {
-      //
-      // @bug : This does not handle missed timer interrupts
-      //
-      mTimerNotifyFunction (mTimerPeriod);
+      mTimerNotifyFunction (GetTimerTickDuration ());
     }
 
     gBS->RestoreTPL (OriginalTPL);
@@ -285,6 +367,102 @@ TimerDriverGenerateSoftInterrupt (
   return EFI_SUCCESS;
 }
 
+/**
+  Program the timer interrupt to fire once, Delay 100ns units from now, instead
+  of periodically.
+
+  @param This            The EDKII_TIMER_ONE_SHOT_PROTOCOL instance.
+  @param Delay           The time until the timer interrupt, in 100ns units.
+                         It is rounded down to local APIC counts, and limited to
+                         the largest count of the local APIC timer.
+
+  @retval EFI_SUCCESS      The timer interrupt was programmed.
+  @retval EFI_NOT_STARTED  The timer interrupt is disabled.
+
+**/
+EFI_STATUS
+EFIAPI
+TimerDriverSetDeadline (
+  IN EDKII_TIMER_ONE_SHOT_PROTOCOL  *This,
+  IN UINT64                         Delay
+  )
+{
+  UINT64   TimerCount;
+  UINT32   TimerFrequency;
+  UINTN    DivideValue = 1;
+  EFI_TPL  OriginalTPL;
+
+  OriginalTPL = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+
+  if (mTimerPeriod == 0) {
+    gBS->RestoreTPL (OriginalTPL);
+    return EFI_NOT_STARTED;
+  }
+
+  //
+  // Keep the time counted down so far for the next call to the notification
+  // function
+  //
+  mTimerElapsed += GetApicTimerOneShotElapsedTime ();
+
+  //
+  // Convert Delay into local APIC counts, as TimerDriverSetTimerPeriod() does.
+  // A count of 0 would stop the timer, so it is not used.
+  //
+  TimerFrequency = PcdGet32(PcdFSBClock) / DivideValue;
+  if (Delay > 429496730) {
+    Delay = 429496730;
+  }
+  TimerCount = DivU64x32 (MultU64x32 (Delay, TimerFrequency), 10000000);
+  if (TimerCount == 0) {
+    TimerCount = 1;
+  } else if (TimerCount > MAX_UINT32) {
+    TimerCount = MAX_UINT32;
+  }
+
+  InitializeApicTimer (DivideValue, (UINT32) TimerCount, FALSE, LOCAL_APIC_TIMER_VECTOR);
+  mTimerOneShotCount = (UINT32) TimerCount;
+
+  gBS->RestoreTPL (OriginalTPL);
+  return EFI_SUCCESS;
+}
+
+/**
+  Return the time elapsed since the previous call to the timer notification
+  function.
+
+  @param This            The EDKII_TIMER_ONE_SHOT_PROTOCOL instance.
+  @param Elapsed         The time elapsed, in 100ns units.  It is 0 if the timer
+                         is in periodic mode.
+
+  @retval EFI_SUCCESS            The time elapsed was returned.
+  @retval EFI_INVALID_PARAMETER  Elapsed is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+TimerDriverGetElapsedTime (
+  IN  EDKII_TIMER_ONE_SHOT_PROTOCOL  *This,
+  OUT UINT64                         *Elapsed
+  )
+{
+  EFI_TPL  OriginalTPL;
+
+  if (Elapsed == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  OriginalTPL = gBS->RaiseTPL (TPL_HIGH_LEVEL);
+  if (mTimerOneShotCount == 0) {
+    *Elapsed = 0;
+  } else {
+    *Elapsed = mTimerElapsed + GetApicTimerOneShotElapsedTime ();
+  }
+  gBS->RestoreTPL (OriginalTPL);
+
+  return EFI_SUCCESS;
+}
+
 /**
   Initialize the Timer Architectural Protocol driver
 
@@ -341,11 +519,13 @@ TimerDriverInitialize (
   ASSERT_EFI_ERROR (Status);
 
   //
-  // Install the Timer Architectural Protocol onto a new handle
+  // Install the Timer Architectural Protocol and the Timer One-Shot Protocol
+  // onto a new handle
   //
   Status = gBS->InstallMultipleProtocolInterfaces (
                   &mTimerHandle,
-                  &gEfiTimerArchProtocolGuid, &mTimer,
+                  &gEfiTimerArchProtocolGuid,      &mTimer,
+                  &gEdkiiTimerOneShotProtocolGuid, &mTimerOneShot,
                   NULL
                   );
   ASSERT_EFI_ERROR (Status);
@@ -14,6 +14,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 
 #include <Protocol/Cpu.h>
 #include <Protocol/Timer.h>
+#include <Protocol/TimerOneShot.h>
 
 #include <Register/LocalApic.h>
 
@@ -174,4 +175,45 @@ TimerDriverGenerateSoftInterrupt (
   )
 ;
 
+/**
+  Program the timer interrupt to fire once, Delay 100ns units from now, instead
+  of periodically.
+
+  @param This            The EDKII_TIMER_ONE_SHOT_PROTOCOL instance.
+  @param Delay           The time until the timer interrupt, in 100ns units.
+                         It is rounded down to local APIC counts, and limited to
+                         the largest count of the local APIC timer.
+
+  @retval EFI_SUCCESS      The timer interrupt was programmed.
+  @retval EFI_NOT_STARTED  The timer interrupt is disabled.
+
+**/
+EFI_STATUS
+EFIAPI
+TimerDriverSetDeadline (
+  IN EDKII_TIMER_ONE_SHOT_PROTOCOL  *This,
+  IN UINT64                         Delay
+  )
+;
+
+/**
+  Return the time elapsed since the previous call to the timer notification
+  function.
+
+  @param This            The EDKII_TIMER_ONE_SHOT_PROTOCOL instance.
+  @param Elapsed         The time elapsed, in 100ns units.  It is 0 if the timer
+                         is in periodic mode.
+
+  @retval EFI_SUCCESS            The time elapsed was returned.
+  @retval EFI_INVALID_PARAMETER  Elapsed is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+TimerDriverGetElapsedTime (
+  IN  EDKII_TIMER_ONE_SHOT_PROTOCOL  *This,
+  OUT UINT64                         *Elapsed
+  )
+;
+
 #endif
@@ -17,6 +17,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Ppi/EndOfPeiPhase.h>
 #include <Ppi/FirmwareVolumeInfoMeasurementExcluded.h>
 #include <Ppi/FirmwareVolumeInfoPrehashedFV.h>
+#include <Ppi/MpServices.h>
+#include <Ppi/MpServices2.h>
 
 #include <Guid/TcgEventHob.h>
 #include <Guid/MeasuredFvHob.h>
@@ -38,6 +40,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Library/ReportStatusCodeLib.h>
 #include <Library/ResetSystemLib.h>
 #include <Library/PrintLib.h>
+#include <Library/BaseCryptLib.h>
+#include <Library/SynchronizationLib.h>
 
 #define PERF_ID_TCG2_PEI  0x3080
 
@@ -91,6 +95,74 @@ typedef struct {
 
 #pragma pack ()
 
+/**
+  Compute the digest of a buffer with a hash algorithm, as the HashAll functions
+  of BaseCryptLib do.
+
+  @param[in]   Data        Pointer to the buffer containing the data to be hashed.
+  @param[in]   DataSize    Size of Data buffer in bytes.
+  @param[out]  HashValue   Pointer to a buffer that receives the digest value.
+
+  @retval TRUE   The digest computation succeeded.
+  @retval FALSE  The digest computation failed, or the algorithm is not supported.
+
+**/
+typedef
+BOOLEAN
+(EFIAPI *TCG2_PREHASH_HASH_ALL) (
+  IN  CONST VOID                    *Data,
+  IN  UINTN                         DataSize,
+  OUT UINT8                         *HashValue
+  );
+
+typedef struct {
+  TPMI_ALG_HASH                     HashAlgo;
+  UINT32                            HashMask;
+  TCG2_PREHASH_HASH_ALL             HashAll;
+} TCG2_PREHASH_ALGO;
+
+TCG2_PREHASH_ALGO mTcg2PreHashAlgo[] = {
+  {TPM_ALG_SHA1,    HASH_ALG_SHA1,    Sha1HashAll},
+  {TPM_ALG_SHA256,  HASH_ALG_SHA256,  Sha256HashAll},
+  {TPM_ALG_SHA384,  HASH_ALG_SHA384,  Sha384HashAll},
+  {TPM_ALG_SHA512,  HASH_ALG_SHA512,  Sha512HashAll},
+  {TPM_ALG_SM3_256, HASH_ALG_SM3_256, Sm3HashAll},
+};
+
+//
+// The digests of an FV that is hashed before it is measured.
+//
+typedef struct {
+  EFI_PHYSICAL_ADDRESS              FvBase;
+  UINT64                            FvLength;
+  TPML_DIGEST_VALUES                DigestList;
+  //
+  // The number of digests of DigestList that could not be computed.
+  //
+  volatile UINT32                   FailedCount;
+} TCG2_PREHASHED_FV;
+
+//
+// A batch of FVs hashed by the processors together. Each task computes one
+// digest of one FV, and the processors take the tasks in turn.
+//
+typedef struct {
+  TCG2_PREHASHED_FV                 *Fv;
+  TCG2_PREHASH_ALGO                 *Algo[HASH_COUNT];
+  UINT32                            AlgoCount;
+  UINT32                            TaskCount;
+  volatile UINT32                   NextTask;
+} TCG2_PREHASH_CONTEXT;
+
+//
+// The maximum number of FVs hashed together once memory is ready.
+//
+#define TCG2_PREHASH_MAX_FV_COUNT  16
+
+TCG2_PREHASHED_FV *mPreHashedFvInfo;
+UINT32 mPreHashedMaxFvIndex = 0;
+UINT32 mPreHashedFvIndex = 0;
+
 /**
   Measure and record the Firmware Volume Information once FvInfoPPI install.
 
@@ -502,6 +574,268 @@ GetFvName (
   return &FvExtHeader->FvName;
 }
 
+/**
+  Check whether an FV is excluded from the measurement by a
+  EFI_PEI_FIRMWARE_VOLUME_INFO_MEASUREMENT_EXCLUDED_PPI.
+
+  @param[in]  FvBase            Base address of FV image.
+  @param[in]  FvLength          Length of FV image.
+
+  @retval TRUE                  The FV is excluded from the measurement.
+  @retval FALSE                 The FV is to be measured.
+
+**/
+BOOLEAN
+IsMeasurementExcludedFv (
+  IN EFI_PHYSICAL_ADDRESS           FvBase,
+  IN UINT64                         FvLength
+  )
+{
+  UINT32                                                Index;
+  EFI_STATUS                                            Status;
+  UINT32                                                Instance;
+  EFI_PEI_FIRMWARE_VOLUME_INFO_MEASUREMENT_EXCLUDED_PPI *MeasurementExcludedFvPpi;
+
+  Instance = 0;
+  do {
+    Status = PeiServicesLocatePpi(
+                 &gEfiPeiFirmwareVolumeInfoMeasurementExcludedPpiGuid,
+                 Instance,
+                 NULL,
+                 (VOID**)&MeasurementExcludedFvPpi
+                 );
+    if (!EFI_ERROR(Status)) {
+      for (Index = 0; Index < MeasurementExcludedFvPpi->Count; Index ++) {
+        if (MeasurementExcludedFvPpi->Fv[Index].FvBase == FvBase
+         && MeasurementExcludedFvPpi->Fv[Index].FvLength == FvLength) {
+          return TRUE;
+        }
+      }
+
+      Instance++;
+    }
+  } while (!EFI_ERROR(Status));
+
+  return FALSE;
+}
+
+/**
+  Compute the digests of the FVs of a pre-hash batch, until all the tasks of the
+  batch are taken. It runs on the APs, and on the BSP, so it does not use any PEI
+  service.
+
+  @param[in, out] Buffer        Pointer to the TCG2_PREHASH_CONTEXT of the batch.
+
+**/
+VOID
+EFIAPI
+PreHashFvProcedure (
+  IN OUT VOID                       *Buffer
+  )
+{
+  TCG2_PREHASH_CONTEXT              *Context;
+  TCG2_PREHASHED_FV                 *PreHashedFv;
+  UINT32                            Task;
+  UINT32                            AlgoIndex;
+
+  Context = (TCG2_PREHASH_CONTEXT *) Buffer;
+  while (TRUE) {
+    Task = InterlockedIncrement (&Context->NextTask) - 1;
+    if (Task >= Context->TaskCount) {
+      break;
+    }
+
+    PreHashedFv = &Context->Fv[Task / Context->AlgoCount];
+    AlgoIndex   = Task % Context->AlgoCount;
+    if (!Context->Algo[AlgoIndex]->HashAll (
+                                     (VOID *) (UINTN) PreHashedFv->FvBase,
+                                     (UINTN) PreHashedFv->FvLength,
+                                     (UINT8 *) &PreHashedFv->DigestList.digests[AlgoIndex].digest
+                                     )) {
+      InterlockedIncrement (&PreHashedFv->FailedCount);
+    }
+  }
+}
+
+/**
+  Hash FVs before they are measured, with the hash algorithms of the PCR banks,
+  and add them into the pre-hashed FV list.
+
+  The digests of all the FVs are computed in parallel by the BSP and the APs,
+  if the EDKII MP Services 2 PPI is installed. Otherwise the APs compute them
+  if the MP Services PPI is installed, and the BSP computes what is left.
+
+  An FV is left out of the pre-hashed FV list if its digests cannot all be
+  computed, or if the list cannot grow, so it is measured as before.
+
+  @param[in]  FvInfo            The base addresses and lengths of the FVs.
+  @param[in]  FvCount           The number of FVs in FvInfo.
+
+**/
+VOID
+PreHashFvImages (
+  IN EFI_PLATFORM_FIRMWARE_BLOB     *FvInfo,
+  IN UINT32                         FvCount
+  )
+{
+  EFI_STATUS                        Status;
+  TCG2_PREHASH_CONTEXT              Context;
+  EDKII_PEI_MP_SERVICES2_PPI        *MpServices2;
+  EFI_PEI_MP_SERVICES_PPI           *MpServices;
+  TCG2_PREHASHED_FV                 *PreHashedFvInfo;
+  UINT32                            HashMask;
+  UINT32                            Index;
+  UINT32                            AlgoIndex;
+  UINT32                            PreHashedIndex;
+
+  if (FvCount == 0) {
+    return;
+  }
+
+  //
+  // Hash the FVs with the algorithms HashLogExtendEvent() would extend.
+  //
+  ZeroMem (&Context, sizeof (Context));
+  HashMask = PcdGet32 (PcdTpm2HashMask) & PcdGet32 (PcdTcg2HashAlgorithmBitmap);
+  for (Index = 0; Index < ARRAY_SIZE (mTcg2PreHashAlgo); Index++) {
+    if ((mTcg2PreHashAlgo[Index].HashMask & HashMask) != 0) {
+      Context.Algo[Context.AlgoCount++] = &mTcg2PreHashAlgo[Index];
+    }
+  }
+  if (Context.AlgoCount == 0) {
+    return;
+  }
+
+  if (mPreHashedFvIndex + FvCount > mPreHashedMaxFvIndex) {
+    PreHashedFvInfo = ReallocatePool (
+                        sizeof (TCG2_PREHASHED_FV) * mPreHashedMaxFvIndex,
+                        sizeof (TCG2_PREHASHED_FV) * (mPreHashedFvIndex + FvCount + FIRMWARE_BLOB_GROWTH_STEP),
+                        mPreHashedFvInfo
+                        );
+    if (PreHashedFvInfo == NULL) {
+      //
+      // Keep the FVs already pre-hashed. The new ones are hashed when they are
+      // measured.
+      //
+      return;
+    }
+    mPreHashedFvInfo     = PreHashedFvInfo;
+    mPreHashedMaxFvIndex = mPreHashedFvIndex + FvCount + FIRMWARE_BLOB_GROWTH_STEP;
+  }
+
+  Context.Fv        = &mPreHashedFvInfo[mPreHashedFvIndex];
+  Context.TaskCount = FvCount * Context.AlgoCount;
+  for (Index = 0; Index < FvCount; Index++) {
+    ZeroMem (&Context.Fv[Index], sizeof (TCG2_PREHASHED_FV));
+    Context.Fv[Index].FvBase   = FvInfo[Index].BlobBase;
+    Context.Fv[Index].FvLength = FvInfo[Index].BlobLength;
+    for (AlgoIndex = 0; AlgoIndex < Context.AlgoCount; AlgoIndex++) {
+      WriteUnaligned16 (&Context.Fv[Index].DigestList.digests[AlgoIndex].hashAlg, Context.Algo[AlgoIndex]->HashAlgo);
+    }
+    WriteUnaligned32 (&Context.Fv[Index].DigestList.count, Context.AlgoCount);
+  }
+
+  PERF_START_EX (mFileHandle, "PreHash", "Tcg2Pei", 0, PERF_ID_TCG2_PEI + 2);
+
+  Status = EFI_NOT_STARTED;
+  if (Context.TaskCount > 1) {
+    //
+    // The PEI MP services are blocking, so only StartupAllCPUs() has the BSP
+    // take tasks while the APs run. StartupAllAPs() leaves the BSP waiting.
+    //
+    Status = PeiServicesLocatePpi (
+               &gEdkiiPeiMpServices2PpiGuid,
+               0,
+               NULL,
+               (VOID **) &MpServices2
+               );
+    if (!EFI_ERROR (Status)) {
+      Status = MpServices2->StartupAllCPUs (
+                              MpServices2,
+                              PreHashFvProcedure,
+                              0,
+                              &Context
+                              );
+    }
+    if (EFI_ERROR (Status)) {
+      Status = PeiServicesLocatePpi (
+                 &gEfiPeiMpServicesPpiGuid,
+                 0,
+                 NULL,
+                 (VOID **) &MpServices
+                 );
+      if (!EFI_ERROR (Status)) {
+        Status = MpServices->StartupAllAPs (
+                               GetPeiServicesTablePointer (),
+                               MpServices,
+                               PreHashFvProcedure,
+                               FALSE,
+                               0,
+                               &Context
+                               );
+      }
+    }
+  }
+  //
+  // Compute the digests the processors did not.
+  //
+  PreHashFvProcedure (&Context);
+
+  PERF_END_EX (mFileHandle, "PreHash", "Tcg2Pei", 0, PERF_ID_TCG2_PEI + 3);
+
+  DEBUG ((
+    DEBUG_INFO,
+    "Tcg2Pei pre-hashed %d FV(s) with %d algorithm(s) - %a\n",
+    FvCount,
+    Context.AlgoCount,
+    EFI_ERROR (Status) ? "BSP" : "BSP and APs"
+    ));
+
+  //
+  // Only keep the FVs whose digests could all be computed.
+  //
+  PreHashedIndex = mPreHashedFvIndex;
+  for (Index = 0; Index < FvCount; Index++) {
+    if (Context.Fv[Index].FailedCount == 0) {
+      if (&mPreHashedFvInfo[PreHashedIndex] != &Context.Fv[Index]) {
+        CopyMem (&mPreHashedFvInfo[PreHashedIndex], &Context.Fv[Index], sizeof (TCG2_PREHASHED_FV));
+      }
+      PreHashedIndex++;
+    }
+  }
+  mPreHashedFvIndex = PreHashedIndex;
+}
+
+/**
+  Get the digests of an FV from the pre-hashed FV list.
+
+  @param[in]  FvBase            Base address of FV image.
+  @param[in]  FvLength          Length of FV image.
+  @param[out] DigestList        The digests of the FV.
+
+  @retval TRUE                  The FV is pre-hashed.
+  @retval FALSE                 The FV is not pre-hashed.
+
+**/
+BOOLEAN
+GetPreHashedFvDigests (
+  IN  EFI_PHYSICAL_ADDRESS          FvBase,
+  IN  UINT64                        FvLength,
+  OUT TPML_DIGEST_VALUES            *DigestList
+  )
+{
+  UINT32                            Index;
+
+  for (Index = 0; Index < mPreHashedFvIndex; Index++) {
+    if (mPreHashedFvInfo[Index].FvBase == FvBase && mPreHashedFvInfo[Index].FvLength == FvLength) {
+      CopyMem (DigestList, &mPreHashedFvInfo[Index].DigestList, sizeof (TPML_DIGEST_VALUES));
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
 /**
   Measure FV image.
   Add it into the measured FV list after the FV is measured successfully.
@@ -532,35 +866,19 @@ MeasureFvImage (
   UINT32                                                Tpm2HashMask;
   TPML_DIGEST_VALUES                                    DigestList;
   UINT32                                                DigestCount;
-  EFI_PEI_FIRMWARE_VOLUME_INFO_MEASUREMENT_EXCLUDED_PPI *MeasurementExcludedFvPpi;
   EDKII_PEI_FIRMWARE_VOLUME_INFO_PREHASHED_FV_PPI       *PrehashedFvPpi;
   HASH_INFO                                             *PreHashInfo;
   UINT32                                                HashAlgoMask;
+  EFI_PLATFORM_FIRMWARE_BLOB                            PreHashFvInfo;
 
   //
   // Check Excluded FV list
   //
-  Instance = 0;
-  do {
-    Status = PeiServicesLocatePpi(
-                 &gEfiPeiFirmwareVolumeInfoMeasurementExcludedPpiGuid,
-                 Instance,
-                 NULL,
-                 (VOID**)&MeasurementExcludedFvPpi
-                 );
-    if (!EFI_ERROR(Status)) {
-      for (Index = 0; Index < MeasurementExcludedFvPpi->Count; Index ++) {
-        if (MeasurementExcludedFvPpi->Fv[Index].FvBase == FvBase
-         && MeasurementExcludedFvPpi->Fv[Index].FvLength == FvLength) {
-          DEBUG ((DEBUG_INFO, "The FV which is excluded by Tcg2Pei starts at: 0x%x\n", FvBase));
-          DEBUG ((DEBUG_INFO, "The FV which is excluded by Tcg2Pei has the size: 0x%x\n", FvLength));
-          return EFI_SUCCESS;
-        }
-      }
-
-      Instance++;
-    }
-  } while (!EFI_ERROR(Status));
+  if (IsMeasurementExcludedFv (FvBase, FvLength)) {
+    DEBUG ((DEBUG_INFO, "The FV which is excluded by Tcg2Pei starts at: 0x%x\n", FvBase));
+    DEBUG ((DEBUG_INFO, "The FV which is excluded by Tcg2Pei has the size: 0x%x\n", FvLength));
+    return EFI_SUCCESS;
+  }
 
   //
   // Check measured FV list
@@ -621,6 +939,21 @@ MeasureFvImage (
     Instance++;
   } while (!EFI_ERROR(Status));
 
+  //
+  // Check pre-hashed FV list of Tcg2Pei, and hash the FV if it is not there,
+  // so the digests of all the PCR banks are computed in parallel.
+  //
+  if (Tpm2HashMask != 0) {
+    if (!GetPreHashedFvDigests (FvBase, FvLength, &DigestList)) {
+      PreHashFvInfo.BlobBase   = FvBase;
+      PreHashFvInfo.BlobLength = FvLength;
+      PreHashFvImages (&PreHashFvInfo, 1);
+    }
+    if (GetPreHashedFvDigests (FvBase, FvLength, &DigestList)) {
+      Tpm2HashMask = 0;
+    }
+  }
+
   //
   // Init the log event for FV measurement
   //
@@ -633,6 +966,7 @@ MeasureFvImage (
     }
     FvBlob2.BlobBase      = FvBase;
     FvBlob2.BlobLength    = FvLength;
+    TcgEventHdr.PCRIndex  = 0;
     TcgEventHdr.EventType = EV_EFI_PLATFORM_FIRMWARE_BLOB2;
     TcgEventHdr.EventSize = sizeof (FvBlob2);
     EventData             = &FvBlob2;
@@ -831,6 +1165,107 @@ FirmwareVolumeInfoPpiNotifyCallback (
   return MeasureFvImage ((EFI_PHYSICAL_ADDRESS) (UINTN) Fv->FvInfo, Fv->FvInfoSize);
 }
 
+/**
+  Add an FV to a list of FVs to pre-hash, unless it is excluded from the measurement
+  or already in the list.
+
+  @param[in, out] FvInfo        The list of FVs to pre-hash.
+  @param[in, out] FvCount       The number of FVs in the list.
+  @param[in]      FvBase        Base address of FV image.
+  @param[in]      FvLength      Length of FV image.
+
+**/
+VOID
+AddPreHashFvImage (
+  IN OUT EFI_PLATFORM_FIRMWARE_BLOB *FvInfo,
+  IN OUT UINT32                     *FvCount,
+  IN     EFI_PHYSICAL_ADDRESS       FvBase,
+  IN     UINT64                     FvLength
+  )
+{
+  UINT32                            Index;
+
+  if (*FvCount >= TCG2_PREHASH_MAX_FV_COUNT) {
+    return;
+  }
+
+  for (Index = 0; Index < *FvCount; Index++) {
+    if (FvInfo[Index].BlobBase == FvBase && FvInfo[Index].BlobLength == FvLength) {
+      return;
+    }
+  }
+
+  if (IsMeasurementExcludedFv (FvBase, FvLength)) {
+    return;
+  }
+
+  FvInfo[*FvCount].BlobBase   = FvBase;
+  FvInfo[*FvCount].BlobLength = FvLength;
+  (*FvCount)++;
+}
+
+/**
+  Hash the FVs that are measured once memory is ready all together: the boot
+  firmware volume, and the FVs reported before by the FV Info PPIs.
+
+**/
+VOID
+PreHashReportedFvImages (
+  VOID
+  )
+{
+  EFI_STATUS                        Status;
+  EFI_PEI_FV_HANDLE                 VolumeHandle;
+  EFI_FV_INFO                       VolumeInfo;
+  EFI_PEI_FIRMWARE_VOLUME_INFO_PPI  *Fv;
+  EFI_PEI_FIRMWARE_VOLUME_PPI       *FvPpi;
+  EFI_PLATFORM_FIRMWARE_BLOB        FvInfo[TCG2_PREHASH_MAX_FV_COUNT];
+  UINT32                            FvCount;
+  UINTN                             Instance;
+  UINTN                             Index;
+
+  FvCount = 0;
+
+  //
+  // The boot firmware volume, that MeasureMainBios() measures.
+  //
+  Status = PeiServicesFfsFindNextVolume (0, &VolumeHandle);
+  if (!EFI_ERROR (Status)) {
+    Status = PeiServicesFfsGetVolumeInfo (VolumeHandle, &VolumeInfo);
+    if (!EFI_ERROR (Status)) {
+      AddPreHashFvImage (FvInfo, &FvCount, (EFI_PHYSICAL_ADDRESS) (UINTN) VolumeInfo.FvStart, VolumeInfo.FvSize);
+    }
+  }
+
+  //
+  // The FVs that FirmwareVolumeInfoPpiNotifyCallback() measures as soon as
+  // it is registered for the FV Info PPIs, the entries of mNotifyList before
+  // the End of PEI one.
+  //
+  for (Index = 0; Index < ARRAY_SIZE (mNotifyList) - 1; Index++) {
+    for (Instance = 0; ; Instance++) {
+      Status = PeiServicesLocatePpi (
+                 mNotifyList[Index].Guid,
+                 Instance,
+                 NULL,
+                 (VOID**)&Fv
+                 );
+      if (EFI_ERROR (Status)) {
+        break;
+      }
+      if (Fv->ParentFvName != NULL || Fv->ParentFileName != NULL) {
+        continue;
+      }
+      Status = PeiServicesLocatePpi (&Fv->FvFormat, 0, NULL, (VOID**)&FvPpi);
+      if (!EFI_ERROR (Status)) {
+        AddPreHashFvImage (FvInfo, &FvCount, (EFI_PHYSICAL_ADDRESS) (UINTN) Fv->FvInfo, Fv->FvInfoSize);
+      }
+    }
+  }
+
+  PreHashFvImages (FvInfo, FvCount);
+}
+
 /**
   Do measurement after memory is ready.
 
@@ -852,6 +1287,12 @@ PeimEntryMP (
     Status = MeasureCRTMVersion ();
   }
 
+  //
+  // Hash the FVs to measure on all the processors at once, so measuring
+  // each of them only extends and logs its digests.
+  //
+  PreHashReportedFvImages ();
+
   Status = MeasureMainBios ();
   if (EFI_ERROR(Status)) {
     return Status;
@@ -0,0 +1,410 @@
+/** @file
+  Host based unit tests of the pre-hashed FVs of Tcg2Pei.
+
+  The tests measure the same FVs through HashLogExtendEvent(), by making the
+  pre-hash fail, and through the pre-hashed FV list, and check that the PCR
+  extends and the event logs are the same.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/UnitTestLib.h>
+
+#include "Tcg2PeiUnitTest.h"
+
+#define UNIT_TEST_APP_NAME        "Tcg2Pei Pre-Hashed FV Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Number of FVs of the tests, and size of each FV
+//
+#define TCG2_PEI_TEST_FV_COUNT    3
+#define TCG2_PEI_TEST_FV_SIZE     0x2000
+
+//
+// All the hash algorithms of the PCR banks
+//
+#define TCG2_PEI_TEST_ALL_HASH    (HASH_ALG_SHA1 | HASH_ALG_SHA256 | HASH_ALG_SHA384 | HASH_ALG_SHA512 | HASH_ALG_SM3_256)
+
+//
+// FVs of the tests
+//
+EFI_PLATFORM_FIRMWARE_BLOB  mTestFvInfo[TCG2_PEI_TEST_FV_COUNT];
+
+//
+// GUIDed HOBs and PCR extends of the FVs measured through
+// HashLogExtendEvent()
+//
+UINT8                       mExpectedHob[TCG2_PEI_TEST_HOB_SIZE];
+UINTN                       mExpectedHobSize;
+TPML_DIGEST_VALUES          mExpectedPcrExtend[TCG2_PEI_TEST_EXTEND_COUNT];
+UINTN                       mExpectedPcrExtendCount;
+
+//
+// PCR banks of the tests
+//
+UINT32  mAllBanks    = TCG2_PEI_TEST_ALL_HASH;
+UINT32  mSha256Bank  = HASH_ALG_SHA256;
+
+/**
+  Forget the FVs measured and pre-hashed, the GUIDed HOBs and the PCR
+  extends.
+**/
+VOID
+ResetMeasurements (
+  VOID
+  )
+{
+  mMeasuredBaseFvIndex    = 0;
+  mPreHashedFvIndex       = 0;
+  mStubHobSize            = 0;
+  mStubPcrExtendCount     = 0;
+  mStubHashAndExtendCount = 0;
+  ZeroMem (mStubHob, sizeof (mStubHob));
+  ZeroMem (mStubPcrExtend, sizeof (mStubPcrExtend));
+}
+
+/**
+  Create the FVs of the tests, with an extended header that names them, and
+  set the PCR banks of the context.
+
+  @param[in]  Context    Pointer to the HASH_ALG_* bits of the PCR banks.
+
+  @retval  UNIT_TEST_PASSED                      The FVs are created.
+  @retval  UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  There is not enough memory.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+Tcg2PeiTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN                           Index;
+  UINTN                           Offset;
+  UINT8                           *Fv;
+  EFI_FIRMWARE_VOLUME_HEADER      *FvHeader;
+  EFI_FIRMWARE_VOLUME_EXT_HEADER  *FvExtHeader;
+
+  for (Index = 0; Index < TCG2_PEI_TEST_FV_COUNT; Index++) {
+    Fv = AllocatePool (TCG2_PEI_TEST_FV_SIZE);
+    if (Fv == NULL) {
+      return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+    }
+    for (Offset = 0; Offset < TCG2_PEI_TEST_FV_SIZE; Offset++) {
+      Fv[Offset] = (UINT8) (Offset * (Index + 3) + Index);
+    }
+    FvHeader = (EFI_FIRMWARE_VOLUME_HEADER *) Fv;
+    FvHeader->ExtHeaderOffset = sizeof (EFI_FIRMWARE_VOLUME_HEADER);
+    FvExtHeader = (EFI_FIRMWARE_VOLUME_EXT_HEADER *) (Fv + FvHeader->ExtHeaderOffset);
+    ZeroMem (&FvExtHeader->FvName, sizeof (FvExtHeader->FvName));
+    FvExtHeader->FvName.Data1 = (UINT32) Index + 1;
+
+    mTestFvInfo[Index].BlobBase   = (EFI_PHYSICAL_ADDRESS) (UINTN) Fv;
+    mTestFvInfo[Index].BlobLength = TCG2_PEI_TEST_FV_SIZE;
+  }
+
+  mStubTpm2HashMask            = *(UINT32 *) Context;
+  mStubTcg2HashAlgorithmBitmap = TCG2_PEI_TEST_ALL_HASH;
+  mStubHashFailMask            = 0;
+  mStubMpServicesInstalled     = FALSE;
+  mStubMpServices2Installed    = FALSE;
+  mStubStartupAllApsCount      = 0;
+  mStubStartupAllCpusCount     = 0;
+  ResetMeasurements ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free the FVs of the tests.
+
+  @param[in]  Context    Unused.
+**/
+VOID
+EFIAPI
+Tcg2PeiTestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < TCG2_PEI_TEST_FV_COUNT; Index++) {
+    if (mTestFvInfo[Index].BlobBase != 0) {
+      FreePool ((VOID *) (UINTN) mTestFvInfo[Index].BlobBase);
+      mTestFvInfo[Index].BlobBase = 0;
+    }
+  }
+}
+
+/**
+  Measure the FVs of the tests through HashLogExtendEvent(), record the
+  GUIDed HOBs and PCR extends as the expected ones, and forget the
+  measurements.
+
+  @retval  UNIT_TEST_PASSED             The FVs are measured.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The FVs are not measured through
+                                        HashLogExtendEvent().
+**/
+UNIT_TEST_STATUS
+MeasureExpectedFvs (
+  VOID
+  )
+{
+  UINTN       Index;
+  EFI_STATUS  Status;
+
+  mStubHashFailMask = TCG2_PEI_TEST_ALL_HASH;
+  for (Index = 0; Index < TCG2_PEI_TEST_FV_COUNT; Index++) {
+    Status = MeasureFvImage (mTestFvInfo[Index].BlobBase, mTestFvInfo[Index].BlobLength);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+  UT_ASSERT_EQUAL (mStubHashAndExtendCount, TCG2_PEI_TEST_FV_COUNT);
+  UT_ASSERT_EQUAL (mStubPcrExtendCount, TCG2_PEI_TEST_FV_COUNT);
+  UT_ASSERT_NOT_EQUAL (mStubHobSize, 0);
+
+  CopyMem (mExpectedHob, mStubHob, sizeof (mExpectedHob));
+  mExpectedHobSize = mStubHobSize;
+  CopyMem (mExpectedPcrExtend, mStubPcrExtend, sizeof (mExpectedPcrExtend));
+  mExpectedPcrExtendCount = mStubPcrExtendCount;
+
+  mStubHashFailMask = 0;
+  ResetMeasurements ();
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Measure the FVs of the tests, and check that the GUIDed HOBs and PCR
+  extends are the expected ones.
+
+  @param[in]  HashAndExtendCount  The number of FVs expected to be measured
+                                  through HashLogExtendEvent().
+
+  @retval  UNIT_TEST_PASSED             The measurements are the expected ones.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The measurements are not the expected ones.
+**/
+UNIT_TEST_STATUS
+CheckMeasuredFvs (
+  IN UINTN  HashAndExtendCount
+  )
+{
+  UINTN       Index;
+  EFI_STATUS  Status;
+
+  for (Index = 0; Index < TCG2_PEI_TEST_FV_COUNT; Index++) {
+    Status = MeasureFvImage (mTestFvInfo[Index].BlobBase, mTestFvInfo[Index].BlobLength);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+  UT_ASSERT_EQUAL (mStubHashAndExtendCount, HashAndExtendCount);
+  UT_ASSERT_EQUAL (mStubPcrExtendCount, mExpectedPcrExtendCount);
+  UT_ASSERT_MEM_EQUAL (mStubPcrExtend, mExpectedPcrExtend, sizeof (mStubPcrExtend));
+  UT_ASSERT_EQUAL (mStubHobSize, mExpectedHobSize);
+  UT_ASSERT_MEM_EQUAL (mStubHob, mExpectedHob, sizeof (mStubHob));
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that FVs that MeasureFvImage() pre-hashes one at a time, without MP
+  services, are extended and logged the way HashLogExtendEvent() does.
+
+  @param[in]  Context    Pointer to the HASH_ALG_* bits of the PCR banks.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+PreHashedFvShouldBeLoggedLikeHashLogExtendEvent (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  TestStatus;
+
+  TestStatus = MeasureExpectedFvs ();
+  if (TestStatus != UNIT_TEST_PASSED) {
+    return TestStatus;
+  }
+
+  TestStatus = CheckMeasuredFvs (0);
+  if (TestStatus != UNIT_TEST_PASSED) {
+    return TestStatus;
+  }
+  UT_ASSERT_EQUAL (mPreHashedFvIndex, TCG2_PEI_TEST_FV_COUNT);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that a batch of FVs is hashed by the BSP and the APs together through
+  StartupAllCPUs() when the EDKII MP Services 2 PPI is installed, and that the
+  FVs are extended and logged the way HashLogExtendEvent() does.
+
+  @param[in]  Context    Pointer to the HASH_ALG_* bits of the PCR banks.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FvBatchShouldBeHashedOnAllCpus (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  TestStatus;
+
+  TestStatus = MeasureExpectedFvs ();
+  if (TestStatus != UNIT_TEST_PASSED) {
+    return TestStatus;
+  }
+
+  mStubMpServicesInstalled  = TRUE;
+  mStubMpServices2Installed = TRUE;
+  PreHashFvImages (mTestFvInfo, TCG2_PEI_TEST_FV_COUNT);
+  UT_ASSERT_EQUAL (mStubStartupAllCpusCount, 1);
+  UT_ASSERT_EQUAL (mStubStartupAllApsCount, 0);
+  UT_ASSERT_EQUAL (mPreHashedFvIndex, TCG2_PEI_TEST_FV_COUNT);
+
+  return CheckMeasuredFvs (0);
+}
+
+/**
+  Check that a batch of FVs is hashed through StartupAllAPs() when only the
+  MP Services PPI is installed, and that the FVs are extended and logged the
+  way HashLogExtendEvent() does.
+
+  @param[in]  Context    Pointer to the HASH_ALG_* bits of the PCR banks.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FvBatchShouldBeHashedOnAps (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  TestStatus;
+
+  TestStatus = MeasureExpectedFvs ();
+  if (TestStatus != UNIT_TEST_PASSED) {
+    return TestStatus;
+  }
+
+  mStubMpServicesInstalled = TRUE;
+  PreHashFvImages (mTestFvInfo, TCG2_PEI_TEST_FV_COUNT);
+  UT_ASSERT_EQUAL (mStubStartupAllCpusCount, 0);
+  UT_ASSERT_EQUAL (mStubStartupAllApsCount, 1);
+  UT_ASSERT_EQUAL (mPreHashedFvIndex, TCG2_PEI_TEST_FV_COUNT);
+
+  return CheckMeasuredFvs (0);
+}
+
+/**
+  Check that FVs with a digest that cannot be computed are left out of the
+  pre-hashed FV list, and are measured through HashLogExtendEvent().
+
+  @param[in]  Context    Pointer to the HASH_ALG_* bits of the PCR banks.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FailedPreHashShouldUseHashLogExtendEvent (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UNIT_TEST_STATUS  TestStatus;
+
+  TestStatus = MeasureExpectedFvs ();
+  if (TestStatus != UNIT_TEST_PASSED) {
+    return TestStatus;
+  }
+
+  mStubMpServices2Installed = TRUE;
+  mStubHashFailMask         = HASH_ALG_SHA256;
+  PreHashFvImages (mTestFvInfo, TCG2_PEI_TEST_FV_COUNT);
+  UT_ASSERT_EQUAL (mStubStartupAllCpusCount, 1);
+  UT_ASSERT_EQUAL (mPreHashedFvIndex, 0);
+
+  return CheckMeasuredFvs (TCG2_PEI_TEST_FV_COUNT);
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the
+  pre-hashed FVs of Tcg2Pei and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      PreHashTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&PreHashTests, Framework, "Tcg2Pei Pre-Hashed FV Tests", "Tcg2Pei.PreHash", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for PreHashTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (PreHashTests, "Pre-hashed FV should be logged like HashLogExtendEvent, all banks", "AllBanks", PreHashedFvShouldBeLoggedLikeHashLogExtendEvent, Tcg2PeiTestSetup, Tcg2PeiTestCleanup, &mAllBanks);
+  AddTestCase (PreHashTests, "Pre-hashed FV should be logged like HashLogExtendEvent, SHA-256 bank", "Sha256Bank", PreHashedFvShouldBeLoggedLikeHashLogExtendEvent, Tcg2PeiTestSetup, Tcg2PeiTestCleanup, &mSha256Bank);
+  AddTestCase (PreHashTests, "FV batch should be hashed on all CPUs", "AllCpus", FvBatchShouldBeHashedOnAllCpus, Tcg2PeiTestSetup, Tcg2PeiTestCleanup, &mAllBanks);
+  AddTestCase (PreHashTests, "FV batch should be hashed on the APs", "Aps", FvBatchShouldBeHashedOnAps, Tcg2PeiTestSetup, Tcg2PeiTestCleanup, &mAllBanks);
+  AddTestCase (PreHashTests, "Failed pre-hash should use HashLogExtendEvent", "Failed", FailedPreHashShouldUseHashLogExtendEvent, Tcg2PeiTestSetup, Tcg2PeiTestCleanup, &mAllBanks);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,89 @@
+/** @file
+  Definitions shared by the host based unit tests of Tcg2Pei and the
+  stand-ins of the services it depends on.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _TCG2_PEI_UNIT_TEST_H_
+#define _TCG2_PEI_UNIT_TEST_H_
+
+#include <PiPei.h>
+#include <IndustryStandard/UefiTcgPlatform.h>
+
+//
+// Size of the HOB buffer, and number of PCR extends recorded
+//
+#define TCG2_PEI_TEST_HOB_SIZE      0x4000
+#define TCG2_PEI_TEST_EXTEND_COUNT  8
+
+//
+// GUIDed HOBs built, PCR extends, and number of HashAndExtend() calls
+//
+extern UINT8               mStubHob[TCG2_PEI_TEST_HOB_SIZE];
+extern UINTN               mStubHobSize;
+extern TPML_DIGEST_VALUES  mStubPcrExtend[TCG2_PEI_TEST_EXTEND_COUNT];
+extern UINTN               mStubPcrExtendCount;
+extern UINTN               mStubHashAndExtendCount;
+
+//
+// Hash algorithms of BaseCryptLib that fail, as HASH_ALG_* bits
+//
+extern UINT32              mStubHashFailMask;
+
+//
+// MP services installed, and number of times they run a procedure
+//
+extern BOOLEAN             mStubMpServicesInstalled;
+extern BOOLEAN             mStubMpServices2Installed;
+extern UINTN               mStubStartupAllApsCount;
+extern UINTN               mStubStartupAllCpusCount;
+
+//
+// Values of the dynamic PCDs
+//
+extern UINT32              mStubTpm2HashMask;
+extern UINT32              mStubTcg2HashAlgorithmBitmap;
+
+//
+// Measured and pre-hashed FV lists of Tcg2Pei
+//
+extern UINT32              mMeasuredBaseFvIndex;
+extern UINT32              mPreHashedFvIndex;
+
+/**
+  Hash FVs before they are measured, with the hash algorithms of the PCR banks,
+  and add them into the pre-hashed FV list.
+
+  @param[in]  FvInfo            The base addresses and lengths of the FVs.
+  @param[in]  FvCount           The number of FVs in FvInfo.
+
+**/
+VOID
+PreHashFvImages (
+  IN EFI_PLATFORM_FIRMWARE_BLOB     *FvInfo,
+  IN UINT32                         FvCount
+  );
+
+/**
+  Measure FV image.
+  Add it into the measured FV list after the FV is measured successfully.
+
+  @param[in]  FvBase            Base address of FV image.
+  @param[in]  FvLength          Length of FV image.
+
+  @retval EFI_SUCCESS           Fv image is measured successfully
+                                or it has been already measured.
+  @retval EFI_OUT_OF_RESOURCES  No enough memory to log the new event.
+  @retval EFI_DEVICE_ERROR      The command was unsuccessful.
+
+**/
+EFI_STATUS
+MeasureFvImage (
+  IN EFI_PHYSICAL_ADDRESS           FvBase,
+  IN UINT64                         FvLength
+  );
+
+#endif
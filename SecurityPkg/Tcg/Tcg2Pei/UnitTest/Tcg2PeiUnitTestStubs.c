@@ -0,0 +1,842 @@
+/** @file
+  Host based stand-ins for the services that the FV measurement of Tcg2Pei
+  depends on, for the tests of the pre-hashed FVs.
+
+  The stand-ins model a TPM whose PCR extends are recorded, and GUIDed HOBs
+  that are appended to one buffer, so the tests can compare the event logs.
+  The hash algorithms of BaseCryptLib and HashLib are replaced by the same
+  digest function, which the tests can make fail for BaseCryptLib only, and
+  the MP services run the procedure on the calling processor.  The dynamic
+  PCDs of the tests are kept in variables.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <PiPei.h>
+
+#include <Ppi/MpServices.h>
+#include <Ppi/MpServices2.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PeiServicesLib.h>
+#include <Library/PeiServicesTablePointerLib.h>
+#include <Library/HobLib.h>
+#include <Library/HashLib.h>
+#include <Library/Tpm2CommandLib.h>
+#include <Library/Tpm2DeviceLib.h>
+#include <Library/BaseCryptLib.h>
+#include <Library/PcdLib.h>
+
+#include "Tcg2PeiUnitTest.h"
+
+//
+// GUIDed HOBs built, PCR extends, and number of HashAndExtend() calls
+//
+UINT8               mStubHob[TCG2_PEI_TEST_HOB_SIZE];
+UINTN               mStubHobSize;
+TPML_DIGEST_VALUES  mStubPcrExtend[TCG2_PEI_TEST_EXTEND_COUNT];
+UINTN               mStubPcrExtendCount;
+UINTN               mStubHashAndExtendCount;
+
+//
+// Hash algorithms of BaseCryptLib that fail, as HASH_ALG_* bits
+//
+UINT32              mStubHashFailMask;
+
+//
+// MP services installed, and number of times they run a procedure
+//
+BOOLEAN             mStubMpServicesInstalled;
+BOOLEAN             mStubMpServices2Installed;
+UINTN               mStubStartupAllApsCount;
+UINTN               mStubStartupAllCpusCount;
+
+//
+// Values of the dynamic PCDs
+//
+UINT32              mStubTpm2HashMask;
+UINT32              mStubTcg2HashAlgorithmBitmap;
+
+typedef struct {
+  TPMI_ALG_HASH     HashAlgo;
+  UINT16            HashSize;
+  UINT32            HashMask;
+} STUB_HASH_INFO;
+
+//
+// The hash algorithms, in the order HashLib registers them
+//
+STATIC STUB_HASH_INFO  mStubHashInfo[] = {
+  {TPM_ALG_SHA1,    SHA1_DIGEST_SIZE,    HASH_ALG_SHA1},
+  {TPM_ALG_SHA256,  SHA256_DIGEST_SIZE,  HASH_ALG_SHA256},
+  {TPM_ALG_SHA384,  SHA384_DIGEST_SIZE,  HASH_ALG_SHA384},
+  {TPM_ALG_SHA512,  SHA512_DIGEST_SIZE,  HASH_ALG_SHA512},
+  {TPM_ALG_SM3_256, SM3_256_DIGEST_SIZE, HASH_ALG_SM3_256},
+};
+
+/**
+  Get the hash algorithm information of an algorithm.
+
+  @param[in] HashAlgo  Hash algorithm
+
+  @return The hash algorithm information, or NULL if it is not supported.
+**/
+STATIC
+STUB_HASH_INFO *
+StubGetHashInfo (
+  IN TPMI_ALG_HASH  HashAlgo
+  )
+{
+  UINTN  Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (mStubHashInfo); Index++) {
+    if (mStubHashInfo[Index].HashAlgo == HashAlgo) {
+      return &mStubHashInfo[Index];
+    }
+  }
+  return NULL;
+}
+
+/**
+  Compute the digest of the tests for a hash algorithm: an FNV-1a hash of
+  the algorithm and the data, spread over the digest size.
+
+  @param[in]  HashInfo   The hash algorithm.
+  @param[in]  Data       Pointer to the data to hash.
+  @param[in]  DataSize   Size of Data in bytes.
+  @param[out] HashValue  Pointer to the buffer that receives the digest.
+**/
+STATIC
+VOID
+StubHashAll (
+  IN  STUB_HASH_INFO  *HashInfo,
+  IN  CONST VOID      *Data,
+  IN  UINTN           DataSize,
+  OUT UINT8           *HashValue
+  )
+{
+  UINT64       Hash;
+  CONST UINT8  *Byte;
+  UINTN        Index;
+
+  Hash = 0xCBF29CE484222325ULL ^ HashInfo->HashAlgo;
+  Byte = Data;
+  for (Index = 0; Index < DataSize; Index++) {
+    Hash = (Hash ^ Byte[Index]) * 0x100000001B3ULL;
+  }
+  for (Index = 0; Index < HashInfo->HashSize; Index++) {
+    Hash = (Hash ^ Index) * 0x100000001B3ULL;
+    HashValue[Index] = (UINT8) (Hash >> 56);
+  }
+}
+
+/**
+  Compute the digest of the tests with a hash algorithm of BaseCryptLib,
+  unless the tests make it fail.
+
+  @param[in]  HashAlgo   The hash algorithm.
+  @param[in]  Data       Pointer to the data to hash.
+  @param[in]  DataSize   Size of Data in bytes.
+  @param[out] HashValue  Pointer to the buffer that receives the digest.
+
+  @retval TRUE   The digest is computed.
+  @retval FALSE  The hash algorithm fails.
+**/
+STATIC
+BOOLEAN
+StubCryptHashAll (
+  IN  TPMI_ALG_HASH  HashAlgo,
+  IN  CONST VOID     *Data,
+  IN  UINTN          DataSize,
+  OUT UINT8          *HashValue
+  )
+{
+  STUB_HASH_INFO  *HashInfo;
+
+  HashInfo = StubGetHashInfo (HashAlgo);
+  if ((HashInfo == NULL) || ((HashInfo->HashMask & mStubHashFailMask) != 0)) {
+    return FALSE;
+  }
+  StubHashAll (HashInfo, Data, DataSize, HashValue);
+  return TRUE;
+}
+
+/**
+  Computes the SHA-1 digest of the tests.
+
+  @param[in]   Data        Pointer to the buffer containing the data to be hashed.
+  @param[in]   DataSize    Size of Data buffer in bytes.
+  @param[out]  HashValue   Pointer to a buffer that receives the SHA-1 digest value.
+
+  @retval TRUE   SHA-1 digest computation succeeded.
+  @retval FALSE  The tests make SHA-1 fail.
+**/
+BOOLEAN
+EFIAPI
+Sha1HashAll (
+  IN   CONST VOID  *Data,
+  IN   UINTN       DataSize,
+  OUT  UINT8       *HashValue
+  )
+{
+  return StubCryptHashAll (TPM_ALG_SHA1, Data, DataSize, HashValue);
+}
+
+/**
+  Computes the SHA-256 digest of the tests.
+
+  @param[in]   Data        Pointer to the buffer containing the data to be hashed.
+  @param[in]   DataSize    Size of Data buffer in bytes.
+  @param[out]  HashValue   Pointer to a buffer that receives the SHA-256 digest value.
+
+  @retval TRUE   SHA-256 digest computation succeeded.
+  @retval FALSE  The tests make SHA-256 fail.
+**/
+BOOLEAN
+EFIAPI
+Sha256HashAll (
+  IN   CONST VOID  *Data,
+  IN   UINTN       DataSize,
+  OUT  UINT8       *HashValue
+  )
+{
+  return StubCryptHashAll (TPM_ALG_SHA256, Data, DataSize, HashValue);
+}
+
+/**
+  Computes the SHA-384 digest of the tests.
+
+  @param[in]   Data        Pointer to the buffer containing the data to be hashed.
+  @param[in]   DataSize    Size of Data buffer in bytes.
+  @param[out]  HashValue   Pointer to a buffer that receives the SHA-384 digest value.
+
+  @retval TRUE   SHA-384 digest computation succeeded.
+  @retval FALSE  The tests make SHA-384 fail.
+**/
+BOOLEAN
+EFIAPI
+Sha384HashAll (
+  IN   CONST VOID  *Data,
+  IN   UINTN       DataSize,
+  OUT  UINT8       *HashValue
+  )
+{
+  return StubCryptHashAll (TPM_ALG_SHA384, Data, DataSize, HashValue);
+}
+
+/**
+  Computes the SHA-512 digest of the tests.
+
+  @param[in]   Data        Pointer to the buffer containing the data to be hashed.
+  @param[in]   DataSize    Size of Data buffer in bytes.
+  @param[out]  HashValue   Pointer to a buffer that receives the SHA-512 digest value.
+
+  @retval TRUE   SHA-512 digest computation succeeded.
+  @retval FALSE  The tests make SHA-512 fail.
+**/
+BOOLEAN
+EFIAPI
+Sha512HashAll (
+  IN   CONST VOID  *Data,
+  IN   UINTN       DataSize,
+  OUT  UINT8       *HashValue
+  )
+{
+  return StubCryptHashAll (TPM_ALG_SHA512, Data, DataSize, HashValue);
+}
+
+/**
+  Computes the SM3 digest of the tests.
+
+  @param[in]   Data        Pointer to the buffer containing the data to be hashed.
+  @param[in]   DataSize    Size of Data buffer in bytes.
+  @param[out]  HashValue   Pointer to a buffer that receives the SM3 digest value.
+
+  @retval TRUE   SM3 digest computation succeeded.
+  @retval FALSE  The tests make SM3 fail.
+**/
+BOOLEAN
+EFIAPI
+Sm3HashAll (
+  IN   CONST VOID  *Data,
+  IN   UINTN       DataSize,
+  OUT  UINT8       *HashValue
+  )
+{
+  return StubCryptHashAll (TPM_ALG_SM3_256, Data, DataSize, HashValue);
+}
+
+/**
+  Hash data with the algorithms of the PCR banks of PcdTpm2HashMask, the way
+  HashLib does, and extend the digests into a PCR.
+
+  @param[in]  PcrIndex         PCR to be extended.
+  @param[in]  DataToHash       Data to be hashed.
+  @param[in]  DataToHashLen    Data size.
+  @param[out] DigestList       Digest list.
+
+  @return The status of the PCR extend.
+**/
+EFI_STATUS
+EFIAPI
+HashAndExtend (
+  IN TPMI_DH_PCR                    PcrIndex,
+  IN VOID                           *DataToHash,
+  IN UINTN                          DataToHashLen,
+  OUT TPML_DIGEST_VALUES            *DigestList
+  )
+{
+  UINTN   Index;
+  UINT32  Count;
+
+  mStubHashAndExtendCount++;
+
+  ZeroMem (DigestList, sizeof (*DigestList));
+  Count = 0;
+  for (Index = 0; Index < ARRAY_SIZE (mStubHashInfo); Index++) {
+    if ((mStubHashInfo[Index].HashMask & PcdGet32 (PcdTpm2HashMask)) != 0) {
+      DigestList->digests[Count].hashAlg = mStubHashInfo[Index].HashAlgo;
+      StubHashAll (&mStubHashInfo[Index], DataToHash, DataToHashLen, (UINT8 *) &DigestList->digests[Count].digest);
+      Count++;
+    }
+  }
+  DigestList->count = Count;
+
+  return Tpm2PcrExtend (PcrIndex, DigestList);
+}
+
+/**
+  Record a PCR extend.
+
+  @param[in] PcrHandle  Handle of the PCR.
+  @param[in] Digests    List of tagged digest values to be extended.
+
+  @retval EFI_SUCCESS       The extend is recorded.
+  @retval EFI_DEVICE_ERROR  The tests extend more PCRs than they record.
+**/
+EFI_STATUS
+EFIAPI
+Tpm2PcrExtend (
+  IN      TPMI_DH_PCR               PcrHandle,
+  IN      TPML_DIGEST_VALUES        *Digests
+  )
+{
+  if (mStubPcrExtendCount >= TCG2_PEI_TEST_EXTEND_COUNT) {
+    return EFI_DEVICE_ERROR;
+  }
+  CopyMem (&mStubPcrExtend[mStubPcrExtendCount++], Digests, sizeof (*Digests));
+  return EFI_SUCCESS;
+}
+
+/**
+  The tests do not start the TPM.
+
+  @param[in] StartupType  Unused.
+
+  @retval EFI_DEVICE_ERROR  The TPM is not started.
+**/
+EFI_STATUS
+EFIAPI
+Tpm2Startup (
+  IN      TPM_SU             StartupType
+  )
+{
+  return EFI_DEVICE_ERROR;
+}
+
+/**
+  The tests do not test the TPM.
+
+  @param[in] FullTest  Unused.
+
+  @retval EFI_DEVICE_ERROR  The TPM is not tested.
+**/
+EFI_STATUS
+EFIAPI
+Tpm2SelfTest (
+  IN TPMI_YES_NO          FullTest
+  )
+{
+  return EFI_DEVICE_ERROR;
+}
+
+/**
+  The tests do not allocate the PCR banks.
+
+  @param[in] PlatformAuth       Unused.
+  @param[in] SupportedPCRBanks  Unused.
+  @param[in] PCRBanks           Unused.
+
+  @retval EFI_DEVICE_ERROR  The PCR banks are not allocated.
+**/
+EFI_STATUS
+EFIAPI
+Tpm2PcrAllocateBanks (
+  IN TPM2B_AUTH                *PlatformAuth,  OPTIONAL
+  IN UINT32                    SupportedPCRBanks,
+  IN UINT32                    PCRBanks
+  )
+{
+  return EFI_DEVICE_ERROR;
+}
+
+/**
+  The tests do not get the capabilities of the TPM.
+
+  @param[out] TpmHashAlgorithmBitmap  Unused.
+  @param[out] ActivePcrBanks          Unused.
+
+  @retval EFI_DEVICE_ERROR  The capabilities are not returned.
+**/
+EFI_STATUS
+EFIAPI
+Tpm2GetCapabilitySupportedAndActivePcrs (
+  OUT UINT32                            *TpmHashAlgorithmBitmap,
+  OUT UINT32                            *ActivePcrBanks
+  )
+{
+  return EFI_DEVICE_ERROR;
+}
+
+/**
+  The tests do not use the TPM device.
+
+  @retval EFI_NOT_FOUND  There is no TPM device.
+**/
+EFI_STATUS
+EFIAPI
+Tpm2RequestUseTpm (
+  VOID
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Get hash mask from algorithm.
+
+  @param[in] HashAlgo   Hash algorithm
+
+  @return Hash mask
+**/
+UINT32
+EFIAPI
+GetHashMaskFromAlgo (
+  IN TPMI_ALG_HASH     HashAlgo
+  )
+{
+  STUB_HASH_INFO  *HashInfo;
+
+  HashInfo = StubGetHashInfo (HashAlgo);
+  return (HashInfo == NULL) ? 0 : HashInfo->HashMask;
+}
+
+/**
+  Copy TPML_DIGEST_VALUES into a buffer
+
+  @param[in,out] Buffer             Buffer to hold copied TPML_DIGEST_VALUES compact binary.
+  @param[in]     DigestList         TPML_DIGEST_VALUES to be copied.
+  @param[in]     HashAlgorithmMask  HASH bits corresponding to the desired digests to copy.
+
+  @return The end of buffer to hold TPML_DIGEST_VALUES.
+**/
+VOID *
+EFIAPI
+CopyDigestListToBuffer (
+  IN OUT VOID                       *Buffer,
+  IN TPML_DIGEST_VALUES             *DigestList,
+  IN UINT32                         HashAlgorithmMask
+  )
+{
+  UINTN           Index;
+  UINT32          DigestListCount;
+  UINT32          *DigestListCountPtr;
+  STUB_HASH_INFO  *HashInfo;
+
+  DigestListCountPtr = (UINT32 *) Buffer;
+  DigestListCount    = 0;
+  Buffer = (UINT8 *) Buffer + sizeof (DigestList->count);
+  for (Index = 0; Index < DigestList->count; Index++) {
+    HashInfo = StubGetHashInfo (DigestList->digests[Index].hashAlg);
+    if ((HashInfo == NULL) || ((HashInfo->HashMask & HashAlgorithmMask) == 0)) {
+      continue;
+    }
+    CopyMem (Buffer, &DigestList->digests[Index].hashAlg, sizeof (DigestList->digests[Index].hashAlg));
+    Buffer = (UINT8 *) Buffer + sizeof (DigestList->digests[Index].hashAlg);
+    CopyMem (Buffer, &DigestList->digests[Index].digest, HashInfo->HashSize);
+    Buffer = (UINT8 *) Buffer + HashInfo->HashSize;
+    DigestListCount++;
+  }
+  WriteUnaligned32 (DigestListCountPtr, DigestListCount);
+
+  return Buffer;
+}
+
+/**
+  Get TPML_DIGEST_VALUES data size.
+
+  @param[in]     DigestList    TPML_DIGEST_VALUES data.
+
+  @return TPML_DIGEST_VALUES data size.
+**/
+UINT32
+EFIAPI
+GetDigestListSize (
+  IN TPML_DIGEST_VALUES             *DigestList
+  )
+{
+  UINTN           Index;
+  UINT32          TotalSize;
+  STUB_HASH_INFO  *HashInfo;
+
+  TotalSize = sizeof (DigestList->count);
+  for (Index = 0; Index < DigestList->count; Index++) {
+    HashInfo   = StubGetHashInfo (DigestList->digests[Index].hashAlg);
+    TotalSize += sizeof (DigestList->digests[Index].hashAlg) + ((HashInfo == NULL) ? 0 : HashInfo->HashSize);
+  }
+
+  return TotalSize;
+}
+
+/**
+  This function get digest from digest list.
+
+  @param[in]  HashAlg       Digest algorithm
+  @param[in]  DigestList    Digest list
+  @param[out] Digest        Digest
+
+  @retval EFI_SUCCESS       Digest is found and returned.
+  @retval EFI_NOT_FOUND     Digest is not found.
+**/
+EFI_STATUS
+EFIAPI
+GetDigestFromDigestList (
+  IN TPMI_ALG_HASH      HashAlg,
+  IN TPML_DIGEST_VALUES *DigestList,
+  OUT VOID              *Digest
+  )
+{
+  UINTN           Index;
+  STUB_HASH_INFO  *HashInfo;
+
+  HashInfo = StubGetHashInfo (HashAlg);
+  for (Index = 0; (HashInfo != NULL) && (Index < DigestList->count); Index++) {
+    if (DigestList->digests[Index].hashAlg == HashAlg) {
+      CopyMem (Digest, &DigestList->digests[Index].digest, HashInfo->HashSize);
+      return EFI_SUCCESS;
+    }
+  }
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+  Append a GUIDed HOB to the HOB buffer of the tests.
+
+  @param[in]  Guid        The GUID to tag the customized HOB.
+  @param[in]  DataLength  The size of the data payload for the GUID HOB.
+
+  @return The start address of GUID HOB data, or NULL if the HOB buffer is full.
+**/
+VOID *
+EFIAPI
+BuildGuidHob (
+  IN CONST EFI_GUID              *Guid,
+  IN UINTN                       DataLength
+  )
+{
+  EFI_HOB_GUID_TYPE  *Hob;
+  UINTN              HobLength;
+
+  HobLength = ALIGN_VALUE (sizeof (EFI_HOB_GUID_TYPE) + DataLength, 8);
+  if (HobLength > sizeof (mStubHob) - mStubHobSize) {
+    return NULL;
+  }
+  Hob = (EFI_HOB_GUID_TYPE *) &mStubHob[mStubHobSize];
+  ZeroMem (Hob, HobLength);
+  Hob->Header.HobType   = EFI_HOB_TYPE_GUID_EXTENSION;
+  Hob->Header.HobLength = (UINT16) HobLength;
+  CopyGuid (&Hob->Name, Guid);
+  mStubHobSize += HobLength;
+  return Hob + 1;
+}
+
+/**
+  Find the first GUIDed HOB of the HOB buffer of the tests with a given GUID.
+
+  @param[in]  Guid  The GUID to match with in the HOB list.
+
+  @return The first instance of the matched GUID HOB, or NULL if there is none.
+**/
+VOID *
+EFIAPI
+GetFirstGuidHob (
+  IN CONST EFI_GUID         *Guid
+  )
+{
+  UINTN              Offset;
+  EFI_HOB_GUID_TYPE  *Hob;
+
+  for (Offset = 0; Offset < mStubHobSize; Offset += Hob->Header.HobLength) {
+    Hob = (EFI_HOB_GUID_TYPE *) &mStubHob[Offset];
+    if (CompareGuid (&Hob->Name, Guid)) {
+      return Hob;
+    }
+  }
+  return NULL;
+}
+
+/**
+  Run a procedure on all the APs of the tests, which is the calling processor.
+
+  @param[in] PeiServices          Unused.
+  @param[in] This                 Unused.
+  @param[in] Procedure            The procedure to run.
+  @param[in] SingleThread         Unused.
+  @param[in] TimeoutInMicroSeconds  Unused.
+  @param[in] ProcedureArgument    The parameter passed into Procedure.
+
+  @retval EFI_SUCCESS  The procedure ran.
+**/
+EFI_STATUS
+EFIAPI
+StubStartupAllAPs (
+  IN  CONST EFI_PEI_SERVICES    **PeiServices,
+  IN  EFI_PEI_MP_SERVICES_PPI   *This,
+  IN  EFI_AP_PROCEDURE          Procedure,
+  IN  BOOLEAN                   SingleThread,
+  IN  UINTN                     TimeoutInMicroSeconds,
+  IN  VOID                      *ProcedureArgument      OPTIONAL
+  )
+{
+  mStubStartupAllApsCount++;
+  Procedure (ProcedureArgument);
+  return EFI_SUCCESS;
+}
+
+/**
+  Run a procedure on all the processors of the tests, which is the calling
+  processor.
+
+  @param[in] This                 Unused.
+  @param[in] Procedure            The procedure to run.
+  @param[in] TimeoutInMicroSeconds  Unused.
+  @param[in] ProcedureArgument    The parameter passed into Procedure.
+
+  @retval EFI_SUCCESS  The procedure ran.
+**/
+EFI_STATUS
+EFIAPI
+StubStartupAllCPUs (
+  IN  EDKII_PEI_MP_SERVICES2_PPI     *This,
+  IN  EFI_AP_PROCEDURE               Procedure,
+  IN  UINTN                          TimeoutInMicroSeconds,
+  IN  VOID                           *ProcedureArgument      OPTIONAL
+  )
+{
+  mStubStartupAllCpusCount++;
+  Procedure (ProcedureArgument);
+  return EFI_SUCCESS;
+}
+
+EFI_PEI_MP_SERVICES_PPI     mStubMpServices  = { NULL, NULL, StubStartupAllAPs };
+EDKII_PEI_MP_SERVICES2_PPI  mStubMpServices2 = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, StubStartupAllCPUs };
+
+/**
+  Locate the MP services of the tests, if they are installed.
+
+  @param[in]  Guid        The GUID of the PPI.
+  @param[in]  Instance    The instance number of the PPI.
+  @param[out] PpiDescriptor  Unused.
+  @param[out] Ppi         Returns the PPI.
+
+  @retval EFI_SUCCESS     The PPI is found.
+  @retval EFI_NOT_FOUND   The PPI is not installed.
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesLocatePpi (
+  IN CONST EFI_GUID             *Guid,
+  IN UINTN                      Instance,
+  IN OUT EFI_PEI_PPI_DESCRIPTOR **PpiDescriptor,
+  IN OUT VOID                   **Ppi
+  )
+{
+  if (Instance == 0) {
+    if (mStubMpServicesInstalled && CompareGuid (Guid, &gEfiPeiMpServicesPpiGuid)) {
+      *Ppi = &mStubMpServices;
+      return EFI_SUCCESS;
+    }
+    if (mStubMpServices2Installed && CompareGuid (Guid, &gEdkiiPeiMpServices2PpiGuid)) {
+      *Ppi = &mStubMpServices2;
+      return EFI_SUCCESS;
+    }
+  }
+  return EFI_NOT_FOUND;
+}
+
+/**
+  The tests do not install PPIs.
+
+  @param[in] PpiList  Unused.
+
+  @retval EFI_OUT_OF_RESOURCES  The PPIs are not installed.
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesInstallPpi (
+  IN CONST EFI_PEI_PPI_DESCRIPTOR     *PpiList
+  )
+{
+  return EFI_OUT_OF_RESOURCES;
+}
+
+/**
+  The tests do not register notifies.
+
+  @param[in] NotifyList  Unused.
+
+  @retval EFI_OUT_OF_RESOURCES  The notifies are not registered.
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesNotifyPpi (
+  IN CONST EFI_PEI_NOTIFY_DESCRIPTOR  *NotifyList
+  )
+{
+  return EFI_OUT_OF_RESOURCES;
+}
+
+/**
+  The tests run with the normal boot mode.
+
+  @param[out] BootMode  Returns BOOT_WITH_FULL_CONFIGURATION.
+
+  @retval EFI_SUCCESS  The boot mode is returned.
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesGetBootMode (
+  OUT EFI_BOOT_MODE          *BootMode
+  )
+{
+  *BootMode = BOOT_WITH_FULL_CONFIGURATION;
+  return EFI_SUCCESS;
+}
+
+/**
+  The tests have no firmware volume to find.
+
+  @param[in]  Instance      Unused.
+  @param[out] VolumeHandle  Unused.
+
+  @retval EFI_NOT_FOUND  There is no firmware volume.
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesFfsFindNextVolume (
+  IN UINTN                          Instance,
+  IN OUT EFI_PEI_FV_HANDLE          *VolumeHandle
+  )
+{
+  return EFI_NOT_FOUND;
+}
+
+/**
+  The tests have no firmware volume to get the information of.
+
+  @param[in]  VolumeHandle  Unused.
+  @param[out] VolumeInfo    Unused.
+
+  @retval EFI_INVALID_PARAMETER  There is no firmware volume.
+**/
+EFI_STATUS
+EFIAPI
+PeiServicesFfsGetVolumeInfo (
+  IN  EFI_PEI_FV_HANDLE  VolumeHandle,
+  OUT EFI_FV_INFO        *VolumeInfo
+  )
+{
+  return EFI_INVALID_PARAMETER;
+}
+
+/**
+  The tests have no PEI Services Table.
+
+  @return NULL
+**/
+CONST EFI_PEI_SERVICES **
+EFIAPI
+GetPeiServicesTablePointer (
+  VOID
+  )
+{
+  return NULL;
+}
+
+/**
+  Retrieves a 32-bit dynamic PCD of the tests.
+
+  @param[in]  TokenNumber The PCD token number to retrieve a current value for.
+
+  @return Returns the 32-bit value for the token specified by TokenNumber.
+**/
+UINT32
+EFIAPI
+LibPcdGet32 (
+  IN UINTN             TokenNumber
+  )
+{
+  if (TokenNumber == PcdToken (PcdTpm2HashMask)) {
+    return mStubTpm2HashMask;
+  }
+  if (TokenNumber == PcdToken (PcdTcg2HashAlgorithmBitmap)) {
+    return mStubTcg2HashAlgorithmBitmap;
+  }
+  ASSERT (FALSE);
+  return 0;
+}
+
+/**
+  Sets a 32-bit dynamic PCD of the tests.
+
+  @param[in]  TokenNumber   The PCD token number to set a current value for.
+  @param[in]  Value         The 32-bit value to set.
+
+  @return The status of the set operation.
+**/
+RETURN_STATUS
+EFIAPI
+LibPcdSet32S (
+  IN UINTN          TokenNumber,
+  IN UINT32         Value
+  )
+{
+  if (TokenNumber == PcdToken (PcdTpm2HashMask)) {
+    mStubTpm2HashMask = Value;
+    return RETURN_SUCCESS;
+  }
+  ASSERT (FALSE);
+  return RETURN_UNSUPPORTED;
+}
+
+/**
+  The tests have no dynamic pointer PCD.
+
+  @param[in]  TokenNumber Unused.
+
+  @return NULL
+**/
+VOID *
+EFIAPI
+LibPcdGetPtr (
+  IN UINTN             TokenNumber
+  )
+{
+  ASSERT (FALSE);
+  return NULL;
+}
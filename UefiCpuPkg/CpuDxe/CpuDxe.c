@@ -24,6 +24,12 @@ UINT64                    mValidMtrrAddressMask;
 UINT64                    mValidMtrrBitsMask;
 UINT64                    mTimerPeriod = 0;
 
+//
+// MTRR transaction of the MTRR updates, which keeps the last MTRR settings
+// calculated
+//
+MTRR_TRANSACTION          mMtrrTransaction;
+
 FIXED_MTRR    mFixedMtrrTable[] = {
   {
     MSR_IA32_MTRR_FIX64K_00000,
@@ -390,6 +396,10 @@ CpuSetMemoryAttributes (
   UINT64                    CacheAttributes;
   UINT64                    MemoryAttributes;
   MTRR_MEMORY_CACHE_TYPE    CurrentCacheType;
+  UINT8                     Scratch[SIZE_16KB];
+  VOID                      *LargeScratch;
+  UINTN                     ScratchSize;
+  BOOLEAN                   Modified;
 
   //
   // If this function is called because GCD SetMemorySpaceAttributes () is called
@@ -458,13 +468,37 @@ CpuSetMemoryAttributes (
       //
       // call MTRR library function
       //
-      Status = MtrrSetMemoryAttribute (
+      Modified = FALSE;
+      Status = MtrrTransactionAddRange (
+                 &mMtrrTransaction,
                  BaseAddress,
                  Length,
                  CacheType
                  );
-
       if (!RETURN_ERROR (Status)) {
+        ScratchSize = sizeof (Scratch);
+        Status = MtrrTransactionCommit (&mMtrrTransaction, Scratch, &ScratchSize, &Modified);
+        if (Status == RETURN_BUFFER_TOO_SMALL) {
+          LargeScratch = AllocatePool (ScratchSize);
+          if (LargeScratch != NULL) {
+            Status = MtrrTransactionCommit (&mMtrrTransaction, LargeScratch, &ScratchSize, &Modified);
+            FreePool (LargeScratch);
+          }
+        }
+        if (Status == RETURN_BUFFER_TOO_SMALL) {
+          //
+          // The range stays staged on RETURN_BUFFER_TOO_SMALL. Start the
+          // transaction again so that the next call does not set it.
+          //
+          MtrrTransactionBegin (&mMtrrTransaction, NULL);
+          Status = RETURN_OUT_OF_RESOURCES;
+        }
+      }
+
+      //
+      // Only synchronize the MTRRs with all APs when they changed
+      //
+      if (!RETURN_ERROR (Status) && Modified) {
         MpStatus = gBS->LocateProtocol (
                           &gEfiMpServiceProtocolGuid,
                           NULL,
@@ -1178,6 +1212,8 @@ InitializeCpu (
   //
   InitInterruptDescriptorTable ();
 
+  MtrrTransactionBegin (&mMtrrTransaction, NULL);
+
   //
   // Install CPU Architectural Protocol
   //
@@ -22,6 +22,11 @@ EFI_MP_SERVICES_PROTOCOL  mMpServicesTemplate = {
   WhoAmI
 };
 
+EDKII_MP_TASK_POOL_PROTOCOL  mMpTaskPoolTemplate = {
+  TaskPoolSubmit,
+  TaskPoolJoin
+};
+
 /**
   This service retrieves the number of logical processor in the platform
   and the number of those logical processors that are enabled on this boot.
@@ -512,6 +517,58 @@ WhoAmI (
   return MpInitLibWhoAmI (ProcessorNumber);;
 }
 
+/**
+  Submit a task to the task pool, to run on any enabled processor.
+
+  The first task submitted wakes up the enabled APs, and the MP Services cannot
+  dispatch procedures to them until the BSP joins the task pool.  A task may
+  submit more tasks, which run before the BSP returns from the join.  This
+  service may be called from the BSP, and from the tasks that run on the APs.
+
+  @param[in] This                 A pointer to the EDKII_MP_TASK_POOL_PROTOCOL instance.
+  @param[in] Procedure            A pointer to the function to be run as a task.
+  @param[in] ProcedureArgument    The parameter passed into Procedure.
+
+  @retval EFI_SUCCESS             The task is submitted, or it was run by the calling
+                                  processor because its queue of tasks is full.
+  @retval EFI_DEVICE_ERROR        Caller processor is an AP that is not running a task.
+  @retval EFI_NOT_READY           Any enabled APs are busy.
+  @retval EFI_OUT_OF_RESOURCES    There is not enough memory for the task pool.
+  @retval EFI_INVALID_PARAMETER   Procedure is NULL.
+**/
+EFI_STATUS
+EFIAPI
+TaskPoolSubmit (
+  IN EDKII_MP_TASK_POOL_PROTOCOL  *This,
+  IN EFI_AP_PROCEDURE             Procedure,
+  IN VOID                         *ProcedureArgument  OPTIONAL
+  )
+{
+  return MpInitLibTaskPoolSubmit (Procedure, ProcedureArgument);
+}
+
+/**
+  Join the task pool: the BSP runs the submitted tasks until all of them are
+  finished, and then returns the APs to the MP Services.
+
+  This service may only be called from the BSP, and not from a task.
+
+  @param[in] This                 A pointer to the EDKII_MP_TASK_POOL_PROTOCOL instance.
+
+  @retval EFI_SUCCESS             All the submitted tasks are finished, or no task
+                                  was submitted.
+  @retval EFI_DEVICE_ERROR        Caller processor is AP.
+  @retval EFI_NOT_READY           The BSP is already joining the task pool.
+**/
+EFI_STATUS
+EFIAPI
+TaskPoolJoin (
+  IN EDKII_MP_TASK_POOL_PROTOCOL  *This
+  )
+{
+  return MpInitLibTaskPoolJoin ();
+}
+
 /**
   Collects BIST data from HOB.
 
@@ -842,6 +899,7 @@ InitializeMpSupport (
   Status = gBS->InstallMultipleProtocolInterfaces (
                   &mMpServiceHandle,
                   &gEfiMpServiceProtocolGuid,  &mMpServicesTemplate,
+                  &gEdkiiMpTaskPoolProtocolGuid, &mMpTaskPoolTemplate,
                   NULL
                   );
   ASSERT_EFI_ERROR (Status);
@@ -9,6 +9,7 @@
 #include "CpuMpPei.h"
 
 extern EDKII_PEI_MP_SERVICES2_PPI            mMpServices2Ppi;
+extern EDKII_PEI_MP_TASK_POOL_PPI            mMpTaskPoolPpi;
 
 //
 // CPU MP PPI to be installed
@@ -29,6 +30,11 @@ EFI_PEI_PPI_DESCRIPTOR           mPeiCpuMpPpiList[] = {
     &gEdkiiPeiMpServices2PpiGuid,
     &mMpServices2Ppi
   },
+  {
+    EFI_PEI_PPI_DESCRIPTOR_PPI,
+    &gEdkiiPeiMpTaskPoolPpiGuid,
+    &mMpTaskPoolPpi
+  },
   {
     (EFI_PEI_PPI_DESCRIPTOR_PPI | EFI_PEI_PPI_DESCRIPTOR_TERMINATE_LIST),
     &gEfiPeiMpServicesPpiGuid,
@@ -378,4 +378,51 @@ MpInitLibStartupAllCPUs (
   IN  VOID                      *ProcedureArgument      OPTIONAL
   );
 
+/**
+  This service submits a task to the task pool, to run on any enabled CPU.
+
+  The first task submitted wakes up the enabled APs, which then run the tasks
+  submitted, and steal them from each other, until the BSP joins the pool by
+  MpInitLibTaskPoolJoin().  The tasks may submit more tasks.  This service may
+  be called from the BSP, and from the tasks that run on the APs.
+
+  @param[in]  Procedure               A pointer to the function to be run as a task.
+                                      See type EFI_AP_PROCEDURE.
+  @param[in]  ProcedureArgument       The parameter passed into Procedure.
+
+  @retval EFI_SUCCESS             The task is submitted, or it was run by the
+                                  calling processor if its queue of tasks is full.
+  @retval EFI_DEVICE_ERROR        Caller processor is an AP that is not running a task.
+  @retval EFI_NOT_READY           Any enabled APs are busy.
+  @retval EFI_NOT_READY           MP Initialize Library is not initialized.
+  @retval EFI_OUT_OF_RESOURCES    There is not enough memory for the task pool.
+  @retval EFI_INVALID_PARAMETER   Procedure is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+MpInitLibTaskPoolSubmit (
+  IN  EFI_AP_PROCEDURE          Procedure,
+  IN  VOID                      *ProcedureArgument      OPTIONAL
+  );
+
+/**
+  This service joins the task pool: the BSP runs the submitted tasks until all
+  of them are finished, and then returns the APs to idle state.
+
+  This service may only be called from the BSP, and not from a task.
+
+  @retval EFI_SUCCESS             All the submitted tasks are finished, or no
+                                  task was submitted.
+  @retval EFI_DEVICE_ERROR        Caller processor is AP.
+  @retval EFI_NOT_READY           The BSP is already joining the task pool.
+  @retval EFI_NOT_READY           MP Initialize Library is not initialized.
+
+**/
+EFI_STATUS
+EFIAPI
+MpInitLibTaskPoolJoin (
+  VOID
+  );
+
 #endif
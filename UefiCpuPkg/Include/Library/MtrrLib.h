@@ -103,6 +103,32 @@ typedef struct {
   MTRR_MEMORY_CACHE_TYPE Type;
 } MTRR_MEMORY_RANGE;
 
+//
+// The maximum number of memory ranges staged in an MTRR transaction
+//
+#define  MTRR_TRANSACTION_RANGE_COUNT  (2 * MTRR_NUMBER_OF_VARIABLE_MTRR)
+
+//
+// Structure to stage the attributes of multiple memory ranges, so that the
+// MTRR settings are calculated once for all of them
+//
+typedef struct {
+  //
+  // MTRR setting buffer the ranges are set into, or NULL for the MTRRs of the processor.
+  //
+  MTRR_SETTINGS          *MtrrSetting;
+  UINTN                  RangeCount;
+  MTRR_MEMORY_RANGE      Ranges[MTRR_TRANSACTION_RANGE_COUNT];
+  //
+  // The last MTRR settings calculated, from SolvedFrom for SolvedRanges.
+  //
+  BOOLEAN                SolutionValid;
+  UINTN                  SolvedRangeCount;
+  MTRR_MEMORY_RANGE      SolvedRanges[MTRR_TRANSACTION_RANGE_COUNT];
+  MTRR_SETTINGS          SolvedFrom;
+  MTRR_SETTINGS          Solution;
+} MTRR_TRANSACTION;
+
 /**
   Returns the variable MTRR count for the CPU.
 
@@ -406,4 +432,87 @@ MtrrSetMemoryAttributesInMtrrSettings (
   IN     CONST MTRR_MEMORY_RANGE *Ranges,
   IN     UINTN                   RangeCount
   );
+
+/**
+  This function starts an MTRR transaction, which stages the attributes of
+  multiple memory ranges and sets them together when it is committed.
+
+  The transaction can be committed multiple times. It keeps the last MTRR
+  settings calculated, so that committing the same memory ranges again onto
+  the same MTRR settings does not calculate them again.
+
+  @param[out]  Transaction  The MTRR transaction to start.
+  @param[in]   MtrrSetting  MTRR setting buffer the memory ranges are set into.
+                            NULL to set them into the MTRRs of the processor.
+**/
+VOID
+EFIAPI
+MtrrTransactionBegin (
+  OUT MTRR_TRANSACTION        *Transaction,
+  IN  MTRR_SETTINGS           *MtrrSetting  OPTIONAL
+  );
+
+/**
+  This function stages the attributes of a memory range in an MTRR transaction.
+
+  When range overlap happens, the range staged last takes higher priority.
+
+  @param[in, out]  Transaction  The MTRR transaction.
+  @param[in]       BaseAddress  The physical address that is the start address
+                                of a memory range.
+  @param[in]       Length       The size in bytes of the memory range.
+  @param[in]       Attribute    The bit mask of attributes to set for the
+                                memory range.
+
+  @retval RETURN_SUCCESS            The memory range is staged.
+  @retval RETURN_INVALID_PARAMETER  Length is zero.
+  @retval RETURN_OUT_OF_RESOURCES   The transaction cannot stage more memory ranges.
+                                    The memory ranges staged should be committed first.
+**/
+RETURN_STATUS
+EFIAPI
+MtrrTransactionAddRange (
+  IN OUT MTRR_TRANSACTION        *Transaction,
+  IN     PHYSICAL_ADDRESS        BaseAddress,
+  IN     UINT64                  Length,
+  IN     MTRR_MEMORY_CACHE_TYPE  Attribute
+  );
+
+/**
+  This function sets the attributes of all the memory ranges staged in an MTRR
+  transaction, calculating the MTRR settings once for all of them.
+
+  The MTRRs of the processor, or the MTRR setting buffer, are only written when
+  the MTRR settings change.
+
+  @param[in, out]  Transaction  The MTRR transaction.
+  @param[in]       Scratch      A temporary scratch buffer that is used to perform the calculation.
+  @param[in, out]  ScratchSize  Pointer to the size in bytes of the scratch buffer.
+                                It may be updated to the actual required size when the calculation
+                                needs more scratch buffer.
+  @param[out]      Modified     Return TRUE if the MTRR settings changed, so that they
+                                need to be synchronized with the other processors.
+                                It is optional.
+
+  @retval RETURN_SUCCESS            The attributes were set for all the memory ranges staged.
+                                    The transaction is ready to stage new memory ranges.
+                                    On the other errors except RETURN_BUFFER_TOO_SMALL, none of
+                                    the attributes is set and the memory ranges staged are dropped.
+  @retval RETURN_INVALID_PARAMETER  The type of a memory range is invalid.
+  @retval RETURN_UNSUPPORTED        The processor does not support one or more bytes of a
+                                    memory range, or the processor does not support MTRRs.
+  @retval RETURN_OUT_OF_RESOURCES   There are not enough system resources to modify the attributes of
+                                    the memory ranges.
+  @retval RETURN_BUFFER_TOO_SMALL   The scratch buffer is too small for MTRR calculation.
+                                    The memory ranges stay staged, so that the transaction can be
+                                    committed again with a scratch buffer of the size returned.
+**/
+RETURN_STATUS
+EFIAPI
+MtrrTransactionCommit (
+  IN OUT MTRR_TRANSACTION        *Transaction,
+  IN     VOID                    *Scratch,
+  IN OUT UINTN                   *ScratchSize,
+  OUT    BOOLEAN                 *Modified  OPTIONAL
+  );
 #endif // _MTRR_LIB_H_
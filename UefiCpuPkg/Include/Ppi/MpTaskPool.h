@@ -0,0 +1,26 @@
+/** @file
+  This file declares EDKII PEI MP Task Pool PPI.
+
+  The PPI provides the services of EDKII MP Task Pool Protocol in PEI, to run
+  many small tasks on all the enabled processors with a single wakeup of the APs.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __PEI_MP_TASK_POOL_PPI_H__
+#define __PEI_MP_TASK_POOL_PPI_H__
+
+#include <Protocol/MpTaskPool.h>
+
+#define EDKII_PEI_MP_TASK_POOL_PPI_GUID \
+  { \
+    0x5a77a4ca, 0xff1b, 0x4860, { 0x9d, 0x9e, 0x1d, 0x50, 0x34, 0x82, 0xea, 0x19 } \
+  }
+
+typedef EDKII_MP_TASK_POOL_PROTOCOL  EDKII_PEI_MP_TASK_POOL_PPI;
+
+extern EFI_GUID gEdkiiPeiMpTaskPoolPpiGuid;
+
+#endif
@@ -0,0 +1,83 @@
+/** @file
+  This file declares EDKII MP Task Pool Protocol.
+
+  The task pool runs many small tasks on all the enabled processors with a
+  single wakeup of the APs: the first task submitted wakes up the APs, which
+  then run the tasks submitted, stealing them from each other, until the BSP
+  joins the pool.  Unlike StartupAllAPs() of the MP Services, which wakes up
+  the APs and waits for them for each procedure, the cost of a task is about
+  the cost of queuing it.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef __MP_TASK_POOL_PROTOCOL_H__
+#define __MP_TASK_POOL_PROTOCOL_H__
+
+#define EDKII_MP_TASK_POOL_PROTOCOL_GUID \
+  { \
+    0x8d43aca2, 0x22ba, 0x49e6, { 0x98, 0xa0, 0x87, 0x3d, 0x74, 0x2e, 0xaf, 0x2f } \
+  }
+
+typedef struct _EDKII_MP_TASK_POOL_PROTOCOL  EDKII_MP_TASK_POOL_PROTOCOL;
+
+/**
+  Submit a task to the task pool, to run on any enabled processor.
+
+  The first task submitted wakes up the enabled APs, and the MP Services cannot
+  dispatch procedures to them until the BSP joins the task pool.  A task may
+  submit more tasks, which run before the BSP returns from the join.  This
+  service may be called from the BSP, and from the tasks that run on the APs.
+
+  @param[in] This                 A pointer to the EDKII_MP_TASK_POOL_PROTOCOL instance.
+  @param[in] Procedure            A pointer to the function to be run as a task.
+  @param[in] ProcedureArgument    The parameter passed into Procedure.
+
+  @retval EFI_SUCCESS             The task is submitted, or it was run by the calling
+                                  processor because its queue of tasks is full.
+  @retval EFI_DEVICE_ERROR        Caller processor is an AP that is not running a task.
+  @retval EFI_NOT_READY           Any enabled APs are busy.
+  @retval EFI_OUT_OF_RESOURCES    There is not enough memory for the task pool.
+  @retval EFI_INVALID_PARAMETER   Procedure is NULL.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_MP_TASK_POOL_SUBMIT) (
+  IN EDKII_MP_TASK_POOL_PROTOCOL  *This,
+  IN EFI_AP_PROCEDURE             Procedure,
+  IN VOID                         *ProcedureArgument  OPTIONAL
+  );
+
+/**
+  Join the task pool: the BSP runs the submitted tasks until all of them are
+  finished, and then returns the APs to the MP Services.
+
+  This service may only be called from the BSP, and not from a task.
+
+  @param[in] This                 A pointer to the EDKII_MP_TASK_POOL_PROTOCOL instance.
+
+  @retval EFI_SUCCESS             All the submitted tasks are finished, or no task
+                                  was submitted.
+  @retval EFI_DEVICE_ERROR        Caller processor is AP.
+  @retval EFI_NOT_READY           The BSP is already joining the task pool.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_MP_TASK_POOL_JOIN) (
+  IN EDKII_MP_TASK_POOL_PROTOCOL  *This
+  );
+
+///
+/// This protocol runs tasks on all the enabled processors with a work-stealing
+/// task pool.
+///
+struct _EDKII_MP_TASK_POOL_PROTOCOL {
+  EDKII_MP_TASK_POOL_SUBMIT  Submit;
+  EDKII_MP_TASK_POOL_JOIN    Join;
+};
+
+extern EFI_GUID gEdkiiMpTaskPoolProtocolGuid;
+
+#endif
@@ -0,0 +1,58 @@
+/** @file
+  SMM CPU Rendezvous protocol definition.
+
+  In the relaxed SMM CPU synchronization methods, the BSP runs the SMI handlers
+  without waiting for all the APs to enter SMM.  The SMI handlers that need all
+  the processors in SMM, such as to run procedures on the APs, or to make sure no
+  processor runs code outside SMM while they run, declare it with this protocol.
+  In the on-demand AP synchronization method, scheduling a procedure on the APs
+  brings them into SMM as this protocol does.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _SMM_CPU_RENDEZVOUS_PROTOCOL_H_
+#define _SMM_CPU_RENDEZVOUS_PROTOCOL_H_
+
+#define EDKII_SMM_CPU_RENDEZVOUS_PROTOCOL_GUID \
+  { \
+    0x8a966c90, 0xf967, 0x4e97, { 0xbe, 0x0b, 0x55, 0xfe, 0x85, 0x9d, 0xc8, 0xc0 } \
+  }
+
+typedef struct _EDKII_SMM_CPU_RENDEZVOUS_PROTOCOL  EDKII_SMM_CPU_RENDEZVOUS_PROTOCOL;
+
+/**
+  Wait for all the processors to enter SMM, except the ones that are blocked
+  or whose SMIs are disabled, and keep them in SMM until the SMI handlers return.
+
+  This service may only be called from the BSP, by an SMI handler.
+
+  @param[in] This                 A pointer to the EDKII_SMM_CPU_RENDEZVOUS_PROTOCOL instance.
+  @param[in] BlockingMode         TRUE to wait until all the processors enter SMM.
+                                  FALSE to wait no longer than the SMM AP sync timeout.
+
+  @retval EFI_SUCCESS             All the processors, except the ones that are blocked
+                                  or whose SMIs are disabled, are in SMM.
+  @retval EFI_TIMEOUT             Some processors did not enter SMM before the timeout.
+  @retval EFI_DEVICE_ERROR        The calling processor is not the BSP in SMM.
+**/
+typedef
+EFI_STATUS
+(EFIAPI *EDKII_WAIT_FOR_ALL_PROCESSOR) (
+  IN CONST EDKII_SMM_CPU_RENDEZVOUS_PROTOCOL  *This,
+  IN       BOOLEAN                            BlockingMode
+  );
+
+///
+/// SMM CPU Rendezvous protocol, for the SMI handlers to bring all the processors
+/// in SMM when the relaxed SMM CPU synchronization methods are used.
+///
+struct _EDKII_SMM_CPU_RENDEZVOUS_PROTOCOL {
+  EDKII_WAIT_FOR_ALL_PROCESSOR  WaitForAllProcessor;
+};
+
+extern EFI_GUID gEdkiiSmmCpuRendezvousProtocolGuid;
+
+#endif
@@ -26,6 +26,51 @@ GetCurrentMicrocodeSignature (
   return BiosSignIdMsr.Bits.MicrocodeUpdateSignature;
 }
 
+/**
+  Find the latest microcode patch for the processor in the microcode patch index.
+
+  @param[in]  CpuMpData             The pointer to CPU MP Data structure.
+  @param[in]  ProcessorSignature    The processor signature of the processor.
+  @param[in]  PlatformId            The platform ID of the processor.
+
+  @return  The pointer to the header of the latest microcode patch for the
+           processor, or NULL if there is no microcode patch for the processor.
+**/
+CPU_MICROCODE_HEADER *
+FindMicrocodePatchInIndex (
+  IN CPU_MP_DATA                 *CpuMpData,
+  IN UINT32                      ProcessorSignature,
+  IN UINT8                       PlatformId
+  )
+{
+  MICROCODE_PATCH_INDEX_ENTRY    *Entries;
+  UINTN                          Index;
+  UINT32                         LatestRevision;
+  CPU_MICROCODE_HEADER           *MicrocodeEntryPoint;
+
+  Entries             = (MICROCODE_PATCH_INDEX_ENTRY *) (UINTN) CpuMpData->MicrocodePatchIndex;
+  LatestRevision      = 0;
+  MicrocodeEntryPoint = NULL;
+
+  //
+  // The entries are in the order of the microcode patches in the microcode
+  // patches data, so the first of the microcode patches with the same revision
+  // is found, as the scan in MicrocodeDetect() finds it.
+  //
+  for (Index = 0; Index < CpuMpData->MicrocodePatchIndexCount; Index++) {
+    if ((Entries[Index].ProcessorSignature == ProcessorSignature) &&
+        ((Entries[Index].ProcessorFlags & (1 << PlatformId)) != 0) &&
+        (Entries[Index].UpdateRevision > LatestRevision)) {
+      LatestRevision      = Entries[Index].UpdateRevision;
+      MicrocodeEntryPoint = (CPU_MICROCODE_HEADER *) (UINTN) (
+                              CpuMpData->MicrocodePatchAddress + Entries[Index].PatchOffset
+                              );
+    }
+  }
+
+  return MicrocodeEntryPoint;
+}
+
 /**
   Detect whether specified processor can find matching microcode patch and load it.
 
@@ -65,6 +110,9 @@ GetCurrentMicrocodeSignature (
          It does not guarantee that the data has not been modified.
          CPU has its own mechanism to verify Microcode Binary part.
 
+  If BSP has built the microcode patch index, the microcode patches have been
+  verified already, and the processor only looks up the index.
+
   @param[in]  CpuMpData        The pointer to CPU MP Data structure.
   @param[in]  ProcessorNumber  The handle number of the processor. The range is
                                from 0 to the total number of logical processors
@@ -150,6 +198,19 @@ MicrocodeDetect (
 
   LatestRevision = 0;
   MicrocodeData  = NULL;
+
+  if (CpuMpData->MicrocodePatchIndex != 0) {
+    //
+    // Look up the microcode patch verified by BSP in the microcode patch index.
+    //
+    MicrocodeEntryPoint = FindMicrocodePatchInIndex (CpuMpData, Eax.Uint32, PlatformId);
+    if (MicrocodeEntryPoint != NULL) {
+      MicrocodeData  = (VOID *) (MicrocodeEntryPoint + 1);
+      LatestRevision = MicrocodeEntryPoint->UpdateRevision;
+    }
+    goto Done;
+  }
+
   MicrocodeEnd = (UINTN) (CpuMpData->MicrocodePatchAddress + CpuMpData->MicrocodePatchRegionSize);
   MicrocodeEntryPoint = (CPU_MICROCODE_HEADER *) (UINTN) CpuMpData->MicrocodePatchAddress;
 
@@ -637,6 +698,267 @@ ShadowMicrocodeUpdatePatch (
   }
 }
 
+/**
+  Add an entry to the microcode patch index being built.
+
+  @param[in, out]  Entries              The pointer to the buffer of the entries.
+                                        It is reallocated if it is full, and
+                                        kept if it cannot be reallocated.
+  @param[in, out]  MaxEntryCount        The number of entries the buffer holds.
+  @param[in, out]  EntryCount           The number of entries in the buffer.
+  @param[in]       CpuMpData            The pointer to CPU MP Data structure.
+  @param[in]       MicrocodeEntryPoint  The pointer to the microcode patch header.
+  @param[in]       ProcessorSignature   The processor signature supported by
+                                        the microcode patch.
+  @param[in]       ProcessorFlags       The processor flags supported by the
+                                        microcode patch.
+
+  @retval TRUE     The entry is added.
+  @retval FALSE    There is not enough memory to add the entry.
+**/
+BOOLEAN
+AddMicrocodePatchIndexEntry (
+  IN OUT MICROCODE_PATCH_INDEX_ENTRY **Entries,
+  IN OUT UINTN                       *MaxEntryCount,
+  IN OUT UINTN                       *EntryCount,
+  IN     CPU_MP_DATA                 *CpuMpData,
+  IN     CPU_MICROCODE_HEADER        *MicrocodeEntryPoint,
+  IN     UINT32                      ProcessorSignature,
+  IN     UINT32                      ProcessorFlags
+  )
+{
+  MICROCODE_PATCH_INDEX_ENTRY    *Entry;
+  MICROCODE_PATCH_INDEX_ENTRY    *NewEntries;
+
+  if (*EntryCount == *MaxEntryCount) {
+    //
+    // Current buffer cannot hold the entry, double the size and allocate a
+    // new buffer.
+    //
+    if (*MaxEntryCount > MAX_UINTN / 2 / sizeof (MICROCODE_PATCH_INDEX_ENTRY)) {
+      return FALSE;
+    }
+
+    NewEntries = ReallocatePool (
+                   *MaxEntryCount * sizeof (MICROCODE_PATCH_INDEX_ENTRY),
+                   2 * *MaxEntryCount * sizeof (MICROCODE_PATCH_INDEX_ENTRY),
+                   *Entries
+                   );
+    if (NewEntries == NULL) {
+      //
+      // The buffer is not freed when it cannot be reallocated. Keep it, so
+      // that the caller frees it.
+      //
+      return FALSE;
+    }
+    *Entries       = NewEntries;
+    *MaxEntryCount = *MaxEntryCount * 2;
+  }
+
+  Entry = &(*Entries)[*EntryCount];
+  Entry->ProcessorSignature = ProcessorSignature;
+  Entry->ProcessorFlags     = ProcessorFlags;
+  Entry->UpdateRevision     = MicrocodeEntryPoint->UpdateRevision;
+  Entry->PatchOffset        = (UINT32) ((UINTN) MicrocodeEntryPoint - (UINTN) CpuMpData->MicrocodePatchAddress);
+  *EntryCount = *EntryCount + 1;
+
+  return TRUE;
+}
+
+/**
+  Build the microcode patch index of the microcode patches data, so the
+  processors look up the microcode patch to load instead of scanning and
+  verifying the microcode patches data each.
+
+  The microcode patches are verified the way MicrocodeDetect() verifies them.
+  Each processor signature and processor flags pair with a correct CheckSum32,
+  in the microcode patch header or in the extended signature table, gets an
+  entry in the index.
+
+  The index is allocated in pages so it stays at the same address when it is
+  passed from PEI to DXE with CPU MP Data structure.
+
+  @param[in, out]  CpuMpData    The pointer to CPU MP Data structure.
+**/
+VOID
+BuildMicrocodePatchIndex (
+  IN OUT CPU_MP_DATA             *CpuMpData
+  )
+{
+  UINT32                                  ExtendedTableLength;
+  UINT32                                  ExtendedTableCount;
+  CPU_MICROCODE_EXTENDED_TABLE            *ExtendedTable;
+  CPU_MICROCODE_EXTENDED_TABLE_HEADER     *ExtendedTableHeader;
+  CPU_MICROCODE_HEADER                    *MicrocodeEntryPoint;
+  UINTN                                   MicrocodeEnd;
+  UINTN                                   Index;
+  UINTN                                   TotalSize;
+  UINT32                                  CheckSum32;
+  UINT32                                  InCompleteCheckSum32;
+  MICROCODE_PATCH_INDEX_ENTRY             *Entries;
+  UINTN                                   MaxEntryCount;
+  UINTN                                   EntryCount;
+  VOID                                    *MicrocodePatchIndex;
+
+  CpuMpData->MicrocodePatchIndex      = 0;
+  CpuMpData->MicrocodePatchIndexCount = 0;
+
+  if ((CpuMpData->MicrocodePatchRegionSize == 0) ||
+      (CpuMpData->MicrocodePatchRegionSize > MAX_UINT32)) {
+    //
+    // There is no microcode patches, or the offsets of the microcode patches
+    // do not fit in the index. The processors will scan the microcode patches.
+    //
+    return;
+  }
+
+  EntryCount    = 0;
+  MaxEntryCount = DEFAULT_MAX_MICROCODE_PATCH_NUM;
+  Entries       = AllocatePool (MaxEntryCount * sizeof (MICROCODE_PATCH_INDEX_ENTRY));
+  if (Entries == NULL) {
+    return;
+  }
+
+  MicrocodeEnd = (UINTN) (CpuMpData->MicrocodePatchAddress + CpuMpData->MicrocodePatchRegionSize);
+  MicrocodeEntryPoint = (CPU_MICROCODE_HEADER *) (UINTN) CpuMpData->MicrocodePatchAddress;
+
+  do {
+    if (MicrocodeEntryPoint->DataSize == 0) {
+      TotalSize = sizeof (CPU_MICROCODE_HEADER) + 2000;
+    } else {
+      TotalSize = sizeof (CPU_MICROCODE_HEADER) + MicrocodeEntryPoint->DataSize;
+    }
+
+    if ( (UINTN)MicrocodeEntryPoint > (MAX_ADDRESS - TotalSize) ||
+         ((UINTN)MicrocodeEntryPoint + TotalSize) > MicrocodeEnd ||
+         (TotalSize & 0x3) != 0 ||
+         MicrocodeEntryPoint->HeaderVersion != 0x1
+       ) {
+      //
+      // Not a valid microcode header, or the padding data between the
+      // microcode patches, skip 1KB to check next entry.
+      //
+      MicrocodeEntryPoint = (CPU_MICROCODE_HEADER *) (((UINTN) MicrocodeEntryPoint) + SIZE_1KB);
+      continue;
+    }
+
+    //
+    // Save an in-complete CheckSum32 from CheckSum Part1 for common parts.
+    //
+    InCompleteCheckSum32 = CalculateSum32 (
+                             (UINT32 *) MicrocodeEntryPoint,
+                             TotalSize
+                             );
+    InCompleteCheckSum32 -= MicrocodeEntryPoint->ProcessorSignature.Uint32;
+    InCompleteCheckSum32 -= MicrocodeEntryPoint->ProcessorFlags;
+    InCompleteCheckSum32 -= MicrocodeEntryPoint->Checksum;
+
+    //
+    // Calculate CheckSum Part1.
+    //
+    CheckSum32 = InCompleteCheckSum32;
+    CheckSum32 += MicrocodeEntryPoint->ProcessorSignature.Uint32;
+    CheckSum32 += MicrocodeEntryPoint->ProcessorFlags;
+    CheckSum32 += MicrocodeEntryPoint->Checksum;
+    if (CheckSum32 == 0) {
+      if (!AddMicrocodePatchIndexEntry (
+             &Entries,
+             &MaxEntryCount,
+             &EntryCount,
+             CpuMpData,
+             MicrocodeEntryPoint,
+             MicrocodeEntryPoint->ProcessorSignature.Uint32,
+             MicrocodeEntryPoint->ProcessorFlags
+             )) {
+        goto OnExit;
+      }
+    }
+
+    if ((MicrocodeEntryPoint->DataSize != 0) &&
+        (MicrocodeEntryPoint->TotalSize > TotalSize + sizeof (CPU_MICROCODE_EXTENDED_TABLE_HEADER)) &&
+        (MicrocodeEntryPoint->TotalSize <= MicrocodeEnd - (UINTN) MicrocodeEntryPoint)) {
+      //
+      // Extended Table exist, verify the extended signatures.
+      //
+      ExtendedTableLength = MicrocodeEntryPoint->TotalSize - (UINT32) TotalSize;
+      ExtendedTableHeader = (CPU_MICROCODE_EXTENDED_TABLE_HEADER *) ((UINT8 *) MicrocodeEntryPoint + TotalSize);
+      if ((ExtendedTableLength % 4) == 0) {
+        //
+        // Calculate CheckSum Part2.
+        //
+        CheckSum32 = CalculateSum32 ((UINT32 *) ExtendedTableHeader, ExtendedTableLength);
+        ExtendedTableCount = ExtendedTableHeader->ExtendedSignatureCount;
+        if ((CheckSum32 == 0) &&
+            (ExtendedTableCount <= (ExtendedTableLength - sizeof (CPU_MICROCODE_EXTENDED_TABLE_HEADER)) /
+                                     sizeof (CPU_MICROCODE_EXTENDED_TABLE))) {
+          ExtendedTable = (CPU_MICROCODE_EXTENDED_TABLE *) (ExtendedTableHeader + 1);
+          for (Index = 0; Index < ExtendedTableCount; Index++, ExtendedTable++) {
+            //
+            // Calculate CheckSum Part3.
+            //
+            CheckSum32 = InCompleteCheckSum32;
+            CheckSum32 += ExtendedTable->ProcessorSignature.Uint32;
+            CheckSum32 += ExtendedTable->ProcessorFlag;
+            CheckSum32 += ExtendedTable->Checksum;
+            if (CheckSum32 != 0) {
+              continue;
+            }
+            if (!AddMicrocodePatchIndexEntry (
+                   &Entries,
+                   &MaxEntryCount,
+                   &EntryCount,
+                   CpuMpData,
+                   MicrocodeEntryPoint,
+                   ExtendedTable->ProcessorSignature.Uint32,
+                   ExtendedTable->ProcessorFlag
+                   )) {
+              goto OnExit;
+            }
+          }
+        }
+      }
+    }
+
+    //
+    // Get the next patch.
+    //
+    if (MicrocodeEntryPoint->DataSize == 0) {
+      TotalSize = 2048;
+    } else if (MicrocodeEntryPoint->TotalSize >= TotalSize) {
+      TotalSize = MicrocodeEntryPoint->TotalSize;
+    }
+
+    MicrocodeEntryPoint = (CPU_MICROCODE_HEADER *) (((UINTN) MicrocodeEntryPoint) + TotalSize);
+  } while (((UINTN) MicrocodeEntryPoint < MicrocodeEnd));
+
+  //
+  // The index is built even if it is empty, so the processors do not scan the
+  // microcode patches that do not verify.
+  //
+  MicrocodePatchIndex = AllocatePages (
+                          EFI_SIZE_TO_PAGES (MAX (EntryCount, 1) * sizeof (MICROCODE_PATCH_INDEX_ENTRY))
+                          );
+  if (MicrocodePatchIndex == NULL) {
+    goto OnExit;
+  }
+  CopyMem (MicrocodePatchIndex, Entries, EntryCount * sizeof (MICROCODE_PATCH_INDEX_ENTRY));
+
+  CpuMpData->MicrocodePatchIndex      = (UINTN) MicrocodePatchIndex;
+  CpuMpData->MicrocodePatchIndexCount = (UINT32) EntryCount;
+
+  DEBUG ((
+    DEBUG_INFO,
+    "%a: 0x%x microcode patch index entries are built.\n",
+    __FUNCTION__, EntryCount
+    ));
+
+OnExit:
+  if (Entries != NULL) {
+    FreePool (Entries);
+  }
+  return;
+}
+
 /**
   Get the cached microcode patch base address and size from the microcode patch
   information cache HOB.
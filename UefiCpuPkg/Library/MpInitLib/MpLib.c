@@ -1793,6 +1793,16 @@ MpInitLibInitialize (
     // the microcode patches data has not been loaded into memory yet
     //
     ShadowMicrocodeUpdatePatch (CpuMpData);
+    BuildMicrocodePatchIndex (CpuMpData);
+  } else if ((OldCpuMpData != NULL) && (OldCpuMpData->MicrocodePatchIndex != 0)) {
+    //
+    // The microcode patch index built in PEI for the cached microcode patches
+    // data is still valid, no need to verify the microcode patches again
+    //
+    CpuMpData->MicrocodePatchIndex      = OldCpuMpData->MicrocodePatchIndex;
+    CpuMpData->MicrocodePatchIndexCount = OldCpuMpData->MicrocodePatchIndexCount;
+  } else {
+    BuildMicrocodePatchIndex (CpuMpData);
   }
 
   //
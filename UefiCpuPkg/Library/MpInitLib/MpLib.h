@@ -61,6 +61,79 @@ typedef struct {
   UINTN    Size;
 } MICROCODE_PATCH_INFO;
 
+//
+// Data structure for an entry of the microcode patch index. There is one entry
+// for each processor signature and processor flags pair that a validated
+// microcode patch supports, in its header or in its extended signature table.
+// The index is passed from PEI to DXE, so please make sure the fields offset
+// same in the different architecture.
+//
+typedef struct {
+  UINT32   ProcessorSignature;
+  UINT32   ProcessorFlags;
+  UINT32   UpdateRevision;
+  //
+  // The offset of the microcode patch header with regard to the base address
+  // of the microcode patches data.
+  //
+  UINT32   PatchOffset;
+} MICROCODE_PATCH_INDEX_ENTRY;
+
+//
+// Number of tasks each processor queues in the task pool, a power of two
+//
+#define MP_TASK_DEQUE_SIZE  64
+
+//
+// Task submitted to the task pool
+//
+typedef struct {
+  EFI_AP_PROCEDURE  Procedure;
+  VOID              *Argument;
+} MP_TASK;
+
+//
+// Tasks queued by one processor in the task pool.
+// The processor pushes and pops tasks at Bottom, the other processors
+// steal the oldest tasks at Top.  The deque starts a cache line, and its
+// MP_TASK_DEQUE_SIZE tasks start the next one.
+//
+typedef struct {
+  SPIN_LOCK         Lock;
+  volatile UINT32   Top;
+  volatile UINT32   Bottom;
+  MP_TASK           *Task;
+} MP_TASK_DEQUE;
+
+//
+// Task pool, the APs run the submitted tasks from the first submission
+// until the BSP joins the pool
+//
+typedef struct {
+  //
+  // Number of tasks submitted and not finished yet
+  //
+  volatile UINT32   PendingCount;
+  //
+  // TRUE when the APs should leave the task pool
+  //
+  volatile BOOLEAN  Stop;
+  //
+  // TRUE when the APs are in the task pool
+  //
+  BOOLEAN           Running;
+  //
+  // TRUE when the BSP is joining the task pool
+  //
+  BOOLEAN           Joining;
+  //
+  // Deques of the processors, DequeSize bytes apart, a multiple of the
+  // cache line size
+  //
+  UINT8             *Deques;
+  UINTN             DequeSize;
+} MP_TASK_POOL;
+
 //
 // CPU exchange information for switch BSP
 //
@@ -222,6 +295,13 @@ struct _CPU_MP_DATA {
   UINT32                         CpuCount;
   UINT32                         BspNumber;
   //
+  // The address and the number of entries of the microcode patch index,
+  // built by BSP once and looked up by each processor.
+  //
+  UINT64                         MicrocodePatchIndex;
+  UINT32                         MicrocodePatchIndexCount;
+  UINT32                         Reserved;
+  //
   // The above fields data will be passed from PEI to DXE
   // Please make sure the fields offset same in the different
   // architecture.
@@ -275,6 +355,11 @@ struct _CPU_MP_DATA {
   // driver.
   //
   BOOLEAN                        WakeUpByInitSipiSipi;
+
+  //
+  // Task pool, allocated when the first task is submitted
+  //
+  MP_TASK_POOL                   *TaskPool;
 };
 
 extern EFI_GUID mCpuInitMpLibHobGuid;
@@ -601,6 +686,35 @@ ShadowMicrocodeUpdatePatch (
   IN OUT CPU_MP_DATA             *CpuMpData
   );
 
+/**
+  Build the microcode patch index of the microcode patches data, so the
+  processors look up the microcode patch to load instead of scanning and
+  verifying the microcode patches data each.
+
+  @param[in, out]  CpuMpData    The pointer to CPU MP Data structure.
+**/
+VOID
+BuildMicrocodePatchIndex (
+  IN OUT CPU_MP_DATA             *CpuMpData
+  );
+
+/**
+  Find the latest microcode patch for the processor in the microcode patch index.
+
+  @param[in]  CpuMpData             The pointer to CPU MP Data structure.
+  @param[in]  ProcessorSignature    The processor signature of the processor.
+  @param[in]  PlatformId            The platform ID of the processor.
+
+  @return  The pointer to the header of the latest microcode patch for the
+           processor, or NULL if there is no microcode patch for the processor.
+**/
+CPU_MICROCODE_HEADER *
+FindMicrocodePatchInIndex (
+  IN CPU_MP_DATA                 *CpuMpData,
+  IN UINT32                      ProcessorSignature,
+  IN UINT8                       PlatformId
+  );
+
 /**
   Get the cached microcode patch base address and size from the microcode patch
   information cache HOB.
@@ -673,5 +787,68 @@ PlatformShadowMicrocode (
   IN OUT CPU_MP_DATA             *CpuMpData
   );
 
+/**
+  Get the Application Processors state.
+
+  @param[in]  CpuData    The pointer to CPU_AP_DATA of specified AP
+
+  @return  The AP status
+**/
+CPU_STATE
+GetApState (
+  IN  CPU_AP_DATA     *CpuData
+  );
+
+/**
+  Calculate timeout value and return the current performance counter value.
+
+  Calculate the number of performance counter ticks required for a timeout.
+  If TimeoutInMicroseconds is 0, return value is also 0, which is recognized
+  as infinity.
+
+  @param[in]  TimeoutInMicroseconds   Timeout value in microseconds.
+  @param[out] CurrentTime             Returns the current value of the performance counter.
+
+  @return Expected time stamp counter for timeout.
+          If TimeoutInMicroseconds is 0, return value is also 0, which is recognized
+          as infinity.
+
+**/
+UINT64
+CalculateTimeout (
+  IN  UINTN   TimeoutInMicroseconds,
+  OUT UINT64  *CurrentTime
+  );
+
+/**
+  Get the tasks queued by one processor in the task pool.
+
+  @param[in]  TaskPool          The task pool.
+  @param[in]  ProcessorNumber   The handle number of the processor.
+
+  @return The tasks queued by the processor.
+**/
+MP_TASK_DEQUE *
+GetTaskDeque (
+  IN MP_TASK_POOL              *TaskPool,
+  IN UINTN                     ProcessorNumber
+  );
+
+/**
+  Run one task of the task pool, taken from the tasks queued by the processor,
+  or else stolen from the tasks queued by the other processors.
+
+  @param[in] CpuMpData          Pointer to CPU MP Data.
+  @param[in] ProcessorNumber    The handle number of the processor.
+
+  @retval TRUE                  A task is run.
+  @retval FALSE                 No task is queued.
+**/
+BOOLEAN
+RunNextTask (
+  IN CPU_MP_DATA               *CpuMpData,
+  IN UINTN                     ProcessorNumber
+  );
+
 #endif
 
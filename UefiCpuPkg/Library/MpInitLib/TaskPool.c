@@ -0,0 +1,382 @@
+/** @file
+  Task pool of the MP initialization library: the enabled processors run the
+  tasks submitted, and steal them from each other, until the BSP joins the
+  pool.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MpLib.h"
+
+/**
+  Get the tasks queued by one processor in the task pool.
+
+  @param[in]  TaskPool          The task pool.
+  @param[in]  ProcessorNumber   The handle number of the processor.
+
+  @return The tasks queued by the processor.
+**/
+MP_TASK_DEQUE *
+GetTaskDeque (
+  IN MP_TASK_POOL              *TaskPool,
+  IN UINTN                     ProcessorNumber
+  )
+{
+  return (MP_TASK_DEQUE *) (TaskPool->Deques + TaskPool->DequeSize * ProcessorNumber);
+}
+
+/**
+  Take a task from the tasks queued by one processor in the task pool.
+
+  @param[in]  Deque             The tasks queued by the processor.
+  @param[in]  Steal             TRUE to take the oldest task, for another processor.
+                                FALSE to take the newest task, for the processor.
+  @param[out] Task              Returns the task taken.
+
+  @retval TRUE                  A task is taken.
+  @retval FALSE                 The processor has no task queued.
+**/
+BOOLEAN
+TakeTask (
+  IN  MP_TASK_DEQUE            *Deque,
+  IN  BOOLEAN                  Steal,
+  OUT MP_TASK                  *Task
+  )
+{
+  BOOLEAN                 Taken;
+
+  //
+  // Do not contend for the lock of a processor without tasks.
+  //
+  if (Deque->Top == Deque->Bottom) {
+    return FALSE;
+  }
+
+  Taken = FALSE;
+  AcquireSpinLock (&Deque->Lock);
+  if (Deque->Top != Deque->Bottom) {
+    if (Steal) {
+      CopyMem (Task, &Deque->Task[Deque->Top & (MP_TASK_DEQUE_SIZE - 1)], sizeof (MP_TASK));
+      Deque->Top++;
+    } else {
+      Deque->Bottom--;
+      CopyMem (Task, &Deque->Task[Deque->Bottom & (MP_TASK_DEQUE_SIZE - 1)], sizeof (MP_TASK));
+    }
+    Taken = TRUE;
+  }
+  ReleaseSpinLock (&Deque->Lock);
+
+  return Taken;
+}
+
+/**
+  Run one task of the task pool, taken from the tasks queued by the processor,
+  or else stolen from the tasks queued by the other processors.
+
+  @param[in] CpuMpData          Pointer to CPU MP Data.
+  @param[in] ProcessorNumber    The handle number of the processor.
+
+  @retval TRUE                  A task is run.
+  @retval FALSE                 No task is queued.
+**/
+BOOLEAN
+RunNextTask (
+  IN CPU_MP_DATA               *CpuMpData,
+  IN UINTN                     ProcessorNumber
+  )
+{
+  MP_TASK_POOL            *TaskPool;
+  MP_TASK                 Task;
+  UINTN                   Index;
+  UINTN                   Victim;
+  BOOLEAN                 Taken;
+
+  TaskPool = CpuMpData->TaskPool;
+  Taken    = TakeTask (GetTaskDeque (TaskPool, ProcessorNumber), FALSE, &Task);
+  for (Index = 1; !Taken && Index < CpuMpData->CpuCount; Index++) {
+    Victim = (ProcessorNumber + Index) % CpuMpData->CpuCount;
+    Taken  = TakeTask (GetTaskDeque (TaskPool, Victim), TRUE, &Task);
+  }
+  if (!Taken) {
+    return FALSE;
+  }
+
+  Task.Procedure (Task.Argument);
+  InterlockedDecrement (&TaskPool->PendingCount);
+  return TRUE;
+}
+
+/**
+  AP procedure of the task pool.
+
+  The AP runs the tasks of the task pool until the BSP joins it.
+
+  @param[in] Buffer             Pointer to CPU MP Data.
+**/
+VOID
+EFIAPI
+TaskPoolWorker (
+  IN VOID                      *Buffer
+  )
+{
+  CPU_MP_DATA             *CpuMpData;
+  UINTN                   ProcessorNumber;
+
+  CpuMpData = (CPU_MP_DATA *) Buffer;
+  GetProcessorNumber (CpuMpData, &ProcessorNumber);
+
+  while (!CpuMpData->TaskPool->Stop) {
+    if (!RunNextTask (CpuMpData, ProcessorNumber)) {
+      CpuPause ();
+    }
+  }
+}
+
+/**
+  Start the task pool: wake up the enabled APs once, to run the tasks
+  submitted until the BSP joins the pool.
+
+  @param[in] CpuMpData          Pointer to CPU MP Data.
+
+  @retval EFI_SUCCESS           The task pool is started.
+  @retval EFI_NOT_READY         Any enabled APs are busy.
+  @retval EFI_OUT_OF_RESOURCES  There is not enough memory for the task pool.
+**/
+EFI_STATUS
+StartTaskPool (
+  IN CPU_MP_DATA               *CpuMpData
+  )
+{
+  MP_TASK_POOL            *TaskPool;
+  MP_TASK_DEQUE           *Deque;
+  UINTN                   ProcessorNumber;
+  CPU_AP_DATA             *CpuData;
+  CPU_STATE               ApState;
+  UINTN                   LineSize;
+  UINTN                   DequeOffset;
+  UINTN                   TaskOffset;
+  UINTN                   DequeSize;
+
+  CheckAndUpdateApsStatus ();
+
+  //
+  // The APs run the tasks until the BSP joins the pool, so all enabled APs
+  // have to be idle, the way StartupAllAPs() expects them.
+  //
+  for (ProcessorNumber = 0; ProcessorNumber < CpuMpData->CpuCount; ProcessorNumber++) {
+    if (ProcessorNumber != CpuMpData->BspNumber) {
+      ApState = GetApState (&CpuMpData->CpuData[ProcessorNumber]);
+      if (ApState != CpuStateDisabled && ApState != CpuStateIdle) {
+        return EFI_NOT_READY;
+      }
+    }
+  }
+
+  TaskPool = CpuMpData->TaskPool;
+  if (TaskPool == NULL) {
+    //
+    // Each processor polls the Top and Bottom of the deques of the others for
+    // tasks to steal, so keep them on a cache line of their own, apart from
+    // the tasks and from the deques of the other processors.
+    //
+    LineSize    = GetSpinLockProperties ();
+    DequeOffset = ALIGN_VALUE (sizeof (MP_TASK_POOL), LineSize);
+    TaskOffset  = ALIGN_VALUE (sizeof (MP_TASK_DEQUE), LineSize);
+    DequeSize   = TaskOffset + ALIGN_VALUE (sizeof (MP_TASK) * MP_TASK_DEQUE_SIZE, LineSize);
+    TaskPool = AllocatePages (
+                 EFI_SIZE_TO_PAGES (DequeOffset + DequeSize * CpuMpData->CpuCount)
+                 );
+    if (TaskPool == NULL) {
+      return EFI_OUT_OF_RESOURCES;
+    }
+    TaskPool->Deques    = (UINT8 *) TaskPool + DequeOffset;
+    TaskPool->DequeSize = DequeSize;
+    for (ProcessorNumber = 0; ProcessorNumber < CpuMpData->CpuCount; ProcessorNumber++) {
+      Deque = GetTaskDeque (TaskPool, ProcessorNumber);
+      InitializeSpinLock (&Deque->Lock);
+      Deque->Top    = 0;
+      Deque->Bottom = 0;
+      Deque->Task   = (MP_TASK *) ((UINT8 *) Deque + TaskOffset);
+    }
+    CpuMpData->TaskPool = TaskPool;
+  }
+
+  TaskPool->PendingCount = 0;
+  TaskPool->Stop         = FALSE;
+  TaskPool->Joining      = FALSE;
+  TaskPool->Running      = TRUE;
+
+  CpuMpData->RunningCount = 0;
+  for (ProcessorNumber = 0; ProcessorNumber < CpuMpData->CpuCount; ProcessorNumber++) {
+    CpuData = &CpuMpData->CpuData[ProcessorNumber];
+    CpuData->Waiting = FALSE;
+    if (ProcessorNumber != CpuMpData->BspNumber && CpuData->State == CpuStateIdle) {
+      CpuData->Waiting = TRUE;
+      CpuMpData->RunningCount++;
+    }
+  }
+
+  if (CpuMpData->RunningCount == 0) {
+    //
+    // The BSP runs all the tasks when it joins the pool.
+    //
+    return EFI_SUCCESS;
+  }
+
+  CpuMpData->Procedure     = TaskPoolWorker;
+  CpuMpData->ProcArguments = CpuMpData;
+  CpuMpData->SingleThread  = FALSE;
+  CpuMpData->FinishedCount = 0;
+  CpuMpData->FailedCpuList = NULL;
+  CpuMpData->ExpectedTime  = CalculateTimeout (0, &CpuMpData->CurrentTime);
+  CpuMpData->TotalTime     = 0;
+  CpuMpData->WaitEvent     = NULL;
+
+  WakeUpAP (CpuMpData, TRUE, 0, TaskPoolWorker, CpuMpData, FALSE);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  This service submits a task to the task pool, to run on any enabled CPU.
+
+  The first task submitted wakes up the enabled APs, which then run the tasks
+  submitted, and steal them from each other, until the BSP joins the pool by
+  MpInitLibTaskPoolJoin().  The tasks may submit more tasks.  This service may
+  be called from the BSP, and from the tasks that run on the APs.
+
+  @param[in]  Procedure               A pointer to the function to be run as a task.
+                                      See type EFI_AP_PROCEDURE.
+  @param[in]  ProcedureArgument       The parameter passed into Procedure.
+
+  @retval EFI_SUCCESS             The task is submitted, or it was run by the
+                                  calling processor if its queue of tasks is full.
+  @retval EFI_DEVICE_ERROR        Caller processor is an AP that is not running a task.
+  @retval EFI_NOT_READY           Any enabled APs are busy.
+  @retval EFI_NOT_READY           MP Initialize Library is not initialized.
+  @retval EFI_OUT_OF_RESOURCES    There is not enough memory for the task pool.
+  @retval EFI_INVALID_PARAMETER   Procedure is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+MpInitLibTaskPoolSubmit (
+  IN  EFI_AP_PROCEDURE          Procedure,
+  IN  VOID                      *ProcedureArgument      OPTIONAL
+  )
+{
+  EFI_STATUS              Status;
+  CPU_MP_DATA             *CpuMpData;
+  MP_TASK_POOL            *TaskPool;
+  MP_TASK_DEQUE           *Deque;
+  UINTN                   ProcessorNumber;
+  BOOLEAN                 Queued;
+
+  if (Procedure == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  CpuMpData = GetCpuMpData ();
+  Status    = GetProcessorNumber (CpuMpData, &ProcessorNumber);
+  if (EFI_ERROR (Status)) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  if (CpuMpData->TaskPool == NULL || !CpuMpData->TaskPool->Running) {
+    if (ProcessorNumber != CpuMpData->BspNumber) {
+      return EFI_DEVICE_ERROR;
+    }
+    Status = StartTaskPool (CpuMpData);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  TaskPool = CpuMpData->TaskPool;
+  Deque    = GetTaskDeque (TaskPool, ProcessorNumber);
+  InterlockedIncrement (&TaskPool->PendingCount);
+
+  Queued = FALSE;
+  AcquireSpinLock (&Deque->Lock);
+  if (Deque->Bottom - Deque->Top < MP_TASK_DEQUE_SIZE) {
+    Deque->Task[Deque->Bottom & (MP_TASK_DEQUE_SIZE - 1)].Procedure = Procedure;
+    Deque->Task[Deque->Bottom & (MP_TASK_DEQUE_SIZE - 1)].Argument  = ProcedureArgument;
+    Deque->Bottom++;
+    Queued = TRUE;
+  }
+  ReleaseSpinLock (&Deque->Lock);
+
+  if (!Queued) {
+    //
+    // The queue is full, so the other processors have enough tasks to steal.
+    //
+    Procedure (ProcedureArgument);
+    InterlockedDecrement (&TaskPool->PendingCount);
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+  This service joins the task pool: the BSP runs the submitted tasks until all
+  of them are finished, and then returns the APs to idle state.
+
+  This service may only be called from the BSP, and not from a task.
+
+  @retval EFI_SUCCESS             All the submitted tasks are finished, or no
+                                  task was submitted.
+  @retval EFI_DEVICE_ERROR        Caller processor is AP.
+  @retval EFI_NOT_READY           The BSP is already joining the task pool.
+  @retval EFI_NOT_READY           MP Initialize Library is not initialized.
+
+**/
+EFI_STATUS
+EFIAPI
+MpInitLibTaskPoolJoin (
+  VOID
+  )
+{
+  EFI_STATUS              Status;
+  CPU_MP_DATA             *CpuMpData;
+  MP_TASK_POOL            *TaskPool;
+  UINTN                   CallerNumber;
+
+  CpuMpData = GetCpuMpData ();
+
+  //
+  // Check whether caller processor is BSP
+  //
+  MpInitLibWhoAmI (&CallerNumber);
+  if (CallerNumber != CpuMpData->BspNumber) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  TaskPool = CpuMpData->TaskPool;
+  if (TaskPool == NULL || !TaskPool->Running) {
+    return EFI_SUCCESS;
+  }
+  if (TaskPool->Joining) {
+    return EFI_NOT_READY;
+  }
+
+  TaskPool->Joining = TRUE;
+  while (TaskPool->PendingCount != 0) {
+    if (!RunNextTask (CpuMpData, CallerNumber)) {
+      CpuPause ();
+    }
+  }
+
+  //
+  // Let the APs leave the task pool, and wait for them as StartupAllAPs() does.
+  //
+  TaskPool->Stop = TRUE;
+  do {
+    Status = CheckAllAPs ();
+  } while (Status == EFI_NOT_READY);
+
+  TaskPool->Running = FALSE;
+  TaskPool->Joining = FALSE;
+  return Status;
+}
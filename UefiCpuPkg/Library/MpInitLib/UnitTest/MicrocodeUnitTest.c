@@ -0,0 +1,460 @@
+/** @file
+  Host based unit tests of the microcode patch index of the MP initialization
+  library.
+
+  The tests build microcode patches data with patches in the header format and
+  with extended signature tables, a patch that fails the CheckSum32, and
+  padding between the patches.  For processors of each signature and platform
+  ID, they check that the microcode patch found in the index built by BSP is
+  the one that the scan of the microcode patches data in MicrocodeDetect()
+  loads.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "MpLib.h"
+
+#define UNIT_TEST_APP_NAME        "Microcode Patch Index Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Size of the microcode patches data of the tests
+//
+#define MICROCODE_TEST_REGION_SIZE    SIZE_16KB
+
+//
+// Number of platform IDs of a processor signature
+//
+#define MICROCODE_TEST_PLATFORM_COUNT 8
+
+//
+// Processor signature and platform ID of the test processor, revision of the
+// microcode loaded, and number of microcode loads
+//
+extern UINT32  mStubProcessorSignature;
+extern UINT8   mStubPlatformId;
+extern UINT32  mStubMicrocodeRevision;
+extern UINTN   mStubMicrocodeLoadCount;
+
+//
+// A processor signature and processor flags pair of an extended signature table
+//
+typedef struct {
+  UINT32                        ProcessorSignature;
+  UINT32                        ProcessorFlag;
+} MICROCODE_TEST_SIGNATURE;
+
+//
+// A microcode patch of the microcode patches data of the tests
+//
+typedef struct {
+  UINT32                        ProcessorSignature;
+  UINT32                        ProcessorFlags;
+  UINT32                        UpdateRevision;
+  //
+  // Total size of the patch, 0 for a patch in the 2KB fixed format
+  //
+  UINT32                        TotalSize;
+  UINT32                        ExtendedSignatureCount;
+  MICROCODE_TEST_SIGNATURE      ExtendedTable[5];
+  //
+  // TRUE if the CheckSum32 of the patch is not correct
+  //
+  BOOLEAN                       Corrupted;
+} MICROCODE_TEST_PATCH;
+
+//
+// Microcode patches of the tests, in the order of the microcode patches data.
+// The extended signature tables make the index hold more entries than it can
+// before it is reallocated.
+//
+MICROCODE_TEST_PATCH  mMicrocodeTestPatches[] = {
+  { 0x000906E9, 0x02, 0x80, SIZE_1KB, 0, { { 0 } }, FALSE },
+  { 0x000906E9, 0x02, 0xB4, SIZE_1KB, 0, { { 0 } }, FALSE },
+  {
+    0x000906EA, 0x22, 0xB4, SIZE_2KB, 5,
+    {
+      { 0x000906E9, 0x08 },
+      { 0x000906EB, 0x02 },
+      { 0x000906EC, 0x22 },
+      { 0x000906ED, 0x22 },
+      { 0x000906EE, 0x01 }
+    },
+    FALSE
+  },
+  { 0x000906E9, 0x02, 0xC6, SIZE_1KB, 0, { { 0 } }, TRUE },
+  { 0x000906EA, 0x22, 0xB4, SIZE_1KB, 0, { { 0 } }, FALSE },
+  { 0x00050654, 0xB7, 0x0200005E, 0, 0, { { 0 } }, FALSE },
+  { 0x000906EB, 0x03, 0xCA, SIZE_1KB, 0, { { 0 } }, FALSE }
+};
+
+//
+// Processor signatures of the tests, with one that no patch supports
+//
+UINT32  mMicrocodeTestSignatures[] = {
+  0x000906E9, 0x000906EA, 0x000906EB, 0x000906EC, 0x000906ED, 0x000906EE, 0x00050654, 0x000A0671
+};
+
+/**
+  Write a microcode patch into the microcode patches data, with the CheckSum32
+  of its header and of its extended signature table.
+
+  @param[in]  Patch   The microcode patch.
+  @param[out] Buffer  The buffer to write the microcode patch into.
+
+  @return The size of the microcode patch.
+**/
+UINTN
+MicrocodeTestWritePatch (
+  IN  CONST MICROCODE_TEST_PATCH           *Patch,
+  OUT VOID                                 *Buffer
+  )
+{
+  CPU_MICROCODE_HEADER                     *Header;
+  CPU_MICROCODE_EXTENDED_TABLE_HEADER      *ExtendedTableHeader;
+  CPU_MICROCODE_EXTENDED_TABLE             *ExtendedTable;
+  UINT32                                   *Data;
+  UINTN                                    ExtendedTableLength;
+  UINTN                                    TotalSize;
+  UINTN                                    Index;
+
+  Header = (CPU_MICROCODE_HEADER *) Buffer;
+  ZeroMem (Header, sizeof (*Header));
+  Header->HeaderVersion             = 1;
+  Header->UpdateRevision            = Patch->UpdateRevision;
+  Header->ProcessorSignature.Uint32 = Patch->ProcessorSignature;
+  Header->LoaderRevision            = 1;
+  Header->ProcessorFlags            = Patch->ProcessorFlags;
+
+  ExtendedTableLength = 0;
+  if (Patch->ExtendedSignatureCount != 0) {
+    ExtendedTableLength = sizeof (CPU_MICROCODE_EXTENDED_TABLE_HEADER) +
+                          Patch->ExtendedSignatureCount * sizeof (CPU_MICROCODE_EXTENDED_TABLE);
+  }
+
+  if (Patch->TotalSize == 0) {
+    TotalSize = SIZE_2KB;
+  } else {
+    TotalSize         = Patch->TotalSize;
+    Header->DataSize  = (UINT32) (TotalSize - sizeof (*Header) - ExtendedTableLength);
+    Header->TotalSize = (UINT32) TotalSize;
+  }
+
+  //
+  // The microcode binary is filled with a pattern, and the checksum makes the
+  // CheckSum32 of the header and the microcode binary 0.
+  //
+  Data = (UINT32 *) (Header + 1);
+  for (Index = 0; Index < (TotalSize - sizeof (*Header) - ExtendedTableLength) / sizeof (UINT32); Index++) {
+    Data[Index] = (UINT32) (0x9E3779B9 * (Index + 1) + Patch->UpdateRevision);
+  }
+  Header->Checksum = 0;
+  Header->Checksum = (UINT32) (0 - CalculateSum32 ((UINT32 *) Header, TotalSize - ExtendedTableLength));
+
+  if (Patch->ExtendedSignatureCount != 0) {
+    ExtendedTableHeader = (CPU_MICROCODE_EXTENDED_TABLE_HEADER *) ((UINT8 *) Buffer + TotalSize - ExtendedTableLength);
+    ZeroMem (ExtendedTableHeader, ExtendedTableLength);
+    ExtendedTableHeader->ExtendedSignatureCount = Patch->ExtendedSignatureCount;
+    ExtendedTable = (CPU_MICROCODE_EXTENDED_TABLE *) (ExtendedTableHeader + 1);
+    for (Index = 0; Index < Patch->ExtendedSignatureCount; Index++) {
+      //
+      // The checksum of the extended signature makes the CheckSum32 of the
+      // patch 0 when it replaces the signature of the header.
+      //
+      ExtendedTable[Index].ProcessorSignature.Uint32 = Patch->ExtendedTable[Index].ProcessorSignature;
+      ExtendedTable[Index].ProcessorFlag             = Patch->ExtendedTable[Index].ProcessorFlag;
+      ExtendedTable[Index].Checksum                  = Header->ProcessorSignature.Uint32 + Header->ProcessorFlags +
+                                                       Header->Checksum - ExtendedTable[Index].ProcessorSignature.Uint32 -
+                                                       ExtendedTable[Index].ProcessorFlag;
+    }
+    ExtendedTableHeader->ExtendedChecksum = (UINT32) (0 - CalculateSum32 ((UINT32 *) ExtendedTableHeader, ExtendedTableLength));
+  }
+
+  if (Patch->Corrupted) {
+    Data[0]++;
+  }
+
+  return TotalSize;
+}
+
+/**
+  Create the CPU MP Data structure of one processor, with the microcode patches
+  data of the tests: the microcode patches, with padding after the patch that
+  fails the CheckSum32.
+
+  @return The CPU MP Data structure, or NULL if there is not enough memory.
+**/
+CPU_MP_DATA *
+MicrocodeTestCreateCpuMpData (
+  VOID
+  )
+{
+  CPU_MP_DATA               *CpuMpData;
+  UINT8                     *MicrocodePatches;
+  UINTN                     Offset;
+  UINTN                     Index;
+
+  CpuMpData        = AllocateZeroPool (sizeof (*CpuMpData));
+  MicrocodePatches = AllocatePool (MICROCODE_TEST_REGION_SIZE);
+  if ((CpuMpData == NULL) || (MicrocodePatches == NULL)) {
+    return NULL;
+  }
+  CpuMpData->CpuData = AllocateZeroPool (sizeof (CPU_AP_DATA));
+  if (CpuMpData->CpuData == NULL) {
+    return NULL;
+  }
+  CpuMpData->BspNumber = 0;
+
+  //
+  // The microcode patches data after the last patch is the erased flash.
+  //
+  SetMem (MicrocodePatches, MICROCODE_TEST_REGION_SIZE, 0xFF);
+  Offset = 0;
+  for (Index = 0; Index < ARRAY_SIZE (mMicrocodeTestPatches); Index++) {
+    Offset += MicrocodeTestWritePatch (&mMicrocodeTestPatches[Index], MicrocodePatches + Offset);
+    if (mMicrocodeTestPatches[Index].Corrupted) {
+      SetMem (MicrocodePatches + Offset, SIZE_1KB, 0xA5);
+      Offset += SIZE_1KB;
+    }
+  }
+  ASSERT (Offset <= MICROCODE_TEST_REGION_SIZE);
+
+  CpuMpData->MicrocodePatchAddress    = (UINTN) MicrocodePatches;
+  CpuMpData->MicrocodePatchRegionSize = MICROCODE_TEST_REGION_SIZE;
+  return CpuMpData;
+}
+
+/**
+  Free the CPU MP Data structure of the tests.
+
+  @param[in] CpuMpData  The CPU MP Data structure.
+**/
+VOID
+MicrocodeTestFreeCpuMpData (
+  IN CPU_MP_DATA  *CpuMpData
+  )
+{
+  if (CpuMpData->MicrocodePatchIndex != 0) {
+    FreePages (
+      (VOID *) (UINTN) CpuMpData->MicrocodePatchIndex,
+      EFI_SIZE_TO_PAGES (MAX (CpuMpData->MicrocodePatchIndexCount, 1) * sizeof (MICROCODE_PATCH_INDEX_ENTRY))
+      );
+  }
+  FreePool ((VOID *) (UINTN) CpuMpData->MicrocodePatchAddress);
+  FreePool (CpuMpData->CpuData);
+  FreePool (CpuMpData);
+}
+
+/**
+  Detect and load the microcode patch for the test processor.
+
+  @param[in] CpuMpData  The CPU MP Data structure.
+
+  @return The address of the header of the microcode patch loaded, or 0 if
+          no microcode patch is loaded.
+**/
+UINTN
+MicrocodeTestDetect (
+  IN CPU_MP_DATA  *CpuMpData
+  )
+{
+  CpuMpData->CpuData[0].MicrocodeEntryAddr = 0;
+  mStubMicrocodeRevision  = 0;
+  mStubMicrocodeLoadCount = 0;
+  MicrocodeDetect (CpuMpData, 0);
+  if (mStubMicrocodeLoadCount == 0) {
+    return 0;
+  }
+  return (UINTN) CpuMpData->CpuData[0].MicrocodeEntryAddr;
+}
+
+/**
+  Check that, for processors of each signature and platform ID, the microcode
+  patch found in the microcode patch index is the one that the scan of the
+  microcode patches data loads.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+IndexShouldFindScannedPatch (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CPU_MP_DATA           *CpuMpData;
+  UINTN                 Signature;
+  UINT8                 PlatformId;
+  UINTN                 Scanned[ARRAY_SIZE (mMicrocodeTestSignatures)][MICROCODE_TEST_PLATFORM_COUNT];
+  UINTN                 LoadedCount;
+  CPU_MICROCODE_HEADER  *MicrocodeEntryPoint;
+
+  CpuMpData = MicrocodeTestCreateCpuMpData ();
+  UT_ASSERT_NOT_NULL (CpuMpData);
+
+  //
+  // Scan the microcode patches data without the index.
+  //
+  LoadedCount = 0;
+  for (Signature = 0; Signature < ARRAY_SIZE (mMicrocodeTestSignatures); Signature++) {
+    for (PlatformId = 0; PlatformId < MICROCODE_TEST_PLATFORM_COUNT; PlatformId++) {
+      mStubProcessorSignature = mMicrocodeTestSignatures[Signature];
+      mStubPlatformId         = PlatformId;
+      Scanned[Signature][PlatformId] = MicrocodeTestDetect (CpuMpData);
+      if (Scanned[Signature][PlatformId] != 0) {
+        LoadedCount++;
+      }
+    }
+  }
+  UT_ASSERT_NOT_EQUAL (LoadedCount, 0);
+
+  //
+  // The index holds an entry for each signature of the patches that pass the
+  // CheckSum32, and it is looked up instead of the scan.
+  //
+  BuildMicrocodePatchIndex (CpuMpData);
+  UT_ASSERT_NOT_EQUAL (CpuMpData->MicrocodePatchIndex, 0);
+  UT_ASSERT_EQUAL (CpuMpData->MicrocodePatchIndexCount, 11);
+
+  for (Signature = 0; Signature < ARRAY_SIZE (mMicrocodeTestSignatures); Signature++) {
+    for (PlatformId = 0; PlatformId < MICROCODE_TEST_PLATFORM_COUNT; PlatformId++) {
+      mStubProcessorSignature = mMicrocodeTestSignatures[Signature];
+      mStubPlatformId         = PlatformId;
+      MicrocodeEntryPoint = FindMicrocodePatchInIndex (CpuMpData, mStubProcessorSignature, PlatformId);
+      UT_ASSERT_EQUAL ((UINTN) MicrocodeEntryPoint, Scanned[Signature][PlatformId]);
+      UT_ASSERT_EQUAL (MicrocodeTestDetect (CpuMpData), Scanned[Signature][PlatformId]);
+    }
+  }
+
+  MicrocodeTestFreeCpuMpData (CpuMpData);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check the microcode patches that the scan of the microcode patches data
+  loads: the latest revision that passes the CheckSum32 is loaded, and the
+  first of the patches with the same revision.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ScanShouldLoadLatestPatch (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CPU_MP_DATA           *CpuMpData;
+  UINTN                 Patch1;
+  UINTN                 Patch2;
+
+  CpuMpData = MicrocodeTestCreateCpuMpData ();
+  UT_ASSERT_NOT_NULL (CpuMpData);
+  Patch1 = (UINTN) CpuMpData->MicrocodePatchAddress + SIZE_1KB;
+  Patch2 = (UINTN) CpuMpData->MicrocodePatchAddress + SIZE_2KB;
+
+  //
+  // The patch of revision 0xC6 fails the CheckSum32.
+  //
+  mStubProcessorSignature = 0x000906E9;
+  mStubPlatformId         = 1;
+  UT_ASSERT_EQUAL (MicrocodeTestDetect (CpuMpData), Patch1);
+  UT_ASSERT_EQUAL (mStubMicrocodeRevision, 0xB4);
+
+  //
+  // The extended signature table of the first patch of revision 0xB4.
+  //
+  mStubPlatformId = 3;
+  UT_ASSERT_EQUAL (MicrocodeTestDetect (CpuMpData), Patch2);
+
+  mStubProcessorSignature = 0x000906EA;
+  mStubPlatformId         = 5;
+  UT_ASSERT_EQUAL (MicrocodeTestDetect (CpuMpData), Patch2);
+
+  mStubPlatformId = 0;
+  UT_ASSERT_EQUAL (MicrocodeTestDetect (CpuMpData), 0);
+
+  MicrocodeTestFreeCpuMpData (CpuMpData);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the microcode
+  patch index and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      IndexTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&IndexTests, Framework, "Microcode Patch Index Tests", "MpInitLib.Microcode", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for IndexTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (IndexTests, "Scan should load the latest patch", "ScanLatestPatch", ScanShouldLoadLatestPatch, NULL, NULL, NULL);
+  AddTestCase (IndexTests, "Index should find the scanned patch", "IndexScannedPatch", IndexShouldFindScannedPatch, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
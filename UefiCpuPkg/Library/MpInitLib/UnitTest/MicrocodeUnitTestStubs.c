@@ -0,0 +1,205 @@
+/** @file
+  Host based stand-ins for the services that the microcode loading of the MP
+  initialization library (Microcode.c) depends on, for the tests of the
+  microcode patch index.
+
+  The stand-ins model a processor with a signature and a platform ID that the
+  tests set: CPUID reports the signature, MSR_IA32_PLATFORM_ID reports the
+  platform ID, and writing MSR_IA32_BIOS_UPDT_TRIG loads the revision of the
+  microcode patch written.  The unit test INF renames the processor services
+  Microcode.c calls to the stand-ins, so that they do not collide with the ones
+  of BaseLib.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MpLib.h"
+
+//
+// Processor signature and platform ID of the test processor, revision of the
+// microcode loaded, and number of microcode loads
+//
+UINT32    mStubProcessorSignature;
+UINT8     mStubPlatformId;
+UINT32    mStubMicrocodeRevision;
+UINTN     mStubMicrocodeLoadCount;
+
+/**
+  Retrieves CPUID information of the test processor.
+
+  @param[in]  Index  The 32-bit value to load into EAX prior to invoking the CPUID instruction.
+  @param[out] Eax    The pointer to the 32-bit EAX value returned by the CPUID instruction.
+  @param[out] Ebx    The pointer to the 32-bit EBX value returned by the CPUID instruction.
+  @param[out] Ecx    The pointer to the 32-bit ECX value returned by the CPUID instruction.
+  @param[out] Edx    The pointer to the 32-bit EDX value returned by the CPUID instruction.
+
+  @return Index.
+**/
+UINT32
+EFIAPI
+AsmCpuid (
+  IN      UINT32                    Index,
+  OUT     UINT32                    *Eax,  OPTIONAL
+  OUT     UINT32                    *Ebx,  OPTIONAL
+  OUT     UINT32                    *Ecx,  OPTIONAL
+  OUT     UINT32                    *Edx   OPTIONAL
+  )
+{
+  if (Eax != NULL) {
+    *Eax = (Index == CPUID_VERSION_INFO) ? mStubProcessorSignature : 0;
+  }
+  if (Ebx != NULL) {
+    *Ebx = 0;
+  }
+  if (Ecx != NULL) {
+    *Ecx = 0;
+  }
+  if (Edx != NULL) {
+    *Edx = 0;
+  }
+  return Index;
+}
+
+/**
+  Returns an MSR of the test processor.
+
+  @param[in]  MsrIndex  The MSR to read.
+
+  @return The value of the MSR.
+**/
+UINT64
+EFIAPI
+AsmReadMsr64 (
+  IN UINT32                         MsrIndex
+  )
+{
+  MSR_IA32_PLATFORM_ID_REGISTER     PlatformIdMsr;
+  MSR_IA32_BIOS_SIGN_ID_REGISTER    BiosSignIdMsr;
+
+  switch (MsrIndex) {
+  case MSR_IA32_PLATFORM_ID:
+    PlatformIdMsr.Uint64          = 0;
+    PlatformIdMsr.Bits.PlatformId = mStubPlatformId;
+    return PlatformIdMsr.Uint64;
+
+  case MSR_IA32_BIOS_SIGN_ID:
+    BiosSignIdMsr.Uint64                        = 0;
+    BiosSignIdMsr.Bits.MicrocodeUpdateSignature = mStubMicrocodeRevision;
+    return BiosSignIdMsr.Uint64;
+
+  default:
+    ASSERT (FALSE);
+    return 0;
+  }
+}
+
+/**
+  Writes an MSR of the test processor. Writing MSR_IA32_BIOS_UPDT_TRIG loads
+  the revision of the microcode patch whose data it points to.
+
+  @param[in]  MsrIndex  The MSR to write.
+  @param[in]  Value     The value to write to the MSR.
+
+  @return Value
+**/
+UINT64
+EFIAPI
+AsmWriteMsr64 (
+  IN UINT32                 MsrIndex,
+  IN UINT64                 Value
+  )
+{
+  CPU_MICROCODE_HEADER      *MicrocodeEntryPoint;
+
+  switch (MsrIndex) {
+  case MSR_IA32_BIOS_UPDT_TRIG:
+    MicrocodeEntryPoint    = (CPU_MICROCODE_HEADER *) (UINTN) Value - 1;
+    mStubMicrocodeRevision = MicrocodeEntryPoint->UpdateRevision;
+    mStubMicrocodeLoadCount++;
+    break;
+
+  case MSR_IA32_BIOS_SIGN_ID:
+    break;
+
+  default:
+    ASSERT (FALSE);
+    break;
+  }
+  return Value;
+}
+
+/**
+  The test processor has the initial APIC ID 0.
+
+  @return 0
+**/
+UINT32
+EFIAPI
+GetInitialApicId (
+  VOID
+  )
+{
+  return 0;
+}
+
+/**
+  The test processor is the first thread of the first core of the first
+  package.
+
+  @param[in]  InitialApicId  Unused.
+  @param[out] Package        Returns 0.
+  @param[out] Core           Returns 0.
+  @param[out] Thread         Returns 0.
+**/
+VOID
+EFIAPI
+GetProcessorLocationByApicId (
+  IN  UINT32  InitialApicId,
+  OUT UINT32  *Package  OPTIONAL,
+  OUT UINT32  *Core    OPTIONAL,
+  OUT UINT32  *Thread  OPTIONAL
+  )
+{
+  if (Package != NULL) {
+    *Package = 0;
+  }
+  if (Core != NULL) {
+    *Core = 0;
+  }
+  if (Thread != NULL) {
+    *Thread = 0;
+  }
+}
+
+/**
+  The tests create the microcode patches data in memory.
+
+  @param[in] CpuMpData      Unused.
+
+  @retval EFI_UNSUPPORTED   There is no platform specific microcode shadow.
+**/
+EFI_STATUS
+PlatformShadowMicrocode (
+  IN OUT CPU_MP_DATA             *CpuMpData
+  )
+{
+  return EFI_UNSUPPORTED;
+}
+
+/**
+  The tests run without HOBs.
+
+  @param[in] Guid          Unused.
+
+  @retval NULL             There is no HOB.
+**/
+VOID *
+EFIAPI
+GetFirstGuidHob (
+  IN CONST EFI_GUID         *Guid
+  )
+{
+  return NULL;
+}
@@ -0,0 +1,441 @@
+/** @file
+  Host based unit tests of the task pool of the MP initialization library.
+
+  The tests model four processors.  The BSP submits and joins the tasks, and
+  the tests run tasks for the APs one at a time, the way TaskPoolWorker() does
+  on each AP, to check which task each processor takes.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "MpLib.h"
+
+#define UNIT_TEST_APP_NAME        "MP Task Pool Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Number of processors of the tests, the BSP being processor 0
+//
+#define TASK_POOL_TEST_CPU_COUNT  4
+
+//
+// Number of tasks of the tests, more than a deque holds
+//
+#define TASK_POOL_TEST_TASK_COUNT (MP_TASK_DEQUE_SIZE + 8)
+
+//
+// CPU MP Data structure of the tests, processor that calls the task pool,
+// and number of times the APs are woken up and checked
+//
+extern CPU_MP_DATA  *mStubCpuMpData;
+extern UINTN        mStubProcessorNumber;
+extern UINTN        mStubWakeUpCount;
+extern UINTN        mStubCheckAllApsCount;
+
+//
+// Number of times each task ran, processor that ran it, and order in which
+// the tasks ran
+//
+UINTN  mTaskRunCount[TASK_POOL_TEST_TASK_COUNT];
+UINTN  mTaskRunner[TASK_POOL_TEST_TASK_COUNT];
+UINTN  mTaskRunOrder[TASK_POOL_TEST_TASK_COUNT];
+UINTN  mTaskRunTotal;
+
+/**
+  Task of the tests: record that the task ran, and on which processor.
+
+  @param[in] Buffer  The index of the task.
+**/
+VOID
+EFIAPI
+TaskPoolTestTask (
+  IN VOID  *Buffer
+  )
+{
+  UINTN  Index;
+
+  Index = (UINTN) Buffer;
+  ASSERT (Index < TASK_POOL_TEST_TASK_COUNT);
+  mTaskRunCount[Index]++;
+  mTaskRunner[Index]             = mStubProcessorNumber;
+  mTaskRunOrder[mTaskRunTotal++] = Index;
+}
+
+/**
+  Task of the tests that submits the two tasks following it.
+
+  @param[in] Buffer  The index of the task.
+**/
+VOID
+EFIAPI
+TaskPoolTestSpawnTask (
+  IN VOID  *Buffer
+  )
+{
+  EFI_STATUS  Status;
+
+  TaskPoolTestTask (Buffer);
+  Status = MpInitLibTaskPoolSubmit (TaskPoolTestTask, (VOID *) ((UINTN) Buffer + 1));
+  ASSERT_EFI_ERROR (Status);
+  Status = MpInitLibTaskPoolSubmit (TaskPoolTestTask, (VOID *) ((UINTN) Buffer + 2));
+  ASSERT_EFI_ERROR (Status);
+}
+
+/**
+  Create the CPU MP Data structure of the tests, with idle APs and no task
+  pool, and clear the records of the tasks.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED                      The CPU MP Data structure is created.
+  @retval  UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  There is not enough memory.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TaskPoolTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  CPU_MP_DATA  *CpuMpData;
+
+  CpuMpData = AllocateZeroPool (sizeof (*CpuMpData));
+  if (CpuMpData == NULL) {
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+  CpuMpData->CpuData = AllocateZeroPool (sizeof (CPU_AP_DATA) * TASK_POOL_TEST_CPU_COUNT);
+  if (CpuMpData->CpuData == NULL) {
+    FreePool (CpuMpData);
+    return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+  }
+  CpuMpData->CpuCount  = TASK_POOL_TEST_CPU_COUNT;
+  CpuMpData->BspNumber = 0;
+
+  mStubCpuMpData        = CpuMpData;
+  mStubProcessorNumber  = 0;
+  mStubWakeUpCount      = 0;
+  mStubCheckAllApsCount = 0;
+
+  ZeroMem (mTaskRunCount, sizeof (mTaskRunCount));
+  ZeroMem (mTaskRunner, sizeof (mTaskRunner));
+  ZeroMem (mTaskRunOrder, sizeof (mTaskRunOrder));
+  mTaskRunTotal = 0;
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Free the CPU MP Data structure of the tests, and its task pool.
+
+  @param[in]  Context    Unused.
+**/
+VOID
+EFIAPI
+TaskPoolTestCleanup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MP_TASK_POOL  *TaskPool;
+
+  TaskPool = mStubCpuMpData->TaskPool;
+  if (TaskPool != NULL) {
+    FreePages (
+      TaskPool,
+      EFI_SIZE_TO_PAGES ((UINTN) GetTaskDeque (TaskPool, TASK_POOL_TEST_CPU_COUNT) - (UINTN) TaskPool)
+      );
+  }
+  FreePool (mStubCpuMpData->CpuData);
+  FreePool (mStubCpuMpData);
+  mStubCpuMpData = NULL;
+}
+
+/**
+  Check that a task submitted to a full deque runs on the submitting
+  processor, and that joining runs all the other tasks, newest first, until
+  none is pending.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+FullDequeShouldRunTaskInline (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MP_TASK_POOL  *TaskPool;
+  UINTN         Index;
+
+  //
+  // The first task wakes up the APs, and the BSP queues the tasks
+  //
+  for (Index = 0; Index < MP_TASK_DEQUE_SIZE; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (MpInitLibTaskPoolSubmit (TaskPoolTestTask, (VOID *) Index));
+  }
+  TaskPool = mStubCpuMpData->TaskPool;
+  UT_ASSERT_NOT_NULL (TaskPool);
+  UT_ASSERT_TRUE (TaskPool->Running);
+  UT_ASSERT_EQUAL (mStubWakeUpCount, 1);
+  UT_ASSERT_EQUAL (mStubCpuMpData->CpuData[1].State, CpuStateBusy);
+  UT_ASSERT_EQUAL (TaskPool->PendingCount, MP_TASK_DEQUE_SIZE);
+  UT_ASSERT_EQUAL (mTaskRunTotal, 0);
+
+  //
+  // The deque of the BSP is full, so the BSP runs the next task itself
+  //
+  UT_ASSERT_NOT_EFI_ERROR (MpInitLibTaskPoolSubmit (TaskPoolTestTask, (VOID *) Index));
+  UT_ASSERT_EQUAL (mTaskRunCount[Index], 1);
+  UT_ASSERT_EQUAL (mTaskRunTotal, 1);
+  UT_ASSERT_EQUAL (TaskPool->PendingCount, MP_TASK_DEQUE_SIZE);
+
+  //
+  // Joining runs the queued tasks newest first, and returns the APs to idle
+  // state once no task is pending
+  //
+  UT_ASSERT_NOT_EFI_ERROR (MpInitLibTaskPoolJoin ());
+  UT_ASSERT_EQUAL (TaskPool->PendingCount, 0);
+  UT_ASSERT_FALSE (TaskPool->Running);
+  UT_ASSERT_EQUAL (mStubCheckAllApsCount, 1);
+  UT_ASSERT_EQUAL (mStubCpuMpData->CpuData[1].State, CpuStateIdle);
+  UT_ASSERT_EQUAL (mTaskRunTotal, MP_TASK_DEQUE_SIZE + 1);
+  for (Index = 0; Index < MP_TASK_DEQUE_SIZE; Index++) {
+    UT_ASSERT_EQUAL (mTaskRunCount[Index], 1);
+    UT_ASSERT_EQUAL (mTaskRunOrder[Index + 1], MP_TASK_DEQUE_SIZE - 1 - Index);
+  }
+
+  //
+  // Joining again does nothing
+  //
+  UT_ASSERT_NOT_EFI_ERROR (MpInitLibTaskPoolJoin ());
+  UT_ASSERT_EQUAL (mStubCheckAllApsCount, 1);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that the APs steal the oldest tasks of the other processors, that the
+  tasks submitted by a task on an AP are queued by the AP, and that each deque
+  keeps its Lock, Top and Bottom on a cache line of its own.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ApsShouldStealOldestTasks (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MP_TASK_POOL   *TaskPool;
+  MP_TASK_DEQUE  *Deque;
+  UINTN          LineSize;
+  UINTN          Index;
+
+  for (Index = 0; Index < 8; Index++) {
+    UT_ASSERT_NOT_EFI_ERROR (MpInitLibTaskPoolSubmit (TaskPoolTestTask, (VOID *) Index));
+  }
+  TaskPool = mStubCpuMpData->TaskPool;
+  UT_ASSERT_NOT_NULL (TaskPool);
+
+  //
+  // The deques and their tasks start cache lines, and the tasks end before
+  // the next deque
+  //
+  LineSize = GetSpinLockProperties ();
+  for (Index = 0; Index < TASK_POOL_TEST_CPU_COUNT; Index++) {
+    Deque = GetTaskDeque (TaskPool, Index);
+    UT_ASSERT_EQUAL ((UINTN) Deque % LineSize, 0);
+    UT_ASSERT_EQUAL ((UINTN) Deque->Task % LineSize, 0);
+    UT_ASSERT_TRUE ((UINTN) Deque->Task >= (UINTN) Deque + sizeof (MP_TASK_DEQUE));
+    UT_ASSERT_TRUE ((UINTN) (Deque->Task + MP_TASK_DEQUE_SIZE) <= (UINTN) GetTaskDeque (TaskPool, Index + 1));
+  }
+  UT_ASSERT_TRUE ((UINTN) GetTaskDeque (TaskPool, 0) >= (UINTN) (TaskPool + 1));
+
+  //
+  // APs without tasks steal the oldest tasks of the BSP
+  //
+  mStubProcessorNumber = 2;
+  UT_ASSERT_TRUE (RunNextTask (mStubCpuMpData, 2));
+  UT_ASSERT_EQUAL (mTaskRunOrder[0], 0);
+  UT_ASSERT_EQUAL (mTaskRunner[0], 2);
+  mStubProcessorNumber = 1;
+  UT_ASSERT_TRUE (RunNextTask (mStubCpuMpData, 1));
+  UT_ASSERT_EQUAL (mTaskRunOrder[1], 1);
+  UT_ASSERT_EQUAL (mTaskRunner[1], 1);
+  UT_ASSERT_EQUAL (TaskPool->PendingCount, 6);
+
+  //
+  // A task running on an AP queues the tasks it submits in the deque of the
+  // AP.  The AP runs the newest of them, and another AP steals the oldest.
+  //
+  mStubProcessorNumber = 3;
+  UT_ASSERT_NOT_EFI_ERROR (MpInitLibTaskPoolSubmit (TaskPoolTestSpawnTask, (VOID *) 8));
+  UT_ASSERT_TRUE (RunNextTask (mStubCpuMpData, 3));
+  UT_ASSERT_EQUAL (mTaskRunOrder[2], 8);
+  Deque = GetTaskDeque (TaskPool, 3);
+  UT_ASSERT_EQUAL (Deque->Bottom - Deque->Top, 2);
+  UT_ASSERT_TRUE (RunNextTask (mStubCpuMpData, 3));
+  UT_ASSERT_EQUAL (mTaskRunOrder[3], 10);
+  mStubProcessorNumber = 1;
+  UT_ASSERT_TRUE (RunNextTask (mStubCpuMpData, 1));
+  UT_ASSERT_EQUAL (mTaskRunOrder[4], 9);
+  UT_ASSERT_EQUAL (mTaskRunner[9], 1);
+  UT_ASSERT_EQUAL (TaskPool->PendingCount, 6);
+
+  //
+  // The BSP runs the rest when it joins
+  //
+  mStubProcessorNumber = 0;
+  UT_ASSERT_NOT_EFI_ERROR (MpInitLibTaskPoolJoin ());
+  UT_ASSERT_EQUAL (TaskPool->PendingCount, 0);
+  UT_ASSERT_EQUAL (mTaskRunTotal, 11);
+  for (Index = 0; Index < 11; Index++) {
+    UT_ASSERT_EQUAL (mTaskRunCount[Index], 1);
+  }
+  for (Index = 2; Index < 8; Index++) {
+    UT_ASSERT_EQUAL (mTaskRunner[Index], 0);
+  }
+
+  //
+  // No task is left to run
+  //
+  mStubProcessorNumber = 2;
+  UT_ASSERT_FALSE (RunNextTask (mStubCpuMpData, 2));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that the APs can neither start nor join the task pool, and that the
+  pool only starts when the enabled APs are idle.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ApsShouldNotStartOrJoin (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UT_ASSERT_STATUS_EQUAL (MpInitLibTaskPoolSubmit (NULL, NULL), EFI_INVALID_PARAMETER);
+
+  //
+  // Only the BSP starts the task pool, when the APs are idle
+  //
+  mStubProcessorNumber = 1;
+  UT_ASSERT_STATUS_EQUAL (MpInitLibTaskPoolSubmit (TaskPoolTestTask, (VOID *) 0), EFI_DEVICE_ERROR);
+  UT_ASSERT_STATUS_EQUAL (MpInitLibTaskPoolJoin (), EFI_DEVICE_ERROR);
+
+  mStubProcessorNumber = 0;
+  mStubCpuMpData->CpuData[2].State = CpuStateBusy;
+  UT_ASSERT_STATUS_EQUAL (MpInitLibTaskPoolSubmit (TaskPoolTestTask, (VOID *) 0), EFI_NOT_READY);
+  UT_ASSERT_EQUAL (mStubWakeUpCount, 0);
+
+  //
+  // Disabled APs are left out of the task pool
+  //
+  mStubCpuMpData->CpuData[2].State = CpuStateDisabled;
+  UT_ASSERT_NOT_EFI_ERROR (MpInitLibTaskPoolSubmit (TaskPoolTestTask, (VOID *) 0));
+  UT_ASSERT_EQUAL (mStubWakeUpCount, 1);
+  UT_ASSERT_EQUAL (mStubCpuMpData->RunningCount, 2);
+  UT_ASSERT_EQUAL (mStubCpuMpData->CpuData[2].State, CpuStateDisabled);
+
+  //
+  // An AP cannot join the task pool, and the task stays pending
+  //
+  mStubProcessorNumber = 3;
+  UT_ASSERT_STATUS_EQUAL (MpInitLibTaskPoolJoin (), EFI_DEVICE_ERROR);
+  UT_ASSERT_EQUAL (mStubCpuMpData->TaskPool->PendingCount, 1);
+  UT_ASSERT_EQUAL (mTaskRunTotal, 0);
+  UT_ASSERT_EQUAL (mStubCheckAllApsCount, 0);
+
+  mStubProcessorNumber = 0;
+  UT_ASSERT_NOT_EFI_ERROR (MpInitLibTaskPoolJoin ());
+  UT_ASSERT_EQUAL (mTaskRunCount[0], 1);
+  UT_ASSERT_EQUAL (mStubCpuMpData->TaskPool->PendingCount, 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the task pool
+  and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      TaskPoolTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&TaskPoolTests, Framework, "MP Task Pool Tests", "MpInitLib.TaskPool", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for TaskPoolTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (TaskPoolTests, "Full deque should run the task inline", "FullDeque", FullDequeShouldRunTaskInline, TaskPoolTestSetup, TaskPoolTestCleanup, NULL);
+  AddTestCase (TaskPoolTests, "APs should steal the oldest tasks", "Steal", ApsShouldStealOldestTasks, TaskPoolTestSetup, TaskPoolTestCleanup, NULL);
+  AddTestCase (TaskPoolTests, "APs should not start or join the task pool", "ApCaller", ApsShouldNotStartOrJoin, TaskPoolTestSetup, TaskPoolTestCleanup, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,173 @@
+/** @file
+  Host based stand-ins for the services that the task pool of the MP
+  initialization library (TaskPool.c) depends on, for the tests of the task
+  pool.
+
+  The stand-ins model the processors of the CPU MP Data structure that the
+  tests set: the tests also set the processor that calls the task pool, and
+  an AP only runs the tasks that the tests run for it.  Waking up the APs
+  marks them busy, and checking the APs returns them to idle state.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "MpLib.h"
+
+//
+// CPU MP Data structure of the tests, processor that calls the task pool,
+// and number of times the APs are woken up and checked
+//
+CPU_MP_DATA  *mStubCpuMpData;
+UINTN        mStubProcessorNumber;
+UINTN        mStubWakeUpCount;
+UINTN        mStubCheckAllApsCount;
+
+/**
+  Get the pointer to CPU MP Data structure of the tests.
+
+  @return  The pointer to CPU MP Data structure.
+**/
+CPU_MP_DATA *
+GetCpuMpData (
+  VOID
+  )
+{
+  return mStubCpuMpData;
+}
+
+/**
+  Find the processor that calls the task pool.
+
+  @param[in]  CpuMpData         Pointer to CPU MP Data
+  @param[out] ProcessorNumber   Return the pocessor number found
+
+  @retval EFI_SUCCESS          ProcessorNumber is found and returned.
+  @retval EFI_NOT_FOUND        ProcessorNumber is not found.
+**/
+EFI_STATUS
+GetProcessorNumber (
+  IN CPU_MP_DATA               *CpuMpData,
+  OUT UINTN                    *ProcessorNumber
+  )
+{
+  if (mStubProcessorNumber >= CpuMpData->CpuCount) {
+    return EFI_NOT_FOUND;
+  }
+  *ProcessorNumber = mStubProcessorNumber;
+  return EFI_SUCCESS;
+}
+
+/**
+  Return the handle number of the processor that calls the task pool.
+
+  @param[out] ProcessorNumber  Pointer to the handle number of the processor.
+
+  @retval EFI_SUCCESS          The handle number is returned.
+**/
+EFI_STATUS
+EFIAPI
+MpInitLibWhoAmI (
+  OUT UINTN                    *ProcessorNumber
+  )
+{
+  *ProcessorNumber = mStubProcessorNumber;
+  return EFI_SUCCESS;
+}
+
+/**
+  The tests update the AP states themselves.
+**/
+VOID
+CheckAndUpdateApsStatus (
+  VOID
+  )
+{
+}
+
+/**
+  Get the Application Processors state.
+
+  @param[in]  CpuData    The pointer to CPU_AP_DATA of specified AP
+
+  @return  The AP status
+**/
+CPU_STATE
+GetApState (
+  IN  CPU_AP_DATA     *CpuData
+  )
+{
+  return CpuData->State;
+}
+
+/**
+  The tests do not time out.
+
+  @param[in]  TimeoutInMicroseconds   Unused.
+  @param[out] CurrentTime             Returns 0.
+
+  @return 0, which is recognized as infinity.
+**/
+UINT64
+CalculateTimeout (
+  IN  UINTN   TimeoutInMicroseconds,
+  OUT UINT64  *CurrentTime
+  )
+{
+  *CurrentTime = 0;
+  return 0;
+}
+
+/**
+  Wake up the APs waiting for the procedure: they become busy, and count the
+  wake up.
+
+  @param[in] CpuMpData          Pointer to CPU MP Data
+  @param[in] Broadcast          Unused.
+  @param[in] ProcessorNumber    Unused.
+  @param[in] Procedure          Unused.
+  @param[in] ProcedureArgument  Unused.
+  @param[in] WakeUpDisabledAps  Unused.
+**/
+VOID
+WakeUpAP (
+  IN CPU_MP_DATA               *CpuMpData,
+  IN BOOLEAN                   Broadcast,
+  IN UINTN                     ProcessorNumber,
+  IN EFI_AP_PROCEDURE          Procedure,              OPTIONAL
+  IN VOID                      *ProcedureArgument,     OPTIONAL
+  IN BOOLEAN                   WakeUpDisabledAps       OPTIONAL
+  )
+{
+  UINTN                        Index;
+
+  for (Index = 0; Index < CpuMpData->CpuCount; Index++) {
+    if (CpuMpData->CpuData[Index].Waiting) {
+      CpuMpData->CpuData[Index].State = CpuStateBusy;
+    }
+  }
+  mStubWakeUpCount++;
+}
+
+/**
+  Return the busy APs to idle state, and count the check.
+
+  @retval EFI_SUCCESS           All APs have finished.
+**/
+EFI_STATUS
+CheckAllAPs (
+  VOID
+  )
+{
+  UINTN                        Index;
+
+  for (Index = 0; Index < mStubCpuMpData->CpuCount; Index++) {
+    if (mStubCpuMpData->CpuData[Index].State == CpuStateBusy) {
+      mStubCpuMpData->CpuData[Index].State   = CpuStateIdle;
+      mStubCpuMpData->CpuData[Index].Waiting = FALSE;
+    }
+  }
+  mStubCheckAllApsCount++;
+  return EFI_SUCCESS;
+}
@@ -440,3 +440,49 @@ MpInitLibStartupAllCPUs (
 
   return EFI_SUCCESS;
 }
+
+/**
+  This service submits a task to the task pool, to run on any enabled CPU.
+
+  There is only the BSP, which runs the task at once.
+
+  @param[in]  Procedure               A pointer to the function to be run as a task.
+                                      See type EFI_AP_PROCEDURE.
+  @param[in]  ProcedureArgument       The parameter passed into Procedure.
+
+  @retval EFI_SUCCESS             The task was run.
+  @retval EFI_INVALID_PARAMETER   Procedure is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+MpInitLibTaskPoolSubmit (
+  IN  EFI_AP_PROCEDURE          Procedure,
+  IN  VOID                      *ProcedureArgument      OPTIONAL
+  )
+{
+  if (Procedure == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Procedure (ProcedureArgument);
+
+  return EFI_SUCCESS;
+}
+
+/**
+  This service joins the task pool.
+
+  There is only the BSP, which ran the tasks when they were submitted.
+
+  @retval EFI_SUCCESS             All the submitted tasks are finished.
+
+**/
+EFI_STATUS
+EFIAPI
+MpInitLibTaskPoolJoin (
+  VOID
+  )
+{
+  return EFI_SUCCESS;
+}
@@ -20,6 +20,8 @@
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 
+#include "MtrrLibInternal.h"
+
 #define OR_SEED      0x0101010101010101ull
 #define CLEAR_SEED   0xFFFFFFFFFFFFFFFFull
 #define MAX_WEIGHT   MAX_UINT8
@@ -2554,6 +2556,274 @@ MtrrSetMemoryAttribute (
   return MtrrSetMemoryAttributeInMtrrSettings (NULL, BaseAddress, Length, Attribute);
 }
 
+/**
+  Worker function writes the MTRRs of the processor that differ between the
+  current MTRR settings and the new ones.
+
+  @param[in]  Current      The current MTRR settings of the processor.
+  @param[in]  MtrrSetting  The new MTRR settings.
+
+**/
+VOID
+MtrrLibSetModifiedMtrrs (
+  IN CONST MTRR_SETTINGS         *Current,
+  IN CONST MTRR_SETTINGS         *MtrrSetting
+  )
+{
+  MTRR_CONTEXT                   MtrrContext;
+  BOOLEAN                        MtrrContextValid;
+  UINT32                         Index;
+  UINT32                         VariableMtrrCount;
+
+  MtrrContextValid = FALSE;
+
+  //
+  // Write fixed MTRRs that have been modified
+  //
+  for (Index = 0; Index < MTRR_NUMBER_OF_FIXED_MTRR; Index++) {
+    if (Current->Fixed.Mtrr[Index] != MtrrSetting->Fixed.Mtrr[Index]) {
+      if (!MtrrContextValid) {
+        MtrrLibPreMtrrChange (&MtrrContext);
+        MtrrContextValid = TRUE;
+      }
+      AsmWriteMsr64 (mMtrrLibFixedMtrrTable[Index].Msr, MtrrSetting->Fixed.Mtrr[Index]);
+    }
+  }
+
+  //
+  // Write variable MTRRs that have been modified
+  //
+  VariableMtrrCount = GetVariableMtrrCountWorker ();
+  ASSERT (VariableMtrrCount <= ARRAY_SIZE (MtrrSetting->Variables.Mtrr));
+  for (Index = 0; Index < VariableMtrrCount; Index++) {
+    if ((Current->Variables.Mtrr[Index].Base != MtrrSetting->Variables.Mtrr[Index].Base) ||
+        (Current->Variables.Mtrr[Index].Mask != MtrrSetting->Variables.Mtrr[Index].Mask)) {
+      if (!MtrrContextValid) {
+        MtrrLibPreMtrrChange (&MtrrContext);
+        MtrrContextValid = TRUE;
+      }
+      AsmWriteMsr64 (MSR_IA32_MTRR_PHYSBASE0 + (Index << 1), MtrrSetting->Variables.Mtrr[Index].Base);
+      AsmWriteMsr64 (MSR_IA32_MTRR_PHYSMASK0 + (Index << 1), MtrrSetting->Variables.Mtrr[Index].Mask);
+    }
+  }
+
+  if (MtrrContextValid || (Current->MtrrDefType != MtrrSetting->MtrrDefType)) {
+    if (!MtrrContextValid) {
+      MtrrLibPreMtrrChange (&MtrrContext);
+    }
+    //
+    // MtrrLibPreMtrrChange() disabled the MTRRs, write back MTRR_DEF_TYPE
+    // instead of only enabling them again.
+    //
+    AsmWriteMsr64 (MSR_IA32_MTRR_DEF_TYPE, MtrrSetting->MtrrDefType);
+    MtrrLibPostMtrrChangeEnableCache (&MtrrContext);
+  }
+}
+
+/**
+  This function starts an MTRR transaction, which stages the attributes of
+  multiple memory ranges and sets them together when it is committed.
+
+  The transaction can be committed multiple times. It keeps the last MTRR
+  settings calculated, so that committing the same memory ranges again onto
+  the same MTRR settings does not calculate them again.
+
+  @param[out]  Transaction  The MTRR transaction to start.
+  @param[in]   MtrrSetting  MTRR setting buffer the memory ranges are set into.
+                            NULL to set them into the MTRRs of the processor.
+**/
+VOID
+EFIAPI
+MtrrTransactionBegin (
+  OUT MTRR_TRANSACTION        *Transaction,
+  IN  MTRR_SETTINGS           *MtrrSetting  OPTIONAL
+  )
+{
+  ZeroMem (Transaction, sizeof (*Transaction));
+  Transaction->MtrrSetting = MtrrSetting;
+}
+
+/**
+  This function stages the attributes of a memory range in an MTRR transaction.
+
+  When range overlap happens, the range staged last takes higher priority.
+
+  @param[in, out]  Transaction  The MTRR transaction.
+  @param[in]       BaseAddress  The physical address that is the start address
+                                of a memory range.
+  @param[in]       Length       The size in bytes of the memory range.
+  @param[in]       Attribute    The bit mask of attributes to set for the
+                                memory range.
+
+  @retval RETURN_SUCCESS            The memory range is staged.
+  @retval RETURN_INVALID_PARAMETER  Length is zero.
+  @retval RETURN_OUT_OF_RESOURCES   The transaction cannot stage more memory ranges.
+                                    The memory ranges staged should be committed first.
+**/
+RETURN_STATUS
+EFIAPI
+MtrrTransactionAddRange (
+  IN OUT MTRR_TRANSACTION        *Transaction,
+  IN     PHYSICAL_ADDRESS        BaseAddress,
+  IN     UINT64                  Length,
+  IN     MTRR_MEMORY_CACHE_TYPE  Attribute
+  )
+{
+  MTRR_MEMORY_RANGE              *Last;
+
+  if (Length == 0) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  //
+  // Drop the ranges staged last that the new range covers, since it takes
+  // higher priority.
+  //
+  while (Transaction->RangeCount != 0) {
+    Last = &Transaction->Ranges[Transaction->RangeCount - 1];
+    if ((Last->BaseAddress < BaseAddress) ||
+        (Last->BaseAddress + Last->Length > BaseAddress + Length)) {
+      break;
+    }
+    Transaction->RangeCount--;
+  }
+
+  //
+  // Extend the range staged last when the new range continues it with the same type.
+  //
+  if (Transaction->RangeCount != 0) {
+    Last = &Transaction->Ranges[Transaction->RangeCount - 1];
+    if ((Last->Type == Attribute) && (Last->BaseAddress + Last->Length == BaseAddress)) {
+      Last->Length += Length;
+      return RETURN_SUCCESS;
+    }
+  }
+
+  if (Transaction->RangeCount == ARRAY_SIZE (Transaction->Ranges)) {
+    return RETURN_OUT_OF_RESOURCES;
+  }
+  Transaction->Ranges[Transaction->RangeCount].BaseAddress = BaseAddress;
+  Transaction->Ranges[Transaction->RangeCount].Length      = Length;
+  Transaction->Ranges[Transaction->RangeCount].Type        = Attribute;
+  Transaction->RangeCount++;
+  return RETURN_SUCCESS;
+}
+
+/**
+  This function sets the attributes of all the memory ranges staged in an MTRR
+  transaction, calculating the MTRR settings once for all of them.
+
+  The MTRRs of the processor, or the MTRR setting buffer, are only written when
+  the MTRR settings change.
+
+  @param[in, out]  Transaction  The MTRR transaction.
+  @param[in]       Scratch      A temporary scratch buffer that is used to perform the calculation.
+  @param[in, out]  ScratchSize  Pointer to the size in bytes of the scratch buffer.
+                                It may be updated to the actual required size when the calculation
+                                needs more scratch buffer.
+  @param[out]      Modified     Return TRUE if the MTRR settings changed, so that they
+                                need to be synchronized with the other processors.
+                                It is optional.
+
+  @retval RETURN_SUCCESS            The attributes were set for all the memory ranges staged.
+                                    The transaction is ready to stage new memory ranges.
+                                    On the other errors except RETURN_BUFFER_TOO_SMALL, none of
+                                    the attributes is set and the memory ranges staged are dropped.
+  @retval RETURN_INVALID_PARAMETER  The type of a memory range is invalid.
+  @retval RETURN_UNSUPPORTED        The processor does not support one or more bytes of a
+                                    memory range, or the processor does not support MTRRs.
+  @retval RETURN_OUT_OF_RESOURCES   There are not enough system resources to modify the attributes of
+                                    the memory ranges.
+  @retval RETURN_BUFFER_TOO_SMALL   The scratch buffer is too small for MTRR calculation.
+                                    The memory ranges stay staged, so that the transaction can be
+                                    committed again with a scratch buffer of the size returned.
+**/
+RETURN_STATUS
+EFIAPI
+MtrrTransactionCommit (
+  IN OUT MTRR_TRANSACTION        *Transaction,
+  IN     VOID                    *Scratch,
+  IN OUT UINTN                   *ScratchSize,
+  OUT    BOOLEAN                 *Modified  OPTIONAL
+  )
+{
+  RETURN_STATUS                  Status;
+  MTRR_SETTINGS                  Current;
+
+  if (Modified != NULL) {
+    *Modified = FALSE;
+  }
+
+  if (Transaction->RangeCount == 0) {
+    return RETURN_SUCCESS;
+  }
+
+  if (!IsMtrrSupported ()) {
+    Status = RETURN_UNSUPPORTED;
+    goto Exit;
+  }
+
+  if (Transaction->MtrrSetting == NULL) {
+    ZeroMem (&Current, sizeof (Current));
+    MtrrGetAllMtrrs (&Current);
+  } else {
+    CopyMem (&Current, Transaction->MtrrSetting, sizeof (Current));
+  }
+
+  if (Transaction->SolutionValid &&
+      (Transaction->SolvedRangeCount == Transaction->RangeCount) &&
+      (CompareMem (Transaction->SolvedRanges, Transaction->Ranges, Transaction->RangeCount * sizeof (Transaction->Ranges[0])) == 0) &&
+      ((CompareMem (&Current, &Transaction->SolvedFrom, sizeof (Current)) == 0) ||
+       (CompareMem (&Current, &Transaction->Solution, sizeof (Current)) == 0))) {
+    //
+    // The same ranges are set onto the same MTRR settings, or onto the MTRR
+    // settings they produced, so the last solution is reused.
+    //
+    DEBUG ((DEBUG_CACHE, "Mtrr: Reuse the MTRR settings calculated for %d ranges\n", Transaction->RangeCount));
+    Status = RETURN_SUCCESS;
+  } else {
+    Transaction->SolutionValid = FALSE;
+    CopyMem (&Transaction->SolvedFrom, &Current, sizeof (Current));
+    CopyMem (&Transaction->Solution, &Current, sizeof (Current));
+    Status = MtrrSetMemoryAttributesInMtrrSettings (
+               &Transaction->Solution, Scratch, ScratchSize,
+               Transaction->Ranges, Transaction->RangeCount
+               );
+    if (RETURN_ERROR (Status)) {
+      goto Exit;
+    }
+
+    if ((Transaction->MtrrSetting == NULL) &&
+        (CompareMem (&Current, &Transaction->Solution, OFFSET_OF (MTRR_SETTINGS, MtrrDefType)) == 0)) {
+      //
+      // The MTRRs of the processor are not written when no MTRR changes.
+      //
+      Transaction->Solution.MtrrDefType = Current.MtrrDefType;
+    }
+
+    Transaction->SolutionValid    = TRUE;
+    Transaction->SolvedRangeCount = Transaction->RangeCount;
+    CopyMem (Transaction->SolvedRanges, Transaction->Ranges, Transaction->RangeCount * sizeof (Transaction->Ranges[0]));
+  }
+
+  if (CompareMem (&Current, &Transaction->Solution, sizeof (Current)) != 0) {
+    if (Transaction->MtrrSetting == NULL) {
+      MtrrLibSetModifiedMtrrs (&Current, &Transaction->Solution);
+    } else {
+      CopyMem (Transaction->MtrrSetting, &Transaction->Solution, sizeof (Current));
+    }
+    if (Modified != NULL) {
+      *Modified = TRUE;
+    }
+  }
+
+Exit:
+  if (Status != RETURN_BUFFER_TOO_SMALL) {
+    Transaction->RangeCount = 0;
+  }
+  return Status;
+}
+
 /**
   Worker function setting variable MTRRs
 
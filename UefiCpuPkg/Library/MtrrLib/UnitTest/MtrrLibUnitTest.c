@@ -0,0 +1,804 @@
+/** @file
+  Host based unit tests of the MTRR library.
+
+  The tests check how an MTRR transaction stages memory ranges, and that the
+  variable MTRR settings calculated once for a batch of memory ranges produce
+  the memory types of the batch.  The benchmark suite reports the cost of
+  calculating the variable MTRR settings after each memory range of a batch,
+  the way setting the memory ranges one by one does, against calculating them
+  once for the whole batch, the way an MTRR transaction does.
+
+  The tests of committing an MTRR transaction run on a test processor whose
+  CPUID and MSRs are modeled by MtrrLibUnitTestStubs.c: they check that the
+  variable MTRR settings calculated last are reused, that only the MTRRs that
+  change are written, and that the transaction reports whether the MTRR
+  settings are modified.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <time.h>
+#include <cmocka.h>
+
+#include <Uefi.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/MtrrLib.h>
+#include <Library/UnitTestLib.h>
+
+#include "../MtrrLibInternal.h"
+#include "MtrrLibUnitTest.h"
+
+#define UNIT_TEST_APP_NAME        "MTRR Library Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+//
+// Maximum number of memory ranges of the memory type layouts of the tests
+//
+#define MTRR_TEST_RANGE_CAPACITY          256
+
+//
+// Number of memory layouts of the tests and of the benchmark, and number of
+// memory ranges set on top of the RAM of each layout
+//
+#define MTRR_TEST_LAYOUT_COUNT            64
+#define MTRR_TEST_LAYOUT_RANGE_COUNT      6
+
+//
+// Size of the scratch buffer for the MTRR calculation
+//
+#define MTRR_TEST_SCRATCH_SIZE            SIZE_1MB
+
+//
+// A batch of memory ranges, with the memory type layout it produces
+//
+typedef struct {
+  MTRR_MEMORY_RANGE       Ranges[MTRR_TEST_LAYOUT_RANGE_COUNT + 2];
+  UINTN                   RangeCount;
+  MTRR_MEMORY_RANGE       Layout[MTRR_TEST_RANGE_CAPACITY];
+  UINTN                   LayoutCount;
+} MTRR_TEST_BATCH;
+
+//
+// Memory types of the memory ranges set on top of the RAM
+//
+MTRR_MEMORY_CACHE_TYPE  mMtrrTestTypes[] = {
+  CacheUncacheable,
+  CacheWriteCombining,
+  CacheWriteThrough,
+  CacheWriteProtected
+};
+
+UINT32                  mMtrrTestSeed;
+VOID                    *mMtrrTestScratch;
+
+/**
+  Return the next number of a deterministic pseudo random sequence.
+
+  @return The next pseudo random number.
+**/
+UINT32
+MtrrTestRandom (
+  VOID
+  )
+{
+  mMtrrTestSeed = mMtrrTestSeed * 1103515245 + 12345;
+  return mMtrrTestSeed >> 8;
+}
+
+/**
+  Build a batch of memory ranges like the ones a platform sets: the RAM below
+  and above 4GB is write back, and smaller aligned memory ranges of the other
+  memory types are set in the RAM below 4GB.
+
+  @param[out] Batch  The batch of memory ranges, with the memory type layout
+                     it produces over uncacheable memory.
+**/
+VOID
+MtrrTestBuildBatch (
+  OUT MTRR_TEST_BATCH  *Batch
+  )
+{
+  UINT64               Length;
+  UINT64               BaseAddress;
+  UINTN                Index;
+
+  Batch->RangeCount = 0;
+
+  Batch->Ranges[Batch->RangeCount].BaseAddress = 0;
+  Batch->Ranges[Batch->RangeCount].Length      = (UINT64)(MtrrTestRandom () % 12 + 4) * SIZE_256MB;
+  Batch->Ranges[Batch->RangeCount].Type        = CacheWriteBack;
+  Batch->RangeCount++;
+
+  Batch->Ranges[Batch->RangeCount].BaseAddress = SIZE_4GB;
+  Batch->Ranges[Batch->RangeCount].Length      = (UINT64)(MtrrTestRandom () % 32 + 1) * SIZE_1GB;
+  Batch->Ranges[Batch->RangeCount].Type        = CacheWriteBack;
+  Batch->RangeCount++;
+
+  for (Index = 0; Index < MTRR_TEST_LAYOUT_RANGE_COUNT; Index++) {
+    Length      = LShiftU64 (SIZE_1MB, MtrrTestRandom () % 4 + 4);
+    BaseAddress = SIZE_1GB + (MtrrTestRandom () % (SIZE_2GB / Length)) * Length;
+    Batch->Ranges[Batch->RangeCount].BaseAddress = BaseAddress;
+    Batch->Ranges[Batch->RangeCount].Length      = Length;
+    Batch->Ranges[Batch->RangeCount].Type        = mMtrrTestTypes[MtrrTestRandom () % ARRAY_SIZE (mMtrrTestTypes)];
+    Batch->RangeCount++;
+  }
+
+  Batch->LayoutCount = 1;
+  Batch->Layout[0].BaseAddress = 0;
+  Batch->Layout[0].Length      = LShiftU64 (1, MTRR_TEST_PHYSICAL_ADDRESS_BITS);
+  Batch->Layout[0].Type        = CacheUncacheable;
+  for (Index = 0; Index < Batch->RangeCount; Index++) {
+    MtrrLibSetMemoryType (
+      Batch->Layout, ARRAY_SIZE (Batch->Layout), &Batch->LayoutCount,
+      Batch->Ranges[Index].BaseAddress, Batch->Ranges[Index].Length, Batch->Ranges[Index].Type
+      );
+  }
+}
+
+/**
+  Merge the adjacent memory ranges of the same memory type of a memory type
+  layout.
+
+  @param[in, out] Layout       The memory type layout.
+  @param[in, out] LayoutCount  The number of memory ranges of the layout.
+**/
+VOID
+MtrrTestMergeLayout (
+  IN OUT MTRR_MEMORY_RANGE  *Layout,
+  IN OUT UINTN              *LayoutCount
+  )
+{
+  UINTN                     Index;
+  UINTN                     Count;
+
+  Count = 0;
+  for (Index = 0; Index < *LayoutCount; Index++) {
+    if ((Count != 0) && (Layout[Count - 1].Type == Layout[Index].Type)) {
+      Layout[Count - 1].Length += Layout[Index].Length;
+    } else {
+      CopyMem (&Layout[Count], &Layout[Index], sizeof (Layout[0]));
+      Count++;
+    }
+  }
+  *LayoutCount = Count;
+}
+
+/**
+  Calculate the variable MTRR settings of a memory type layout.
+
+  @param[in]  Layout        The memory type layout.
+  @param[in]  LayoutCount   The number of memory ranges of the layout.
+  @param[out] VariableMtrr  Return the variable MTRR settings.
+  @param[out] MtrrCount     Return the number of variable MTRRs.
+
+  @retval RETURN_SUCCESS           The variable MTRR settings are calculated.
+  @retval RETURN_OUT_OF_RESOURCES  The layout needs more variable MTRRs than
+                                   the processor has.
+**/
+RETURN_STATUS
+MtrrTestSolve (
+  IN  CONST MTRR_MEMORY_RANGE  *Layout,
+  IN  UINTN                    LayoutCount,
+  OUT MTRR_MEMORY_RANGE        *VariableMtrr,
+  OUT UINT32                   *MtrrCount
+  )
+{
+  MTRR_MEMORY_RANGE            Ranges[MTRR_TEST_RANGE_CAPACITY];
+  UINTN                        ScratchSize;
+
+  //
+  // The calculation consumes the memory ranges.
+  //
+  CopyMem (Ranges, Layout, LayoutCount * sizeof (Layout[0]));
+  ScratchSize = MTRR_TEST_SCRATCH_SIZE;
+  return MtrrLibSetMemoryRanges (
+           CacheUncacheable, LShiftU64 (1, MTRR_TEST_PHYSICAL_ADDRESS_BITS - 1),
+           Ranges, LayoutCount,
+           mMtrrTestScratch, &ScratchSize,
+           VariableMtrr, MTRR_NUMBER_OF_VARIABLE_MTRR, MtrrCount
+           );
+}
+
+/**
+  Check how an MTRR transaction stages memory ranges: the memory ranges a new
+  memory range covers are dropped, and a memory range that continues the one
+  staged last with the same memory type extends it.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TransactionShouldMergeStagedRanges (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MTRR_TRANSACTION      *Transaction;
+  MTRR_SETTINGS         Settings;
+  RETURN_STATUS         Status;
+
+  Transaction = AllocatePool (sizeof (*Transaction));
+  UT_ASSERT_NOT_NULL (Transaction);
+
+  MtrrTransactionBegin (Transaction, &Settings);
+  UT_ASSERT_EQUAL ((UINTN)Transaction->MtrrSetting, (UINTN)&Settings);
+  UT_ASSERT_EQUAL (Transaction->RangeCount, 0);
+  UT_ASSERT_FALSE (Transaction->SolutionValid);
+
+  Status = MtrrTransactionAddRange (Transaction, SIZE_1MB, 0, CacheWriteBack);
+  UT_ASSERT_STATUS_EQUAL (Status, RETURN_INVALID_PARAMETER);
+
+  Status = MtrrTransactionAddRange (Transaction, SIZE_1MB, SIZE_1MB, CacheWriteBack);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = MtrrTransactionAddRange (Transaction, SIZE_2MB, SIZE_2MB, CacheWriteBack);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Transaction->RangeCount, 1);
+  UT_ASSERT_EQUAL (Transaction->Ranges[0].BaseAddress, SIZE_1MB);
+  UT_ASSERT_EQUAL (Transaction->Ranges[0].Length, SIZE_1MB + SIZE_2MB);
+
+  //
+  // An overlapping memory range of another memory type is staged after it.
+  //
+  Status = MtrrTransactionAddRange (Transaction, SIZE_2MB, SIZE_4MB, CacheUncacheable);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Transaction->RangeCount, 2);
+
+  //
+  // A memory range covering both replaces them.
+  //
+  Status = MtrrTransactionAddRange (Transaction, 0, SIZE_8MB, CacheWriteThrough);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Transaction->RangeCount, 1);
+  UT_ASSERT_EQUAL (Transaction->Ranges[0].BaseAddress, 0);
+  UT_ASSERT_EQUAL (Transaction->Ranges[0].Length, SIZE_8MB);
+  UT_ASSERT_EQUAL (Transaction->Ranges[0].Type, CacheWriteThrough);
+
+  FreePool (Transaction);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that an MTRR transaction reports when it cannot stage more memory
+  ranges, and keeps the memory ranges staged.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TransactionShouldReportFullStage (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MTRR_TRANSACTION      *Transaction;
+  RETURN_STATUS         Status;
+  UINTN                 Index;
+
+  Transaction = AllocatePool (sizeof (*Transaction));
+  UT_ASSERT_NOT_NULL (Transaction);
+
+  MtrrTransactionBegin (Transaction, NULL);
+  for (Index = 0; Index < MTRR_TRANSACTION_RANGE_COUNT; Index++) {
+    Status = MtrrTransactionAddRange (Transaction, MultU64x32 (SIZE_2MB, (UINT32)Index), SIZE_1MB, CacheWriteCombining);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+  }
+
+  Status = MtrrTransactionAddRange (Transaction, MultU64x32 (SIZE_2MB, (UINT32)Index), SIZE_1MB, CacheWriteCombining);
+  UT_ASSERT_STATUS_EQUAL (Status, RETURN_OUT_OF_RESOURCES);
+  UT_ASSERT_EQUAL (Transaction->RangeCount, MTRR_TRANSACTION_RANGE_COUNT);
+
+  //
+  // A memory range continuing the one staged last still fits.
+  //
+  Status = MtrrTransactionAddRange (Transaction, MultU64x32 (SIZE_2MB, (UINT32)Index - 1) + SIZE_1MB, SIZE_1MB, CacheWriteCombining);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_EQUAL (Transaction->RangeCount, MTRR_TRANSACTION_RANGE_COUNT);
+
+  FreePool (Transaction);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Stage the memory ranges of a platform in an MTRR transaction: the RAM below
+  and above 4GB is write back, and the top of the RAM below 4GB is
+  uncacheable.
+
+  @param[in, out] Transaction  The MTRR transaction.
+
+  @retval RETURN_SUCCESS  The memory ranges are staged.
+  @return The status of the memory range that cannot be staged.
+**/
+RETURN_STATUS
+MtrrTestAddPlatformRanges (
+  IN OUT MTRR_TRANSACTION  *Transaction
+  )
+{
+  RETURN_STATUS            Status;
+
+  Status = MtrrTransactionAddRange (Transaction, 0, SIZE_2GB, CacheWriteBack);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+  Status = MtrrTransactionAddRange (Transaction, SIZE_4GB, SIZE_4GB, CacheWriteBack);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+  return MtrrTransactionAddRange (Transaction, SIZE_2GB - SIZE_16MB, SIZE_16MB, CacheUncacheable);
+}
+
+/**
+  Check that committing an MTRR transaction onto an MTRR setting buffer reuses
+  the MTRR settings calculated last for the same memory ranges, both onto the
+  MTRR settings they were calculated from and onto the MTRR settings they
+  produced, and reports whether the MTRR settings are modified.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TransactionShouldReuseSolution (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MTRR_TRANSACTION      *Transaction;
+  MTRR_SETTINGS         Initial;
+  MTRR_SETTINGS         Settings;
+  MTRR_SETTINGS         Expected;
+  UINTN                 ScratchSize;
+  BOOLEAN               Modified;
+  RETURN_STATUS         Status;
+
+  Transaction = AllocatePool (sizeof (*Transaction));
+  UT_ASSERT_NOT_NULL (Transaction);
+
+  MtrrTestResetProcessor (CacheUncacheable);
+  ZeroMem (&Initial, sizeof (Initial));
+  Initial.MtrrDefType = CacheUncacheable;
+  CopyMem (&Settings, &Initial, sizeof (Settings));
+
+  MtrrTransactionBegin (Transaction, &Settings);
+  Status = MtrrTestAddPlatformRanges (Transaction);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  ScratchSize = MTRR_TEST_SCRATCH_SIZE;
+  Modified    = FALSE;
+  Status = MtrrTransactionCommit (Transaction, mMtrrTestScratch, &ScratchSize, &Modified);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_TRUE (Modified);
+  UT_ASSERT_TRUE (Transaction->SolutionValid);
+  UT_ASSERT_EQUAL (Transaction->RangeCount, 0);
+  UT_ASSERT_NOT_EQUAL (CompareMem (&Settings, &Initial, sizeof (Settings)), 0);
+  CopyMem (&Expected, &Settings, sizeof (Expected));
+
+  //
+  // The same memory ranges committed onto the MTRR settings they produced are
+  // not calculated again, so no scratch buffer is needed, and nothing changes.
+  //
+  Status = MtrrTestAddPlatformRanges (Transaction);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  ScratchSize = 0;
+  Modified    = TRUE;
+  Status = MtrrTransactionCommit (Transaction, NULL, &ScratchSize, &Modified);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_FALSE (Modified);
+  UT_ASSERT_MEM_EQUAL (&Settings, &Expected, sizeof (Settings));
+
+  //
+  // The same memory ranges committed onto the MTRR settings they were
+  // calculated from are not calculated again either.
+  //
+  CopyMem (&Settings, &Initial, sizeof (Settings));
+  Status = MtrrTestAddPlatformRanges (Transaction);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  ScratchSize = 0;
+  Modified    = FALSE;
+  Status = MtrrTransactionCommit (Transaction, NULL, &ScratchSize, &Modified);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_TRUE (Modified);
+  UT_ASSERT_MEM_EQUAL (&Settings, &Expected, sizeof (Settings));
+
+  //
+  // Other memory ranges are calculated again, which needs a scratch buffer.
+  //
+  Status = MtrrTestAddPlatformRanges (Transaction);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  Status = MtrrTransactionAddRange (Transaction, SIZE_1GB, SIZE_2MB, CacheWriteCombining);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  ScratchSize = 0;
+  Modified    = TRUE;
+  Status = MtrrTransactionCommit (Transaction, NULL, &ScratchSize, &Modified);
+  UT_ASSERT_STATUS_EQUAL (Status, RETURN_BUFFER_TOO_SMALL);
+  UT_ASSERT_FALSE (Modified);
+  UT_ASSERT_NOT_EQUAL (ScratchSize, 0);
+  UT_ASSERT_MEM_EQUAL (&Settings, &Expected, sizeof (Settings));
+
+  FreePool (Transaction);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that committing an MTRR transaction onto the MTRRs of the processor
+  writes only the MTRRs that change.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TransactionShouldWriteModifiedMtrrs (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MTRR_TRANSACTION                 *Transaction;
+  UINT64                           *Before;
+  MSR_IA32_MTRR_DEF_TYPE_REGISTER  DefType;
+  UINTN                            ScratchSize;
+  BOOLEAN                          Modified;
+  RETURN_STATUS                    Status;
+  UINT32                           Index;
+  UINT32                           Msr;
+  UINTN                            PairCount;
+
+  Transaction = AllocatePool (sizeof (*Transaction));
+  Before      = AllocatePool (sizeof (mStubMsr));
+  UT_ASSERT_NOT_NULL (Transaction);
+  UT_ASSERT_NOT_NULL (Before);
+
+  MtrrTestResetProcessor (CacheUncacheable);
+  MtrrTransactionBegin (Transaction, NULL);
+  Status = MtrrTestAddPlatformRanges (Transaction);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  ScratchSize = MTRR_TEST_SCRATCH_SIZE;
+  Status = MtrrTransactionCommit (Transaction, mMtrrTestScratch, &ScratchSize, &Modified);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_TRUE (Modified);
+  DefType.Uint64 = mStubMsr[MSR_IA32_MTRR_DEF_TYPE];
+  UT_ASSERT_EQUAL (DefType.Bits.E, 1);
+  UT_ASSERT_EQUAL (DefType.Bits.FE, 1);
+
+  //
+  // The same memory ranges write no MTRR.
+  //
+  ZeroMem (mStubMsrWriteCount, sizeof (mStubMsrWriteCount));
+  Status = MtrrTestAddPlatformRanges (Transaction);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  ScratchSize = MTRR_TEST_SCRATCH_SIZE;
+  Status = MtrrTransactionCommit (Transaction, mMtrrTestScratch, &ScratchSize, &Modified);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_FALSE (Modified);
+  UT_ASSERT_TRUE (IsZeroBuffer (mStubMsrWriteCount, sizeof (mStubMsrWriteCount)));
+
+  //
+  // A memory range above 1MB writes only the variable MTRRs that change, each
+  // once, while the MTRRs are disabled through MTRR_DEF_TYPE.
+  //
+  CopyMem (Before, mStubMsr, sizeof (mStubMsr));
+  ZeroMem (mStubMsrWriteCount, sizeof (mStubMsrWriteCount));
+  Status = MtrrTransactionAddRange (Transaction, SIZE_1GB, SIZE_2MB, CacheWriteThrough);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  ScratchSize = MTRR_TEST_SCRATCH_SIZE;
+  Status = MtrrTransactionCommit (Transaction, mMtrrTestScratch, &ScratchSize, &Modified);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_TRUE (Modified);
+  UT_ASSERT_EQUAL (mStubMsrWriteCount[MSR_IA32_MTRR_DEF_TYPE], 2);
+  UT_ASSERT_EQUAL (mStubMsr[MSR_IA32_MTRR_DEF_TYPE], Before[MSR_IA32_MTRR_DEF_TYPE]);
+
+  for (Msr = MSR_IA32_MTRR_FIX64K_00000; Msr < MSR_IA32_MTRR_DEF_TYPE; Msr++) {
+    UT_ASSERT_EQUAL (mStubMsrWriteCount[Msr], 0);
+  }
+
+  PairCount = 0;
+  for (Index = 0; Index < MTRR_TEST_VARIABLE_MTRR_COUNT; Index++) {
+    Msr = MSR_IA32_MTRR_PHYSBASE0 + (Index << 1);
+    UT_ASSERT_EQUAL (mStubMsrWriteCount[Msr], mStubMsrWriteCount[Msr + 1]);
+    UT_ASSERT_TRUE (mStubMsrWriteCount[Msr] <= 1);
+    if (mStubMsrWriteCount[Msr] != 0) {
+      UT_ASSERT_TRUE ((mStubMsr[Msr] != Before[Msr]) || (mStubMsr[Msr + 1] != Before[Msr + 1]));
+      PairCount++;
+    }
+  }
+  UT_ASSERT_NOT_EQUAL (PairCount, 0);
+  UT_ASSERT_EQUAL (MtrrGetMemoryAttribute (SIZE_1GB), CacheWriteThrough);
+
+  FreePool (Before);
+  FreePool (Transaction);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that committing an MTRR transaction onto the MTRRs of the processor
+  does not write them when the memory ranges are already in effect, even though
+  the fixed MTRRs are disabled.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+TransactionShouldKeepMtrrsInEffect (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MTRR_TRANSACTION                 *Transaction;
+  MSR_IA32_MTRR_DEF_TYPE_REGISTER  DefType;
+  UINTN                            ScratchSize;
+  BOOLEAN                          Modified;
+  RETURN_STATUS                    Status;
+
+  Transaction = AllocatePool (sizeof (*Transaction));
+  UT_ASSERT_NOT_NULL (Transaction);
+
+  DefType.Uint64    = 0;
+  DefType.Bits.Type = CacheWriteBack;
+  DefType.Bits.E    = 1;
+  MtrrTestResetProcessor (DefType.Uint64);
+
+  MtrrTransactionBegin (Transaction, NULL);
+  Status = MtrrTransactionAddRange (Transaction, SIZE_1GB, SIZE_1GB, CacheWriteBack);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  ScratchSize = MTRR_TEST_SCRATCH_SIZE;
+  Modified    = TRUE;
+  Status = MtrrTransactionCommit (Transaction, mMtrrTestScratch, &ScratchSize, &Modified);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_FALSE (Modified);
+  UT_ASSERT_TRUE (IsZeroBuffer (mStubMsrWriteCount, sizeof (mStubMsrWriteCount)));
+  UT_ASSERT_EQUAL (mStubMsr[MSR_IA32_MTRR_DEF_TYPE], DefType.Uint64);
+
+  FreePool (Transaction);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Check that the variable MTRR settings calculated once for a batch of memory
+  ranges produce the memory type layout of the batch.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+BatchSolutionShouldProduceLayout (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MTRR_TEST_BATCH       *Batch;
+  MTRR_MEMORY_RANGE     VariableMtrr[MTRR_NUMBER_OF_VARIABLE_MTRR];
+  UINT32                MtrrCount;
+  MTRR_MEMORY_RANGE     *Actual;
+  UINTN                 ActualCount;
+  UINTN                 Layout;
+  RETURN_STATUS         Status;
+
+  Batch  = AllocatePool (sizeof (*Batch));
+  Actual = AllocatePool (MTRR_TEST_RANGE_CAPACITY * sizeof (*Actual));
+  UT_ASSERT_NOT_NULL (Batch);
+  UT_ASSERT_NOT_NULL (Actual);
+
+  mMtrrTestSeed = 1;
+  for (Layout = 0; Layout < MTRR_TEST_LAYOUT_COUNT; Layout++) {
+    MtrrTestBuildBatch (Batch);
+
+    Status = MtrrTestSolve (Batch->Layout, Batch->LayoutCount, VariableMtrr, &MtrrCount);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+
+    ActualCount = 1;
+    Actual[0].BaseAddress = 0;
+    Actual[0].Length      = LShiftU64 (1, MTRR_TEST_PHYSICAL_ADDRESS_BITS);
+    Actual[0].Type        = CacheUncacheable;
+    Status = MtrrLibApplyVariableMtrrs (VariableMtrr, MtrrCount, Actual, MTRR_TEST_RANGE_CAPACITY, &ActualCount);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+
+    MtrrTestMergeLayout (Batch->Layout, &Batch->LayoutCount);
+    MtrrTestMergeLayout (Actual, &ActualCount);
+    UT_ASSERT_EQUAL (ActualCount, Batch->LayoutCount);
+    UT_ASSERT_MEM_EQUAL (Actual, Batch->Layout, ActualCount * sizeof (*Actual));
+  }
+
+  FreePool (Actual);
+  FreePool (Batch);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Report the cost of calculating the variable MTRR settings after each memory
+  range of a batch, against calculating them once for the whole batch.
+
+  @param[in]  Context    Unused.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  The test failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+SolverCost (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  MTRR_TEST_BATCH       *Batch;
+  MTRR_MEMORY_RANGE     VariableMtrr[MTRR_NUMBER_OF_VARIABLE_MTRR];
+  UINT32                MtrrCount;
+  MTRR_MEMORY_RANGE     *Working;
+  UINTN                 WorkingCount;
+  UINTN                 Layout;
+  UINTN                 Index;
+  UINTN                 Solved;
+  RETURN_STATUS         Status;
+  clock_t               Start;
+  clock_t               OneByOne;
+  clock_t               Batched;
+
+  Batch   = AllocatePool (sizeof (*Batch));
+  Working = AllocatePool (MTRR_TEST_RANGE_CAPACITY * sizeof (*Working));
+  UT_ASSERT_NOT_NULL (Batch);
+  UT_ASSERT_NOT_NULL (Working);
+
+  OneByOne = 0;
+  Batched  = 0;
+  Solved   = 0;
+  mMtrrTestSeed = 1;
+  for (Layout = 0; Layout < MTRR_TEST_LAYOUT_COUNT; Layout++) {
+    MtrrTestBuildBatch (Batch);
+
+    //
+    // Set the memory ranges one by one: each one is applied to the memory type
+    // layout the current variable MTRRs produce, and the variable MTRRs are
+    // calculated again.
+    //
+    Start     = clock ();
+    MtrrCount = 0;
+    for (Index = 0; Index < Batch->RangeCount; Index++) {
+      WorkingCount = 1;
+      Working[0].BaseAddress = 0;
+      Working[0].Length      = LShiftU64 (1, MTRR_TEST_PHYSICAL_ADDRESS_BITS);
+      Working[0].Type        = CacheUncacheable;
+      Status = MtrrLibApplyVariableMtrrs (VariableMtrr, MtrrCount, Working, MTRR_TEST_RANGE_CAPACITY, &WorkingCount);
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+      MtrrLibSetMemoryType (
+        Working, MTRR_TEST_RANGE_CAPACITY, &WorkingCount,
+        Batch->Ranges[Index].BaseAddress, Batch->Ranges[Index].Length, Batch->Ranges[Index].Type
+        );
+      Status = MtrrTestSolve (Working, WorkingCount, VariableMtrr, &MtrrCount);
+      UT_ASSERT_NOT_EFI_ERROR (Status);
+      Solved++;
+    }
+    OneByOne += clock () - Start;
+
+    //
+    // Set the memory ranges in a batch.
+    //
+    Start = clock ();
+    Status = MtrrTestSolve (Batch->Layout, Batch->LayoutCount, VariableMtrr, &MtrrCount);
+    UT_ASSERT_NOT_EFI_ERROR (Status);
+    Batched += clock () - Start;
+  }
+
+  UT_LOG_INFO (
+    "%d batches of %d ranges: %d us one by one (%d calculations), %d us batched\n",
+    MTRR_TEST_LAYOUT_COUNT,
+    MTRR_TEST_LAYOUT_RANGE_COUNT + 2,
+    (UINT32)((UINT64)OneByOne * 1000000 / CLOCKS_PER_SEC),
+    (UINT32)Solved,
+    (UINT32)((UINT64)Batched * 1000000 / CLOCKS_PER_SEC)
+    );
+  DEBUG ((
+    DEBUG_INFO,
+    "%d batches of %d ranges: %d us one by one (%d calculations), %d us batched\n",
+    MTRR_TEST_LAYOUT_COUNT,
+    MTRR_TEST_LAYOUT_RANGE_COUNT + 2,
+    (UINT32)((UINT64)OneByOne * 1000000 / CLOCKS_PER_SEC),
+    (UINT32)Solved,
+    (UINT32)((UINT64)Batched * 1000000 / CLOCKS_PER_SEC)
+    ));
+
+  FreePool (Working);
+  FreePool (Batch);
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the MTRR
+  library and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      TransactionTests;
+  UNIT_TEST_SUITE_HANDLE      BenchmarkTests;
+
+  Framework = NULL;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  mMtrrTestScratch = AllocatePool (MTRR_TEST_SCRATCH_SIZE);
+  if (mMtrrTestScratch == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&TransactionTests, Framework, "MTRR Transaction Tests", "MtrrLib.Transaction", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for TransactionTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (TransactionTests, "Transaction should merge the staged ranges", "MergeStagedRanges", TransactionShouldMergeStagedRanges, NULL, NULL, NULL);
+  AddTestCase (TransactionTests, "Transaction should report a full stage", "FullStage", TransactionShouldReportFullStage, NULL, NULL, NULL);
+  AddTestCase (TransactionTests, "Transaction should reuse the last solution", "ReuseSolution", TransactionShouldReuseSolution, NULL, NULL, NULL);
+  AddTestCase (TransactionTests, "Transaction should write only the modified MTRRs", "WriteModifiedMtrrs", TransactionShouldWriteModifiedMtrrs, NULL, NULL, NULL);
+  AddTestCase (TransactionTests, "Transaction should keep the MTRRs in effect", "KeepMtrrsInEffect", TransactionShouldKeepMtrrsInEffect, NULL, NULL, NULL);
+  AddTestCase (TransactionTests, "Batch solution should produce the memory type layout", "BatchSolution", BatchSolutionShouldProduceLayout, NULL, NULL, NULL);
+
+  Status = CreateUnitTestSuite (&BenchmarkTests, Framework, "MTRR Benchmarks", "MtrrLib.Benchmark", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for BenchmarkTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (BenchmarkTests, "MTRR calculation cost, one by one and batched", "SolverCost", SolverCost, NULL, NULL, NULL);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+  FreePool (mMtrrTestScratch);
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
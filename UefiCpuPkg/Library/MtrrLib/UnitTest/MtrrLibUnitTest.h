@@ -0,0 +1,49 @@
+/** @file
+  Definitions shared by the host based unit tests of the MTRR library and the
+  stand-ins of the processor services.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MTRR_LIB_UNIT_TEST_H_
+#define _MTRR_LIB_UNIT_TEST_H_
+
+#include <Uefi.h>
+#include <Register/Intel/Msr.h>
+
+//
+// Physical address width of the test processor
+//
+#define MTRR_TEST_PHYSICAL_ADDRESS_BITS   36
+
+//
+// Number of variable MTRRs of the test processor
+//
+#define MTRR_TEST_VARIABLE_MTRR_COUNT     10
+
+//
+// Number of MSRs of the test processor, covering all the MTRRs
+//
+#define MTRR_TEST_MSR_COUNT               (MSR_IA32_MTRR_DEF_TYPE + 1)
+
+//
+// MSRs of the test processor, and number of times each MSR is written
+//
+extern UINT64  mStubMsr[MTRR_TEST_MSR_COUNT];
+extern UINTN   mStubMsrWriteCount[MTRR_TEST_MSR_COUNT];
+
+/**
+  Reset the MSRs of the test processor: it has MTRR_TEST_VARIABLE_MTRR_COUNT
+  variable MTRRs, the fixed MTRRs and write combining, and all the MTRRs are
+  cleared.
+
+  @param[in] DefType  The value of MSR_IA32_MTRR_DEF_TYPE.
+**/
+VOID
+MtrrTestResetProcessor (
+  IN UINT64  DefType
+  );
+
+#endif
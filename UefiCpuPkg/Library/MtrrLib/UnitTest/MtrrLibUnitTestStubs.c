@@ -0,0 +1,272 @@
+/** @file
+  Host based stand-ins for the processor services that the MTRR library
+  depends on, for the tests of the MTRR library.
+
+  The stand-ins model a processor with MTRRs: CPUID reports the MTRR feature
+  and the physical address width of the tests, and the MSRs are kept in a
+  table that records how many times each MSR is written.  The unit test INF
+  renames the processor services the MTRR library calls to the stand-ins, so
+  that they do not collide with the ones of BaseLib and CpuLib.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <Uefi.h>
+#include <Register/Intel/Cpuid.h>
+#include <Register/Intel/Msr.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/CpuLib.h>
+#include <Library/DebugLib.h>
+
+#include "MtrrLibUnitTest.h"
+
+//
+// MSRs of the test processor, and number of times each MSR is written
+//
+UINT64    mStubMsr[MTRR_TEST_MSR_COUNT];
+UINTN     mStubMsrWriteCount[MTRR_TEST_MSR_COUNT];
+
+UINTN     mStubCr4;
+
+/**
+  Reset the MSRs of the test processor: it has MTRR_TEST_VARIABLE_MTRR_COUNT
+  variable MTRRs, the fixed MTRRs and write combining, and all the MTRRs are
+  cleared.
+
+  @param[in] DefType  The value of MSR_IA32_MTRR_DEF_TYPE.
+**/
+VOID
+MtrrTestResetProcessor (
+  IN UINT64                     DefType
+  )
+{
+  MSR_IA32_MTRRCAP_REGISTER     MtrrCap;
+
+  ZeroMem (mStubMsr, sizeof (mStubMsr));
+  ZeroMem (mStubMsrWriteCount, sizeof (mStubMsrWriteCount));
+
+  MtrrCap.Uint64    = 0;
+  MtrrCap.Bits.VCNT = MTRR_TEST_VARIABLE_MTRR_COUNT;
+  MtrrCap.Bits.FIX  = 1;
+  MtrrCap.Bits.WC   = 1;
+  mStubMsr[MSR_IA32_MTRRCAP]       = MtrrCap.Uint64;
+  mStubMsr[MSR_IA32_MTRR_DEF_TYPE] = DefType;
+}
+
+/**
+  Retrieves CPUID information of the test processor.
+
+  @param[in]  Index  The 32-bit value to load into EAX prior to invoking the CPUID instruction.
+  @param[out] Eax    The pointer to the 32-bit EAX value returned by the CPUID instruction.
+  @param[out] Ebx    The pointer to the 32-bit EBX value returned by the CPUID instruction.
+  @param[out] Ecx    The pointer to the 32-bit ECX value returned by the CPUID instruction.
+  @param[out] Edx    The pointer to the 32-bit EDX value returned by the CPUID instruction.
+
+  @return Index.
+**/
+UINT32
+EFIAPI
+AsmCpuid (
+  IN      UINT32                    Index,
+  OUT     UINT32                    *Eax,  OPTIONAL
+  OUT     UINT32                    *Ebx,  OPTIONAL
+  OUT     UINT32                    *Ecx,  OPTIONAL
+  OUT     UINT32                    *Edx   OPTIONAL
+  )
+{
+  CPUID_VERSION_INFO_EDX            VersionInfoEdx;
+  CPUID_VIR_PHY_ADDRESS_SIZE_EAX    VirPhyAddressSize;
+  UINT32                            Value[4];
+
+  ZeroMem (Value, sizeof (Value));
+  switch (Index) {
+  case CPUID_VERSION_INFO:
+    VersionInfoEdx.Uint32    = 0;
+    VersionInfoEdx.Bits.MTRR = 1;
+    Value[3] = VersionInfoEdx.Uint32;
+    break;
+
+  case CPUID_EXTENDED_FUNCTION:
+    Value[0] = CPUID_VIR_PHY_ADDRESS_SIZE;
+    break;
+
+  case CPUID_VIR_PHY_ADDRESS_SIZE:
+    VirPhyAddressSize.Uint32                   = 0;
+    VirPhyAddressSize.Bits.PhysicalAddressBits = MTRR_TEST_PHYSICAL_ADDRESS_BITS;
+    Value[0] = VirPhyAddressSize.Uint32;
+    break;
+
+  default:
+    break;
+  }
+
+  if (Eax != NULL) {
+    *Eax = Value[0];
+  }
+  if (Ebx != NULL) {
+    *Ebx = Value[1];
+  }
+  if (Ecx != NULL) {
+    *Ecx = Value[2];
+  }
+  if (Edx != NULL) {
+    *Edx = Value[3];
+  }
+  return Index;
+}
+
+/**
+  Returns an MSR of the test processor.
+
+  @param[in]  MsrIndex  The MSR to read.
+
+  @return The value of the MSR.
+**/
+UINT64
+EFIAPI
+AsmReadMsr64 (
+  IN UINT32  MsrIndex
+  )
+{
+  ASSERT (MsrIndex < MTRR_TEST_MSR_COUNT);
+  return mStubMsr[MsrIndex];
+}
+
+/**
+  Writes an MSR of the test processor, and counts the write.
+
+  @param[in]  MsrIndex  The MSR to write.
+  @param[in]  Value     The value to write to the MSR.
+
+  @return Value
+**/
+UINT64
+EFIAPI
+AsmWriteMsr64 (
+  IN UINT32  MsrIndex,
+  IN UINT64  Value
+  )
+{
+  ASSERT (MsrIndex < MTRR_TEST_MSR_COUNT);
+  mStubMsr[MsrIndex] = Value;
+  mStubMsrWriteCount[MsrIndex]++;
+  return Value;
+}
+
+/**
+  Reads an MSR of the test processor, performs a bitwise AND followed by a
+  bitwise OR, and writes the result back to the MSR.
+
+  @param[in]  MsrIndex  The MSR to write.
+  @param[in]  AndData   The value to AND with the read value from the MSR.
+  @param[in]  OrData    The value to OR with the result of the AND operation.
+
+  @return The value written back to the MSR.
+**/
+UINT64
+EFIAPI
+AsmMsrAndThenOr64 (
+  IN UINT32  MsrIndex,
+  IN UINT64  AndData,
+  IN UINT64  OrData
+  )
+{
+  return AsmWriteMsr64 (MsrIndex, (AsmReadMsr64 (MsrIndex) & AndData) | OrData);
+}
+
+/**
+  Reads CR4 of the test processor.
+
+  @return The value of CR4.
+**/
+UINTN
+EFIAPI
+AsmReadCr4 (
+  VOID
+  )
+{
+  return mStubCr4;
+}
+
+/**
+  Writes CR4 of the test processor.
+
+  @param[in]  Cr4   The value to write to CR4.
+
+  @return Cr4
+**/
+UINTN
+EFIAPI
+AsmWriteCr4 (
+  UINTN  Cr4
+  )
+{
+  mStubCr4 = Cr4;
+  return Cr4;
+}
+
+/**
+  The test processor has no cache to disable.
+**/
+VOID
+EFIAPI
+AsmDisableCache (
+  VOID
+  )
+{
+}
+
+/**
+  The test processor has no cache to enable.
+**/
+VOID
+EFIAPI
+AsmEnableCache (
+  VOID
+  )
+{
+}
+
+/**
+  The test processor has no TLB to flush.
+**/
+VOID
+EFIAPI
+CpuFlushTlb (
+  VOID
+  )
+{
+}
+
+/**
+  The tests do not take interrupts.
+
+  @retval FALSE  Interrupts were disabled.
+**/
+BOOLEAN
+EFIAPI
+SaveAndDisableInterrupts (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+/**
+  The tests do not take interrupts.
+
+  @param[in]  InterruptState  Unused.
+
+  @return InterruptState
+**/
+BOOLEAN
+EFIAPI
+SetInterruptState (
+  IN BOOLEAN  InterruptState
+  )
+{
+  return InterruptState;
+}
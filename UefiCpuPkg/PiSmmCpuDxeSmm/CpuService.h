@@ -144,6 +144,30 @@ SmmRegisterExceptionHandler (
   IN EFI_CPU_INTERRUPT_HANDLER     InterruptHandler
   );
 
+//
+// SMM CPU Rendezvous Protocol function prototypes.
+//
+
+/**
+  Wait for all the processors to enter SMM, except the ones that are blocked
+  or whose SMIs are disabled, and keep them in SMM until the SMI handlers return.
+
+  @param[in] This                 A pointer to the EDKII_SMM_CPU_RENDEZVOUS_PROTOCOL instance.
+  @param[in] BlockingMode         TRUE to wait until all the processors enter SMM.
+                                  FALSE to wait no longer than the SMM AP sync timeout.
+
+  @retval EFI_SUCCESS             All the processors, except the ones that are blocked
+                                  or whose SMIs are disabled, are in SMM.
+  @retval EFI_TIMEOUT             Some processors did not enter SMM before the timeout.
+  @retval EFI_DEVICE_ERROR        The calling processor is not the BSP in SMM.
+**/
+EFI_STATUS
+EFIAPI
+SmmCpuRendezvous (
+  IN CONST EDKII_SMM_CPU_RENDEZVOUS_PROTOCOL  *This,
+  IN       BOOLEAN                            BlockingMode
+  );
+
 //
 // Internal function prototypes
 //
@@ -161,7 +185,7 @@ SmmCpuUpdate (
 /**
   Initialize SMM CPU Services.
 
-  It installs EFI SMM CPU Services Protocol.
+  It installs EFI SMM CPU Services Protocol and EDKII SMM CPU Rendezvous Protocol.
 
   @param ImageHandle The firmware allocated handle for the EFI image.
 
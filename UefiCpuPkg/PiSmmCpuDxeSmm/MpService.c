@@ -22,6 +22,10 @@ UINTN                                       mSemaphoreSize;
 SPIN_LOCK                                   *mPFLock = NULL;
 SMM_CPU_SYNC_MODE                           mCpuSmmSyncMode;
 BOOLEAN                                     mMachineCheckSupported = FALSE;
+//
+// Ticks the BSP waited for the APs to rendezvous in the current SMI
+//
+UINT64                                      mSmiRendezvousTicks;
 
 /**
   Performs an atomic compare exchange operation to get semaphore.
@@ -106,6 +110,64 @@ LockdownSemaphore (
   return Value;
 }
 
+/**
+  Signal the BSP the arrival of an AP at a synchronization point.
+
+  When PcdCpuSmmHierarchicalSync is TRUE, the AP signals the semaphore of its
+  package, so that only the APs of the same package contend for it, and the BSP
+  collects the signals of each package at once.
+
+  @param   CpuIndex         AP processor Index
+
+**/
+VOID
+SignalBsp (
+  IN      UINTN                     CpuIndex
+  )
+{
+  if (FeaturePcdGet (PcdCpuSmmHierarchicalSync)) {
+    ReleaseSemaphore (mSmmMpSyncData->CpuData[CpuIndex].PackageRun);
+  } else {
+    ReleaseSemaphore (mSmmMpSyncData->CpuData[mSmmMpSyncData->BspIndex].Run);
+  }
+}
+
+/**
+  Wait for the APs to signal the semaphores of their packages.
+
+  @param   NumberOfAPs      AP number
+
+**/
+VOID
+WaitForAllPackages (
+  IN      UINTN                     NumberOfAPs
+  )
+{
+  UINTN                             PackageIndex;
+  volatile UINT32                   *PackageRun;
+  UINT32                            Value;
+  UINT32                            Count;
+
+  while (NumberOfAPs > 0) {
+    for (PackageIndex = 0; PackageIndex < mSmmMpSyncData->PackageCount && NumberOfAPs > 0; PackageIndex++) {
+      PackageRun = (volatile UINT32 *)((UINTN)mSmmMpSyncData->PackageRun + mSemaphoreSize * PackageIndex);
+      Value      = *PackageRun;
+      if (Value == 0) {
+        continue;
+      }
+      //
+      // Take the signals of the package at once, but no more than expected,
+      // as WaitForSemaphore() would do one by one.
+      //
+      Count = (UINT32)MIN (Value, NumberOfAPs);
+      if (InterlockedCompareExchange32 ((UINT32 *)PackageRun, Value, Value - Count) == Value) {
+        NumberOfAPs -= Count;
+      }
+    }
+    CpuPause ();
+  }
+}
+
 /**
   Wait all APs to performs an atomic compare exchange operation to release semaphore.
 
@@ -118,10 +180,24 @@ WaitForAllAPs (
   )
 {
   UINTN                             BspIndex;
+  UINT64                            Timer;
 
-  BspIndex = mSmmMpSyncData->BspIndex;
-  while (NumberOfAPs-- > 0) {
-    WaitForSemaphore (mSmmMpSyncData->CpuData[BspIndex].Run);
+  Timer = 0;
+  if (FeaturePcdGet (PcdCpuSmmProfileEnable)) {
+    Timer = StartSyncTimer ();
+  }
+
+  if (FeaturePcdGet (PcdCpuSmmHierarchicalSync)) {
+    WaitForAllPackages (NumberOfAPs);
+  } else {
+    BspIndex = mSmmMpSyncData->BspIndex;
+    while (NumberOfAPs-- > 0) {
+      WaitForSemaphore (mSmmMpSyncData->CpuData[BspIndex].Run);
+    }
+  }
+
+  if (FeaturePcdGet (PcdCpuSmmProfileEnable)) {
+    mSmiRendezvousTicks += GetSyncTimerElapsed (Timer);
   }
 }
 
@@ -254,9 +330,15 @@ SmmWaitForApArrival (
   UINTN                             Index;
   BOOLEAN                           LmceEn;
   BOOLEAN                           LmceSignal;
+  UINT64                            RendezvousTimer;
 
   ASSERT (*mSmmMpSyncData->Counter <= mNumberOfCpus);
 
+  RendezvousTimer = 0;
+  if (FeaturePcdGet (PcdCpuSmmProfileEnable)) {
+    RendezvousTimer = StartSyncTimer ();
+  }
+
   LmceEn     = FALSE;
   LmceSignal = FALSE;
   if (mMachineCheckSupported) {
@@ -322,6 +404,10 @@ SmmWaitForApArrival (
     }
   }
 
+  if (FeaturePcdGet (PcdCpuSmmProfileEnable)) {
+    mSmiRendezvousTicks += GetSyncTimerElapsed (RendezvousTimer);
+  }
+
   return;
 }
 
@@ -473,9 +559,12 @@ BSPHandler (
   UINTN                             ApCount;
   BOOLEAN                           ClearTopLevelSmiResult;
   UINTN                             PresentCount;
+  UINT64                            Timer;
 
   ASSERT (CpuIndex == mSmmMpSyncData->BspIndex);
   ApCount = 0;
+  Timer   = 0;
+  mSmiRendezvousTicks = 0;
 
   //
   // Flag BSP's presence
@@ -606,6 +695,9 @@ BSPHandler (
     //
     // Make sure all APs have their Present flag set
     //
+    if (FeaturePcdGet (PcdCpuSmmProfileEnable)) {
+      Timer = StartSyncTimer ();
+    }
     while (TRUE) {
       PresentCount = 0;
       for (Index = 0; Index < mMaxNumberOfCpus; Index++) {
@@ -617,6 +709,9 @@ BSPHandler (
         break;
       }
     }
+    if (FeaturePcdGet (PcdCpuSmmProfileEnable)) {
+      mSmiRendezvousTicks += GetSyncTimerElapsed (Timer);
+    }
   }
 
   //
@@ -675,6 +770,10 @@ BSPHandler (
   //
   WaitForAllAPs (ApCount);
 
+  if (FeaturePcdGet (PcdCpuSmmProfileEnable)) {
+    SmmProfileRecordRendezvousTime (mSmiRendezvousTicks);
+  }
+
   //
   // Reset the tokens buffer.
   //
@@ -687,6 +786,8 @@ BSPHandler (
     mSmmMpSyncData->BspIndex = (UINT32)-1;
   }
 
+  mSmmMpSyncData->RendezvousRequested = FALSE;
+
   //
   // Allow APs to check in from this point on
   //
@@ -694,6 +795,38 @@ BSPHandler (
   *mSmmMpSyncData->AllCpusInSync = FALSE;
 }
 
+/**
+  Withdraw the arrival of an AP in SMM, so that it leaves SMM without
+  synchronizing with the BSP.
+
+  The arrival cannot be withdrawn once the BSP has locked the counter down,
+  because the BSP then waits for the AP.
+
+  @retval TRUE   The arrival of the AP is withdrawn.
+  @retval FALSE  The BSP has locked the counter down.
+
+**/
+BOOLEAN
+LeaveSmiEarly (
+  VOID
+  )
+{
+  UINT32                            Value;
+
+  do {
+    Value = *mSmmMpSyncData->Counter;
+    if (Value == (UINT32)-1) {
+      return FALSE;
+    }
+    ASSERT (Value > 1);
+  } while (InterlockedCompareExchange32 (
+             (UINT32*)mSmmMpSyncData->Counter,
+             Value,
+             Value - 1
+             ) != Value);
+  return TRUE;
+}
+
 /**
   SMI handler for AP.
 
@@ -772,6 +905,16 @@ APHandler (
   BspIndex = mSmmMpSyncData->BspIndex;
   ASSERT (CpuIndex != BspIndex);
 
+  if (SyncMode == SmmCpuSyncModeOnDemandAp && !SmmCpuFeaturesNeedConfigureMtrrs() &&
+      !mSmmMpSyncData->RendezvousRequested && LeaveSmiEarly ()) {
+    //
+    // No SMI handler has asked for the APs in this SMI run, so leave SMM
+    // without waiting for the BSP. An SMI handler asking for the APs later
+    // brings this AP back with an SMI IPI.
+    //
+    return;
+  }
+
   //
   // Mark this processor's presence
   //
@@ -781,7 +924,7 @@ APHandler (
     //
     // Notify BSP of arrival at this point
     //
-    ReleaseSemaphore (mSmmMpSyncData->CpuData[BspIndex].Run);
+    SignalBsp (CpuIndex);
   }
 
   if (SmmCpuFeaturesNeedConfigureMtrrs()) {
@@ -798,7 +941,7 @@ APHandler (
     //
     // Signal BSP the completion of this AP
     //
-    ReleaseSemaphore (mSmmMpSyncData->CpuData[BspIndex].Run);
+    SignalBsp (CpuIndex);
 
     //
     // Wait for BSP's signal to program MTRRs
@@ -813,7 +956,7 @@ APHandler (
     //
     // Signal BSP the completion of this AP
     //
-    ReleaseSemaphore (mSmmMpSyncData->CpuData[BspIndex].Run);
+    SignalBsp (CpuIndex);
   }
 
   while (TRUE) {
@@ -860,7 +1003,7 @@ APHandler (
     //
     // Notify BSP the readiness of this AP to program MTRRs
     //
-    ReleaseSemaphore (mSmmMpSyncData->CpuData[BspIndex].Run);
+    SignalBsp (CpuIndex);
 
     //
     // Wait for the signal from BSP to program MTRRs
@@ -877,7 +1020,7 @@ APHandler (
   //
   // Notify BSP the readiness of this AP to Reset states/semaphore for this processor
   //
-  ReleaseSemaphore (mSmmMpSyncData->CpuData[BspIndex].Run);
+  SignalBsp (CpuIndex);
 
   //
   // Wait for the signal from BSP to Reset states/semaphore for this processor
@@ -892,7 +1035,7 @@ APHandler (
   //
   // Notify BSP the readiness of this AP to exit SMM
   //
-  ReleaseSemaphore (mSmmMpSyncData->CpuData[BspIndex].Run);
+  SignalBsp (CpuIndex);
 
 }
 
@@ -1252,7 +1395,10 @@ InternalSmmStartupThisAp (
     return EFI_INVALID_PARAMETER;
   }
   if (!(*(mSmmMpSyncData->CpuData[CpuIndex].Present))) {
-    if (mSmmMpSyncData->EffectiveSyncMode == SmmCpuSyncModeTradition) {
+    SmmRendezvousOnDemand ();
+  }
+  if (!(*(mSmmMpSyncData->CpuData[CpuIndex].Present))) {
+    if (mSmmMpSyncData->EffectiveSyncMode != SmmCpuSyncModeRelaxedAp) {
       DEBUG((DEBUG_ERROR, "!mSmmMpSyncData->CpuData[%d].Present\n", CpuIndex));
     }
     return EFI_INVALID_PARAMETER;
@@ -1344,6 +1490,8 @@ InternalSmmStartupAllAPs (
     return EFI_INVALID_PARAMETER;
   }
 
+  SmmRendezvousOnDemand ();
+
   CpuCount = 0;
   for (Index = 0; Index < mMaxNumberOfCpus; Index++) {
     if (IsPresentAp (Index)) {
@@ -1767,6 +1915,88 @@ Exit:
   RestoreCr2 (Cr2);
 }
 
+/**
+  Wait for all the processors to enter SMM, except the ones that are blocked
+  or whose SMIs are disabled, and keep them in SMM until the SMI handlers return.
+
+  @param[in] BlockingMode         TRUE to wait until all the processors enter SMM.
+                                  FALSE to wait no longer than the SMM AP sync timeout.
+
+  @retval EFI_SUCCESS             All the processors, except the ones that are blocked
+                                  or whose SMIs are disabled, are in SMM.
+  @retval EFI_TIMEOUT             Some processors did not enter SMM before the timeout.
+  @retval EFI_DEVICE_ERROR        The calling processor is not the BSP in SMM.
+**/
+EFI_STATUS
+SmmWaitForAllProcessor (
+  IN BOOLEAN                    BlockingMode
+  )
+{
+  UINTN                         Index;
+
+  if (!(*mSmmMpSyncData->InsideSmm) ||
+      GetApicId () != (UINT32)gSmmCpuPrivate->ProcessorInfo[mSmmMpSyncData->BspIndex].ProcessorId) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  if (*mSmmMpSyncData->AllCpusInSync) {
+    //
+    // The APs were gathered before the SMI handlers ran, and the APs that
+    // arrive later are excluded.
+    //
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Keep the APs that enter SMM from now on until the SMI handlers return,
+  // and bring back the ones that left SMM early.
+  //
+  mSmmMpSyncData->RendezvousRequested = TRUE;
+  for (Index = 0; Index < mMaxNumberOfCpus; Index++) {
+    if (!(*(mSmmMpSyncData->CpuData[Index].Present)) && gSmmCpuPrivate->ProcessorInfo[Index].ProcessorId != INVALID_APIC_ID) {
+      SendSmiIpi ((UINT32)gSmmCpuPrivate->ProcessorInfo[Index].ProcessorId);
+    }
+  }
+
+  SmmWaitForApArrival ();
+
+  if (BlockingMode) {
+    while (!AllCpusInSmmWithExceptions (ARRIVAL_EXCEPTION_BLOCKED | ARRIVAL_EXCEPTION_SMI_DISABLED)) {
+      CpuPause ();
+    }
+  }
+
+  if (!AllCpusInSmmWithExceptions (ARRIVAL_EXCEPTION_BLOCKED | ARRIVAL_EXCEPTION_SMI_DISABLED)) {
+    return EFI_TIMEOUT;
+  }
+  return EFI_SUCCESS;
+}
+
+/**
+  In the on-demand AP sync mode, bring the APs into SMM before a procedure is
+  scheduled on them, unless an SMI handler already asked for them in this SMI
+  run.  The APs that do not enter SMM before the SMM AP sync timeout are left
+  out of the procedure.
+
+**/
+VOID
+SmmRendezvousOnDemand (
+  VOID
+  )
+{
+  EFI_STATUS                    Status;
+
+  if (mSmmMpSyncData->EffectiveSyncMode != SmmCpuSyncModeOnDemandAp ||
+      mSmmMpSyncData->RendezvousRequested) {
+    return;
+  }
+
+  Status = SmmWaitForAllProcessor (FALSE);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "SMM CPU rendezvous on demand - %r\n", Status));
+  }
+}
+
 /**
   Allocate buffer for SpinLock and Wrapper function buffer.
 
@@ -1833,6 +2063,8 @@ InitializeSmmCpuSemaphores (
   mSmmCpuSemaphores.SemaphoreCpu.Run     = (UINT32 *)SemaphoreAddr;
   SemaphoreAddr += ProcessorCount * SemaphoreSize;
   mSmmCpuSemaphores.SemaphoreCpu.Present = (BOOLEAN *)SemaphoreAddr;
+  SemaphoreAddr += ProcessorCount * SemaphoreSize;
+  mSmmCpuSemaphores.SemaphoreCpu.PackageRun = (UINT32 *)SemaphoreAddr;
 
   mPFLock                       = mSmmCpuSemaphores.SemaphoreGlobal.PFLock;
   mConfigSmmCodeAccessCheckLock = mSmmCpuSemaphores.SemaphoreGlobal.CodeAccessCheckLock;
@@ -1840,6 +2072,55 @@ InitializeSmmCpuSemaphores (
   mSemaphoreSize = SemaphoreSize;
 }
 
+/**
+  Assign each processor the semaphore of its package, through which it signals
+  the BSP when PcdCpuSmmHierarchicalSync is TRUE.
+
+  The processors without a valid APIC ID yet, such as the ones that may be
+  hot-added, share the semaphore of the first package.
+
+**/
+VOID
+InitializePackageSemaphores (
+  VOID
+  )
+{
+  EFI_PROCESSOR_INFORMATION  *ProcessorInfo;
+  UINTN                      CpuIndex;
+  UINTN                      Index;
+
+  ProcessorInfo = gSmmCpuPrivate->ProcessorInfo;
+  mSmmMpSyncData->PackageRun   = mSmmCpuSemaphores.SemaphoreCpu.PackageRun;
+  mSmmMpSyncData->PackageCount = 1;
+
+  for (CpuIndex = 0; CpuIndex < gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus; CpuIndex ++) {
+    mSmmMpSyncData->CpuData[CpuIndex].PackageRun = mSmmMpSyncData->PackageRun;
+    if (ProcessorInfo[CpuIndex].ProcessorId == INVALID_APIC_ID) {
+      continue;
+    }
+
+    //
+    // Share the semaphore of the first processor found in the same package.
+    //
+    for (Index = 0; Index < CpuIndex; Index++) {
+      if (ProcessorInfo[Index].ProcessorId != INVALID_APIC_ID &&
+          ProcessorInfo[Index].Location.Package == ProcessorInfo[CpuIndex].Location.Package) {
+        break;
+      }
+    }
+    if (Index < CpuIndex) {
+      mSmmMpSyncData->CpuData[CpuIndex].PackageRun = mSmmMpSyncData->CpuData[Index].PackageRun;
+    } else if (CpuIndex != 0) {
+      mSmmMpSyncData->CpuData[CpuIndex].PackageRun =
+        (UINT32 *)((UINTN)mSmmMpSyncData->PackageRun + mSemaphoreSize * mSmmMpSyncData->PackageCount);
+      mSmmMpSyncData->PackageCount++;
+    }
+    *(mSmmMpSyncData->CpuData[CpuIndex].PackageRun) = 0;
+  }
+
+  DEBUG ((DEBUG_INFO, "SMM hierarchical sync: %d packages\n", mSmmMpSyncData->PackageCount));
+}
+
 /**
   Initialize un-cacheable data.
 
@@ -1888,6 +2169,10 @@ InitializeMpSyncData (
       *(mSmmMpSyncData->CpuData[CpuIndex].Run)     = 0;
       *(mSmmMpSyncData->CpuData[CpuIndex].Present) = FALSE;
     }
+
+    if (FeaturePcdGet (PcdCpuSmmHierarchicalSync)) {
+      InitializePackageSemaphores ();
+    }
   }
 }
 
@@ -1931,6 +2216,11 @@ InitializeMpServiceData (
   mSmmMpSyncData = (SMM_DISPATCHER_MP_SYNC_DATA*) AllocatePages (EFI_SIZE_TO_PAGES (mSmmMpSyncDataSize));
   ASSERT (mSmmMpSyncData != NULL);
   mCpuSmmSyncMode = (SMM_CPU_SYNC_MODE)PcdGet8 (PcdCpuSmmSyncMode);
+  if (mCpuSmmSyncMode >= SmmCpuSyncModeMax) {
+    DEBUG ((DEBUG_ERROR, "Invalid PcdCpuSmmSyncMode 0x%x, use the traditional sync mode\n", mCpuSmmSyncMode));
+    ASSERT (FALSE);
+    mCpuSmmSyncMode = SmmCpuSyncModeTradition;
+  }
   InitializeMpSyncData ();
 
   //
@@ -19,6 +19,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #include <Protocol/SmmAccess2.h>
 #include <Protocol/SmmReadyToLock.h>
 #include <Protocol/SmmCpuService.h>
+#include <Protocol/SmmCpuRendezvous.h>
 #include <Protocol/SmmMemoryAttribute.h>
 #include <Protocol/MmMp.h>
 
@@ -406,11 +407,17 @@ typedef struct {
   volatile BOOLEAN                  *Present;
   PROCEDURE_TOKEN                   *Token;
   EFI_STATUS                        *Status;
+  //
+  // The semaphore through which the processor signals the BSP when
+  // PcdCpuSmmHierarchicalSync is TRUE, shared by the processors of its package.
+  //
+  volatile UINT32                   *PackageRun;
 } SMM_CPU_DATA_BLOCK;
 
 typedef enum {
   SmmCpuSyncModeTradition,
   SmmCpuSyncModeRelaxedAp,
+  SmmCpuSyncModeOnDemandAp,
   SmmCpuSyncModeMax
 } SMM_CPU_SYNC_MODE;
 
@@ -429,6 +436,16 @@ typedef struct {
   volatile BOOLEAN              *CandidateBsp;
   EFI_AP_PROCEDURE              StartupProcedure;
   VOID                          *StartupProcArgs;
+  //
+  // The semaphores of the packages, mSemaphoreSize apart, when
+  // PcdCpuSmmHierarchicalSync is TRUE.
+  //
+  volatile UINT32               *PackageRun;
+  UINTN                         PackageCount;
+  //
+  // TRUE when an SMI handler asked for all the processors in this SMI run
+  //
+  volatile BOOLEAN              RendezvousRequested;
 } SMM_DISPATCHER_MP_SYNC_DATA;
 
 #define SMM_PSD_OFFSET              0xfb00
@@ -452,6 +469,10 @@ typedef struct {
   volatile UINT32                   *Run;
   volatile BOOLEAN                  *Present;
   SPIN_LOCK                         *Token;
+  //
+  // Semaphores of the packages, there are at most as many packages as processors
+  //
+  volatile UINT32                   *PackageRun;
 } SMM_CPU_SEMAPHORE_CPU;
 
 ///
@@ -546,6 +567,21 @@ IsSyncTimerTimeout (
   IN      UINT64                    Timer
   );
 
+/**
+  Get the number of performance counter ticks elapsed since the SMM AP Sync
+  timer started.
+
+  @param Timer  The start timer from the begin.
+
+  @return The number of ticks elapsed.
+
+**/
+UINT64
+EFIAPI
+GetSyncTimerElapsed (
+  IN      UINT64                    Timer
+  );
+
 /**
   Initialize IDT for SMM Stack Guard.
 
@@ -713,6 +749,35 @@ InitializeMpSyncData (
   VOID
   );
 
+/**
+  Wait for all the processors to enter SMM, except the ones that are blocked
+  or whose SMIs are disabled, and keep them in SMM until the SMI handlers return.
+
+  @param[in] BlockingMode         TRUE to wait until all the processors enter SMM.
+                                  FALSE to wait no longer than the SMM AP sync timeout.
+
+  @retval EFI_SUCCESS             All the processors, except the ones that are blocked
+                                  or whose SMIs are disabled, are in SMM.
+  @retval EFI_TIMEOUT             Some processors did not enter SMM before the timeout.
+  @retval EFI_DEVICE_ERROR        The calling processor is not the BSP in SMM.
+**/
+EFI_STATUS
+SmmWaitForAllProcessor (
+  IN BOOLEAN                    BlockingMode
+  );
+
+/**
+  In the on-demand AP sync mode, bring the APs into SMM before a procedure is
+  scheduled on them, unless an SMI handler already asked for them in this SMI
+  run.  The APs that do not enter SMM before the SMM AP sync timeout are left
+  out of the procedure.
+
+**/
+VOID
+SmmRendezvousOnDemand (
+  VOID
+  );
+
 /**
 
   Find out SMRAM information including SMRR base and SMRR size.
@@ -14,6 +14,7 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 UINT32                    mSmmProfileCr3;
 
 SMM_PROFILE_HEADER        *mSmmProfileBase;
+SMM_PROFILE_RENDEZVOUS    *mSmmProfileRendezvous;
 MSR_DS_AREA_STRUCT        *mMsrDsAreaBase;
 //
 // The buffer to store SMM profile data.
@@ -900,7 +901,7 @@ InitSmmProfileInternal (
   // Initialize SMM profile data header.
   //
   mSmmProfileBase->HeaderSize     = sizeof (SMM_PROFILE_HEADER);
-  mSmmProfileBase->MaxDataEntries = (UINT64)((mSmmProfileSize - sizeof(SMM_PROFILE_HEADER)) / sizeof (SMM_PROFILE_ENTRY));
+  mSmmProfileBase->MaxDataEntries = (UINT64)((mSmmProfileSize - sizeof(SMM_PROFILE_HEADER) - sizeof (SMM_PROFILE_RENDEZVOUS)) / sizeof (SMM_PROFILE_ENTRY));
   mSmmProfileBase->MaxDataSize    = MultU64x64 (mSmmProfileBase->MaxDataEntries, sizeof(SMM_PROFILE_ENTRY));
   mSmmProfileBase->CurDataEntries = 0;
   mSmmProfileBase->CurDataSize    = 0;
@@ -909,6 +910,13 @@ InitSmmProfileInternal (
   mSmmProfileBase->NumSmis        = 0;
   mSmmProfileBase->NumCpus        = gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus;
 
+  //
+  // Initialize the rendezvous trailer, after the profile entries.
+  //
+  mSmmProfileRendezvous = (SMM_PROFILE_RENDEZVOUS *)((UINTN)(mSmmProfileBase + 1) + (UINTN)mSmmProfileBase->MaxDataSize);
+  mSmmProfileRendezvous->Signature = SMM_PROFILE_RENDEZVOUS_SIGNATURE;
+  mSmmProfileRendezvous->Revision  = SMM_PROFILE_RENDEZVOUS_REVISION;
+
   if (mBtsSupported) {
     mMsrDsArea = (MSR_DS_AREA_STRUCT **)AllocateZeroPool (sizeof (MSR_DS_AREA_STRUCT *) * mMaxNumberOfCpus);
     ASSERT (mMsrDsArea != NULL);
@@ -1115,6 +1123,29 @@ SmmProfileRecordSmiNum (
   }
 }
 
+/**
+  Record the time the BSP waited for the APs to rendezvous in the SMI.
+
+  @param  RendezvousTicks  The number of performance counter ticks the BSP waited.
+
+**/
+VOID
+SmmProfileRecordRendezvousTime (
+  IN UINT64  RendezvousTicks
+  )
+{
+  UINT64  RendezvousTime;
+
+  if (mSmmProfileStart) {
+    RendezvousTime = GetTimeInNanoSecond (RendezvousTicks);
+    mSmmProfileRendezvous->LastRendezvousTime   = RendezvousTime;
+    mSmmProfileRendezvous->TotalRendezvousTime += RendezvousTime;
+    if (RendezvousTime > mSmmProfileRendezvous->MaxRendezvousTime) {
+      mSmmProfileRendezvous->MaxRendezvousTime = RendezvousTime;
+    }
+  }
+}
+
 /**
   Initialize processor environment for SMM profile.
 
@@ -46,6 +46,17 @@ SmmProfileRecordSmiNum (
   VOID
   );
 
+/**
+  Record the time the BSP waited for the APs to rendezvous in the SMI.
+
+  @param  RendezvousTicks  The number of performance counter ticks the BSP waited.
+
+**/
+VOID
+SmmProfileRecordRendezvousTime (
+  IN UINT64  RendezvousTicks
+  );
+
 /**
   The Page fault handler to save SMM profile data.
 
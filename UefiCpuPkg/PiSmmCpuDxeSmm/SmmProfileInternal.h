@@ -9,6 +9,8 @@ SPDX-License-Identifier: BSD-2-Clause-Patent
 #ifndef _SMM_PROFILE_INTERNAL_H_
 #define _SMM_PROFILE_INTERNAL_H_
 
+#include <PiDxe.h>
+
 #include <Protocol/SmmReadyToLock.h>
 #include <Library/UefiRuntimeServicesTableLib.h>
 #include <Library/DxeServicesTableLib.h>
@@ -95,6 +97,22 @@ typedef struct {
   UINT64  SmiCmd;
 } SMM_PROFILE_ENTRY;
 
+#define SMM_PROFILE_RENDEZVOUS_SIGNATURE  SIGNATURE_32 ('S', 'P', 'R', 'V')
+#define SMM_PROFILE_RENDEZVOUS_REVISION   1
+
+//
+// Trailer of the SMM profile data, right after the MaxDataSize bytes of
+// profile entries.  It records the time in nanoseconds the BSP waited for the
+// APs to rendezvous in the last SMI, in the longest one, and in all of them.
+//
+typedef struct {
+  UINT32  Signature;
+  UINT32  Revision;
+  UINT64  LastRendezvousTime;
+  UINT64  MaxRendezvousTime;
+  UINT64  TotalRendezvousTime;
+} SMM_PROFILE_RENDEZVOUS;
+
 extern SMM_S3_RESUME_STATE       *mSmmS3ResumeState;
 extern UINTN                     gSmiExceptionHandlers[];
 extern BOOLEAN                   mXdSupported;
@@ -0,0 +1,295 @@
+/** @file
+  Host based unit tests of the SMM MP services of the SMM CPU driver.
+
+  The tests model an SMI run in which the BSP runs the SMI handlers, and check
+  how the APs join it in the on-demand AP synchronization method: an AP that
+  no SMI handler asked for leaves SMM at once, and scheduling a procedure on
+  the APs brings them into SMM.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <setjmp.h>
+#include <cmocka.h>
+
+#include <Library/UnitTestLib.h>
+
+#include "PiSmmCpuDxeSmm.h"
+#include "MpServiceUnitTest.h"
+
+#define UNIT_TEST_APP_NAME        "SMM MP Service Unit Tests"
+#define UNIT_TEST_APP_VERSION     "1.0"
+
+/**
+  Procedure of the tests.  The APs of the tests do not run it.
+
+  @param[in,out] Buffer  Unused.
+
+  @retval EFI_SUCCESS    The procedure ran.
+**/
+EFI_STATUS
+EFIAPI
+MpServiceTestProcedure (
+  IN OUT VOID  *Buffer
+  )
+{
+  return EFI_SUCCESS;
+}
+
+/**
+  Start an SMI run in the sync mode of the test: the BSP is in SMM and runs
+  the SMI handlers, and the APs are outside SMM and respond to SMI IPIs.
+
+  @param[in]  Context    The sync mode of the test.
+
+  @retval  UNIT_TEST_PASSED                      The SMI run is started.
+  @retval  UNIT_TEST_ERROR_PREREQUISITE_NOT_MET  There is not enough memory.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+MpServiceTestSetup (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  UINTN  Index;
+
+  if (mSmmMpSyncData == NULL) {
+    for (Index = 0; Index < MP_SERVICE_TEST_CPU_COUNT; Index++) {
+      mStubProcessorInfo[Index].ProcessorId = Index;
+    }
+    gSmmCpuPrivate->SmmCoreEntryContext.NumberOfCpus = MP_SERVICE_TEST_CPU_COUNT;
+    InitializeSmmCpuSemaphores ();
+    InitializeDataForMmMp ();
+
+    mSmmMpSyncDataSize = sizeof (SMM_DISPATCHER_MP_SYNC_DATA) +
+                         (sizeof (SMM_CPU_DATA_BLOCK) + sizeof (BOOLEAN)) * MP_SERVICE_TEST_CPU_COUNT;
+    mSmmMpSyncData = AllocatePool (mSmmMpSyncDataSize);
+    if (mSmmMpSyncData == NULL) {
+      return UNIT_TEST_ERROR_PREREQUISITE_NOT_MET;
+    }
+  }
+
+  mCpuSmmSyncMode = (SMM_CPU_SYNC_MODE) (UINTN) Context;
+  InitializeMpSyncData ();
+
+  mSmmMpSyncData->BspIndex = 0;
+  gSmmCpuPrivate->SmmCoreEntryContext.CurrentlyExecutingCpu = 0;
+  *(mSmmMpSyncData->CpuData[0].Present) = TRUE;
+  *mSmmMpSyncData->Counter              = 1;
+  *mSmmMpSyncData->InsideSmm            = TRUE;
+
+  for (Index = 0; Index < MP_SERVICE_TEST_CPU_COUNT; Index++) {
+    mStubSmiIpiCount[Index]  = 0;
+    mStubApResponsive[Index] = TRUE;
+  }
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  An AP that enters SMM while no SMI handler asked for the APs leaves SMM at
+  once, unless the BSP has locked the arrival counter down.
+
+  @param[in]  Context    The sync mode of the test.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+ApShouldLeaveSmiEarlyUnlessAskedFor (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  //
+  // AP 1 checks in, and leaves
+  //
+  InterlockedIncrement ((UINT32 *) mSmmMpSyncData->Counter);
+  APHandler (1, TRUE, SmmCpuSyncModeOnDemandAp);
+  UT_ASSERT_EQUAL (*mSmmMpSyncData->Counter, 1);
+  UT_ASSERT_FALSE (*(mSmmMpSyncData->CpuData[1].Present));
+
+  //
+  // The arrival cannot be withdrawn once the counter is locked down
+  //
+  *mSmmMpSyncData->Counter = (UINT32) -1;
+  UT_ASSERT_FALSE (LeaveSmiEarly ());
+  UT_ASSERT_EQUAL (*mSmmMpSyncData->Counter, (UINT32) -1);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Scheduling a procedure on an AP that is outside SMM brings the APs into SMM
+  once in the SMI run.  An AP that does not enter SMM is rejected.
+
+  @param[in]  Context    The sync mode of the test.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+StartupThisApShouldBringApsIn (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS     Status;
+  MM_COMPLETION  Token;
+
+  mStubApResponsive[3] = FALSE;
+
+  Status = InternalSmmStartupThisAp (MpServiceTestProcedure, 2, NULL, &Token, 0, NULL);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  UT_ASSERT_TRUE (mSmmMpSyncData->RendezvousRequested);
+  UT_ASSERT_NOT_EQUAL (mStubSmiIpiCount[2], 0);
+  UT_ASSERT_TRUE (*(mSmmMpSyncData->CpuData[1].Present));
+  UT_ASSERT_TRUE (*(mSmmMpSyncData->CpuData[2].Present));
+  UT_ASSERT_FALSE (*(mSmmMpSyncData->CpuData[3].Present));
+  UT_ASSERT_EQUAL ((UINTN) mSmmMpSyncData->CpuData[2].Procedure, (UINTN) MpServiceTestProcedure);
+  UT_ASSERT_EQUAL (*(mSmmMpSyncData->CpuData[2].Run), 1);
+
+  //
+  // The AP that did not enter SMM is not asked for again in this SMI run
+  //
+  UT_ASSERT_NOT_EQUAL (mStubSmiIpiCount[3], 0);
+  mStubSmiIpiCount[3] = 0;
+  Status = InternalSmmStartupThisAp (MpServiceTestProcedure, 3, NULL, &Token, 0, NULL);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_INVALID_PARAMETER);
+  UT_ASSERT_EQUAL (mStubSmiIpiCount[3], 0);
+  UT_ASSERT_EQUAL (*(mSmmMpSyncData->CpuData[3].Run), 0);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Scheduling a procedure on all the APs brings them into SMM first.
+
+  @param[in]  Context    The sync mode of the test.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+StartupAllApsShouldBringApsIn (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS     Status;
+  MM_COMPLETION  Token;
+  UINTN          Index;
+
+  Status = InternalSmmStartupAllAPs (MpServiceTestProcedure, 0, NULL, &Token, NULL);
+  UT_ASSERT_NOT_EFI_ERROR (Status);
+  for (Index = 1; Index < MP_SERVICE_TEST_CPU_COUNT; Index++) {
+    UT_ASSERT_TRUE (*(mSmmMpSyncData->CpuData[Index].Present));
+    UT_ASSERT_EQUAL (*(mSmmMpSyncData->CpuData[Index].Run), 1);
+  }
+  UT_ASSERT_EQUAL (*mSmmMpSyncData->Counter, MP_SERVICE_TEST_CPU_COUNT);
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  In the relaxed sync mode, an AP outside SMM is rejected without being
+  brought into SMM.
+
+  @param[in]  Context    The sync mode of the test.
+
+  @retval  UNIT_TEST_PASSED             The test passed.
+  @retval  UNIT_TEST_ERROR_TEST_FAILED  A test assertion failed.
+**/
+UNIT_TEST_STATUS
+EFIAPI
+StartupThisApShouldNotBringApsInRelaxedMode (
+  IN UNIT_TEST_CONTEXT  Context
+  )
+{
+  EFI_STATUS     Status;
+  MM_COMPLETION  Token;
+
+  Status = InternalSmmStartupThisAp (MpServiceTestProcedure, 2, NULL, &Token, 0, NULL);
+  UT_ASSERT_STATUS_EQUAL (Status, EFI_INVALID_PARAMETER);
+  UT_ASSERT_EQUAL (mStubSmiIpiCount[2], 0);
+  UT_ASSERT_FALSE (*(mSmmMpSyncData->CpuData[2].Present));
+
+  return UNIT_TEST_PASSED;
+}
+
+/**
+  Initialize the unit test framework, suite, and unit tests for the SMM MP
+  services and run the unit tests.
+
+  @retval  EFI_SUCCESS           All test cases were dispatched.
+  @retval  EFI_OUT_OF_RESOURCES  There are not enough resources available to
+                                 initialize the unit tests.
+**/
+EFI_STATUS
+EFIAPI
+UnitTestingEntry (
+  VOID
+  )
+{
+  EFI_STATUS                  Status;
+  UNIT_TEST_FRAMEWORK_HANDLE  Framework;
+  UNIT_TEST_SUITE_HANDLE      SyncModeTests;
+  UNIT_TEST_CONTEXT           OnDemand;
+  UNIT_TEST_CONTEXT           Relaxed;
+
+  Framework = NULL;
+  OnDemand  = (UNIT_TEST_CONTEXT) (UINTN) SmmCpuSyncModeOnDemandAp;
+  Relaxed   = (UNIT_TEST_CONTEXT) (UINTN) SmmCpuSyncModeRelaxedAp;
+
+  DEBUG ((DEBUG_INFO, "%a v%a\n", UNIT_TEST_APP_NAME, UNIT_TEST_APP_VERSION));
+
+  //
+  // Start setting up the test framework for running the tests.
+  //
+  Status = InitUnitTestFramework (&Framework, UNIT_TEST_APP_NAME, gEfiCallerBaseName, UNIT_TEST_APP_VERSION);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in InitUnitTestFramework. Status = %r\n", Status));
+    goto EXIT;
+  }
+
+  Status = CreateUnitTestSuite (&SyncModeTests, Framework, "SMM CPU Sync Mode Tests", "PiSmmCpuDxeSmm.MpService.SyncMode", NULL, NULL);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "Failed in CreateUnitTestSuite for SyncModeTests\n"));
+    Status = EFI_OUT_OF_RESOURCES;
+    goto EXIT;
+  }
+
+  AddTestCase (SyncModeTests, "AP should leave an SMI early unless asked for", "LeaveEarly", ApShouldLeaveSmiEarlyUnlessAskedFor, MpServiceTestSetup, NULL, OnDemand);
+  AddTestCase (SyncModeTests, "StartupThisAp should bring the APs in on demand", "StartupThisAp", StartupThisApShouldBringApsIn, MpServiceTestSetup, NULL, OnDemand);
+  AddTestCase (SyncModeTests, "StartupAllAPs should bring the APs in on demand", "StartupAllAps", StartupAllApsShouldBringApsIn, MpServiceTestSetup, NULL, OnDemand);
+  AddTestCase (SyncModeTests, "StartupThisAp should not bring the APs in the relaxed mode", "Relaxed", StartupThisApShouldNotBringApsInRelaxedMode, MpServiceTestSetup, NULL, Relaxed);
+
+  //
+  // Execute the tests.
+  //
+  Status = RunAllTestSuites (Framework);
+
+EXIT:
+  if (Framework) {
+    FreeUnitTestFramework (Framework);
+  }
+
+  return Status;
+}
+
+/**
+  Standard POSIX C entry point for host based unit test execution.
+**/
+int
+main (
+  int argc,
+  char *argv[]
+  )
+{
+  return UnitTestingEntry ();
+}
@@ -0,0 +1,74 @@
+/** @file
+  Definitions shared by the host based unit tests of the SMM MP services of
+  the SMM CPU driver and the stand-ins of the services they depend on.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#ifndef _MP_SERVICE_UNIT_TEST_H_
+#define _MP_SERVICE_UNIT_TEST_H_
+
+//
+// Number of processors of the tests, the BSP being processor 0
+//
+#define MP_SERVICE_TEST_CPU_COUNT  4
+
+//
+// Processors of the tests
+//
+extern EFI_PROCESSOR_INFORMATION  mStubProcessorInfo[MP_SERVICE_TEST_CPU_COUNT];
+
+//
+// Number of SMI IPIs sent to each processor, and the APs that enter SMM when
+// they receive one
+//
+extern UINTN                      mStubSmiIpiCount[MP_SERVICE_TEST_CPU_COUNT];
+extern BOOLEAN                    mStubApResponsive[MP_SERVICE_TEST_CPU_COUNT];
+
+//
+// Data of the SMM MP services that the header of the SMM CPU driver does not
+// declare
+//
+extern UINTN                      mSmmMpSyncDataSize;
+extern SMM_CPU_SYNC_MODE          mCpuSmmSyncMode;
+
+/**
+  Allocate buffer for all semaphores and spin locks.
+
+**/
+VOID
+InitializeSmmCpuSemaphores (
+  VOID
+  );
+
+/**
+  Withdraw the arrival of an AP in SMM, so that it leaves SMM without
+  synchronizing with the BSP.
+
+  @retval TRUE   The arrival of the AP is withdrawn.
+  @retval FALSE  The BSP has locked the counter down.
+
+**/
+BOOLEAN
+LeaveSmiEarly (
+  VOID
+  );
+
+/**
+  SMI handler for AP.
+
+  @param     CpuIndex         AP processor Index.
+  @param     ValidSmi         Indicates that current SMI is a valid SMI or not.
+  @param     SyncMode         SMM MP sync mode.
+
+**/
+VOID
+APHandler (
+  IN      UINTN                     CpuIndex,
+  IN      BOOLEAN                   ValidSmi,
+  IN      SMM_CPU_SYNC_MODE         SyncMode
+  );
+
+#endif
@@ -0,0 +1,439 @@
+/** @file
+  Host based stand-ins for the services and data that the SMM MP services of
+  the SMM CPU driver (MpService.c) depend on, for the tests of the SMM CPU
+  synchronization methods.
+
+  The stand-ins model MP_SERVICE_TEST_CPU_COUNT processors whose APIC IDs are
+  their indexes, the BSP being processor 0.  The timers of the SMM AP sync
+  timeout expire at once, and an SMI IPI brings an AP into SMM at once, unless
+  the tests make the AP unresponsive.
+
+  Copyright (c) 2020, Intel Corporation. All rights reserved.<BR>
+  SPDX-License-Identifier: BSD-2-Clause-Patent
+
+**/
+
+#include "PiSmmCpuDxeSmm.h"
+#include "MpServiceUnitTest.h"
+
+//
+// Processors of the tests, and data of the SMM CPU driver
+//
+EFI_PROCESSOR_INFORMATION  mStubProcessorInfo[MP_SERVICE_TEST_CPU_COUNT];
+SMM_CPU_OPERATION          mStubOperation[MP_SERVICE_TEST_CPU_COUNT];
+
+SMM_CPU_PRIVATE_DATA  mStubSmmCpuPrivateData = {
+  SMM_CPU_PRIVATE_DATA_SIGNATURE,
+  NULL,
+  mStubProcessorInfo,
+  mStubOperation
+};
+
+SMM_CPU_PRIVATE_DATA  *gSmmCpuPrivate = &mStubSmmCpuPrivateData;
+CPU_HOT_PLUG_DATA     mCpuHotPlugData;
+UINTN                 mMaxNumberOfCpus = MP_SERVICE_TEST_CPU_COUNT;
+UINTN                 mNumberOfCpus    = MP_SERVICE_TEST_CPU_COUNT;
+UINT64                mAddressEncMask  = 0;
+SPIN_LOCK             *mConfigSmmCodeAccessCheckLock = NULL;
+EFI_MM_MP_PROTOCOL    mSmmMp;
+IA32_DESCRIPTOR       gcSmiGdtr;
+IA32_DESCRIPTOR       gcSmiIdtr;
+
+//
+// Number of SMI IPIs sent to each processor, and the APs that enter SMM when
+// they receive one
+//
+UINTN    mStubSmiIpiCount[MP_SERVICE_TEST_CPU_COUNT];
+BOOLEAN  mStubApResponsive[MP_SERVICE_TEST_CPU_COUNT];
+
+/**
+  Get the APIC ID of the BSP, which calls the SMM MP services.
+
+  @return  The APIC ID of the BSP.
+
+**/
+UINT32
+EFIAPI
+GetApicId (
+  VOID
+  )
+{
+  return (UINT32) mStubProcessorInfo[0].ProcessorId;
+}
+
+/**
+  Send an SMI IPI to a processor, and count it.  A responsive AP that is not
+  in SMM enters SMM the way SmiRendezvous() does, and stays there for the SMI
+  run.
+
+  @param  ApicId  The APIC ID of the processor.
+
+**/
+VOID
+EFIAPI
+SendSmiIpi (
+  IN UINT32  ApicId
+  )
+{
+  ASSERT (ApicId < MP_SERVICE_TEST_CPU_COUNT);
+  mStubSmiIpiCount[ApicId]++;
+  if (mStubApResponsive[ApicId] && !*(mSmmMpSyncData->CpuData[ApicId].Present)) {
+    InitializeSpinLock (mSmmMpSyncData->CpuData[ApicId].Busy);
+    *(mSmmMpSyncData->CpuData[ApicId].Present) = TRUE;
+    InterlockedIncrement ((UINT32 *) mSmmMpSyncData->Counter);
+  }
+}
+
+/**
+  Start the SMM AP sync timer.
+
+  @return  0.
+
+**/
+UINT64
+EFIAPI
+StartSyncTimer (
+  VOID
+  )
+{
+  return 0;
+}
+
+/**
+  The SMM AP sync timer expires at once.
+
+  @param  Timer  Unused.
+
+  @retval TRUE   The timer has expired.
+
+**/
+BOOLEAN
+EFIAPI
+IsSyncTimerTimeout (
+  IN      UINT64                    Timer
+  )
+{
+  return TRUE;
+}
+
+/**
+  The processors have no SMM registers.
+
+  @param  CpuIndex  Unused.
+  @param  RegName   Unused.
+
+  @return  0.
+
+**/
+UINT64
+EFIAPI
+SmmCpuFeaturesGetSmmRegister (
+  IN UINTN         CpuIndex,
+  IN SMM_REG_NAME  RegName
+  )
+{
+  return 0;
+}
+
+/**
+  The MTRRs are not configured in SMM.
+
+  @retval FALSE  The MTRRs are not configured in SMM.
+
+**/
+BOOLEAN
+EFIAPI
+SmmCpuFeaturesNeedConfigureMtrrs (
+  VOID
+  )
+{
+  return FALSE;
+}
+
+/**
+  Not used by the tests.
+**/
+VOID
+EFIAPI
+SmmCpuFeaturesDisableSmrr (
+  VOID
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Not used by the tests.
+**/
+VOID
+EFIAPI
+SmmCpuFeaturesReenableSmrr (
+  VOID
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Not used by the tests.
+
+  @param  CpuIndex  Unused.
+**/
+VOID
+EFIAPI
+SmmCpuFeaturesRendezvousEntry (
+  IN UINTN  CpuIndex
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Not used by the tests.
+
+  @param  CpuIndex  Unused.
+**/
+VOID
+EFIAPI
+SmmCpuFeaturesRendezvousExit (
+  IN UINTN  CpuIndex
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Not used by the tests.
+
+  @param  MtrrSetting  Unused.
+
+  @return  MtrrSetting.
+**/
+MTRR_SETTINGS *
+EFIAPI
+MtrrGetAllMtrrs (
+  OUT MTRR_SETTINGS                *MtrrSetting
+  )
+{
+  ASSERT (FALSE);
+  return MtrrSetting;
+}
+
+/**
+  Not used by the tests.
+
+  @param  MtrrSetting  Unused.
+
+  @return  MtrrSetting.
+**/
+MTRR_SETTINGS *
+EFIAPI
+MtrrSetAllMtrrs (
+  IN MTRR_SETTINGS                *MtrrSetting
+  )
+{
+  ASSERT (FALSE);
+  return MtrrSetting;
+}
+
+/**
+  Not used by the tests.
+
+  @retval FALSE  The SMI is not valid.
+**/
+BOOLEAN
+EFIAPI
+PlatformValidSmi (
+  VOID
+  )
+{
+  ASSERT (FALSE);
+  return FALSE;
+}
+
+/**
+  Not used by the tests.
+
+  @retval FALSE  The SMI status is not cleared.
+**/
+BOOLEAN
+EFIAPI
+ClearTopLevelSmiStatus (
+  VOID
+  )
+{
+  ASSERT (FALSE);
+  return FALSE;
+}
+
+/**
+  Not used by the tests.
+
+  @param  IsBsp  Unused.
+
+  @retval EFI_NOT_READY  The BSP is not elected.
+**/
+EFI_STATUS
+EFIAPI
+PlatformSmmBspElection (
+  OUT BOOLEAN     *IsBsp
+  )
+{
+  ASSERT (FALSE);
+  return EFI_NOT_READY;
+}
+
+/**
+  Not used by the tests.
+
+  @param  InitFlag  Unused.
+  @param  Context   Unused.
+  @param  Function  Unused.
+**/
+VOID
+EFIAPI
+InitializeDebugAgent (
+  IN UINT32                InitFlag,
+  IN VOID                  *Context, OPTIONAL
+  IN DEBUG_AGENT_CONTINUE  Function  OPTIONAL
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Not used by the tests.
+
+  @param  Cr2  Unused.
+**/
+VOID
+SaveCr2 (
+  OUT UINTN  *Cr2
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Not used by the tests.
+
+  @param  Cr2  Unused.
+**/
+VOID
+RestoreCr2 (
+  IN UINTN  Cr2
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Not used by the tests.
+**/
+VOID
+PerformPreTasks (
+  VOID
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Not used by the tests.
+**/
+VOID
+PerformRemainingTasks (
+  VOID
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Not used by the tests.
+**/
+VOID
+SmmCpuUpdate (
+  VOID
+  )
+{
+  ASSERT (FALSE);
+}
+
+/**
+  Not used by the tests.
+
+  @return  0.
+**/
+UINT32
+SmmInitPageTable (
+  VOID
+  )
+{
+  ASSERT (FALSE);
+  return 0;
+}
+
+/**
+  Not used by the tests.
+
+  @param  Cr3          Unused.
+  @param  GdtStepSize  Unused.
+
+  @return  NULL.
+**/
+VOID *
+InitGdt (
+  IN  UINTN  Cr3,
+  OUT UINTN  *GdtStepSize
+  )
+{
+  ASSERT (FALSE);
+  return NULL;
+}
+
+/**
+  Not used by the tests.
+
+  @param  Pages  Unused.
+
+  @return  NULL.
+**/
+VOID *
+AllocatePageTableMemory (
+  IN UINTN           Pages
+  )
+{
+  ASSERT (FALSE);
+  return NULL;
+}
+
+/**
+  Not used by the tests.
+
+  @param  CpuIndex   Unused.
+  @param  SmBase     Unused.
+  @param  SmiStack   Unused.
+  @param  StackSize  Unused.
+  @param  GdtBase    Unused.
+  @param  GdtSize    Unused.
+  @param  IdtBase    Unused.
+  @param  IdtSize    Unused.
+  @param  Cr3        Unused.
+**/
+VOID
+EFIAPI
+InstallSmiHandler (
+  IN UINTN   CpuIndex,
+  IN UINT32  SmBase,
+  IN VOID    *SmiStack,
+  IN UINTN   StackSize,
+  IN UINTN   GdtBase,
+  IN UINTN   GdtSize,
+  IN UINTN   IdtBase,
+  IN UINTN   IdtSize,
+  IN UINT32  Cr3
+  )
+{
+  ASSERT (FALSE);
+}